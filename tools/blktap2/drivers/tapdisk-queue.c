@@ -113,6 +113,32 @@ queue_deferred_tiocbs(struct tqueue *queue)
 		queue_deferred_tiocb(queue);
 }
 
+static void
+account_tiocb_latency(struct tqueue *queue, struct tiocb *tiocb)
+{
+	struct timeval now;
+	uint64_t usecs;
+
+	gettimeofday(&now, NULL);
+	usecs  = (now.tv_sec - tiocb->ts.tv_sec) * 1000000ULL;
+	usecs += now.tv_usec - tiocb->ts.tv_usec;
+
+	queue->stats.completed++;
+	queue->stats.lat_usecs += usecs;
+	if (usecs > queue->stats.lat_max_usecs)
+		queue->stats.lat_max_usecs = usecs;
+}
+
+static void
+account_tiocb_submit(struct tqueue *queue, int queued, int submitted)
+{
+	queue->stats.submits++;
+	queue->stats.tiocbs_queued   += queued;
+	queue->stats.iocbs_submitted += submitted;
+	if (submitted > queue->stats.max_batch)
+		queue->stats.max_batch = submitted;
+}
+
 /*
  * td_complete may queue more tiocbs
  */
@@ -129,6 +155,8 @@ complete_tiocb(struct tqueue *queue, struct tiocb *tiocb, unsigned long res)
 	else
 		err = -EIO;
 
+	account_tiocb_latency(queue, tiocb);
+
 	tiocb->cb(tiocb->arg, tiocb, err);
 }
 
@@ -237,6 +265,8 @@ tapdisk_rwio_submit(struct tqueue *queue)
 	tapdisk_filter_iocbs(queue->filter, queue->iocbs, queue->queued);
 	merged = io_merge(&queue->opioctx, queue->iocbs, queue->queued);
 
+	account_tiocb_submit(queue, queue->queued, merged);
+
 	queue->queued = 0;
 
 	for (i = 0; i < merged; i++) {
@@ -522,6 +552,9 @@ tapdisk_lio_submit(struct tqueue *queue)
 	DBG("queued: %d, merged: %d, submitted: %d\n",
 	    queue->queued, merged, submitted);
 
+	account_tiocb_submit(queue, queue->queued,
+			     submitted < 0 ? 0 : submitted);
+
 	if (submitted < 0) {
 		err = submitted;
 		submitted = 0;
@@ -660,6 +693,19 @@ tapdisk_debug_queue(struct tqueue *queue)
 	     "tiocbs_pending: %d, tiocbs_deferred: %d, deferrals: %"PRIx64"\n",
 	     queue->size, queue->tio->name, queue->queued, queue->iocbs_pending,
 	     queue->tiocbs_pending, queue->tiocbs_deferred, queue->deferrals);
+	WARN("submits: %"PRIu64", tiocbs: %"PRIu64", iocbs: %"PRIu64", "
+	     "avg batch: %"PRIu64", max batch: %d, max depth: %d\n",
+	     queue->stats.submits, queue->stats.tiocbs_queued,
+	     queue->stats.iocbs_submitted,
+	     queue->stats.submits ?
+	     queue->stats.iocbs_submitted / queue->stats.submits : 0,
+	     queue->stats.max_batch, queue->stats.max_depth);
+	WARN("completed: %"PRIu64", avg lat: %"PRIu64"us, "
+	     "max lat: %"PRIu64"us\n",
+	     queue->stats.completed,
+	     queue->stats.completed ?
+	     queue->stats.lat_usecs / queue->stats.completed : 0,
+	     queue->stats.lat_max_usecs);
 
 	if (tiocb) {
 		WARN("deferred:\n");
@@ -693,6 +739,14 @@ tapdisk_prep_tiocb(struct tiocb *tiocb, int fd, int rw, char *buf, size_t size,
 void
 tapdisk_queue_tiocb(struct tqueue *queue, struct tiocb *tiocb)
 {
+	int depth;
+
+	gettimeofday(&tiocb->ts, NULL);
+
+	depth = queue->tiocbs_pending + queue->queued + 1;
+	if (depth > queue->stats.max_depth)
+		queue->stats.max_depth = depth;
+
 	if (!tapdisk_queue_full(queue))
 		queue_tiocb(queue, tiocb);
 	else
@@ -30,6 +30,7 @@
 #define TAPDISK_QUEUE_H
 
 #include <libaio.h>
+#include <sys/time.h>
 
 #include "io-optimize.h"
 #include "scheduler.h"
@@ -46,6 +47,9 @@ struct tiocb {
 
 	struct iocb           iocb;
 	struct tiocb         *next;
+
+	/* time the request was queued, for latency accounting */
+	struct timeval        ts;
 };
 
 struct tlist {
@@ -82,6 +86,19 @@ struct tqueue {
 	struct tfilter       *filter;
 
 	uint64_t              deferrals;
+
+	/* submission batching and completion latency statistics.
+	 * latencies cover queueing (including deferral) to completion. */
+	struct {
+		uint64_t      submits;         /* batch submissions */
+		uint64_t      tiocbs_queued;   /* requests queued */
+		uint64_t      iocbs_submitted; /* iocbs after merging */
+		int           max_batch;       /* largest single batch */
+		int           max_depth;       /* queue depth high water */
+		uint64_t      completed;       /* requests completed */
+		uint64_t      lat_usecs;       /* cumulative latency */
+		uint64_t      lat_max_usecs;   /* worst-case latency */
+	} stats;
 };
 
 struct tio {
@@ -85,8 +85,10 @@
 #define VHD_OPEN_FAST              0x00004
 #define VHD_OPEN_STRICT            0x00008
 #define VHD_OPEN_IGNORE_DISABLED   0x00010
+#define VHD_OPEN_CACHED            0x00020
 
 #define VHD_FLAG_CREAT_PARENT_RAW        0x00001
+#define VHD_FLAG_CREAT_PREALLOCATE       0x00002
 
 #define vhd_flag_set(word, flag)         ((word) |= (flag))
 #define vhd_flag_clear(word, flag)       ((word) &= ~(flag))
@@ -151,6 +153,11 @@ struct vhd_context {
 	vhd_footer_t               footer;
 	vhd_bat_t                  bat;
 	vhd_batmap_t               batmap;
+
+	/* in-memory bitmap cache (VHD_OPEN_CACHED); dirty entries are
+	 * batched in memory until vhd_flush_bitmap_cache or close */
+	char                     **bm_cache;
+	char                      *bm_dirty;
 };
 
 static inline uint32_t
@@ -318,6 +325,7 @@ int vhd_write_header_at(vhd_context_t *, vhd_header_t *, off_t);
 int vhd_write_bat(vhd_context_t *, vhd_bat_t *);
 int vhd_write_batmap(vhd_context_t *, vhd_batmap_t *);
 int vhd_write_bitmap(vhd_context_t *, uint32_t block, char *bitmap);
+int vhd_flush_bitmap_cache(vhd_context_t *);
 int vhd_write_block(vhd_context_t *, uint32_t block, char *data);
 
 int vhd_io_read(vhd_context_t *, char *, uint64_t, uint32_t);
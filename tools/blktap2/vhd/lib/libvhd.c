@@ -1813,6 +1813,16 @@ vhd_read_bitmap(vhd_context_t *ctx, uint32_t block, char **bufp)
 	off  = vhd_sectors_to_bytes(blk);
 	size = vhd_bytes_padded(ctx->spb >> 3);
 
+	if (ctx->bm_cache && ctx->bm_cache[block]) {
+		err = posix_memalign((void **)&buf, VHD_SECTOR_SIZE, size);
+		if (err)
+			return -err;
+
+		memcpy(buf, ctx->bm_cache[block], size);
+		*bufp = buf;
+		return 0;
+	}
+
 	err  = vhd_seek(ctx, off, SEEK_SET);
 	if (err)
 		return err;
@@ -1825,6 +1835,15 @@ vhd_read_bitmap(vhd_context_t *ctx, uint32_t block, char **bufp)
 	if (err)
 		goto fail;
 
+	if (ctx->bm_cache) {
+		char *copy;
+
+		if (!posix_memalign((void **)&copy, VHD_SECTOR_SIZE, size)) {
+			memcpy(copy, buf, size);
+			ctx->bm_cache[block] = copy;
+		}
+	}
+
 	*bufp = buf;
 	return 0;
 
@@ -2159,6 +2178,23 @@ vhd_write_bitmap(vhd_context_t *ctx, uint32_t block, char *bitmap)
 	off  = vhd_sectors_to_bytes(blk);
 	size = vhd_sectors_to_bytes(ctx->bm_secs);
 
+	if (ctx->bm_cache) {
+		char *copy = ctx->bm_cache[block];
+
+		if (!copy) {
+			err = posix_memalign((void **)&copy,
+					     VHD_SECTOR_SIZE, size);
+			if (err)
+				return -err;
+			ctx->bm_cache[block] = copy;
+		}
+
+		/* defer the write; batched in vhd_flush_bitmap_cache */
+		memcpy(copy, bitmap, size);
+		ctx->bm_dirty[block] = 1;
+		return 0;
+	}
+
 	err  = vhd_seek(ctx, off, SEEK_SET);
 	if (err)
 		return err;
@@ -2351,6 +2387,75 @@ out:
 	return err;
 }
 
+static int
+vhd_init_bitmap_cache(vhd_context_t *ctx)
+{
+	int err;
+
+	err = vhd_get_bat(ctx);
+	if (err)
+		return err;
+
+	ctx->bm_cache = calloc(ctx->bat.entries, sizeof(char *));
+	if (!ctx->bm_cache)
+		return -ENOMEM;
+
+	ctx->bm_dirty = calloc(ctx->bat.entries, sizeof(char));
+	if (!ctx->bm_dirty) {
+		free(ctx->bm_cache);
+		ctx->bm_cache = NULL;
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static void
+vhd_free_bitmap_cache(vhd_context_t *ctx)
+{
+	int i;
+
+	if (ctx->bm_cache) {
+		for (i = 0; i < ctx->bat.entries; i++)
+			free(ctx->bm_cache[i]);
+		free(ctx->bm_cache);
+		ctx->bm_cache = NULL;
+	}
+
+	free(ctx->bm_dirty);
+	ctx->bm_dirty = NULL;
+}
+
+int
+vhd_flush_bitmap_cache(vhd_context_t *ctx)
+{
+	int i, err;
+	size_t size;
+
+	if (!ctx->bm_cache)
+		return 0;
+
+	size = vhd_sectors_to_bytes(ctx->bm_secs);
+
+	for (i = 0; i < ctx->bat.entries; i++) {
+		if (!ctx->bm_dirty[i])
+			continue;
+
+		err = vhd_seek(ctx, vhd_sectors_to_bytes(ctx->bat.bat[i]),
+			       SEEK_SET);
+		if (err)
+			return err;
+
+		err = vhd_write(ctx, ctx->bm_cache[i], size);
+		if (err)
+			return err;
+
+		ctx->bm_dirty[i] = 0;
+	}
+
+	return 0;
+}
+
 int
 vhd_open(vhd_context_t *ctx, const char *file, int flags)
 {
@@ -2408,11 +2513,19 @@ vhd_open(vhd_context_t *ctx, const char *file, int flags)
 
 		ctx->spb     = ctx->header.block_size >> VHD_SECTOR_SHIFT;
 		ctx->bm_secs = secs_round_up_no_zero(ctx->spb >> 3);
+
+		if (flags & VHD_OPEN_CACHED) {
+			err = vhd_init_bitmap_cache(ctx);
+			if (err)
+				goto fail;
+		}
 	}
 
 	return 0;
 
 fail:
+	vhd_free_bitmap_cache(ctx);
+	vhd_put_bat(ctx);
 	if (ctx->fd != -1)
 		close(ctx->fd);
 	free(ctx->file);
@@ -2423,6 +2536,9 @@ fail:
 void
 vhd_close(vhd_context_t *ctx)
 {
+	if (ctx->bm_cache)
+		vhd_flush_bitmap_cache(ctx);
+	vhd_free_bitmap_cache(ctx);
 	if (ctx->file)
 		close(ctx->fd);
 	free(ctx->file);
@@ -2769,6 +2885,77 @@ vhd_create_bat(vhd_context_t *ctx)
 	return vhd_write_bat(ctx, &ctx->bat);
 }
 
+/*
+ * Allocate every block of a dynamic disk up front, laid out sequentially,
+ * so sequential guest writes translate to sequential physical I/O.
+ */
+static int
+vhd_initialize_preallocated_blocks(vhd_context_t *ctx)
+{
+	int i, err;
+	off_t off;
+	uint64_t sec;
+	uint32_t spb, bm_secs;
+
+	spb     = ctx->header.block_size >> VHD_SECTOR_SHIFT;
+	bm_secs = secs_round_up_no_zero(spb >> 3);
+
+	err = vhd_seek(ctx, 0, SEEK_END);
+	if (err)
+		return err;
+
+	off = vhd_position(ctx);
+	if (off == (off_t)-1)
+		return -errno;
+
+	sec = off >> VHD_SECTOR_SHIFT;
+	for (i = 0; i < ctx->bat.entries; i++) {
+		ctx->bat.bat[i] = sec;
+		sec += bm_secs + spb;
+	}
+
+	if (ctx->is_block) {
+		/*
+		 * block devices are fully provisioned already, but each
+		 * block's bitmap must be zeroed so its sectors read as
+		 * absent.
+		 */
+		char *buf;
+		size_t size = vhd_sectors_to_bytes(bm_secs);
+
+		err = posix_memalign((void **)&buf, VHD_SECTOR_SIZE, size);
+		if (err)
+			return -err;
+
+		memset(buf, 0, size);
+
+		for (i = 0; i < ctx->bat.entries; i++) {
+			err = vhd_seek(ctx,
+				       vhd_sectors_to_bytes(ctx->bat.bat[i]),
+				       SEEK_SET);
+			if (!err)
+				err = vhd_write(ctx, buf, size);
+			if (err)
+				break;
+		}
+
+		free(buf);
+		if (err)
+			return err;
+	} else {
+		/*
+		 * extends the file with zeroes, which doubles as the
+		 * all-clear bitmap of every block.
+		 */
+		err = posix_fallocate(ctx->fd, off,
+				      vhd_sectors_to_bytes(sec) - off);
+		if (err)
+			return -err;
+	}
+
+	return vhd_write_bat(ctx, &ctx->bat);
+}
+
 static int
 vhd_initialize_fixed_disk(vhd_context_t *ctx)
 {
@@ -2904,6 +3091,13 @@ __vhd_create(const char *name, const char *parent, uint64_t bytes, int type,
 		if (err)
 			goto out;
 
+		if (type == HD_TYPE_DYNAMIC &&
+		    vhd_flag_test(flags, VHD_FLAG_CREAT_PREALLOCATE)) {
+			err = vhd_initialize_preallocated_blocks(&ctx);
+			if (err)
+				goto out;
+		}
+
 		if (type == HD_TYPE_DIFF) {
 			err = vhd_write_parent_locators(&ctx, parent);
 			if (err)
@@ -49,7 +49,7 @@ vhd_util_create(int argc, char **argv)
 		goto usage;
 
 	optind = 0;
-	while ((c = getopt(argc, argv, "n:s:rh")) != -1) {
+	while ((c = getopt(argc, argv, "n:s:rph")) != -1) {
 		switch (c) {
 		case 'n':
 			name = optarg;
@@ -61,6 +61,9 @@ vhd_util_create(int argc, char **argv)
 		case 'r':
 			sparse = 0;
 			break;
+		case 'p':
+			vhd_flag_set(flags, VHD_FLAG_CREAT_PREALLOCATE);
+			break;
 		case 'h':
 		default:
 			goto usage;
@@ -70,11 +73,16 @@ vhd_util_create(int argc, char **argv)
 	if (err || !name || optind != argc)
 		goto usage;
 
+	/* preallocation only applies to sparse disks */
+	if (!sparse && vhd_flag_test(flags, VHD_FLAG_CREAT_PREALLOCATE))
+		goto usage;
+
 	return vhd_create(name, size << 20,
 				  (sparse ? HD_TYPE_DYNAMIC : HD_TYPE_FIXED),
 				  flags);
 
 usage:
-	printf("options: <-n name> <-s size (MB)> [-r reserve] [-h help]\n");
+	printf("options: <-n name> <-s size (MB)> [-r reserve] "
+	       "[-p preallocate blocks] [-h help]\n");
 	return -EINVAL;
 }
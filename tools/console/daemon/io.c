@@ -60,6 +60,9 @@
 #define RATE_LIMIT_ALLOWANCE 30
 /* Duration of each time period in ms */
 #define RATE_LIMIT_PERIOD 200
+/* Number of bytes a guest may log per time period; the event allowance
+ * alone does not bound throughput, as one event can carry a full ring */
+#define RATE_LIMIT_BYTES 16384
 
 extern int log_reload;
 extern int log_guest;
@@ -103,6 +106,8 @@ struct console {
 	xenevtchn_handle *xce_handle;
 	int xce_pollfd_idx;
 	int event_count;
+	unsigned int byte_count;
+	bool notify_pending;
 	long long next_period;
 	xenevtchn_port_or_error_t local_port;
 	xenevtchn_port_or_error_t remote_port;
@@ -298,6 +303,12 @@ static int write_with_timestamp(int fd, const char *data, size_t sz,
 	return 0;
 }
 
+static inline bool console_rate_limited(struct console *con)
+{
+	return con->event_count >= RATE_LIMIT_ALLOWANCE ||
+	       con->byte_count >= RATE_LIMIT_BYTES;
+}
+
 static inline bool buffer_available(struct console *con)
 {
 	if (discard_overflowed_data ||
@@ -338,7 +349,9 @@ static void buffer_append(struct console *con)
 
 	xen_mb();
 	intf->out_cons = cons;
-	xenevtchn_notify(con->xce_handle, con->local_port);
+	con->byte_count += size;
+	/* Notified once per iteration, after all draining is done. */
+	con->notify_pending = true;
 
 	/* Get the data to the logfile as early as possible because if
 	 * no one is listening on the console pty then it will fill up
@@ -1085,9 +1098,10 @@ static void console_evtchn_unmask(struct console *con, void *data)
 	 * patch if necessary */
 	if ((now+5) > con->next_period) {
 		con->next_period = now + RATE_LIMIT_PERIOD;
-		if (con->event_count >= RATE_LIMIT_ALLOWANCE)
+		if (console_rate_limited(con))
 			(void)xenevtchn_unmask(con->xce_handle, con->local_port);
 		con->event_count = 0;
+		con->byte_count = 0;
 	}
 }
 
@@ -1112,13 +1126,13 @@ static void handle_ring_read(struct console *con)
 
 	buffer_append(con);
 
-	if (con->event_count < RATE_LIMIT_ALLOWANCE)
+	if (!console_rate_limited(con))
 		(void)xenevtchn_unmask(con->xce_handle, port);
 }
 
 static void handle_console_ring(struct console *con)
 {
-	if (con->event_count < RATE_LIMIT_ALLOWANCE) {
+	if (!console_rate_limited(con)) {
 		if (con->xce_handle != NULL &&
 		    con->xce_pollfd_idx != -1 &&
 		    !(fds[con->xce_pollfd_idx].revents &
@@ -1129,6 +1143,12 @@ static void handle_console_ring(struct console *con)
 	}
 
 	con->xce_pollfd_idx = -1;
+
+	/* Issue the producer notification once per drained iteration. */
+	if (con->notify_pending) {
+		con->notify_pending = false;
+		xenevtchn_notify(con->xce_handle, con->local_port);
+	}
 }
 
 static void handle_xs(void)
@@ -1260,7 +1280,7 @@ static void maybe_add_console_evtchn_fd(struct console *con, void *data)
 {
 	long long next_timeout = *((long long *)data);
 
-	if (con->event_count >= RATE_LIMIT_ALLOWANCE) {
+	if (console_rate_limited(con)) {
 		/* Determine if we're going to be the next time slice to expire */
 		if (!next_timeout ||
 		    con->next_period < next_timeout)
@@ -27,6 +27,7 @@
 #include <stdint.h>
 #include <xen/xen.h>
 #include <xen/memory.h>
+#include <xen/arch-x86/hvm/start_info.h>
 #include <xen/sched.h>
 #include <xen/hvm/hvm_xs_strings.h>
 #include <xen/hvm/params.h>
@@ -893,10 +894,33 @@ void hvmloader_acpi_build_tables(struct acpi_config *config,
 {
     const char *s;
     struct acpi_ctxt ctxt;
+    const struct hvm_modlist_entry *mod;
 
     /* Allocate and initialise the acpi info area. */
     mem_hole_populate_ram(ACPI_INFO_PHYSICAL_ADDRESS >> PAGE_SHIFT, 1);
 
+    /*
+     * If the toolstack built the ACPI tables host-side and handed them in
+     * as an "acpi" module, they are already sitting at their final
+     * guest-physical addresses (modules are loaded in place by the domain
+     * builder) with the RSDP at the start of the module.  Installing them
+     * is then just a matter of copying the RSDP to where this BIOS
+     * expects it, skipping in-guest table construction entirely.
+     */
+    mod = get_module_entry(hvm_start_info, "acpi");
+    if ( mod && mod->size >= sizeof(struct acpi_20_rsdp) )
+    {
+        const struct acpi_20_rsdp *rsdp = (void *)(uint32_t)mod->paddr;
+
+        if ( rsdp->signature == ACPI_2_0_RSDP_SIGNATURE )
+        {
+            printf("Installing prebuilt ACPI tables from module\n");
+            memcpy((void *)physical, rsdp, sizeof(*rsdp));
+            return;
+        }
+        printf("Ignoring \"acpi\" module lacking an RSDP signature\n");
+    }
+
     /* If the device model is specified switch to the corresponding tables */
     s = xenstore_read("platform/device-model", "");
     if ( !strncmp(s, "qemu_xen_traditional", 21) )
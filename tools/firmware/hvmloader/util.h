@@ -164,6 +164,10 @@ struct hvm_info_table *get_hvm_info_table(void) __attribute__ ((const));
 /* HVM start info */
 extern const struct hvm_start_info *hvm_start_info;
 
+struct hvm_modlist_entry;
+const struct hvm_modlist_entry *get_module_entry(
+    const struct hvm_start_info *info, const char *name);
+
 /* String and memory functions */
 int strcmp(const char *cs, const char *ct);
 int strncmp(const char *s1, const char *s2, uint32_t n);
@@ -88,6 +88,26 @@ int xendevicemodel_map_io_range_to_ioreq_server(
     xendevicemodel_handle *dmod, domid_t domid, ioservid_t id, int is_mmio,
     uint64_t start, uint64_t end);
 
+/**
+ * This function registers a range of memory or I/O ports for emulation
+ * with writes posted over the buffered ioreq ring.
+ *
+ * Writes to the range complete without waiting for the emulator, so the
+ * IOREQ Server must handle buffered ioreqs and the emulator must support
+ * the addr_ext buf_ioreq encoding. Reads still use the synchronous path.
+ *
+ * @parm dmod a handle to an open devicemodel interface.
+ * @parm domid the domain id to be serviced
+ * @parm id the IOREQ Server id.
+ * @parm is_mmio is this a range of ports or memory
+ * @parm start start of range
+ * @parm end end of range (inclusive).
+ * @return 0 on success, -1 on failure.
+ */
+int xendevicemodel_map_posted_io_range_to_ioreq_server(
+    xendevicemodel_handle *dmod, domid_t domid, ioservid_t id, int is_mmio,
+    uint64_t start, uint64_t end);
+
 /**
  * This function deregisters a range of memory or I/O ports for emulation.
  *
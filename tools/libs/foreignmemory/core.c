@@ -125,6 +125,50 @@ void *xenforeignmemory_map(xenforeignmemory_handle *fmem,
     return xenforeignmemory_map2(fmem, dom, NULL, prot, 0, num, arr, err);
 }
 
+void *xenforeignmemory_map_aligned(xenforeignmemory_handle *fmem,
+                                   uint32_t dom, int prot, size_t num,
+                                   const xen_pfn_t arr[/*num*/],
+                                   int err[/*num*/], size_t alignment)
+{
+    size_t size = num << PAGE_SHIFT;
+    unsigned char *window, *addr;
+    size_t front;
+    void *ret;
+
+    if ( !alignment || (alignment & (alignment - 1)) ||
+         alignment < PAGE_SIZE )
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    /*
+     * Reserve an oversized window, trim it down to the aligned portion,
+     * and map the foreign pages over that with MAP_FIXED.  The kernel is
+     * then free to use huge pages for its tracking structures where the
+     * underlying mapping allows it.
+     */
+    window = mmap(NULL, size + alignment, PROT_NONE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if ( window == MAP_FAILED )
+        return NULL;
+
+    addr = (unsigned char *)(((uintptr_t)window + alignment - 1) &
+                             ~((uintptr_t)alignment - 1));
+    front = addr - window;
+    if ( front )
+        munmap(window, front);
+    if ( alignment - front )
+        munmap(addr + size, alignment - front);
+
+    ret = xenforeignmemory_map2(fmem, dom, addr, prot, MAP_FIXED, num, arr,
+                                err);
+    if ( !ret )
+        munmap(addr, size);
+
+    return ret;
+}
+
 int xenforeignmemory_unmap(xenforeignmemory_handle *fmem,
                            void *addr, size_t num)
 {
@@ -119,6 +119,19 @@ void *xenforeignmemory_map2(xenforeignmemory_handle *fmem, uint32_t dom,
                             void *addr, int prot, int flags, size_t pages,
                             const xen_pfn_t arr[/*pages*/], int err[/*pages*/]);
 
+/*
+ * Like xenforeignmemory_map() but the local mapping is placed at an
+ * address aligned to @alignment bytes, which must be a power of two of
+ * at least the page size.  This allows callers mapping large windows to
+ * benefit from huge page backing of the mapping in the local kernel.
+ *
+ * Mappings must be unmapped with xenforeignmemory_unmap().
+ */
+void *xenforeignmemory_map_aligned(xenforeignmemory_handle *fmem,
+                                   uint32_t dom, int prot, size_t pages,
+                                   const xen_pfn_t arr[/*pages*/],
+                                   int err[/*pages*/], size_t alignment);
+
 /*
  * Unmap a mapping previous created with xenforeignmemory_map().
  *
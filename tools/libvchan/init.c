@@ -62,8 +62,10 @@
 #define MAX_LARGE_RING (1 << LARGE_RING_SHIFT)
 #define LARGE_RING_OFFSET 2048
 
-// if you go over this size, you'll have too many grants to fit in the shared page.
-#define MAX_RING_SHIFT 20
+// An order-22 (4MB) ring would need 1024 grant references, more than fit
+// in the shared page even on its own; 21 is the largest order whose grant
+// list can fit, and the combined fit of both rings is checked at setup.
+#define MAX_RING_SHIFT 21
 #define MAX_RING_SIZE (1 << MAX_RING_SHIFT)
 
 #ifndef offsetof
@@ -72,6 +74,22 @@
 
 #define max(a,b) ((a > b) ? a : b)
 
+// The grant references for the data rings share the control page with the
+// header and any in-page ring, so the space available for them depends on
+// the layout: they must end below the lowest in-page ring in use, and may
+// use the rest of the page when both rings are external.
+static int max_grants(int left_order, int right_order)
+{
+	int limit = PAGE_SIZE;
+
+	if (left_order == SMALL_RING_SHIFT || right_order == SMALL_RING_SHIFT)
+		limit = SMALL_RING_OFFSET;
+	else if (left_order == LARGE_RING_SHIFT || right_order == LARGE_RING_SHIFT)
+		limit = LARGE_RING_OFFSET;
+
+	return (limit - sizeof(struct vchan_interface)) / sizeof(uint32_t);
+}
+
 static int init_gnt_srv(struct libxenvchan *ctrl, int domain)
 {
 	int pages_left = ctrl->read.order >= PAGE_SHIFT ? 1 << (ctrl->read.order - PAGE_SHIFT) : 0;
@@ -79,6 +97,10 @@ static int init_gnt_srv(struct libxenvchan *ctrl, int domain)
 	uint32_t ring_ref = -1;
 	void *ring;
 
+	if (pages_left + pages_right >
+	    max_grants(ctrl->read.order, ctrl->write.order))
+		return -1;
+
 	ring = xengntshr_share_page_notify(ctrl->gntshr, domain,
 			&ring_ref, 1, offsetof(struct vchan_interface, srv_live),
 			ctrl->event_port);
@@ -160,6 +182,12 @@ static int init_gnt_cli(struct libxenvchan *ctrl, int domain, uint32_t ring_ref)
 		goto out_unmap_ring;
 	if (ctrl->read.order == ctrl->write.order && ctrl->read.order < PAGE_SHIFT)
 		goto out_unmap_ring;
+	if ((ctrl->write.order >= PAGE_SHIFT ?
+	     1 << (ctrl->write.order - PAGE_SHIFT) : 0) +
+	    (ctrl->read.order >= PAGE_SHIFT ?
+	     1 << (ctrl->read.order - PAGE_SHIFT) : 0) >
+	    max_grants(ctrl->write.order, ctrl->read.order))
+		goto out_unmap_ring;
 
 	grants = ctrl->ring->grants;
 
@@ -323,6 +351,7 @@ struct libxenvchan *libxenvchan_server_init(struct xentoollog_logger *logger,
 	ctrl->event = NULL;
 	ctrl->is_server = 1;
 	ctrl->server_persist = 0;
+	ctrl->busy_poll_iters = 0;
 
 	ctrl->read.order = min_order(left_min);
 	ctrl->write.order = min_order(right_min);
@@ -407,6 +436,7 @@ struct libxenvchan *libxenvchan_client_init(struct xentoollog_logger *logger,
 	ctrl->gnttab = NULL;
 	ctrl->write.order = ctrl->read.order = 0;
 	ctrl->is_server = 0;
+	ctrl->busy_poll_iters = 0;
 
 	xs = xs_daemon_open();
 	if (!xs)
@@ -143,6 +143,25 @@ static inline int fast_get_data_ready(struct libxenvchan *ctrl, size_t request)
 	return raw_get_data_ready(ctrl);
 }
 
+/**
+ * Busy-poll for incoming data before falling back to the notification
+ * path.  Spins on the raw indexes without posting a notify request, so
+ * a streaming sender is not forced into event channel round trips while
+ * the receiver is actively polling.
+ */
+static inline int busy_poll_data_ready(struct libxenvchan *ctrl, size_t request)
+{
+	unsigned i;
+	int avail = 0;
+
+	for (i = 0; i < ctrl->busy_poll_iters; i++) {
+		avail = raw_get_data_ready(ctrl);
+		if (avail >= request || !libxenvchan_is_open(ctrl))
+			break;
+	}
+	return avail;
+}
+
 int libxenvchan_data_ready(struct libxenvchan *ctrl)
 {
 	/* Since this value is being used outside libxenvchan, request notification
@@ -311,7 +330,14 @@ static int do_recv(struct libxenvchan *ctrl, void *data, size_t size)
 int libxenvchan_recv(struct libxenvchan *ctrl, void *data, size_t size)
 {
 	while (1) {
-		int avail = fast_get_data_ready(ctrl, size);
+		int avail;
+
+		if (ctrl->busy_poll_iters) {
+			avail = busy_poll_data_ready(ctrl, size);
+			if (size <= avail)
+				return do_recv(ctrl, data, size);
+		}
+		avail = fast_get_data_ready(ctrl, size);
 		if (size <= avail)
 			return do_recv(ctrl, data, size);
 		if (!libxenvchan_is_open(ctrl))
@@ -328,7 +354,17 @@ int libxenvchan_recv(struct libxenvchan *ctrl, void *data, size_t size)
 int libxenvchan_read(struct libxenvchan *ctrl, void *data, size_t size)
 {
 	while (1) {
-		int avail = fast_get_data_ready(ctrl, size);
+		int avail;
+
+		if (ctrl->busy_poll_iters) {
+			avail = busy_poll_data_ready(ctrl, 1);
+			if (avail) {
+				if (size > avail)
+					size = avail;
+				return do_recv(ctrl, data, size);
+			}
+		}
+		avail = fast_get_data_ready(ctrl, size);
 		if (avail && size > avail)
 			size = avail;
 		if (avail)
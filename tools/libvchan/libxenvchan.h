@@ -86,6 +86,11 @@ struct libxenvchan {
 	int blocking:1;
 	/* communication rings */
 	struct libxenvchan_ring read, write;
+	/* number of times the receive path re-checks the ring before
+	 * falling back to blocking on the event channel; while spinning no
+	 * notify request is posted, so the sender streams without event
+	 * channel round trips.  0 (the default) disables busy-polling. */
+	unsigned busy_poll_iters;
 };
 
 /**
@@ -810,6 +810,36 @@ int xc_domain_getinfolist(xc_interface *xch,
                           unsigned int max_domains,
                           xc_domaininfo_t *info);
 
+typedef xen_sysctl_vcpu_snapshot_t xc_vcpu_snapshot_t;
+
+/**
+ * This function takes a composite snapshot of one or more domains together
+ * with the runstates of all their vcpus, using a single hypercall.  It is
+ * intended for periodic fleet monitoring (xenstat/xentop style), replacing
+ * one XEN_DOMCTL_getvcpuinfo call per vcpu.
+ *
+ * @parm xch a handle to an open hypervisor interface
+ * @parm first_domain the first domain to enumerate information from
+ * @parm max_domains the number of elements in domains
+ * @parm domains an array receiving the per-domain information
+ * @parm max_vcpus the number of elements in vcpus
+ * @parm vcpus an array receiving the per-vcpu runstate records
+ * @parm num_domains set to the number of domain entries filled
+ * @parm num_vcpus set to the number of vcpu entries filled
+ * @parm generation if non-NULL, set to the domain list generation; it
+ *                  changes whenever a domain is created or destroyed
+ * @return 0 on success, -1 on error
+ */
+int xc_domain_snapshot(xc_interface *xch,
+                       uint32_t first_domain,
+                       unsigned int max_domains,
+                       xc_domaininfo_t *domains,
+                       unsigned int max_vcpus,
+                       xc_vcpu_snapshot_t *vcpus,
+                       unsigned int *num_domains,
+                       unsigned int *num_vcpus,
+                       uint64_t *generation);
+
 /**
  * This function set p2m for broken page
  * &parm xch a handle to an open hypervisor interface
@@ -894,6 +924,63 @@ int xc_vcpu_getcontext(xc_interface *xch,
                        uint32_t vcpu,
                        vcpu_guest_context_any_t *ctxt);
 
+/**
+ * This function returns the execution contexts of a range of vcpus of a
+ * domain in one hypercall, pausing the domain only once so the contexts
+ * are mutually consistent.
+ *
+ * @parm xch a handle to an open hypervisor interface
+ * @parm domid the domain to get information from
+ * @parm first_vcpu the first vcpu number of the range
+ * @parm nr_vcpus in: the size of the ctxts array; out: the number of
+ *                slots covered by this call (further calls are needed
+ *                for domains with more than 64 vcpus)
+ * @parm valid bitmap of slots actually written; bits for offline or
+ *             uninitialised vcpus are clear
+ * @parm ctxts an array of at least *nr_vcpus context structures
+ * @return 0 on success, -1 on failure
+ */
+int xc_domain_get_vcpu_contexts(xc_interface *xch,
+                                uint32_t domid,
+                                uint32_t first_vcpu,
+                                uint32_t *nr_vcpus,
+                                uint64_t *valid,
+                                vcpu_guest_context_any_t *ctxts);
+
+/*
+ * Get a domain's aggregate vCPU runstate times (ns), for cheap polled
+ * CPU accounting.
+ */
+typedef struct xen_domctl_runstate_times xc_runstate_times_t;
+int xc_domain_get_runstate_times(xc_interface *xch, uint32_t domid,
+                                 xc_runstate_times_t *times);
+
+/*
+ * Enable/disable the background promotion of contiguous 4k p2m mappings
+ * back into 2M superpages for a HAP domain.
+ */
+int xc_domain_set_superpage_promotion(xc_interface *xch, uint32_t domid,
+                                      bool enable);
+
+/*
+ * Advise the idle governor of the worst wakeup latency (in microseconds)
+ * the domain can tolerate; 0 removes the hint.
+ */
+int xc_domain_set_wakeup_latency(xc_interface *xch, uint32_t domid,
+                                 uint32_t latency_us);
+
+/*
+ * Switch FIFO event channel wake-latency accounting on or off, and read
+ * back the per-priority histograms: on entry *nr_counts is the size of
+ * the counts array in uint64 slots, on exit the number available
+ * ([priority][bucket] row-major; bucket i counts latencies below 2^i us).
+ */
+int xc_domain_evtchn_fifo_latency(xc_interface *xch, uint32_t domid,
+                                  bool enable);
+int xc_domain_evtchn_fifo_latency_read(xc_interface *xch, uint32_t domid,
+                                       uint64_t *counts,
+                                       uint32_t *nr_counts);
+
 /**
  * This function initializes the vuart emulation and returns
  * the event to be used by the backend for communicating with
@@ -1475,6 +1562,7 @@ int xc_perfc_query(xc_interface *xch,
 
 typedef xen_sysctl_lockprof_data_t xc_lockprof_data_t;
 int xc_lockprof_reset(xc_interface *xch);
+int xc_lockprof_control(xc_interface *xch, bool enable);
 int xc_lockprof_query_number(xc_interface *xch,
                              uint32_t *n_elems);
 int xc_lockprof_query(xc_interface *xch,
@@ -1482,6 +1570,76 @@ int xc_lockprof_query(xc_interface *xch,
                       uint64_t *time,
                       xc_hypercall_buffer_t *data);
 
+typedef xen_sysctl_hypercall_prof_data_t xc_hypercall_prof_data_t;
+int xc_hypercall_prof_reset(xc_interface *xch, uint32_t domid);
+int xc_hypercall_prof_query(xc_interface *xch,
+                            uint32_t domid,
+                            uint32_t *n_elems,
+                            xc_hypercall_buffer_t *data);
+
+/* Per-domain event counters (XEN_DOMPERF_*); counting is a global switch. */
+int xc_domperf_enable(xc_interface *xch, int enable);
+int xc_domperf_query(xc_interface *xch,
+                     uint32_t domid,
+                     uint32_t *n_elems,
+                     xc_hypercall_buffer_t *data);
+
+/*
+ * Hypervisor heap profile: xmalloc allocation-site counters plus per-domain
+ * heap page counts.  On entry *nr_sites and *nr_doms hold the capacities
+ * of sites[] and doms[]; on success they hold the entries filled.
+ */
+typedef xen_memprof_site_t xc_memprof_site_t;
+typedef xen_memprof_dom_t xc_memprof_dom_t;
+int xc_memprof_query(xc_interface *xch,
+                     xc_hypercall_buffer_t *sites, uint32_t *nr_sites,
+                     xc_hypercall_buffer_t *doms, uint32_t *nr_doms,
+                     uint64_t *pool_used, uint64_t *pool_size);
+
+/*
+ * Read one CPU's binary diagnostics log ring.  On entry *nr_recs holds
+ * the capacity of recs[]; on success it holds the records returned,
+ * oldest first, and *prod the total ever written on that CPU.
+ */
+typedef xen_dlog_rec_t xc_dlog_rec_t;
+int xc_dlog_read(xc_interface *xch, uint32_t cpu,
+                 xc_hypercall_buffer_t *recs, uint32_t *nr_recs,
+                 uint64_t *prod);
+
+/* NMI-driven IP sampling; samples arrive as TRC_SAMPLE trace records. */
+int xc_sampler_enable(xc_interface *xch, int enable, uint32_t rate);
+int xc_sampler_query(xc_interface *xch, uint32_t *enabled,
+                     uint64_t *nr_samples, uint64_t *nr_dropped);
+
+/*
+ * Per-IRQ rate and CPU time figures for guest-bound interrupts.  On entry
+ * *nr holds the capacity of stats[]; on success it holds the number of
+ * entries filled.
+ */
+int xc_irq_stats(xc_interface *xch, struct xen_sysctl_irq_stat *stats,
+                 uint32_t *nr);
+
+/*
+ * Hypervisor-maintained statistics area (xen_statspage_header layout).
+ * After enabling, map the nr_pages starting at mfn with DOMID_XEN to
+ * sample per-domain stats without further hypercalls.
+ */
+int xc_statspage_enable(xc_interface *xch, uint32_t capacity,
+                        uint32_t period_ms);
+int xc_statspage_disable(xc_interface *xch);
+int xc_statspage_get_info(xc_interface *xch, uint64_t *mfn,
+                          uint32_t *nr_pages);
+
+/*
+ * Shared host time page (xen_timepage layout): TSC-to-system-time
+ * parameters maintained by the hypervisor, for converting raw TSC
+ * values (e.g. trace record cycle stamps) without hypercalls.
+ * xc_timepage_map() returns a read-only mapping of one page; unmap
+ * with munmap() when done.
+ */
+int xc_timepage_info(xc_interface *xch, uint64_t *mfn);
+void *xc_timepage_map(xc_interface *xch);
+
 void *xc_memalign(xc_interface *xch, size_t alignment, size_t size);
 
 /**
@@ -1586,6 +1744,15 @@ int xc_tbuf_set_cpu_mask(xc_interface *xch, xc_cpumap_t mask);
 
 int xc_tbuf_set_evt_mask(xc_interface *xch, uint32_t mask);
 
+/*
+ * Set the mask of low-priority events to shed once a trace buffer fills
+ * beyond the mute water mark.  A mask of zero disables shedding.
+ */
+int xc_tbuf_set_mute_mask(xc_interface *xch, uint32_t mask);
+
+/* Retrieve cumulative lost/muted record counts, summed over all CPUs. */
+int xc_tbuf_get_drops(xc_interface *xch, uint64_t *lost, uint64_t *muted);
+
 int xc_domctl(xc_interface *xch, struct xen_domctl *domctl);
 int xc_sysctl(xc_interface *xch, struct xen_sysctl *sysctl);
 
@@ -1617,6 +1784,8 @@ int xc_gnttab_op(xc_interface *xch, int cmd,
 
 int xc_gnttab_query_size(xc_interface *xch, struct gnttab_query_size *query);
 int xc_gnttab_get_version(xc_interface *xch, uint32_t domid); /* Never logs */
+/* Grow a domain's grant table to (at least) nr_frames frames. */
+int xc_gnttab_pregrow(xc_interface *xch, uint32_t domid, uint32_t nr_frames);
 grant_entry_v1_t *xc_gnttab_map_table_v1(xc_interface *xch, uint32_t domid, int *gnt_num);
 grant_entry_v2_t *xc_gnttab_map_table_v2(xc_interface *xch, uint32_t domid, int *gnt_num);
 /* Sometimes these don't set errno [fixme], and sometimes they don't log. */
@@ -1852,6 +2021,13 @@ int xc_pm_get_max_cx(xc_interface *xch, int cpuid, int *max_cx);
 int xc_pm_get_cxstat(xc_interface *xch, int cpuid, struct xc_cx_stat *cxpt);
 int xc_pm_reset_cxstat(xc_interface *xch, int cpuid);
 
+/* Bulk Cx/Px residency digest; recs[] is indexed by CPU number. */
+int xc_pm_get_summary(xc_interface *xch, struct pm_telemetry_rec *recs,
+                      int *nr);
+int xc_pm_telemetry_enable(xc_interface *xch, uint32_t period_ms,
+                           uint64_t *mfn, uint32_t *nr_pages);
+int xc_pm_telemetry_disable(xc_interface *xch);
+
 int xc_cpu_online(xc_interface *xch, int cpu);
 int xc_cpu_offline(xc_interface *xch, int cpu);
 
@@ -1907,6 +2083,10 @@ int xc_set_cpuidle_max_cstate(xc_interface *xch, uint32_t value);
 
 int xc_enable_turbo(xc_interface *xch, int cpuid);
 int xc_disable_turbo(xc_interface *xch, int cpuid);
+
+int xc_set_hwp_epp(xc_interface *xch, int cpuid, uint32_t epp);
+
+int xc_set_cpu_max_cstate(xc_interface *xch, int cpuid, uint32_t value);
 /**
  * tmem operations
  */
@@ -2014,6 +2194,13 @@ int xc_get_mem_access(xc_interface *xch, uint32_t domain_id,
  * Caller has to unmap this page when done.
  */
 void *xc_monitor_enable(xc_interface *xch, uint32_t domain_id, uint32_t *port);
+/*
+ * Like xc_monitor_enable(), but with a ring of 1 << ring_order pages.
+ * Larger rings avoid stalling vCPUs of many-vCPU guests on a full ring.
+ * Caller has to unmap all of the returned pages when done.
+ */
+void *xc_monitor_enable_ex(xc_interface *xch, uint32_t domain_id,
+                           uint32_t *port, unsigned int ring_order);
 int xc_monitor_disable(xc_interface *xch, uint32_t domain_id);
 int xc_monitor_resume(xc_interface *xch, uint32_t domain_id);
 /*
@@ -2032,6 +2219,18 @@ int xc_monitor_write_ctrlreg(xc_interface *xch, uint32_t domain_id,
  */
 int xc_monitor_mov_to_msr(xc_interface *xch, uint32_t domain_id, uint32_t msr,
                           bool enable, bool onchangeonly);
+/*
+ * Add/remove a value to/from the allowlist of a monitored control register
+ * or MSR (event is XEN_DOMCTL_MONITOR_EVENT_WRITE_CTRLREG or
+ * XEN_DOMCTL_MONITOR_EVENT_MOV_TO_MSR). Writes of an allowed value are
+ * resolved in the hypervisor without notifying the monitor ring.
+ */
+int xc_monitor_add_allowed_value(xc_interface *xch, uint32_t domain_id,
+                                 uint32_t event, uint32_t index,
+                                 uint64_t value);
+int xc_monitor_remove_allowed_value(xc_interface *xch, uint32_t domain_id,
+                                    uint32_t event, uint32_t index,
+                                    uint64_t value);
 int xc_monitor_singlestep(xc_interface *xch, uint32_t domain_id, bool enable);
 int xc_monitor_software_breakpoint(xc_interface *xch, uint32_t domain_id,
                                    bool enable);
@@ -2234,8 +2433,26 @@ int xc_memshr_range_share(xc_interface *xch,
                           uint64_t first_gfn,
                           uint64_t last_gfn);
 
+/* Populates a range of an empty client physmap with shared mappings of the
+ * source domain's pages, giving copy-on-write clone semantics: the first
+ * write by either domain to a cloned page breaks the sharing and leaves the
+ * writer with a private copy. Client gfns which are not physmap holes, and
+ * source pages which cannot be shared, are skipped and left for the caller
+ * to populate by other means. Both domains must be paused and have memory
+ * sharing enabled.
+ *
+ * May fail with -EINVAL if the range exceeds the source domain's physmap.
+ * May also fail with -ENOMEM if there isn't enough memory available to store
+ * the sharing metadata.
+ */
+int xc_memshr_clone(xc_interface *xch,
+                    uint32_t source_domain,
+                    uint32_t client_domain,
+                    uint64_t first_gfn,
+                    uint64_t last_gfn);
+
 /* Debug calls: return the number of pages referencing the shared frame backing
- * the input argument. Should be one or greater. 
+ * the input argument. Should be one or greater.
  *
  * May fail with EINVAL if there is no backing shared frame for the input
  * argument.
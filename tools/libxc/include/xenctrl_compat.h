@@ -44,6 +44,15 @@ void *xc_map_foreign_pages(xc_interface *xch, uint32_t dom, int prot,
  */
 void *xc_map_foreign_bulk(xc_interface *xch, uint32_t dom, int prot,
                           const xen_pfn_t *arr, int *err, unsigned int num);
+
+/**
+ * Like xc_map_foreign_bulk(), but places the local mapping at an address
+ * aligned to @alignment bytes (a power of two of at least the page size),
+ * allowing the kernel to back large windows with huge pages.
+ */
+void *xc_map_foreign_bulk_aligned(xc_interface *xch, uint32_t dom, int prot,
+                                  const xen_pfn_t *arr, int *err,
+                                  unsigned int num, size_t alignment);
 #endif
 
 #endif
@@ -29,6 +29,7 @@
 #define XCFLAGS_HVM       (1 << 2)
 #define XCFLAGS_STDVGA    (1 << 3)
 #define XCFLAGS_CHECKPOINT_COMPRESS    (1 << 4)
+#define XCFLAGS_COMPRESS  (1 << 5)
 
 #define X86_64_B_SIZE   64 
 #define X86_32_B_SIZE   32
@@ -72,6 +73,12 @@ struct save_callbacks {
 #define XGS_POLICY_CONTINUE_PRECOPY 0  /* Remain in the precopy phase. */
 #define XGS_POLICY_STOP_AND_COPY    1  /* Immediately suspend and transmit the
                                         * remaining dirty pages. */
+#define XGS_POLICY_POSTCOPY         2  /* Suspend the guest and transfer
+                                        * execution to the destination, with
+                                        * remaining pages serviced on demand.
+                                        * Not yet implemented; currently
+                                        * degrades to STOP_AND_COPY with a
+                                        * warning. */
     precopy_policy_t precopy_policy;
 
     /*
@@ -198,16 +198,73 @@ static int xc_try_bzip2_decode(
 
 #include <lzma.h>
 
+/*
+ * The uncompressed size of an xz image is recorded in its index; parsing
+ * that up front lets the output buffer be sized exactly, instead of being
+ * grown by repeated doubling (each of which memcpy()s everything written
+ * so far).  Returns 0 (i.e. "unknown") on any parse problem - the decode
+ * loop copes, exactly as it does for streams with no size information.
+ */
+static size_t xz_stream_output_size(struct xc_dom_image *dom)
+{
+    const unsigned char *in = dom->kernel_blob;
+    size_t insize = dom->kernel_size;
+    lzma_stream_flags footer;
+    lzma_index *idx = NULL;
+    uint64_t memlimit = UINT64_MAX;
+    lzma_vli outsize;
+    size_t in_pos = 0;
+
+    if ( insize < 2 * LZMA_STREAM_HEADER_SIZE )
+        return 0;
+
+    if ( lzma_stream_footer_decode(
+             &footer, in + insize - LZMA_STREAM_HEADER_SIZE) != LZMA_OK )
+        return 0;
+
+    if ( footer.backward_size > insize - 2 * LZMA_STREAM_HEADER_SIZE )
+        return 0;
+
+    if ( lzma_index_buffer_decode(&idx, &memlimit, NULL,
+                                  in + insize - LZMA_STREAM_HEADER_SIZE
+                                  - footer.backward_size,
+                                  &in_pos, footer.backward_size) != LZMA_OK )
+        return 0;
+
+    outsize = lzma_index_uncompressed_size(idx);
+    lzma_index_end(idx, NULL);
+
+    return outsize <= SIZE_MAX ? outsize : 0;
+}
+
+/*
+ * LZMA-alone headers carry the uncompressed size at bytes 5-12;
+ * all-ones means "unknown".
+ */
+static size_t lzma_stream_output_size(struct xc_dom_image *dom)
+{
+    const unsigned char *in = dom->kernel_blob;
+    uint64_t outsize = 0;
+    unsigned int i;
+
+    if ( dom->kernel_size < 13 )
+        return 0;
+
+    for ( i = 0; i < 8; i++ )
+        outsize |= (uint64_t)in[5 + i] << (i * 8);
+
+    return outsize != UINT64_MAX && outsize <= SIZE_MAX ? outsize : 0;
+}
+
 static int _xc_try_lzma_decode(
     struct xc_dom_image *dom, void **blob, size_t *size,
-    lzma_stream *stream, const char *what)
+    lzma_stream *stream, size_t outsize, const char *what)
 {
     lzma_ret ret;
     lzma_action action = LZMA_RUN;
     unsigned char *out_buf;
     unsigned char *tmp_buf;
     int retval = -1;
-    size_t outsize;
     const char *msg;
 
     if ( dom->kernel_size == 0)
@@ -216,11 +273,17 @@ static int _xc_try_lzma_decode(
         return -1;
     }
 
-    /* sigh.  We don't know up-front how much memory we are going to need
-     * for the output buffer.  Allocate the output buffer to be equal
-     * the input buffer to start, and we'll realloc as needed.
+    /* If the image doesn't say how large it inflates to, allocate the
+     * output buffer to be equal the input buffer to start, and realloc
+     * as needed.
      */
-    outsize = dom->kernel_size;
+    if ( outsize == 0 )
+        outsize = dom->kernel_size;
+    else if ( xc_dom_kernel_check_size(dom, outsize) )
+    {
+        DOMPRINTF("%s: output too large", what);
+        goto lzma_cleanup;
+    }
     out_buf = malloc(outsize);
     if ( out_buf == NULL )
     {
@@ -232,7 +295,7 @@ static int _xc_try_lzma_decode(
     stream->avail_in = dom->kernel_size;
 
     stream->next_out = out_buf;
-    stream->avail_out = dom->kernel_size;
+    stream->avail_out = outsize;
 
     for ( ; ; )
     {
@@ -340,14 +403,34 @@ static int xc_try_xz_decode(
     struct xc_dom_image *dom, void **blob, size_t *size)
 {
     lzma_stream stream = LZMA_STREAM_INIT;
+    lzma_ret ret = LZMA_PROG_ERROR;
+
+#if LZMA_VERSION >= 50040002
+    /*
+     * liblzma >= 5.4 can decode the blocks of a multi-block stream (as
+     * produced by "xz -T") in parallel.  Single-block images are decoded
+     * on one thread inside liblzma, exactly as before.
+     */
+    long nr_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    lzma_mt mt = {
+        .threads = nr_threads > 1 ? nr_threads : 1,
+        .memlimit_threading = LZMA_BLOCK_SIZE,
+        .memlimit_stop = LZMA_BLOCK_SIZE,
+    };
+
+    ret = lzma_stream_decoder_mt(&stream, &mt);
+    if ( ret != LZMA_OK )
+#endif
+        ret = lzma_stream_decoder(&stream, LZMA_BLOCK_SIZE, 0);
 
-    if ( lzma_stream_decoder(&stream, LZMA_BLOCK_SIZE, 0) != LZMA_OK )
+    if ( ret != LZMA_OK )
     {
         DOMPRINTF("XZ: Failed to init decoder");
         return -1;
     }
 
-    return _xc_try_lzma_decode(dom, blob, size, &stream, "XZ");
+    return _xc_try_lzma_decode(dom, blob, size, &stream,
+                               xz_stream_output_size(dom), "XZ");
 }
 
 static int xc_try_lzma_decode(
@@ -361,7 +444,8 @@ static int xc_try_lzma_decode(
         return -1;
     }
 
-    return _xc_try_lzma_decode(dom, blob, size, &stream, "LZMA");
+    return _xc_try_lzma_decode(dom, blob, size, &stream,
+                               lzma_stream_output_size(dom), "LZMA");
 }
 
 #else /* !defined(HAVE_LZMA) */
@@ -27,6 +27,8 @@
 #include <string.h>
 #include <inttypes.h>
 #include <assert.h>
+#include <pthread.h>
+#include <unistd.h>
 
 #include <xen/xen.h>
 #include <xen/foreign/x86_32.h>
@@ -1311,12 +1313,173 @@ static int check_mmio_hole(uint64_t start, uint64_t memsize,
         return 1;
 }
 
+/*
+ * Populate [cur_pages, end_pages) of an HVM guest, attempting 1GB and 2MB
+ * extents before falling back to 4kB pages, skipping any MMIO hole.  Safe
+ * to run concurrently for disjoint ranges of the same domain, provided
+ * each caller drives its own @xch.
+ */
+static int populate_hvm_range(xc_interface *xch, struct xc_dom_image *dom,
+                              unsigned int memflags, unsigned long cur_pages,
+                              unsigned long end_pages,
+                              unsigned long *stat_normal_pages,
+                              unsigned long *stat_2mb_pages,
+                              unsigned long *stat_1gb_pages)
+{
+    uint32_t domid = dom->guest_domid;
+    unsigned long i, cur_pfn;
+    int rc = 0;
+
+    while ( (rc == 0) && (end_pages > cur_pages) )
+    {
+        /* Clip count to maximum 1GB extent. */
+        unsigned long count = end_pages - cur_pages;
+        unsigned long max_pages = SUPERPAGE_1GB_NR_PFNS;
+
+        if ( count > max_pages )
+            count = max_pages;
+
+        cur_pfn = dom->p2m_host[cur_pages];
+
+        /* Take care the corner cases of super page tails */
+        if ( ((cur_pfn & (SUPERPAGE_1GB_NR_PFNS-1)) != 0) &&
+             (count > (-cur_pfn & (SUPERPAGE_1GB_NR_PFNS-1))) )
+            count = -cur_pfn & (SUPERPAGE_1GB_NR_PFNS-1);
+        else if ( ((count & (SUPERPAGE_1GB_NR_PFNS-1)) != 0) &&
+                  (count > SUPERPAGE_1GB_NR_PFNS) )
+            count &= ~(SUPERPAGE_1GB_NR_PFNS - 1);
+
+        /* Attemp to allocate 1GB super page. Because in each pass
+         * we only allocate at most 1GB, we don't have to clip
+         * super page boundaries.
+         */
+        if ( ((count | cur_pfn) & (SUPERPAGE_1GB_NR_PFNS - 1)) == 0 &&
+             /* Check if there exists MMIO hole in the 1GB memory
+              * range */
+             !check_mmio_hole(cur_pfn << PAGE_SHIFT,
+                              SUPERPAGE_1GB_NR_PFNS << PAGE_SHIFT,
+                              dom->mmio_start, dom->mmio_size) )
+        {
+            long done;
+            unsigned long nr_extents = count >> SUPERPAGE_1GB_SHIFT;
+            xen_pfn_t sp_extents[nr_extents];
+
+            for ( i = 0; i < nr_extents; i++ )
+                sp_extents[i] =
+                    dom->p2m_host[cur_pages+(i<<SUPERPAGE_1GB_SHIFT)];
+
+            done = xc_domain_populate_physmap(xch, domid, nr_extents,
+                                              SUPERPAGE_1GB_SHIFT,
+                                              memflags, sp_extents);
+
+            if ( done > 0 )
+            {
+                *stat_1gb_pages += done;
+                done <<= SUPERPAGE_1GB_SHIFT;
+                cur_pages += done;
+                count -= done;
+            }
+        }
+
+        if ( count != 0 )
+        {
+            /* Clip count to maximum 8MB extent. */
+            max_pages = SUPERPAGE_2MB_NR_PFNS * 4;
+            if ( count > max_pages )
+                count = max_pages;
+
+            /* Clip partial superpage extents to superpage
+             * boundaries. */
+            if ( ((cur_pfn & (SUPERPAGE_2MB_NR_PFNS-1)) != 0) &&
+                 (count > (-cur_pfn & (SUPERPAGE_2MB_NR_PFNS-1))) )
+                count = -cur_pfn & (SUPERPAGE_2MB_NR_PFNS-1);
+            else if ( ((count & (SUPERPAGE_2MB_NR_PFNS-1)) != 0) &&
+                      (count > SUPERPAGE_2MB_NR_PFNS) )
+                count &= ~(SUPERPAGE_2MB_NR_PFNS - 1); /* clip non-s.p. tail */
+
+            /* Attempt to allocate superpage extents. */
+            if ( ((count | cur_pfn) & (SUPERPAGE_2MB_NR_PFNS - 1)) == 0 )
+            {
+                long done;
+                unsigned long nr_extents = count >> SUPERPAGE_2MB_SHIFT;
+                xen_pfn_t sp_extents[nr_extents];
+
+                for ( i = 0; i < nr_extents; i++ )
+                    sp_extents[i] =
+                        dom->p2m_host[cur_pages+(i<<SUPERPAGE_2MB_SHIFT)];
+
+                done = xc_domain_populate_physmap(xch, domid, nr_extents,
+                                                  SUPERPAGE_2MB_SHIFT,
+                                                  memflags, sp_extents);
+
+                if ( done > 0 )
+                {
+                    *stat_2mb_pages += done;
+                    done <<= SUPERPAGE_2MB_SHIFT;
+                    cur_pages += done;
+                    count -= done;
+                }
+            }
+        }
+
+        /* Fall back to 4kB extents. */
+        if ( count != 0 )
+        {
+            rc = xc_domain_populate_physmap_exact(
+                xch, domid, count, 0, memflags, &dom->p2m_host[cur_pages]);
+            cur_pages += count;
+            *stat_normal_pages += count;
+        }
+    }
+
+    return rc;
+}
+
+/* Parallel population of a large range, in 1GB-aligned shards. */
+#define POPULATE_MAX_WORKERS    4
+#define POPULATE_MIN_WORKER_PFNS SUPERPAGE_1GB_NR_PFNS
+
+struct populate_worker {
+    pthread_t thread;
+    struct xc_dom_image *dom;
+    unsigned int memflags;
+    unsigned long cur_pages, end_pages;
+    unsigned long stat_normal_pages, stat_2mb_pages, stat_1gb_pages;
+    int rc;
+};
+
+static void *populate_hvm_worker(void *arg)
+{
+    struct populate_worker *w = arg;
+    /*
+     * A private handle per worker: hypercall buffer management inside an
+     * xc_interface isn't meant for concurrent use.
+     */
+    xc_interface *xch = xc_interface_open(NULL, NULL, 0);
+
+    if ( xch == NULL )
+    {
+        w->rc = -1;
+        return NULL;
+    }
+
+    w->rc = populate_hvm_range(xch, w->dom, w->memflags, w->cur_pages,
+                               w->end_pages, &w->stat_normal_pages,
+                               &w->stat_2mb_pages, &w->stat_1gb_pages);
+
+    xc_interface_close(xch);
+
+    return NULL;
+}
+
 static int meminit_hvm(struct xc_dom_image *dom)
 {
     unsigned long i, vmemid, nr_pages = dom->total_pages;
     unsigned long p2m_size;
     unsigned long target_pages = dom->target_pages;
-    unsigned long cur_pages, cur_pfn;
+    unsigned long cur_pages, span;
+    unsigned int nr_workers;
+    long nr_cpus;
     int rc;
     unsigned long stat_normal_pages = 0, stat_2mb_pages = 0,
         stat_1gb_pages = 0;
@@ -1500,108 +1663,61 @@ static int meminit_hvm(struct xc_dom_image *dom)
         else
             cur_pages = vmemranges[vmemid].start >> PAGE_SHIFT;
 
-        rc = 0;
-        while ( (rc == 0) && (end_pages > cur_pages) )
-        {
-            /* Clip count to maximum 1GB extent. */
-            unsigned long count = end_pages - cur_pages;
-            unsigned long max_pages = SUPERPAGE_1GB_NR_PFNS;
+        span = end_pages - cur_pages;
+        nr_workers = span / POPULATE_MIN_WORKER_PFNS;
+        if ( nr_workers > POPULATE_MAX_WORKERS )
+            nr_workers = POPULATE_MAX_WORKERS;
+        nr_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        if ( nr_cpus > 0 && nr_workers > nr_cpus )
+            nr_workers = nr_cpus;
 
-            if ( count > max_pages )
-                count = max_pages;
-
-            cur_pfn = dom->p2m_host[cur_pages];
-
-            /* Take care the corner cases of super page tails */
-            if ( ((cur_pfn & (SUPERPAGE_1GB_NR_PFNS-1)) != 0) &&
-                 (count > (-cur_pfn & (SUPERPAGE_1GB_NR_PFNS-1))) )
-                count = -cur_pfn & (SUPERPAGE_1GB_NR_PFNS-1);
-            else if ( ((count & (SUPERPAGE_1GB_NR_PFNS-1)) != 0) &&
-                      (count > SUPERPAGE_1GB_NR_PFNS) )
-                count &= ~(SUPERPAGE_1GB_NR_PFNS - 1);
-
-            /* Attemp to allocate 1GB super page. Because in each pass
-             * we only allocate at most 1GB, we don't have to clip
-             * super page boundaries.
-             */
-            if ( ((count | cur_pfn) & (SUPERPAGE_1GB_NR_PFNS - 1)) == 0 &&
-                 /* Check if there exists MMIO hole in the 1GB memory
-                  * range */
-                 !check_mmio_hole(cur_pfn << PAGE_SHIFT,
-                                  SUPERPAGE_1GB_NR_PFNS << PAGE_SHIFT,
-                                  dom->mmio_start, dom->mmio_size) )
-            {
-                long done;
-                unsigned long nr_extents = count >> SUPERPAGE_1GB_SHIFT;
-                xen_pfn_t sp_extents[nr_extents];
-
-                for ( i = 0; i < nr_extents; i++ )
-                    sp_extents[i] =
-                        dom->p2m_host[cur_pages+(i<<SUPERPAGE_1GB_SHIFT)];
-
-                done = xc_domain_populate_physmap(xch, domid, nr_extents,
-                                                  SUPERPAGE_1GB_SHIFT,
-                                                  new_memflags, sp_extents);
-
-                if ( done > 0 )
-                {
-                    stat_1gb_pages += done;
-                    done <<= SUPERPAGE_1GB_SHIFT;
-                    cur_pages += done;
-                    count -= done;
-                }
-            }
+        if ( nr_workers > 1 )
+        {
+            struct populate_worker workers[POPULATE_MAX_WORKERS] = {};
+            unsigned long chunk = span / nr_workers;
+            unsigned long start = cur_pages;
+            unsigned int w;
 
-            if ( count != 0 )
+            rc = 0;
+            for ( w = 0; w < nr_workers; w++ )
             {
-                /* Clip count to maximum 8MB extent. */
-                max_pages = SUPERPAGE_2MB_NR_PFNS * 4;
-                if ( count > max_pages )
-                    count = max_pages;
-
-                /* Clip partial superpage extents to superpage
-                 * boundaries. */
-                if ( ((cur_pfn & (SUPERPAGE_2MB_NR_PFNS-1)) != 0) &&
-                     (count > (-cur_pfn & (SUPERPAGE_2MB_NR_PFNS-1))) )
-                    count = -cur_pfn & (SUPERPAGE_2MB_NR_PFNS-1);
-                else if ( ((count & (SUPERPAGE_2MB_NR_PFNS-1)) != 0) &&
-                          (count > SUPERPAGE_2MB_NR_PFNS) )
-                    count &= ~(SUPERPAGE_2MB_NR_PFNS - 1); /* clip non-s.p. tail */
-
-                /* Attempt to allocate superpage extents. */
-                if ( ((count | cur_pfn) & (SUPERPAGE_2MB_NR_PFNS - 1)) == 0 )
+                workers[w].dom = dom;
+                workers[w].memflags = new_memflags;
+                workers[w].cur_pages = start;
+                /*
+                 * Shard on 1GB boundaries (in guest physical space, which
+                 * the p2m identity-maps here) so each worker keeps its
+                 * superpage allocation opportunities.
+                 */
+                workers[w].end_pages = (w == nr_workers - 1) ? end_pages :
+                    ((cur_pages + (w + 1) * chunk) &
+                     ~(unsigned long)(SUPERPAGE_1GB_NR_PFNS - 1));
+                start = workers[w].end_pages;
+
+                if ( pthread_create(&workers[w].thread, NULL,
+                                    populate_hvm_worker, &workers[w]) )
                 {
-                    long done;
-                    unsigned long nr_extents = count >> SUPERPAGE_2MB_SHIFT;
-                    xen_pfn_t sp_extents[nr_extents];
-
-                    for ( i = 0; i < nr_extents; i++ )
-                        sp_extents[i] =
-                            dom->p2m_host[cur_pages+(i<<SUPERPAGE_2MB_SHIFT)];
-
-                    done = xc_domain_populate_physmap(xch, domid, nr_extents,
-                                                      SUPERPAGE_2MB_SHIFT,
-                                                      new_memflags, sp_extents);
-
-                    if ( done > 0 )
-                    {
-                        stat_2mb_pages += done;
-                        done <<= SUPERPAGE_2MB_SHIFT;
-                        cur_pages += done;
-                        count -= done;
-                    }
+                    /* Do this shard's work ourselves instead. */
+                    workers[w].thread = pthread_self();
+                    populate_hvm_worker(&workers[w]);
                 }
             }
 
-            /* Fall back to 4kB extents. */
-            if ( count != 0 )
+            for ( w = 0; w < nr_workers; w++ )
             {
-                rc = xc_domain_populate_physmap_exact(
-                    xch, domid, count, 0, new_memflags, &dom->p2m_host[cur_pages]);
-                cur_pages += count;
-                stat_normal_pages += count;
+                if ( !pthread_equal(workers[w].thread, pthread_self()) )
+                    pthread_join(workers[w].thread, NULL);
+                if ( workers[w].rc != 0 )
+                    rc = workers[w].rc;
+                stat_normal_pages += workers[w].stat_normal_pages;
+                stat_2mb_pages += workers[w].stat_2mb_pages;
+                stat_1gb_pages += workers[w].stat_1gb_pages;
             }
         }
+        else
+            rc = populate_hvm_range(xch, dom, new_memflags, cur_pages,
+                                    end_pages, &stat_normal_pages,
+                                    &stat_2mb_pages, &stat_1gb_pages);
 
         if ( rc != 0 )
         {
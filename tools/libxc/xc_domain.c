@@ -321,6 +321,91 @@ int xc_domain_get_guest_width(xc_interface *xch, uint32_t domid,
     return 0;
 }
 
+int xc_domain_get_runstate_times(xc_interface *xch, uint32_t domid,
+                                 xc_runstate_times_t *times)
+{
+    int rc;
+    DECLARE_DOMCTL;
+
+    memset(&domctl, 0, sizeof(domctl));
+    domctl.domain = domid;
+    domctl.cmd = XEN_DOMCTL_get_runstate_times;
+
+    rc = do_domctl(xch, &domctl);
+    if ( rc == 0 )
+        *times = domctl.u.runstate_times;
+
+    return rc;
+}
+
+int xc_domain_set_superpage_promotion(xc_interface *xch, uint32_t domid,
+                                      bool enable)
+{
+    DECLARE_DOMCTL;
+
+    memset(&domctl, 0, sizeof(domctl));
+    domctl.domain = domid;
+    domctl.cmd = XEN_DOMCTL_superpage_promotion;
+    domctl.u.superpage_promotion.enable = enable;
+
+    return do_domctl(xch, &domctl);
+}
+
+int xc_domain_set_wakeup_latency(xc_interface *xch, uint32_t domid,
+                                 uint32_t latency_us)
+{
+    DECLARE_DOMCTL;
+
+    memset(&domctl, 0, sizeof(domctl));
+    domctl.domain = domid;
+    domctl.cmd = XEN_DOMCTL_set_wakeup_latency;
+    domctl.u.set_wakeup_latency.latency_us = latency_us;
+
+    return do_domctl(xch, &domctl);
+}
+
+int xc_domain_evtchn_fifo_latency(xc_interface *xch, uint32_t domid,
+                                  bool enable)
+{
+    DECLARE_DOMCTL;
+
+    memset(&domctl, 0, sizeof(domctl));
+    domctl.domain = domid;
+    domctl.cmd = XEN_DOMCTL_evtchn_fifo_lat;
+    domctl.u.evtchn_fifo_lat.op = enable ? XEN_DOMCTL_EVTCHN_FIFO_LAT_enable
+                                         : XEN_DOMCTL_EVTCHN_FIFO_LAT_disable;
+
+    return do_domctl(xch, &domctl);
+}
+
+int xc_domain_evtchn_fifo_latency_read(xc_interface *xch, uint32_t domid,
+                                       uint64_t *counts, uint32_t *nr_counts)
+{
+    int rc;
+    DECLARE_DOMCTL;
+    DECLARE_HYPERCALL_BOUNCE(counts, *nr_counts * sizeof(*counts),
+                             XC_HYPERCALL_BUFFER_BOUNCE_OUT);
+
+    if ( xc_hypercall_bounce_pre(xch, counts) )
+        return -1;
+
+    memset(&domctl, 0, sizeof(domctl));
+    domctl.domain = domid;
+    domctl.cmd = XEN_DOMCTL_evtchn_fifo_lat;
+    domctl.u.evtchn_fifo_lat.op = XEN_DOMCTL_EVTCHN_FIFO_LAT_read;
+    domctl.u.evtchn_fifo_lat.nr_counts = *nr_counts;
+    set_xen_guest_handle(domctl.u.evtchn_fifo_lat.counts, counts);
+
+    rc = do_domctl(xch, &domctl);
+
+    xc_hypercall_bounce_post(xch, counts);
+
+    if ( rc == 0 )
+        *nr_counts = domctl.u.evtchn_fifo_lat.nr_counts;
+
+    return rc;
+}
+
 int xc_dom_vuart_init(xc_interface *xch,
                       uint32_t type,
                       uint32_t domid,
@@ -441,6 +526,55 @@ int xc_domain_getinfolist(xc_interface *xch,
     return ret;
 }
 
+int xc_domain_snapshot(xc_interface *xch,
+                       uint32_t first_domain,
+                       unsigned int max_domains,
+                       xc_domaininfo_t *domains,
+                       unsigned int max_vcpus,
+                       xc_vcpu_snapshot_t *vcpus,
+                       unsigned int *num_domains,
+                       unsigned int *num_vcpus,
+                       uint64_t *generation)
+{
+    int ret = 0;
+    DECLARE_SYSCTL;
+    DECLARE_HYPERCALL_BOUNCE(domains, max_domains * sizeof(*domains),
+                             XC_HYPERCALL_BUFFER_BOUNCE_OUT);
+    DECLARE_HYPERCALL_BOUNCE(vcpus, max_vcpus * sizeof(*vcpus),
+                             XC_HYPERCALL_BUFFER_BOUNCE_OUT);
+
+    if ( xc_hypercall_bounce_pre(xch, domains) )
+        return -1;
+
+    if ( xc_hypercall_bounce_pre(xch, vcpus) )
+    {
+        xc_hypercall_bounce_post(xch, domains);
+        return -1;
+    }
+
+    sysctl.cmd = XEN_SYSCTL_domain_snapshot;
+    sysctl.u.domain_snapshot.first_domain = first_domain;
+    sysctl.u.domain_snapshot.max_domains  = max_domains;
+    sysctl.u.domain_snapshot.max_vcpus    = max_vcpus;
+    set_xen_guest_handle(sysctl.u.domain_snapshot.domains, domains);
+    set_xen_guest_handle(sysctl.u.domain_snapshot.vcpus, vcpus);
+
+    if ( xc_sysctl(xch, &sysctl) < 0 )
+        ret = -1;
+    else
+    {
+        *num_domains = sysctl.u.domain_snapshot.num_domains;
+        *num_vcpus   = sysctl.u.domain_snapshot.num_vcpus;
+        if ( generation )
+            *generation = sysctl.u.domain_snapshot.generation;
+    }
+
+    xc_hypercall_bounce_post(xch, vcpus);
+    xc_hypercall_bounce_post(xch, domains);
+
+    return ret;
+}
+
 /* set broken page p2m */
 int xc_set_broken_page_p2m(xc_interface *xch,
                            uint32_t domid,
@@ -561,6 +695,40 @@ int xc_vcpu_getcontext(xc_interface *xch,
     return rc;
 }
 
+int xc_domain_get_vcpu_contexts(xc_interface *xch,
+                                uint32_t domid,
+                                uint32_t first_vcpu,
+                                uint32_t *nr_vcpus,
+                                uint64_t *valid,
+                                vcpu_guest_context_any_t *ctxts)
+{
+    int rc;
+    DECLARE_DOMCTL;
+    DECLARE_HYPERCALL_BOUNCE(ctxts, *nr_vcpus * sizeof(*ctxts),
+                             XC_HYPERCALL_BUFFER_BOUNCE_OUT);
+
+    if ( xc_hypercall_bounce_pre(xch, ctxts) )
+        return -1;
+
+    domctl.cmd = XEN_DOMCTL_getvcpucontexts;
+    domctl.domain = domid;
+    domctl.u.vcpucontexts.first_vcpu = first_vcpu;
+    domctl.u.vcpucontexts.nr_vcpus = *nr_vcpus;
+    set_xen_guest_handle(domctl.u.vcpucontexts.ctxt, ctxts);
+
+    rc = do_domctl(xch, &domctl);
+
+    xc_hypercall_bounce_post(xch, ctxts);
+
+    if ( rc == 0 )
+    {
+        *nr_vcpus = domctl.u.vcpucontexts.nr_vcpus;
+        *valid = domctl.u.vcpucontexts.valid;
+    }
+
+    return rc;
+}
+
 int xc_vcpu_get_extstate(xc_interface *xch,
                          uint32_t domid,
                          uint32_t vcpu,
@@ -87,6 +87,14 @@ void *xc_map_foreign_bulk(xc_interface *xch, uint32_t dom, int prot,
     return xenforeignmemory_map(xch->fmem, dom, prot, num, arr, err);
 }
 
+void *xc_map_foreign_bulk_aligned(xc_interface *xch, uint32_t dom, int prot,
+                                  const xen_pfn_t *arr, int *err,
+                                  unsigned int num, size_t alignment)
+{
+    return xenforeignmemory_map_aligned(xch->fmem, dom, prot, num, arr, err,
+                                        alignment);
+}
+
 /*
  * Local variables:
  * mode: C
@@ -64,6 +64,36 @@ int xc_gnttab_get_version(xc_interface *xch, uint32_t domid)
         return query.version;
 }
 
+int xc_gnttab_pregrow(xc_interface *xch, uint32_t domid, uint32_t nr_frames)
+{
+    struct gnttab_setup_table setup;
+    DECLARE_HYPERCALL_BUFFER(unsigned long, frame_list);
+    int rc;
+
+    frame_list = xc_hypercall_buffer_alloc(xch, frame_list,
+                                           nr_frames * sizeof(*frame_list));
+    if ( !frame_list )
+    {
+        ERROR("Could not allocate frame_list in xc_gnttab_pregrow\n");
+        return -1;
+    }
+
+    setup.dom = domid;
+    setup.nr_frames = nr_frames;
+    set_xen_guest_handle(setup.frame_list, frame_list);
+
+    rc = xc_gnttab_op(xch, GNTTABOP_setup_table, &setup, sizeof(setup), 1);
+    if ( !rc && setup.status != GNTST_okay )
+    {
+        errno = EINVAL;
+        rc = -1;
+    }
+
+    xc_hypercall_buffer_free(xch, frame_list);
+
+    return rc;
+}
+
 static void *_gnttab_map_table(xc_interface *xch, uint32_t domid, int *gnt_num)
 {
     int rc, i;
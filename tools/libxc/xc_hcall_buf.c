@@ -61,6 +61,83 @@ void xc__hypercall_buffer_free(xc_interface *xch, xc_hypercall_buffer_t *b)
     xencall_free_buffer(xch->xcall, b->hbuf);
 }
 
+/*
+ * Arena of pre-pinned slabs backing the bounce helpers below. Pinning a
+ * buffer for every call (mlock/munlock on Linux) dominates the profile of
+ * callers issuing thousands of domctls/sysctls per second, so slabs are
+ * pinned once, handed out lock-free via a compare-and-swap'd in-use mask,
+ * and only unpinned when the interface is closed. Requests larger than a
+ * slab, or arriving when all slabs are busy, fall back to the usual
+ * per-call allocation.
+ */
+#define ARENA_SLAB_SIZE (XC_HCALL_ARENA_SLAB_PAGES * (size_t)PAGE_SIZE)
+
+static void *hcall_arena_alloc(xc_interface *xch, size_t size)
+{
+    unsigned int i;
+
+    if ( size > ARENA_SLAB_SIZE )
+        return NULL;
+
+    for ( i = 0; i < XC_HCALL_ARENA_NR_SLABS; i++ )
+    {
+        unsigned int bit = 1u << i;
+
+        if ( xch->hcall_arena.inuse & bit )
+            continue;
+
+        if ( xch->hcall_arena.slab[i] == NULL )
+        {
+            void *p = xencall_alloc_buffer_pages(xch->xcall,
+                                                 XC_HCALL_ARENA_SLAB_PAGES);
+
+            if ( p == NULL )
+                return NULL; /* fall back to a per-call allocation */
+
+            if ( !__sync_bool_compare_and_swap(&xch->hcall_arena.slab[i],
+                                               NULL, p) )
+                /* Lost the race to populate this slot. */
+                xencall_free_buffer_pages(xch->xcall, p,
+                                          XC_HCALL_ARENA_SLAB_PAGES);
+        }
+
+        if ( !(__sync_fetch_and_or(&xch->hcall_arena.inuse, bit) & bit) )
+            return xch->hcall_arena.slab[i];
+    }
+
+    return NULL;
+}
+
+static int hcall_arena_free(xc_interface *xch, void *p)
+{
+    unsigned int i;
+
+    for ( i = 0; i < XC_HCALL_ARENA_NR_SLABS; i++ )
+    {
+        if ( p == xch->hcall_arena.slab[i] )
+        {
+            __sync_fetch_and_and(&xch->hcall_arena.inuse, ~(1u << i));
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+void xc__hypercall_arena_destroy(xc_interface *xch)
+{
+    unsigned int i;
+
+    for ( i = 0; i < XC_HCALL_ARENA_NR_SLABS; i++ )
+    {
+        if ( xch->hcall_arena.slab[i] )
+            xencall_free_buffer_pages(xch->xcall, xch->hcall_arena.slab[i],
+                                      XC_HCALL_ARENA_SLAB_PAGES);
+        xch->hcall_arena.slab[i] = NULL;
+    }
+    xch->hcall_arena.inuse = 0;
+}
+
 int xc__hypercall_bounce_pre(xc_interface *xch, xc_hypercall_buffer_t *b)
 {
     void *p;
@@ -80,7 +157,14 @@ int xc__hypercall_bounce_pre(xc_interface *xch, xc_hypercall_buffer_t *b)
         return 0;
     }
 
-    p = xc__hypercall_buffer_alloc(xch, b, b->sz);
+    p = hcall_arena_alloc(xch, b->sz);
+    if ( p != NULL )
+    {
+        memset(p, 0, b->sz); /* match xencall_alloc_buffer() behaviour */
+        b->hbuf = p;
+    }
+    else
+        p = xc__hypercall_buffer_alloc(xch, b, b->sz);
     if ( p == NULL )
         return -1;
 
@@ -104,7 +188,8 @@ void xc__hypercall_bounce_post(xc_interface *xch, xc_hypercall_buffer_t *b)
     if ( b->dir == XC_HYPERCALL_BUFFER_BOUNCE_OUT || b->dir == XC_HYPERCALL_BUFFER_BOUNCE_BOTH )
         memcpy(b->ubuf, b->hbuf, b->sz);
 
-    xc__hypercall_buffer_free(xch, b);
+    if ( !hcall_arena_free(xch, b->hbuf) )
+        xc__hypercall_buffer_free(xch, b);
 }
 
 struct xc_hypercall_buffer_array {
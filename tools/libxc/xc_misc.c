@@ -464,6 +464,60 @@ int xc_perfc_query(xc_interface *xch,
     return do_sysctl(xch, &sysctl);
 }
 
+int xc_memprof_query(xc_interface *xch,
+                     struct xc_hypercall_buffer *sites, uint32_t *nr_sites,
+                     struct xc_hypercall_buffer *doms, uint32_t *nr_doms,
+                     uint64_t *pool_used, uint64_t *pool_size)
+{
+    int rc;
+    DECLARE_SYSCTL;
+    DECLARE_HYPERCALL_BUFFER_ARGUMENT(sites);
+    DECLARE_HYPERCALL_BUFFER_ARGUMENT(doms);
+
+    sysctl.cmd = XEN_SYSCTL_memprof;
+    sysctl.u.memprof.nr_sites = *nr_sites;
+    sysctl.u.memprof.nr_doms = *nr_doms;
+    set_xen_guest_handle(sysctl.u.memprof.sites, sites);
+    set_xen_guest_handle(sysctl.u.memprof.doms, doms);
+
+    rc = do_sysctl(xch, &sysctl);
+    if ( rc )
+        return rc;
+
+    *nr_sites = sysctl.u.memprof.nr_sites;
+    *nr_doms = sysctl.u.memprof.nr_doms;
+    if ( pool_used )
+        *pool_used = sysctl.u.memprof.pool_used;
+    if ( pool_size )
+        *pool_size = sysctl.u.memprof.pool_size;
+
+    return 0;
+}
+
+int xc_dlog_read(xc_interface *xch, uint32_t cpu,
+                 struct xc_hypercall_buffer *recs, uint32_t *nr_recs,
+                 uint64_t *prod)
+{
+    int rc;
+    DECLARE_SYSCTL;
+    DECLARE_HYPERCALL_BUFFER_ARGUMENT(recs);
+
+    sysctl.cmd = XEN_SYSCTL_dlog;
+    sysctl.u.dlog.cpu = cpu;
+    sysctl.u.dlog.nr_recs = *nr_recs;
+    set_xen_guest_handle(sysctl.u.dlog.recs, recs);
+
+    rc = do_sysctl(xch, &sysctl);
+    if ( rc )
+        return rc;
+
+    *nr_recs = sysctl.u.dlog.nr_recs;
+    if ( prod )
+        *prod = sysctl.u.dlog.prod;
+
+    return 0;
+}
+
 int xc_lockprof_reset(xc_interface *xch)
 {
     DECLARE_SYSCTL;
@@ -475,6 +529,18 @@ int xc_lockprof_reset(xc_interface *xch)
     return do_sysctl(xch, &sysctl);
 }
 
+int xc_lockprof_control(xc_interface *xch, bool enable)
+{
+    DECLARE_SYSCTL;
+
+    sysctl.cmd = XEN_SYSCTL_lockprof_op;
+    sysctl.u.lockprof_op.cmd = enable ? XEN_SYSCTL_LOCKPROF_enable
+                                      : XEN_SYSCTL_LOCKPROF_disable;
+    set_xen_guest_handle(sysctl.u.lockprof_op.data, HYPERCALL_BUFFER_NULL);
+
+    return do_sysctl(xch, &sysctl);
+}
+
 int xc_lockprof_query_number(xc_interface *xch,
                              uint32_t *n_elems)
 {
@@ -514,6 +580,202 @@ int xc_lockprof_query(xc_interface *xch,
     return rc;
 }
 
+int xc_hypercall_prof_reset(xc_interface *xch, uint32_t domid)
+{
+    DECLARE_SYSCTL;
+
+    sysctl.cmd = XEN_SYSCTL_hypercall_prof_op;
+    sysctl.u.hypercall_prof_op.cmd = XEN_SYSCTL_HYPERCALL_PROF_reset;
+    sysctl.u.hypercall_prof_op.domain = domid;
+    set_xen_guest_handle(sysctl.u.hypercall_prof_op.data,
+                         HYPERCALL_BUFFER_NULL);
+
+    return do_sysctl(xch, &sysctl);
+}
+
+int xc_hypercall_prof_query(xc_interface *xch,
+                            uint32_t domid,
+                            uint32_t *n_elems,
+                            struct xc_hypercall_buffer *data)
+{
+    int rc;
+    DECLARE_SYSCTL;
+    DECLARE_HYPERCALL_BUFFER_ARGUMENT(data);
+
+    sysctl.cmd = XEN_SYSCTL_hypercall_prof_op;
+    sysctl.u.hypercall_prof_op.cmd = XEN_SYSCTL_HYPERCALL_PROF_query;
+    sysctl.u.hypercall_prof_op.domain = domid;
+    sysctl.u.hypercall_prof_op.max_elem = *n_elems;
+    set_xen_guest_handle(sysctl.u.hypercall_prof_op.data, data);
+
+    rc = do_sysctl(xch, &sysctl);
+
+    *n_elems = sysctl.u.hypercall_prof_op.nr_elem;
+
+    return rc;
+}
+
+int xc_domperf_enable(xc_interface *xch, int enable)
+{
+    DECLARE_SYSCTL;
+
+    sysctl.cmd = XEN_SYSCTL_domperf_op;
+    sysctl.u.domperf_op.cmd = enable ? XEN_SYSCTL_DOMPERF_enable
+                                     : XEN_SYSCTL_DOMPERF_disable;
+    set_xen_guest_handle(sysctl.u.domperf_op.data, HYPERCALL_BUFFER_NULL);
+
+    return do_sysctl(xch, &sysctl);
+}
+
+int xc_domperf_query(xc_interface *xch,
+                     uint32_t domid,
+                     uint32_t *n_elems,
+                     struct xc_hypercall_buffer *data)
+{
+    int rc;
+    DECLARE_SYSCTL;
+    DECLARE_HYPERCALL_BUFFER_ARGUMENT(data);
+
+    sysctl.cmd = XEN_SYSCTL_domperf_op;
+    sysctl.u.domperf_op.cmd = XEN_SYSCTL_DOMPERF_query;
+    sysctl.u.domperf_op.domain = domid;
+    sysctl.u.domperf_op.max_elem = *n_elems;
+    set_xen_guest_handle(sysctl.u.domperf_op.data, data);
+
+    rc = do_sysctl(xch, &sysctl);
+
+    *n_elems = sysctl.u.domperf_op.nr_elem;
+
+    return rc;
+}
+
+int xc_sampler_enable(xc_interface *xch, int enable, uint32_t rate)
+{
+    DECLARE_SYSCTL;
+
+    sysctl.cmd = XEN_SYSCTL_sampler_op;
+    sysctl.u.sampler_op.cmd = enable ? XEN_SYSCTL_SAMPLER_enable
+                                     : XEN_SYSCTL_SAMPLER_disable;
+    sysctl.u.sampler_op.rate = rate;
+
+    return do_sysctl(xch, &sysctl);
+}
+
+int xc_sampler_query(xc_interface *xch, uint32_t *enabled,
+                     uint64_t *nr_samples, uint64_t *nr_dropped)
+{
+    int rc;
+    DECLARE_SYSCTL;
+
+    sysctl.cmd = XEN_SYSCTL_sampler_op;
+    sysctl.u.sampler_op.cmd = XEN_SYSCTL_SAMPLER_query;
+
+    rc = do_sysctl(xch, &sysctl);
+    if ( rc )
+        return rc;
+
+    if ( enabled )
+        *enabled = sysctl.u.sampler_op.enabled;
+    if ( nr_samples )
+        *nr_samples = sysctl.u.sampler_op.nr_samples;
+    if ( nr_dropped )
+        *nr_dropped = sysctl.u.sampler_op.nr_dropped;
+
+    return 0;
+}
+
+int xc_irq_stats(xc_interface *xch, struct xen_sysctl_irq_stat *stats,
+                 uint32_t *nr)
+{
+    int rc;
+    DECLARE_SYSCTL;
+    DECLARE_HYPERCALL_BOUNCE(stats, *nr * sizeof(*stats),
+                             XC_HYPERCALL_BUFFER_BOUNCE_OUT);
+
+    if ( xc_hypercall_bounce_pre(xch, stats) )
+        return -1;
+
+    sysctl.cmd = XEN_SYSCTL_irq_stats;
+    sysctl.u.irq_stats.nr = *nr;
+    set_xen_guest_handle(sysctl.u.irq_stats.stats, stats);
+
+    rc = do_sysctl(xch, &sysctl);
+
+    xc_hypercall_bounce_post(xch, stats);
+
+    if ( rc == 0 )
+        *nr = sysctl.u.irq_stats.nr;
+
+    return rc;
+}
+
+int xc_statspage_enable(xc_interface *xch, uint32_t capacity,
+                        uint32_t period_ms)
+{
+    DECLARE_SYSCTL;
+
+    sysctl.cmd = XEN_SYSCTL_statspage_op;
+    sysctl.u.statspage_op.cmd = XEN_SYSCTL_STATSPAGE_enable;
+    sysctl.u.statspage_op.capacity = capacity;
+    sysctl.u.statspage_op.period_ms = period_ms;
+
+    return do_sysctl(xch, &sysctl);
+}
+
+int xc_statspage_disable(xc_interface *xch)
+{
+    DECLARE_SYSCTL;
+
+    sysctl.cmd = XEN_SYSCTL_statspage_op;
+    sysctl.u.statspage_op.cmd = XEN_SYSCTL_STATSPAGE_disable;
+
+    return do_sysctl(xch, &sysctl);
+}
+
+int xc_statspage_get_info(xc_interface *xch, uint64_t *mfn,
+                          uint32_t *nr_pages)
+{
+    int rc;
+    DECLARE_SYSCTL;
+
+    sysctl.cmd = XEN_SYSCTL_statspage_op;
+    sysctl.u.statspage_op.cmd = XEN_SYSCTL_STATSPAGE_get_info;
+
+    rc = do_sysctl(xch, &sysctl);
+    if ( rc == 0 )
+    {
+        *mfn = sysctl.u.statspage_op.mfn;
+        *nr_pages = sysctl.u.statspage_op.nr_pages;
+    }
+
+    return rc;
+}
+
+int xc_timepage_info(xc_interface *xch, uint64_t *mfn)
+{
+    int rc;
+    DECLARE_SYSCTL;
+
+    sysctl.cmd = XEN_SYSCTL_timepage_info;
+
+    rc = do_sysctl(xch, &sysctl);
+    if ( rc == 0 )
+        *mfn = sysctl.u.timepage_info.mfn;
+
+    return rc;
+}
+
+void *xc_timepage_map(xc_interface *xch)
+{
+    uint64_t mfn;
+
+    if ( xc_timepage_info(xch, &mfn) )
+        return NULL;
+
+    return xc_map_foreign_range(xch, DOMID_XEN, XC_PAGE_SIZE,
+                                PROT_READ, mfn);
+}
+
 int xc_getcpuinfo(xc_interface *xch, int max_cpus,
                   xc_cpuinfo_t *info, int *nr_cpus)
 {
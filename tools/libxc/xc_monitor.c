@@ -25,7 +25,14 @@
 void *xc_monitor_enable(xc_interface *xch, uint32_t domain_id, uint32_t *port)
 {
     return xc_vm_event_enable(xch, domain_id, HVM_PARAM_MONITOR_RING_PFN,
-                              port);
+                              port, 0);
+}
+
+void *xc_monitor_enable_ex(xc_interface *xch, uint32_t domain_id,
+                           uint32_t *port, unsigned int ring_order)
+{
+    return xc_vm_event_enable(xch, domain_id, HVM_PARAM_MONITOR_RING_PFN,
+                              port, ring_order);
 }
 
 int xc_monitor_disable(xc_interface *xch, uint32_t domain_id)
@@ -105,6 +112,41 @@ int xc_monitor_mov_to_msr(xc_interface *xch, uint32_t domain_id, uint32_t msr,
     return do_domctl(xch, &domctl);
 }
 
+static int monitor_allowed_value(xc_interface *xch, uint32_t domain_id,
+                                 uint32_t op, uint32_t event, uint32_t index,
+                                 uint64_t value)
+{
+    DECLARE_DOMCTL;
+
+    domctl.cmd = XEN_DOMCTL_monitor_op;
+    domctl.domain = domain_id;
+    domctl.u.monitor_op.op = op;
+    domctl.u.monitor_op.event = event;
+    domctl.u.monitor_op.u.allowed_value.index = index;
+    domctl.u.monitor_op.u.allowed_value.pad = 0;
+    domctl.u.monitor_op.u.allowed_value.value = value;
+
+    return do_domctl(xch, &domctl);
+}
+
+int xc_monitor_add_allowed_value(xc_interface *xch, uint32_t domain_id,
+                                 uint32_t event, uint32_t index,
+                                 uint64_t value)
+{
+    return monitor_allowed_value(xch, domain_id,
+                                 XEN_DOMCTL_MONITOR_OP_ADD_ALLOWED_VALUE,
+                                 event, index, value);
+}
+
+int xc_monitor_remove_allowed_value(xc_interface *xch, uint32_t domain_id,
+                                    uint32_t event, uint32_t index,
+                                    uint64_t value)
+{
+    return monitor_allowed_value(xch, domain_id,
+                                 XEN_DOMCTL_MONITOR_OP_REMOVE_ALLOWED_VALUE,
+                                 event, index, value);
+}
+
 int xc_monitor_software_breakpoint(xc_interface *xch, uint32_t domain_id,
                                    bool enable)
 {
@@ -192,6 +192,67 @@ int xc_pm_reset_cxstat(xc_interface *xch, int cpuid)
     return xc_sysctl(xch, &sysctl);
 }
 
+int xc_pm_get_summary(xc_interface *xch, struct pm_telemetry_rec *recs,
+                      int *nr)
+{
+    DECLARE_SYSCTL;
+    DECLARE_HYPERCALL_BOUNCE(recs, *nr * sizeof(*recs),
+                             XC_HYPERCALL_BUFFER_BOUNCE_OUT);
+    int ret;
+
+    if ( xc_hypercall_bounce_pre(xch, recs) )
+        return -1;
+
+    sysctl.cmd = XEN_SYSCTL_get_pmstat;
+    sysctl.u.get_pmstat.type = PMSTAT_get_summary;
+    sysctl.u.get_pmstat.cpuid = 0;
+    sysctl.u.get_pmstat.u.telem.nr = *nr;
+    set_xen_guest_handle(sysctl.u.get_pmstat.u.telem.summaries, recs);
+
+    ret = xc_sysctl(xch, &sysctl);
+
+    xc_hypercall_bounce_post(xch, recs);
+
+    if ( !ret )
+        *nr = sysctl.u.get_pmstat.u.telem.nr;
+
+    return ret;
+}
+
+int xc_pm_telemetry_enable(xc_interface *xch, uint32_t period_ms,
+                           uint64_t *mfn, uint32_t *nr_pages)
+{
+    DECLARE_SYSCTL;
+    int ret;
+
+    sysctl.cmd = XEN_SYSCTL_get_pmstat;
+    sysctl.u.get_pmstat.type = PMSTAT_telem_enable;
+    sysctl.u.get_pmstat.cpuid = 0;
+    sysctl.u.get_pmstat.u.telem.period_ms = period_ms;
+
+    ret = xc_sysctl(xch, &sysctl);
+    if ( !ret )
+    {
+        if ( mfn )
+            *mfn = sysctl.u.get_pmstat.u.telem.mfn;
+        if ( nr_pages )
+            *nr_pages = sysctl.u.get_pmstat.u.telem.nr;
+    }
+
+    return ret;
+}
+
+int xc_pm_telemetry_disable(xc_interface *xch)
+{
+    DECLARE_SYSCTL;
+
+    sysctl.cmd = XEN_SYSCTL_get_pmstat;
+    sysctl.u.get_pmstat.type = PMSTAT_telem_disable;
+    sysctl.u.get_pmstat.cpuid = 0;
+
+    return xc_sysctl(xch, &sysctl);
+}
+
 
 /*
  * 1. Get PM parameter
@@ -433,3 +494,35 @@ int xc_disable_turbo(xc_interface *xch, int cpuid)
     sysctl.u.pm_op.cpuid = cpuid;
     return do_sysctl(xch, &sysctl);
 }
+
+int xc_set_hwp_epp(xc_interface *xch, int cpuid, uint32_t epp)
+{
+    DECLARE_SYSCTL;
+
+    if ( !xch )
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    sysctl.cmd = XEN_SYSCTL_pm_op;
+    sysctl.u.pm_op.cmd = XEN_SYSCTL_pm_op_set_hwp_epp;
+    sysctl.u.pm_op.cpuid = cpuid;
+    sysctl.u.pm_op.u.set_hwp_epp = epp;
+    return do_sysctl(xch, &sysctl);
+}
+
+int xc_set_cpu_max_cstate(xc_interface *xch, int cpuid, uint32_t value)
+{
+    DECLARE_SYSCTL;
+
+    if ( !xch )
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    sysctl.cmd = XEN_SYSCTL_pm_op;
+    sysctl.u.pm_op.cmd = XEN_SYSCTL_pm_op_set_cpu_max_cstate;
+    sysctl.u.pm_op.cpuid = cpuid;
+    sysctl.u.pm_op.u.set_cpu_max_cstate = value;
+    return do_sysctl(xch, &sysctl);
+}
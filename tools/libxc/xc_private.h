@@ -98,11 +98,25 @@ struct xc_interface_core {
 
     /* Device model */
     xendevicemodel_handle *dmod;
+
+    /*
+     * Arena of pre-pinned hypercall buffer slabs used by the bounce
+     * helpers (see xc_hcall_buf.c). Slabs are pinned lazily, claimed
+     * lock-free via the in-use bitmask, and only unpinned on close.
+     */
+#define XC_HCALL_ARENA_NR_SLABS   8
+#define XC_HCALL_ARENA_SLAB_PAGES 32
+    struct {
+        void *slab[XC_HCALL_ARENA_NR_SLABS];
+        unsigned int inuse;
+    } hcall_arena;
 };
 
 void *osdep_alloc_hypercall_buffer(xc_interface *xch, int npages);
 void osdep_free_hypercall_buffer(xc_interface *xch, void *ptr, int npages);
 
+void xc__hypercall_arena_destroy(xc_interface *xch);
+
 void xc_report_error(xc_interface *xch, int code, const char *fmt, ...)
     __attribute__((format(printf,3,4)));
 void xc_reportv(xc_interface *xch, xentoollog_logger *lg, xentoollog_level,
@@ -399,6 +413,7 @@ int xc_flush_mmu_updates(xc_interface *xch, struct xc_mmu *mmu);
 int read_exact(int fd, void *data, size_t size); /* EOF => -1, errno=0 */
 int write_exact(int fd, const void *data, size_t size);
 int writev_exact(int fd, const struct iovec *iov, int iovcnt);
+int readv_exact(int fd, const struct iovec *iov, int iovcnt);
 
 int xc_ffs8(uint8_t x);
 int xc_ffs16(uint16_t x);
@@ -414,11 +429,12 @@ int xc_ffs64(uint64_t x);
 int xc_vm_event_control(xc_interface *xch, uint32_t domain_id, unsigned int op,
                         unsigned int mode, uint32_t *port);
 /*
- * Enables vm_event and returns the mapped ring page indicated by param.
+ * Enables vm_event and returns the mapped ring, 1 << ring_order pages
+ * starting at the pfn indicated by param.
  * param can be HVM_PARAM_PAGING/ACCESS/SHARING_RING_PFN
  */
 void *xc_vm_event_enable(xc_interface *xch, uint32_t domain_id, int param,
-                         uint32_t *port);
+                         uint32_t *port, unsigned int ring_order);
 
 int do_dm_op(xc_interface *xch, uint32_t domid, unsigned int nr_bufs, ...);
 
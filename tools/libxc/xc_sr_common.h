@@ -198,6 +198,9 @@ struct xc_sr_context
             /* Further debugging information in the stream. */
             bool debug;
 
+            /* Emit PAGE_DATA_COMPRESSED records where they shrink. */
+            bool compress;
+
             unsigned long p2m_size;
 
             struct precopy_stats stats;
@@ -207,6 +210,11 @@ struct xc_sr_context
             unsigned long *deferred_pages;
             unsigned long nr_deferred_pages;
             xc_hypercall_buffer_t dirty_bitmap_hbuf;
+            xc_hypercall_buffer_t dirty_list_hbuf;
+            bool dirty_list_unsupported;
+
+            /* Pipelined writer thread state.  NULL => write inline. */
+            struct xc_sr_save_writer *writer;
         } save;
 
         struct /* Restore data. */
@@ -389,6 +397,16 @@ static inline int write_record(struct xc_sr_context *ctx,
  */
 int read_record(struct xc_sr_context *ctx, int fd, struct xc_sr_record *rec);
 
+/*
+ * Split variants of read_record(), for callers wishing to inspect the record
+ * header before deciding how to consume the payload (e.g. to stream page data
+ * straight into a guest mapping rather than via an intermediate buffer).
+ */
+int read_record_header(struct xc_sr_context *ctx, int fd,
+                       struct xc_sr_rhdr *rhdr);
+int read_record_data(struct xc_sr_context *ctx, int fd,
+                     const struct xc_sr_rhdr *rhdr, struct xc_sr_record *rec);
+
 /*
  * This would ideally be private in restore.c, but is needed by
  * x86_pv_localise_page() if we receive pagetables frames ahead of the
@@ -1,9 +1,13 @@
 #include <arpa/inet.h>
 
 #include <assert.h>
+#include <zlib.h>
 
 #include "xc_sr_common.h"
 
+#define SUPERPAGE_2MB_SHIFT   9
+#define SUPERPAGE_2MB_NR_PFNS (1UL << SUPERPAGE_2MB_SHIFT)
+
 /*
  * Read and validate the Image and Domain headers.
  */
@@ -136,11 +140,13 @@ int populate_pfns(struct xc_sr_context *ctx, unsigned count,
 {
     xc_interface *xch = ctx->xch;
     xen_pfn_t *mfns = malloc(count * sizeof(*mfns)),
-        *pfns = malloc(count * sizeof(*pfns));
-    unsigned i, nr_pfns = 0;
+        *pfns = malloc(count * sizeof(*pfns)),
+        *small = malloc(count * sizeof(*small));
+    unsigned *small_idx = malloc(count * sizeof(*small_idx));
+    unsigned i, nr_pfns = 0, nr_small = 0;
     int rc = -1;
 
-    if ( !mfns || !pfns )
+    if ( !mfns || !pfns || !small || !small_idx )
     {
         ERROR("Failed to allocate %zu bytes for populating the physmap",
               2 * count * sizeof(*mfns));
@@ -162,16 +168,63 @@ int populate_pfns(struct xc_sr_context *ctx, unsigned count,
         }
     }
 
-    if ( nr_pfns )
+    /*
+     * Populate aligned runs of contiguous pfns as 2MB extents, which keeps
+     * guest memory physically contiguous and takes far fewer hypercalls for
+     * large guests.  Anything else (unaligned, partial runs, or failed 2MB
+     * allocations due to host fragmentation) is populated as 4k pages in a
+     * single batch afterwards.  PV guests see no benefit, and their pfns
+     * rarely form runs, so only HVM guests take the superpage path.
+     */
+    for ( i = 0; i < nr_pfns; )
+    {
+        unsigned run = 1, j;
+
+        if ( ctx->dominfo.hvm &&
+             !(pfns[i] & (SUPERPAGE_2MB_NR_PFNS - 1)) )
+        {
+            while ( run < SUPERPAGE_2MB_NR_PFNS && i + run < nr_pfns &&
+                    pfns[i + run] == pfns[i] + run )
+                ++run;
+        }
+
+        if ( run == SUPERPAGE_2MB_NR_PFNS )
+        {
+            xen_pfn_t extent = pfns[i];
+
+            if ( xc_domain_populate_physmap_exact(
+                     xch, ctx->domid, 1, SUPERPAGE_2MB_SHIFT, 0,
+                     &extent) == 0 )
+            {
+                for ( j = 0; j < run; ++j )
+                    mfns[i + j] = extent + j;
+                i += run;
+                continue;
+            }
+            /* Fall through to 4k allocations for this pfn. */
+        }
+
+        small_idx[nr_small] = i;
+        small[nr_small++] = pfns[i];
+        ++i;
+    }
+
+    if ( nr_small )
     {
         rc = xc_domain_populate_physmap_exact(
-            xch, ctx->domid, nr_pfns, 0, 0, mfns);
+            xch, ctx->domid, nr_small, 0, 0, small);
         if ( rc )
         {
             PERROR("Failed to populate physmap");
             goto err;
         }
 
+        for ( i = 0; i < nr_small; ++i )
+            mfns[small_idx[i]] = small[i];
+    }
+
+    if ( nr_pfns )
+    {
         for ( i = 0; i < nr_pfns; ++i )
         {
             if ( mfns[i] == INVALID_MFN )
@@ -188,6 +241,8 @@ int populate_pfns(struct xc_sr_context *ctx, unsigned count,
     rc = 0;
 
  err:
+    free(small_idx);
+    free(small);
     free(pfns);
     free(mfns);
 
@@ -198,6 +253,11 @@ int populate_pfns(struct xc_sr_context *ctx, unsigned count,
  * Given a list of pfns, their types, and a block of page data from the
  * stream, populate and record their types, map the relevant subset and copy
  * the data into the guest.
+ *
+ * If page_data is NULL, the page contents are instead read directly from
+ * ctx->fd into the guest mapping, eliminating the intermediate copy.  The
+ * caller must have established that the next data in the stream is exactly
+ * the pages described by pfns/types, and must not be in verify mode.
  */
 static int process_page_data(struct xc_sr_context *ctx, unsigned count,
                              xen_pfn_t *pfns, uint32_t *types, void *page_data)
@@ -205,13 +265,17 @@ static int process_page_data(struct xc_sr_context *ctx, unsigned count,
     xc_interface *xch = ctx->xch;
     xen_pfn_t *mfns = malloc(count * sizeof(*mfns));
     int *map_errs = malloc(count * sizeof(*map_errs));
-    int rc;
+    struct iovec *iov = NULL;
+    int rc, iovcnt = 0;
     void *mapping = NULL, *guest_page = NULL;
     unsigned i,    /* i indexes the pfns from the record. */
         j,         /* j indexes the subset of pfns we decide to map. */
         nr_pages = 0;
 
-    if ( !mfns || !map_errs )
+    if ( !page_data )
+        iov = malloc(count * sizeof(*iov));
+
+    if ( !mfns || !map_errs || (!page_data && !iov) )
     {
         rc = -1;
         ERROR("Failed to allocate %zu bytes to process page data",
@@ -285,6 +349,18 @@ static int process_page_data(struct xc_sr_context *ctx, unsigned count,
             goto err;
         }
 
+        if ( !page_data )
+        {
+            /* Direct mode - stream the data into place below. */
+            iov[iovcnt].iov_base = guest_page;
+            iov[iovcnt].iov_len = PAGE_SIZE;
+            ++iovcnt;
+
+            ++j;
+            guest_page += PAGE_SIZE;
+            continue;
+        }
+
         /* Undo page normalisation done by the saver. */
         rc = ctx->restore.ops.localise_page(ctx, types[i], page_data);
         if ( rc )
@@ -312,6 +388,39 @@ static int process_page_data(struct xc_sr_context *ctx, unsigned count,
         page_data += PAGE_SIZE;
     }
 
+    if ( !page_data && iovcnt )
+    {
+        if ( readv_exact(ctx->fd, iov, iovcnt) )
+        {
+            rc = -1;
+            PERROR("Failed to read %u pages of data into guest mapping",
+                   iovcnt);
+            goto err;
+        }
+
+        /* Undo page normalisation done by the saver, in place. */
+        for ( i = 0, guest_page = mapping; i < count; ++i )
+        {
+            switch ( types[i] )
+            {
+            case XEN_DOMCTL_PFINFO_XTAB:
+            case XEN_DOMCTL_PFINFO_BROKEN:
+            case XEN_DOMCTL_PFINFO_XALLOC:
+                continue;
+            }
+
+            rc = ctx->restore.ops.localise_page(ctx, types[i], guest_page);
+            if ( rc )
+            {
+                ERROR("Failed to localise pfn %#"PRIpfn" (type %#"PRIx32")",
+                      pfns[i], types[i] >> XEN_DOMCTL_PFINFO_LTAB_SHIFT);
+                goto err;
+            }
+
+            guest_page += PAGE_SIZE;
+        }
+    }
+
  done:
     rc = 0;
 
@@ -319,6 +428,7 @@ static int process_page_data(struct xc_sr_context *ctx, unsigned count,
     if ( mapping )
         xenforeignmemory_unmap(xch->fmem, mapping, nr_pages);
 
+    free(iov);
     free(map_errs);
     free(mfns);
 
@@ -326,34 +436,33 @@ static int process_page_data(struct xc_sr_context *ctx, unsigned count,
 }
 
 /*
- * Validate a PAGE_DATA record from the stream, and pass the results to
- * process_page_data() to actually perform the legwork.
+ * Validate the pfn/type words of a PAGE_DATA record, and return freshly
+ * allocated arrays of the decoded pfns and types.  'length' is the length of
+ * the full record; 'pages' must contain at least the header and pfn array.
+ * The caller is responsible for checking that the record payload matches
+ * *pages_of_data_p, which differs per record type.
  */
-static int handle_page_data(struct xc_sr_context *ctx, struct xc_sr_record *rec)
+static int decode_page_data_header(struct xc_sr_context *ctx, uint32_t length,
+                                   struct xc_sr_rec_page_data_header *pages,
+                                   xen_pfn_t **pfns_p, uint32_t **types_p,
+                                   unsigned *pages_of_data_p)
 {
     xc_interface *xch = ctx->xch;
-    struct xc_sr_rec_page_data_header *pages = rec->data;
     unsigned i, pages_of_data = 0;
     int rc = -1;
 
     xen_pfn_t *pfns = NULL, pfn;
     uint32_t *types = NULL, type;
 
-    if ( rec->length < sizeof(*pages) )
-    {
-        ERROR("PAGE_DATA record truncated: length %u, min %zu",
-              rec->length, sizeof(*pages));
-        goto err;
-    }
-    else if ( pages->count < 1 )
+    if ( pages->count < 1 )
     {
         ERROR("Expected at least 1 pfn in PAGE_DATA record");
         goto err;
     }
-    else if ( rec->length < sizeof(*pages) + (pages->count * sizeof(uint64_t)) )
+    else if ( length < sizeof(*pages) + (pages->count * sizeof(uint64_t)) )
     {
         ERROR("PAGE_DATA record (length %u) too short to contain %u"
-              " pfns worth of information", rec->length, pages->count);
+              " pfns worth of information", length, pages->count);
         goto err;
     }
 
@@ -392,6 +501,46 @@ static int handle_page_data(struct xc_sr_context *ctx, struct xc_sr_record *rec)
         types[i] = type;
     }
 
+    *pfns_p = pfns;
+    *types_p = types;
+    *pages_of_data_p = pages_of_data;
+
+    return 0;
+
+ err:
+    free(types);
+    free(pfns);
+
+    return rc;
+}
+
+/*
+ * Validate a PAGE_DATA record from the stream, and pass the results to
+ * process_page_data() to actually perform the legwork.
+ */
+static int handle_page_data(struct xc_sr_context *ctx, struct xc_sr_record *rec)
+{
+    xc_interface *xch = ctx->xch;
+    struct xc_sr_rec_page_data_header *pages = rec->data;
+    unsigned pages_of_data;
+    int rc = -1;
+
+    xen_pfn_t *pfns = NULL;
+    uint32_t *types = NULL;
+
+    if ( rec->length < sizeof(*pages) )
+    {
+        ERROR("PAGE_DATA record truncated: length %u, min %zu",
+              rec->length, sizeof(*pages));
+        goto err;
+    }
+
+    rc = decode_page_data_header(ctx, rec->length, pages, &pfns, &types,
+                                 &pages_of_data);
+    if ( rc )
+        goto err;
+    rc = -1;
+
     if ( rec->length != (sizeof(*pages) +
                          (sizeof(uint64_t) * pages->count) +
                          (PAGE_SIZE * pages_of_data)) )
@@ -411,6 +560,152 @@ static int handle_page_data(struct xc_sr_context *ctx, struct xc_sr_record *rec)
     return rc;
 }
 
+/*
+ * Handle a PAGE_DATA record whose payload has not yet been read from the
+ * stream.  The pfn header is read and validated as usual, but the page
+ * contents are left in the stream for process_page_data() to readv()
+ * directly into the guest mapping.  Not usable in verify mode, or when
+ * records are being buffered for a checkpoint.
+ */
+static int handle_page_data_direct(struct xc_sr_context *ctx,
+                                   const struct xc_sr_rhdr *rhdr)
+{
+    xc_interface *xch = ctx->xch;
+    struct xc_sr_rec_page_data_header hdr, *pages = NULL;
+    unsigned pages_of_data;
+    int rc = -1;
+
+    xen_pfn_t *pfns = NULL;
+    uint32_t *types = NULL;
+
+    if ( rhdr->length < sizeof(hdr) )
+    {
+        ERROR("PAGE_DATA record truncated: length %u, min %zu",
+              rhdr->length, sizeof(hdr));
+        goto err;
+    }
+
+    if ( read_exact(ctx->fd, &hdr, sizeof(hdr)) )
+    {
+        PERROR("Failed to read PAGE_DATA header from stream");
+        goto err;
+    }
+
+    if ( hdr.count < 1 ||
+         rhdr->length < sizeof(hdr) + (hdr.count * sizeof(uint64_t)) )
+    {
+        ERROR("PAGE_DATA record (length %u) too short to contain %u"
+              " pfns worth of information", rhdr->length, hdr.count);
+        goto err;
+    }
+
+    pages = malloc(sizeof(*pages) + (hdr.count * sizeof(uint64_t)));
+    if ( !pages )
+    {
+        ERROR("Unable to allocate memory for %u pfns", hdr.count);
+        goto err;
+    }
+    *pages = hdr;
+
+    if ( read_exact(ctx->fd, &pages->pfn[0], hdr.count * sizeof(uint64_t)) )
+    {
+        PERROR("Failed to read PAGE_DATA pfn list from stream");
+        goto err;
+    }
+
+    rc = decode_page_data_header(ctx, rhdr->length, pages, &pfns, &types,
+                                 &pages_of_data);
+    if ( rc )
+        goto err;
+    rc = -1;
+
+    if ( rhdr->length != (sizeof(*pages) +
+                          (sizeof(uint64_t) * pages->count) +
+                          (PAGE_SIZE * pages_of_data)) )
+    {
+        ERROR("PAGE_DATA record wrong size: length %u, expected "
+              "%zu + %zu + %lu", rhdr->length, sizeof(*pages),
+              (sizeof(uint64_t) * pages->count), (PAGE_SIZE * pages_of_data));
+        goto err;
+    }
+
+    rc = process_page_data(ctx, pages->count, pfns, types, NULL);
+ err:
+    free(types);
+    free(pfns);
+    free(pages);
+
+    return rc;
+}
+
+/*
+ * Handle a PAGE_DATA_COMPRESSED record: identical layout to PAGE_DATA, but
+ * the page contents are a single zlib deflate stream which is inflated into
+ * a local buffer before taking the regular process_page_data() path.
+ */
+static int handle_page_data_compressed(struct xc_sr_context *ctx,
+                                       struct xc_sr_record *rec)
+{
+    xc_interface *xch = ctx->xch;
+    struct xc_sr_rec_page_data_header *pages = rec->data;
+    unsigned pages_of_data;
+    int rc = -1;
+
+    xen_pfn_t *pfns = NULL;
+    uint32_t *types = NULL;
+    void *data = NULL;
+    uLongf datasz;
+    size_t hdrsz;
+
+    if ( rec->length < sizeof(*pages) )
+    {
+        ERROR("PAGE_DATA_COMPRESSED record truncated: length %u, min %zu",
+              rec->length, sizeof(*pages));
+        goto err;
+    }
+
+    rc = decode_page_data_header(ctx, rec->length, pages, &pfns, &types,
+                                 &pages_of_data);
+    if ( rc )
+        goto err;
+    rc = -1;
+
+    hdrsz = sizeof(*pages) + (pages->count * sizeof(uint64_t));
+
+    if ( !pages_of_data || rec->length <= hdrsz )
+    {
+        ERROR("PAGE_DATA_COMPRESSED record (length %u) has no page data",
+              rec->length);
+        goto err;
+    }
+
+    datasz = pages_of_data * PAGE_SIZE;
+    data = malloc(datasz);
+    if ( !data )
+    {
+        ERROR("Unable to allocate %lu bytes for decompressed page data",
+              (unsigned long)datasz);
+        goto err;
+    }
+
+    if ( uncompress(data, &datasz, (void *)&pages->pfn[pages->count],
+                    rec->length - hdrsz) != Z_OK ||
+         datasz != pages_of_data * PAGE_SIZE )
+    {
+        ERROR("Failed to inflate %zu bytes of compressed page data",
+              rec->length - hdrsz);
+        goto err;
+    }
+
+    rc = process_page_data(ctx, pages->count, pfns, types, data);
+ err:
+    free(data);
+    free(types);
+    free(pfns);
+
+    return rc;
+}
+
 /*
  * Send checkpoint dirty pfn list to primary.
  */
@@ -640,6 +935,10 @@ static int process_record(struct xc_sr_context *ctx, struct xc_sr_record *rec)
         rc = handle_page_data(ctx, rec);
         break;
 
+    case REC_TYPE_PAGE_DATA_COMPRESSED:
+        rc = handle_page_data_compressed(ctx, rec);
+        break;
+
     case REC_TYPE_VERIFY:
         DPRINTF("Verify mode enabled");
         ctx->restore.verify = true;
@@ -744,7 +1043,39 @@ static int restore(struct xc_sr_context *ctx)
 
     do
     {
-        rc = read_record(ctx, ctx->fd, &rec);
+        struct xc_sr_rhdr rhdr;
+
+        rc = read_record_header(ctx, ctx->fd, &rhdr);
+        if ( rc )
+        {
+            if ( ctx->restore.buffer_all_records )
+                goto remus_failover;
+            else
+                goto err;
+        }
+
+        /*
+         * In the common case, stream page data straight into the guest
+         * mapping rather than through an intermediate buffer.  Verify mode
+         * needs the buffered copy to compare against, and buffered records
+         * (checkpointed streams) are replayed from memory later.
+         */
+        if ( rhdr.type == REC_TYPE_PAGE_DATA &&
+             !ctx->restore.buffer_all_records &&
+             !ctx->restore.verify )
+        {
+            rec.type = rhdr.type;
+            rec.length = rhdr.length;
+            rec.data = NULL;
+
+            rc = handle_page_data_direct(ctx, &rhdr);
+            if ( rc )
+                goto err;
+
+            continue;
+        }
+
+        rc = read_record_data(ctx, ctx->fd, &rhdr, &rec);
         if ( rc )
         {
             if ( ctx->restore.buffer_all_records )
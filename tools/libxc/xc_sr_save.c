@@ -1,8 +1,59 @@
 #include <assert.h>
 #include <arpa/inet.h>
+#include <pthread.h>
+#include <zlib.h>
 
 #include "xc_sr_common.h"
 
+/*
+ * Maximum number of entries to ask XEN_DOMCTL_SHADOW_OP_CLEAN_LIST for.
+ * Matches the hypervisor's own list size; a precopy iteration dirtying
+ * more than this falls back to a full bitmap copy anyway.
+ */
+#define DIRTY_LIST_ENTRIES (256U * 1024)
+
+/*
+ * Number of prepared page batches which may be queued for the writer thread.
+ * Each batch pins up to MAX_BATCH_SIZE mapped guest pages (4MB), so this
+ * bounds both memory usage and how far the mapper may run ahead of the wire.
+ */
+#define MAX_PIPELINE_BATCHES 4
+
+/* A fully prepared PAGE_DATA record, awaiting writev() to the stream. */
+struct xc_sr_save_batch
+{
+    struct xc_sr_record rec;
+    struct xc_sr_rec_page_data_header hdr;
+    uint64_t *rec_pfns;
+    struct iovec *iov;
+    int iovcnt;
+    void *guest_mapping;
+    unsigned nr_pages_mapped;
+    void **local_pages;
+    unsigned nr_pfns;
+    void *comp_data;
+};
+
+/*
+ * Writer thread state.  The main thread prepares batches (type lookup,
+ * foreign mapping, page normalisation) and enqueues them onto a small ring;
+ * the writer thread performs the writev() and releases each batch.  This
+ * overlaps the hypercall/mapping cost of the next batch with the stream I/O
+ * of the previous one.
+ */
+struct xc_sr_save_writer
+{
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t data_cond, space_cond;
+    struct xc_sr_save_batch *ring[MAX_PIPELINE_BATCHES];
+    unsigned int prod, cons;
+    bool stopping;
+    int rc;              /* First error seen by the writer thread. */
+    int saved_errno;
+    struct xc_sr_context *ctx;
+};
+
 /*
  * Writes an Image header and Domain header into the stream.
  */
@@ -66,37 +117,300 @@ static int write_checkpoint_record(struct xc_sr_context *ctx)
     return write_record(ctx, &checkpoint);
 }
 
+/* Release all resources held by a prepared batch. */
+static void free_batch(struct xc_sr_context *ctx,
+                       struct xc_sr_save_batch *batch)
+{
+    unsigned i;
+
+    if ( !batch )
+        return;
+
+    if ( batch->guest_mapping )
+        xenforeignmemory_unmap(ctx->xch->fmem, batch->guest_mapping,
+                               batch->nr_pages_mapped);
+    for ( i = 0; batch->local_pages && i < batch->nr_pfns; ++i )
+        free(batch->local_pages[i]);
+    free(batch->local_pages);
+    free(batch->rec_pfns);
+    free(batch->iov);
+    free(batch->comp_data);
+    free(batch);
+}
+
 /*
- * Writes a batch of memory as a PAGE_DATA record into the stream.  The batch
- * is constructed in ctx->save.batch_pfns.
+ * Try to shrink a prepared batch by deflating the page payload into a single
+ * buffer, rewriting it as a PAGE_DATA_COMPRESSED record.  Batches which do
+ * not shrink, or any zlib failure, leave the batch untouched to be sent
+ * uncompressed.
+ */
+static void compress_batch(struct xc_sr_context *ctx,
+                           struct xc_sr_save_batch *batch)
+{
+    static const char pad[(1U << REC_ALIGN_ORDER) - 1];
+    z_stream zs = { 0 };
+    size_t insz = 0, outsz;
+    int i, zrc;
+    void *buf;
+
+    for ( i = 4; i < batch->iovcnt; ++i )
+        insz += batch->iov[i].iov_len;
+
+    if ( !insz )
+        return;
+
+    /* Only worth doing if we save at least one alignment unit. */
+    outsz = insz - (1U << REC_ALIGN_ORDER);
+    buf = malloc(outsz);
+    if ( !buf )
+        return;
+
+    if ( deflateInit(&zs, Z_DEFAULT_COMPRESSION) != Z_OK )
+    {
+        free(buf);
+        return;
+    }
+
+    zs.next_out = buf;
+    zs.avail_out = outsz;
+
+    for ( i = 4, zrc = Z_OK; i < batch->iovcnt && zrc == Z_OK; ++i )
+    {
+        zs.next_in = batch->iov[i].iov_base;
+        zs.avail_in = batch->iov[i].iov_len;
+        zrc = deflate(&zs, i + 1 == batch->iovcnt ? Z_FINISH : Z_NO_FLUSH);
+    }
+
+    if ( zrc != Z_STREAM_END )
+    {
+        /* Ran out of output space - the data doesn't compress.  Send as-is. */
+        deflateEnd(&zs);
+        free(buf);
+        return;
+    }
+
+    batch->comp_data = buf;
+    batch->rec.type = REC_TYPE_PAGE_DATA_COMPRESSED;
+    batch->rec.length -= insz - zs.total_out;
+    batch->iov[4].iov_base = buf;
+    batch->iov[4].iov_len = zs.total_out;
+    batch->iovcnt = 5;
+
+    /* Re-align the stream; record lengths exclude trailing padding. */
+    if ( zs.total_out & ((1U << REC_ALIGN_ORDER) - 1) )
+    {
+        batch->iov[5].iov_base = (void *)pad;
+        batch->iov[5].iov_len = ROUNDUP(zs.total_out, REC_ALIGN_ORDER) -
+                                zs.total_out;
+        batch->iovcnt = 6;
+    }
+
+    deflateEnd(&zs);
+}
+
+static void *writer_thread(void *arg)
+{
+    struct xc_sr_save_writer *writer = arg;
+    struct xc_sr_context *ctx = writer->ctx;
+    struct xc_sr_save_batch *batch;
+    bool failed;
+
+    pthread_mutex_lock(&writer->mutex);
+    for ( ;; )
+    {
+        while ( writer->prod == writer->cons && !writer->stopping )
+            pthread_cond_wait(&writer->data_cond, &writer->mutex);
+
+        if ( writer->prod == writer->cons )
+            break;
+
+        batch = writer->ring[writer->cons % MAX_PIPELINE_BATCHES];
+        failed = writer->rc;
+        pthread_mutex_unlock(&writer->mutex);
+
+        if ( !failed && ctx->save.compress )
+            compress_batch(ctx, batch);
+
+        /* After a write error, just discard remaining batches. */
+        if ( !failed && writev_exact(ctx->fd, batch->iov, batch->iovcnt) )
+            failed = true;
+
+        pthread_mutex_lock(&writer->mutex);
+        if ( failed && !writer->rc )
+        {
+            writer->saved_errno = errno;
+            writer->rc = -1;
+        }
+        pthread_mutex_unlock(&writer->mutex);
+
+        free_batch(ctx, batch);
+
+        pthread_mutex_lock(&writer->mutex);
+        writer->cons++;
+        pthread_cond_signal(&writer->space_cond);
+    }
+    pthread_mutex_unlock(&writer->mutex);
+
+    return NULL;
+}
+
+
+/*
+ * Hand a prepared batch to the writer thread, blocking if the pipeline is
+ * full.  Writes inline when no writer thread is running.  Takes ownership
+ * of the batch in all cases.
+ */
+static int submit_batch(struct xc_sr_context *ctx,
+                        struct xc_sr_save_batch *batch)
+{
+    xc_interface *xch = ctx->xch;
+    struct xc_sr_save_writer *writer = ctx->save.writer;
+    int rc = 0;
+
+    if ( !writer )
+    {
+        if ( ctx->save.compress )
+            compress_batch(ctx, batch);
+        rc = writev_exact(ctx->fd, batch->iov, batch->iovcnt);
+        if ( rc )
+            PERROR("Failed to write page data to stream");
+        free_batch(ctx, batch);
+        return rc;
+    }
+
+    pthread_mutex_lock(&writer->mutex);
+    while ( writer->prod - writer->cons == MAX_PIPELINE_BATCHES &&
+            !writer->rc )
+        pthread_cond_wait(&writer->space_cond, &writer->mutex);
+
+    if ( writer->rc )
+    {
+        errno = writer->saved_errno;
+        rc = -1;
+    }
+    else
+    {
+        writer->ring[writer->prod++ % MAX_PIPELINE_BATCHES] = batch;
+        batch = NULL;
+        pthread_cond_signal(&writer->data_cond);
+    }
+    pthread_mutex_unlock(&writer->mutex);
+
+    if ( rc )
+    {
+        PERROR("Failed to write page data to stream");
+        free_batch(ctx, batch);
+    }
+
+    return rc;
+}
+
+/*
+ * Wait for all queued batches to reach the stream.  Must be called before
+ * any other record is written, to preserve stream ordering.
+ */
+static int drain_batches(struct xc_sr_context *ctx)
+{
+    xc_interface *xch = ctx->xch;
+    struct xc_sr_save_writer *writer = ctx->save.writer;
+    int rc = 0;
+
+    if ( !writer )
+        return 0;
+
+    pthread_mutex_lock(&writer->mutex);
+    while ( writer->prod != writer->cons )
+        pthread_cond_wait(&writer->space_cond, &writer->mutex);
+
+    if ( writer->rc )
+    {
+        errno = writer->saved_errno;
+        rc = -1;
+    }
+    pthread_mutex_unlock(&writer->mutex);
+
+    if ( rc )
+        PERROR("Failed to write page data to stream");
+
+    return rc;
+}
+
+static int start_writer(struct xc_sr_context *ctx)
+{
+    xc_interface *xch = ctx->xch;
+    struct xc_sr_save_writer *writer = calloc(1, sizeof(*writer));
+
+    if ( !writer )
+    {
+        ERROR("Unable to allocate memory for writer thread state");
+        errno = ENOMEM;
+        return -1;
+    }
+
+    writer->ctx = ctx;
+    pthread_mutex_init(&writer->mutex, NULL);
+    pthread_cond_init(&writer->data_cond, NULL);
+    pthread_cond_init(&writer->space_cond, NULL);
+
+    if ( pthread_create(&writer->thread, NULL, writer_thread, writer) )
+    {
+        PERROR("Unable to start writer thread - writing pages inline");
+        pthread_cond_destroy(&writer->space_cond);
+        pthread_cond_destroy(&writer->data_cond);
+        pthread_mutex_destroy(&writer->mutex);
+        free(writer);
+        return 0;
+    }
+
+    ctx->save.writer = writer;
+    return 0;
+}
+
+static void stop_writer(struct xc_sr_context *ctx)
+{
+    struct xc_sr_save_writer *writer = ctx->save.writer;
+
+    if ( !writer )
+        return;
+
+    pthread_mutex_lock(&writer->mutex);
+    writer->stopping = true;
+    pthread_cond_signal(&writer->data_cond);
+    pthread_mutex_unlock(&writer->mutex);
+    pthread_join(writer->thread, NULL);
+
+    pthread_cond_destroy(&writer->space_cond);
+    pthread_cond_destroy(&writer->data_cond);
+    pthread_mutex_destroy(&writer->mutex);
+    free(writer);
+    ctx->save.writer = NULL;
+}
+
+/*
+ * Prepares a batch of memory as a PAGE_DATA record and hands it to the
+ * writer thread.  The batch is constructed in ctx->save.batch_pfns.
  *
  * This function:
  * - gets the types for each pfn in the batch.
  * - for each pfn with real data:
  *   - maps and attempts to localise the pages.
- * - construct and writes a PAGE_DATA record into the stream.
+ * - constructs a PAGE_DATA record and submits it to the writer thread.
  */
 static int write_batch(struct xc_sr_context *ctx)
 {
     xc_interface *xch = ctx->xch;
     xen_pfn_t *mfns = NULL, *types = NULL;
-    void *guest_mapping = NULL;
+    struct xc_sr_save_batch *batch = NULL;
     void **guest_data = NULL;
-    void **local_pages = NULL;
     int *errors = NULL, rc = -1;
-    unsigned i, p, nr_pages = 0, nr_pages_mapped = 0;
+    unsigned i, p, nr_pages = 0;
     unsigned nr_pfns = ctx->save.nr_batch_pfns;
     void *page, *orig_page;
-    uint64_t *rec_pfns = NULL;
-    struct iovec *iov = NULL; int iovcnt = 0;
-    struct xc_sr_rec_page_data_header hdr = { 0 };
-    struct xc_sr_record rec =
-    {
-        .type = REC_TYPE_PAGE_DATA,
-    };
 
     assert(nr_pfns != 0);
 
+    /* Everything the writer thread needs to put the record on the wire. */
+    batch = calloc(1, sizeof(*batch));
     /* Mfns of the batch pfns. */
     mfns = malloc(nr_pfns * sizeof(*mfns));
     /* Types of the batch pfns. */
@@ -105,12 +419,22 @@ static int write_batch(struct xc_sr_context *ctx)
     errors = malloc(nr_pfns * sizeof(*errors));
     /* Pointers to page data to send.  Mapped gfns or local allocations. */
     guest_data = calloc(nr_pfns, sizeof(*guest_data));
+
+    if ( !batch || !mfns || !types || !errors || !guest_data )
+    {
+        ERROR("Unable to allocate arrays for a batch of %u pages",
+              nr_pfns);
+        goto err;
+    }
+
+    batch->rec.type = REC_TYPE_PAGE_DATA;
+    batch->nr_pfns = nr_pfns;
     /* Pointers to locally allocated pages.  Need freeing. */
-    local_pages = calloc(nr_pfns, sizeof(*local_pages));
-    /* iovec[] for writev(). */
-    iov = malloc((nr_pfns + 4) * sizeof(*iov));
+    batch->local_pages = calloc(nr_pfns, sizeof(*batch->local_pages));
+    /* iovec[] for writev(), with room for compression and padding. */
+    batch->iov = malloc((nr_pfns + 5) * sizeof(*batch->iov));
 
-    if ( !mfns || !types || !errors || !guest_data || !local_pages || !iov )
+    if ( !batch->local_pages || !batch->iov )
     {
         ERROR("Unable to allocate arrays for a batch of %u pages",
               nr_pfns);
@@ -153,14 +477,14 @@ static int write_batch(struct xc_sr_context *ctx)
 
     if ( nr_pages > 0 )
     {
-        guest_mapping = xenforeignmemory_map(xch->fmem,
+        batch->guest_mapping = xenforeignmemory_map(xch->fmem,
             ctx->domid, PROT_READ, nr_pages, mfns, errors);
-        if ( !guest_mapping )
+        if ( !batch->guest_mapping )
         {
             PERROR("Failed to map guest pages");
             goto err;
         }
-        nr_pages_mapped = nr_pages;
+        batch->nr_pages_mapped = nr_pages;
 
         for ( i = 0, p = 0; i < nr_pfns; ++i )
         {
@@ -179,11 +503,11 @@ static int write_batch(struct xc_sr_context *ctx)
                 goto err;
             }
 
-            orig_page = page = guest_mapping + (p * PAGE_SIZE);
+            orig_page = page = batch->guest_mapping + (p * PAGE_SIZE);
             rc = ctx->save.ops.normalise_page(ctx, types[i], &page);
 
             if ( orig_page != page )
-                local_pages[i] = page;
+                batch->local_pages[i] = page;
 
             if ( rc )
             {
@@ -205,36 +529,37 @@ static int write_batch(struct xc_sr_context *ctx)
         }
     }
 
-    rec_pfns = malloc(nr_pfns * sizeof(*rec_pfns));
-    if ( !rec_pfns )
+    batch->rec_pfns = malloc(nr_pfns * sizeof(*batch->rec_pfns));
+    if ( !batch->rec_pfns )
     {
         ERROR("Unable to allocate %zu bytes of memory for page data pfn list",
-              nr_pfns * sizeof(*rec_pfns));
+              nr_pfns * sizeof(*batch->rec_pfns));
         goto err;
     }
 
-    hdr.count = nr_pfns;
+    batch->hdr.count = nr_pfns;
 
-    rec.length = sizeof(hdr);
-    rec.length += nr_pfns * sizeof(*rec_pfns);
-    rec.length += nr_pages * PAGE_SIZE;
+    batch->rec.length = sizeof(batch->hdr);
+    batch->rec.length += nr_pfns * sizeof(*batch->rec_pfns);
+    batch->rec.length += nr_pages * PAGE_SIZE;
 
     for ( i = 0; i < nr_pfns; ++i )
-        rec_pfns[i] = ((uint64_t)(types[i]) << 32) | ctx->save.batch_pfns[i];
+        batch->rec_pfns[i] = ((uint64_t)(types[i]) << 32) |
+                             ctx->save.batch_pfns[i];
 
-    iov[0].iov_base = &rec.type;
-    iov[0].iov_len = sizeof(rec.type);
+    batch->iov[0].iov_base = &batch->rec.type;
+    batch->iov[0].iov_len = sizeof(batch->rec.type);
 
-    iov[1].iov_base = &rec.length;
-    iov[1].iov_len = sizeof(rec.length);
+    batch->iov[1].iov_base = &batch->rec.length;
+    batch->iov[1].iov_len = sizeof(batch->rec.length);
 
-    iov[2].iov_base = &hdr;
-    iov[2].iov_len = sizeof(hdr);
+    batch->iov[2].iov_base = &batch->hdr;
+    batch->iov[2].iov_len = sizeof(batch->hdr);
 
-    iov[3].iov_base = rec_pfns;
-    iov[3].iov_len = nr_pfns * sizeof(*rec_pfns);
+    batch->iov[3].iov_base = batch->rec_pfns;
+    batch->iov[3].iov_len = nr_pfns * sizeof(*batch->rec_pfns);
 
-    iovcnt = 4;
+    batch->iovcnt = 4;
 
     if ( nr_pages )
     {
@@ -242,32 +567,27 @@ static int write_batch(struct xc_sr_context *ctx)
         {
             if ( guest_data[i] )
             {
-                iov[iovcnt].iov_base = guest_data[i];
-                iov[iovcnt].iov_len = PAGE_SIZE;
-                iovcnt++;
+                batch->iov[batch->iovcnt].iov_base = guest_data[i];
+                batch->iov[batch->iovcnt].iov_len = PAGE_SIZE;
+                batch->iovcnt++;
                 --nr_pages;
             }
         }
     }
 
-    if ( writev_exact(ctx->fd, iov, iovcnt) )
-    {
-        PERROR("Failed to write page data to stream");
+    /* Sanity check we are sending all the pages we expected to. */
+    assert(nr_pages == 0);
+
+    /* submit_batch() takes ownership, even on failure. */
+    rc = submit_batch(ctx, batch);
+    batch = NULL;
+    if ( rc )
         goto err;
-    }
 
-    /* Sanity check we have sent all the pages we expected to. */
-    assert(nr_pages == 0);
     rc = ctx->save.nr_batch_pfns = 0;
 
  err:
-    free(rec_pfns);
-    if ( guest_mapping )
-        xenforeignmemory_unmap(xch->fmem, guest_mapping, nr_pages_mapped);
-    for ( i = 0; local_pages && i < nr_pfns; ++i )
-        free(local_pages[i]);
-    free(iov);
-    free(local_pages);
+    free_batch(ctx, batch);
     free(guest_data);
     free(errors);
     free(types);
@@ -390,6 +710,11 @@ static int send_dirty_pages(struct xc_sr_context *ctx,
     if ( rc )
         return rc;
 
+    /* Callers may write further records; wait for the pipeline to empty. */
+    rc = drain_batches(ctx);
+    if ( rc )
+        return rc;
+
     if ( written > entries )
         DPRINTF("Bitmap contained more entries than expected...");
 
@@ -487,6 +812,81 @@ static int simple_precopy_policy(struct precopy_stats stats, void *user)
         : XGS_POLICY_CONTINUE_PRECOPY;
 }
 
+/*
+ * Interpret a decision from the precopy policy callback.  Postcopy is not
+ * yet implemented - the protocol has record types reserved for it - so a
+ * policy asking for it gets the next best thing: an immediate switch to
+ * stop-and-copy.
+ */
+static int interpret_policy_decision(struct xc_sr_context *ctx, int decision)
+{
+    xc_interface *xch = ctx->xch;
+
+    if ( decision == XGS_POLICY_POSTCOPY )
+    {
+        IPRINTF("Postcopy requested but not supported, "
+                "using stop-and-copy instead");
+        decision = XGS_POLICY_STOP_AND_COPY;
+    }
+
+    return decision;
+}
+
+/*
+ * Retrieve-and-clear the set of pages dirtied since the last iteration
+ * into dirty_bitmap.  Prefers XEN_DOMCTL_SHADOW_OP_CLEAN_LIST, whose cost
+ * scales with the number of dirty pages rather than with the size of the
+ * guest, falling back to a full XEN_DOMCTL_SHADOW_OP_CLEAN bitmap copy
+ * when the list is unavailable (older hypervisor, first call after
+ * enabling log dirty, or more dirty pages than the list can hold).
+ */
+static int clean_dirty_pages(struct xc_sr_context *ctx,
+                             xc_shadow_op_stats_t *stats)
+{
+    xc_interface *xch = ctx->xch;
+    DECLARE_HYPERCALL_BUFFER_SHADOW(unsigned long, dirty_bitmap,
+                                    &ctx->save.dirty_bitmap_hbuf);
+    DECLARE_HYPERCALL_BUFFER_SHADOW(uint64_t, dirty_list,
+                                    &ctx->save.dirty_list_hbuf);
+
+    if ( !ctx->save.dirty_list_unsupported )
+    {
+        long count = xc_shadow_control(
+            xch, ctx->domid, XEN_DOMCTL_SHADOW_OP_CLEAN_LIST,
+            &ctx->save.dirty_list_hbuf, DIRTY_LIST_ENTRIES, NULL, 0, stats);
+
+        if ( count >= 0 )
+        {
+            long i;
+
+            bitmap_clear(dirty_bitmap, ctx->save.p2m_size);
+            for ( i = 0; i < count; ++i )
+                if ( dirty_list[i] < ctx->save.p2m_size )
+                    set_bit(dirty_list[i], dirty_bitmap);
+
+            return 0;
+        }
+
+        if ( errno != ENODATA && errno != ENOBUFS )
+        {
+            /* Hypervisor doesn't know the op: don't bother asking again. */
+            ctx->save.dirty_list_unsupported = true;
+            DPRINTF("Dirty page list unsupported, using bitmap");
+        }
+    }
+
+    if ( xc_shadow_control(
+             xch, ctx->domid, XEN_DOMCTL_SHADOW_OP_CLEAN,
+             &ctx->save.dirty_bitmap_hbuf, ctx->save.p2m_size,
+             NULL, 0, stats) != ctx->save.p2m_size )
+    {
+        PERROR("Failed to retrieve logdirty bitmap");
+        return -1;
+    }
+
+    return 0;
+}
+
 /*
  * Send memory while guest is running.
  */
@@ -522,7 +922,8 @@ static int send_memory_live(struct xc_sr_context *ctx)
 
     for ( ; ; )
     {
-        policy_decision = precopy_policy(*policy_stats, data);
+        policy_decision =
+            interpret_policy_decision(ctx, precopy_policy(*policy_stats, data));
         x++;
 
         if ( stats.dirty_count > 0 && policy_decision != XGS_POLICY_ABORT )
@@ -543,20 +944,15 @@ static int send_memory_live(struct xc_sr_context *ctx)
         policy_stats->total_written += policy_stats->dirty_count;
         policy_stats->dirty_count   = -1;
 
-        policy_decision = precopy_policy(*policy_stats, data);
+        policy_decision =
+            interpret_policy_decision(ctx, precopy_policy(*policy_stats, data));
 
         if ( policy_decision != XGS_POLICY_CONTINUE_PRECOPY )
            break;
 
-        if ( xc_shadow_control(
-                 xch, ctx->domid, XEN_DOMCTL_SHADOW_OP_CLEAN,
-                 &ctx->save.dirty_bitmap_hbuf, ctx->save.p2m_size,
-                 NULL, 0, &stats) != ctx->save.p2m_size )
-        {
-            PERROR("Failed to retrieve logdirty bitmap");
-            rc = -1;
+        rc = clean_dirty_pages(ctx, &stats);
+        if ( rc )
             goto out;
-        }
 
         policy_stats->dirty_count = stats.dirty_count;
 
@@ -789,6 +1185,8 @@ static int setup(struct xc_sr_context *ctx)
     int rc;
     DECLARE_HYPERCALL_BUFFER_SHADOW(unsigned long, dirty_bitmap,
                                     &ctx->save.dirty_bitmap_hbuf);
+    DECLARE_HYPERCALL_BUFFER_SHADOW(uint64_t, dirty_list,
+                                    &ctx->save.dirty_list_hbuf);
 
     rc = ctx->save.ops.setup(ctx);
     if ( rc )
@@ -796,11 +1194,15 @@ static int setup(struct xc_sr_context *ctx)
 
     dirty_bitmap = xc_hypercall_buffer_alloc_pages(
                    xch, dirty_bitmap, NRPAGES(bitmap_size(ctx->save.p2m_size)));
+    dirty_list = xc_hypercall_buffer_alloc_pages(
+                 xch, dirty_list,
+                 NRPAGES(DIRTY_LIST_ENTRIES * sizeof(*dirty_list)));
     ctx->save.batch_pfns = malloc(MAX_BATCH_SIZE *
                                   sizeof(*ctx->save.batch_pfns));
     ctx->save.deferred_pages = calloc(1, bitmap_size(ctx->save.p2m_size));
 
-    if ( !ctx->save.batch_pfns || !dirty_bitmap || !ctx->save.deferred_pages )
+    if ( !ctx->save.batch_pfns || !dirty_bitmap || !dirty_list ||
+         !ctx->save.deferred_pages )
     {
         ERROR("Unable to allocate memory for dirty bitmaps, batch pfns and"
               " deferred pages");
@@ -809,7 +1211,7 @@ static int setup(struct xc_sr_context *ctx)
         goto err;
     }
 
-    rc = 0;
+    rc = start_writer(ctx);
 
  err:
     return rc;
@@ -820,7 +1222,10 @@ static void cleanup(struct xc_sr_context *ctx)
     xc_interface *xch = ctx->xch;
     DECLARE_HYPERCALL_BUFFER_SHADOW(unsigned long, dirty_bitmap,
                                     &ctx->save.dirty_bitmap_hbuf);
+    DECLARE_HYPERCALL_BUFFER_SHADOW(uint64_t, dirty_list,
+                                    &ctx->save.dirty_list_hbuf);
 
+    stop_writer(ctx);
 
     xc_shadow_control(xch, ctx->domid, XEN_DOMCTL_SHADOW_OP_OFF,
                       NULL, 0, NULL, 0, NULL);
@@ -830,6 +1235,9 @@ static void cleanup(struct xc_sr_context *ctx)
 
     xc_hypercall_buffer_free_pages(xch, dirty_bitmap,
                                    NRPAGES(bitmap_size(ctx->save.p2m_size)));
+    xc_hypercall_buffer_free_pages(xch, dirty_list,
+                                   NRPAGES(DIRTY_LIST_ENTRIES *
+                                           sizeof(*dirty_list)));
     free(ctx->save.deferred_pages);
     free(ctx->save.batch_pfns);
 }
@@ -979,6 +1387,7 @@ int xc_domain_save(xc_interface *xch, int io_fd, uint32_t dom,
     ctx.save.callbacks = callbacks;
     ctx.save.live  = !!(flags & XCFLAGS_LIVE);
     ctx.save.debug = !!(flags & XCFLAGS_DEBUG);
+    ctx.save.compress = !!(flags & XCFLAGS_COMPRESS);
     ctx.save.checkpointed = stream_type;
     ctx.save.recv_fd = recv_fd;
 
@@ -0,0 +1,133 @@
+#ifndef __SNAPSHOT_FORMAT__H
+#define __SNAPSHOT_FORMAT__H
+
+/*
+ * C structures for the local snapshot container format, version 1.
+ *
+ * A container stores a base image of a domain plus a chain of incremental
+ * epochs, each produced from one checkpoint of a non-live (checkpointed)
+ * migration v2 stream.  It is designed for fast repeated snapshots of large
+ * guests to local storage:
+ *
+ *  - Every section starts on a (1 << align_shift) boundary (at least the
+ *    guest page size), so the file can be written with O_DIRECT and
+ *    asynchronous aligned I/O, and page data can be read back with zero
+ *    re-buffering.
+ *
+ *  - Page contents live in fixed-size slots addressed by absolute slot
+ *    number.  Index entries may reference slots written by any earlier
+ *    epoch, so unchanged pages are never rewritten, and a per-slot SHA-256
+ *    digest table lets the writer (or an offline pass) coalesce identical
+ *    pages without reading them back.
+ *
+ *  - All non-page state (vcpu context, HVM params, ...) is stored verbatim
+ *    as migration v2 records (see xc_sr_stream_format.h) in each epoch's
+ *    records section; the container adds no second encoding for it.
+ *
+ * File layout:
+ *
+ *   +------------------+ 0
+ *   | superblock       |  one alignment unit
+ *   +------------------+
+ *   | epoch N:         |
+ *   |   page data      |  nr_slots * page size
+ *   |   digest table   |  nr_slots * 32 octets
+ *   |   pfn index      |  nr_index * 16 octets, sorted by pfn
+ *   |   v2 records     |  raw migration v2 records, END terminated
+ *   |   epoch header   |  one alignment unit
+ *   +------------------+
+ *   | epoch N+1: ...   |
+ *
+ * An epoch is written data-first and sealed by its header; the
+ * superblock's latest_epoch field is updated (and flushed) last.  A torn
+ * final epoch is therefore invisible, and the previous epoch remains the
+ * restore point.
+ *
+ * To reconstruct the domain at epoch E: walk the epoch chain from E
+ * backwards via prev_epoch, taking for each pfn the entry from the newest
+ * index which contains it, then replay E's records section.  Slots never
+ * move once written, so the walk only reads index sections.
+ */
+
+#include <inttypes.h>
+
+/* "xen-snap" */
+#define SNAP_MAGIC   0x70616e732d6e6578ULL
+#define SNAP_VERSION 1
+
+struct xc_sr_snap_superblock
+{
+    uint64_t magic;
+    uint32_t version;
+    uint32_t page_shift;
+    /* log2 of the section alignment.  No less than page_shift. */
+    uint32_t align_shift;
+    /* DHDR_TYPE_* of the saved domain. */
+    uint32_t guest_type;
+    /* Offset of the newest sealed epoch header.  0 if no epoch completed. */
+    uint64_t latest_epoch;
+    uint64_t nr_epochs;
+    /* Toolstack-chosen identity of this snapshot chain. */
+    uint8_t uuid[16];
+    uint64_t _res[4];
+};
+
+#define SNAP_EPOCH_MARKER 0xffffffff70616e73ULL
+
+struct xc_sr_snap_epoch_hdr
+{
+    uint64_t marker;
+    /* 0 for the base image, incremented by 1 for each further epoch. */
+    uint64_t seq;
+    /* Offset of the previous epoch's header.  0 for the base image. */
+    uint64_t prev_epoch;
+    /* CLOCK_REALTIME in nanoseconds at the point the domain was suspended. */
+    uint64_t timestamp_ns;
+    /* Page data section written by this epoch. */
+    uint64_t data_off;
+    uint64_t nr_slots;
+    /* SHA-256 digest table; one entry per slot, same order. */
+    uint64_t digest_off;
+    /* Index of the pfns written by this epoch, sorted ascending. */
+    uint64_t index_off;
+    uint64_t nr_index;
+    /* Migration v2 records for the non-page state of this epoch. */
+    uint64_t records_off;
+    uint64_t records_len;
+    /* CRC32c over this header, computed with csum set to 0. */
+    uint32_t csum;
+    uint32_t _res1;
+};
+
+struct xc_sr_snap_index_entry
+{
+    /* Same encoding as the PAGE_DATA pfn array: PAGE_DATA_PFN_MASK and
+     * PAGE_DATA_TYPE_MASK apply.  Pfns without backing data (e.g. ballooned
+     * pages) have no slot and must set slot to SNAP_SLOT_INVALID. */
+    uint64_t pfn;
+    /*
+     * Absolute page slot holding the contents.  Slot s of an epoch with
+     * data_off d lives at file offset d + s_rel * page size, where s_rel
+     * is s minus the sum of nr_slots of all earlier epochs.  May reference
+     * any epoch at or before the indexing one.
+     */
+    uint64_t slot;
+};
+
+#define SNAP_SLOT_INVALID (~0ULL)
+
+struct xc_sr_snap_digest
+{
+    uint8_t sha256[32];
+};
+
+#endif
+/*
+ * Local variables:
+ * mode: C
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
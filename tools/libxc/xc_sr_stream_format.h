@@ -4,6 +4,9 @@
 /*
  * C structures for the Migration v2 stream format.
  * See docs/specs/libxc-migration-stream.pandoc
+ *
+ * For the local snapshot container built from checkpointed streams see
+ * xc_sr_snapshot_format.h.
  */
 
 #include <inttypes.h>
@@ -76,6 +79,13 @@ struct xc_sr_rhdr
 #define REC_TYPE_VERIFY                     0x0000000dU
 #define REC_TYPE_CHECKPOINT                 0x0000000eU
 #define REC_TYPE_CHECKPOINT_DIRTY_PFN_LIST  0x0000000fU
+#define REC_TYPE_PAGE_DATA_COMPRESSED       0x00000010U
+
+/*
+ * 0x00000011 - 0x00000014 are reserved for postcopy live migration
+ * (POSTCOPY_BEGIN, POSTCOPY_PFNS, POSTCOPY_PAGE_DATA, POSTCOPY_COMPLETE),
+ * which is not yet implemented.
+ */
 
 #define REC_TYPE_OPTIONAL             0x80000000U
 
@@ -90,6 +100,15 @@ struct xc_sr_rec_page_data_header
 #define PAGE_DATA_PFN_MASK  0x000fffffffffffffULL
 #define PAGE_DATA_TYPE_MASK 0xf000000000000000ULL
 
+/*
+ * PAGE_DATA_COMPRESSED
+ *
+ * Identical header and pfn layout to PAGE_DATA, but the page contents which
+ * follow the pfn array are a single zlib (RFC 1950) deflate stream of the
+ * concatenated pages.  Senders must fall back to PAGE_DATA for batches which
+ * do not shrink under compression.
+ */
+
 /* X86_PV_INFO */
 struct xc_sr_rec_x86_pv_info
 {
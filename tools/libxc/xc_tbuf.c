@@ -170,3 +170,34 @@ int xc_tbuf_set_evt_mask(xc_interface *xch, uint32_t mask)
     return do_sysctl(xch, &sysctl);
 }
 
+int xc_tbuf_set_mute_mask(xc_interface *xch, uint32_t mask)
+{
+    DECLARE_SYSCTL;
+
+    sysctl.cmd = XEN_SYSCTL_tbuf_op;
+    sysctl.interface_version = XEN_SYSCTL_INTERFACE_VERSION;
+    sysctl.u.tbuf_op.cmd  = XEN_SYSCTL_TBUFOP_set_mute_mask;
+    sysctl.u.tbuf_op.evt_mask = mask;
+
+    return do_sysctl(xch, &sysctl);
+}
+
+int xc_tbuf_get_drops(xc_interface *xch, uint64_t *lost, uint64_t *muted)
+{
+    int rc;
+    DECLARE_SYSCTL;
+
+    sysctl.cmd = XEN_SYSCTL_tbuf_op;
+    sysctl.interface_version = XEN_SYSCTL_INTERFACE_VERSION;
+    sysctl.u.tbuf_op.cmd  = XEN_SYSCTL_TBUFOP_get_drops;
+
+    rc = do_sysctl(xch, &sysctl);
+    if ( rc == 0 )
+    {
+        *lost = sysctl.u.tbuf_op.lost_records;
+        *muted = sysctl.u.tbuf_op.muted_records;
+    }
+
+    return rc;
+}
+
@@ -32,6 +32,7 @@ int xc_vm_event_control(xc_interface *xch, uint32_t domain_id, unsigned int op,
     domctl.domain = domain_id;
     domctl.u.vm_event_op.op = op;
     domctl.u.vm_event_op.mode = mode;
+    domctl.u.vm_event_op.ring_order = 0;
 
     rc = do_domctl(xch, &domctl);
     if ( !rc && port )
@@ -40,12 +41,14 @@ int xc_vm_event_control(xc_interface *xch, uint32_t domain_id, unsigned int op,
 }
 
 void *xc_vm_event_enable(xc_interface *xch, uint32_t domain_id, int param,
-                         uint32_t *port)
+                         uint32_t *port, unsigned int ring_order)
 {
+    DECLARE_DOMCTL;
     void *ring_page = NULL;
     uint64_t pfn;
-    xen_pfn_t ring_pfn, mmap_pfn;
-    unsigned int op, mode;
+    xen_pfn_t *ring_pfns = NULL;
+    unsigned long nr_pages = 1UL << ring_order;
+    unsigned int i, op, mode;
     int rc1, rc2, saved_errno;
 
     if ( !port )
@@ -62,7 +65,8 @@ void *xc_vm_event_enable(xc_interface *xch, uint32_t domain_id, int param,
         return NULL;
     }
 
-    /* Get the pfn of the ring page */
+    /* Get the pfn of the first ring page; the ring occupies nr_pages
+     * contiguous pfns starting there. */
     rc1 = xc_hvm_param_get(xch, domain_id, param, &pfn);
     if ( rc1 != 0 )
     {
@@ -70,27 +74,38 @@ void *xc_vm_event_enable(xc_interface *xch, uint32_t domain_id, int param,
         goto out;
     }
 
-    ring_pfn = pfn;
-    mmap_pfn = pfn;
-    rc1 = xc_get_pfn_type_batch(xch, domain_id, 1, &mmap_pfn);
-    if ( rc1 || mmap_pfn & XEN_DOMCTL_PFINFO_XTAB )
+    ring_pfns = calloc(nr_pages, sizeof(*ring_pfns));
+    if ( !ring_pfns )
+    {
+        errno = ENOMEM;
+        rc1 = -1;
+        goto out;
+    }
+
+    for ( i = 0; i < nr_pages; i++ )
     {
-        /* Page not in the physmap, try to populate it */
-        rc1 = xc_domain_populate_physmap_exact(xch, domain_id, 1, 0, 0,
-                                              &ring_pfn);
-        if ( rc1 != 0 )
+        xen_pfn_t mmap_pfn = pfn + i;
+
+        ring_pfns[i] = pfn + i;
+        rc1 = xc_get_pfn_type_batch(xch, domain_id, 1, &mmap_pfn);
+        if ( rc1 || mmap_pfn & XEN_DOMCTL_PFINFO_XTAB )
         {
-            PERROR("Failed to populate ring pfn\n");
-            goto out;
+            /* Page not in the physmap, try to populate it */
+            rc1 = xc_domain_populate_physmap_exact(xch, domain_id, 1, 0, 0,
+                                                   &ring_pfns[i]);
+            if ( rc1 != 0 )
+            {
+                PERROR("Failed to populate ring pfn\n");
+                goto out;
+            }
         }
     }
 
-    mmap_pfn = ring_pfn;
     ring_page = xc_map_foreign_pages(xch, domain_id, PROT_READ | PROT_WRITE,
-                                         &mmap_pfn, 1);
+                                     ring_pfns, nr_pages);
     if ( !ring_page )
     {
-        PERROR("Could not map the ring page\n");
+        PERROR("Could not map the ring page(s)\n");
         goto out;
     }
 
@@ -121,17 +136,25 @@ void *xc_vm_event_enable(xc_interface *xch, uint32_t domain_id, int param,
         goto out;
     }
 
-    rc1 = xc_vm_event_control(xch, domain_id, op, mode, port);
+    domctl.cmd = XEN_DOMCTL_vm_event_op;
+    domctl.domain = domain_id;
+    domctl.u.vm_event_op.op = op;
+    domctl.u.vm_event_op.mode = mode;
+    domctl.u.vm_event_op.ring_order = ring_order;
+
+    rc1 = do_domctl(xch, &domctl);
     if ( rc1 != 0 )
     {
         PERROR("Failed to enable vm_event\n");
         goto out;
     }
+    *port = domctl.u.vm_event_op.port;
 
-    /* Remove the ring_pfn from the guest's physmap */
-    rc1 = xc_domain_decrease_reservation_exact(xch, domain_id, 1, 0, &ring_pfn);
+    /* Remove the ring pfns from the guest's physmap */
+    rc1 = xc_domain_decrease_reservation_exact(xch, domain_id, nr_pages, 0,
+                                               ring_pfns);
     if ( rc1 != 0 )
-        PERROR("Failed to remove ring page from guest physmap");
+        PERROR("Failed to remove ring page(s) from guest physmap");
 
  out:
     saved_errno = errno;
@@ -147,12 +170,13 @@ void *xc_vm_event_enable(xc_interface *xch, uint32_t domain_id, int param,
         }
 
         if ( ring_page )
-            xenforeignmemory_unmap(xch->fmem, ring_page, 1);
+            xenforeignmemory_unmap(xch->fmem, ring_page, nr_pages);
         ring_page = NULL;
 
         errno = saved_errno;
     }
 
+    free(ring_pfns);
     return ring_page;
 }
 
@@ -66,6 +66,8 @@ int libxl_ctx_alloc(libxl_ctx **pctx, int version,
     LIBXL_TAILQ_INIT(&ctx->death_list);
     libxl__ev_xswatch_init(&ctx->death_watch);
 
+    LIBXL_LIST_INIT(&ctx->domain_config_cache);
+
     ctx->childproc_hooks = &libxl__childproc_default_hooks;
     ctx->childproc_user = 0;
 
@@ -186,6 +188,8 @@ int libxl_ctx_free(libxl_ctx *ctx)
 
     free(ctx->watch_slots);
 
+    libxl__domain_config_cache_dispose(ctx);
+
     discard_events(&ctx->occurred);
 
     /* If we have outstanding children, then the application inherits
@@ -102,6 +102,16 @@
  */
 #define LIBXL_HAVE_VNUMA 1
 
+/* LIBXL_HAVE_NUMA_PLACEMENT_POLICY
+ *
+ * If this is defined, libxl_domain_build_info has a field
+ * 'numa_placement_policy' selecting how automatic NUMA placement
+ * distributes the domain: the traditional best-fit candidate search,
+ * or striping across a node set with a matching auto-generated vNUMA
+ * topology.
+ */
+#define LIBXL_HAVE_NUMA_PLACEMENT_POLICY 1
+
 /* LIBXL_HAVE_USERDATA_UNLINK
  *
  * If it is defined, libxl has a library function called
@@ -278,6 +288,13 @@
  */
 #define LIBXL_HAVE_BUILDINFO_ARCH_ARM_TEE 1
 
+/*
+ * LIBXL_HAVE_DOMAINS_DESTROY indicates that libxl supports destroying
+ * a batch of domains through a single asynchronous operation, via
+ * libxl_domains_destroy().
+ */
+#define LIBXL_HAVE_DOMAINS_DESTROY 1
+
 /*
  * LIBXL_HAVE_SOFT_RESET indicates that libxl supports performing
  * 'soft reset' for domains and there is 'soft_reset' shutdown reason
@@ -1518,6 +1535,7 @@ int libxl_domain_suspend(libxl_ctx *ctx, uint32_t domid, int fd,
                          LIBXL_EXTERNAL_CALLERS_ONLY;
 #define LIBXL_SUSPEND_DEBUG 1
 #define LIBXL_SUSPEND_LIVE 2
+#define LIBXL_SUSPEND_COMPRESS 4
 
 /*
  * Only suspend domain, do not save its state to file, do not destroy it.
@@ -1550,6 +1568,16 @@ int libxl_domain_reboot(libxl_ctx *ctx, uint32_t domid);
 int libxl_domain_destroy(libxl_ctx *ctx, uint32_t domid,
                          const libxl_asyncop_how *ao_how)
                          LIBXL_EXTERNAL_CALLERS_ONLY;
+/* Destroy a batch of domains in parallel within a single operation.
+ * The individual destructions proceed concurrently over the libxl
+ * event loop; the operation completes when all of them have finished.
+ * Returns 0 only if every domain was destroyed; otherwise the error
+ * from the first failed destruction (the others are still attempted).
+ */
+int libxl_domains_destroy(libxl_ctx *ctx, const uint32_t *domids,
+                          unsigned int nr_domids,
+                          const libxl_asyncop_how *ao_how)
+                          LIBXL_EXTERNAL_CALLERS_ONLY;
 int libxl_domain_preserve(libxl_ctx *ctx, uint32_t domid, libxl_domain_create_info *info, const char *name_suffix, libxl_uuid new_uuid);
 
 /* get max. number of cpus supported by hypervisor */
@@ -1576,6 +1604,13 @@ int libxl_domain_rename(libxl_ctx *ctx, uint32_t domid,
 int libxl_domain_pause(libxl_ctx *ctx, uint32_t domid);
 int libxl_domain_unpause(libxl_ctx *ctx, uint32_t domid);
 
+/*
+ * Tell the hypervisor's idle governor the worst wakeup latency (in
+ * microseconds) the domain can tolerate; 0 removes the hint.
+ */
+int libxl_domain_set_wakeup_latency(libxl_ctx *ctx, uint32_t domid,
+                                    uint32_t latency_us);
+
 int libxl_domain_core_dump(libxl_ctx *ctx, uint32_t domid,
                            const char *filename,
                            const libxl_asyncop_how *ao_how)
@@ -94,6 +94,15 @@ int libxl__domain_build_info_setdefault(libxl__gc *gc,
             } else {
                 b_info->device_model_version = libxl__default_device_model(gc);
             }
+        } else if (b_info->type == LIBXL_DOMAIN_TYPE_PVH) {
+            /*
+             * PVH guests boot directly via the PVH entry point and need
+             * no emulation; default to no device model at all so domain
+             * creation does not pay for probing and accounting for one.
+             * Guests which want a xenpv qemu for their backends must
+             * request a device model version explicitly.
+             */
+            b_info->device_model_version = LIBXL_DEVICE_MODEL_VERSION_NONE;
         } else {
             b_info->device_model_version =
                 LIBXL_DEVICE_MODEL_VERSION_QEMU_XEN;
@@ -119,6 +128,12 @@ int libxl__domain_build_info_setdefault(libxl__gc *gc,
         }
     }
 
+    if (b_info->type == LIBXL_DOMAIN_TYPE_HVM &&
+        b_info->device_model_version == LIBXL_DEVICE_MODEL_VERSION_NONE) {
+        LOG(ERROR, "HVM guests require a device model");
+        return ERROR_INVAL;
+    }
+
     if (b_info->blkdev_start == NULL)
         b_info->blkdev_start = libxl__strdup(NOGC, "xvda");
 
@@ -583,6 +598,12 @@ int libxl__domain_make(libxl__gc *gc, libxl_domain_config *d_config,
         rc = libxl__arch_domain_save_config(gc, d_config, state, &create);
         if (rc < 0)
             goto out;
+
+        /* Best effort: on-demand growth remains available either way. */
+        if (b_info->grant_prealloc_frames &&
+            xc_gnttab_pregrow(ctx->xch, *domid,
+                              b_info->grant_prealloc_frames) < 0)
+            LOGED(WARN, *domid, "grant table pre-growth failed");
     }
 
     ret = xc_cpupool_movedomain(ctx->xch, info->poolid, *domid);
@@ -754,8 +775,17 @@ static int store_libxl_entry(libxl__gc *gc, uint32_t domid,
                              libxl_domain_build_info *b_info)
 {
     char *path = NULL;
+    int rc;
 
     path = libxl__xs_libxl_path(gc, domid);
+
+    if (b_info->storage_mirror_hook) {
+        rc = libxl__xs_printf(gc, XBT_NULL,
+                              GCSPRINTF("%s/storage-mirror-hook", path),
+                              "%s", b_info->storage_mirror_hook);
+        if (rc) return rc;
+    }
+
     path = GCSPRINTF("%s/dm-version", path);
     return libxl__xs_printf(gc, XBT_NULL, path, "%s",
                             libxl_device_model_version_to_string(b_info->device_model_version));
@@ -1463,6 +1493,14 @@ static void domcreate_launch_dm(libxl__egc *egc, libxl__multidev *multidev,
         ret = libxl__need_xenpv_qemu(gc, d_config);
         if (ret < 0)
             goto error_out;
+        if (ret && d_config->b_info.device_model_version ==
+                   LIBXL_DEVICE_MODEL_VERSION_NONE) {
+            LOGD(ERROR, domid,
+                 "configuration requires a device model, but "
+                 "device_model_version is \"none\"");
+            ret = ERROR_INVAL;
+            goto error_out;
+        }
         if (ret) {
             dcs->sdss.dm.guest_domid = domid;
             libxl__spawn_local_dm(egc, &dcs->sdss.dm);
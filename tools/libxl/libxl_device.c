@@ -1999,6 +1999,137 @@ out:
     return;
 }
 
+/*
+ * Batched xenstore setup for several devices of one type.
+ *
+ * libxl__device_add_async() pays a full xenstore transaction per
+ * device, so a guest with many disks and NICs spends most of its
+ * creation in transaction round trips.  Here the frontend/backend/
+ * libxl nodes of every device are written inside a single transaction,
+ * after which the usual asynchronous connection wait (and hotplug
+ * script execution) proceeds concurrently per device via multidev.
+ *
+ * Only used on paths which do not update the stored configuration:
+ * domain creation stores the complete configuration once at the end.
+ */
+void libxl__devices_add_async(libxl__egc *egc, uint32_t domid,
+                              const struct libxl_device_type *dt,
+                              void *types, int num,
+                              libxl__multidev *multidev)
+{
+    STATE_AO_GC(multidev->ao);
+    struct {
+        libxl__ao_device *aodev;
+        libxl__device *device;
+        char **bents, **fents, **ro_fents;
+    } *prep;
+    xs_transaction_t t = XBT_NULL;
+    int i, rc;
+
+    if (!num)
+        return;
+
+    GCNEW_ARRAY(prep, num);
+
+    for (i = 0; i < num; i++) {
+        void *type = (uint8_t *)types + i * dt->dev_elem_size;
+        flexarray_t *back, *front, *ro_front;
+        libxl__ao_device *aodev = libxl__multidev_prepare(multidev);
+
+        prep[i].aodev = aodev;
+        assert(!aodev->update_json);
+
+        if (dt->set_default) {
+            rc = dt->set_default(gc, domid, type, false);
+            if (rc) goto fail_one;
+        }
+
+        if (dt->update_devid) {
+            rc = dt->update_devid(gc, domid, type);
+            if (rc) goto fail_one;
+        }
+
+        GCNEW(prep[i].device);
+        rc = dt->to_device(gc, domid, type, prep[i].device);
+        if (rc) goto fail_one;
+
+        back = flexarray_make(gc, 16, 1);
+        front = flexarray_make(gc, 16, 1);
+        ro_front = flexarray_make(gc, 16, 1);
+
+        flexarray_append_pair(back, "frontend-id", GCSPRINTF("%d", domid));
+        flexarray_append_pair(back, "online", "1");
+        flexarray_append_pair(back, "state",
+                              GCSPRINTF("%d", XenbusStateInitialising));
+        flexarray_append_pair(front, "backend-id",
+                              GCSPRINTF("%d", prep[i].device->backend_domid));
+        flexarray_append_pair(front, "state",
+                              GCSPRINTF("%d", XenbusStateInitialising));
+
+        if (dt->set_xenstore_config)
+            dt->set_xenstore_config(gc, domid, type, back, front, ro_front);
+
+        prep[i].bents = libxl__xs_kvs_of_flexarray(gc, back);
+        prep[i].fents = libxl__xs_kvs_of_flexarray(gc, front);
+        prep[i].ro_fents = libxl__xs_kvs_of_flexarray(gc, ro_front);
+        continue;
+
+    fail_one:
+        aodev->rc = rc;
+        aodev->callback(egc, aodev);
+        prep[i].aodev = NULL;
+    }
+
+    for (;;) {
+        rc = libxl__xs_transaction_start(gc, &t);
+        if (rc) goto fail_all;
+
+        for (i = 0; i < num; i++) {
+            if (!prep[i].aodev) continue;
+
+            rc = libxl__device_exists(gc, t, prep[i].device);
+            if (rc < 0) goto fail_all;
+            if (rc == 1) {              /* already exists in xenstore */
+                LOGD(ERROR, domid, "device already exists in xenstore");
+                prep[i].aodev->action = LIBXL__DEVICE_ACTION_ADD;
+                prep[i].aodev->rc = ERROR_DEVICE_EXISTS;
+                prep[i].aodev->callback(egc, prep[i].aodev);
+                prep[i].aodev = NULL;
+                continue;
+            }
+
+            rc = libxl__device_generic_add(gc, t, prep[i].device,
+                                           prep[i].bents, prep[i].fents,
+                                           prep[i].ro_fents);
+            if (rc) goto fail_all;
+        }
+
+        rc = libxl__xs_transaction_commit(gc, &t);
+        if (!rc) break;
+        if (rc < 0) goto fail_all;
+    }
+
+    for (i = 0; i < num; i++) {
+        if (!prep[i].aodev) continue;
+
+        prep[i].aodev->dev = prep[i].device;
+        prep[i].aodev->action = LIBXL__DEVICE_ACTION_ADD;
+        libxl__wait_device_connection(egc, prep[i].aodev);
+    }
+
+    return;
+
+ fail_all:
+    libxl__xs_transaction_abort(gc, &t);
+    for (i = 0; i < num; i++) {
+        if (!prep[i].aodev) continue;
+
+        prep[i].aodev->rc = rc;
+        prep[i].aodev->callback(egc, prep[i].aodev);
+        prep[i].aodev = NULL;
+    }
+}
+
 int libxl__device_add(libxl__gc *gc, uint32_t domid,
                       const struct libxl_device_type *dt, void *type)
 {
@@ -146,7 +146,7 @@ static int numa_place_domain(libxl__gc *gc, uint32_t domid,
     libxl__numa_candidate candidate;
     libxl_bitmap cpumap, cpupool_nodemap, *map;
     libxl_cpupoolinfo cpupool_info;
-    int i, cpupool, rc = 0;
+    int i, cpupool, min_nodes = 0, max_nodes = 0, rc = 0;
     uint64_t memkb;
 
     libxl__numa_candidate_init(&candidate);
@@ -202,11 +202,24 @@ static int numa_place_domain(libxl__gc *gc, uint32_t domid,
         rc = ERROR_FAIL;
         goto out;
     }
+    rc = libxl_cpumap_to_nodemap(CTX, &cpupool_info.cpumap,
+                                 &cpupool_nodemap);
+    if (rc)
+        goto out;
+
+    /*
+     * When striping, only consider the single candidate spanning all the
+     * nodes the domain may use: memory allocation and the auto-generated
+     * vNUMA topology will then spread the domain across them.
+     */
+    if (info->numa_placement_policy == LIBXL_NUMA_PLACEMENT_POLICY_STRIPED)
+        min_nodes = max_nodes = libxl_bitmap_count_set(&cpupool_nodemap);
 
     /* Find the best candidate with enough free memory and at least
      * as much pcpus as the domain has vcpus.  */
     rc = libxl__get_numa_candidate(gc, memkb, info->max_vcpus,
-                                   0, 0, map, numa_cmpf, &candidate, &found);
+                                   min_nodes, max_nodes, map, numa_cmpf,
+                                   &candidate, &found);
     if (rc)
         goto out;
 
@@ -220,11 +233,6 @@ static int numa_place_domain(libxl__gc *gc, uint32_t domid,
 
     /* Avoid trying to set the affinity to nodes that might be in the
      * candidate's nodemap but out of our cpupool. */
-    rc = libxl_cpumap_to_nodemap(CTX, &cpupool_info.cpumap,
-                                 &cpupool_nodemap);
-    if (rc)
-        goto out;
-
     libxl_for_each_set_bit(i, info->nodemap) {
         if (!libxl_bitmap_test(&cpupool_nodemap, i))
             libxl_bitmap_reset(&info->nodemap, i);
@@ -234,6 +242,15 @@ static int numa_place_domain(libxl__gc *gc, uint32_t domid,
                 "%"PRIu64" KB free selected", candidate.nr_nodes,
                 candidate.nr_cpus, candidate.free_memkb / 1024);
 
+    /*
+     * A striped placement only pays off if the guest kernel knows about
+     * it: synthesize a matching vNUMA topology, unless the configuration
+     * already provides one.
+     */
+    if (info->numa_placement_policy == LIBXL_NUMA_PLACEMENT_POLICY_STRIPED &&
+        !libxl__vnuma_configured(info))
+        rc = libxl__vnuma_generate_striped(gc, info);
+
  out:
     libxl__numa_candidate_dispose(&candidate);
     libxl_bitmap_dispose(&cpupool_nodemap);
@@ -1292,12 +1309,19 @@ int libxl__build_hvm(libxl__gc *gc, uint32_t domid,
     dom->console_domid = state->console_domid;
     dom->xenstore_domid = state->store_domid;
 
-    rc = libxl__domain_device_construct_rdm(gc, d_config,
+    /*
+     * Reserved device memory only matters with an emulated PCI bus;
+     * it also lives in the u.hvm union arm, so don't go near it for
+     * PVH guests.
+     */
+    if (device_model) {
+        rc = libxl__domain_device_construct_rdm(gc, d_config,
                                             info->u.hvm.rdm_mem_boundary_memkb*1024,
                                             dom);
-    if (rc) {
-        LOG(ERROR, "checking reserved device memory failed");
-        goto out;
+        if (rc) {
+            LOG(ERROR, "checking reserved device memory failed");
+            goto out;
+        }
     }
 
     if (info->num_vnuma_nodes != 0) {
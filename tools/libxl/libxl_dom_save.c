@@ -23,6 +23,9 @@
 
 static void stream_done(libxl__egc *egc,
                         libxl__stream_write_state *sws, int rc);
+static void save_mirror_precopy_done(libxl__egc *egc,
+                                     libxl__async_exec_state *aes,
+                                     int rc, int status);
 static void domain_save_done(libxl__egc *egc,
                              libxl__domain_save_state *dss, int rc);
 
@@ -380,6 +383,7 @@ void libxl__domain_save(libxl__egc *egc, libxl__domain_save_state *dss)
 
     dss->xcflags = (live ? XCFLAGS_LIVE : 0)
           | (debug ? XCFLAGS_DEBUG : 0)
+          | (dss->compress ? XCFLAGS_COMPRESS : 0)
           | (dss->hvm ? XCFLAGS_HVM : 0);
 
     /* Disallow saving a guest with vNUMA configured because migration
@@ -413,6 +417,14 @@ void libxl__domain_save(libxl__egc *egc, libxl__domain_save_state *dss)
     dss->sws.back_channel = false;
     dss->sws.completion_callback = stream_done;
 
+    if (dsps->mirror_hook) {
+        /* Set up incremental mirroring of local storage before the
+         * memory precopy starts pushing pages. */
+        libxl__storage_mirror_hook(egc, dsps, "precopy",
+                                   save_mirror_precopy_done);
+        return;
+    }
+
     libxl__stream_write_start(egc, &dss->sws);
     return;
 
@@ -420,6 +432,23 @@ void libxl__domain_save(libxl__egc *egc, libxl__domain_save_state *dss)
     domain_save_done(egc, dss, rc);
 }
 
+static void save_mirror_precopy_done(libxl__egc *egc,
+                                     libxl__async_exec_state *aes,
+                                     int rc, int status)
+{
+    libxl__domain_suspend_state *dsps = CONTAINER_OF(aes, *dsps, mirror_aes);
+    libxl__domain_save_state *dss = CONTAINER_OF(dsps, *dss, dsps);
+
+    if (!rc && status)
+        rc = ERROR_FAIL;
+    if (rc) {
+        domain_save_done(egc, dss, rc);
+        return;
+    }
+
+    libxl__stream_write_start(egc, &dss->sws);
+}
+
 static void stream_done(libxl__egc *egc,
                         libxl__stream_write_state *sws, int rc)
 {
@@ -43,6 +43,10 @@ int libxl__domain_suspend_init(libxl__egc *egc,
     dsps->guest_evtchn_lockfd = -1;
     dsps->guest_responded = 0;
     dsps->dm_savefile = libxl__device_model_savefile(gc, domid);
+    dsps->mirror_hook = libxl__xs_read(gc, XBT_NULL,
+        GCSPRINTF("%s/storage-mirror-hook",
+                  libxl__xs_libxl_path(gc, domid)));
+    libxl__async_exec_init(&dsps->mirror_aes);
 
     port = xs_suspend_evtchn_port(domid);
 
@@ -400,6 +404,69 @@ static void domain_suspend_common_done(libxl__egc *egc,
     dsps->callback_common_done(egc, dsps, rc);
 }
 
+/*----- storage mirror hook -----*/
+
+/*
+ * Optional external hook for keeping local storage in sync during
+ * migration.  If /libxl/$domid/storage-mirror-hook is set (from the
+ * storage_mirror_hook xl.cfg option) the executable it names is run
+ * with two arguments, the phase and the domid:
+ *   - "precopy", when the save stream starts, so an incremental mirror
+ *     of the disks can be set up alongside the memory precopy;
+ *   - "cutover", once the guest has been suspended, i.e. inside the
+ *     migration downtime window, so the final delta can be synced
+ *     before the stream completes.
+ * The migration only proceeds once the hook exits; a nonzero exit
+ * status fails the migration.
+ */
+void libxl__storage_mirror_hook(libxl__egc *egc,
+                                libxl__domain_suspend_state *dsps,
+                                const char *phase,
+                                libxl__async_exec_callback *callback)
+{
+    STATE_AO_GC(dsps->ao);
+    libxl__async_exec_state *aes = &dsps->mirror_aes;
+    char **args;
+    int nullfd, rc;
+
+    assert(dsps->mirror_hook);
+
+    nullfd = open("/dev/null", O_RDONLY);
+    if (nullfd < 0) {
+        LOGED(ERROR, dsps->domid, "unable to open /dev/null");
+        rc = ERROR_FAIL;
+        goto out;
+    }
+
+    args = libxl__zalloc(gc, sizeof(*args) * 4);
+    args[0] = libxl__strdup(gc, dsps->mirror_hook);
+    args[1] = libxl__strdup(gc, phase);
+    args[2] = GCSPRINTF("%u", dsps->domid);
+
+    libxl__async_exec_init(aes);
+    aes->ao = dsps->ao;
+    aes->what = GCSPRINTF("storage mirror hook %s, phase %s",
+                          args[0], phase);
+    aes->env = NULL;
+    aes->args = args;
+    aes->callback = callback;
+    aes->timeout_ms = LIBXL_HOTPLUG_TIMEOUT * 1000;
+    aes->stdfds[0] = nullfd;
+    aes->stdfds[1] = 2;
+    aes->stdfds[2] = -1;
+
+    rc = libxl__async_exec_start(aes);
+    close(nullfd);
+    if (!rc) return;
+
+ out:
+    callback(egc, aes, rc, 0);
+}
+
+static void suspend_mirror_cutover_done(libxl__egc *egc,
+                                        libxl__async_exec_state *aes,
+                                        int rc, int status);
+
 void libxl__domain_suspend_callback(void *data)
 {
     libxl__save_helper_state *shs = data;
@@ -415,6 +482,29 @@ static void domain_suspend_callback_common_done(libxl__egc *egc,
                                 libxl__domain_suspend_state *dsps, int rc)
 {
     libxl__domain_save_state *dss = CONTAINER_OF(dsps, *dss, dsps);
+
+    if (!rc && dsps->mirror_hook) {
+        /* The guest is down: sync the final storage delta now, while
+         * we are inside the downtime window anyway. */
+        libxl__storage_mirror_hook(egc, dsps, "cutover",
+                                   suspend_mirror_cutover_done);
+        return;
+    }
+
+    dss->rc = rc;
+    libxl__xc_domain_saverestore_async_callback_done(egc, &dss->sws.shs, !rc);
+}
+
+static void suspend_mirror_cutover_done(libxl__egc *egc,
+                                        libxl__async_exec_state *aes,
+                                        int rc, int status)
+{
+    libxl__domain_suspend_state *dsps = CONTAINER_OF(aes, *dsps, mirror_aes);
+    libxl__domain_save_state *dss = CONTAINER_OF(dsps, *dss, dsps);
+
+    if (!rc && status)
+        rc = ERROR_FAIL;
+
     dss->rc = rc;
     libxl__xc_domain_saverestore_async_callback_done(egc, &dss->sws.shs, !rc);
 }
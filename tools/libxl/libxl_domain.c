@@ -509,6 +509,7 @@ int libxl_domain_suspend(libxl_ctx *ctx, uint32_t domid, int fd, int flags,
     dss->type = type;
     dss->live = flags & LIBXL_SUSPEND_LIVE;
     dss->debug = flags & LIBXL_SUSPEND_DEBUG;
+    dss->compress = flags & LIBXL_SUSPEND_COMPRESS;
     dss->checkpointed_stream = LIBXL_CHECKPOINTED_STREAM_NONE;
 
     rc = libxl__fd_flags_modify_save(gc, dss->fd,
@@ -571,6 +572,21 @@ int libxl_domain_pause(libxl_ctx *ctx, uint32_t domid)
     return 0;
 }
 
+int libxl_domain_set_wakeup_latency(libxl_ctx *ctx, uint32_t domid,
+                                    uint32_t latency_us)
+{
+    int ret;
+    GC_INIT(ctx);
+    ret = xc_domain_set_wakeup_latency(ctx->xch, domid, latency_us);
+    if (ret<0) {
+        LOGED(ERROR, domid, "Setting wakeup latency hint");
+        GC_FREE;
+        return ERROR_FAIL;
+    }
+    GC_FREE;
+    return 0;
+}
+
 int libxl_domain_core_dump(libxl_ctx *ctx, uint32_t domid,
                            const char *filename,
                            const libxl_asyncop_how *ao_how)
@@ -922,6 +938,74 @@ static void domain_destroy_cb(libxl__egc *egc, libxl__domain_destroy_state *dds,
     libxl__ao_complete(egc, ao, rc);
 }
 
+/* Callbacks for libxl_domains_destroy */
+
+typedef struct domains_destroy_state domains_destroy_state;
+
+typedef struct {
+    libxl__domain_destroy_state dds;
+    domains_destroy_state *container;
+} domains_destroy_one;
+
+struct domains_destroy_state {
+    libxl__ao *ao;
+    unsigned int nr;
+    unsigned int finished;
+    int rc;
+    domains_destroy_one *each;
+};
+
+static void domains_destroy_one_cb(libxl__egc *egc,
+                                   libxl__domain_destroy_state *dds, int rc);
+
+int libxl_domains_destroy(libxl_ctx *ctx, const uint32_t *domids,
+                          unsigned int nr_domids,
+                          const libxl_asyncop_how *ao_how)
+{
+    AO_CREATE(ctx, nr_domids ? domids[0] : 0, ao_how);
+    domains_destroy_state *ddms;
+    unsigned int i;
+
+    if (!nr_domids) {
+        libxl__ao_complete(egc, ao, 0);
+        return AO_INPROGRESS;
+    }
+
+    GCNEW(ddms);
+    ddms->ao = ao;
+    ddms->nr = nr_domids;
+    GCNEW_ARRAY(ddms->each, nr_domids);
+
+    for (i = 0; i < nr_domids; i++) {
+        domains_destroy_one *ddo = &ddms->each[i];
+
+        ddo->container = ddms;
+        ddo->dds.ao = ao;
+        ddo->dds.domid = domids[i];
+        ddo->dds.callback = domains_destroy_one_cb;
+        libxl__domain_destroy(egc, &ddo->dds);
+    }
+
+    return AO_INPROGRESS;
+}
+
+static void domains_destroy_one_cb(libxl__egc *egc,
+                                   libxl__domain_destroy_state *dds, int rc)
+{
+    domains_destroy_one *ddo = CONTAINER_OF(dds, *ddo, dds);
+    domains_destroy_state *ddms = ddo->container;
+    STATE_AO_GC(ddms->ao);
+
+    if (rc) {
+        LOGD(ERROR, dds->domid, "Destruction of domain failed");
+        if (!ddms->rc)
+            ddms->rc = rc;
+    }
+
+    if (++ddms->finished == ddms->nr)
+        libxl__ao_complete(egc, ao, ddms->rc);
+}
+
 /* Callbacks for libxl__domain_destroy */
 
 static void stubdom_destroy_callback(libxl__egc *egc,
@@ -493,12 +493,111 @@ void libxl__unlock_domain_userdata(libxl__domain_userdata_lock *lock)
     free(lock);
 }
 
+/*
+ * Cache of parsed "libxl-json" userdata blobs, so that repeated queries
+ * (e.g. xl list -l over many domains) do not re-deserialize unchanged
+ * configurations.  The store is a file shared with other processes, so
+ * entries are keyed by the identity (inode, size, mtime) of the on-disk
+ * blob rather than an in-process generation counter, and are refreshed
+ * in place whenever this process stores a new configuration.
+ */
+
+static libxl__domain_config_cache_entry *
+domain_config_cache_find(libxl_ctx *ctx, uint32_t domid)
+{
+    libxl__domain_config_cache_entry *ent;
+
+    LIBXL_LIST_FOREACH(ent, &ctx->domain_config_cache, entry)
+        if (ent->domid == domid)
+            return ent;
+
+    return NULL;
+}
+
+static bool domain_config_cache_stamp(libxl__gc *gc, uint32_t domid,
+                                      struct stat *stab)
+{
+    const char *path = libxl__userdata_path(gc, domid, "libxl-json", "d");
+
+    return path && !stat(path, stab);
+}
+
+static bool domain_config_cache_matches(const libxl__domain_config_cache_entry *ent,
+                                        const struct stat *stab)
+{
+    return ent->ino == stab->st_ino && ent->size == stab->st_size &&
+           ent->mtim.tv_sec == stab->st_mtim.tv_sec &&
+           ent->mtim.tv_nsec == stab->st_mtim.tv_nsec;
+}
+
+static void domain_config_cache_drop(libxl__domain_config_cache_entry *ent)
+{
+    LIBXL_LIST_REMOVE(ent, entry);
+    libxl_domain_config_dispose(&ent->d_config);
+    free(ent);
+}
+
+/* Record d_config as the parsed image of the currently stored blob.
+ * Callers hold the userdata lock, so the blob cannot change between
+ * their store/retrieve and the stat() here. */
+static void domain_config_cache_update(libxl__gc *gc, uint32_t domid,
+                                       const libxl_domain_config *d_config)
+{
+    libxl__domain_config_cache_entry *ent;
+    struct stat stab;
+
+    if (!domain_config_cache_stamp(gc, domid, &stab))
+        return;
+
+    CTX_LOCK;
+    ent = domain_config_cache_find(CTX, domid);
+    if (!ent) {
+        ent = libxl__zalloc(NOGC, sizeof(*ent));
+        ent->domid = domid;
+        LIBXL_LIST_INSERT_HEAD(&CTX->domain_config_cache, ent, entry);
+    } else {
+        libxl_domain_config_dispose(&ent->d_config);
+    }
+    libxl_domain_config_init(&ent->d_config);
+    libxl_domain_config_copy(CTX, &ent->d_config, d_config);
+    ent->ino = stab.st_ino;
+    ent->size = stab.st_size;
+    ent->mtim = stab.st_mtim;
+    CTX_UNLOCK;
+}
+
+void libxl__domain_config_cache_dispose(libxl_ctx *ctx)
+{
+    libxl__domain_config_cache_entry *ent, *tmp;
+
+    LIBXL_LIST_FOREACH_SAFE(ent, &ctx->domain_config_cache, entry, tmp)
+        domain_config_cache_drop(ent);
+}
+
 int libxl__get_domain_configuration(libxl__gc *gc, uint32_t domid,
                                     libxl_domain_config *d_config)
 {
     uint8_t *data = NULL;
+    libxl__domain_config_cache_entry *ent;
+    struct stat stab;
+    bool stamped;
     int rc, len;
 
+    stamped = domain_config_cache_stamp(gc, domid, &stab);
+
+    CTX_LOCK;
+    ent = domain_config_cache_find(CTX, domid);
+    if (ent) {
+        if (stamped && domain_config_cache_matches(ent, &stab)) {
+            libxl_domain_config_copy(CTX, d_config, &ent->d_config);
+            CTX_UNLOCK;
+            return 0;
+        }
+        /* Blob rewritten or removed: drop the entry and re-read below. */
+        domain_config_cache_drop(ent);
+    }
+    CTX_UNLOCK;
+
     rc = libxl__userdata_retrieve(gc, domid, "libxl-json", &data, &len);
     if (rc) {
         LOGEVD(ERROR, rc, domid,
@@ -513,6 +612,8 @@ int libxl__get_domain_configuration(libxl__gc *gc, uint32_t domid,
         goto out;
     }
     rc = libxl_domain_config_from_json(CTX, d_config, (const char *)data);
+    if (!rc)
+        domain_config_cache_update(gc, domid, d_config);
 
 out:
     free(data);
@@ -542,6 +643,10 @@ int libxl__set_domain_configuration(libxl__gc *gc, uint32_t domid,
         goto out;
     }
 
+    /* Refresh the parsed cache in place so subsequent queries need not
+     * re-deserialize what we just wrote. */
+    domain_config_cache_update(gc, domid, d_config);
+
 out:
     free(d_config_json);
     return rc;
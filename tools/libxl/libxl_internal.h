@@ -549,6 +549,20 @@ struct libxl__gc {
     libxl_ctx *owner;
 };
 
+/* Parsed copy of a domain's "libxl-json" userdata blob, so repeated
+ * queries need not re-deserialize an unchanged configuration.  An entry
+ * is valid only while the identity of the on-disk blob still matches. */
+typedef struct libxl__domain_config_cache_entry libxl__domain_config_cache_entry;
+struct libxl__domain_config_cache_entry {
+    LIBXL_LIST_ENTRY(libxl__domain_config_cache_entry) entry;
+    uint32_t domid;
+    /* Identity of the blob this was parsed from */
+    ino_t ino;
+    off_t size;
+    struct timespec mtim;
+    libxl_domain_config d_config;
+};
+
 struct libxl__ctx {
     xentoollog_logger *lg;
     xc_interface *xch;
@@ -607,6 +621,9 @@ struct libxl__ctx {
 
     LIBXL_LIST_HEAD(, libxl_evgen_disk_eject) disk_eject_evgens;
 
+    /* Parsed domain configuration cache; protected by the ctx lock */
+    LIBXL_LIST_HEAD(, libxl__domain_config_cache_entry) domain_config_cache;
+
     const libxl_childproc_hooks *childproc_hooks;
     void *childproc_user;
     int sigchld_selfpipe[2]; /* [0]==-1 means handler not installed */
@@ -3435,6 +3452,8 @@ struct libxl__domain_suspend_state {
     libxl__ev_qmp qmp;
 
     const char *dm_savefile;
+    const char *mirror_hook;
+    libxl__async_exec_state mirror_aes;
     void (*callback_device_model_done)(libxl__egc*,
                               struct libxl__domain_suspend_state*, int rc);
     void (*callback_common_done)(libxl__egc*,
@@ -3444,6 +3463,14 @@ int libxl__domain_suspend_init(libxl__egc *egc,
                                libxl__domain_suspend_state *dsps,
                                libxl_domain_type type);
 
+/* Run the domain's storage mirror hook script for the given migration
+ * phase ("precopy" or "cutover").  Caller must have checked that
+ * dsps->mirror_hook is set.  Calls callback when the script exits. */
+_hidden void libxl__storage_mirror_hook(libxl__egc *egc,
+                                        libxl__domain_suspend_state *dsps,
+                                        const char *phase,
+                                        libxl__async_exec_callback *callback);
+
 /* calls dsps->callback_device_model_done when done
  * may synchronously calls this callback */
 _hidden void libxl__qmp_suspend_save(libxl__egc *egc,
@@ -3461,6 +3488,7 @@ struct libxl__domain_save_state {
     libxl_domain_type type;
     int live;
     int debug;
+    int compress;
     int checkpointed_stream;
     const libxl_domain_remus_info *remus;
     /* private */
@@ -3600,6 +3628,19 @@ _hidden void libxl__bootloader_run(libxl__egc*, libxl__bootloader_state *st);
         }                                                               \
     }
 
+/* As LIBXL_DEFINE_DEVICES_ADD, but setting up all the devices' xenstore
+ * nodes in one transaction.  Only for types whose add function is
+ * libxl__device_add_async(). */
+#define LIBXL_DEFINE_DEVICES_ADD_BATCHED(type)                          \
+    void libxl__add_##type##s(libxl__egc *egc, libxl__ao *ao, uint32_t domid, \
+                              libxl_domain_config *d_config,            \
+                              libxl__multidev *multidev)                \
+    {                                                                   \
+        libxl__devices_add_async(egc, domid, &libxl__##type##_devtype,  \
+                                 d_config->type##s,                     \
+                                 d_config->num_##type##s, multidev);    \
+    }
+
 #define LIBXL_DEFINE_DEVICE_REMOVE_EXT(type, remtype, removedestroy, f) \
     int libxl_device_##type##_##removedestroy(libxl_ctx *ctx,           \
         uint32_t domid, libxl_device_##type *type,                      \
@@ -4369,6 +4410,8 @@ int libxl__vnuma_build_vmemrange_hvm(libxl__gc *gc,
                                      libxl__domain_build_state *state,
                                      struct xc_dom_image *dom);
 bool libxl__vnuma_configured(const libxl_domain_build_info *b_info);
+int libxl__vnuma_generate_striped(libxl__gc *gc,
+                                  libxl_domain_build_info *b_info);
 
 _hidden int libxl__ms_vm_genid_set(libxl__gc *gc, uint32_t domid,
                                    const libxl_ms_vm_genid *id);
@@ -4509,6 +4552,9 @@ void libxl__unlock_domain_userdata(libxl__domain_userdata_lock *lock);
  * is "libxl-json".
  * Caller must hold user data lock.
  */
+/* Discard all parsed configuration cache entries; the caller must hold
+ * the ctx lock (or be tearing the ctx down). */
+_hidden void libxl__domain_config_cache_dispose(libxl_ctx *ctx);
 int libxl__get_domain_configuration(libxl__gc *gc, uint32_t domid,
                                     libxl_domain_config *d_config);
 int libxl__set_domain_configuration(libxl__gc *gc, uint32_t domid,
@@ -4588,6 +4634,14 @@ void device_add_domain_config(libxl__gc *gc, libxl_domain_config *d_config,
 void libxl__device_add_async(libxl__egc *egc, uint32_t domid,
                              const struct libxl_device_type *dt, void *type,
                              libxl__ao_device *aodev);
+/* Add several devices of one type, writing the xenstore nodes of all
+ * of them inside a single transaction.  The asynchronous connection
+ * wait then proceeds concurrently for each device via multidev.  Not
+ * usable on paths which must update the stored JSON configuration. */
+void libxl__devices_add_async(libxl__egc *egc, uint32_t domid,
+                              const struct libxl_device_type *dt,
+                              void *types, int num,
+                              libxl__multidev *multidev);
 int libxl__device_add(libxl__gc *gc, uint32_t domid,
                       const struct libxl_device_type *dt, void *type);
 
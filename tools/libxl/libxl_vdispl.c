@@ -199,7 +199,7 @@ out:
 
 static LIBXL_DEFINE_DEVICE_FROM_TYPE(vdispl)
 static LIBXL_DEFINE_UPDATE_DEVID(vdispl)
-static LIBXL_DEFINE_DEVICES_ADD(vdispl)
+static LIBXL_DEFINE_DEVICES_ADD_BATCHED(vdispl)
 
 LIBXL_DEFINE_DEVID_TO_DEVICE(vdispl)
 LIBXL_DEFINE_DEVICE_ADD(vdispl)
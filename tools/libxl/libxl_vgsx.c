@@ -76,7 +76,7 @@ static int libxl__set_xenstore_vgsx(libxl__gc *gc, uint32_t domid,
 
 static LIBXL_DEFINE_UPDATE_DEVID(vgsx)
 static LIBXL_DEFINE_DEVICE_FROM_TYPE(vgsx)
-static LIBXL_DEFINE_DEVICES_ADD(vgsx)
+static LIBXL_DEFINE_DEVICES_ADD_BATCHED(vgsx)
 
 DEFINE_DEVICE_TYPE_STRUCT(vgsx, VGSX,
     .update_config = (device_update_config_fn_t) libxl__update_config_vgsx,
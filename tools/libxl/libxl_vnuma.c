@@ -24,6 +24,93 @@ bool libxl__vnuma_configured(const libxl_domain_build_info *b_info)
     return b_info->num_vnuma_nodes != 0;
 }
 
+/*
+ * Synthesize a vNUMA topology for a domain striped across the physical
+ * nodes set in b_info->nodemap: one vnode per pnode, with the memory and
+ * the vcpus spread (almost) evenly and the vdistances taken from the
+ * host distance table, so the guest kernel sees the real locality of
+ * the memory it is given.
+ */
+int libxl__vnuma_generate_striped(libxl__gc *gc,
+                                  libxl_domain_build_info *b_info)
+{
+    libxl_numainfo *ninfo = NULL;
+    int nr_nodes = 0;
+    unsigned int num, i, j, n = 0;
+    unsigned int *pnodes;
+    uint64_t memkb_node;
+    int rc;
+
+    assert(!libxl__vnuma_configured(b_info));
+
+    num = libxl_bitmap_count_set(&b_info->nodemap);
+    if (num < 2 || b_info->max_vcpus < num)
+        return 0;
+
+    ninfo = libxl_get_numainfo(CTX, &nr_nodes);
+    if (ninfo == NULL) {
+        LOG(ERROR, "libxl_get_numainfo failed");
+        return ERROR_FAIL;
+    }
+
+    pnodes = libxl__calloc(gc, num, sizeof(*pnodes));
+    libxl_for_each_set_bit(i, b_info->nodemap)
+        pnodes[n++] = i;
+
+    /*
+     * The shares must sum to exactly max_memkb, and be multiples of the
+     * page size so each vnode covers a whole number of pages; the last
+     * vnode absorbs the remainder.
+     */
+    memkb_node = (b_info->max_memkb / num) & ~3ULL;
+
+    b_info->vnuma_nodes = calloc(num, sizeof(*b_info->vnuma_nodes));
+    if (b_info->vnuma_nodes == NULL) {
+        rc = ERROR_NOMEM;
+        goto out;
+    }
+    b_info->num_vnuma_nodes = num;
+
+    for (i = 0; i < num; i++) {
+        libxl_vnode_info *v = &b_info->vnuma_nodes[i];
+        unsigned int first = i * b_info->max_vcpus / num;
+        unsigned int last = (i + 1) * b_info->max_vcpus / num;
+
+        libxl_vnode_info_init(v);
+        v->pnode = pnodes[i];
+        v->memkb = (i == num - 1)
+                   ? b_info->max_memkb - memkb_node * (num - 1)
+                   : memkb_node;
+
+        v->distances = calloc(num, sizeof(*v->distances));
+        if (v->distances == NULL) {
+            rc = ERROR_NOMEM;
+            goto out;
+        }
+        v->num_distances = num;
+        for (j = 0; j < num; j++)
+            v->distances[j] = (pnodes[i] < nr_nodes &&
+                               pnodes[j] < ninfo[pnodes[i]].num_dists)
+                              ? ninfo[pnodes[i]].dists[pnodes[j]]
+                              : (i == j ? 10 : 20);
+
+        rc = libxl_cpu_bitmap_alloc(CTX, &v->vcpus, b_info->max_vcpus);
+        if (rc)
+            goto out;
+        for (j = first; j < last; j++)
+            libxl_bitmap_set(&v->vcpus, j);
+
+        LOG(DETAIL, "vnode %u: pnode %u, %"PRIu64" KB, vcpus %u-%u",
+            i, v->pnode, v->memkb, first, last - 1);
+    }
+
+    rc = 0;
+
+out:
+    libxl_numainfo_list_free(ninfo, nr_nodes);
+    return rc;
+}
+
 /* Sort vmemranges in ascending order with "start" */
 static int compare_vmemrange(const void *a, const void *b)
 {
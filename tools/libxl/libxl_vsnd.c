@@ -664,7 +664,7 @@ out:
 }
 
 static LIBXL_DEFINE_UPDATE_DEVID(vsnd)
-static LIBXL_DEFINE_DEVICES_ADD(vsnd)
+static LIBXL_DEFINE_DEVICES_ADD_BATCHED(vsnd)
 
 LIBXL_DEFINE_DEVICE_ADD(vsnd)
 LIBXL_DEFINE_DEVICE_REMOVE(vsnd)
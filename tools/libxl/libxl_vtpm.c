@@ -225,7 +225,7 @@ static void libxl_device_vtpm_update_config(libxl__gc *gc, void *d, void *s)
 
 static LIBXL_DEFINE_UPDATE_DEVID(vtpm)
 static LIBXL_DEFINE_DEVICE_FROM_TYPE(vtpm)
-static LIBXL_DEFINE_DEVICES_ADD(vtpm)
+static LIBXL_DEFINE_DEVICES_ADD_BATCHED(vtpm)
 
 LIBXL_DEFINE_DEVICE_ADD(vtpm)
 LIBXL_DEFINE_DEVICE_REMOVE(vtpm)
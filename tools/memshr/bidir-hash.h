@@ -27,6 +27,20 @@ typedef struct vbdblk {
     uint16_t disk_id;
 } vbdblk_t;
 
+/* 64-bit multiply-xorshift mixer (the splitmix64 finaliser). Needs no
+ * lookup tables, is a handful of pipelined multiply/shift ops, and spreads
+ * sequential keys (sector numbers, handles) across the whole table, which
+ * the old xor-fold hashes did not. */
+static inline uint32_t bidir_hash_mix64(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return (uint32_t)x;
+}
+
 
 #if defined FINGERPRINT_MAP || BLOCK_MAP 
 #define DEFINE_SINGLE_MAP 
@@ -49,7 +63,7 @@ static uint32_t fgprtshr_fgprt_hash(uint32_t h)
 
 static uint32_t fgprtshr_mfn_hash(uint64_t m)
 {
-    return (uint32_t)m;
+    return bidir_hash_mix64(m);
 }
 
 static int fgprtshr_fgprt_cmp(uint32_t h1, uint32_t h2)
@@ -82,15 +96,14 @@ static int fgprtshr_mfn_cmp(uint32_t m1, uint32_t m2)
 #undef BIDIR_KEY_T
 #undef BIDIR_VALUE_T
 
-/* TODO better hashes! */
 static inline uint32_t blockshr_block_hash(vbdblk_t block)
 {
-    return (uint32_t)(block.sec) ^ (uint32_t)(block.disk_id);
+    return bidir_hash_mix64(block.sec ^ ((uint64_t)block.disk_id << 48));
 }
 
 static inline uint32_t blockshr_shrhnd_hash(share_tuple_t shrhnd)
 {
-    return ((uint32_t) shrhnd.handle);
+    return bidir_hash_mix64(shrhnd.handle ^ ((uint64_t)shrhnd.domain << 32));
 }
 
 static inline int blockshr_block_cmp(vbdblk_t b1, vbdblk_t b2)
@@ -0,0 +1,126 @@
+/* -*-  Mode:C; c-basic-offset:4; tab-width:4 -*-
+ ****************************************************************************
+ *
+ *        File: xen-dlog.c
+ *
+ * Description: dump and format the hypervisor's binary structured
+ *              diagnostics log (per-CPU rings read via XEN_SYSCTL_dlog).
+ *              Formatting lives here rather than in the hypervisor so
+ *              that the logging call sites stay cheap.
+ */
+
+#include <xenctrl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+
+#define MAX_RECS 256
+
+static const struct {
+    uint32_t event;
+    const char *name;
+} event_names[] = {
+    { XEN_DLOG_CONSOLE_SUPPRESSED, "console/printk-suppressed" },
+};
+
+static const char *event_name(uint32_t event)
+{
+    unsigned int i;
+
+    for ( i = 0; i < sizeof(event_names) / sizeof(event_names[0]); i++ )
+        if ( event_names[i].event == event )
+            return event_names[i].name;
+    return NULL;
+}
+
+static void dump_cpu(uint32_t cpu, const xc_dlog_rec_t *recs,
+                     uint32_t nr_recs, uint64_t prod)
+{
+    uint32_t i, j;
+
+    printf("CPU%u: %"PRIu64" records written, last %u:\n",
+           cpu, prod, nr_recs);
+
+    for ( i = 0; i < nr_recs; i++ )
+    {
+        const xc_dlog_rec_t *r = &recs[i];
+        const char *name = event_name(r->event);
+
+        printf("  %016"PRIx64" %08x", r->tsc, r->event);
+        if ( name != NULL )
+            printf(" %-28s", name);
+        for ( j = 0; j < r->nargs && j < 4; j++ )
+            printf(" %#"PRIx64, r->arg[j]);
+        printf("\n");
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    xc_interface  *xc_handle;
+    xc_physinfo_t  physinfo = { 0 };
+    uint32_t       cpu, first_cpu = 0, last_cpu;
+    int            errors = 0;
+    DECLARE_HYPERCALL_BUFFER(xc_dlog_rec_t, recs);
+
+    if ( argc > 2 || (argc == 2 && !strcmp(argv[1], "-h")) )
+    {
+        printf("usage: %s [<cpu>]\n"
+               "Print the hypervisor's per-CPU binary diagnostics log,\n"
+               "for all CPUs or the given one.\n", argv[0]);
+        return 1;
+    }
+
+    if ( (xc_handle = xc_interface_open(0, 0, 0)) == 0 )
+    {
+        fprintf(stderr, "Error opening xc interface: %d (%s)\n",
+                errno, strerror(errno));
+        return 1;
+    }
+
+    if ( xc_physinfo(xc_handle, &physinfo) != 0 )
+    {
+        fprintf(stderr, "Error getting physinfo: %d (%s)\n",
+                errno, strerror(errno));
+        return 1;
+    }
+    last_cpu = physinfo.max_cpu_id;
+
+    if ( argc == 2 )
+        first_cpu = last_cpu = strtoul(argv[1], NULL, 0);
+
+    recs = xc_hypercall_buffer_alloc(xc_handle, recs,
+                                     sizeof(*recs) * MAX_RECS);
+    if ( recs == NULL )
+    {
+        fprintf(stderr, "Could not allocate buffer: %d (%s)\n",
+                errno, strerror(errno));
+        return 1;
+    }
+
+    for ( cpu = first_cpu; cpu <= last_cpu; cpu++ )
+    {
+        uint32_t nr_recs = MAX_RECS;
+        uint64_t prod;
+
+        if ( xc_dlog_read(xc_handle, cpu, HYPERCALL_BUFFER(recs),
+                          &nr_recs, &prod) != 0 )
+        {
+            if ( errno == ENODEV ) /* CPU never came up */
+                continue;
+            fprintf(stderr, "Error reading CPU%u log: %d (%s)\n",
+                    cpu, errno, strerror(errno));
+            errors++;
+            continue;
+        }
+
+        dump_cpu(cpu, recs, nr_recs, prod);
+    }
+
+    xc_hypercall_buffer_free(xc_handle, recs);
+    xc_interface_close(xc_handle);
+
+    return errors != 0;
+}
@@ -0,0 +1,102 @@
+/* -*-  Mode:C; c-basic-offset:4; tab-width:4 -*-
+ ****************************************************************************
+ *
+ *        File: xen-memprof.c
+ *
+ * Description: print the hypervisor heap profile: xmalloc pool totals,
+ *              per-allocation-site counters and per-domain heap usage,
+ *              modeled on xenlockprof.c
+ */
+
+#include <xenctrl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+
+#define MAX_SITES   256
+#define MAX_DOMS    1024
+
+static int cmp_live(const void *a, const void *b)
+{
+    const xc_memprof_site_t *l = a, *r = b;
+
+    if ( l->live_bytes != r->live_bytes )
+        return l->live_bytes < r->live_bytes ? 1 : -1;
+    return l->bytes < r->bytes ? 1 : l->bytes > r->bytes ? -1 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    xc_interface      *xc_handle;
+    uint32_t           i, nr_sites = MAX_SITES, nr_doms = MAX_DOMS;
+    uint64_t           pool_used, pool_size;
+    DECLARE_HYPERCALL_BUFFER(xc_memprof_site_t, sites);
+    DECLARE_HYPERCALL_BUFFER(xc_memprof_dom_t, doms);
+
+    if ( argc != 1 )
+    {
+        printf("%s: print hypervisor heap usage and xmalloc\n"
+               "allocation-site counters.  Resolve site addresses against\n"
+               "the matching xen-syms, e.g.:\n"
+               "  addr2line -f -e xen-syms <addr>\n", argv[0]);
+        return 1;
+    }
+
+    if ( (xc_handle = xc_interface_open(0, 0, 0)) == 0 )
+    {
+        fprintf(stderr, "Error opening xc interface: %d (%s)\n",
+                errno, strerror(errno));
+        return 1;
+    }
+
+    sites = xc_hypercall_buffer_alloc(xc_handle, sites,
+                                      sizeof(*sites) * nr_sites);
+    doms = xc_hypercall_buffer_alloc(xc_handle, doms,
+                                     sizeof(*doms) * nr_doms);
+    if ( sites == NULL || doms == NULL )
+    {
+        fprintf(stderr, "Could not allocate buffers: %d (%s)\n",
+                errno, strerror(errno));
+        return 1;
+    }
+
+    if ( xc_memprof_query(xc_handle, HYPERCALL_BUFFER(sites), &nr_sites,
+                          HYPERCALL_BUFFER(doms), &nr_doms,
+                          &pool_used, &pool_size) != 0 )
+    {
+        fprintf(stderr, "Error getting heap profile: %d (%s)\n",
+                errno, strerror(errno));
+        return 1;
+    }
+
+    printf("xmalloc pool: %"PRIu64" bytes used of %"PRIu64"\n\n",
+           pool_used, pool_size);
+
+    printf("%-18s %12s %12s %14s %12s\n",
+           "site", "allocs", "frees", "bytes", "live");
+    qsort(sites, nr_sites, sizeof(*sites), cmp_live);
+    for ( i = 0; i < nr_sites; i++ )
+    {
+        char addr[19];
+
+        if ( sites[i].addr )
+            snprintf(addr, sizeof(addr), "%#"PRIx64, sites[i].addr);
+        else
+            snprintf(addr, sizeof(addr), "(other)");
+        printf("%-18s %12"PRIu64" %12"PRIu64" %14"PRIu64" %12"PRIu64"\n",
+               addr, sites[i].allocs, sites[i].frees, sites[i].bytes,
+               sites[i].live_bytes);
+    }
+
+    printf("\n%-8s %16s %16s\n", "domain", "domheap pages", "xenheap pages");
+    for ( i = 0; i < nr_doms; i++ )
+        printf("%-8u %16"PRIu64" %16"PRIu64"\n", doms[i].domain,
+               doms[i].tot_pages, doms[i].xenheap_pages);
+
+    xc_hypercall_buffer_free(xc_handle, sites);
+    xc_hypercall_buffer_free(xc_handle, doms);
+
+    return 0;
+}
@@ -0,0 +1,159 @@
+/* -*-  Mode:C; c-basic-offset:4; tab-width:4 -*-
+ ****************************************************************************
+ *
+ *        File: xenhcallprof.c
+ *
+ * Description: print per-domain hypercall latency profile data,
+ *              modeled on xenlockprof.c
+ */
+
+#include <xenctrl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <inttypes.h>
+
+#define NAME(x) [ __HYPERVISOR_ ## x ] = #x
+
+static const char *const hcall_names[] = {
+    NAME(set_trap_table),
+    NAME(mmu_update),
+    NAME(set_gdt),
+    NAME(stack_switch),
+    NAME(set_callbacks),
+    NAME(fpu_taskswitch),
+    NAME(sched_op_compat),
+    NAME(platform_op),
+    NAME(set_debugreg),
+    NAME(get_debugreg),
+    NAME(update_descriptor),
+    NAME(memory_op),
+    NAME(multicall),
+    NAME(update_va_mapping),
+    NAME(set_timer_op),
+    NAME(event_channel_op_compat),
+    NAME(xen_version),
+    NAME(console_io),
+    NAME(physdev_op_compat),
+    NAME(grant_table_op),
+    NAME(vm_assist),
+    NAME(update_va_mapping_otherdomain),
+    NAME(iret),
+    NAME(vcpu_op),
+    NAME(set_segment_base),
+    NAME(mmuext_op),
+    NAME(xsm_op),
+    NAME(nmi_op),
+    NAME(sched_op),
+    NAME(callback_op),
+    NAME(xenoprof_op),
+    NAME(event_channel_op),
+    NAME(physdev_op),
+    NAME(hvm_op),
+    NAME(sysctl),
+    NAME(domctl),
+    NAME(kexec_op),
+    NAME(tmem_op),
+    NAME(argo_op),
+    NAME(xenpmu_op),
+    NAME(dm_op),
+    NAME(arch_0),
+    NAME(arch_1),
+    NAME(arch_2),
+    NAME(arch_3),
+    NAME(arch_4),
+    NAME(arch_5),
+    NAME(arch_6),
+    NAME(arch_7),
+};
+
+#undef NAME
+
+int main(int argc, char *argv[])
+{
+    xc_interface      *xc_handle;
+    uint32_t           i, j, n, domid;
+    double             t, st;
+    char               name[60];
+    DECLARE_HYPERCALL_BUFFER(xc_hypercall_prof_data_t, data);
+
+    if ( (argc < 2) || (argc > 3) ||
+         ((argc == 3) && (strcmp(argv[2], "-r") != 0)) )
+    {
+        printf("%s: <domid> [-r]\n", argv[0]);
+        printf("no flag: print hypercall profile data for <domid>\n");
+        printf("    -r : reset profile data for <domid>\n");
+        return 1;
+    }
+
+    domid = strtoul(argv[1], NULL, 0);
+
+    if ( (xc_handle = xc_interface_open(0,0,0)) == 0 )
+    {
+        fprintf(stderr, "Error opening xc interface: %d (%s)\n",
+                errno, strerror(errno));
+        return 1;
+    }
+
+    if ( argc == 3 )
+    {
+        if ( xc_hypercall_prof_reset(xc_handle, domid) != 0 )
+        {
+            fprintf(stderr, "Error resetting profile data: %d (%s)\n",
+                    errno, strerror(errno));
+            return 1;
+        }
+        return 0;
+    }
+
+    n = 64;     /* enough for every hypercall number */
+    data = xc_hypercall_buffer_alloc(xc_handle, data, sizeof(*data) * n);
+    if ( data == NULL )
+    {
+        fprintf(stderr, "Could not allocate buffers: %d (%s)\n",
+                errno, strerror(errno));
+        return 1;
+    }
+
+    i = n;
+    if ( xc_hypercall_prof_query(xc_handle, domid, &i,
+                                 HYPERCALL_BUFFER(data)) != 0 )
+    {
+        fprintf(stderr, "Error getting profile records: %d (%s)\n",
+                errno, strerror(errno));
+        return 1;
+    }
+
+    if ( i > n )
+    {
+        printf("data incomplete, %d records are missing!\n\n", i - n);
+        i = n;
+    }
+
+    st = 0;
+    for ( j = 0; j < i; j++ )
+    {
+        if ( (data[j].op < sizeof(hcall_names) / sizeof(*hcall_names)) &&
+             hcall_names[data[j].op] )
+            snprintf(name, sizeof(name), "%s", hcall_names[data[j].op]);
+        else
+            snprintf(name, sizeof(name), "hypercall %u", data[j].op);
+        t = (double)(data[j].time) / 1E+09;
+        st += t;
+        printf("%-30s: calls:%12"PRId64"(%20.9fs)\n",
+               name, data[j].count, t);
+
+        /* Bucket k counts dispatches of [2^(k-1), 2^k) microseconds. */
+        printf("    latency histogram (us):");
+        for ( n = 0; n < XEN_HYPERCALL_PROF_NR_HIST; n++ )
+            if ( data[j].hist[n] )
+                printf(" <%u:%"PRId64, 1u << n, data[j].hist[n]);
+        printf("\n");
+    }
+    printf("total time in hypercalls: %20.9fs\n", st);
+
+    xc_hypercall_buffer_free(xc_handle, data);
+
+    return 0;
+}
@@ -27,11 +27,15 @@ int main(int argc, char *argv[])
     char               name[100];
     DECLARE_HYPERCALL_BUFFER(xc_lockprof_data_t, data);
 
-    if ( (argc > 2) || ((argc == 2) && (strcmp(argv[1], "-r") != 0)) )
+    if ( (argc > 2) ||
+         ((argc == 2) && (strcmp(argv[1], "-r") != 0) &&
+          (strcmp(argv[1], "-e") != 0) && (strcmp(argv[1], "-d") != 0)) )
     {
-        printf("%s: [-r]\n", argv[0]);
+        printf("%s: [-r|-e|-d]\n", argv[0]);
         printf("no args: print lock profile data\n");
         printf("    -r : reset profile data\n");
+        printf("    -e : enable data collection\n");
+        printf("    -d : disable data collection\n");
         return 1;
     }
 
@@ -44,9 +48,15 @@ int main(int argc, char *argv[])
 
     if ( argc > 1 )
     {
-        if ( xc_lockprof_reset(xc_handle) != 0 )
+        int rc;
+
+        if ( strcmp(argv[1], "-r") == 0 )
+            rc = xc_lockprof_reset(xc_handle);
+        else
+            rc = xc_lockprof_control(xc_handle, strcmp(argv[1], "-e") == 0);
+        if ( rc != 0 )
         {
-            fprintf(stderr, "Error resetting profile data: %d (%s)\n",
+            fprintf(stderr, "Error modifying profile state: %d (%s)\n",
                     errno, strerror(errno));
             return 1;
         }
@@ -108,6 +118,17 @@ int main(int argc, char *argv[])
         printf("%-50s: lock:%12"PRId64"(%20.9fs), "
                "block:%12"PRId64"(%20.9fs)\n",
                name, data[j].lock_cnt, l, data[j].block_cnt, b);
+        if ( data[j].block_cnt )
+        {
+            uint32_t k;
+
+            /* Bucket k counts waits of [2^(k-1), 2^k) microseconds. */
+            printf("    wait histogram (us):");
+            for ( k = 0; k < XEN_LOCKPROF_NR_HIST; k++ )
+                if ( data[j].hist[k] )
+                    printf(" <%u:%"PRId64, 1u << k, data[j].hist[k]);
+            printf("\n");
+        }
     }
     l = (double)time / 1E+09;
     printf("total profiling time: %20.9fs\n", l);
@@ -11,6 +11,7 @@
  */
 
 #include <xenctrl.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/mman.h>
@@ -74,9 +75,13 @@ int main(int argc, char *argv[])
     xc_interface    *xc_handle;
     DECLARE_HYPERCALL_BUFFER(xc_perfc_desc_t, pcd);
     DECLARE_HYPERCALL_BUFFER(xc_perfc_val_t, pcv);
+    DECLARE_HYPERCALL_BUFFER(uint64_t, dpv);
     xc_perfc_val_t  *val;
     int num_desc, num_val;
     unsigned int    sum, reset = 0, full = 0, pretty = 0;
+    unsigned int    dom_query = 0, dom_enable = 0, dom_disable = 0;
+    unsigned int    sampler_start = 0, sampler_stop = 0;
+    uint32_t        domid = 0, rate = 0;
     char hypercall_name[36];
 
     if ( argc > 1 )
@@ -96,6 +101,26 @@ int main(int argc, char *argv[])
             case 'r':
                 reset = 1;
                 break;
+            case 'e':
+                dom_enable = 1;
+                break;
+            case 'E':
+                dom_disable = 1;
+                break;
+            case 'd':
+                if ( argc < 3 )
+                    goto error;
+                dom_query = 1;
+                domid = strtoul(argv[2], NULL, 10);
+                break;
+            case 's':
+                sampler_start = 1;
+                if ( argc > 2 )
+                    rate = strtoul(argv[2], NULL, 10);
+                break;
+            case 'S':
+                sampler_stop = 1;
+                break;
             default:
                 goto error;
             }
@@ -108,9 +133,14 @@ int main(int argc, char *argv[])
             printf("    -f : print full arrays/histograms\n");
             printf("    -p : print full arrays/histograms in pretty format\n");
             printf("    -r : reset counters\n");
+            printf("    -e : enable per-domain counters\n");
+            printf("    -E : disable per-domain counters\n");
+            printf("    -d <domid> : print per-domain counters\n");
+            printf("    -s [rate] : start the IP sampler (rate in Hz)\n");
+            printf("    -S : stop the IP sampler and print its statistics\n");
             return 0;
         }
-    }   
+    }
 
     if ( (xc_handle = xc_interface_open(0,0,0)) == 0 )
     {
@@ -119,6 +149,81 @@ int main(int argc, char *argv[])
         return 1;
     }
     
+    if ( sampler_start || sampler_stop )
+    {
+        if ( xc_sampler_enable(xc_handle, sampler_start, rate) != 0 )
+        {
+            fprintf(stderr, "Error switching the IP sampler: %d (%s)\n",
+                    errno, strerror(errno));
+            return 1;
+        }
+
+        if ( sampler_stop )
+        {
+            uint32_t enabled;
+            uint64_t nr_samples, nr_dropped;
+
+            if ( xc_sampler_query(xc_handle, &enabled, &nr_samples,
+                                  &nr_dropped) != 0 )
+            {
+                fprintf(stderr, "Error querying the IP sampler: %d (%s)\n",
+                        errno, strerror(errno));
+                return 1;
+            }
+
+            printf("samples taken:   %12"PRIu64"\n", nr_samples);
+            printf("samples dropped: %12"PRIu64"\n", nr_dropped);
+        }
+
+        return 0;
+    }
+
+    if ( dom_enable || dom_disable )
+    {
+        if ( xc_domperf_enable(xc_handle, dom_enable) != 0 )
+        {
+            fprintf(stderr, "Error switching per-domain counters: %d (%s)\n",
+                    errno, strerror(errno));
+            return 1;
+        }
+
+        return 0;
+    }
+
+    if ( dom_query )
+    {
+        static const char *const domperf_names[XEN_DOMPERF_NR] = {
+            [XEN_DOMPERF_vmexits]      = "vmexits",
+            [XEN_DOMPERF_hypercalls]   = "hypercalls",
+            [XEN_DOMPERF_grant_ops]    = "grant_ops",
+            [XEN_DOMPERF_evtchn_sends] = "evtchn_sends",
+        };
+        uint32_t nr = XEN_DOMPERF_NR;
+
+        dpv = xc_hypercall_buffer_alloc(xc_handle, dpv, sizeof(*dpv) * nr);
+        if ( dpv == NULL )
+        {
+            fprintf(stderr, "Could not allocate buffer: %d (%s)\n",
+                    errno, strerror(errno));
+            return 1;
+        }
+
+        if ( xc_domperf_query(xc_handle, domid, &nr, HYPERCALL_BUFFER(dpv)) )
+        {
+            fprintf(stderr, "Error querying per-domain counters: %d (%s)\n",
+                    errno, strerror(errno));
+            return 1;
+        }
+
+        if ( nr > XEN_DOMPERF_NR )
+            nr = XEN_DOMPERF_NR;
+        for ( i = 0; i < nr; i++ )
+            printf("%-15s %12"PRIu64"\n", domperf_names[i], dpv[i]);
+
+        xc_hypercall_buffer_free(xc_handle, dpv);
+        return 0;
+    }
+
     if ( reset )
     {
         if ( xc_perfc_reset(xc_handle) != 0 )
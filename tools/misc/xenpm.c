@@ -65,10 +65,16 @@ void show_help(void)
             " set-vcpu-migration-delay      <num> set scheduler vcpu migration delay in us\n"
             " get-vcpu-migration-delay            get scheduler vcpu migration delay\n"
             " set-max-cstate        <num>         set the C-State limitation (<num> >= 0)\n"
+            " set-cpu-max-cstate    [cpuid] <num> set per-CPU C-State limitation (0 = no limit)\n"
             " start [seconds]                     start collect Cx/Px statistics,\n"
             "                                     output after CTRL-C or SIGINT or several seconds.\n"
             " enable-turbo-mode     [cpuid]       enable Turbo Mode for processors that support it.\n"
             " disable-turbo-mode    [cpuid]       disable Turbo Mode for processors that support it.\n"
+            " set-hwp-epp           [cpuid] <num> set HWP energy-performance preference on CPU\n"
+            "                                     <cpuid> or all (0 - performance ... 255 - energy)\n"
+            " get-pm-summary                      show Cx/Px residency of all CPUs in one query\n"
+            " enable-telemetry      [period_ms]   let Xen refresh a shared telemetry page\n"
+            " disable-telemetry                   stop refreshing the telemetry page\n"
             );
 }
 /* wrapper function */
@@ -1131,6 +1137,38 @@ void set_max_cstate_func(int argc, char *argv[])
                 value, errno, strerror(errno));
 }
 
+void set_cpu_max_cstate_func(int argc, char *argv[])
+{
+    int cpuid = -1, value = -1;
+
+    if ( argc > 1 )
+    {
+        parse_cpuid(argv[0], &cpuid);
+        argv++;
+        argc--;
+    }
+
+    if ( argc != 1 || sscanf(argv[0], "%d", &value) != 1 || value < 0 )
+    {
+        fprintf(stderr, "Missing or invalid argument(s)\n");
+        exit(EINVAL);
+    }
+
+    if ( cpuid < 0 )
+    {
+        /* cap the C-state on all cpus */
+        int i;
+        for ( i = 0; i < max_cpu_nr; i++ )
+            if ( xc_set_cpu_max_cstate(xc_handle, i, value) )
+                fprintf(stderr,
+                        "[CPU%d] failed to set max C-state to C%d (%d - %s)\n",
+                        i, value, errno, strerror(errno));
+    }
+    else if ( xc_set_cpu_max_cstate(xc_handle, cpuid, value) )
+        fprintf(stderr, "failed to set max C-state to C%d (%d - %s)\n",
+                value, errno, strerror(errno));
+}
+
 void enable_turbo_mode(int argc, char *argv[])
 {
     int cpuid = -1;
@@ -1177,6 +1215,104 @@ void disable_turbo_mode(int argc, char *argv[])
                 errno, strerror(errno));
 }
 
+void pm_summary_func(int argc, char *argv[])
+{
+    struct pm_telemetry_rec *recs;
+    int i, j, nr = max_cpu_nr;
+
+    recs = calloc(nr, sizeof(*recs));
+    if ( recs == NULL )
+    {
+        fprintf(stderr, "failed to allocate summary buffer\n");
+        exit(ENOMEM);
+    }
+
+    if ( xc_pm_get_summary(xc_handle, recs, &nr) )
+    {
+        fprintf(stderr, "failed to get PM summary (%d - %s)\n",
+                errno, strerror(errno));
+        free(recs);
+        return;
+    }
+
+    for ( i = 0; i < nr; i++ )
+    {
+        printf("CPU%-3d cur Px %2d  last Cx %2d  idle %"PRIu64" ms  Px residency (ms):",
+               i, (int32_t)recs[i].cur_px, (int32_t)recs[i].last_cx,
+               recs[i].idle_time / 1000000UL);
+        for ( j = 0; j < XEN_PM_PX_MAX && recs[i].px_residency[j]; j++ )
+            printf(" %"PRIu64, recs[i].px_residency[j] / 1000000UL);
+        printf("\n");
+    }
+
+    free(recs);
+}
+
+void enable_telemetry_func(int argc, char *argv[])
+{
+    int period = 0;
+    uint64_t mfn;
+    uint32_t nr_pages;
+
+    if ( argc > 0 && (sscanf(argv[0], "%d", &period) != 1 || period < 0) )
+    {
+        fprintf(stderr, "Invalid period argument\n");
+        exit(EINVAL);
+    }
+
+    if ( xc_pm_telemetry_enable(xc_handle, period, &mfn, &nr_pages) )
+    {
+        fprintf(stderr, "failed to enable PM telemetry (%d - %s)\n",
+                errno, strerror(errno));
+        return;
+    }
+
+    printf("PM telemetry enabled: %u page(s) starting at mfn %#"PRIx64"\n",
+           nr_pages, mfn);
+}
+
+void disable_telemetry_func(int argc, char *argv[])
+{
+    if ( xc_pm_telemetry_disable(xc_handle) )
+        fprintf(stderr, "failed to disable PM telemetry (%d - %s)\n",
+                errno, strerror(errno));
+}
+
+void set_hwp_epp_func(int argc, char *argv[])
+{
+    int cpuid = -1, epp = -1;
+
+    if ( argc > 1 )
+    {
+        parse_cpuid(argv[0], &cpuid);
+        argv++;
+        argc--;
+    }
+
+    if ( argc != 1 || sscanf(argv[0], "%d", &epp) != 1 ||
+         epp < 0 || epp > 255 )
+    {
+        fprintf(stderr, "Missing or invalid argument(s)\n");
+        exit(EINVAL);
+    }
+
+    if ( cpuid < 0 )
+    {
+        /* set energy-performance preference on all cpus */
+        int i;
+        for ( i = 0; i < max_cpu_nr; i++ )
+            if ( xc_set_hwp_epp(xc_handle, i, epp) )
+                fprintf(stderr,
+                        "[CPU%d] failed to set HWP energy-performance "
+                        "preference (%d - %s)\n",
+                        i, errno, strerror(errno));
+    }
+    else if ( xc_set_hwp_epp(xc_handle, cpuid, epp) )
+        fprintf(stderr,
+                "failed to set HWP energy-performance preference (%d - %s)\n",
+                errno, strerror(errno));
+}
+
 struct {
     const char *name;
     void (*function)(int argc, char *argv[]);
@@ -1198,8 +1334,13 @@ struct {
     { "get-vcpu-migration-delay", get_vcpu_migration_delay_func},
     { "set-vcpu-migration-delay", set_vcpu_migration_delay_func},
     { "set-max-cstate", set_max_cstate_func},
+    { "set-cpu-max-cstate", set_cpu_max_cstate_func},
     { "enable-turbo-mode", enable_turbo_mode },
     { "disable-turbo-mode", disable_turbo_mode },
+    { "set-hwp-epp", set_hwp_epp_func },
+    { "get-pm-summary", pm_summary_func },
+    { "enable-telemetry", enable_telemetry_func },
+    { "disable-telemetry", disable_telemetry_func },
 };
 
 int main(int argc, char *argv[])
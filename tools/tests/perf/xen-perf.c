@@ -0,0 +1,378 @@
+/*
+ * xen-perf.c
+ *
+ * Host-wide microbenchmark harness. Measures hypercall latency, event
+ * channel round-trip time, grant map/unmap rate and scheduler wake
+ * latency from dom0, and emits the results as JSON so that runs can be
+ * compared against a stored baseline with xen-perf-compare.
+ *
+ * Copyright (c) 2019 Citrix Systems Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the
+ * License only.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <err.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include <xenctrl.h>
+#include <xenevtchn.h>
+#include <xengnttab.h>
+
+#include <xen-tools/libs.h>
+
+#define DEFAULT_ITERATIONS 100000
+#define WARMUP_ITERATIONS  1000
+
+struct result {
+    const char *name;
+    unsigned long iterations;
+    uint64_t ns_total;
+    uint64_t ns_max;
+};
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    if ( clock_gettime(CLOCK_MONOTONIC, &ts) )
+        err(1, "clock_gettime");
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Null-ish hypercall latency, measured via XENVER_version. */
+static void bench_hypercall(struct result *res, unsigned long iters)
+{
+    xc_interface *xch = xc_interface_open(NULL, NULL, 0);
+    unsigned long i;
+    uint64_t start;
+
+    if ( !xch )
+        err(1, "xc_interface_open");
+
+    for ( i = 0; i < WARMUP_ITERATIONS; i++ )
+        xc_version(xch, XENVER_version, NULL);
+
+    start = now_ns();
+    for ( i = 0; i < iters; i++ )
+        xc_version(xch, XENVER_version, NULL);
+    res->ns_total = now_ns() - start;
+    res->iterations = iters;
+
+    xc_interface_close(xch);
+}
+
+/*
+ * Event channel round-trip within dom0: two handles bound to each
+ * other's ports, ping-ponging a notification. Each iteration is one
+ * full round trip (two notifies, two wakeups).
+ */
+static void bench_evtchn(struct result *res, unsigned long iters)
+{
+    xenevtchn_handle *xce_a, *xce_b;
+    evtchn_port_t pa, pb;
+    unsigned long i;
+    uint64_t start;
+
+    xce_a = xenevtchn_open(NULL, 0);
+    xce_b = xenevtchn_open(NULL, 0);
+    if ( !xce_a || !xce_b )
+        err(1, "xenevtchn_open");
+
+    pa = xenevtchn_bind_unbound_port(xce_a, 0);
+    if ( (int)pa < 0 )
+        err(1, "xenevtchn_bind_unbound_port");
+    pb = xenevtchn_bind_interdomain(xce_b, 0, pa);
+    if ( (int)pb < 0 )
+        err(1, "xenevtchn_bind_interdomain");
+
+    start = now_ns();
+    for ( i = 0; i < iters; i++ )
+    {
+        if ( xenevtchn_notify(xce_b, pb) )
+            err(1, "xenevtchn_notify");
+        if ( xenevtchn_pending(xce_a) != pa )
+            errx(1, "unexpected port pending on handle A");
+        xenevtchn_unmask(xce_a, pa);
+
+        if ( xenevtchn_notify(xce_a, pa) )
+            err(1, "xenevtchn_notify");
+        if ( xenevtchn_pending(xce_b) != pb )
+            errx(1, "unexpected port pending on handle B");
+        xenevtchn_unmask(xce_b, pb);
+    }
+    res->ns_total = now_ns() - start;
+    res->iterations = iters;
+
+    xenevtchn_close(xce_b);
+    xenevtchn_close(xce_a);
+}
+
+/* Grant map/unmap rate: repeatedly map and unmap a page we granted. */
+static void bench_gnttab(struct result *res, unsigned long iters)
+{
+    xengntshr_handle *xgs = xengntshr_open(NULL, 0);
+    xengnttab_handle *xgt = xengnttab_open(NULL, 0);
+    uint32_t ref;
+    void *shared, *map;
+    unsigned long i;
+    uint64_t start;
+
+    if ( !xgs || !xgt )
+        err(1, "xengnttab/xengntshr open");
+
+    shared = xengntshr_share_pages(xgs, 0, 1, &ref, 1);
+    if ( !shared )
+        err(1, "xengntshr_share_pages");
+
+    start = now_ns();
+    for ( i = 0; i < iters; i++ )
+    {
+        map = xengnttab_map_grant_ref(xgt, 0, ref, PROT_READ | PROT_WRITE);
+        if ( !map )
+            err(1, "xengnttab_map_grant_ref");
+        if ( xengnttab_unmap(xgt, map, 1) )
+            err(1, "xengnttab_unmap");
+    }
+    res->ns_total = now_ns() - start;
+    res->iterations = iters;
+
+    xengntshr_unshare(xgs, shared, 1);
+    xengnttab_close(xgt);
+    xengntshr_close(xgs);
+}
+
+/*
+ * Scheduler wake latency: a child process blocks on an event channel
+ * and timestamps its wakeup; the parent timestamps the notify. The
+ * delta covers the hypervisor delivery path plus the dom0 scheduler
+ * waking the child.
+ */
+
+struct wake_shm {
+    volatile uint64_t t_sent;
+    volatile uint64_t ns_total;
+    volatile uint64_t ns_max;
+    volatile int ready;
+};
+
+static void bench_sched(struct result *res, unsigned long iters)
+{
+    xenevtchn_handle *xce_a;
+    evtchn_port_t pa;
+    struct wake_shm *shm;
+    unsigned long i;
+    pid_t pid;
+
+    shm = mmap(NULL, sizeof(*shm), PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if ( shm == MAP_FAILED )
+        err(1, "mmap");
+
+    xce_a = xenevtchn_open(NULL, 0);
+    if ( !xce_a )
+        err(1, "xenevtchn_open");
+
+    pa = xenevtchn_bind_unbound_port(xce_a, 0);
+    if ( (int)pa < 0 )
+        err(1, "xenevtchn_bind_unbound_port");
+
+    pid = fork();
+    if ( pid < 0 )
+        err(1, "fork");
+
+    if ( !pid )
+    {
+        xenevtchn_handle *xce_b = xenevtchn_open(NULL, 0);
+        evtchn_port_t pb;
+
+        if ( !xce_b )
+            err(1, "xenevtchn_open (child)");
+        pb = xenevtchn_bind_interdomain(xce_b, 0, pa);
+        if ( (int)pb < 0 )
+            err(1, "xenevtchn_bind_interdomain (child)");
+
+        shm->ready = 1;
+
+        for ( i = 0; i < iters; i++ )
+        {
+            uint64_t lat;
+
+            if ( xenevtchn_pending(xce_b) != pb )
+                errx(1, "unexpected port pending in child");
+            lat = now_ns() - shm->t_sent;
+            shm->ns_total += lat;
+            if ( lat > shm->ns_max )
+                shm->ns_max = lat;
+            xenevtchn_unmask(xce_b, pb);
+
+            /* Ack, so the parent knows we are blocked again. */
+            xenevtchn_notify(xce_b, pb);
+        }
+
+        xenevtchn_close(xce_b);
+        exit(0);
+    }
+
+    while ( !shm->ready )
+        usleep(1000);
+
+    for ( i = 0; i < iters; i++ )
+    {
+        shm->t_sent = now_ns();
+        if ( xenevtchn_notify(xce_a, pa) )
+            err(1, "xenevtchn_notify");
+        if ( xenevtchn_pending(xce_a) != pa )
+            errx(1, "unexpected port pending in parent");
+        xenevtchn_unmask(xce_a, pa);
+    }
+
+    if ( waitpid(pid, NULL, 0) < 0 )
+        err(1, "waitpid");
+
+    res->iterations = iters;
+    res->ns_total = shm->ns_total;
+    res->ns_max = shm->ns_max;
+
+    xenevtchn_close(xce_a);
+    munmap(shm, sizeof(*shm));
+}
+
+static struct {
+    const char *name;
+    void (*fn)(struct result *res, unsigned long iters);
+    /* Blocking benchmarks need fewer iterations to be stable. */
+    unsigned long iter_div;
+} benchmarks[] = {
+    { "hypercall", bench_hypercall, 1 },
+    { "evtchn",    bench_evtchn,    1 },
+    { "gnttab",    bench_gnttab,    1 },
+    { "sched",     bench_sched,     10 },
+};
+
+static void emit_json(FILE *out, const struct result *res, unsigned int nr)
+{
+    unsigned int i;
+
+    fprintf(out, "{\n  \"version\": 1,\n  \"results\": [\n");
+    for ( i = 0; i < nr; i++ )
+    {
+        uint64_t ns_per_op = res[i].ns_total / res[i].iterations;
+
+        fprintf(out,
+                "    { \"name\": \"%s\", \"iterations\": %lu,"
+                " \"ns_per_op\": %"PRIu64", \"ops_per_sec\": %"PRIu64,
+                res[i].name, res[i].iterations, ns_per_op,
+                ns_per_op ? UINT64_C(1000000000) / ns_per_op
+                          : UINT64_C(0));
+        if ( res[i].ns_max )
+            fprintf(out, ", \"ns_max\": %"PRIu64, res[i].ns_max);
+        fprintf(out, " }%s\n", i + 1 < nr ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+static void usage(const char *prog)
+{
+    unsigned int i;
+
+    fprintf(stderr,
+            "usage: %s [-i iterations] [-o output.json] [bench]...\n"
+            "Benchmarks (default: all):", prog);
+    for ( i = 0; i < ARRAY_SIZE(benchmarks); i++ )
+        fprintf(stderr, " %s", benchmarks[i].name);
+    fprintf(stderr, "\n");
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    struct result results[ARRAY_SIZE(benchmarks)];
+    unsigned long iters = DEFAULT_ITERATIONS;
+    unsigned int i, nr_results = 0;
+    FILE *out = stdout;
+    const char *outfile = NULL;
+    int opt;
+
+    while ( (opt = getopt(argc, argv, "i:o:h")) != -1 )
+    {
+        switch ( opt )
+        {
+        case 'i':
+            iters = strtoul(optarg, NULL, 0);
+            if ( !iters )
+                usage(argv[0]);
+            break;
+        case 'o':
+            outfile = optarg;
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+
+    for ( i = 0; i < ARRAY_SIZE(benchmarks); i++ )
+    {
+        int j, requested = (optind == argc);
+
+        for ( j = optind; j < argc; j++ )
+            if ( !strcmp(argv[j], benchmarks[i].name) )
+                requested = 1;
+
+        if ( !requested )
+            continue;
+
+        memset(&results[nr_results], 0, sizeof(results[nr_results]));
+        results[nr_results].name = benchmarks[i].name;
+        fprintf(stderr, "running %s...\n", benchmarks[i].name);
+        benchmarks[i].fn(&results[nr_results],
+                         iters / benchmarks[i].iter_div ?: 1);
+        nr_results++;
+    }
+
+    if ( !nr_results )
+        usage(argv[0]);
+
+    if ( outfile )
+    {
+        out = fopen(outfile, "w");
+        if ( !out )
+            err(1, "fopen %s", outfile);
+    }
+
+    emit_json(out, results, nr_results);
+
+    if ( outfile )
+        fclose(out);
+
+    return 0;
+}
+
+/*
+ * Local variables:
+ * mode: C
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,124 @@
+/*
+ * Streaming bandwidth benchmark for libxenvchan.
+ *
+ * Run the server in one domain and the client in the other:
+ *
+ *   vchan-bench server <client-domid> <nodepath> [ring-order] [megabytes]
+ *   vchan-bench client <server-domid> <nodepath> [megabytes]
+ *
+ * The client streams the requested amount of data to the server; both
+ * sides report the achieved copy bandwidth.  Vary ring-order (log2 of
+ * the ring size in bytes, 10..20) to validate bandwidth scaling with
+ * multi-page rings.  Both rings use the same order and their grant
+ * lists share the control page, which caps the symmetric size at 1MB
+ * per direction.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <libxenvchan.h>
+
+#define DEFAULT_ORDER 20
+#define DEFAULT_MEGABYTES 1024
+#define CHUNK_SIZE (1 << 18)
+
+static char chunk[CHUNK_SIZE];
+
+static void usage(char **argv)
+{
+	fprintf(stderr, "usage:\n"
+		"\t%s server domid nodepath [ring-order] [megabytes]\n"
+		"\t%s client domid nodepath [megabytes]\n",
+		argv[0], argv[0]);
+	exit(1);
+}
+
+static double elapsed_seconds(const struct timespec *from)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - from->tv_sec) +
+	       (now.tv_nsec - from->tv_nsec) / 1e9;
+}
+
+static void report(const char *role, unsigned long long bytes, double secs)
+{
+	printf("%s: %llu bytes in %.3fs: %.1f MB/s\n",
+	       role, bytes, secs, bytes / (secs * 1048576.0));
+}
+
+int main(int argc, char **argv)
+{
+	struct libxenvchan *ctrl;
+	struct timespec start;
+	unsigned long long total, done = 0;
+	int is_server, order = DEFAULT_ORDER, megabytes = DEFAULT_MEGABYTES;
+	int ret;
+
+	if (argc < 4)
+		usage(argv);
+
+	if (!strcmp(argv[1], "server")) {
+		is_server = 1;
+		if (argc > 4)
+			order = atoi(argv[4]);
+		if (argc > 5)
+			megabytes = atoi(argv[5]);
+	} else if (!strcmp(argv[1], "client")) {
+		is_server = 0;
+		if (argc > 4)
+			megabytes = atoi(argv[4]);
+	} else
+		usage(argv);
+
+	if (order < 10 || order > 20 || megabytes <= 0)
+		usage(argv);
+	total = (unsigned long long)megabytes << 20;
+
+	if (is_server)
+		ctrl = libxenvchan_server_init(NULL, atoi(argv[2]), argv[3],
+					       (size_t)1 << order,
+					       (size_t)1 << order);
+	else
+		ctrl = libxenvchan_client_init(NULL, atoi(argv[2]), argv[3]);
+	if (!ctrl) {
+		perror("libxenvchan_*_init");
+		exit(1);
+	}
+	ctrl->blocking = 1;
+
+	memset(chunk, 0x5a, sizeof(chunk));
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	while (done < total) {
+		size_t len = sizeof(chunk);
+
+		if (total - done < len)
+			len = total - done;
+
+		if (is_server)
+			ret = libxenvchan_read(ctrl, chunk, len);
+		else
+			ret = libxenvchan_write(ctrl, chunk, len);
+		if (ret <= 0) {
+			perror(is_server ? "read" : "write");
+			exit(1);
+		}
+		done += ret;
+	}
+
+	report(is_server ? "server" : "client", done, elapsed_seconds(&start));
+
+	libxenvchan_close(ctrl);
+	return 0;
+}
@@ -26,6 +26,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define container_of(ptr, type, member) ({                      \
         typeof(((type *)0)->member) *mptr = (ptr);              \
@@ -80,6 +81,29 @@ typedef union {
     };
 } pci_sbdf_t;
 
+#define BITS_PER_LONG (sizeof(unsigned long) * 8)
+#define BITS_TO_LONGS(bits) \
+    (((bits) + BITS_PER_LONG - 1) / BITS_PER_LONG)
+#define DECLARE_BITMAP(name, bits) \
+    unsigned long name[BITS_TO_LONGS(bits)]
+
+static inline void __set_bit(unsigned int nr, unsigned long *addr)
+{
+    addr[nr / BITS_PER_LONG] |= 1UL << (nr % BITS_PER_LONG);
+}
+
+static inline void __clear_bit(unsigned int nr, unsigned long *addr)
+{
+    addr[nr / BITS_PER_LONG] &= ~(1UL << (nr % BITS_PER_LONG));
+}
+
+static inline bool test_bit(unsigned int nr, const unsigned long *addr)
+{
+    return addr[nr / BITS_PER_LONG] & (1UL << (nr % BITS_PER_LONG));
+}
+
+#define PCI_CFG_SPACE_EXP_SIZE 4096
+
 #define CONFIG_HAS_VPCI
 #include "vpci.h"
 
@@ -89,6 +113,7 @@ typedef union {
 
 #define xzalloc(type) ((type *)calloc(1, sizeof(type)))
 #define xmalloc(type) ((type *)malloc(sizeof(type)))
+#define xmalloc_array(type, num) ((type *)malloc(sizeof(type) * (num)))
 #define xfree(p) free(p)
 
 #define pci_get_pdev_by_domain(...) &test_pdev
@@ -101,8 +126,6 @@ typedef union {
 #define pci_conf_write16(...)
 #define pci_conf_write32(...)
 
-#define PCI_CFG_SPACE_EXP_SIZE 4096
-
 #define BUG() assert(0)
 #define ASSERT_UNREACHABLE() assert(0)
 
@@ -157,7 +157,6 @@ main(int argc, char **argv)
     unsigned int i;
     int rc;
 
-    INIT_LIST_HEAD(&vpci.handlers);
     spin_lock_init(&vpci.lock);
 
     VPCI_ADD_REG(vpci_read32, vpci_write32, 0, 4, r0);
@@ -82,6 +82,7 @@ typedef struct settings_st {
     unsigned long new_data_thresh;
     unsigned long ms_per_sample;
     double cpu_freq;
+    int runstate_poll;          // poll runstate times instead of tracing
 } settings_t;
 
 struct t_struct {
@@ -115,6 +116,7 @@ static void advance_next_datapoint(uint64_t);
 static void alloc_qos_data(int ncpu);
 static int process_record(int, struct t_rec *);
 static void qos_kill_thread(int domid);
+static int indexof(int domid);
 
 
 static void init_current(int ncpu)
@@ -544,6 +546,94 @@ static int monitor_tbufs(void)
     return 0;
 }
 
+/**
+ * monitor_runstates - periodically poll per-domain runstate times
+ *
+ * Alternative to trace buffer processing: the hypervisor already keeps
+ * aggregate run/runnable/blocked times for every vcpu, so instead of
+ * consuming every scheduler event we just sample the per-domain totals
+ * once per poll interval (one domctl per domain) and feed the deltas
+ * into the same shared memory structure that xenmon reads.  All time is
+ * attributed to a single virtual cpu since the totals are domain-wide.
+ */
+static int monitor_runstates(void)
+{
+    xc_interface *xc_handle;
+    uint64_t prev_gotten[NDOMAINS] = {0};
+    uint64_t prev_waiting[NDOMAINS] = {0};
+    uint64_t prev_blocked[NDOMAINS] = {0};
+    int prev_id[NDOMAINS];
+    uint64_t last_now = 0;
+    int i;
+
+    for (i=0; i<NDOMAINS; i++)
+        prev_id[i] = -1;
+
+    init_current(1);
+    alloc_qos_data(1);
+    new_qos = cpu_qos_data[0];
+
+    if ((xc_handle = xc_interface_open(0,0,0)) == 0) {
+        PERROR("Failure to open xc interface");
+        return 1;
+    }
+
+    while ( !interrupted )
+    {
+        xc_dominfo_t dominfo[NDOMAINS];
+        struct timespec ts;
+        uint64_t now;
+        int n, ndomains;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        now = (uint64_t)ts.tv_sec * billion + ts.tv_nsec;
+        global_now = now;
+
+        ndomains = xc_domain_getinfo(xc_handle, 0, NDOMAINS, dominfo);
+
+        n = new_qos->next_datapoint;
+
+        for (i=0; i<ndomains; i++) {
+            xc_runstate_times_t rt;
+            int domid = dominfo[i].domid;
+            int idx;
+
+            if (xc_domain_get_runstate_times(xc_handle, domid, &rt) != 0)
+                continue;       // domain may have just gone away
+
+            idx = indexof(domid);
+
+            if (prev_id[idx] == domid) {
+                new_qos->qdata[n].ns_gotten[idx]  += rt.running  - prev_gotten[idx];
+                new_qos->qdata[n].ns_waiting[idx] += rt.runnable - prev_waiting[idx];
+                new_qos->qdata[n].ns_blocked[idx] += rt.blocked  - prev_blocked[idx];
+            }
+            else
+                prev_id[idx] = domid; // slot is new or recycled; prime only
+
+            prev_gotten[idx]  = rt.running;
+            prev_waiting[idx] = rt.runnable;
+            prev_blocked[idx] = rt.blocked;
+            new_qos->domain_info[idx].ns_oncpu_since_boot = rt.running;
+        }
+
+        if (last_now != 0)
+            new_qos->qdata[n].ns_passed += now - last_now;
+        new_qos->qdata[n].timestamp = now;
+        last_now = now;
+
+        if (new_qos->qdata[n].ns_passed > (million*opts.ms_per_sample))
+            advance_next_datapoint(now);
+
+        nanosleep(&opts.poll_sleep, NULL);
+        wakeups++;
+    }
+
+    xc_interface_close(xc_handle);
+
+    return 0;
+}
+
 
 /******************************************************************************
  * Command line handling
@@ -569,6 +659,9 @@ static void usage(void)
 "  -t, --log-thresh=l         Set number, l, of new records required to\n" \
 "                             trigger a write to output (default " \
                               xstr(NEW_DATA_THRESH) ").\n" \
+"  -r, --runstate             Poll per-domain runstate times instead of\n" \
+"                             processing trace buffer data (lower overhead,\n" \
+"                             no per-cpu or I/O statistics)\n" \
 "  -?, --help                 Show this message\n" \
 " -V, --version              Print program version\n" \
 "\n" \
@@ -610,12 +703,13 @@ static void parse_args(int argc, char **argv)
         { "log-thresh",    required_argument, 0, 't' },
         { "poll-sleep",    required_argument, 0, 's' },
         { "ms_per_sample", required_argument, 0, 'm' },
+        { "runstate",      no_argument,       0, 'r' },
         { "help",          no_argument,       0, '?' },
         { "version",       no_argument,       0, 'V' },
         { 0, 0, 0, 0 }
     };
 
-    while ( (option = getopt_long(argc, argv, "m:s:t:?V",
+    while ( (option = getopt_long(argc, argv, "m:rs:t:?V",
                     long_options, NULL)) != -1)
     {
         switch ( option )
@@ -632,6 +726,10 @@ static void parse_args(int argc, char **argv)
                 opts.ms_per_sample = argtol(optarg, 0);
                 break;
 
+            case 'r': /* poll runstate times rather than tracing */
+                opts.runstate_poll = 1;
+                break;
+
             case 'V': /* print program version */
                 printf("%s\n", program_version);
                 exit(EXIT_SUCCESS);
@@ -711,6 +809,7 @@ int main(int argc, char **argv)
     opts.new_data_thresh = NEW_DATA_THRESH;
     opts.ms_per_sample = MS_PER_SAMPLE;
     opts.cpu_freq = CPU_FREQ;
+    opts.runstate_poll = 0;
 
     parse_args(argc, argv);
     fprintf(stderr, "ms_per_sample = %ld\n", opts.ms_per_sample);
@@ -724,11 +823,15 @@ int main(int argc, char **argv)
     sigaction(SIGTERM, &act, NULL);
     sigaction(SIGINT,  &act, NULL);
 
-    ret = monitor_tbufs();
+    if (opts.runstate_poll)
+        ret = monitor_runstates();
+    else
+        ret = monitor_tbufs();
 
     dump_stats();
     msync(new_qos, sizeof(_new_qos_data), MS_SYNC);
-    disable_tracing();
+    if (!opts.runstate_poll)
+        disable_tracing();
 
     return ret;
 }
@@ -20,22 +20,19 @@
 
 
 #include <unistd.h>
+#include <sys/uio.h>
 #include <xc_private.h>
 
 static int file_op(int fd, void *page, int i,
-                   ssize_t (*fn)(int, void *, size_t))
+                   ssize_t (*fn)(int, void *, size_t, off_t))
 {
-    off_t offset = i;
+    off_t offset = (off_t)i << PAGE_SHIFT;
     int total = 0;
     int bytes;
 
-    offset = lseek(fd, offset << PAGE_SHIFT, SEEK_SET);
-    if ( offset == (off_t)-1 )
-        return -1;
-
     while ( total < PAGE_SIZE )
     {
-        bytes = fn(fd, page + total, PAGE_SIZE - total);
+        bytes = fn(fd, page + total, PAGE_SIZE - total, offset + total);
         if ( bytes <= 0 )
             return -1;
 
@@ -45,19 +42,57 @@ static int file_op(int fd, void *page, int i,
     return 0;
 }
 
-static ssize_t my_write(int fd, void *buf, size_t count)
+static ssize_t my_pread(int fd, void *buf, size_t count, off_t offset)
 {
-    return write(fd, buf, count);
+    return pread(fd, buf, count, offset);
+}
+
+static ssize_t my_pwrite(int fd, void *buf, size_t count, off_t offset)
+{
+    return pwrite(fd, buf, count, offset);
 }
 
 int read_page(int fd, void *page, int i)
 {
-    return file_op(fd, page, i, &read);
+    return file_op(fd, page, i, &my_pread);
 }
 
 int write_page(int fd, void *page, int i)
 {
-    return file_op(fd, page, i, &my_write);
+    return file_op(fd, page, i, &my_pwrite);
+}
+
+/* Write nr pages from a contiguous buffer to consecutive pagefile slots
+ * starting at slot, with a single vectored request where possible. */
+int write_pages(int fd, void *pages, int slot, int nr)
+{
+    struct iovec iov[nr];
+    off_t offset = (off_t)slot << PAGE_SHIFT;
+    size_t total = (size_t)nr << PAGE_SHIFT;
+    size_t done = 0;
+    ssize_t bytes;
+
+    while ( done < total )
+    {
+        size_t skip = done & (PAGE_SIZE - 1);
+        int i, cnt = 0;
+
+        for ( i = done >> PAGE_SHIFT; i < nr; i++ )
+        {
+            iov[cnt].iov_base = pages + ((size_t)i << PAGE_SHIFT) + skip;
+            iov[cnt].iov_len = PAGE_SIZE - skip;
+            skip = 0;
+            cnt++;
+        }
+
+        bytes = pwritev(fd, iov, cnt, offset + done);
+        if ( bytes <= 0 )
+            return -1;
+
+        done += bytes;
+    }
+
+    return 0;
 }
 
 
@@ -26,6 +26,7 @@
 
 int read_page(int fd, void *page, int i);
 int write_page(int fd, void *page, int i);
+int write_pages(int fd, void *pages, int slot, int nr);
 
 
 #endif
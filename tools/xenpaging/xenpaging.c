@@ -587,86 +587,119 @@ static void put_response(struct vm_event *vm_event, vm_event_response_t *rsp)
     RING_PUSH_RESPONSES(back_ring);
 }
 
-/* Evict a given gfn
+/* Evict up to nr gfns into the consecutive free pagefile slots starting
+ * at slot. The victims are nominated in one go, mapped with a single
+ * foreign mapping and written out with one vectored request, so bulk
+ * page-out runs at the speed of the disk rather than one synchronous
+ * write per page.
  * Returns < 0 on fatal error
- * Returns 0 on successful evict
- * Returns > 0 if gfn can not be evicted
+ * Returns the number of evicted pages otherwise; less than nr if the
+ * policy ran out of victims or nominated pages turned out to be busy.
  */
-static int xenpaging_evict_page(struct xenpaging *paging, unsigned long gfn, int slot)
+static int evict_batch(struct xenpaging *paging, int slot, int nr)
 {
     xc_interface *xch = paging->xc_handle;
-    void *page;
-    xen_pfn_t victim = gfn;
-    int ret;
-
-    DECLARE_DOMCTL;
+    xen_pfn_t gfns[XENPAGING_EVICT_BATCH_SIZE];
+    unsigned long gfn;
+    static int num_paged_out;
+    void *pages;
+    int i, ret, num = 0, evicted = 0;
 
-    /* Nominate page */
-    ret = xc_mem_paging_nominate(xch, paging->vm_event.domain_id, gfn);
-    if ( ret < 0 )
+    /* Nominate a batch of victims */
+    while ( num < nr && !interrupted )
     {
-        /* unpageable gfn is indicated by EBUSY */
-        if ( errno == EBUSY )
-            ret = 1;
-        else
+        gfn = policy_choose_victim(paging);
+        if ( gfn == INVALID_MFN )
+        {
+            /* If the number did not change after last flush command then
+             * the command did not reach qemu yet, or qemu still processes
+             * the command, or qemu has nothing to release.
+             * Right now there is no need to issue the command again.
+             */
+            if ( !num && num_paged_out != paging->num_paged_out )
+            {
+                DPRINTF("Flushing qemu cache\n");
+                xenpaging_mem_paging_flush_ioemu_cache(paging);
+                num_paged_out = paging->num_paged_out;
+            }
+            break;
+        }
+
+        ret = xc_mem_paging_nominate(xch, paging->vm_event.domain_id, gfn);
+        if ( ret < 0 )
+        {
+            /* unpageable gfn is indicated by EBUSY, try another victim */
+            if ( errno == EBUSY )
+                continue;
             PERROR("Error nominating page %lx", gfn);
-        goto out;
+            return -1;
+        }
+
+        gfns[num++] = gfn;
     }
 
-    /* Map page */
-    page = xc_map_foreign_pages(xch, paging->vm_event.domain_id, PROT_READ, &victim, 1);
-    if ( page == NULL )
+    if ( !num )
+        return 0;
+
+    /* Map all victims with a single mapping */
+    pages = xc_map_foreign_pages(xch, paging->vm_event.domain_id, PROT_READ,
+                                 gfns, num);
+    if ( pages == NULL )
     {
-        PERROR("Error mapping page %lx", gfn);
-        ret = -1;
-        goto out;
+        PERROR("Error mapping %d pages for batch at slot %d", num, slot);
+        return -1;
     }
 
-    /* Copy page */
-    ret = write_page(paging->fd, page, slot);
+    /* Copy pages with one vectored write */
+    ret = write_pages(paging->fd, pages, slot, num);
+    munmap(pages, PAGE_SIZE * num);
     if ( ret < 0 )
     {
-        PERROR("Error copying page %lx", gfn);
-        munmap(page, PAGE_SIZE);
-        ret = -1;
-        goto out;
+        PERROR("Error copying batch of %d pages to slot %d", num, slot);
+        return -1;
     }
 
-    /* Release page */
-    munmap(page, PAGE_SIZE);
-
-    /* Tell Xen to evict page */
-    ret = xc_mem_paging_evict(xch, paging->vm_event.domain_id, gfn);
-    if ( ret < 0 )
+    /* Tell Xen to evict the pages. A busy gfn stays resident, its slot
+     * simply remains free and is picked up by a later scan. */
+    for ( i = 0; i < num; i++ )
     {
-        /* A gfn in use is indicated by EBUSY */
-        if ( errno == EBUSY )
+        gfn = gfns[i];
+        ret = xc_mem_paging_evict(xch, paging->vm_event.domain_id, gfn);
+        if ( ret < 0 )
         {
-                ret = 1;
+            /* A gfn in use is indicated by EBUSY */
+            if ( errno == EBUSY )
+            {
                 DPRINTF("Nominated page %lx busy", gfn);
-        } else
+                continue;
+            }
             PERROR("Error evicting page %lx", gfn);
-        goto out;
-    }
+            return -1;
+        }
 
-    DPRINTF("evict_page > gfn %lx pageslot %d\n", gfn, slot);
-    /* Notify policy of page being paged out */
-    policy_notify_paged_out(gfn);
+        DPRINTF("evict_page > gfn %lx pageslot %d\n", gfn, slot + i);
+        /* Notify policy of page being paged out */
+        policy_notify_paged_out(gfn);
 
-    /* Update index */
-    paging->slot_to_gfn[slot] = gfn;
-    paging->gfn_to_slot[gfn] = slot;
+        /* Update index */
+        paging->slot_to_gfn[slot + i] = gfn;
+        paging->gfn_to_slot[gfn] = slot + i;
 
-    /* Record number of evicted pages */
-    paging->num_paged_out++;
+        /* Record number of evicted pages */
+        paging->num_paged_out++;
 
-    ret = 0;
+        if ( test_and_set_bit(gfn, paging->bitmap) )
+            ERROR("Page %lx has been evicted before", gfn);
 
- out:
-    return ret;
+        evicted++;
+    }
+
+    return evicted;
 }
 
-static int xenpaging_resume_page(struct xenpaging *paging, vm_event_response_t *rsp, int notify_policy)
+/* Queue a response on the ring. The event channel notification is sent
+ * once per batch of responses by the caller, not per page. */
+static void xenpaging_resume_page(struct xenpaging *paging, vm_event_response_t *rsp, int notify_policy)
 {
     /* Put the page info on the ring */
     put_response(&paging->vm_event, rsp);
@@ -686,9 +719,6 @@ static int xenpaging_resume_page(struct xenpaging *paging, vm_event_response_t *
        /* Record number of resumed pages */
        paging->num_paged_out--;
     }
-
-    /* Tell Xen page is ready */
-    return xenevtchn_notify(paging->vm_event.xce_handle, paging->vm_event.port);
 }
 
 static int xenpaging_populate_page(struct xenpaging *paging, unsigned long gfn, int i)
@@ -753,60 +783,7 @@ static void resume_pages(struct xenpaging *paging, int num_pages)
         page_in_trigger();
 }
 
-/* Evict one gfn and write it to the given slot
- * Returns < 0 on fatal error
- * Returns 0 on successful evict
- * Returns > 0 if no gfn can be evicted
- */
-static int evict_victim(struct xenpaging *paging, int slot)
-{
-    xc_interface *xch = paging->xc_handle;
-    unsigned long gfn;
-    static int num_paged_out;
-    int ret;
-
-    do
-    {
-        gfn = policy_choose_victim(paging);
-        if ( gfn == INVALID_MFN )
-        {
-            /* If the number did not change after last flush command then
-             * the command did not reach qemu yet, or qemu still processes
-             * the command, or qemu has nothing to release.
-             * Right now there is no need to issue the command again.
-             */
-            if ( num_paged_out != paging->num_paged_out )
-            {
-                DPRINTF("Flushing qemu cache\n");
-                xenpaging_mem_paging_flush_ioemu_cache(paging);
-                num_paged_out = paging->num_paged_out;
-            }
-            ret = ENOSPC;
-            goto out;
-        }
-
-        if ( interrupted )
-        {
-            ret = EINTR;
-            goto out;
-        }
-
-        ret = xenpaging_evict_page(paging, gfn, slot);
-        if ( ret < 0 )
-            goto out;
-    }
-    while ( ret );
-
-    if ( test_and_set_bit(gfn, paging->bitmap) )
-        ERROR("Page %lx has been evicted before", gfn);
-
-    ret = 0;
-
- out:
-    return ret;
-}
-
-/* Evict a batch of pages and write them to a free slot in the paging file
+/* Evict a batch of pages and write them to free slots in the paging file
  * Returns < 0 on fatal error
  * Returns 0 if no gfn can be evicted
  * Returns > 0 on successful evict
@@ -819,31 +796,42 @@ static int evict_pages(struct xenpaging *paging, int num_pages)
     /* Reuse known free slots */
     while ( paging->stack_count > 0 && num < num_pages )
     {
-        slot = paging->free_slot_stack[--paging->stack_count];
-        rc = evict_victim(paging, slot);
-        if ( rc )
-        {
-            num = rc < 0 ? -1 : num;
+        slot = paging->free_slot_stack[paging->stack_count - 1];
+        rc = evict_batch(paging, slot, 1);
+        if ( rc < 0 )
+            return -1;
+        /* No victim evicted, caller has to try again */
+        if ( rc == 0 )
             return num;
-        }
+        paging->stack_count--;
         num++;
     }
 
-    /* Scan all slots slots for remainders */
+    /* Scan for runs of free slots and evict batches into them */
     for ( slot = 0; slot < paging->max_pages && num < num_pages; slot++ )
     {
+        int run = 0;
+
         /* Slot is allocated */
         if ( paging->slot_to_gfn[slot] )
             continue;
 
-        rc = evict_victim(paging, slot);
-        if ( rc )
-        {
-            num = rc < 0 ? -1 : num;
+        while ( slot + run < paging->max_pages &&
+                run < XENPAGING_EVICT_BATCH_SIZE &&
+                num + run < num_pages &&
+                !paging->slot_to_gfn[slot + run] )
+            run++;
+
+        rc = evict_batch(paging, slot, run);
+        if ( rc < 0 )
+            return -1;
+
+        num += rc;
+        /* Out of victims (or busy pages), caller has to try again */
+        if ( rc < run )
             break;
-        }
 
-        num++;
+        slot += run - 1;
     }
     return num;
 }
@@ -855,6 +843,7 @@ int main(int argc, char *argv[])
     vm_event_request_t req;
     vm_event_response_t rsp;
     int num, prev_num = 0;
+    int rsp_count = 0;
     int slot;
     int tot_pages;
     int rc;
@@ -949,11 +938,8 @@ int main(int argc, char *argv[])
                 rsp.vcpu_id = req.vcpu_id;
                 rsp.flags = req.flags;
 
-                if ( xenpaging_resume_page(paging, &rsp, 1) < 0 )
-                {
-                    PERROR("Error resuming page %"PRIx64"", req.u.mem_paging.gfn);
-                    goto out;
-                }
+                xenpaging_resume_page(paging, &rsp, 1);
+                rsp_count++;
 
                 /* Clear this pagefile slot */
                 paging->slot_to_gfn[slot] = 0;
@@ -979,15 +965,24 @@ int main(int argc, char *argv[])
                     rsp.vcpu_id = req.vcpu_id;
                     rsp.flags = req.flags;
 
-                    if ( xenpaging_resume_page(paging, &rsp, 0) < 0 )
-                    {
-                        PERROR("Error resuming page %"PRIx64"", req.u.mem_paging.gfn);
-                        goto out;
-                    }
+                    xenpaging_resume_page(paging, &rsp, 0);
+                    rsp_count++;
                 }
             }
         }
 
+        /* Tell Xen the queued pages are ready, once for the whole batch */
+        if ( rsp_count )
+        {
+            rsp_count = 0;
+            if ( xenevtchn_notify(paging->vm_event.xce_handle,
+                                  paging->vm_event.port) < 0 )
+            {
+                PERROR("Error notifying responses");
+                goto out;
+            }
+        }
+
         /* If interrupted, write all pages back into the guest */
         if ( interrupted == SIGTERM || interrupted == SIGINT )
         {
@@ -32,6 +32,9 @@
 #include <xen/vm_event.h>
 
 #define XENPAGING_PAGEIN_QUEUE_SIZE 64
+/* Pages evicted in one batch: mapped together, written with one
+ * vectored request */
+#define XENPAGING_EVICT_BATCH_SIZE 16
 
 struct vm_event {
     domid_t domain_id;
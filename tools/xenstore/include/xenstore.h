@@ -47,6 +47,25 @@
  */
 #define XS_UNWATCH_FILTER     (1UL<<2)
 
+/*
+ * Setting XS_OPEN_POOL makes the library open an additional, private
+ * connection to the daemon for each thread issuing requests (up to an
+ * internal limit, beyond which threads share the main connection
+ * again), so concurrent requests on one handle no longer serialise on
+ * a single connection.  Requires a pthread-enabled build; the flag is
+ * ignored otherwise.
+ *
+ * Restrictions in pool mode:
+ * * A transaction is tied to the connection that started it, and hence
+ *   must be used and ended by the thread which called
+ *   xs_transaction_start().
+ * * Requests of one thread still execute in order; only requests of
+ *   different threads run concurrently.
+ * Watch registration and delivery always use the main connection, so
+ * the watch interfaces below are unaffected.
+ */
+#define XS_OPEN_POOL          (1UL<<3)
+
 struct xs_handle;
 typedef uint32_t xs_transaction_t;
 
@@ -116,6 +135,17 @@ char **xs_directory(struct xs_handle *h, xs_transaction_t t,
 void *xs_read(struct xs_handle *h, xs_transaction_t t,
 	      const char *path, unsigned int *len);
 
+/* Get the values of several files in as few exchanges as possible.
+ * Returns a malloced array of num values, each individually malloced
+ * and nul terminated, with lengths in lens[].  Files which could not
+ * be read have a NULL value and a length of zero.
+ * Returns NULL on failure.
+ * Call free() on each value and on the array after use.
+ */
+char **xs_read_batch(struct xs_handle *h, xs_transaction_t t,
+		     char *const *paths, unsigned int num,
+		     unsigned int *lens);
+
 /* Write the value of a single file.
  * Returns false on failure.
  */
@@ -181,6 +211,27 @@ bool xs_watch(struct xs_handle *h, const char *path, const char *token);
 /* Return the FD to poll on to see if a watch has fired. */
 int xs_fileno(struct xs_handle *h);
 
+/* Asynchronous watch delivery: register a callback invoked for every
+ * watch event, with the triggering path and the token from xs_watch.
+ * This replaces the queue/poll scheme: while a callback is registered,
+ * xs_fileno(), xs_read_watch() and xs_check_watch() must not be used.
+ * Registration fails with EBUSY if events are already queued.
+ *
+ * In a pthread-enabled build the callback runs on the library's reader
+ * thread, so it must not block for long and must not issue requests on
+ * this handle unless it was opened with XS_OPEN_POOL (watch requests,
+ * which always use the reader thread's connection, would deadlock even
+ * then).  Without pthreads, events are delivered from within the watch
+ * reading functions.
+ *
+ * Pass fn == NULL to remove the callback again.
+ * Returns false on failure.
+ */
+typedef void xs_watch_cb_fn(void *opaque, const char *path,
+			    const char *token);
+bool xs_watch_set_callback(struct xs_handle *h, xs_watch_cb_fn *fn,
+			   void *opaque);
+
 /* Check for node changes.  On success, returns a non-NULL pointer ret
  * such that ret[0] and ret[1] are valid C strings, namely the
  * triggering path (see docs/misc/xenstore.txt) and the token (from
@@ -329,20 +329,34 @@ perform(enum mode mode, int optind, int argc, char **argv, struct xs_handle *xsh
             /* CANNOT BE REACHED */
             errx(1, "invalid mode %d", mode);
         case MODE_read: {
-            unsigned len;
-            char *val = xs_read(xsh, xth, argv[optind], &len);
-            if (val == NULL) {
+            unsigned int i, num = argc - optind;
+            unsigned int *lens = malloc(num * sizeof(unsigned int));
+            char **vals;
+
+            if (lens == NULL)
+                err(1, "malloc");
+            /* Fetch all requested paths in as few exchanges as possible. */
+            vals = xs_read_batch(xsh, xth, &argv[optind], num, lens);
+            if (vals == NULL) {
                 warnx("couldn't read path %s", argv[optind]);
                 return 1;
             }
-            if (prefix)
-                output("%s: ", argv[optind]);
-            if (raw)
-                output_raw(val, len);
-            else
-                output("%s\n", sanitise_value(&ebuf, val, len));
-            free(val);
-            optind++;
+            for (i = 0; i < num; i++) {
+                if (vals[i] == NULL) {
+                    warnx("couldn't read path %s", argv[optind + i]);
+                    return 1;
+                }
+                if (prefix)
+                    output("%s: ", argv[optind + i]);
+                if (raw)
+                    output_raw(vals[i], lens[i]);
+                else
+                    output("%s\n", sanitise_value(&ebuf, vals[i], lens[i]));
+                free(vals[i]);
+            }
+            free(vals);
+            free(lens);
+            optind += num;
             break;
         }
         case MODE_write: {
@@ -127,6 +127,28 @@ static int do_control_print(void *ctx, struct connection *conn,
 	return 0;
 }
 
+static int do_control_stats(void *ctx, struct connection *conn,
+			    char **vec, int num)
+{
+	char *resp;
+
+	if (num > 1 || (num == 1 && !streq(vec[0], "reset")))
+		return EINVAL;
+
+	if (num == 1) {
+		request_stats_reset();
+		send_ack(conn, XS_CONTROL);
+		return 0;
+	}
+
+	resp = request_stats_dump(ctx);
+	if (!resp)
+		return ENOMEM;
+
+	send_reply(conn, XS_CONTROL, resp, strlen(resp) + 1);
+	return 0;
+}
+
 static int do_control_help(void *, struct connection *, char **, int);
 
 static struct cmd_s cmds[] = {
@@ -135,6 +157,7 @@ static struct cmd_s cmds[] = {
 	{ "logfile", do_control_logfile, "<file>" },
 	{ "memreport", do_control_memreport, "[<file>]" },
 	{ "print", do_control_print, "<string>" },
+	{ "stats", do_control_stats, "[reset]" },
 	{ "help", do_control_help, "" },
 };
 
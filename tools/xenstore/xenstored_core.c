@@ -248,6 +248,7 @@ static bool write_messages(struct connection *conn)
 	trace_io(conn, out, 1);
 
 	list_del(&out->list);
+	conn->out_depth--;
 	talloc_free(out);
 
 	return true;
@@ -337,6 +338,7 @@ static void initialize_fds(int sock, int *p_sock_pollfd_idx,
 
 	wrl_gettime_now(&now);
 	wrl_log_periodic(now);
+	domain_log_stats(now);
 
 	list_for_each_entry(conn, &connections, list) {
 		if (conn->domain) {
@@ -641,7 +643,7 @@ unsigned int get_strings(struct buffered_data *data,
 	return i;
 }
 
-static void send_error(struct connection *conn, int error)
+static const char *errnum_to_string(int error)
 {
 	unsigned int i;
 
@@ -652,8 +654,14 @@ static void send_error(struct connection *conn, int error)
 			break;
 		}
 	}
-	send_reply(conn, XS_ERROR, xsd_errors[i].errstring,
-			  strlen(xsd_errors[i].errstring) + 1);
+	return xsd_errors[i].errstring;
+}
+
+static void send_error(struct connection *conn, int error)
+{
+	const char *errstring = errnum_to_string(error);
+
+	send_reply(conn, XS_ERROR, errstring, strlen(errstring) + 1);
 }
 
 void send_reply(struct connection *conn, enum xsd_sockmsg_type type,
@@ -706,6 +714,8 @@ void send_reply(struct connection *conn, enum xsd_sockmsg_type type,
 
 	/* Queue for later transmission. */
 	list_add_tail(&bdata->list, &conn->out_list);
+	if (++conn->out_depth > conn->out_depth_max)
+		conn->out_depth_max = conn->out_depth;
 
 	return;
 }
@@ -884,6 +894,67 @@ static int do_read(struct connection *conn, struct buffered_data *in)
 	return 0;
 }
 
+/*
+ * Read several nodes in a single exchange.  The input is a list of paths;
+ * the reply holds one entry per path, in order: the node's data length in
+ * decimal, or the error name if it cannot be read, followed by the data.
+ * The reply is cut short once the payload limit is reached; the client is
+ * expected to re-request the unanswered paths.
+ */
+static int do_read_batch(struct connection *conn, struct buffered_data *in)
+{
+	struct node *node;
+	const char *path;
+	char *data;
+	char lenstr[24];
+	unsigned int num, i, used, lenlen, datalen;
+
+	num = xs_count_strings(in->buffer, in->used);
+	if (num < 1)
+		return EINVAL;
+
+	data = talloc_array(in, char, XENSTORE_PAYLOAD_MAX);
+	if (!data)
+		return ENOMEM;
+
+	used = 0;
+	path = in->buffer;
+	for (i = 0; i < num; i++, path += strlen(path) + 1) {
+		const char *body = NULL;
+
+		node = get_node_canonicalized(conn, in, path, NULL,
+					      XS_PERM_READ);
+		if (node) {
+			lenlen = snprintf(lenstr, sizeof(lenstr), "%u",
+					  node->datalen) + 1;
+			body = node->data;
+			datalen = node->datalen;
+		} else {
+			/* The error name stands in for the length. */
+			lenlen = snprintf(lenstr, sizeof(lenstr), "%s",
+					  errnum_to_string(errno)) + 1;
+			datalen = 0;
+		}
+
+		if (used + lenlen + datalen > XENSTORE_PAYLOAD_MAX) {
+			if (i == 0)
+				return E2BIG;
+			break;
+		}
+
+		memcpy(data + used, lenstr, lenlen);
+		used += lenlen;
+		if (datalen) {
+			memcpy(data + used, body, datalen);
+			used += datalen;
+		}
+	}
+
+	send_reply(conn, XS_READ_BATCH, data, used);
+
+	return 0;
+}
+
 static void delete_node_single(struct connection *conn, struct node *node)
 {
 	TDB_DATA key;
@@ -1290,6 +1361,7 @@ static struct {
 	[XS_SET_TARGET]        = { "SET_TARGET",        do_set_target },
 	[XS_RESET_WATCHES]     = { "RESET_WATCHES",     do_reset_watches },
 	[XS_DIRECTORY_PART]    = { "DIRECTORY_PART",    send_directory_part },
+	[XS_READ_BATCH]        = { "READ_BATCH",        do_read_batch },
 };
 
 static const char *sockmsg_string(enum xsd_sockmsg_type type)
@@ -1300,6 +1372,97 @@ static const char *sockmsg_string(enum xsd_sockmsg_type type)
 	return "**UNKNOWN**";
 }
 
+/*
+ * Per-request-type latency statistics, readable (and resettable) at
+ * runtime via the "stats" control command.  Bucket i of a histogram
+ * counts requests which took less than 2^i microseconds to process;
+ * the last bucket catches everything else.
+ */
+#define REQ_STATS_BUCKETS 20
+
+static struct request_stats {
+	uint64_t count;
+	uint64_t usec_sum;
+	uint64_t usec_max;
+	uint64_t bucket[REQ_STATS_BUCKETS];
+} request_stats[XS_TYPE_COUNT];
+
+static uint64_t monotonic_usec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void request_stats_account(enum xsd_sockmsg_type type, uint64_t usec)
+{
+	struct request_stats *stats;
+	unsigned int i;
+
+	if ((unsigned)type >= XS_TYPE_COUNT)
+		return;
+
+	stats = &request_stats[type];
+	stats->count++;
+	stats->usec_sum += usec;
+	if (usec > stats->usec_max)
+		stats->usec_max = usec;
+	for (i = 0; i < REQ_STATS_BUCKETS - 1; i++)
+		if (usec < (UINT64_C(1) << i))
+			break;
+	stats->bucket[i]++;
+}
+
+void request_stats_reset(void)
+{
+	struct connection *conn;
+
+	memset(request_stats, 0, sizeof(request_stats));
+	list_for_each_entry(conn, &connections, list) {
+		conn->out_depth_max = conn->out_depth;
+		conn->request_cnt = 0;
+	}
+}
+
+char *request_stats_dump(const void *ctx)
+{
+	char *resp = talloc_strdup(ctx, "");
+	struct connection *conn;
+	unsigned int i, j;
+
+	for (i = 0; i < XS_TYPE_COUNT; i++) {
+		const struct request_stats *stats = &request_stats[i];
+
+		if (!resp || !stats->count)
+			continue;
+		resp = talloc_asprintf_append(resp,
+			"%-20s count %8"PRIu64" avg_us %6"PRIu64
+			" max_us %8"PRIu64" hist",
+			sockmsg_string(i), stats->count,
+			stats->usec_sum / stats->count, stats->usec_max);
+		for (j = 0; resp && j < REQ_STATS_BUCKETS; j++)
+			if (stats->bucket[j])
+				resp = talloc_asprintf_append(resp,
+					" %u:%"PRIu64, j, stats->bucket[j]);
+		if (resp)
+			resp = talloc_asprintf_append(resp, "\n");
+	}
+
+	list_for_each_entry(conn, &connections, list) {
+		if (!resp)
+			break;
+		resp = talloc_asprintf_append(resp,
+			"%s %u: queued %u max %u requests %"PRIu64"\n",
+			conn->domain ? "domain" : "socket",
+			conn->domain ? conn->id : (unsigned int)conn->fd,
+			conn->out_depth, conn->out_depth_max,
+			conn->request_cnt);
+	}
+
+	return resp;
+}
+
 /* Process "in" for conn: "in" will vanish after this conversation, so
  * we can talloc off it for temporary variables.  May free "conn".
  */
@@ -1307,6 +1470,7 @@ static void process_message(struct connection *conn, struct buffered_data *in)
 {
 	struct transaction *trans;
 	enum xsd_sockmsg_type type = in->hdr.msg.type;
+	uint64_t start = monotonic_usec();
 	int ret;
 
 	trans = transaction_lookup(conn, in->hdr.msg.tx_id);
@@ -1317,6 +1481,7 @@ static void process_message(struct connection *conn, struct buffered_data *in)
 
 	assert(conn->transaction == NULL);
 	conn->transaction = trans;
+	conn->request_cnt++;
 
 	if ((unsigned)type < XS_TYPE_COUNT && wire_funcs[type].func)
 		ret = wire_funcs[type].func(conn, in);
@@ -1328,6 +1493,8 @@ static void process_message(struct connection *conn, struct buffered_data *in)
 		send_error(conn, ret);
 
 	conn->transaction = NULL;
+
+	request_stats_account(type, monotonic_usec() - start);
 }
 
 static void consider_message(struct connection *conn)
@@ -1479,13 +1646,25 @@ static int readfd(struct connection *conn, void *data, unsigned int len)
 
 static void accept_connection(int sock, bool canwrite)
 {
-	int fd;
+	int fd, flags;
 	struct connection *conn;
 
 	fd = accept(sock, NULL, NULL);
 	if (fd < 0)
 		return;
 
+	/*
+	 * writefd()/readfd() treat EAGAIN as "try again later", but that only
+	 * works if the fd really is non-blocking.  Otherwise a stalled client
+	 * with a full socket buffer blocks the main loop inside write(),
+	 * delaying watch event delivery to every other connection.
+	 */
+	flags = fcntl(fd, F_GETFL);
+	if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+		close(fd);
+		return;
+	}
+
 	conn = new_connection(writefd, readfd);
 	if (conn) {
 		conn->fd = fd;
@@ -1563,7 +1742,7 @@ static void setup_structure(void)
 }
 
 
-static unsigned int hash_from_key_fn(void *k)
+unsigned int hash_from_key_fn(void *k)
 {
 	char *str = k;
 	unsigned int hash = 5381;
@@ -1576,7 +1755,7 @@ static unsigned int hash_from_key_fn(void *k)
 }
 
 
-static int keys_equal_fn(void *key1, void *key2)
+int keys_equal_fn(void *key1, void *key2)
 {
 	return 0 == strcmp((char *)key1, (char *)key2);
 }
@@ -1879,6 +2058,9 @@ static void usage(void)
 "  -R, --no-recovery       to request that no recovery should be attempted when\n"
 "                          the store is corrupted (debug only),\n"
 "  -I, --internal-db       store database in memory, not on disk\n"
+"  -U, --restart           resume from the state file written by a previous\n"
+"                          instance on SIGUSR1, re-binding domain rings,\n"
+"                          event channels and watches,\n"
 "  -V, --verbose           to request verbose execution.\n");
 }
 
@@ -1897,16 +2079,123 @@ static struct option options[] = {
 	{ "trace-file", 1, NULL, 'T' },
 	{ "transaction", 1, NULL, 't' },
 	{ "no-recovery", 0, NULL, 'R' },
+	{ "restart", 0, NULL, 'U' },
 	{ "internal-db", 0, NULL, 'I' },
 	{ "verbose", 0, NULL, 'V' },
 	{ "watch-nb", 1, NULL, 'W' },
 	{ NULL, 0, NULL, 0 } };
 
-extern void dump_conn(struct connection *conn); 
+extern void dump_conn(struct connection *conn);
 int dom0_domid = 0;
 int dom0_event = 0;
 int priv_domid = 0;
 
+/*
+ * Live update: on SIGUSR1 the daemon writes domain connection and watch
+ * state to a handover file and exits; the replacement binary is started
+ * with --restart and resumes from it.  Node data survives in the tdb
+ * (unless --internal-db is in use), pending transactions are implicitly
+ * aborted, and socket clients must reconnect.
+ */
+static volatile sig_atomic_t lu_dump_pending;
+
+static void lu_request_dump(int sig)
+{
+	lu_dump_pending = 1;
+	/* Poke the log pipe so a blocked poll() wakes up. */
+	trigger_reopen_log(sig);
+}
+
+static char *lu_state_path(void *ctx)
+{
+	return talloc_asprintf(ctx, "%s/state-handover", xs_daemon_rundir());
+}
+
+static void lu_dump_state(void)
+{
+	char *filename = lu_state_path(NULL);
+	FILE *f;
+
+	if (!filename)
+		barf("live-update: out of memory");
+
+	f = fopen(filename, "w");
+	if (!f)
+		barf_perror("live-update: could not write %s", filename);
+
+	fprintf(f, "xenstored-state 1\n");
+	dump_domain_connections(f);
+
+	if (fclose(f) != 0)
+		barf_perror("live-update: could not write %s", filename);
+
+	xprintf("live-update: state dumped to %s, exiting\n", filename);
+	talloc_free(filename);
+}
+
+static void lu_restore_state(void)
+{
+	char *filename = lu_state_path(NULL);
+	FILE *f;
+	char line[XENSTORE_ABS_PATH_MAX + 256];
+	unsigned int domid, port, relative;
+	unsigned long mfn;
+	int off, rc;
+
+	if (!filename)
+		barf("live-update: out of memory");
+
+	f = fopen(filename, "r");
+	if (!f) {
+		xprintf("live-update: no state file %s, cold start\n",
+			filename);
+		talloc_free(filename);
+		return;
+	}
+
+	if (!fgets(line, sizeof(line), f) ||
+	    !streq(line, "xenstored-state 1\n"))
+		barf("live-update: %s is not a version 1 state file",
+		     filename);
+
+	while (fgets(line, sizeof(line), f)) {
+		char *end = strchr(line, '\n');
+
+		if (end)
+			*end = '\0';
+
+		if (sscanf(line, "domain %u %lu %u", &domid, &mfn,
+			   &port) == 3) {
+			rc = restore_domain_connection(domid, mfn, port);
+			if (rc)
+				xprintf("live-update: could not restore"
+					" domain %u: %s\n", domid,
+					strerror(rc));
+		} else if (off = 0,
+			   sscanf(line, "watch %u %u %n", &domid, &relative,
+				  &off) == 2 && off) {
+			/* <node> <token>, the token may contain spaces. */
+			char *node = line + off;
+			char *token = strchr(node, ' ');
+
+			if (!token)
+				continue;
+			*token++ = '\0';
+			rc = restore_domain_watch(domid, node, token,
+						  relative);
+			if (rc)
+				xprintf("live-update: could not restore"
+					" watch %s for domain %u: %s\n",
+					node, domid, strerror(rc));
+		}
+	}
+
+	fclose(f);
+	unlink(filename);
+	xprintf("live-update: state restored from %s\n", filename);
+	talloc_free(filename);
+}
+
 int main(int argc, char *argv[])
 {
 	int opt, *sock = NULL, *ro_sock = NULL;
@@ -1914,11 +2203,12 @@ int main(int argc, char *argv[])
 	bool dofork = true;
 	bool outputpid = false;
 	bool no_domain_init = false;
+	bool live_update = false;
 	const char *pidfile = NULL;
 	int timeout;
 
 
-	while ((opt = getopt_long(argc, argv, "DE:F:HNPS:t:T:RVW:", options,
+	while ((opt = getopt_long(argc, argv, "DE:F:HNPS:t:T:RUVW:", options,
 				  NULL)) != -1) {
 		switch (opt) {
 		case 'D':
@@ -1942,6 +2232,9 @@ int main(int argc, char *argv[])
 		case 'R':
 			recovery = false;
 			break;
+		case 'U':
+			live_update = true;
+			break;
 		case 'S':
 			quota_max_entry_size = strtol(optarg, NULL, 10);
 			break;
@@ -2011,6 +2304,10 @@ int main(int argc, char *argv[])
 	/* Restore existing connections. */
 	restore_existing_connections();
 
+	/* Pick up state handed over by the previous instance. */
+	if (live_update)
+		lu_restore_state();
+
 	if (outputpid) {
 		printf("%ld\n", (long)getpid());
 		fflush(stdout);
@@ -2021,6 +2318,7 @@ int main(int argc, char *argv[])
 		finish_daemonize();
 
 	signal(SIGHUP, trigger_reopen_log);
+	signal(SIGUSR1, lu_request_dump);
 	if (tracefile)
 		tracefile = talloc_strdup(NULL, tracefile);
 
@@ -2040,6 +2338,11 @@ int main(int argc, char *argv[])
 	for (;;) {
 		struct connection *conn, *next;
 
+		if (lu_dump_pending) {
+			lu_dump_state();
+			exit(0);
+		}
+
 		if (poll(fds, nr_fds, timeout) < 0) {
 			if (errno == EINTR)
 				continue;
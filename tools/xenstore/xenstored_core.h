@@ -86,6 +86,11 @@ struct connection
 	/* Buffered output data */
 	struct list_head out_list;
 
+	/* Output queue depth accounting ("stats" control command). */
+	unsigned int out_depth;
+	unsigned int out_depth_max;
+	uint64_t request_cnt;
+
 	/* Transaction context for current request (NULL if none). */
 	struct transaction *transaction;
 
@@ -161,6 +166,10 @@ struct connection *new_connection(connwritefn_t *write, connreadfn_t *read);
 void check_store(void);
 void corrupt(struct connection *conn, const char *fmt, ...);
 
+/* Request latency and queue depth statistics ("stats" control command). */
+char *request_stats_dump(const void *ctx);
+void request_stats_reset(void);
+
 /* Is this a valid node name? */
 bool is_valid_nodename(const char *node);
 
@@ -208,6 +217,10 @@ xengnttab_handle **xgt_handle;
 
 int remember_string(struct hashtable *hash, const char *str);
 
+/* Hash/compare functions for string-keyed hashtables. */
+unsigned int hash_from_key_fn(void *k);
+int keys_equal_fn(void *key1, void *key2);
+
 #endif /* _XENSTORED_CORE_H */
 
 /*
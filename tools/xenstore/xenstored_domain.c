@@ -26,6 +26,7 @@
 
 #include "utils.h"
 #include "talloc.h"
+#include "hashtable.h"
 #include "xenstored_core.h"
 #include "xenstored_domain.h"
 #include "xenstored_transaction.h"
@@ -85,6 +86,19 @@ struct domain
 
 static LIST_HEAD(domains);
 
+/* Index of domains by domid; the list above is kept for iteration. */
+static struct hashtable *domhash;
+
+static unsigned int domhash_fn(void *k)
+{
+	return *(unsigned int *)k;
+}
+
+static int domeq_fn(void *key1, void *key2)
+{
+	return *(unsigned int *)key1 == *(unsigned int *)key2;
+}
+
 static bool check_indexes(XENSTORE_RING_IDX cons, XENSTORE_RING_IDX prod)
 {
 	return ((prod - cons) <= XENSTORE_RING_SIZE);
@@ -196,6 +210,8 @@ static int destroy_domain(void *_domain)
 	struct domain *domain = _domain;
 
 	list_del(&domain->list);
+	if (domhash)
+		hashtable_remove(domhash, &domain->domid);
 
 	if (domain->port) {
 		if (xenevtchn_unbind(xce_handle, domain->port) == -1)
@@ -317,6 +333,18 @@ static struct domain *new_domain(void *context, unsigned int domid,
 	list_add(&domain->list, &domains);
 	talloc_set_destructor(domain, destroy_domain);
 
+	if (domhash) {
+		unsigned int *key = malloc(sizeof(*key));
+
+		if (!key)
+			return NULL;
+		*key = domid;
+		if (!hashtable_insert(domhash, key, domain)) {
+			free(key);
+			return NULL;
+		}
+	}
+
 	/* Tell kernel we're interested in this event. */
 	rc = xenevtchn_bind_interdomain(xce_handle, domid, port);
 	if (rc == -1)
@@ -340,13 +368,7 @@ static struct domain *new_domain(void *context, unsigned int domid,
 
 static struct domain *find_domain_by_domid(unsigned int domid)
 {
-	struct domain *i;
-
-	list_for_each_entry(i, &domains, list) {
-		if (i->domid == domid)
-			return i;
-	}
-	return NULL;
+	return domhash ? hashtable_search(domhash, &domid) : NULL;
 }
 
 static void domain_conn_reset(struct domain *domain)
@@ -597,6 +619,70 @@ void restore_existing_connections(void)
 {
 }
 
+/*
+ * Live-update support: one "domain" line per introduced domain, followed
+ * by its watches.  Socket connections cannot be handed over and their
+ * clients are expected to reconnect.
+ */
+void dump_domain_connections(FILE *f)
+{
+	struct domain *domain;
+
+	list_for_each_entry(domain, &domains, list) {
+		if (!domain->interface || !domain->port)
+			continue;
+		fprintf(f, "domain %u %lu %u\n", domain->domid, domain->mfn,
+			domain->remote_port);
+		dump_watches(f, domain->conn, domain->domid);
+	}
+}
+
+/*
+ * Live-update support: recreate an introduced domain from its dumped
+ * record, remapping the ring and rebinding the event channel.  The
+ * guest is notified in case it was waiting on the old instance.
+ */
+int restore_domain_connection(unsigned int domid, unsigned long mfn,
+			      evtchn_port_t port)
+{
+	struct domain *domain;
+	struct xenstore_domain_interface *interface;
+	int rc;
+
+	/* Already present, e.g. dom0 set up by dom0_init(). */
+	if (find_domain_by_domid(domid))
+		return 0;
+
+	interface = map_interface(domid, mfn);
+	if (!interface)
+		return errno;
+	domain = new_domain(NULL, domid, port);
+	if (!domain) {
+		rc = errno;
+		unmap_interface(interface);
+		return rc;
+	}
+	domain->interface = interface;
+	domain->mfn = mfn;
+	talloc_steal(domain->conn, domain);
+
+	/* Wake the guest in case it was blocked on the old instance. */
+	xenevtchn_notify(xce_handle, domain->port);
+
+	return 0;
+}
+
+int restore_domain_watch(unsigned int domid, const char *node,
+			 const char *token, bool relative)
+{
+	struct domain *domain = find_domain_by_domid(domid);
+
+	if (!domain || !domain->conn)
+		return ENOENT;
+
+	return restore_watch(domain->conn, node, token, relative);
+}
+
 static int dom0_init(void) 
 { 
 	evtchn_port_t port;
@@ -625,6 +711,10 @@ void domain_init(void)
 {
 	int rc;
 
+	domhash = create_hashtable(16, domhash_fn, domeq_fn);
+	if (!domhash)
+		barf_perror("Failed to allocate domain hash");
+
 	xc_handle = talloc(talloc_autofree_context(), xc_interface*);
 	if (!xc_handle)
 		barf_perror("Failed to allocate domain handle");
@@ -959,6 +1049,23 @@ void wrl_log_periodic(struct wrl_timestampt now)
 	}
 }
 
+#define DOMAIN_STATS_EVERY 60 /* seconds */
+static time_t domain_stats_last;
+
+/* Periodically trace per-domain entry/watch counts (needs tracing on). */
+void domain_log_stats(struct wrl_timestampt now)
+{
+	struct domain *d;
+
+	if (now.sec - domain_stats_last < DOMAIN_STATS_EVERY)
+		return;
+	domain_stats_last = now.sec;
+
+	list_for_each_entry(d, &domains, list)
+		trace("stats: domain %u: %i entries, %i watches\n",
+		      d->domid, d->nbentry, d->nbwatch);
+}
+
 void wrl_apply_debit_direct(struct connection *conn)
 {
 	if (!conn)
@@ -19,6 +19,9 @@
 #ifndef _XENSTORED_DOMAIN_H
 #define _XENSTORED_DOMAIN_H
 
+#include <stdio.h>
+#include <xenevtchn.h>
+
 void handle_event(void);
 
 /* domid, mfn, eventchn, path */
@@ -50,6 +53,13 @@ const char *get_implicit_path(const struct connection *conn);
 /* Read existing connection information from store. */
 void restore_existing_connections(void);
 
+/* Live-update support: hand domain connections over to a new instance. */
+void dump_domain_connections(FILE *f);
+int restore_domain_connection(unsigned int domid, unsigned long mfn,
+			      evtchn_port_t port);
+int restore_domain_watch(unsigned int domid, const char *node,
+			 const char *token, bool relative);
+
 /* Can connection attached to domain read/write. */
 bool domain_can_read(struct connection *conn);
 bool domain_can_write(struct connection *conn);
@@ -89,6 +99,7 @@ void wrl_check_timeout(struct domain *domain,
                        struct wrl_timestampt now,
                        int *ptimeout);
 void wrl_log_periodic(struct wrl_timestampt now);
+void domain_log_stats(struct wrl_timestampt now);
 void wrl_apply_debit_direct(struct connection *conn);
 void wrl_apply_debit_trans_commit(struct connection *conn);
 
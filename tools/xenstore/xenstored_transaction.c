@@ -150,6 +150,9 @@ struct transaction
 	/* List of accessed nodes. */
 	struct list_head accessed;
 
+	/* Index of accessed nodes by name, values are struct accessed_node. */
+	struct hashtable *accessed_hash;
+
 	/* List of changed domains - to record the changed domain entry number */
 	struct list_head changed_domains;
 
@@ -169,13 +172,7 @@ static void set_tdb_key(const char *name, TDB_DATA *key)
 static struct accessed_node *find_accessed_node(struct transaction *trans,
 						const char *name)
 {
-	struct accessed_node *i;
-
-	list_for_each_entry(i, &trans->accessed, list)
-		if (streq(i->node, name))
-			return i;
-
-	return NULL;
+	return hashtable_search(trans->accessed_hash, (void *)name);
 }
 
 static char *transaction_get_node_name(void *ctx, struct transaction *trans,
@@ -209,6 +206,21 @@ int transaction_prepend(struct connection *conn, const char *name,
 	return 0;
 }
 
+/* Index an accessed node by name.  The hashtable owns the key copy. */
+static bool remember_node(struct transaction *trans, struct accessed_node *i)
+{
+	char *key = strdup(i->node);
+
+	if (!key)
+		return false;
+	if (!hashtable_insert(trans->accessed_hash, key, i)) {
+		free(key);
+		return false;
+	}
+
+	return true;
+}
+
 /*
  * A node has been accessed.
  *
@@ -282,6 +294,8 @@ int access_node(struct connection *conn, struct node *node,
 				i->ta_node = true;
 			}
 		}
+		if (!remember_node(trans, i))
+			goto nomem;
 		list_add_tail(&i->list, &trans->accessed);
 	}
 
@@ -395,6 +409,13 @@ static int destroy_transaction(void *_transaction)
 
 	wrl_ntransactions--;
 	trace_destroy(trans, "transaction");
+	/*
+	 * The accessed nodes themselves are talloc children of trans and may
+	 * already be gone (finalize_transaction); only the key copies need
+	 * freeing here.
+	 */
+	if (trans->accessed_hash)
+		hashtable_destroy(trans->accessed_hash, 0);
 	while ((i = list_top(&trans->accessed, struct accessed_node, list))) {
 		if (i->ta_node) {
 			trans_name = transaction_get_node_name(i, trans,
@@ -444,6 +465,12 @@ int do_transaction_start(struct connection *conn, struct buffered_data *in)
 
 	INIT_LIST_HEAD(&trans->accessed);
 	INIT_LIST_HEAD(&trans->changed_domains);
+	trans->accessed_hash = create_hashtable(16, hash_from_key_fn,
+						keys_equal_fn);
+	if (!trans->accessed_hash) {
+		talloc_free(trans);
+		return ENOMEM;
+	}
 	trans->fail = false;
 	trans->generation = generation++;
 
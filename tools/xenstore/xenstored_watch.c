@@ -211,6 +211,48 @@ int do_watch(struct connection *conn, struct buffered_data *in)
 	return 0;
 }
 
+/* Live-update support: write one line per watch on this connection. */
+void dump_watches(FILE *f, struct connection *conn, unsigned int domid)
+{
+	struct watch *watch;
+
+	/* The token goes last: it may contain spaces. */
+	list_for_each_entry(watch, &conn->watches, list)
+		fprintf(f, "watch %u %u %s %s\n", domid,
+			watch->relative_path ? 1 : 0, watch->node,
+			watch->token);
+}
+
+/*
+ * Live-update support: re-establish a watch exactly as dumped, without
+ * firing it or acking anything.  The node is already canonicalized.
+ */
+int restore_watch(struct connection *conn, const char *node,
+		  const char *token, bool relative)
+{
+	struct watch *watch;
+
+	watch = talloc(conn, struct watch);
+	if (!watch)
+		return ENOMEM;
+	watch->node = talloc_strdup(watch, node);
+	watch->token = talloc_strdup(watch, token);
+	if (!watch->node || !watch->token) {
+		talloc_free(watch);
+		return ENOMEM;
+	}
+	watch->relative_path = relative ? get_implicit_path(conn) : NULL;
+
+	INIT_LIST_HEAD(&watch->events);
+
+	domain_watch_inc(conn);
+	list_add_tail(&watch->list, &conn->watches);
+	trace_create(watch, "watch");
+	talloc_set_destructor(watch, destroy_watch);
+
+	return 0;
+}
+
 int do_unwatch(struct connection *conn, struct buffered_data *in)
 {
 	struct watch *watch;
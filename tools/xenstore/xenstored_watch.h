@@ -19,6 +19,8 @@
 #ifndef _XENSTORED_WATCH_H
 #define _XENSTORED_WATCH_H
 
+#include <stdio.h>
+
 #include "xenstored_core.h"
 
 int do_watch(struct connection *conn, struct buffered_data *in);
@@ -30,4 +32,9 @@ void fire_watches(struct connection *conn, void *tmp, const char *name,
 
 void conn_delete_all_watches(struct connection *conn);
 
+/* Live-update support. */
+void dump_watches(FILE *f, struct connection *conn, unsigned int domid);
+int restore_watch(struct connection *conn, const char *node,
+		  const char *token, bool relative);
+
 #endif /* _XENSTORED_WATCH_H */
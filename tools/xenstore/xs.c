@@ -90,18 +90,47 @@ struct xs_handle {
 	/* One request at a time. */
 	pthread_mutex_t request_mutex;
 
+	/*
+	 * Watch events are delivered through this callback (from the read
+	 * thread) instead of watch_list when it is set; see
+	 * xs_watch_set_callback().
+	 */
+	xs_watch_cb_fn *watch_cb;
+	void *watch_cb_opaque;
+
+	/*
+	 * XS_OPEN_POOL: additional per-thread connections to the daemon,
+	 * used in lockstep (write request, read reply) so concurrent
+	 * requests don't queue behind the shared request_mutex.  Watch
+	 * related requests stay on h->fd, where the read thread lives.
+	 */
+	bool pool_enabled;
+	bool pool_key_valid;
+	char *connect_to;
+	pthread_key_t pool_key;
+	struct xs_channel *pool;
+	unsigned int pool_count;
+	pthread_mutex_t pool_mutex;
+
 	/* Lock discipline:
 	 *  Only holder of the request lock may write to h->fd.
 	 *  Only holder of the request lock may access read_thr_exists.
 	 *  If read_thr_exists==0, only holder of request lock may read h->fd;
 	 *  If read_thr_exists==1, only the read thread may read h->fd.
 	 *  Only holder of the reply lock may access reply_list.
-	 *  Only holder of the watch lock may access watch_list.
+	 *  Only holder of the watch lock may access watch_list, watch_cb
+	 *  and watch_cb_opaque.
+	 *  Only holder of the pool lock may access pool, pool_count and
+	 *  the in_use flags of pool channels, or clear pool_enabled (set
+	 *  once at open time); a channel's fd is used without locks by
+	 *  the single thread owning the channel.
 	 * Lock hierarchy:
 	 *  The order in which to acquire locks is
 	 *     request_mutex
 	 *     reply_mutex
 	 *     watch_mutex
+	 *  The pool lock nests inside none of the above and none of the
+	 *  above may be acquired while holding it.
 	 */
 };
 
@@ -138,6 +167,9 @@ struct xs_handle {
 	int watch_pipe[2];
 	/* Filtering watch event in unwatch function? */
 	bool unwatch_filter;
+	/* Watch events are delivered through this callback when set. */
+	xs_watch_cb_fn *watch_cb;
+	void *watch_cb_opaque;
 };
 
 #define mutex_lock(m)		((void)0)
@@ -153,6 +185,23 @@ struct xs_handle {
 
 #endif
 
+/* A pooled connection, owned by (at most) one thread at a time. */
+struct xs_channel {
+	struct xs_channel *next;
+	struct xs_handle *h;
+	int fd;
+	bool in_use;
+};
+
+/* Don't grow the pool beyond this many extra connections. */
+#define XS_POOL_MAX_CHANNELS 16
+
+#ifdef USE_PTHREAD
+static struct xs_channel *get_pool_channel(struct xs_handle *h);
+#else
+#define get_pool_channel(h) NULL
+#endif
+
 static int read_message(struct xs_handle *h, int nonblocking);
 
 static bool setnonblock(int fd, int nonblock) {
@@ -229,14 +278,45 @@ static int get_dev(const char *connect_to)
 	return open(connect_to, O_RDWR);
 }
 
+static int open_connection(const char *connect_to)
+{
+	struct stat buf;
+
+	if (stat(connect_to, &buf) != 0)
+		return -1;
+
+	if (S_ISSOCK(buf.st_mode))
+		return get_socket(connect_to);
+	else
+		return get_dev(connect_to);
+}
+
 static int all_restrict_cb(Xentoolcore__Active_Handle *ah, domid_t domid) {
     struct xs_handle *h = CONTAINER_OF(ah, *h, tc_ah);
-    return xentoolcore__restrict_by_dup2_null(h->fd);
+    int rc;
+
+#ifdef USE_PTHREAD
+    struct xs_channel *ch;
+
+    mutex_lock(&h->pool_mutex);
+    /*
+     * Disable the pool so no thread can open a new, unrestricted
+     * connection after this point; get_pool_channel() rechecks the flag
+     * under the pool lock.
+     */
+    h->pool_enabled = false;
+    for (ch = h->pool; ch; ch = ch->next)
+	    if (ch->fd != -1)
+		    xentoolcore__restrict_by_dup2_null(ch->fd);
+    mutex_unlock(&h->pool_mutex);
+#endif
+
+    rc = xentoolcore__restrict_by_dup2_null(h->fd);
+    return rc;
 }
 
 static struct xs_handle *get_handle(const char *connect_to)
 {
-	struct stat buf;
 	struct xs_handle *h = NULL;
 	int saved_errno;
 
@@ -250,14 +330,7 @@ static struct xs_handle *get_handle(const char *connect_to)
 	h->tc_ah.restrict_callback = all_restrict_cb;
 	xentoolcore__register_active_handle(&h->tc_ah);
 
-	if (stat(connect_to, &buf) != 0)
-		goto err;
-
-	if (S_ISSOCK(buf.st_mode))
-		h->fd = get_socket(connect_to);
-	else
-		h->fd = get_dev(connect_to);
-
+	h->fd = open_connection(connect_to);
 	if (h->fd == -1)
 		goto err;
 
@@ -277,6 +350,12 @@ static struct xs_handle *get_handle(const char *connect_to)
 	pthread_cond_init(&h->reply_condvar, NULL);
 
 	pthread_mutex_init(&h->request_mutex, NULL);
+
+	pthread_mutex_init(&h->pool_mutex, NULL);
+	/* Pool channels are only created once xs_open() enables the pool. */
+	h->connect_to = strdup(connect_to);
+	if (!h->connect_to)
+		goto err;
 #endif
 
 	return h;
@@ -288,6 +367,9 @@ err:
 		xentoolcore__deregister_active_handle(&h->tc_ah);
 		if (h->fd >= 0)
 			close(h->fd);
+#ifdef USE_PTHREAD
+		free(h->connect_to);
+#endif
 	}
 	free(h);
 
@@ -295,6 +377,112 @@ err:
 	return NULL;
 }
 
+#ifdef USE_PTHREAD
+/*
+ * Destructor of pool_key: an exiting thread returns its channel to the
+ * pool for reuse.  Not run after xs_close() deletes the key.
+ */
+static void pool_channel_release(void *arg)
+{
+	struct xs_channel *ch = arg;
+
+	mutex_lock(&ch->h->pool_mutex);
+	ch->in_use = false;
+	mutex_unlock(&ch->h->pool_mutex);
+}
+
+/*
+ * Get the calling thread's pool channel, binding a free (or freshly
+ * connected) one on first use.  Returns NULL if the pool is disabled or
+ * exhausted, in which case the caller falls back to the shared
+ * connection.
+ */
+static struct xs_channel *get_pool_channel(struct xs_handle *h)
+{
+	struct xs_channel *ch;
+	bool full;
+
+	if (!h->pool_enabled)
+		return NULL;
+
+	ch = pthread_getspecific(h->pool_key);
+	if (ch)
+		return ch->fd != -1 ? ch : NULL;
+
+	mutex_lock(&h->pool_mutex);
+	if (!h->pool_enabled) {
+		/* The handle was restricted; don't hand out channels. */
+		mutex_unlock(&h->pool_mutex);
+		return NULL;
+	}
+	for (ch = h->pool; ch; ch = ch->next)
+		if (!ch->in_use && ch->fd != -1)
+			break;
+	if (ch)
+		ch->in_use = true;
+	full = h->pool_count >= XS_POOL_MAX_CHANNELS;
+	mutex_unlock(&h->pool_mutex);
+
+	if (!ch) {
+		if (full || !h->connect_to)
+			return NULL;
+
+		ch = malloc(sizeof(*ch));
+		if (!ch)
+			return NULL;
+
+		ch->h = h;
+		ch->in_use = true;
+		ch->fd = open_connection(h->connect_to);
+		if (ch->fd == -1) {
+			free(ch);
+			return NULL;
+		}
+
+		mutex_lock(&h->pool_mutex);
+		if (!h->pool_enabled) {
+			/* The handle was restricted while we connected. */
+			mutex_unlock(&h->pool_mutex);
+			close(ch->fd);
+			free(ch);
+			return NULL;
+		}
+		ch->next = h->pool;
+		h->pool = ch;
+		h->pool_count++;
+		mutex_unlock(&h->pool_mutex);
+	}
+
+	if (pthread_setspecific(h->pool_key, ch) != 0) {
+		pool_channel_release(ch);
+		return NULL;
+	}
+
+	return ch;
+}
+
+static void free_pool(struct xs_handle *h)
+{
+	struct xs_channel *ch, *next;
+
+	if (h->pool_key_valid)
+		pthread_key_delete(h->pool_key);
+
+	for (ch = h->pool; ch; ch = next) {
+		next = ch->next;
+		if (ch->fd != -1)
+			close(ch->fd);
+		free(ch);
+	}
+	h->pool = NULL;
+
+	free(h->connect_to);
+	h->connect_to = NULL;
+}
+#else
+#define free_pool(h) ((void)0)
+#endif
+
 struct xs_handle *xs_daemon_open(void)
 {
 	return xs_open(0);
@@ -325,6 +513,14 @@ struct xs_handle *xs_open(unsigned long flags)
 	if (xsh && (flags & XS_UNWATCH_FILTER))
 		xsh->unwatch_filter = true;
 
+#ifdef USE_PTHREAD
+	if (xsh && (flags & XS_OPEN_POOL) &&
+	    pthread_key_create(&xsh->pool_key, pool_channel_release) == 0) {
+		xsh->pool_key_valid = true;
+		xsh->pool_enabled = true;
+	}
+#endif
+
 	return xsh;
 }
 
@@ -350,7 +546,8 @@ static void close_fds_free(struct xs_handle *h) {
 
 	xentoolcore__deregister_active_handle(&h->tc_ah);
         close(h->fd);
-        
+
+	free_pool(h);
 	free(h);
 }
 
@@ -484,6 +681,47 @@ static void *read_reply(
 	return body;
 }
 
+/* free(), but don't change errno. */
+static void free_no_errno(void *p)
+{
+	int saved_errno = errno;
+	free(p);
+	errno = saved_errno;
+}
+
+/* Lockstep read of one reply from a pool channel's private connection.
+ * No watch events can arrive on it, as no watches are ever registered
+ * there.  Adds an extra nul terminator, like read_reply().
+ */
+static void *read_reply_channel(int fd, struct xsd_sockmsg *hdr,
+				unsigned int *len)
+{
+	char *body;
+
+	if (!read_all(fd, hdr, sizeof(*hdr), 0))
+		return NULL;
+
+	if (hdr->len > XENSTORE_PAYLOAD_MAX) {
+		errno = E2BIG;
+		return NULL;
+	}
+
+	body = malloc(hdr->len + 1);
+	if (body == NULL)
+		return NULL;
+
+	if (!read_all(fd, body, hdr->len, 0)) {
+		free_no_errno(body);
+		return NULL;
+	}
+
+	body[hdr->len] = '\0';
+	if (len)
+		*len = hdr->len;
+
+	return body;
+}
+
 /* Send message to xs, get malloc'ed reply.  NULL and set errno on error. */
 static void *xs_talkv(struct xs_handle *h, xs_transaction_t t,
 		      enum xsd_sockmsg_type type,
@@ -492,6 +730,7 @@ static void *xs_talkv(struct xs_handle *h, xs_transaction_t t,
 		      unsigned int *len)
 {
 	struct xsd_sockmsg msg;
+	struct xs_channel *ch = NULL;
 	void *ret = NULL;
 	int saved_errno;
 	unsigned int i;
@@ -509,25 +748,44 @@ static void *xs_talkv(struct xs_handle *h, xs_transaction_t t,
 		return 0;
 	}
 
+	/* Watches must live on the shared connection the read thread owns. */
+	if (type != XS_WATCH && type != XS_UNWATCH)
+		ch = get_pool_channel(h);
+
 	ignorepipe.sa_handler = SIG_IGN;
 	sigemptyset(&ignorepipe.sa_mask);
 	ignorepipe.sa_flags = 0;
 	sigaction(SIGPIPE, &ignorepipe, &oldact);
 
-	mutex_lock(&h->request_mutex);
+	if (ch) {
+		if (!xs_write_all(ch->fd, &msg, sizeof(msg)))
+			goto fail;
 
-	if (!xs_write_all(h->fd, &msg, sizeof(msg)))
-		goto fail;
+		for (i = 0; i < num_vecs; i++)
+			if (!xs_write_all(ch->fd, iovec[i].iov_base,
+					  iovec[i].iov_len))
+				goto fail;
 
-	for (i = 0; i < num_vecs; i++)
-		if (!xs_write_all(h->fd, iovec[i].iov_base, iovec[i].iov_len))
+		ret = read_reply_channel(ch->fd, &msg, len);
+		if (!ret)
 			goto fail;
+	} else {
+		mutex_lock(&h->request_mutex);
 
-	ret = read_reply(h, &msg.type, len);
-	if (!ret)
-		goto fail;
+		if (!xs_write_all(h->fd, &msg, sizeof(msg)))
+			goto fail;
 
-	mutex_unlock(&h->request_mutex);
+		for (i = 0; i < num_vecs; i++)
+			if (!xs_write_all(h->fd, iovec[i].iov_base,
+					  iovec[i].iov_len))
+				goto fail;
+
+		ret = read_reply(h, &msg.type, len);
+		if (!ret)
+			goto fail;
+
+		mutex_unlock(&h->request_mutex);
+	}
 
 	sigaction(SIGPIPE, &oldact, NULL);
 	if (msg.type == XS_ERROR) {
@@ -547,23 +805,22 @@ static void *xs_talkv(struct xs_handle *h, xs_transaction_t t,
 fail:
 	/* We're in a bad state, so close fd. */
 	saved_errno = errno;
-	mutex_unlock(&h->request_mutex);
+	if (!ch)
+		mutex_unlock(&h->request_mutex);
 	sigaction(SIGPIPE, &oldact, NULL);
 close_fd:
-	close(h->fd);
-	h->fd = -1;
+	if (ch) {
+		/* Only poison this thread's channel; h->fd is unaffected. */
+		close(ch->fd);
+		ch->fd = -1;
+	} else {
+		close(h->fd);
+		h->fd = -1;
+	}
 	errno = saved_errno;
 	return NULL;
 }
 
-/* free(), but don't change errno. */
-static void free_no_errno(void *p)
-{
-	int saved_errno = errno;
-	free(p);
-	errno = saved_errno;
-}
-
 /* Simplified version of xs_talkv: single message. */
 static void *xs_single(struct xs_handle *h, xs_transaction_t t,
 		       enum xsd_sockmsg_type type,
@@ -688,6 +945,107 @@ void *xs_read(struct xs_handle *h, xs_transaction_t t,
 	return xs_single(h, t, XS_READ, path, len);
 }
 
+/* Get the values of several files in as few exchanges as possible.
+ * Returns a malloced array of num values, each individually malloced and
+ * nul terminated, with lengths in lens[].  Files which could not be read
+ * have a NULL value and a length of zero.  Returns NULL on failure.
+ * Call free() on each value and on the array after use.
+ */
+char **xs_read_batch(struct xs_handle *h, xs_transaction_t t,
+		     char *const *paths, unsigned int num,
+		     unsigned int *lens)
+{
+	char **ret;
+	struct iovec *iovec;
+	char *reply;
+	unsigned int i, done, reply_len;
+
+	ret = calloc(num, sizeof(*ret));
+	iovec = malloc(num * sizeof(*iovec));
+	if (!ret || !iovec)
+		goto fail;
+
+	for (done = 0; done < num; ) {
+		unsigned int batch = num - done, off, parsed;
+
+		for (i = 0; i < batch; i++) {
+			iovec[i].iov_base = (void *)paths[done + i];
+			iovec[i].iov_len = strlen(paths[done + i]) + 1;
+		}
+
+		reply = xs_talkv(h, t, XS_READ_BATCH, iovec, batch,
+				 &reply_len);
+		if (!reply) {
+			if (errno == ENOSYS)
+				goto fallback;
+			goto fail;
+		}
+
+		/* Entries are <len-or-error>|<data>; see do_read_batch(). */
+		for (off = 0, parsed = 0; off < reply_len && parsed < batch;
+		     parsed++) {
+			char *field = reply + off;
+			unsigned int fieldlen, datalen;
+
+			fieldlen = strnlen(field, reply_len - off);
+			if (fieldlen == reply_len - off)
+				goto bad_reply;
+			off += fieldlen + 1;
+
+			if (field[0] < '0' || field[0] > '9') {
+				/* Error name: leave the value NULL. */
+				lens[done + parsed] = 0;
+				continue;
+			}
+
+			datalen = atoi(field);
+			if (datalen > reply_len - off)
+				goto bad_reply;
+			ret[done + parsed] = malloc(datalen + 1);
+			if (!ret[done + parsed]) {
+				free(reply);
+				goto fail;
+			}
+			memcpy(ret[done + parsed], reply + off, datalen);
+			ret[done + parsed][datalen] = '\0';
+			lens[done + parsed] = datalen;
+			off += datalen;
+		}
+		free(reply);
+
+		/* A well-formed reply answers at least one path. */
+		if (parsed == 0) {
+			errno = EINVAL;
+			goto fail;
+		}
+		done += parsed;
+	}
+
+	free(iovec);
+	return ret;
+
+bad_reply:
+	free(reply);
+	errno = EINVAL;
+fail:
+	if (ret)
+		for (i = 0; i < num; i++)
+			free(ret[i]);
+	free(ret);
+	free(iovec);
+	return NULL;
+
+fallback:
+	/* Talking to an older xenstored: one round trip per file. */
+	for (i = done; i < num; i++) {
+		ret[i] = xs_read(h, t, paths[i], &lens[i]);
+		if (!ret[i])
+			lens[i] = 0;
+	}
+	free(iovec);
+	return ret;
+}
+
 /* Write the value of a single file.
  * Returns false on failure.
  */
@@ -797,6 +1155,30 @@ unwind:
 	return false;
 }
 
+/* Register (or, with fn == NULL, remove) a watch event callback;
+ * see the description in xenstore.h.
+ * Returns false on failure.
+ */
+bool xs_watch_set_callback(struct xs_handle *h, xs_watch_cb_fn *fn,
+			   void *opaque)
+{
+	mutex_lock(&h->watch_mutex);
+
+	if (fn && !list_empty(&h->watch_list)) {
+		/* Already queued events would never be consumed. */
+		mutex_unlock(&h->watch_mutex);
+		errno = EBUSY;
+		return false;
+	}
+
+	h->watch_cb = fn;
+	h->watch_cb_opaque = opaque;
+
+	mutex_unlock(&h->watch_mutex);
+
+	return true;
+}
+
 /* Watch a node for changes (poll on fd to detect, or call read_watch()).
  * When the node (or any child) changes, fd will become readable.
  * Token is returned when watch is read, to allow matching.
@@ -1272,7 +1654,28 @@ static int read_message(struct xs_handle *h, int nonblocking)
 	body[msg->hdr.len] = '\0';
 
 	if (msg->hdr.type == XS_WATCH_EVENT) {
+		xs_watch_cb_fn *cb;
+		void *opaque;
+
 		mutex_lock(&h->watch_mutex);
+		cb = h->watch_cb;
+		opaque = h->watch_cb_opaque;
+		if (cb) {
+			/*
+			 * Deliver directly, outside the mutex so the
+			 * callback may use watch functions itself.  The
+			 * event body is <path>\0<token>\0.
+			 */
+			const char *token = body + strlen(body) + 1;
+
+			mutex_unlock(&h->watch_mutex);
+			if (token > body + msg->hdr.len)
+				token = "";
+			cb(opaque, body, token);
+			free(body);
+			free(msg);
+			goto done;
+		}
 		cleanup_push(pthread_mutex_unlock, &h->watch_mutex);
 
 		/* Kick users out of their select() loop. */
@@ -1302,6 +1705,7 @@ static int read_message(struct xs_handle *h, int nonblocking)
 		mutex_unlock(&h->reply_mutex);
 	}
 
+done:
 	ret = 0;
 
 error_freebody:
@@ -30,6 +30,17 @@ mread_handle_t mread_init(int fd)
     return h;
 }
 
+/* A trace file being followed live grows behind our back; pick up the
+ * new size.  The mappings are MAP_SHARED, so data appended within an
+ * already-mapped region becomes visible without remapping. */
+void mread_refresh(mread_handle_t h)
+{
+    struct stat s;
+
+    fstat(h->fd, &s);
+    h->file_size = s.st_size;
+}
+
 ssize_t mread64(mread_handle_t h, void *rec, ssize_t len, off_t offset)
 {
     /* Idea: have a "cache" of N mmaped regions.  If the offset is
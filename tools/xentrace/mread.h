@@ -15,4 +15,5 @@ typedef struct mread_ctrl {
 } *mread_handle_t;
 
 mread_handle_t mread_init(int fd);
+void mread_refresh(mread_handle_t h);
 ssize_t mread64(mread_handle_t h, void *dst, ssize_t len, off_t offset);
@@ -0,0 +1,369 @@
+/*
+ * sched2adv.c: credit2 parameter advisor driven by xentrace streams.
+ *
+ * Ingests a raw trace file (as written by xentrace), computes wake
+ * latency and migration churn distributions from the TRC_SCHED_* and
+ * TRC_CSCHED2_* records, and recommends settings for the tunables we
+ * otherwise adjust by hand: the context-switch ratelimit
+ * (xl sched-credit2 -s -r <us>) and the migration resistance
+ * (sched_credit2_migrate_resist= on the hypervisor command line).
+ *
+ * Record layouts follow what sched_credit2.c and schedule.c emit; this
+ * tool must be kept in sync with them, like xenalyze.
+ *
+ * Copyright (C) <2019> - This program is free software; you can
+ * redistribute it and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Event IDs, pre-computed from xen/include/public/trace.h. */
+#define TRC_TRACE_CPU_CHANGE    0x0001f003
+#define TRC_SCHED_WAKE          0x00028004
+#define TRC_SCHED_SWITCH        0x0002800a
+#define TRC_CSCHED2_MIGRATE     0x0002220f
+#define TRC_CSCHED2_RATELIMIT   0x00022216
+
+#define TRC_HD_CYCLE_FLAG       (1u << 31)
+#define TRC_HD_EVENT_MASK       0x0fffffff
+#define TRC_HD_EXTRA(h)         (((h) >> 28) & 7)
+
+/* Hypervisor defaults, for the recommendation baselines. */
+#define DEFAULT_RATELIMIT_US    1000
+#define DEFAULT_MIGRATE_RESIST  500
+
+#define MAX_VCPUS_TRACKED       4096
+
+struct vcpu_state {
+    uint32_t dom, vcpu;
+    uint64_t wake_tsc;          /* 0: no wake outstanding */
+    uint64_t migrations;
+    uint64_t last_migrate_tsc;
+};
+
+static struct vcpu_state vcpus[MAX_VCPUS_TRACKED];
+static unsigned int nr_vcpus;
+
+static uint64_t *wake_lat;      /* tsc deltas, wake -> switched in */
+static uint64_t *migr_gap;      /* tsc deltas between migrations */
+static unsigned int nr_wake_lat, sz_wake_lat;
+static unsigned int nr_migr_gap, sz_migr_gap;
+
+static uint64_t nr_migrations, nr_ratelimit_hits, nr_records;
+static uint64_t first_tsc, last_tsc;
+
+static double mhz = 0.0;        /* 0: report cycles, not microseconds */
+
+static struct vcpu_state *get_vcpu(uint32_t dom, uint32_t vcpu)
+{
+    unsigned int i;
+
+    /* The idle domain is not interesting. */
+    if ( dom == 0x7fff || dom == 32767 )
+        return NULL;
+
+    for ( i = 0; i < nr_vcpus; i++ )
+        if ( vcpus[i].dom == dom && vcpus[i].vcpu == vcpu )
+            return &vcpus[i];
+
+    if ( nr_vcpus == MAX_VCPUS_TRACKED )
+        return NULL;
+
+    vcpus[nr_vcpus].dom = dom;
+    vcpus[nr_vcpus].vcpu = vcpu;
+
+    return &vcpus[nr_vcpus++];
+}
+
+static void sample(uint64_t **arr, unsigned int *nr, unsigned int *sz,
+                   uint64_t val)
+{
+    if ( *nr == *sz )
+    {
+        *sz = *sz ? *sz * 2 : 4096;
+        *arr = realloc(*arr, *sz * sizeof(**arr));
+        if ( !*arr )
+        {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    (*arr)[(*nr)++] = val;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t l = *(const uint64_t *)a, r = *(const uint64_t *)b;
+
+    return l < r ? -1 : l > r;
+}
+
+static uint64_t percentile(uint64_t *arr, unsigned int nr, unsigned int pct)
+{
+    if ( !nr )
+        return 0;
+
+    return arr[(uint64_t)(nr - 1) * pct / 100];
+}
+
+static double scale(uint64_t cycles)
+{
+    return mhz ? cycles / mhz : cycles;
+}
+
+static void process(uint32_t event, uint64_t tsc, const uint32_t *d)
+{
+    struct vcpu_state *v;
+
+    if ( !tsc )
+        return;
+
+    if ( !first_tsc )
+        first_tsc = tsc;
+    if ( tsc > last_tsc )
+        last_tsc = tsc;
+
+    switch ( event )
+    {
+    case TRC_SCHED_WAKE:
+        v = get_vcpu(d[0], d[1]);
+        if ( v )
+            v->wake_tsc = tsc;
+        break;
+
+    case TRC_SCHED_SWITCH:
+        v = get_vcpu(d[2], d[3]);
+        if ( v && v->wake_tsc && tsc > v->wake_tsc )
+        {
+            sample(&wake_lat, &nr_wake_lat, &sz_wake_lat, tsc - v->wake_tsc);
+            v->wake_tsc = 0;
+        }
+        break;
+
+    case TRC_CSCHED2_MIGRATE:
+        /* d[0]: vcpu:16,dom:16; d[1]: rqi:16,trqi:16 */
+        nr_migrations++;
+        v = get_vcpu(d[0] >> 16, d[0] & 0xffff);
+        if ( v )
+        {
+            v->migrations++;
+            if ( v->last_migrate_tsc && tsc > v->last_migrate_tsc )
+                sample(&migr_gap, &nr_migr_gap, &sz_migr_gap,
+                       tsc - v->last_migrate_tsc);
+            v->last_migrate_tsc = tsc;
+        }
+        break;
+
+    case TRC_CSCHED2_RATELIMIT:
+        nr_ratelimit_hits++;
+        break;
+    }
+}
+
+static int parse(FILE *f)
+{
+    uint32_t hdr, d[7];
+    uint64_t tsc;
+    unsigned int extra;
+
+    while ( fread(&hdr, sizeof(hdr), 1, f) == 1 )
+    {
+        uint32_t event = hdr & TRC_HD_EVENT_MASK;
+
+        extra = TRC_HD_EXTRA(hdr);
+
+        tsc = 0;
+        if ( hdr & TRC_HD_CYCLE_FLAG )
+        {
+            uint32_t t[2];
+
+            if ( fread(t, sizeof(t), 1, f) != 1 )
+                break;
+            tsc = ((uint64_t)t[1] << 32) | t[0];
+        }
+
+        if ( extra && fread(d, sizeof(*d), extra, f) != extra )
+            break;
+
+        /* The cpu-change pseudo record carries no tsc; nothing to do. */
+        if ( event == TRC_TRACE_CPU_CHANGE )
+            continue;
+
+        nr_records++;
+        process(event, tsc, d);
+    }
+
+    return ferror(f) ? -errno : 0;
+}
+
+static void report(void)
+{
+    const char *unit = mhz ? "us" : "cycles";
+    double dur = scale(last_tsc - first_tsc);
+    double dur_s = mhz ? dur / 1e6 : 0.0;
+    double p50, p95, p99;
+    unsigned int i;
+
+    qsort(wake_lat, nr_wake_lat, sizeof(*wake_lat), cmp_u64);
+    qsort(migr_gap, nr_migr_gap, sizeof(*migr_gap), cmp_u64);
+
+    p50 = scale(percentile(wake_lat, nr_wake_lat, 50));
+    p95 = scale(percentile(wake_lat, nr_wake_lat, 95));
+    p99 = scale(percentile(wake_lat, nr_wake_lat, 99));
+
+    printf("%"PRIu64" records, %u vcpus, span %.0f %s\n",
+           nr_records, nr_vcpus, dur, unit);
+
+    printf("\nwake-to-run latency (%u samples, %s):\n"
+           "  p50 %.0f  p95 %.0f  p99 %.0f  max %.0f\n",
+           nr_wake_lat, unit, p50, p95, p99,
+           scale(percentile(wake_lat, nr_wake_lat, 100)));
+
+    printf("\nmigrations: %"PRIu64" total", nr_migrations);
+    if ( dur_s > 0 )
+        printf(" (%.1f/s)", nr_migrations / dur_s);
+    printf("; gap between migrations of a vcpu (%s):\n"
+           "  p50 %.0f  p95 %.0f\n", unit,
+           scale(percentile(migr_gap, nr_migr_gap, 50)),
+           scale(percentile(migr_gap, nr_migr_gap, 95)));
+
+    printf("busiest movers:\n");
+    for ( i = 0; i < nr_vcpus && i < 5; i++ )
+    {
+        unsigned int j, top = i;
+
+        for ( j = i + 1; j < nr_vcpus; j++ )
+            if ( vcpus[j].migrations > vcpus[top].migrations )
+                top = j;
+        if ( top != i )
+        {
+            struct vcpu_state tmp = vcpus[i];
+
+            vcpus[i] = vcpus[top];
+            vcpus[top] = tmp;
+        }
+        if ( !vcpus[i].migrations )
+            break;
+        printf("  d%uv%u: %"PRIu64"\n",
+               vcpus[i].dom, vcpus[i].vcpu, vcpus[i].migrations);
+    }
+
+    printf("\nratelimit continuations: %"PRIu64"", nr_ratelimit_hits);
+    if ( dur_s > 0 )
+        printf(" (%.1f/s)", nr_ratelimit_hits / dur_s);
+    printf("\n\nrecommendations:\n");
+
+    if ( !mhz )
+    {
+        printf("  (re-run with -f <cpu MHz> for tuned values)\n");
+        return;
+    }
+
+    /*
+     * The ratelimit keeps a vcpu running although a wakeup would
+     * preempt it.  Many ratelimit continuations together with a p95
+     * wake latency in the order of the (default) ratelimit mean wakers
+     * are routinely parked behind it: suggest shrinking it towards the
+     * observed p50.  With no continuations at all, latency is not
+     * coming from the ratelimit and raising it can cut switch churn.
+     */
+    if ( nr_ratelimit_hits && dur_s > 0 && nr_ratelimit_hits / dur_s > 10 &&
+         p95 > DEFAULT_RATELIMIT_US / 2 )
+    {
+        unsigned int r = p50 < 100 ? 100 : p50;
+
+        printf("  wakers often wait out the ratelimit; try:\n"
+               "    xl sched-credit2 -s -r %u\n", r);
+    }
+    else if ( !nr_ratelimit_hits && nr_wake_lat )
+        printf("  ratelimit never engaged; the current value is not a\n"
+               "  bottleneck (consider raising it if switch rates are a\n"
+               "  concern).\n");
+
+    /*
+     * Frequent back-and-forth moves of the same vcpus mean the load
+     * balancer is fighting the migration resistance and losing; moves
+     * separated by less than ~10 ratelimit periods are unlikely to
+     * have amortised their cache cost.
+     */
+    if ( nr_migr_gap &&
+         scale(percentile(migr_gap, nr_migr_gap, 50)) <
+         10 * DEFAULT_RATELIMIT_US )
+        printf("  migration churn is high; try booting with:\n"
+               "    sched_credit2_migrate_resist=%u\n",
+               DEFAULT_MIGRATE_RESIST * 2);
+    else if ( dur_s > 0 && nr_migrations / dur_s < 1 && p95 > 2000 )
+        printf("  migrations are rare but wake latency is high; if load\n"
+               "  is imbalanced, try booting with:\n"
+               "    sched_credit2_migrate_resist=%u\n",
+               DEFAULT_MIGRATE_RESIST / 2);
+    else
+        printf("  migration behaviour looks healthy.\n");
+}
+
+int main(int argc, char **argv)
+{
+    FILE *f;
+    int opt;
+
+    while ( (opt = getopt(argc, argv, "f:")) != -1 )
+    {
+        switch ( opt )
+        {
+        case 'f':
+            mhz = atof(optarg);
+            break;
+        default:
+            goto usage;
+        }
+    }
+
+    if ( optind != argc - 1 )
+    {
+    usage:
+        fprintf(stderr,
+                "usage: %s [-f cpu-mhz] <trace-file>\n"
+                "  Analyse a raw xentrace file (collect with, e.g.,\n"
+                "  'xentrace -e 0x2f000 out.trc') and recommend credit2\n"
+                "  parameter changes.  With -f, times are in microseconds\n"
+                "  and tuned values are computed; otherwise TSC cycles.\n",
+                argv[0]);
+        return 1;
+    }
+
+    f = fopen(argv[optind], "rb");
+    if ( !f )
+    {
+        perror(argv[optind]);
+        return 1;
+    }
+
+    if ( parse(f) )
+    {
+        perror("parse");
+        return 1;
+    }
+    fclose(f);
+
+    if ( !nr_records )
+    {
+        fprintf(stderr, "no trace records found\n");
+        return 1;
+    }
+
+    report();
+
+    return 0;
+}
@@ -34,6 +34,7 @@
 #include "mread.h"
 #include "pv.h"
 #include <errno.h>
+#include <signal.h>
 #include <strings.h>
 #include <string.h>
 #include <assert.h>
@@ -72,6 +73,7 @@ struct {
     char * trace_file;
     int output_defined;
     off_t file_size;
+    FILE *index_out;
     struct {
         off_t update_offset;
         int pipe[2];
@@ -180,6 +182,7 @@ struct {
         summary:1,
         report_pcpu:1,
         tsc_loop_fatal:1,
+        live:1,
         summary_info;
     long long cpu_qhz, cpu_hz;
     int scatterplot_interrupt_vector;
@@ -222,6 +225,9 @@ struct {
         };
         int count;
     } interval;
+    char *write_index_file;
+    char *use_index_file;
+    tsc_t window_start_tsc, window_end_tsc;
 } opt = {
     .scatterplot_interrupt_eip=0,
     .scatterplot_unpin_promote=0,
@@ -253,6 +259,11 @@ struct {
     .summary = 0,
     .report_pcpu = 0,
     .tsc_loop_fatal = 0,
+    .live = 0,
+    .write_index_file = NULL,
+    .use_index_file = NULL,
+    .window_start_tsc = 0,
+    .window_end_tsc = 0,
     .cpu_hz = DEFAULT_CPU_HZ,
     /* Pre-calculate a multiplier that makes the rest of the
      * calculations easier */
@@ -7923,11 +7934,14 @@ void sched_process(struct pcpu_info *p)
                 struct {
                     unsigned int vcpuid:16, domid:16;
                     uint64_t cur_dl, cur_bg;
+                    unsigned int priority_level;
                 } __attribute__((packed)) *r = (typeof(r))ri->d;
 
                 printf(" %s rtds:runq_pick d%uv%u, deadline = %"PRIu64", "
-                       "budget = %"PRIu64"\n", ri->dump_header,
-                       r->domid, r->vcpuid, r->cur_dl, r->cur_bg);
+                       "budget = %"PRIu64", priority level = %u\n",
+                       ri->dump_header,
+                       r->domid, r->vcpuid, r->cur_dl, r->cur_bg,
+                       r->priority_level);
             }
             break;
         case TRC_SCHED_CLASS_EVT(RTDS, 3): /* BUDGET_BURN      */
@@ -7936,11 +7950,13 @@ void sched_process(struct pcpu_info *p)
                     unsigned int vcpuid:16, domid:16;
                     uint64_t cur_bg;
                     int delta;
+                    unsigned int priority_level;
                 } __attribute__((packed)) *r = (typeof(r))ri->d;
 
                 printf(" %s rtds:burn_budget d%uv%u, budget = %"PRIu64", "
-                       "delta = %d\n", ri->dump_header, r->domid,
-                       r->vcpuid, r->cur_bg, r->delta);
+                       "delta = %d, priority level = %u\n", ri->dump_header,
+                       r->domid, r->vcpuid, r->cur_bg, r->delta,
+                       r->priority_level);
             }
             break;
         case TRC_SCHED_CLASS_EVT(RTDS, 4): /* BUDGET_REPLENISH */
@@ -7972,6 +7988,19 @@ void sched_process(struct pcpu_info *p)
                        r->tickled ? ", tickled" : ", not tickled");
             }
             break;
+        case TRC_SCHED_CLASS_EVT(RTDS, 7): /* EXTRA_BUDGET     */
+            if (opt.dump_all) {
+                struct {
+                    unsigned int vcpuid:16, domid:16;
+                    unsigned int priority_level;
+                    uint64_t overrun;
+                } __attribute__((packed)) *r = (typeof(r))ri->d;
+
+                printf(" %s rtds:extra_budget d%uv%u, priority level = %u, "
+                       "overrun = %"PRIu64"\n", ri->dump_header,
+                       r->domid, r->vcpuid, r->priority_level, r->overrun);
+            }
+            break;
         case TRC_SCHED_CLASS_EVT(SNULL, 1): /* PICKED_CPU */
             if (opt.dump_all) {
                 struct {
@@ -8989,6 +9018,40 @@ void activate_early_eof(void) {
     }
 }
 
+/* -- Live mode -- */
+#define LIVE_POLL_USEC 100000
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void interrupt_handler(int sig)
+{
+    interrupted = 1;
+}
+
+/*
+ * Wait for the trace file to grow past [offset].  Returns 1 once more
+ * data has appeared; 0 on interrupt, which degrades us to the normal
+ * end-of-file paths so summaries and intervals still get printed.
+ */
+int live_wait_for_data(off_t offset)
+{
+    struct stat s;
+
+    while(!interrupted) {
+        if(fstat(G.fd, &s) < 0) {
+            perror("fstat");
+            return 0;
+        }
+        if(s.st_size > G.file_size && s.st_size > offset) {
+            G.file_size = s.st_size;
+            mread_refresh(G.mh);
+            return 1;
+        }
+        usleep(LIVE_POLL_USEC);
+    }
+    return 0;
+}
+
 off_t scan_for_new_pcpu(off_t offset) {
     ssize_t r;
     struct trace_record rec;
@@ -9276,7 +9339,8 @@ void process_cpu_change(struct pcpu_info *p) {
         p->file_offset += ri->size + r->window_size;
         p->next_cpu_change_offset = p->file_offset;
 
-        if(p->file_offset > G.file_size) {
+        if(p->file_offset > G.file_size
+           && (!opt.live || !live_wait_for_data(p->file_offset))) {
             activate_early_eof();
         } else if(P.early_eof && p->file_offset > P.last_epoch_offset) {
             fprintf(warn, "%s: early_eof activated, pcpu %d past last_epoch_offset %llx, deactivating.\n",
@@ -9334,10 +9398,18 @@ void process_cpu_change(struct pcpu_info *p) {
             volume_clear(&p->volume.last_buffer);
         }
 
+        /* One line per buffer window; this is what makes re-analysis of
+         * a time window O(window) rather than O(file). */
+        if(G.index_out)
+            fprintf(G.index_out, "%u %llu %llu %u\n",
+                    r->cpu, (unsigned long long)p->file_offset,
+                    (unsigned long long)ri->tsc, r->window_size);
+
         p->file_offset += ri->size;
         p->next_cpu_change_offset = p->file_offset + r->window_size;
 
-        if(p->next_cpu_change_offset > G.file_size)
+        if(p->next_cpu_change_offset > G.file_size
+           && (!opt.live || !live_wait_for_data(p->next_cpu_change_offset)))
             activate_early_eof();
         else if(p->pid == P.max_active_pcpu)
             scan_for_new_pcpu(p->next_cpu_change_offset);
@@ -9658,6 +9730,12 @@ ssize_t read_record(struct pcpu_info * p) {
     ri = &p->ri;
 
     ri->size = __read_record(&ri->rec, *offset);
+
+    /* In live mode a zero-sized read usually just means we've caught up
+     * with the writer; wait for more data rather than deactivating. */
+    while(ri->size == 0 && opt.live && live_wait_for_data(*offset))
+        ri->size = __read_record(&ri->rec, *offset);
+
     if(ri->size)
     {
         __fill_in_record_info(p);
@@ -9843,6 +9921,11 @@ void process_records(void) {
         if(!(p=choose_next_record()))
             return;
 
+        /* Records are processed in tsc order, so everything from here
+         * on is past the end of the requested window. */
+        if(opt.window_end_tsc && p->order_tsc > opt.window_end_tsc)
+            return;
+
         process_record(p);
 
         /* Lost records gets processed twice. */
@@ -9966,6 +10049,52 @@ void report_pcpu(void) {
 
 }
 
+/*
+ * Index file: one line per buffer window, "cpu offset tsc window_size",
+ * as written by --write-index.  For each cpu, activate at the last
+ * window starting at or before the window of interest (or at its first
+ * window, if none do).  Entries for a given cpu are in file order, so
+ * a single pass keeps the right one.
+ */
+int init_pcpus_from_index(void) {
+    FILE *f;
+    unsigned cpu, wsize;
+    unsigned long long offset, tsc;
+    int i, found=0;
+    static struct {
+        int seen;
+        unsigned long long offset, tsc;
+    } best[MAX_CPUS] = { { 0 } };
+
+    if((f=fopen(opt.use_index_file, "r"))==NULL) {
+        fprintf(stderr, "Could not open index file %s\n",
+                opt.use_index_file);
+        perror("fopen");
+        error(ERR_SYSTEM, NULL);
+    }
+
+    while(fscanf(f, "%u %llu %llu %u", &cpu, &offset, &tsc, &wsize) == 4) {
+        if(cpu >= MAX_CPUS)
+            continue;
+        if(!best[cpu].seen || tsc <= opt.window_start_tsc) {
+            best[cpu].seen = 1;
+            best[cpu].offset = offset;
+            best[cpu].tsc = tsc;
+        }
+    }
+
+    fclose(f);
+
+    for(i=0; i<MAX_CPUS; i++) {
+        if(!best[i].seen)
+            continue;
+        if(scan_for_new_pcpu(best[i].offset))
+            found++;
+    }
+
+    return found;
+}
+
 void init_pcpus(void) {
     int i=0;
     off_t offset = 0;
@@ -9981,6 +10110,13 @@ void init_pcpus(void) {
 
     sched_default_domain_init();
 
+    if(opt.use_index_file) {
+        if(init_pcpus_from_index() > 0)
+            return;
+        fprintf(warn, "%s: empty index, falling back to full scan.\n",
+                __func__);
+    }
+
     /* Scan through the cpu_change recs until we see a duplicate */
     do {
         offset = scan_for_new_pcpu(offset);
@@ -10046,6 +10182,10 @@ enum {
     OPT_PROGRESS,
     OPT_TOLERANCE,
     OPT_TSC_LOOP_FATAL,
+    OPT_LIVE,
+    OPT_WRITE_INDEX,
+    OPT_USE_INDEX,
+    OPT_WINDOW,
     /* Specific letters */
     OPT_DUMP_ALL='a',
     OPT_INTERVAL_LENGTH='i',
@@ -10526,6 +10666,39 @@ error_t cmd_parser(int key, char *arg, struct argp_state *state)
         opt.tsc_loop_fatal = 1;
         break;
 
+    case OPT_LIVE:
+        opt.live = 1;
+        break;
+
+    case OPT_WRITE_INDEX:
+        /* FIXME - strcpy */
+        opt.write_index_file = arg;
+        break;
+
+    case OPT_USE_INDEX:
+        /* FIXME - strcpy */
+        opt.use_index_file = arg;
+        break;
+
+    case OPT_WINDOW:
+    {
+        char * inval;
+
+        opt.window_start_tsc = strtoull(arg, &inval, 0);
+
+        if( inval == arg )
+            argp_usage(state);
+
+        if(*inval == ',') {
+            char *p = inval + 1;
+            opt.window_end_tsc = strtoull(p, &inval, 0);
+            if( inval == p )
+                argp_usage(state);
+        } else if(*inval != '\0')
+            argp_usage(state);
+    }
+    break;
+
     case ARGP_KEY_ARG:
     {
         /* FIXME - strcpy */
@@ -10820,6 +10993,24 @@ const struct argp_option cmd_opts[] =  {
       .arg = "errlevel",
       .doc = "Sets tolerance for errors found in the file.  Default is 3; max is 6.", },
 
+    { .name = "live",
+      .key = OPT_LIVE,
+      .doc = "Follow a trace file which is still being written: wait for more data at end-of-file instead of finishing.  Interrupt (^C) to stop and print output.", },
+
+    { .name = "write-index",
+      .key = OPT_WRITE_INDEX,
+      .arg = "filename",
+      .doc = "Write an index of per-cpu buffer offsets and tscs to [filename] while processing, for later use with --use-index.", },
+
+    { .name = "use-index",
+      .key = OPT_USE_INDEX,
+      .arg = "filename",
+      .doc = "Seek each cpu straight to the buffer indicated by an index previously written with --write-index, rather than scanning from the beginning of the file.  Use with --window.", },
+
+    { .name = "window",
+      .key = OPT_WINDOW,
+      .arg = "start-tsc[,end-tsc]",
+      .doc = "Stop processing once past end-tsc.  With --use-index, start each cpu at the last indexed buffer at or before start-tsc.", },
 
     { 0 },
 };
@@ -10855,6 +11046,15 @@ int main(int argc, char *argv[]) {
     if ( (G.mh = mread_init(G.fd)) == NULL )
         perror("mread");
 
+    if (opt.write_index_file != NULL
+        && (G.index_out = fopen(opt.write_index_file, "w")) == NULL) {
+        perror("fopen");
+        error(ERR_SYSTEM, NULL);
+    }
+
+    if (opt.live)
+        signal(SIGINT, interrupt_handler);
+
     if (G.symbol_file != NULL)
         parse_symbol_file(G.symbol_file);
 
@@ -10880,6 +11080,9 @@ int main(int argc, char *argv[]) {
     if(opt.progress)
         progress_finish();
 
+    if(G.index_out)
+        fclose(G.index_out);
+
     return 0;
 }
 /*
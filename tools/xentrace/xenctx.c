@@ -684,21 +684,28 @@ static void print_ctx(vcpu_guest_context_any_t *ctx_any)
 #endif
 
 #ifndef NO_TRANSLATION
+/*
+ * Keep a handful of guest pages mapped across reads: stack walks
+ * revisit the same few pages over and over, and unaligned accesses
+ * straddling a page boundary alternate between two of them.
+ */
+#define NR_MAPPED_PAGES 16
+static struct {
+    unsigned long mfn;
+    void *mapped;
+} map_cache[NR_MAPPED_PAGES];
+static unsigned int map_cache_next;
+
 static void *map_page(vcpu_guest_context_any_t *ctx, int vcpu, guest_word_t virt)
 {
-    static unsigned long previous_mfn = 0;
-    static void *mapped = NULL;
-
     unsigned long mfn = xc_translate_foreign_address(xenctx.xc_handle, xenctx.domid, vcpu, virt);
     unsigned long offset = virt & ~XC_PAGE_MASK;
+    unsigned int i;
+    void *mapped;
 
-    if (mapped && mfn == previous_mfn)
-        goto out;
-
-    if (mapped)
-        munmap(mapped, XC_PAGE_SIZE);
-
-    previous_mfn = mfn;
+    for (i = 0; i < NR_MAPPED_PAGES; i++)
+        if (map_cache[i].mapped && map_cache[i].mfn == mfn)
+            return (void *)(map_cache[i].mapped + offset);
 
     mapped = xc_map_foreign_range(xenctx.xc_handle, xenctx.domid, XC_PAGE_SIZE, PROT_READ, mfn);
 
@@ -707,7 +714,12 @@ static void *map_page(vcpu_guest_context_any_t *ctx, int vcpu, guest_word_t virt
         return NULL;
     }
 
- out:
+    i = map_cache_next++ % NR_MAPPED_PAGES;
+    if (map_cache[i].mapped)
+        munmap(map_cache[i].mapped, XC_PAGE_SIZE);
+    map_cache[i].mfn = mfn;
+    map_cache[i].mapped = mapped;
+
     return (void *)(mapped + offset);
 }
 
@@ -976,11 +988,14 @@ static int print_stack(vcpu_guest_context_any_t *ctx, int vcpu, int width,
 }
 #endif
 
-static void dump_ctx(int vcpu)
+/* ctxp may be a context fetched in bulk beforehand, or NULL. */
+static void dump_ctx(int vcpu, vcpu_guest_context_any_t *ctxp)
 {
     vcpu_guest_context_any_t ctx;
 
-    if (xc_vcpu_getcontext(xenctx.xc_handle, xenctx.domid, vcpu, &ctx) < 0) {
+    if (ctxp)
+        ctx = *ctxp;
+    else if (xc_vcpu_getcontext(xenctx.xc_handle, xenctx.domid, vcpu, &ctx) < 0) {
         perror("xc_vcpu_getcontext");
         return;
     }
@@ -1040,7 +1055,35 @@ static void dump_ctx(int vcpu)
 static void dump_all_vcpus(void)
 {
     xc_vcpuinfo_t vinfo;
+    vcpu_guest_context_any_t *ctxs;
+    uint64_t *valid;
+    unsigned int i, nr = xenctx.dominfo.max_vcpu_id + 1;
     int vcpu;
+
+    /*
+     * Fetch all contexts up front, 64 per hypercall, so they reflect a
+     * single point in time rather than one getcontext round trip each.
+     */
+    ctxs = calloc(nr, sizeof(*ctxs));
+    valid = calloc((nr + 63) / 64, sizeof(*valid));
+    if (ctxs && valid) {
+        for (i = 0; i < nr; ) {
+            uint32_t chunk = nr - i > 64 ? 64 : nr - i;
+            uint32_t req = chunk;
+
+            if (xc_domain_get_vcpu_contexts(xenctx.xc_handle, xenctx.domid,
+                                            i, &chunk, &valid[i / 64],
+                                            &ctxs[i]) < 0 || chunk != req)
+                break;
+            i += chunk;
+        }
+        if (i < nr) {
+            /* Old hypervisor: fall back to per-vcpu fetches. */
+            free(ctxs);
+            ctxs = NULL;
+        }
+    }
+
     for (vcpu = 0; vcpu <= xenctx.dominfo.max_vcpu_id; vcpu++)
     {
         if ( xc_vcpu_getinfo(xenctx.xc_handle, xenctx.domid, vcpu, &vinfo) )
@@ -1048,12 +1091,16 @@ static void dump_all_vcpus(void)
         if ( vinfo.online )
         {
             printf("vcpu%d:\n", vcpu);
-            dump_ctx(vcpu);
+            dump_ctx(vcpu, ctxs && (valid[vcpu / 64] & (1ULL << (vcpu % 64)))
+                           ? &ctxs[vcpu] : NULL);
             printf("\n");
         }
         else
             printf("vcpu%d offline\n\n", vcpu);
     }
+
+    free(ctxs);
+    free(valid);
 }
 
 static void usage(void)
@@ -1282,14 +1329,14 @@ int main(int argc, char **argv)
 #ifndef NO_TRANSLATION
     if ( xenctx.do_memory )
     {
-        dump_ctx(vcpu);
+        dump_ctx(vcpu, NULL);
         if ( xenctx.do_stack || xenctx.all_vcpus )
             printf("\n");
     }
     xenctx.do_memory = 0;
     if ( xenctx.do_stack )
     {
-        dump_ctx(vcpu);
+        dump_ctx(vcpu, NULL);
         if ( xenctx.all_vcpus )
             printf("\n");
     }
@@ -1298,7 +1345,7 @@ int main(int argc, char **argv)
     if (xenctx.all_vcpus)
         dump_all_vcpus();
     if ( do_default )
-        dump_ctx(vcpu);
+        dump_ctx(vcpu, NULL);
 
     ret = xc_domain_unpause(xenctx.xc_handle, xenctx.domid);
     if (ret < 0) {
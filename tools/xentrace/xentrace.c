@@ -55,6 +55,7 @@ typedef struct settings_st {
     char *outfile;
     unsigned long poll_sleep; /* milliseconds to sleep between polls */
     uint32_t evt_mask;
+    uint32_t mute_mask;
     char *cpu_mask_str;
     unsigned long tbuf_size;
     unsigned long disk_rsvd;
@@ -584,6 +585,42 @@ static void set_evt_mask(uint32_t mask)
     }
 }
 
+/**
+ * set_mute_mask - set the low-priority (shed first when full) mask in HV
+ * @mask:           the new mask
+ */
+static void set_mute_mask(uint32_t mask)
+{
+    int ret = 0;
+
+    ret = xc_tbuf_set_mute_mask(xc_handle, mask);
+    fprintf(stderr, "change mutemask to 0x%x\n", mask);
+
+    if ( ret != 0 )
+    {
+        PERROR("Failure to set the mute mask in Xen");
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * print_drop_stats - report records lost or muted by Xen while tracing
+ */
+static void print_drop_stats(void)
+{
+    uint64_t lost, muted;
+
+    if ( xc_tbuf_get_drops(xc_handle, &lost, &muted) != 0 )
+    {
+        PERROR("Failure to get drop statistics from Xen");
+        return;
+    }
+
+    if ( lost || muted )
+        fprintf(stderr, "%"PRIu64" records lost, %"PRIu64" muted\n",
+                lost, muted);
+}
+
 /**
  * get_num_cpus - get the number of logical CPUs
  */
@@ -790,6 +827,8 @@ static int monitor_tbufs(void)
     if ( opts.memory_buffer )
         membuf_dump();
 
+    print_drop_stats();
+
     /* cleanup */
     free(meta);
     free(data);
@@ -819,14 +858,18 @@ static void usage(void)
 "  -c, --cpu-mask=c        Set cpu-mask, using either hex, CPU ranges, or\n" \
 "                          for all CPUs\n" \
 "  -e, --evt-mask=e        Set evt-mask\n" \
+"  -m, --mute-mask=m       Set mask of low-priority events which Xen sheds\n" \
+"                          first when a trace buffer runs nearly full,\n" \
+"                          instead of losing records indiscriminately.\n" \
 "  -s, --poll-sleep=p      Set sleep time, p, in milliseconds between\n" \
 "                          polling the trace buffer for new data\n" \
 "                          (default " xstr(POLL_SLEEP_MILLIS) ").\n" \
 "  -S, --trace-buf-size=N  Set trace buffer size in pages (default " \
                            xstr(DEFAULT_TBUF_SIZE) ").\n" \
-"                          N.B. that the trace buffer cannot be resized.\n" \
-"                          if it has already been set this boot cycle,\n" \
-"                          this argument will be ignored.\n" \
+"                          N.B. that resizing requires tracing to be\n" \
+"                          disabled and the buffers to be unmapped; if\n" \
+"                          that is not the case this argument will be\n" \
+"                          ignored.\n" \
 "  -D  --discard-buffers   Discard all records currently in the trace\n" \
 "                          buffers before beginning.\n" \
 "  -x  --dont-disable-tracing\n" \
@@ -1086,6 +1129,7 @@ static void parse_args(int argc, char **argv)
         { "poll-sleep",     required_argument, 0, 's' },
         { "cpu-mask",       required_argument, 0, 'c' },
         { "evt-mask",       required_argument, 0, 'e' },
+        { "mute-mask",      required_argument, 0, 'm' },
         { "trace-buf-size", required_argument, 0, 'S' },
         { "reserve-disk-space", required_argument, 0, 'r' },
         { "time-interval",  required_argument, 0, 'T' },
@@ -1098,7 +1142,7 @@ static void parse_args(int argc, char **argv)
         { 0, 0, 0, 0 }
     };
 
-    while ( (option = getopt_long(argc, argv, "t:s:c:e:S:r:T:M:DxX?V",
+    while ( (option = getopt_long(argc, argv, "t:s:c:e:m:S:r:T:M:DxX?V",
                     long_options, NULL)) != -1) 
     {
         switch ( option )
@@ -1113,7 +1157,11 @@ static void parse_args(int argc, char **argv)
         case 'e': /* set new event mask for filtering*/
             parse_evtmask(optarg);
             break;
-        
+
+        case 'm': /* set mask of events to shed first when nearly full */
+            opts.mute_mask = argtol(optarg, 0);
+            break;
+
         case 'S': /* set tbuf size (given in pages) */
             opts.tbuf_size = argtol(optarg, 0);
             break;
@@ -1172,6 +1220,7 @@ int main(int argc, char **argv)
     opts.outfile = 0;
     opts.poll_sleep = POLL_SLEEP_MILLIS;
     opts.evt_mask = 0;
+    opts.mute_mask = 0;
     opts.cpu_mask_str = NULL;
     opts.disk_rsvd = 0;
     opts.disable_tracing = 1;
@@ -1190,6 +1239,9 @@ int main(int argc, char **argv)
     if ( opts.evt_mask != 0 )
         set_evt_mask(opts.evt_mask);
 
+    if ( opts.mute_mask != 0 )
+        set_mute_mask(opts.mute_mask);
+
     if ( opts.cpu_mask_str )
     {
         if ( parse_cpu_mask() )
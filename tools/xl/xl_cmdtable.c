@@ -61,8 +61,8 @@ struct cmd_spec cmd_table[] = {
     },
     { "destroy",
       &main_destroy, 0, 1,
-      "Terminate a domain immediately",
-      "[options] <Domain>\n",
+      "Terminate one or more domains immediately",
+      "[options] <Domain> [Domain ...]\n",
       "-f                      Permit destroying domain 0, which will only succeed\n"
       "                        when run from disaggregated toolstack domain with a\n"
       "                        hardware domain distinct from domain 0."
@@ -1468,6 +1468,8 @@ void parse_config_data(const char *config_source,
         b_info->max_maptrack_frames = l;
     else if (max_maptrack_frames != -1)
         b_info->max_maptrack_frames = max_maptrack_frames;
+    if (!xlu_cfg_get_long (config, "grant_prealloc_frames", &l, 0))
+        b_info->grant_prealloc_frames = l;
 
     libxl_defbool_set(&b_info->claim_mode, claim_mode);
 
@@ -1516,6 +1518,8 @@ void parse_config_data(const char *config_source,
                                            b_info->max_vcpus);
 
     xlu_cfg_get_defbool(config, "nomigrate", &b_info->disable_migrate, 0);
+    xlu_cfg_replace_string (config, "storage_mirror_hook",
+                            &b_info->storage_mirror_hook, 0);
 
     if (!xlu_cfg_get_long(config, "tsc_mode", &l, 1)) {
         const char *s = libxl_tsc_mode_to_string(l);
@@ -1540,6 +1544,15 @@ void parse_config_data(const char *config_source,
         }
     }
 
+    if (!xlu_cfg_get_string(config, "numa_placement_policy", &buf, 0)) {
+        if (libxl_numa_placement_policy_from_string(
+                buf, &b_info->numa_placement_policy)) {
+            fprintf(stderr, "ERROR: invalid value \"%s\" for "
+                    "\"numa_placement_policy\"\n", buf);
+            exit (1);
+        }
+    }
+
     if (!xlu_cfg_get_long(config, "rtc_timeoffset", &l, 0))
         b_info->rtc_timeoffset = l;
 
@@ -42,17 +42,20 @@ static void unpause_domain(uint32_t domid)
     libxl_domain_unpause(ctx, domid);
 }
 
-static void destroy_domain(uint32_t domid, int force)
+static void destroy_domains(const uint32_t *domids, unsigned int nr, int force)
 {
+    unsigned int i;
     int rc;
 
-    if (domid == 0 && !force) {
-        fprintf(stderr, "Not destroying domain 0; use -f to force.\n"
-                        "This can only be done when using a disaggregated "
-                        "hardware domain and toolstack.\n\n");
-        exit(EXIT_FAILURE);
+    for (i = 0; i < nr; i++) {
+        if (domids[i] == 0 && !force) {
+            fprintf(stderr, "Not destroying domain 0; use -f to force.\n"
+                            "This can only be done when using a disaggregated "
+                            "hardware domain and toolstack.\n\n");
+            exit(EXIT_FAILURE);
+        }
     }
-    rc = libxl_domain_destroy(ctx, domid, 0);
+    rc = libxl_domains_destroy(ctx, domids, nr, 0);
     if (rc) { fprintf(stderr,"destroy failed (rc=%d)\n",rc); exit(EXIT_FAILURE); }
 }
 
@@ -86,6 +89,8 @@ int main_destroy(int argc, char **argv)
 {
     int opt;
     int force = 0;
+    uint32_t *domids;
+    unsigned int i, nr;
 
     SWITCH_FOREACH_OPT(opt, "f", NULL, "destroy", 1) {
     case 'f':
@@ -93,7 +98,13 @@ int main_destroy(int argc, char **argv)
         break;
     }
 
-    destroy_domain(find_domain(argv[optind]), force);
+    nr = argc - optind;
+    domids = xmalloc(sizeof(*domids) * nr);
+    for (i = 0; i < nr; i++)
+        domids[i] = find_domain(argv[optind + i]);
+
+    destroy_domains(domids, nr, force);
+    free(domids);
     return EXIT_SUCCESS;
 }
 
@@ -78,7 +78,7 @@ void idle_loop(void)
          * while we were scrubbing.
          */
         else if ( !softirq_pending(cpu) && !scrub_free_pages() &&
-                  !softirq_pending(cpu) )
+                  !tasklet_steal_work() && !softirq_pending(cpu) )
             do_idle();
 
         do_softirq();
@@ -163,8 +163,12 @@ static void ctxt_switch_from(struct vcpu *p)
 
     /* XXX MPU */
 
-    /* VFP */
-    vfp_save_state(p);
+    /* VFP, only if the outgoing vCPU actually touched it */
+    if ( p->arch.vfp_loaded )
+    {
+        vfp_save_state(p);
+        p->arch.vfp_loaded = false;
+    }
 
     /* VGIC */
     gic_save_state(p);
@@ -189,8 +193,11 @@ static void ctxt_switch_to(struct vcpu *n)
     /* VGIC */
     gic_restore_state(n);
 
-    /* VFP */
-    vfp_restore_state(n);
+    /*
+     * VFP is restored lazily: trap the first FP/SIMD access and only
+     * then reload the register file (see the HSR_EC_CP handler).
+     */
+    vfp_enable_trap();
 
     /* XXX MPU */
 
@@ -920,7 +927,7 @@ static int relinquish_memory(struct domain *d, struct page_list_head *list)
 
         put_page(page);
 
-        if ( hypercall_preempt_check() )
+        if ( general_preempt_check() )
         {
             ret = -ERESTART;
             goto out;
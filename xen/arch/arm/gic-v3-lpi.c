@@ -154,6 +154,18 @@ void vgic_vcpu_inject_lpi(struct domain *d, unsigned int virq)
     if ( vcpu_id >= d->max_vcpus )
           return;
 
+    /*
+     * LPIs are edge triggered and have no active state, so an edge
+     * arriving while the LPI is still queued coalesces with the queued
+     * instance.  Checking the (asynchronously updated) status bit here
+     * avoids taking the target vCPU's vgic lock at all during an
+     * interrupt storm: seeing a stale set bit merely means the earlier
+     * edge is only now being made visible to the guest, which covers
+     * this one too.
+     */
+    if ( test_bit(GIC_IRQ_GUEST_QUEUED, &p->status) )
+        return;
+
     vgic_inject_irq(d, d->vcpu[vcpu_id], virq, true);
 }
 
@@ -31,7 +31,7 @@
 
 static void gic_update_one_lr(struct vcpu *v, int i);
 
-static inline void gic_set_lr(int lr, struct pending_irq *p,
+static inline void gic_set_lr(struct vcpu *v, int lr, struct pending_irq *p,
                               unsigned int state)
 {
     ASSERT(!local_irq_is_enabled());
@@ -41,6 +41,17 @@ static inline void gic_set_lr(int lr, struct pending_irq *p,
     gic_hw_ops->update_lr(lr, p->irq, p->priority,
                           p->desc ? p->desc->irq : INVALID_IRQ, state);
 
+    if ( p->queue_time )
+    {
+        s_time_t lat = NOW() - p->queue_time;
+
+        v->arch.vgic.inj_lat_sum += lat;
+        if ( lat > v->arch.vgic.inj_lat_max )
+            v->arch.vgic.inj_lat_max = lat;
+        v->arch.vgic.inj_count++;
+        p->queue_time = 0;
+    }
+
     set_bit(GIC_IRQ_GUEST_VISIBLE, &p->status);
     clear_bit(GIC_IRQ_GUEST_QUEUED, &p->status);
     p->lr = lr;
@@ -152,7 +163,7 @@ void gic_raise_guest_irq(struct vcpu *v, unsigned int virtual_irq,
 
         if (i < nr_lrs) {
             set_bit(i, &this_cpu(lr_mask));
-            gic_set_lr(i, p, GICH_LR_PENDING);
+            gic_set_lr(v, i, p, GICH_LR_PENDING);
             return;
         }
     }
@@ -195,6 +206,7 @@ static void gic_update_one_lr(struct vcpu *v, int i)
         if ( test_bit(GIC_IRQ_GUEST_ENABLED, &p->status) &&
              test_and_clear_bit(GIC_IRQ_GUEST_QUEUED, &p->status) )
         {
+            p->queue_time = 0;
             if ( p->desc == NULL )
             {
                 lr_val.pending = true;
@@ -208,6 +220,9 @@ static void gic_update_one_lr(struct vcpu *v, int i)
     else if ( lr_val.pending )
     {
         int q __attribute__ ((unused)) = test_and_clear_bit(GIC_IRQ_GUEST_QUEUED, &p->status);
+
+        if ( q )
+            p->queue_time = 0;
 #ifdef GIC_DEBUG
         if ( q )
             gdprintk(XENLOG_DEBUG, "trying to inject irq=%d into %pv, when it is already pending in LR%d\n",
@@ -316,7 +331,7 @@ found:
             inflight_r = &p_r->inflight;
         }
 
-        gic_set_lr(lr, p, GICH_LR_PENDING);
+        gic_set_lr(v, lr, p, GICH_LR_PENDING);
         list_del_init(&p->lr_queue);
         set_bit(lr, &this_cpu(lr_mask));
 
@@ -410,6 +425,12 @@ void gic_dump_vgic_info(struct vcpu *v)
 
     list_for_each_entry( p, &v->arch.vgic.lr_pending, lr_queue )
         printk("Pending irq=%d\n", p->irq);
+
+    if ( v->arch.vgic.inj_count )
+        printk("Injections: %"PRIu64", latency avg=%"PRId64"ns max=%"PRId64"ns\n",
+               v->arch.vgic.inj_count,
+               v->arch.vgic.inj_lat_sum / v->arch.vgic.inj_count,
+               v->arch.vgic.inj_lat_max);
 }
 
 struct irq_desc *vgic_get_hw_irq_desc(struct domain *d, struct vcpu *v,
@@ -1106,6 +1106,113 @@ out:
     return rc;
 }
 
+/*
+ * Install a run of brand new 4K mappings sharing the same third-level
+ * table. The table walk is done once for the whole run, the PTE writes
+ * are cleaned from the cache in one go and a single IOTLB flush covers
+ * the run. As none of the entries replace a valid mapping, no
+ * break-before-make sequence (and hence no TLB flush) is required.
+ *
+ * Return the number of entries installed - possibly 0, in which case
+ * the caller has to fall back to __p2m_set_entry() - or a negative
+ * error.
+ */
+static long p2m_set_leaf_range(struct p2m_domain *p2m,
+                               gfn_t sgfn,
+                               mfn_t smfn,
+                               unsigned long nr,
+                               p2m_type_t t,
+                               p2m_access_t a)
+{
+    paddr_t addr = gfn_to_gaddr(sgfn);
+    unsigned int level;
+    unsigned long i, done = 0;
+    lpae_t *table, *entry;
+    int rc = 0, ret;
+
+    /* Convenience aliases */
+    const unsigned int offsets[4] = {
+        zeroeth_table_offset(addr),
+        first_table_offset(addr),
+        second_table_offset(addr),
+        third_table_offset(addr)
+    };
+
+    ASSERT(p2m_is_write_locked(p2m));
+    ASSERT(!p2m->mem_access_enabled);
+    ASSERT(!mfn_eq(smfn, INVALID_MFN));
+
+    /* Don't cross the third-level table mapped below. */
+    nr = min(nr, (unsigned long)LPAE_ENTRIES - offsets[3]);
+
+    table = p2m_get_root_pointer(p2m, sgfn);
+    if ( !table )
+        return -EINVAL;
+
+    for ( level = P2M_ROOT_LEVEL; level < 3; level++ )
+    {
+        ret = p2m_next_level(p2m, false, level, &table, offsets[level]);
+        /*
+         * Leave both allocation failures and in-place superpages
+         * (which need to be shattered) to the single-entry path.
+         */
+        if ( ret != GUEST_TABLE_NORMAL_PAGE )
+            goto out;
+    }
+
+    entry = table + offsets[3];
+
+    for ( i = 0; i < nr; i++, entry++ )
+    {
+        /*
+         * Only brand new mappings are installed here. Replacing a
+         * valid entry requires break-before-make, which is left to
+         * the single-entry path.
+         */
+        if ( lpae_is_valid(*entry) )
+            break;
+
+        p2m_write_pte(entry, mfn_to_p2m_entry(mfn_add(smfn, i), t, a),
+                      false);
+        p2m->stats.mappings[3]++;
+        done++;
+    }
+
+    if ( !done )
+        goto out;
+
+    if ( p2m->clean_pte )
+        clean_dcache_va_range(table + offsets[3], done * sizeof(lpae_t));
+
+    p2m->max_mapped_gfn = gfn_max(p2m->max_mapped_gfn, gfn_add(sgfn, done));
+    p2m->lowest_mapped_gfn = gfn_min(p2m->lowest_mapped_gfn, sgfn);
+
+    if ( has_iommu_pt(p2m->domain) )
+    {
+        unsigned int flush_flags = 0;
+
+        if ( need_iommu_pt_sync(p2m->domain) )
+        {
+            for ( i = 0; i < done && !rc; i++ )
+                rc = iommu_map(p2m->domain, _dfn(gfn_x(sgfn) + i),
+                               mfn_add(smfn, i), 0, p2m_get_iommu_flags(t),
+                               &flush_flags);
+        }
+
+        if ( !flush_flags )
+            flush_flags = IOMMU_FLUSHF_added;
+
+        if ( !rc )
+            rc = iommu_iotlb_flush(p2m->domain, _dfn(gfn_x(sgfn)), done,
+                                   flush_flags);
+    }
+
+out:
+    unmap_domain_page(table);
+
+    return rc ?: done;
+}
+
 int p2m_set_entry(struct p2m_domain *p2m,
                   gfn_t sgfn,
                   unsigned long nr,
@@ -1140,6 +1247,34 @@ int p2m_set_entry(struct p2m_domain *p2m,
         else
             order = THIRD_ORDER;
 
+        /*
+         * Batch runs of new 4K mappings sharing a third-level table:
+         * the table walk and the cache/IOTLB maintenance are then
+         * amortised over the whole run.
+         */
+        if ( order == THIRD_ORDER && nr > 1 &&
+             likely(!p2m->mem_access_enabled) &&
+             !mfn_eq(smfn, INVALID_MFN) )
+        {
+            long done = p2m_set_leaf_range(p2m, sgfn, smfn, nr, t, a);
+
+            if ( done < 0 )
+            {
+                rc = done;
+                break;
+            }
+
+            if ( done )
+            {
+                sgfn = gfn_add(sgfn, done);
+                smfn = mfn_add(smfn, done);
+                nr -= done;
+                continue;
+            }
+
+            /* Fall back to the single-entry path for this entry. */
+        }
+
         rc = __p2m_set_entry(p2m, sgfn, order, smfn, t, a);
         if ( rc )
             break;
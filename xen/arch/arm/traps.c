@@ -47,6 +47,7 @@
 #include <asm/regs.h>
 #include <asm/smccc.h>
 #include <asm/traps.h>
+#include <asm/vfp.h>
 #include <asm/vgic.h>
 #include <asm/vtimer.h>
 
@@ -2104,6 +2105,19 @@ void do_trap_guest_sync(struct cpu_user_regs *regs)
         do_cp14_dbg(regs, hsr);
         break;
     case HSR_EC_CP:
+        /*
+         * FP/SIMD state is restored lazily: the first access after a
+         * context switch traps here. Reload the register file, clear
+         * the trap and re-execute the faulting instruction.
+         */
+        if ( !current->arch.vfp_loaded )
+        {
+            perfc_incr(fp_lazy_restore);
+            vfp_disable_trap();
+            vfp_restore_state(current);
+            current->arch.vfp_loaded = true;
+            break;
+        }
         GUEST_BUG_ON(!psr_mode_is_32bit(regs->cpsr));
         perfc_incr(trap_cp);
         do_cp(regs, hsr);
@@ -570,7 +570,9 @@ void vgic_inject_irq(struct domain *d, struct vcpu *v, unsigned int virq,
         return;
     }
 
-    set_bit(GIC_IRQ_GUEST_QUEUED, &n->status);
+    /* Only stamp the first edge; further ones coalesce with it. */
+    if ( !test_and_set_bit(GIC_IRQ_GUEST_QUEUED, &n->status) )
+        n->queue_time = NOW();
 
     if ( !list_empty(&n->inflight) )
     {
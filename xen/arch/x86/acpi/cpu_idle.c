@@ -110,6 +110,14 @@ integer_param("max_cstate", max_cstate);
 static bool __read_mostly local_apic_timer_c2_ok;
 boolean_param("lapic_timer_c2_ok", local_apic_timer_c2_ok);
 
+/*
+ * Per-CPU QoS bounds consulted by the idle governor: a C-state type cap
+ * (like max_cstate, but per CPU) and a wakeup latency bound in
+ * microseconds derived from per-domain hints.  Zero means "no bound".
+ */
+DEFINE_PER_CPU(uint32_t, max_cstate_limit);
+DEFINE_PER_CPU(uint32_t, wakeup_latency_limit_us);
+
 struct acpi_processor_power *__read_mostly processor_powers[NR_CPUS];
 
 struct hw_residencies
@@ -489,7 +497,7 @@ static struct {
 
 void trace_exit_reason(u32 *irq_traced)
 {
-    if ( unlikely(tb_init_done) )
+    if ( tracing_active() )
     {
         int i, curbit;
         u32 irr_status[8] = { 0 };
@@ -1241,6 +1249,58 @@ uint32_t pmstat_get_cx_nr(uint32_t cpuid)
     return processor_powers[cpuid] ? processor_powers[cpuid]->count : 0;
 }
 
+uint32_t pmstat_get_last_cx(uint32_t cpuid)
+{
+    const struct acpi_processor_power *power = processor_powers[cpuid];
+
+    return power ? (power->last_state ? power->last_state->idx : 0) : ~0;
+}
+
+int cpuidle_set_max_cstate(unsigned int cpu, unsigned int limit)
+{
+    if ( cpu >= nr_cpu_ids || !cpu_online(cpu) )
+        return -EINVAL;
+
+    per_cpu(max_cstate_limit, cpu) = limit;
+
+    return 0;
+}
+
+/*
+ * Fold the per-domain wakeup latency hints into per-CPU bounds: every CPU
+ * a domain may run on (its cpupool's CPUs) gets the tightest hint of all
+ * such domains.  Called whenever a hint changes; hints must be re-issued
+ * if a domain moves between cpupools.
+ */
+void cpuidle_update_latency_limits(void)
+{
+    unsigned int cpu;
+    struct domain *d;
+
+    for_each_online_cpu ( cpu )
+        per_cpu(wakeup_latency_limit_us, cpu) = 0;
+
+    rcu_read_lock(&domlist_read_lock);
+
+    for_each_domain ( d )
+    {
+        uint32_t us = d->arch.wakeup_latency_us;
+
+        if ( !us )
+            continue;
+
+        for_each_cpu ( cpu, cpupool_domain_cpumask(d) )
+        {
+            uint32_t *limit = &per_cpu(wakeup_latency_limit_us, cpu);
+
+            if ( !*limit || us < *limit )
+                *limit = us;
+        }
+    }
+
+    rcu_read_unlock(&domlist_read_lock);
+}
+
 int pmstat_get_cx_stat(uint32_t cpuid, struct pm_cx_stat *stat)
 {
     struct acpi_processor_power *power = processor_powers[cpuid];
@@ -365,6 +365,116 @@ static void feature_detect(void *info)
     }
 }
 
+/*
+ * Hardware-managed P-states (HWP).  Where supported, hand P-state
+ * selection to the hardware: the governor's target frequency only sets a
+ * maximum-performance bound in IA32_HWP_REQUEST, leaving the hardware free
+ * to use all turbo headroom below it instead of the legacy P-state that a
+ * PERF_CTL write would pin.  "hwp=0" on the command line reverts to
+ * legacy P-state control.
+ */
+#define CPUID6_EAX_HWP              (1u << 7)
+#define CPUID6_EAX_HWP_EPP          (1u << 10)
+
+/* HWP-capable CPUs express performance levels in units of 100MHz. */
+#define HWP_RATIO_SCALE             100000  /* kHz per performance level */
+
+static bool __read_mostly opt_hwp = true;
+boolean_param("hwp", opt_hwp);
+
+static bool __read_mostly hwp_in_use;
+static bool __read_mostly hwp_has_epp;
+
+struct hwp_cpu_state {
+    uint8_t lowest, guaranteed, highest;
+    uint8_t min_perf, max_perf;
+    uint8_t epp;
+};
+static DEFINE_PER_CPU(struct hwp_cpu_state, hwp_state);
+
+/* Runs on the target CPU. */
+static void hwp_write_request(void *unused)
+{
+    const struct hwp_cpu_state *hwp = &this_cpu(hwp_state);
+    uint64_t val = hwp->min_perf | ((uint64_t)hwp->max_perf << 8);
+
+    /* Desired_Performance left at zero: fully autonomous selection. */
+    if ( hwp_has_epp )
+        val |= (uint64_t)hwp->epp << 24;
+
+    wrmsrl(MSR_IA32_HWP_REQUEST, val);
+}
+
+/* Runs on the target CPU. */
+static void hwp_init_cpu(void *unused)
+{
+    struct hwp_cpu_state *hwp = &this_cpu(hwp_state);
+    uint64_t caps;
+
+    wrmsrl(MSR_IA32_PM_ENABLE, 1);
+
+    rdmsrl(MSR_IA32_HWP_CAPABILITIES, caps);
+    hwp->highest = caps;
+    hwp->guaranteed = caps >> 8;
+    hwp->lowest = caps >> 24;
+
+    /* Autonomous operation over the full range, balanced preference. */
+    hwp->min_perf = hwp->lowest;
+    hwp->max_perf = hwp->highest;
+    hwp->epp = 0x80;
+
+    hwp_write_request(NULL);
+}
+
+static int hwp_cpufreq_target(struct cpufreq_policy *policy,
+                              unsigned int target_freq)
+{
+    cpumask_t online_policy_cpus;
+    unsigned int j;
+
+    cpumask_and(&online_policy_cpus, &cpu_online_map, policy->cpus);
+
+    for_each_cpu(j, &online_policy_cpus)
+    {
+        struct hwp_cpu_state *hwp = &per_cpu(hwp_state, j);
+        unsigned int ratio;
+
+        /*
+         * The P0 table entry stands for "no limit": only cap below the
+         * highest (turbo) level when the governor asks for less.
+         */
+        if ( target_freq >= policy->cpuinfo.max_freq )
+            ratio = hwp->highest;
+        else
+            ratio = max_t(unsigned int, target_freq / HWP_RATIO_SCALE,
+                          hwp->lowest);
+
+        hwp->max_perf = min_t(unsigned int, ratio, hwp->highest);
+        hwp->min_perf = hwp->lowest;
+    }
+
+    on_selected_cpus(&online_policy_cpus, hwp_write_request, NULL, 1);
+
+    policy->cur = target_freq;
+
+    return 0;
+}
+
+int hwp_set_epp(unsigned int cpu, unsigned int epp)
+{
+    if ( !hwp_in_use || !hwp_has_epp )
+        return -EOPNOTSUPP;
+    if ( epp > 0xff )
+        return -EINVAL;
+    if ( !per_cpu(cpufreq_cpu_policy, cpu) )
+        return -EINVAL;
+
+    per_cpu(hwp_state, cpu).epp = epp;
+    on_selected_cpus(cpumask_of(cpu), hwp_write_request, NULL, 1);
+
+    return 0;
+}
+
 static unsigned int check_freqs(const cpumask_t *mask, unsigned int freq,
                                 struct acpi_cpufreq_data *data)
 {
@@ -402,6 +512,9 @@ static int acpi_cpufreq_target(struct cpufreq_policy *policy,
         if (target_freq > policy->cpuinfo.second_max_freq)
             target_freq = policy->cpuinfo.second_max_freq;
 
+    if ( hwp_in_use )
+        return hwp_cpufreq_target(policy, target_freq);
+
     perf = data->acpi_data;
     result = cpufreq_frequency_table_target(policy,
                                             data->freq_table,
@@ -603,6 +716,20 @@ acpi_cpufreq_cpu_init(struct cpufreq_policy *policy)
     if (c->x86_vendor == X86_VENDOR_INTEL && c->cpuid_level >= 6)
         on_selected_cpus(cpumask_of(cpu), feature_detect, policy, 1);
 
+    /* Let the hardware pick P-states within the governor's bounds. */
+    if ( opt_hwp && c->x86_vendor == X86_VENDOR_INTEL && c->cpuid_level >= 6 &&
+         (cpuid_eax(6) & CPUID6_EAX_HWP) )
+    {
+        if ( !hwp_in_use )
+        {
+            hwp_in_use = true;
+            hwp_has_epp = !!(cpuid_eax(6) & CPUID6_EAX_HWP_EPP);
+            printk(XENLOG_INFO "HWP: hardware-managed P-states enabled%s\n",
+                   hwp_has_epp ? " (with EPP control)" : "");
+        }
+        on_selected_cpus(cpumask_of(cpu), hwp_init_cpu, NULL, 1);
+    }
+
     /*
      * the first call to ->target() should result in us actually
      * writing something to the appropriate registers.
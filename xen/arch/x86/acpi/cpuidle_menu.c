@@ -229,7 +229,13 @@ static int menu_select(struct acpi_processor_power *power)
             break;
         if (s->latency * LATENCY_MULTIPLIER > data->latency_factor)
             break;
-        /* TBD: we need to check the QoS requirment in future */
+        /* QoS bounds requested via domctl/sysctl (0 = unbounded) */
+        if (this_cpu(max_cstate_limit) &&
+            s->type > this_cpu(max_cstate_limit))
+            break;
+        if (this_cpu(wakeup_latency_limit_us) &&
+            s->latency > this_cpu(wakeup_latency_limit_us))
+            break;
         data->exit_us = s->latency;
         data->last_state_idx = i;
     }
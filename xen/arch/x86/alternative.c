@@ -25,6 +25,7 @@
 #include <asm/traps.h>
 #include <asm/nmi.h>
 #include <asm/nops.h>
+#include <asm/static_branch.h>
 #include <xen/livepatch.h>
 
 #define MAX_PATCH_LEN (255-1)
@@ -249,6 +250,42 @@ void init_or_livepatch apply_alternatives(struct alt_instr *start,
     }
 }
 
+/*
+ * Switch one static branch site between a 5-byte nop and a jump to its
+ * target.  Called from stop_machine context: all other CPUs spin with
+ * interrupts disabled, so none can be executing the instruction being
+ * rewritten, and all serialize (via IRET) before running guest or Xen
+ * code again.  The nop bytes must match those emitted at build time by
+ * arch_static_branch(), not the runtime ideal nops, as disabling a
+ * branch has to restore the original instruction.
+ */
+void arch_static_branch_patch(const struct static_branch_entry *e, bool enable)
+{
+    static const uint8_t nop5[] = { 0x0f, 0x1f, 0x44, 0x00, 0x00 };
+    uint8_t *orig = SB_ORIG_PTR(e);
+    uint8_t buf[STATIC_BRANCH_INSN_LEN];
+    unsigned long cr0 = read_cr0();
+
+    BUILD_BUG_ON(sizeof(nop5) != STATIC_BRANCH_INSN_LEN);
+
+    if ( enable )
+    {
+        int32_t disp = SB_TARGET_PTR(e) - (orig + STATIC_BRANCH_INSN_LEN);
+
+        buf[0] = 0xe9; /* jmp rel32 */
+        memcpy(buf + 1, &disp, sizeof(disp));
+    }
+    else
+        memcpy(buf, nop5, sizeof(nop5));
+
+    /* Disable WP to allow patching read-only pages. */
+    write_cr0(cr0 & ~X86_CR0_WP);
+
+    memcpy(orig, buf, sizeof(buf));
+
+    write_cr0(cr0);
+}
+
 static bool __initdata alt_done;
 
 /*
@@ -363,17 +363,24 @@ void vpmu_save(struct vcpu *v)
         if ( vpmu->arch_vpmu_ops->arch_vpmu_save(v, 0) )
             vpmu_reset(vpmu, VPMU_CONTEXT_LOADED);
 
-    apic_write(APIC_LVTPC, PMU_APIC_VECTOR | APIC_LVT_MASKED);
+    /*
+     * Idle counters cannot raise a PMU interrupt, so the LVTPC only needs
+     * masking when the outgoing vCPU was actually counting.
+     */
+    if ( vpmu_is_set(vpmu, VPMU_RUNNING) )
+        apic_write(APIC_LVTPC, PMU_APIC_VECTOR | APIC_LVT_MASKED);
 }
 
-int vpmu_load(struct vcpu *v, bool_t from_guest)
+/*
+ * Make the current pCPU ready to load @v's context: fetch the context from
+ * the pCPU it was last loaded on, and save whatever context the previous
+ * occupant of this pCPU has left in the counters.
+ */
+void vpmu_evict(struct vcpu *v)
 {
     struct vpmu_struct *vpmu = vcpu_vpmu(v);
     int pcpu = smp_processor_id();
-    struct vcpu *prev = NULL;
-
-    if ( !vpmu_is_set(vpmu, VPMU_CONTEXT_ALLOCATED) )
-        return 0;
+    struct vcpu *prev;
 
     /* First time this VCPU is running here */
     if ( vpmu->last_pcpu != pcpu )
@@ -391,7 +398,7 @@ int vpmu_load(struct vcpu *v, bool_t from_guest)
                              vpmu_save_force, (void *)v, 1);
             vpmu_reset(vpmu, VPMU_CONTEXT_LOADED);
         }
-    } 
+    }
 
     /* Prevent forced context save from remote CPU */
     local_irq_disable();
@@ -400,16 +407,35 @@ int vpmu_load(struct vcpu *v, bool_t from_guest)
 
     if ( prev != v && prev )
     {
-        vpmu = vcpu_vpmu(prev);
-
         /* Someone ran here before us */
         vpmu_save_force(prev);
-        vpmu_reset(vpmu, VPMU_CONTEXT_LOADED);
-
-        vpmu = vcpu_vpmu(v);
+        vpmu_reset(vcpu_vpmu(prev), VPMU_CONTEXT_LOADED);
     }
 
     local_irq_enable();
+}
+
+int vpmu_load(struct vcpu *v, bool_t from_guest)
+{
+    struct vpmu_struct *vpmu = vcpu_vpmu(v);
+
+    if ( !vpmu_is_set(vpmu, VPMU_CONTEXT_ALLOCATED) )
+        return 0;
+
+    /*
+     * If the incoming vCPU has no active counters, leave whatever context
+     * occupies this pCPU in place: all PMU MSR accesses are intercepted
+     * while counters are idle, so the vendor code evicts it lazily on the
+     * first access and context switches of non-profiling vCPUs touch
+     * neither the counters nor remote pCPUs.
+     */
+    if ( !from_guest &&
+         (!vpmu_is_set(vpmu, VPMU_RUNNING) ||
+          (!has_vlapic(vpmu_vcpu(vpmu)->domain) &&
+           vpmu_is_set(vpmu, VPMU_CACHED))) )
+        return 0;
+
+    vpmu_evict(v);
 
     /* Only when PMU is counting, we load PMU context immediately. */
     if ( !vpmu_is_set(vpmu, VPMU_RUNNING) ||
@@ -290,6 +290,11 @@ static int amd_vpmu_save(struct vcpu *v,  bool_t to_guest)
     struct vpmu_struct *vpmu = vcpu_vpmu(v);
     unsigned int i;
 
+    /* A frozen context already has its counters stopped. */
+    if ( vpmu_is_set(vpmu, VPMU_FROZEN) &&
+         !vpmu_is_set(vpmu, VPMU_CONTEXT_SAVE) )
+        return 0;
+
     /* Stop the counters. */
     for ( i = 0; i < num_counters; i++ )
         wrmsrl(ctrls[i], 0);
@@ -398,6 +403,8 @@ static int amd_vpmu_do_wrmsr(unsigned int msr, uint64_t msr_content,
     if ( !vpmu_is_set(vpmu, VPMU_CONTEXT_LOADED)
         || vpmu_is_set(vpmu, VPMU_FROZEN) )
     {
+        if ( !vpmu_is_set(vpmu, VPMU_CONTEXT_LOADED) )
+            vpmu_evict(v);
         context_load(v);
         vpmu_set(vpmu, VPMU_CONTEXT_LOADED);
         vpmu_reset(vpmu, VPMU_FROZEN);
@@ -419,6 +426,8 @@ static int amd_vpmu_do_rdmsr(unsigned int msr, uint64_t *msr_content)
     if ( !vpmu_is_set(vpmu, VPMU_CONTEXT_LOADED)
         || vpmu_is_set(vpmu, VPMU_FROZEN) )
     {
+        if ( !vpmu_is_set(vpmu, VPMU_CONTEXT_LOADED) )
+            vpmu_evict(v);
         context_load(v);
         vpmu_set(vpmu, VPMU_CONTEXT_LOADED);
         vpmu_reset(vpmu, VPMU_FROZEN);
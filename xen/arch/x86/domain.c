@@ -141,7 +141,7 @@ static void idle_loop(void)
          * while we were scrubbing.
          */
         else if ( !softirq_pending(cpu) && !scrub_free_pages()  &&
-                    !softirq_pending(cpu) )
+                  !tasklet_steal_work() && !softirq_pending(cpu) )
             pm_idle();
         do_softirq();
         /*
@@ -312,8 +312,10 @@ struct vcpu *alloc_vcpu_struct(const struct domain *d)
      * may require that the shadow CR3 points below 4GB, and hence the whole
      * structure must satisfy this restriction. Thus we specify MEMF_bits(32).
      */
-    unsigned int memflags =
-        (is_hvm_domain(d) && paging_mode_shadow(d)) ? MEMF_bits(32) : 0;
+    unsigned int memflags = MEMF_node(domain_affinity_node(d));
+
+    if ( is_hvm_domain(d) && paging_mode_shadow(d) )
+        memflags |= MEMF_bits(32);
 
     BUILD_BUG_ON(sizeof(*v) > PAGE_SIZE);
     v = alloc_xenheap_pages(0, memflags);
@@ -569,7 +571,8 @@ int arch_domain_create(struct domain *d,
      * The shared_info machine address must fit in a 32-bit field within a
      * 32-bit guest's start_info structure. Hence we specify MEMF_bits(32).
      */
-    if ( (d->shared_info = alloc_xenheap_pages(0, MEMF_bits(32))) == NULL )
+    if ( (d->shared_info = alloc_xenheap_pages(0, MEMF_bits(32) |
+                               MEMF_node(domain_affinity_node(d)))) == NULL )
         goto fail;
 
     clear_page(d->shared_info);
@@ -607,6 +610,10 @@ int arch_domain_create(struct domain *d,
     /* PV/PVH guests get an emulated PIT too for video BIOSes to use. */
     pit_init(d, cpu_khz);
 
+    /* Allocation failure merely disables hypercall latency accounting. */
+    d->arch.hypercall_stats = xzalloc_array(struct hypercall_stats,
+                                            NR_hypercalls);
+
     /*
      * If the FPU does not save FCS/FDS then we can always
      * save/restore the 64-bit FIP/FDP and ignore the selectors.
@@ -638,6 +645,7 @@ void arch_domain_destroy(struct domain *d)
     xfree(d->arch.e820);
     xfree(d->arch.cpuid);
     xfree(d->arch.msr);
+    xfree(d->arch.hypercall_stats);
 
     free_domain_pirqs(d);
     if ( !is_idle_domain(d) )
@@ -689,7 +697,7 @@ int arch_domain_soft_reset(struct domain *d)
 
     hvm_domain_soft_reset(d);
 
-    spin_lock(&d->event_lock);
+    write_lock(&d->event_lock);
     for ( i = 0; i < d->nr_pirqs ; i++ )
     {
         if ( domain_pirq_to_emuirq(d, i) != IRQ_UNBOUND )
@@ -699,7 +707,7 @@ int arch_domain_soft_reset(struct domain *d)
                 break;
         }
     }
-    spin_unlock(&d->event_lock);
+    write_unlock(&d->event_lock);
 
     if ( ret )
         return ret;
@@ -1934,7 +1942,7 @@ static int relinquish_memory(
         page_list_add_tail(page, &d->arch.relmem_list);
         put_page(page);
 
-        if ( hypercall_preempt_check() )
+        if ( general_preempt_check() )
         {
             ret = -ERESTART;
             goto out;
@@ -1988,6 +1996,12 @@ int domain_relinquish_resources(struct domain *d)
         };
 
     case 0:
+        /*
+         * Make all type counts exact again; no new split-counted pages
+         * can appear once d->is_dying is set.
+         */
+        pgt_split_fold_domain(d);
+
         ret = pci_release_devices(d);
         if ( ret )
             return ret;
@@ -2132,8 +2146,14 @@ void vcpu_kick(struct vcpu *v)
 
 void vcpu_mark_events_pending(struct vcpu *v)
 {
-    int already_pending = test_and_set_bit(
-        0, (unsigned long *)&vcpu_info(v, evtchn_upcall_pending));
+    /*
+     * Test first: the locked RMW would pull the (guest-shared) line
+     * exclusive even when the flag is already set.
+     */
+    int already_pending =
+        test_bit(0, (unsigned long *)&vcpu_info(v, evtchn_upcall_pending)) ||
+        test_and_set_bit(
+            0, (unsigned long *)&vcpu_info(v, evtchn_upcall_pending));
 
     if ( already_pending )
         return;
@@ -62,6 +62,9 @@ void __init mapcache_override_current(struct vcpu *v)
     this_cpu(override) = v;
 }
 
+/* Above this many stale entries a full TLB flush beats per-address ones. */
+#define MAPCACHE_FLUSH_THRESHOLD 16
+
 #define mapcache_l2_entry(e) ((e) >> PAGETABLE_ORDER)
 #define MAPCACHE_L2_ENTRIES (mapcache_l2_entry(MAPCACHE_ENTRIES - 1) + 1)
 #define MAPCACHE_L1ENT(idx) \
@@ -122,13 +125,34 @@ void *map_domain_page(mfn_t mfn)
     if ( unlikely(idx >= dcache->entries) )
     {
         unsigned long accum = 0, prev = 0;
+        unsigned int reaped[MAPCACHE_FLUSH_THRESHOLD], nr_reaped = 0;
+        bool full_flush = false;
+
+        perfc_incr(domain_page_wrap);
 
         /* /First/, clean the garbage map and update the inuse list. */
         for ( i = 0; i < BITS_TO_LONGS(dcache->entries); i++ )
         {
+            unsigned long reap = xchg(&dcache->garbage[i], 0);
+
             accum |= prev;
-            dcache->inuse[i] &= ~xchg(&dcache->garbage[i], 0);
+            dcache->inuse[i] &= ~reap;
             prev = ~dcache->inuse[i];
+
+            if ( !full_flush )
+            {
+                unsigned int b;
+
+                for_each_set_bit ( b, &reap, BITS_PER_LONG )
+                {
+                    if ( nr_reaped == ARRAY_SIZE(reaped) )
+                    {
+                        full_flush = true;
+                        break;
+                    }
+                    reaped[nr_reaped++] = i * BITS_PER_LONG + b;
+                }
+            }
         }
 
         if ( accum | (prev & BITMAP_LAST_WORD_MASK(dcache->entries)) )
@@ -146,6 +170,8 @@ void *map_domain_page(mfn_t mfn)
                     l1e_write(&MAPCACHE_L1ENT(idx), l1e_empty());
                     hashent->idx = MAPHASHENT_NOTINUSE;
                     hashent->mfn = ~0UL;
+                    if ( !nr_reaped )
+                        reaped[nr_reaped++] = idx;
                     break;
                 }
                 if ( ++i == MAPHASH_ENTRIES )
@@ -154,9 +180,24 @@ void *map_domain_page(mfn_t mfn)
         }
         BUG_ON(idx >= dcache->entries);
 
-        /* /Second/, flush TLBs. */
-        perfc_incr(domain_page_tlb_flush);
-        flush_tlb_local();
+        /*
+         * /Second/, flush TLBs. Few stale mappings can be invalidated by
+         * address (covering all PCIDs via flush_area_local()), which is
+         * cheaper than repopulating a fully flushed TLB. Remote CPUs are
+         * dealt with by the epoch/timestamp check above either way.
+         */
+        if ( full_flush )
+        {
+            perfc_incr(domain_page_tlb_flush);
+            flush_tlb_local();
+        }
+        else
+            for ( i = 0; i < nr_reaped; i++ )
+            {
+                perfc_incr(domain_page_inv_addr);
+                flush_tlb_one_local((void *)MAPCACHE_VIRT_START +
+                                    pfn_to_paddr(reaped[i]));
+            }
         vcache->shadow_epoch = ++dcache->epoch;
         dcache->tlbflush_timestamp = tlbflush_current_time();
     }
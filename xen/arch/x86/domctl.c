@@ -29,6 +29,7 @@
 #include <xsm/xsm.h>
 #include <xen/iommu.h>
 #include <xen/vm_event.h>
+#include <xen/cpuidle.h>
 #include <public/vm_event.h>
 #include <asm/mem_sharing.h>
 #include <asm/xstate.h>
@@ -1505,6 +1506,15 @@ long arch_do_domctl(
         recalculate_cpuid_policy(d);
         break;
 
+    case XEN_DOMCTL_superpage_promotion:
+        ret = p2m_promote_enable(d, !!domctl->u.superpage_promotion.enable);
+        break;
+
+    case XEN_DOMCTL_set_wakeup_latency:
+        d->arch.wakeup_latency_us = domctl->u.set_wakeup_latency.latency_us;
+        cpuidle_update_latency_limits();
+        break;
+
     case XEN_DOMCTL_get_cpu_policy:
         /* Process the CPUID leaves. */
         if ( guest_handle_is_null(domctl->u.cpu_policy.cpuid_policy) )
@@ -24,6 +24,14 @@
 #define WRAP_MASK (0x000003FFU)
 #endif
 
+/*
+ * Largest region (as an order of 4k pages) to invalidate by iterating over
+ * individual addresses rather than flushing the entire TLB.  16 pages keeps
+ * the cost below that of repopulating a freshly emptied TLB even with the
+ * four INVPCIDs per page needed when XPTI is active.
+ */
+#define FLUSH_INVLPG_MAX_ORDER 4
+
 u32 tlbflush_clock = 1U;
 DEFINE_PER_CPU(u32, tlbflush_time);
 
@@ -196,37 +204,43 @@ unsigned int flush_area_local(const void *va, unsigned int flags)
 
     if ( flags & (FLUSH_TLB|FLUSH_TLB_GLOBAL) )
     {
-        if ( order == 0 )
+        if ( order <= FLUSH_INVLPG_MAX_ORDER )
         {
+            unsigned long addr = (unsigned long)va;
+            bool pcide = read_cr4() & X86_CR4_PCIDE;
+            unsigned int i;
+
             /*
-             * We don't INVLPG multi-page regions because the 2M/4M/1G
-             * region may not have been mapped with a superpage. Also there
-             * are various errata surrounding INVLPG usage on superpages, and
-             * a full flush is in any case not *that* expensive.
+             * INVLPG and INVPCID invalidate all TLB entries covering the
+             * given linear address, including ones installed via superpage
+             * mappings, so walking a small region in page size steps is
+             * correct no matter how it is actually mapped.  Larger regions
+             * are cheaper to deal with by a full flush.
              */
-            if ( read_cr4() & X86_CR4_PCIDE )
+            for ( i = 0; i < (1u << order); i++, addr += PAGE_SIZE )
             {
-                unsigned long addr = (unsigned long)va;
-
-                /*
-                 * Flush the addresses for all potential address spaces.
-                 * We can't check the current domain for being subject to
-                 * XPTI as current might be the idle vcpu while we still have
-                 * some XPTI domain TLB entries.
-                 * Using invpcid is okay here, as with PCID enabled we always
-                 * have global pages disabled.
-                 */
-                invpcid_flush_one(PCID_PV_PRIV, addr);
-                invpcid_flush_one(PCID_PV_USER, addr);
-                if ( opt_xpti_hwdom || opt_xpti_domu )
+                if ( pcide )
                 {
-                    invpcid_flush_one(PCID_PV_PRIV | PCID_PV_XPTI, addr);
-                    invpcid_flush_one(PCID_PV_USER | PCID_PV_XPTI, addr);
+                    /*
+                     * Flush the addresses for all potential address spaces.
+                     * We can't check the current domain for being subject to
+                     * XPTI as current might be the idle vcpu while we still
+                     * have some XPTI domain TLB entries.
+                     * Using invpcid is okay here, as with PCID enabled we
+                     * always have global pages disabled.
+                     */
+                    invpcid_flush_one(PCID_PV_PRIV, addr);
+                    invpcid_flush_one(PCID_PV_USER, addr);
+                    if ( opt_xpti_hwdom || opt_xpti_domu )
+                    {
+                        invpcid_flush_one(PCID_PV_PRIV | PCID_PV_XPTI, addr);
+                        invpcid_flush_one(PCID_PV_USER | PCID_PV_XPTI, addr);
+                    }
                 }
+                else
+                    asm volatile ( "invlpg %0"
+                                   : : "m" (*(const char *)addr) : "memory" );
             }
-            else
-                asm volatile ( "invlpg %0"
-                               : : "m" (*(const char *)(va)) : "memory" );
         }
         else
             do_tlb_flush();
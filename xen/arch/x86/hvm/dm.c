@@ -448,11 +448,12 @@ static int dm_op(const struct dmop_args *op_args)
             &op.u.map_io_range_to_ioreq_server;
 
         rc = -EINVAL;
-        if ( data->pad )
+        if ( data->flags & ~XEN_DMOP_IO_RANGE_POSTED_WRITE )
             break;
 
         rc = hvm_map_io_range_to_ioreq_server(d, data->id, data->type,
-                                              data->start, data->end);
+                                              data->flags, data->start,
+                                              data->end);
         break;
     }
 
@@ -462,7 +463,7 @@ static int dm_op(const struct dmop_args *op_args)
             &op.u.unmap_io_range_from_ioreq_server;
 
         rc = -EINVAL;
-        if ( data->pad )
+        if ( data->flags )
             break;
 
         rc = hvm_unmap_io_range_from_ioreq_server(d, data->id, data->type,
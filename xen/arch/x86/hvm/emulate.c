@@ -32,7 +32,7 @@ static void hvmtrace_io_assist(const ioreq_t *p)
     unsigned int size, event;
     unsigned char buffer[16];
 
-    if ( likely(!tb_init_done) )
+    if ( !tracing_active() )
         return;
 
     if ( p->type == IOREQ_TYPE_COPY )
@@ -300,6 +300,20 @@ static int hvmemul_do_io(
         }
         else
         {
+            /*
+             * Writes to a range the server registered as write-posted
+             * complete without waiting for the device model, unless the
+             * buffered ring is full (in which case fall back to the
+             * synchronous path below).
+             */
+            if ( hvm_ioreq_posted_write(s, &p) &&
+                 hvm_send_ioreq(s, &p, 1) == X86EMUL_OKAY )
+            {
+                rc = X86EMUL_OKAY;
+                vio->io_req.state = STATE_IOREQ_NONE;
+                break;
+            }
+
             rc = hvm_send_ioreq(s, &p, 0);
             if ( rc != X86EMUL_RETRY || currd->is_shutting_down )
                 vio->io_req.state = STATE_IOREQ_NONE;
@@ -782,6 +796,43 @@ static int hvmemul_linear_to_phys(
     *paddr = ((paddr_t)pfn << PAGE_SHIFT) | offset;
     return X86EMUL_OKAY;
 }
+
+/*
+ * Batched continuation helper for the RAM paths of the REP handlers:
+ * translate the linear range starting at @addr and clip @reps to the
+ * physically contiguous plain-RAM run found there.  Unlike a plain
+ * hvmemul_linear_to_phys() call this never raises an event, so it is
+ * safe to use once earlier iterations of the repeated operation have
+ * already been carried out: on any translation failure, or when the run
+ * starts in an MMIO range, 0 is returned and the caller simply reports
+ * the iterations done so far, leaving the remainder to a re-execution
+ * of the (suitably advanced) instruction.
+ */
+static unsigned long hvmemul_next_ram_run(
+    unsigned long addr,
+    paddr_t *gpa,
+    unsigned int bytes_per_rep,
+    unsigned long reps,
+    uint32_t pfec,
+    struct hvm_emulate_ctxt *hvmemul_ctxt)
+{
+    p2m_type_t p2mt;
+    int rc = hvmemul_linear_to_phys(addr, gpa, bytes_per_rep, &reps, pfec,
+                                    hvmemul_ctxt);
+
+    if ( rc != X86EMUL_OKAY )
+    {
+        if ( rc == X86EMUL_EXCEPTION )
+            x86_emul_reset_event(&hvmemul_ctxt->ctxt);
+        return 0;
+    }
+
+    (void)get_gfn_query_unlocked(current->domain, *gpa >> PAGE_SHIFT, &p2mt);
+    if ( p2mt == p2m_mmio_direct || p2mt == p2m_mmio_dm )
+        return 0;
+
+    return reps;
+}
     
 
 static int hvmemul_virtual_to_linear(
@@ -1691,7 +1742,7 @@ static int hvmemul_rep_movs(
     struct hvm_emulate_ctxt *hvmemul_ctxt =
         container_of(ctxt, struct hvm_emulate_ctxt, ctxt);
     struct hvm_vcpu_io *vio = &current->arch.hvm.hvm_io;
-    unsigned long saddr, daddr, bytes;
+    unsigned long saddr, daddr, bytes, orig_reps;
     paddr_t sgpa, dgpa;
     uint32_t pfec = PFEC_page_present;
     p2m_type_t sp2mt, dp2mt;
@@ -1710,6 +1761,9 @@ static int hvmemul_rep_movs(
     if ( rc != X86EMUL_OKAY )
         return rc;
 
+    /* Cap as hvmemul_linear_to_phys() does, for use by the batching below. */
+    orig_reps = min_t(unsigned long, *reps, 4096);
+
     if ( hvmemul_ctxt->seg_reg[x86_seg_ss].dpl == 3 )
         pfec |= PFEC_user_mode;
 
@@ -1818,6 +1872,59 @@ static int hvmemul_rep_movs(
     if ( rc == HVMTRANS_okay )
         rc = hvm_copy_to_guest_phys(dgpa, buf, bytes, current);
 
+    /*
+     * The translations above clip the batch at the first discontiguity
+     * in either physical range.  Rather than re-entering the emulator
+     * once per contiguous run, pre-translate and copy further runs in
+     * the same pass, feeding the grand total back through *reps.
+     * Forward copies only - reverse ones are rare and not worth the
+     * extra complexity.
+     */
+    if ( rc == HVMTRANS_okay && !df && !hvmemul_ctxt->set_context )
+    {
+        unsigned long done = *reps;
+        const unsigned long buf_reps = bytes / bytes_per_rep;
+        unsigned int i;
+
+        for ( i = 0; done < orig_reps && i < 16; i++ )
+        {
+            unsigned long srun, drun;
+            paddr_t nsgpa, ndgpa;
+
+            saddr += bytes;
+            daddr += bytes;
+
+            srun = hvmemul_next_ram_run(saddr, &nsgpa, bytes_per_rep,
+                                        min(orig_reps - done, buf_reps),
+                                        pfec, hvmemul_ctxt);
+            if ( !srun )
+                break;
+
+            drun = hvmemul_next_ram_run(daddr, &ndgpa, bytes_per_rep, srun,
+                                        pfec | PFEC_write_access,
+                                        hvmemul_ctxt);
+            if ( !drun )
+                break;
+
+            bytes = drun * bytes_per_rep;
+
+            /* Self-overlapping runs can't go through the bounce buffer. */
+            if ( ((ndgpa + bytes_per_rep) > nsgpa) &&
+                 (ndgpa < (nsgpa + bytes)) )
+                break;
+
+            if ( hvm_copy_from_guest_phys(buf, nsgpa, bytes) !=
+                 HVMTRANS_okay ||
+                 hvm_copy_to_guest_phys(ndgpa, buf, bytes, current) !=
+                 HVMTRANS_okay )
+                break;
+
+            done += drun;
+        }
+
+        *reps = done;
+    }
+
     xfree(buf);
 
     if ( rc == HVMTRANS_gfn_paged_out )
@@ -1846,9 +1953,10 @@ static int hvmemul_rep_stos(
     struct hvm_emulate_ctxt *hvmemul_ctxt =
         container_of(ctxt, struct hvm_emulate_ctxt, ctxt);
     struct hvm_vcpu_io *vio = &current->arch.hvm.hvm_io;
-    unsigned long addr, bytes;
+    unsigned long addr, bytes, orig_reps;
     paddr_t gpa;
     p2m_type_t p2mt;
+    uint32_t pfec = PFEC_page_present | PFEC_write_access;
     bool_t df = !!(ctxt->regs->eflags & X86_EFLAGS_DF);
     int rc = hvmemul_virtual_to_linear(seg, offset, bytes_per_rep, reps,
                                        hvm_access_write, hvmemul_ctxt, &addr);
@@ -1856,6 +1964,12 @@ static int hvmemul_rep_stos(
     if ( rc != X86EMUL_OKAY )
         return rc;
 
+    if ( hvmemul_ctxt->seg_reg[x86_seg_ss].dpl == 3 )
+        pfec |= PFEC_user_mode;
+
+    /* Cap as hvmemul_linear_to_phys() does, for use by the batching below. */
+    orig_reps = min_t(unsigned long, *reps, 4096);
+
     bytes = PAGE_SIZE - (addr & ~PAGE_MASK);
     if ( vio->mmio_access.write_access &&
          (vio->mmio_gla == (addr & PAGE_MASK)) &&
@@ -1866,11 +1980,6 @@ static int hvmemul_rep_stos(
         gpa = pfn_to_paddr(vio->mmio_gpfn) | (addr & ~PAGE_MASK);
     else
     {
-        uint32_t pfec = PFEC_page_present | PFEC_write_access;
-
-        if ( hvmemul_ctxt->seg_reg[x86_seg_ss].dpl == 3 )
-            pfec |= PFEC_user_mode;
-
         rc = hvmemul_linear_to_phys(addr, &gpa, bytes_per_rep, reps, pfec,
                                     hvmemul_ctxt);
         if ( rc != X86EMUL_OKAY )
@@ -1929,6 +2038,34 @@ static int hvmemul_rep_stos(
 
         rc = hvm_copy_to_guest_phys(gpa, buf, bytes, current);
 
+        /* See the corresponding comment in hvmemul_rep_movs(). */
+        if ( rc == HVMTRANS_okay && !df && buf != p_data )
+        {
+            unsigned long done = *reps;
+            const unsigned long buf_reps = bytes / bytes_per_rep;
+            unsigned int i;
+
+            for ( i = 0; done < orig_reps && i < 16; i++ )
+            {
+                unsigned long run;
+                paddr_t ngpa;
+
+                addr += bytes;
+                run = hvmemul_next_ram_run(addr, &ngpa, bytes_per_rep,
+                                           min(orig_reps - done, buf_reps),
+                                           pfec, hvmemul_ctxt);
+                if ( !run ||
+                     hvm_copy_to_guest_phys(ngpa, buf, run * bytes_per_rep,
+                                            current) != HVMTRANS_okay )
+                    break;
+
+                bytes = run * bytes_per_rep;
+                done += run;
+            }
+
+            *reps = done;
+        }
+
         if ( buf != p_data )
             xfree(buf);
 
@@ -2570,6 +2707,7 @@ void hvm_emulate_init_once(
     hvmemul_ctxt->ctxt.regs = regs;
     hvmemul_ctxt->ctxt.vendor = curr->domain->arch.cpuid->x86_vendor;
     hvmemul_ctxt->ctxt.force_writeback = true;
+    hvmemul_ctxt->ctxt.decode_cache = curr->arch.hvm.hvm_io.decode_cache;
 }
 
 void hvm_emulate_init_per_insn(
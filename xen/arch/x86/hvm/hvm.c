@@ -499,9 +499,9 @@ void hvm_migrate_pirqs(struct vcpu *v)
     if ( !iommu_enabled || !hvm_domain_irq(d)->dpci )
        return;
 
-    spin_lock(&d->event_lock);
+    write_lock(&d->event_lock);
     pt_pirq_iterate(d, migrate_pirq, v);
-    spin_unlock(&d->event_lock);
+    write_unlock(&d->event_lock);
 }
 
 static bool hvm_get_pending_event(struct vcpu *v, struct x86_event *info)
@@ -1520,6 +1520,9 @@ int hvm_vcpu_initialise(struct vcpu *v)
     if ( rc != 0 )
         goto fail4;
 
+    /* Optional; emulation merely doesn't cache decodes without it. */
+    v->arch.hvm.hvm_io.decode_cache = xzalloc(struct x86_decode_cache);
+
     vcpu_nestedhvm(v).nv_vvmcxaddr = INVALID_PADDR;
 
     if ( nestedhvm_enabled(d)
@@ -1567,6 +1570,8 @@ void hvm_vcpu_destroy(struct vcpu *v)
 
     nestedhvm_vcpu_destroy(v);
 
+    XFREE(v->arch.hvm.hvm_io.decode_cache);
+
     free_compat_arg_xlat(v);
 
     tasklet_kill(&v->arch.hvm.assert_evtchn_irq_tasklet);
@@ -1674,6 +1679,20 @@ void hvm_inject_event(const struct x86_event *event)
     hvm_funcs.inject_event(event);
 }
 
+/*
+ * Features which require the full chain of checks in
+ * hvm_hap_nested_page_fault(): introspection (vm_event), mem paging and
+ * mem sharing.  Derived from existing per-domain state so there are no
+ * separate enable/disable hooks to keep in sync; for a plain HVM domain
+ * this is a handful of loads from the domain structure.
+ */
+static bool hap_npf_needs_full_chain(const struct domain *d)
+{
+    return unlikely(d->vm_event_monitor != NULL) ||
+           unlikely(d->vm_event_paging != NULL) ||
+           unlikely(d->arch.hvm.mem_sharing_enabled);
+}
+
 int hvm_hap_nested_page_fault(paddr_t gpa, unsigned long gla,
                               struct npfec npfec)
 {
@@ -1747,6 +1766,28 @@ int hvm_hap_nested_page_fault(paddr_t gpa, unsigned long gla,
 
     ap2m_active = altp2m_active(currd);
 
+    /*
+     * Emulated MMIO faults at device-model rates, and the locked lookup
+     * below (which stays held across the emulation) makes heavy MMIO
+     * traffic contend with balloon and log-dirty driven p2m updates.  As
+     * with the internal-MMIO check above, classify the fault with an
+     * unlocked query, and hand clean p2m_mmio_dm hits straight to the
+     * device model.  The query is advisory, like other users of
+     * get_gfn_query_unlocked(): if the entry is changed concurrently, the
+     * outcome is the same as if the fault had been handled just before the
+     * change, and a stale classification resolves itself when the guest
+     * re-faults on the updated entry.
+     */
+    if ( !ap2m_active && !nestedhvm_vcpu_in_guestmode(curr) &&
+         mfn_eq(get_gfn_query_unlocked(currd, gfn, &p2mt), INVALID_MFN) &&
+         p2mt == p2m_mmio_dm )
+    {
+        if ( !handle_mmio_with_translation(gla, gpa >> PAGE_SHIFT, npfec) )
+            hvm_inject_hw_exception(TRAP_gp_fault, 0);
+        rc = 1;
+        goto out;
+    }
+
     /*
      * Take a lock on the host p2m speculatively, to avoid potential
      * locking order problems later and to handle unshare etc.
@@ -1756,8 +1797,32 @@ int hvm_hap_nested_page_fault(paddr_t gpa, unsigned long gla,
                               P2M_ALLOC | (npfec.write_access ? P2M_UNSHARE : 0),
                               NULL);
 
+    /*
+     * Fast path for ordinary RAM faults (PoD population and log-dirty
+     * write-protect) on domains with none of the machinery above active:
+     * with a full-permission entry of plain RAM type there is nothing for
+     * the access / MMIO / paging / sharing checks below to do.
+     */
+    if ( !ap2m_active && !hap_npf_needs_full_chain(currd) &&
+         p2ma == p2m_access_rwx &&
+         (p2mt == p2m_ram_rw || p2mt == p2m_ram_logdirty) )
+    {
+        perfc_incr(hap_npf_fast);
+        if ( npfec.write_access )
+        {
+            paging_mark_pfn_dirty(currd, _pfn(gfn));
+            /* Log dirty is always done with order 0. */
+            p2m_change_type_one(currd, gfn, p2m_ram_logdirty, p2m_ram_rw);
+        }
+        __put_gfn(hostp2m, gfn);
+        rc = 1;
+        goto out;
+    }
+
     if ( ap2m_active )
     {
+        perfc_incra(altp2m_npf_view, vcpu_altp2m(curr).p2midx);
+
         if ( p2m_altp2m_lazy_copy(curr, gpa, gla, npfec, &p2m) )
         {
             /* entry was lazily copied from host -- retry */
@@ -1824,6 +1889,7 @@ int hvm_hap_nested_page_fault(paddr_t gpa, unsigned long gla,
                 }
             }
 
+            perfc_incr(hap_npf_access);
             sync = p2m_mem_access_check(gpa, gla, npfec, &req_ptr);
 
             if ( !sync )
@@ -1845,6 +1911,7 @@ int hvm_hap_nested_page_fault(paddr_t gpa, unsigned long gla,
          (npfec.write_access &&
           (p2m_is_discard_write(p2mt) || (p2mt == p2m_ioreq_server))) )
     {
+        perfc_incr(hap_npf_mmio);
         if ( !handle_mmio_with_translation(gla, gpa >> PAGE_SHIFT, npfec) )
             hvm_inject_hw_exception(TRAP_gp_fault, 0);
         rc = 1;
@@ -1853,14 +1920,20 @@ int hvm_hap_nested_page_fault(paddr_t gpa, unsigned long gla,
 
     /* Check if the page has been paged out */
     if ( p2m_is_paged(p2mt) || (p2mt == p2m_ram_paging_out) )
+    {
+        perfc_incr(hap_npf_paged);
         paged = 1;
+    }
 
     /* Mem sharing: unshare the page and try again */
     if ( npfec.write_access && (p2mt == p2m_ram_shared) )
     {
         ASSERT(p2m_is_hostp2m(p2m));
-        sharing_enomem = 
+        perfc_incr(hap_npf_unshare);
+        sharing_enomem =
             (mem_sharing_unshare_page(currd, gfn, 0) < 0);
+        if ( !sharing_enomem )
+            mem_sharing_unshare_cluster(currd, gfn);
         rc = 1;
         goto out_put_gfn;
     }
@@ -1868,6 +1941,7 @@ int hvm_hap_nested_page_fault(paddr_t gpa, unsigned long gla,
     /* Spurious fault? PoD and log-dirty also take this path. */
     if ( p2m_is_ram(p2mt) )
     {
+        perfc_incr(hap_npf_ram);
         rc = 1;
         /*
          * Page log dirty is always done with order 0. If this mfn resides in
@@ -4031,6 +4105,70 @@ static int hvmop_flush_tlb_all(void)
     return hvm_flush_vcpu_tlb(always_flush, NULL) ? 0 : -ERESTART;
 }
 
+static bool flush_vcpu_in_mask(void *ctxt, struct vcpu *v)
+{
+    uint64_t vcpu_mask = *(uint64_t *)ctxt;
+
+    return v->vcpu_id >= 64 || (vcpu_mask & (1ul << v->vcpu_id));
+}
+
+static int hvmop_flush_tlb_vcpus(
+    XEN_GUEST_HANDLE_PARAM(xen_hvm_flush_tlb_vcpus_t) uop)
+{
+    static DEFINE_PER_CPU(cpumask_t, flush_ipi_cpumask);
+    cpumask_t *mask = &this_cpu(flush_ipi_cpumask);
+    struct domain *d = current->domain;
+    xen_hvm_flush_tlb_vcpus_t op;
+    struct vcpu *v;
+
+    if ( !is_hvm_domain(d) )
+        return -EINVAL;
+
+    if ( copy_from_guest(&op, uop, 1) )
+        return -EFAULT;
+
+    /*
+     * Without HAP the paging soft state needs refreshing as well, which
+     * requires the targets to be stopped; take the pausing path.
+     */
+    if ( !hap_enabled(d) )
+        return hvm_flush_vcpu_tlb(flush_vcpu_in_mask, &op.vcpu_mask)
+               ? 0 : -ERESTART;
+
+    /*
+     * Invalidate the targets' ASIDs/VPIDs first: any vCPU entering the
+     * guest from here on starts with a clean TLB.
+     */
+    for_each_vcpu ( d, v )
+        if ( flush_vcpu_in_mask(&op.vcpu_mask, v) )
+            hvm_asid_flush_vcpu(v);
+
+    smp_mb();
+
+    /*
+     * Only vCPUs already in guest context before the generation bump can
+     * still hold stale translations; kick those through a VM entry.
+     * Descheduled vCPUs pick the flush up for free when they next run.
+     */
+    cpumask_clear(mask);
+    for_each_vcpu ( d, v )
+    {
+        unsigned int cpu;
+
+        if ( v == current || !flush_vcpu_in_mask(&op.vcpu_mask, v) )
+            continue;
+
+        cpu = read_atomic(&v->dirty_cpu);
+        if ( is_vcpu_dirty_cpu(cpu) )
+            __cpumask_set_cpu(cpu, mask);
+    }
+
+    if ( !cpumask_empty(mask) )
+        smp_send_event_check_mask(mask);
+
+    return 0;
+}
+
 static int hvmop_set_evtchn_upcall_vector(
     XEN_GUEST_HANDLE_PARAM(xen_hvm_evtchn_upcall_vector_t) uop)
 {
@@ -4110,6 +4248,7 @@ static int hvm_allow_set_param(struct domain *d,
     case HVM_PARAM_NR_IOREQ_SERVER_PAGES:
     case HVM_PARAM_ALTP2M:
     case HVM_PARAM_MCA_CAP:
+    case HVM_PARAM_VGA_DIRTY_PFN:
         if ( value != 0 && a->value != value )
             rc = -EEXIST;
         break;
@@ -4297,6 +4436,10 @@ static int hvmop_set_param(
         d->arch.x87_fip_width = a.value;
         break;
 
+    case HVM_PARAM_VGA_DIRTY_PFN:
+        rc = stdvga_dirty_rect_set_gfn(d, a.value);
+        break;
+
     case HVM_PARAM_VM86_TSS:
         /* Hardware would silently truncate high bits. */
         if ( a.value != (uint32_t)a.value )
@@ -4948,6 +5091,11 @@ long do_hvm_op(unsigned long op, XEN_GUEST_HANDLE_PARAM(void) arg)
         rc = guest_handle_is_null(arg) ? hvmop_flush_tlb_all() : -EINVAL;
         break;
 
+    case HVMOP_flush_tlb_vcpus:
+        rc = hvmop_flush_tlb_vcpus(
+            guest_handle_cast(arg, xen_hvm_flush_tlb_vcpus_t));
+        break;
+
     case HVMOP_get_mem_type:
         rc = hvmop_get_mem_type(
             guest_handle_cast(arg, xen_hvm_get_mem_type_t));
@@ -19,6 +19,7 @@
  * Copyright (c) 2017 Citrix Systems Ltd.
  */
 #include <xen/lib.h>
+#include <xen/domperf.h>
 #include <xen/hypercall.h>
 #include <xen/nospec.h>
 
@@ -158,6 +159,7 @@ int hvm_hypercall(struct cpu_user_regs *regs)
     struct domain *currd = curr->domain;
     int mode = hvm_guest_x86_mode(curr);
     unsigned long eax = regs->eax;
+    s_time_t t0;
 
     switch ( mode )
     {
@@ -202,6 +204,7 @@ int hvm_hypercall(struct cpu_user_regs *regs)
     }
 
     curr->hcall_preempted = false;
+    t0 = NOW();
 
     if ( mode == 8 )
     {
@@ -296,6 +299,10 @@ int hvm_hypercall(struct cpu_user_regs *regs)
 
     HVM_DBG_LOG(DBG_LEVEL_HCALL, "hcall%lu -> %lx", eax, regs->rax);
 
+    /* Preempted hypercalls have each continuation accounted separately. */
+    hypercall_stats_account(currd, eax, t0);
+    domperf_incr(curr, hypercalls);
+
     if ( curr->hcall_preempted )
         return HVM_HCALL_preempted;
 
@@ -34,6 +34,8 @@
 
 #include <public/hvm/ioreq.h>
 
+static DEFINE_RCU_READ_LOCK(ioreq_server_rcu_lock);
+
 static void set_ioreq_server(struct domain *d, unsigned int id,
                              struct hvm_ioreq_server *s)
 {
@@ -43,6 +45,21 @@ static void set_ioreq_server(struct domain *d, unsigned int id,
     d->arch.hvm.ioreq_server.server[id] = s;
 }
 
+static void _hvm_free_ioreq_server(struct rcu_head *head)
+{
+    xfree(container_of(head, struct hvm_ioreq_server, rcu_head));
+}
+
+/*
+ * Servers are freed via RCU once unpublished from the server array, so
+ * readers iterating the array locklessly (is_ioreq_server_page(),
+ * hvm_select_ioreq_server()) can never dereference a stale pointer.
+ */
+static void hvm_free_ioreq_server(struct hvm_ioreq_server *s)
+{
+    call_rcu(&s->rcu_head, _hvm_free_ioreq_server);
+}
+
 #define GET_IOREQ_SERVER(d, id) \
     (d)->arch.hvm.ioreq_server.server[id]
 
@@ -434,7 +451,14 @@ bool is_ioreq_server_page(struct domain *d, const struct page_info *page)
     unsigned int id;
     bool found = false;
 
-    spin_lock_recursive(&d->arch.hvm.ioreq_server.lock);
+    /*
+     * No need for the server lock: servers are unpublished from the
+     * array before being freed via RCU, and their ioreq pages are only
+     * torn down once unpublished (or with the target domain paused).
+     * A page becoming (or ceasing to be) an ioreq page concurrently
+     * with the walk is racy even under the lock.
+     */
+    rcu_read_lock(&ioreq_server_rcu_lock);
 
     FOR_EACH_IOREQ_SERVER(d, id, s)
     {
@@ -445,7 +469,7 @@ bool is_ioreq_server_page(struct domain *d, const struct page_info *page)
         }
     }
 
-    spin_unlock_recursive(&d->arch.hvm.ioreq_server.lock);
+    rcu_read_unlock(&ioreq_server_rcu_lock);
 
     return found;
 }
@@ -653,7 +677,10 @@ static void hvm_ioreq_server_free_rangesets(struct hvm_ioreq_server *s)
     unsigned int i;
 
     for ( i = 0; i < NR_IO_RANGE_TYPES; i++ )
+    {
         rangeset_destroy(s->range[i]);
+        rangeset_destroy(s->posted_range[i]);
+    }
 }
 
 static int hvm_ioreq_server_alloc_rangesets(struct hvm_ioreq_server *s,
@@ -694,6 +721,17 @@ static int hvm_ioreq_server_alloc_rangesets(struct hvm_ioreq_server *s,
     return rc;
 }
 
+static void hvm_ioreq_config_changed(struct domain *d)
+{
+    /*
+     * Invalidate every vCPU's MRU selection cache. The counter is only
+     * bumped after the configuration change it covers, so a vCPU racing
+     * with an update can at worst tag a freshly computed resolution with
+     * the old generation, and will then simply re-do the lookup.
+     */
+    d->arch.hvm.ioreq_server.generation++;
+}
+
 static void hvm_ioreq_server_enable(struct hvm_ioreq_server *s)
 {
     struct hvm_ioreq_vcpu *sv;
@@ -707,6 +745,7 @@ static void hvm_ioreq_server_enable(struct hvm_ioreq_server *s)
     hvm_remove_ioreq_gfn(s, true);
 
     s->enabled = true;
+    hvm_ioreq_config_changed(s->target);
 
     list_for_each_entry ( sv,
                           &s->ioreq_vcpu_list,
@@ -728,6 +767,7 @@ static void hvm_ioreq_server_disable(struct hvm_ioreq_server *s)
     hvm_add_ioreq_gfn(s, false);
 
     s->enabled = false;
+    hvm_ioreq_config_changed(s->target);
 
  done:
     spin_unlock(&s->lock);
@@ -852,7 +892,7 @@ int hvm_create_ioreq_server(struct domain *d, int bufioreq_handling,
     spin_unlock_recursive(&d->arch.hvm.ioreq_server.lock);
     domain_unpause(d);
 
-    xfree(s);
+    hvm_free_ioreq_server(s);
     return rc;
 }
 
@@ -888,7 +928,7 @@ int hvm_destroy_ioreq_server(struct domain *d, ioservid_t id)
 
     domain_unpause(d);
 
-    xfree(s);
+    hvm_free_ioreq_server(s);
 
     rc = 0;
 
@@ -997,8 +1037,8 @@ int hvm_get_ioreq_server_frame(struct domain *d, ioservid_t id,
 }
 
 int hvm_map_io_range_to_ioreq_server(struct domain *d, ioservid_t id,
-                                     uint32_t type, uint64_t start,
-                                     uint64_t end)
+                                     uint32_t type, uint32_t flags,
+                                     uint64_t start, uint64_t end)
 {
     struct hvm_ioreq_server *s;
     struct rangeset *r;
@@ -1021,9 +1061,16 @@ int hvm_map_io_range_to_ioreq_server(struct domain *d, ioservid_t id,
 
     switch ( type )
     {
+    case XEN_DMOP_IO_RANGE_PCI:
+        /* PCI config writes need a response and hence can't be posted. */
+        if ( flags & XEN_DMOP_IO_RANGE_POSTED_WRITE )
+        {
+            rc = -EINVAL;
+            goto out;
+        }
+        /* fall through */
     case XEN_DMOP_IO_RANGE_PORT:
     case XEN_DMOP_IO_RANGE_MEMORY:
-    case XEN_DMOP_IO_RANGE_PCI:
         r = s->range[type];
         break;
 
@@ -1040,7 +1087,49 @@ int hvm_map_io_range_to_ioreq_server(struct domain *d, ioservid_t id,
     if ( rangeset_overlaps_range(r, start, end) )
         goto out;
 
+    if ( flags & XEN_DMOP_IO_RANGE_POSTED_WRITE )
+    {
+        /* Posted writes are delivered over the buffered ioreq ring. */
+        rc = -EOPNOTSUPP;
+        if ( !HANDLE_BUFIOREQ(s) )
+            goto out;
+
+        if ( !s->posted_range[type] )
+        {
+            char *name;
+
+            rc = asprintf(&name, "ioreq_server %d posted %s", id,
+                          (type == XEN_DMOP_IO_RANGE_PORT) ? "port" :
+                          "memory");
+            if ( rc )
+                goto out;
+
+            s->posted_range[type] = rangeset_new(s->target, name,
+                                                 RANGESETF_prettyprint_hex);
+
+            xfree(name);
+
+            rc = -ENOMEM;
+            if ( !s->posted_range[type] )
+                goto out;
+
+            rangeset_limit(s->posted_range[type], MAX_NR_IO_RANGES);
+        }
+
+        rc = rangeset_add_range(s->posted_range[type], start, end);
+        if ( rc )
+            goto out;
+    }
+
     rc = rangeset_add_range(r, start, end);
+    if ( rc && (flags & XEN_DMOP_IO_RANGE_POSTED_WRITE) &&
+         rangeset_remove_range(s->posted_range[type], start, end) )
+        gprintk(XENLOG_WARNING,
+                "stale posted range [%"PRIx64",%"PRIx64"] for server %d\n",
+                start, end, id);
+
+    if ( !rc )
+        hvm_ioreq_config_changed(d);
 
  out:
     spin_unlock_recursive(&d->arch.hvm.ioreq_server.lock);
@@ -1092,7 +1181,18 @@ int hvm_unmap_io_range_from_ioreq_server(struct domain *d, ioservid_t id,
     if ( !rangeset_contains_range(r, start, end) )
         goto out;
 
-    rc = rangeset_remove_range(r, start, end);
+    /*
+     * Shrink the posted subset first: should this fail, the range stays
+     * fully mapped rather than losing only its posted property.
+     */
+    rc = s->posted_range[type]
+         ? rangeset_remove_range(s->posted_range[type], start, end)
+         : 0;
+    if ( !rc )
+        rc = rangeset_remove_range(r, start, end);
+
+    if ( !rc )
+        hvm_ioreq_config_changed(d);
 
  out:
     spin_unlock_recursive(&d->arch.hvm.ioreq_server.lock);
@@ -1250,7 +1350,7 @@ void hvm_destroy_all_ioreq_servers(struct domain *d)
         hvm_ioreq_server_deinit(s);
         set_ioreq_server(d, id, NULL);
 
-        xfree(s);
+        hvm_free_ioreq_server(s);
     }
 
     spin_unlock_recursive(&d->arch.hvm.ioreq_server.lock);
@@ -1259,11 +1359,15 @@ void hvm_destroy_all_ioreq_servers(struct domain *d)
 struct hvm_ioreq_server *hvm_select_ioreq_server(struct domain *d,
                                                  ioreq_t *p)
 {
-    struct hvm_ioreq_server *s;
+    struct vcpu *curr = current;
+    struct hvm_ioreq_select_cache *cache = NULL;
+    struct hvm_ioreq_server *s, *found = NULL;
+    uint64_t generation = 0;
     uint32_t cf8;
     uint8_t type;
     uint64_t addr;
     unsigned int id;
+    unsigned long start, end;
 
     if ( p->type != IOREQ_TYPE_COPY && p->type != IOREQ_TYPE_PIO )
         return NULL;
@@ -1304,6 +1408,49 @@ struct hvm_ioreq_server *hvm_select_ioreq_server(struct domain *d,
         addr = p->addr;
     }
 
+    switch ( type )
+    {
+    case XEN_DMOP_IO_RANGE_PORT:
+        start = addr;
+        end = start + p->size - 1;
+        break;
+
+    case XEN_DMOP_IO_RANGE_MEMORY:
+        start = hvm_mmio_first_byte(p);
+        end = hvm_mmio_last_byte(p);
+        break;
+
+    case XEN_DMOP_IO_RANGE_PCI:
+        start = end = addr >> 32;
+        break;
+
+    default:
+        ASSERT_UNREACHABLE();
+        return NULL;
+    }
+
+    if ( curr->domain == d )
+    {
+        cache = &curr->arch.hvm.hvm_io.select_cache;
+
+        /*
+         * The generation must be sampled before the rangesets are
+         * consulted: a result tagged with a stale generation merely fails
+         * validation on the next lookup, whereas consulting stale
+         * rangesets after sampling a new generation would cache a wrong
+         * resolution indefinitely.
+         */
+        generation = ACCESS_ONCE(d->arch.hvm.ioreq_server.generation);
+
+        if ( cache->valid && cache->generation == generation &&
+             cache->type == type && cache->start == start &&
+             cache->end == end )
+        {
+            found = cache->server;
+            goto done;
+        }
+    }
+
     FOR_EACH_IOREQ_SERVER(d, id, s)
     {
         struct rangeset *r;
@@ -1313,40 +1460,68 @@ struct hvm_ioreq_server *hvm_select_ioreq_server(struct domain *d,
 
         r = s->range[type];
 
-        switch ( type )
+        if ( type == XEN_DMOP_IO_RANGE_PCI
+             ? rangeset_contains_singleton(r, start)
+             : rangeset_contains_range(r, start, end) )
         {
-            unsigned long start, end;
+            found = s;
+            break;
+        }
+    }
 
-        case XEN_DMOP_IO_RANGE_PORT:
-            start = addr;
-            end = start + p->size - 1;
-            if ( rangeset_contains_range(r, start, end) )
-                return s;
+    if ( cache )
+    {
+        cache->generation = generation;
+        cache->type = type;
+        cache->start = start;
+        cache->end = end;
+        cache->server = found;
+        cache->valid = true;
+    }
 
-            break;
+ done:
+    if ( found && type == XEN_DMOP_IO_RANGE_PCI )
+    {
+        p->type = IOREQ_TYPE_PCI_CONFIG;
+        p->addr = addr;
+    }
 
-        case XEN_DMOP_IO_RANGE_MEMORY:
-            start = hvm_mmio_first_byte(p);
-            end = hvm_mmio_last_byte(p);
+    return found;
+}
 
-            if ( rangeset_contains_range(r, start, end) )
-                return s;
+bool hvm_ioreq_posted_write(struct hvm_ioreq_server *s, const ioreq_t *p)
+{
+    struct rangeset *r;
+    unsigned long start, end;
 
-            break;
+    /*
+     * Only writes which hvm_send_buffered_ioreq() is known to accept may
+     * be posted; anything else must wait for the device model's response.
+     */
+    if ( p->dir != IOREQ_WRITE || p->data_is_ptr || p->count != 1 ||
+         (p->size != 1 && p->size != 2 && p->size != 4 && p->size != 8) ||
+         (p->addr >> 20) > ~0u )
+        return false;
 
-        case XEN_DMOP_IO_RANGE_PCI:
-            if ( rangeset_contains_singleton(r, addr >> 32) )
-            {
-                p->type = IOREQ_TYPE_PCI_CONFIG;
-                p->addr = addr;
-                return s;
-            }
+    switch ( p->type )
+    {
+    case IOREQ_TYPE_PIO:
+        r = s->posted_range[XEN_DMOP_IO_RANGE_PORT];
+        start = p->addr;
+        end = start + p->size - 1;
+        break;
 
-            break;
-        }
+    case IOREQ_TYPE_COPY:
+        r = s->posted_range[XEN_DMOP_IO_RANGE_MEMORY];
+        start = hvm_mmio_first_byte(p);
+        end = hvm_mmio_last_byte(p);
+        break;
+
+    default:
+        return false;
     }
 
-    return NULL;
+    return r && rangeset_contains_range(r, start, end);
 }
 
 static int hvm_send_buffered_ioreq(struct hvm_ioreq_server *s, ioreq_t *p)
@@ -1357,9 +1532,11 @@ static int hvm_send_buffered_ioreq(struct hvm_ioreq_server *s, ioreq_t *p)
     buf_ioreq_t bp = { .data = p->data,
                        .addr = p->addr,
                        .type = p->type,
-                       .dir = p->dir };
+                       .dir = p->dir,
+                       .addr_ext = p->addr > 0xffffful };
     /* Timeoffset sends 64b data, but no address. Use two consecutive slots. */
     int qw = 0;
+    unsigned int slots;
 
     /* Ensure buffered_iopage fits in a page */
     BUILD_BUG_ON(sizeof(buffered_iopage_t) > PAGE_SIZE);
@@ -1372,13 +1549,14 @@ static int hvm_send_buffered_ioreq(struct hvm_ioreq_server *s, ioreq_t *p)
 
     /*
      * Return 0 for the cases we can't deal with:
-     *  - 'addr' is only a 20-bit field, so we cannot address beyond 1MB
+     *  - even with the addr_ext extension slot only address bits [51:0]
+     *    can be expressed
      *  - we cannot buffer accesses to guest memory buffers, as the guest
      *    may expect the memory buffer to be synchronously accessed
      *  - the count field is usually used with data_is_ptr and since we don't
      *    support data_is_ptr we do not waste space for the count field either
      */
-    if ( (p->addr > 0xffffful) || p->data_is_ptr || (p->count != 1) )
+    if ( (p->addr >> 20) > ~0u || p->data_is_ptr || (p->count != 1) )
         return 0;
 
     switch ( p->size )
@@ -1403,8 +1581,8 @@ static int hvm_send_buffered_ioreq(struct hvm_ioreq_server *s, ioreq_t *p)
 
     spin_lock(&s->bufioreq_lock);
 
-    if ( (pg->ptrs.write_pointer - pg->ptrs.read_pointer) >=
-         (IOREQ_BUFFER_SLOT_NUM - qw) )
+    if ( (pg->ptrs.write_pointer - pg->ptrs.read_pointer) >
+         (IOREQ_BUFFER_SLOT_NUM - 1 - qw - bp.addr_ext) )
     {
         /* The queue is full: send the iopacket through the normal path. */
         spin_unlock(&s->bufioreq_lock);
@@ -1412,16 +1590,26 @@ static int hvm_send_buffered_ioreq(struct hvm_ioreq_server *s, ioreq_t *p)
     }
 
     pg->buf_ioreq[pg->ptrs.write_pointer % IOREQ_BUFFER_SLOT_NUM] = bp;
+    slots = 1;
+
+    if ( bp.addr_ext )
+    {
+        /* The extension slot carries address bits [51:20] in its data. */
+        bp.data = p->addr >> 20;
+        pg->buf_ioreq[(pg->ptrs.write_pointer + slots++) %
+                      IOREQ_BUFFER_SLOT_NUM] = bp;
+    }
 
     if ( qw )
     {
         bp.data = p->data >> 32;
-        pg->buf_ioreq[(pg->ptrs.write_pointer+1) % IOREQ_BUFFER_SLOT_NUM] = bp;
+        pg->buf_ioreq[(pg->ptrs.write_pointer + slots++) %
+                      IOREQ_BUFFER_SLOT_NUM] = bp;
     }
 
     /* Make the ioreq_t visible /before/ write_pointer. */
     smp_wmb();
-    pg->ptrs.write_pointer += qw ? 2 : 1;
+    pg->ptrs.write_pointer += slots;
 
     /* Canonicalize read/write pointers to prevent their overflow. */
     while ( (s->bufioreq_handling == HVM_IOREQSRV_BUFIOREQ_ATOMIC) &&
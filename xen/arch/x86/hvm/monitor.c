@@ -53,6 +53,14 @@ bool hvm_monitor_cr(unsigned int index, unsigned long value, unsigned long old)
             .u.write_ctrlreg.old_value = old
         };
 
+        if ( monitored_value_allowed(curr->domain,
+                                     XEN_DOMCTL_MONITOR_EVENT_WRITE_CTRLREG,
+                                     index, value) )
+        {
+            perfc_incr(monitor_value_filtered);
+            return 0;
+        }
+
         if ( monitor_traps(curr, sync, &req) >= 0 )
             return 1;
     }
@@ -92,6 +100,14 @@ void hvm_monitor_msr(unsigned int msr, uint64_t new_value, uint64_t old_value)
             .u.mov_to_msr.old_value = old_value
         };
 
+        if ( monitored_value_allowed(curr->domain,
+                                     XEN_DOMCTL_MONITOR_EVENT_MOV_TO_MSR,
+                                     msr, new_value) )
+        {
+            perfc_incr(monitor_value_filtered);
+            return;
+        }
+
         monitor_traps(curr, 1, &req);
     }
 }
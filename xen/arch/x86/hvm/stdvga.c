@@ -132,6 +132,41 @@ static bool_t stdvga_cache_is_enabled(const struct hvm_hw_stdvga *s)
     return s->cache == STDVGA_CACHE_ENABLED;
 }
 
+/*
+ * Extend the shared dirty rectangle (if the device model registered one
+ * via HVM_PARAM_VGA_DIRTY_PFN) to cover a buffered VRAM write.  Called
+ * with s->lock held, so updates are serialised; the device model reads
+ * the page concurrently following the protocol described in
+ * public/hvm/ioreq.h.
+ */
+static void stdvga_dirty_rect_update(struct hvm_hw_stdvga *s,
+                                     uint64_t addr, unsigned int size)
+{
+    struct vga_dirty_rect *dr = s->dirty;
+    uint32_t first = addr - VGA_MEM_BASE;
+    uint32_t last = first + size - 1;
+
+    if ( !dr )
+        return;
+
+    if ( read_atomic(&dr->ack) == dr->wseq )
+    {
+        /* Previous box was consumed by the device model: start afresh. */
+        dr->first = first;
+        dr->last = last;
+    }
+    else
+    {
+        if ( first < dr->first )
+            dr->first = first;
+        if ( last > dr->last )
+            dr->last = last;
+    }
+
+    smp_wmb();
+    dr->wseq++;
+}
+
 static int stdvga_outb(uint64_t addr, uint8_t val)
 {
     struct hvm_hw_stdvga *s = &current->domain->arch.hvm.stdvga;
@@ -506,6 +541,8 @@ static int stdvga_mem_write(const struct hvm_io_handler *handler,
         break;
     }
 
+    stdvga_dirty_rect_update(s, addr, size);
+
  done:
     srv = hvm_select_ioreq_server(current->domain, &p);
     if ( !srv )
@@ -613,6 +650,41 @@ void stdvga_init(struct domain *d)
     }
 }
 
+int stdvga_dirty_rect_set_gfn(struct domain *d, unsigned long gfn)
+{
+    struct hvm_hw_stdvga *s = &d->arch.hvm.stdvga;
+    struct page_info *page;
+    void *va;
+    int rc;
+
+    if ( !has_vvga(d) )
+        return -ENODEV;
+
+    if ( s->dirty )
+        return -EEXIST;
+
+    rc = prepare_ring_for_helper(d, gfn, &page, &va);
+    if ( rc )
+        return rc;
+
+    clear_page(va);
+
+    spin_lock(&s->lock);
+    if ( s->dirty )
+        rc = -EEXIST;
+    else
+    {
+        s->dirty_page = page;
+        s->dirty = va;
+    }
+    spin_unlock(&s->lock);
+
+    if ( rc )
+        destroy_ring_for_helper(&va, page);
+
+    return rc;
+}
+
 void stdvga_deinit(struct domain *d)
 {
     struct hvm_hw_stdvga *s = &d->arch.hvm.stdvga;
@@ -628,6 +700,12 @@ void stdvga_deinit(struct domain *d)
         free_domheap_page(s->vram_page[i]);
         s->vram_page[i] = NULL;
     }
+
+    if ( s->dirty )
+    {
+        destroy_ring_for_helper((void **)&s->dirty, s->dirty_page);
+        s->dirty_page = NULL;
+    }
 }
 
 /*
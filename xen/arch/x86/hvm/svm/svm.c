@@ -17,6 +17,7 @@
  */
 
 #include <xen/init.h>
+#include <xen/domperf.h>
 #include <xen/lib.h>
 #include <xen/trace.h>
 #include <xen/sched.h>
@@ -1128,7 +1129,7 @@ void svm_vmenter_helper(const struct cpu_user_regs *regs)
 
     svm_asid_handle_vmrun();
 
-    if ( unlikely(tb_init_done) )
+    if ( tracing_active() )
         HVMTRACE_ND(VMENTRY,
                     nestedhvm_vcpu_in_guestmode(curr) ? TRC_HVM_NESTEDFLAG : 0,
                     1/*cycles*/, 0, 0, 0, 0, 0, 0, 0);
@@ -1787,7 +1788,7 @@ static void svm_do_nested_pgfault(struct vcpu *v,
 
     ret = hvm_hap_nested_page_fault(gpa, ~0ul, npfec);
 
-    if ( tb_init_done )
+    if ( tracing_active() )
     {
         struct {
             uint64_t gpa;
@@ -2712,6 +2713,7 @@ void svm_vmexit_handler(struct cpu_user_regs *regs)
     }
 
     perfc_incra(svmexits, exit_reason);
+    domperf_incr(v, vmexits);
 
     hvm_maybe_deassert_evtchn_irq();
 
@@ -92,9 +92,15 @@ static void update_reference_tsc(struct domain *d, bool initialize)
      * ReferenceTime = ((RDTSC() * TscScale) >> 64) + TscOffset
      *
      * Windows uses a 100ns tick, so we need a scale which is cpu
-     * ticks per 100ns shifted left by 64.
+     * ticks per 100ns shifted left by 64.  The guest TSC frequency
+     * cannot change while the domain runs, so the value is computed
+     * once and cached.
      */
-    p->TscScale = ((10000ul << 32) / d->arch.tsc_khz) << 32;
+    if ( !d->arch.hvm.viridian.reference_tsc_scale )
+        d->arch.hvm.viridian.reference_tsc_scale =
+            ((10000ul << 32) / d->arch.tsc_khz) << 32;
+
+    p->TscScale = d->arch.hvm.viridian.reference_tsc_scale;
 
     p->TscSequence++;
     if ( p->TscSequence == 0xFFFFFFFF ||
@@ -150,6 +156,17 @@ int viridian_time_wrmsr(struct vcpu *v, uint32_t idx, uint64_t val)
         if ( !(viridian_feature_mask(d) & HVMPV_reference_tsc) )
             return X86EMUL_EXCEPTION;
 
+        /*
+         * Windows re-writes this MSR with an unchanged value on events
+         * such as resume from hibernation or soft reboot. The page
+         * content is still valid in that case, so avoid tearing the
+         * mapping down, re-initializing the page and needlessly bumping
+         * TscSequence.
+         */
+        if ( val == d->arch.hvm.viridian.reference_tsc.raw &&
+             d->arch.hvm.viridian.reference_tsc.fields.enabled )
+            break;
+
         d->arch.hvm.viridian.reference_tsc.raw = val;
         dump_reference_tsc(d);
         if ( d->arch.hvm.viridian.reference_tsc.fields.enabled )
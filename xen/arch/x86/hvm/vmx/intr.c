@@ -74,7 +74,7 @@ static void vmx_enable_intr_window(struct vcpu *v, struct hvm_intack intack)
 
     ASSERT(intack.source != hvm_intsrc_none);
 
-    if ( unlikely(tb_init_done) )
+    if ( tracing_active() )
     {
         unsigned long intr;
 
@@ -16,6 +16,7 @@
  */
 
 #include <xen/init.h>
+#include <xen/domperf.h>
 #include <xen/lib.h>
 #include <xen/trace.h>
 #include <xen/sched.h>
@@ -149,11 +150,34 @@ static void vmx_pi_switch_to(struct vcpu *v)
 {
     struct pi_desc *pi_desc = &v->arch.hvm.vmx.pi_desc;
     unsigned int dest = cpu_physical_id(v->processor);
+    uint32_t ndst = x2apic_enabled ? dest
+                                   : MASK_INSR(dest, PI_xAPIC_NDST_MASK);
+    uint64_t old, new, prev;
 
-    write_atomic(&pi_desc->ndst,
-                 x2apic_enabled ? dest : MASK_INSR(dest, PI_xAPIC_NDST_MASK));
+    /*
+     * NDST only goes stale when the vCPU moves to a different pCPU; in
+     * the common case of resuming where we left off, clearing SN is all
+     * that is needed.
+     */
+    if ( pi_desc->ndst == ndst )
+    {
+        perfc_incr(pi_ndst_suppressed);
+        pi_clear_sn(pi_desc);
+        return;
+    }
 
-    pi_clear_sn(pi_desc);
+    /*
+     * NDST and SN share the descriptor's control word, so the rewrite and
+     * the SN clear can be folded into a single atomic update.  ON may be
+     * set by the IOMMU at any time, hence the cmpxchg loop.
+     */
+    prev = read_atomic(&pi_desc->control);
+    do {
+        old = prev;
+        new = (old & ~(((uint64_t)UINT32_MAX << 32) |
+                       (1ull << POSTED_INTR_SN))) | ((uint64_t)ndst << 32);
+        prev = cmpxchg(&pi_desc->control, old, new);
+    } while ( prev != old );
 }
 
 static void vmx_pi_unblock_vcpu(struct vcpu *v)
@@ -2367,6 +2391,7 @@ static void pi_wakeup_interrupt(struct cpu_user_regs *regs)
 
     ack_APIC_irq();
     this_cpu(irq_count)++;
+    perfc_incr(pi_wakeup_intr);
 
     spin_lock(lock);
 
@@ -2394,6 +2419,7 @@ static void pi_notification_interrupt(struct cpu_user_regs *regs)
 {
     ack_APIC_irq();
     this_cpu(irq_count)++;
+    perfc_incr(pi_notify_in_root);
 
     /*
      * We get here when a vCPU is running in root-mode (such as via hypercall,
@@ -3316,7 +3342,7 @@ static void ept_handle_violation(ept_qual_t q, paddr_t gpa)
         .present = q.eff_read || q.eff_write || q.eff_exec,
     };
 
-    if ( tb_init_done )
+    if ( tracing_active() )
     {
         struct {
             uint64_t gpa;
@@ -3622,6 +3648,7 @@ void vmx_vmexit_handler(struct cpu_user_regs *regs)
                     regs->eip, 0, 0, 0, 0);
 
     perfc_incra(vmexits, exit_reason);
+    domperf_incr(v, vmexits);
 
     /* Handle the interrupt we missed before allowing any more in. */
     switch ( (uint16_t)exit_reason )
@@ -3651,6 +3678,43 @@ void vmx_vmexit_handler(struct cpu_user_regs *regs)
     /* Now enable interrupts so it's safe to take locks. */
     local_irq_enable();
 
+    /*
+     * Fast-path tier for the hottest simple exits: x2APIC ICR and TSC
+     * deadline MSR writes need nothing beyond the GPRs synchronised above,
+     * so dispatch them ahead of the altp2m / nested / real mode processing
+     * below.  WRMSR exits cannot occur during event delivery, but the IDT
+     * vectoring info is re-injected all the same to stay on the safe side.
+     */
+    if ( exit_reason == EXIT_REASON_MSR_WRITE &&
+         likely(!v->arch.hvm.vmx.vmx_realmode) &&
+         !altp2m_active(currd) && !nestedhvm_enabled(currd) )
+    {
+        uint32_t msr = regs->ecx;
+
+        if ( msr == MSR_X2APIC_ICR || msr == MSR_IA32_TSC_DEADLINE )
+        {
+            perfc_incr(vmexit_fastpathed);
+
+            hvm_maybe_deassert_evtchn_irq();
+
+            __vmread(IDT_VECTORING_INFO, &idtv_info);
+            vmx_idtv_reinject(idtv_info);
+
+            switch ( hvm_msr_write_intercept(msr, msr_fold(regs), true) )
+            {
+            case X86EMUL_OKAY:
+                update_guest_eip(); /* Safe: WRMSR */
+                break;
+
+            case X86EMUL_EXCEPTION:
+                hvm_inject_hw_exception(TRAP_gp_fault, 0);
+                break;
+            }
+
+            goto out;
+        }
+    }
+
     /*
      * If the guest has the ability to switch EPTP without an exit,
      * figure out whether it has done so and update the altp2m data.
@@ -3683,6 +3747,7 @@ void vmx_vmexit_handler(struct cpu_user_regs *regs)
         if ( idx != vcpu_altp2m(v).p2midx )
         {
             BUG_ON(idx >= MAX_ALTP2M);
+            perfc_incra(altp2m_switch_view, idx);
             atomic_dec(&p2m_get_altp2m(v)->active_vcpus);
             vcpu_altp2m(v).p2midx = idx;
             atomic_inc(&p2m_get_altp2m(v)->active_vcpus);
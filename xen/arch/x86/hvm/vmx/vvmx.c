@@ -113,6 +113,7 @@ int nvmx_vcpu_initialise(struct vcpu *v)
 
     nvmx->ept.enabled = 0;
     nvmx->guest_vpid = 0;
+    nvmx->vvmcs_dirty = ~0ULL;
     nvmx->vmxon_region_pa = INVALID_PADDR;
     nvcpu->nv_vvmcx = NULL;
     nvcpu->nv_vvmcxaddr = INVALID_PADDR;
@@ -776,6 +777,8 @@ static void nvmx_purge_vvmcs(struct vcpu *v)
     nvcpu->nv_vvmcx = NULL;
     nvcpu->nv_vvmcxaddr = INVALID_PADDR;
     v->arch.hvm.vmx.vmcs_shadow_maddr = 0;
+    /* A subsequently loaded vvmcs needs a full synchronisation. */
+    vcpu_2_nvmx(v).vvmcs_dirty = ~0ULL;
 
     for ( i = 0; i < 2; i++ )
         unmap_io_bitmap(v, i);
@@ -904,6 +907,27 @@ static struct vmcs_host_to_guest {
     {HOST_SYSENTER_EIP, GUEST_SYSENTER_EIP},
 };
 
+void nvmx_set_vvmcs_dirty(struct vcpu *v, u32 encoding)
+{
+    unsigned int i;
+
+    /*
+     * With VMCS shadowing L1 accesses the vvmcs without trapping, so
+     * dirty state can't be tracked and all fields get copied regardless.
+     */
+    if ( cpu_has_vmx_vmcs_shadowing )
+        return;
+
+    BUILD_BUG_ON(ARRAY_SIZE(vmcs_gstate_field) > 64);
+
+    for ( i = 0; i < ARRAY_SIZE(vmcs_gstate_field); i++ )
+        if ( vmcs_gstate_field[i] == encoding )
+        {
+            vcpu_2_nvmx(v).vvmcs_dirty |= 1ULL << i;
+            break;
+        }
+}
+
 static void vvmcs_to_shadow(const struct vcpu *v, unsigned int field)
 {
     __vmwrite(field, get_vvmcs(v, field));
@@ -941,7 +965,7 @@ fallback:
         vvmcs_to_shadow(v, field[i]);
 }
 
-static inline void shadow_to_vvmcs(const struct vcpu *v, unsigned int field)
+static inline void shadow_to_vvmcs(struct vcpu *v, unsigned int field)
 {
     unsigned long value;
 
@@ -1003,6 +1027,7 @@ static void load_shadow_control(struct vcpu *v)
 static void load_shadow_guest_state(struct vcpu *v)
 {
     struct nestedvcpu *nvcpu = &vcpu_nestedhvm(v);
+    struct nestedvmx *nvmx = &vcpu_2_nvmx(v);
     u32 control;
     u64 cr_gh_mask, cr_read_shadow;
     int rc;
@@ -1013,9 +1038,25 @@ static void load_shadow_guest_state(struct vcpu *v)
         VM_ENTRY_INSTRUCTION_LEN,
     };
 
-    /* vvmcs.gstate to shadow vmcs.gstate */
-    vvmcs_to_shadow_bulk(v, ARRAY_SIZE(vmcs_gstate_field),
-                         vmcs_gstate_field);
+    /*
+     * vvmcs.gstate to shadow vmcs.gstate.  Without VMCS shadowing all
+     * vvmcs updates since the last synchronisation were intercepted, so
+     * only fields marked dirty need copying; the shadow vmcs still holds
+     * the values synchronised back at the last virtual vmexit for the
+     * rest.
+     */
+    if ( cpu_has_vmx_vmcs_shadowing )
+        vvmcs_to_shadow_bulk(v, ARRAY_SIZE(vmcs_gstate_field),
+                             vmcs_gstate_field);
+    else
+    {
+        unsigned int i;
+
+        for ( i = 0; i < ARRAY_SIZE(vmcs_gstate_field); i++ )
+            if ( nvmx->vvmcs_dirty & (1ULL << i) )
+                vvmcs_to_shadow(v, vmcs_gstate_field[i]);
+        nvmx->vvmcs_dirty = 0;
+    }
 
     nvcpu->guest_cr[0] = get_vvmcs(v, CR0_READ_SHADOW);
     nvcpu->guest_cr[4] = get_vvmcs(v, CR4_READ_SHADOW);
@@ -1195,6 +1236,8 @@ static void sync_vvmcs_guest_state(struct vcpu *v, struct cpu_user_regs *regs)
     /* copy shadow vmcs.gstate back to vvmcs.gstate */
     shadow_to_vvmcs_bulk(v, ARRAY_SIZE(vmcs_gstate_field),
                          vmcs_gstate_field);
+    /* All synchronised fields match the shadow vmcs again. */
+    vcpu_2_nvmx(v).vvmcs_dirty = 0;
     /* RIP, RSP are in user regs */
     set_vvmcs(v, GUEST_RIP, regs->rip);
     set_vvmcs(v, GUEST_RSP, regs->rsp);
@@ -17,6 +17,7 @@
  */
 
 #include <xen/time.h>
+#include <xen/perfc.h>
 #include <asm/hvm/support.h>
 #include <asm/hvm/vpt.h>
 #include <asm/event.h>
@@ -171,6 +172,33 @@ static void pt_unlock(struct periodic_time *pt)
     spin_unlock(&pt->vcpu->arch.hvm.tm_lock);
 }
 
+/*
+ * The tm_list length is mirrored in hvm.nr_pts so the context-switch and
+ * interrupt-injection paths, which run on every vmentry/vmexit, can see
+ * without taking tm_lock whether any timers are active at all.  Writers
+ * hold tm_lock; a lock-free reader racing with an update merely takes the
+ * slow path, or skips work which the timer's vcpu_kick() will redo.
+ */
+static void pt_list_add(struct periodic_time *pt, struct vcpu *v)
+{
+    ASSERT(spin_is_locked(&v->arch.hvm.tm_lock));
+
+    pt->on_list = 1;
+    list_add(&pt->list, &v->arch.hvm.tm_list);
+    v->arch.hvm.nr_pts++;
+}
+
+static void pt_list_del(struct periodic_time *pt)
+{
+    struct vcpu *v = pt->vcpu;
+
+    ASSERT(spin_is_locked(&v->arch.hvm.tm_lock));
+
+    list_del(&pt->list);
+    pt->on_list = 0;
+    v->arch.hvm.nr_pts--;
+}
+
 static void pt_process_missed_ticks(struct periodic_time *pt)
 {
     s_time_t missed_ticks, now = NOW();
@@ -218,8 +246,23 @@ void pt_save_timer(struct vcpu *v)
     if ( v->pause_flags & VPF_blocked )
         return;
 
+    if ( !v->arch.hvm.nr_pts )
+    {
+        /*
+         * No active timers: nothing to stop.  A timer activated after this
+         * check simply isn't stopped, which is harmless - it fires while
+         * the vCPU is descheduled and kicks it awake.  pt_freeze_time()
+         * only touches state private to this vCPU's context-switch path.
+         */
+        perfc_incr(vpt_save_skip);
+        pt_freeze_time(v);
+        return;
+    }
+
     spin_lock(&v->arch.hvm.tm_lock);
 
+    perfc_incr(vpt_save);
+
     list_for_each_entry ( pt, head, list )
         if ( !pt->do_not_freeze )
             stop_timer(&pt->timer);
@@ -234,8 +277,23 @@ void pt_restore_timer(struct vcpu *v)
     struct list_head *head = &v->arch.hvm.tm_list;
     struct periodic_time *pt;
 
+    if ( !v->arch.hvm.nr_pts )
+    {
+        /*
+         * Timers added while the list looked empty were armed by their
+         * creator (or already have a pending interrupt), so there is
+         * nothing to re-arm here.
+         */
+        perfc_incr(vpt_restore_skip);
+        pt_thaw_time(v);
+        return;
+    }
+
     spin_lock(&v->arch.hvm.tm_lock);
 
+    perfc_incr(vpt_restore);
+    perfc_incra(vpt_list_len, min(v->arch.hvm.nr_pts, 7u));
+
     list_for_each_entry ( pt, head, list )
     {
         if ( pt->pending_intr_nr == 0 )
@@ -272,8 +330,7 @@ static void pt_irq_fired(struct vcpu *v, struct periodic_time *pt)
     if ( pt->one_shot )
     {
         if ( pt->on_list )
-            list_del(&pt->list);
-        pt->on_list = false;
+            pt_list_del(pt);
         pt->pending_intr_nr = 0;
     }
     else if ( mode_is(v->domain, one_missed_tick_pending) ||
@@ -308,6 +365,13 @@ int pt_update_irq(struct vcpu *v)
     int irq, pt_vector = -1;
     bool level;
 
+    /*
+     * No active timers, nothing to inject.  A timer firing concurrently
+     * kicks the vCPU, forcing interrupts to be re-evaluated.
+     */
+    if ( !v->arch.hvm.nr_pts )
+        return -1;
+
     spin_lock(&v->arch.hvm.tm_lock);
 
     earliest_pt = NULL;
@@ -322,8 +386,7 @@ int pt_update_irq(struct vcpu *v)
                  !pt->level )
             {
                 /* suspend timer emulation */
-                list_del(&pt->list);
-                pt->on_list = 0;
+                pt_list_del(pt);
             }
             else
             {
@@ -440,6 +503,10 @@ void pt_intr_post(struct vcpu *v, struct hvm_intack intack)
     if ( intack.source == hvm_intsrc_vector )
         return;
 
+    /* is_pt_irq() can only match a timer which is on the list. */
+    if ( !v->arch.hvm.nr_pts )
+        return;
+
     spin_lock(&v->arch.hvm.tm_lock);
 
     pt = is_pt_irq(v, intack);
@@ -533,8 +600,7 @@ void create_periodic_time(
     pt->cb = cb;
     pt->priv = data;
 
-    pt->on_list = 1;
-    list_add(&pt->list, &v->arch.hvm.tm_list);
+    pt_list_add(pt, v);
 
     init_timer(&pt->timer, pt_timer_fn, pt, v->processor);
     set_timer(&pt->timer, pt->scheduled);
@@ -550,8 +616,7 @@ void destroy_periodic_time(struct periodic_time *pt)
 
     pt_lock(pt);
     if ( pt->on_list )
-        list_del(&pt->list);
-    pt->on_list = 0;
+        pt_list_del(pt);
     pt->pending_intr_nr = 0;
     pt_unlock(pt);
 
@@ -573,17 +638,15 @@ static void pt_adjust_vcpu(struct periodic_time *pt, struct vcpu *v)
 
     pt_lock(pt);
     on_list = pt->on_list;
-    if ( pt->on_list )
-        list_del(&pt->list);
-    pt->on_list = 0;
+    if ( on_list )
+        pt_list_del(pt);
     pt_unlock(pt);
 
     spin_lock(&v->arch.hvm.tm_lock);
     pt->vcpu = v;
     if ( on_list )
     {
-        pt->on_list = 1;
-        list_add(&pt->list, &v->arch.hvm.tm_list);
+        pt_list_add(pt, v);
 
         migrate_timer(&pt->timer, v->processor);
     }
@@ -626,8 +689,7 @@ static void pt_resume(struct periodic_time *pt)
     pt_lock(pt);
     if ( pt->pending_intr_nr && !pt->on_list )
     {
-        pt->on_list = 1;
-        list_add(&pt->list, &pt->vcpu->arch.hvm.tm_list);
+        pt_list_add(pt, pt->vcpu);
         vcpu_kick(pt->vcpu);
     }
     pt_unlock(pt);
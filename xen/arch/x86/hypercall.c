@@ -19,7 +19,10 @@
  * Copyright (c) 2015,2016 Citrix Systems Ltd.
  */
 
+#include <xen/bitops.h>
+#include <xen/guest_access.h>
 #include <xen/hypercall.h>
+#include <xen/sched.h>
 
 #define ARGS(x, n)                              \
     [ __HYPERVISOR_ ## x ] = { n, n }
@@ -79,6 +82,93 @@ const hypercall_args_t hypercall_args_table[NR_hypercalls] =
 #undef COMP
 #undef ARGS
 
+/*
+ * Account one completed hypercall dispatch for @d.  Counters are updated
+ * without locking: concurrent vcpus of the same domain may race, at worst
+ * losing the occasional sample.
+ */
+void hypercall_stats_account(struct domain *d, unsigned int op, s_time_t t0)
+{
+    struct hypercall_stats *stats = d->arch.hypercall_stats;
+    s_time_t delta = NOW() - t0;
+    uint64_t us;
+
+    if ( !stats || op >= NR_hypercalls )
+        return;
+
+    stats += op;
+    stats->count++;
+    stats->time += delta;
+
+    /*
+     * Bucket 0 counts dispatches completing in under 1us, bucket n those
+     * taking [2^(n-1), 2^n) us, the last bucket everything else.
+     */
+    us = delta / MICROSECS(1);
+    stats->hist[us ? min(fls64(us), XEN_HYPERCALL_PROF_NR_HIST - 1) : 0]++;
+}
+
+int hypercall_stats_control(struct xen_sysctl_hypercall_prof_op *hp)
+{
+    struct domain *d;
+    unsigned int op;
+    int rc = 0;
+
+    d = rcu_lock_domain_by_id(hp->domain);
+    if ( d == NULL )
+        return -ESRCH;
+
+    if ( !d->arch.hypercall_stats )
+    {
+        rcu_unlock_domain(d);
+        return -ENODATA;
+    }
+
+    switch ( hp->cmd )
+    {
+    case XEN_SYSCTL_HYPERCALL_PROF_reset:
+        memset(d->arch.hypercall_stats, 0,
+               NR_hypercalls * sizeof(*d->arch.hypercall_stats));
+        break;
+
+    case XEN_SYSCTL_HYPERCALL_PROF_query:
+        hp->nr_elem = 0;
+        for ( op = 0; op < NR_hypercalls; op++ )
+        {
+            const struct hypercall_stats *stats =
+                &d->arch.hypercall_stats[op];
+            struct xen_sysctl_hypercall_prof_data elem = {
+                .op = op,
+                .count = stats->count,
+                .time = stats->time,
+            };
+
+            if ( !stats->count )
+                continue;
+
+            if ( hp->nr_elem < hp->max_elem )
+            {
+                memcpy(elem.hist, stats->hist, sizeof(elem.hist));
+                if ( copy_to_guest_offset(hp->data, hp->nr_elem, &elem, 1) )
+                {
+                    rc = -EFAULT;
+                    break;
+                }
+            }
+            hp->nr_elem++;
+        }
+        break;
+
+    default:
+        rc = -EINVAL;
+        break;
+    }
+
+    rcu_unlock_domain(d);
+
+    return rc;
+}
+
 #define next_arg(fmt, args) ({                                              \
     unsigned long __arg;                                                    \
     switch ( *(fmt)++ )                                                     \
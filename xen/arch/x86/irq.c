@@ -10,8 +10,11 @@
 #include <xen/errno.h>
 #include <xen/event.h>
 #include <xen/irq.h>
+#include <xen/numa.h>
 #include <xen/perfc.h>
+#include <xen/guest_access.h>
 #include <xen/sched.h>
+#include <xen/sched-if.h>
 #include <xen/keyhandler.h>
 #include <xen/compat.h>
 #include <xen/iocap.h>
@@ -25,6 +28,7 @@
 #include <asm/flushtlb.h>
 #include <asm/mach-generic/mach_apic.h>
 #include <public/physdev.h>
+#include <public/sysctl.h>
 
 static int parse_irq_vector_map_param(const char *s);
 
@@ -60,6 +64,12 @@ static struct timer irq_ratelimit_timer;
 static unsigned int __read_mostly irq_ratelimit_threshold = 10000;
 integer_param("irq_ratelimit", irq_ratelimit_threshold);
 
+/* irq_balance: period (in ms) of the guest irq balancer, 0 to disable */
+static unsigned int __read_mostly irq_balance_period_ms;
+integer_param("irq_balance", irq_balance_period_ms);
+static struct timer irq_balance_timer;
+static DEFINE_PER_CPU(unsigned int, irq_bal_load);
+
 static int __init parse_irq_vector_map_param(const char *s)
 {
     const char *ss;
@@ -816,6 +826,7 @@ void do_IRQ(struct cpu_user_regs *regs)
 {
     struct irqaction *action;
     uint32_t          tsc_in;
+    s_time_t          handle_start;
     struct irq_desc  *desc;
     unsigned int      vector = (u8)regs->entry_vector;
     int irq = __get_cpu_var(vector_irq[vector]);
@@ -892,9 +903,14 @@ void do_IRQ(struct cpu_user_regs *regs)
             desc->rl_quantum_start = now;
         }
 
-        tsc_in = tb_init_done ? get_cycles() : 0;
+        desc->bal_cnt++;
+        /* Only pay for the extra timestamps while the balancer is active. */
+        handle_start = irq_balance_period_ms ? NOW() : 0;
+        tsc_in = tracing_active() ? get_cycles() : 0;
         __do_IRQ_guest(irq);
         TRACE_3D(TRC_HW_IRQ_HANDLED, irq, tsc_in, get_cycles());
+        if ( handle_start )
+            desc->bal_time += NOW() - handle_start;
         goto out_no_end;
     }
 
@@ -915,7 +931,7 @@ void do_IRQ(struct cpu_user_regs *regs)
     {
         desc->status &= ~IRQ_PENDING;
         spin_unlock_irq(&desc->lock);
-        tsc_in = tb_init_done ? get_cycles() : 0;
+        tsc_in = tracing_active() ? get_cycles() : 0;
         action->handler(irq, action->dev_id, regs);
         TRACE_3D(TRC_HW_IRQ_HANDLED, irq, tsc_in, get_cycles());
         spin_lock_irq(&desc->lock);
@@ -1080,6 +1096,170 @@ bool cpu_has_pending_apic_eoi(void)
     return pending_eoi_sp(this_cpu(pending_eoi)) != 0;
 }
 
+/* Don't bother retargeting irqs below this rate (per balancing interval). */
+#define IRQ_BALANCE_MIN_RATE 32
+
+/*
+ * CPUs an irq may be moved to: the binding domain's cpupool, narrowed to
+ * the CPUs NUMA-local to the domain whenever that still leaves a choice.
+ */
+static void irq_balance_allowed_cpus(const struct irq_desc *desc,
+                                     cpumask_t *mask)
+{
+    const irq_guest_action_t *action = (irq_guest_action_t *)desc->action;
+    static cpumask_t numa_cpus;
+    struct domain *d;
+    nodeid_t node;
+
+    cpumask_copy(mask, &cpu_online_map);
+
+    if ( !action->nr_guests )
+        return;
+
+    d = action->guest[0];
+    cpumask_and(mask, mask, cpupool_domain_cpumask(d));
+
+    cpumask_clear(&numa_cpus);
+    for_each_node_mask ( node, d->node_affinity )
+        cpumask_or(&numa_cpus, &numa_cpus, &node_to_cpumask(node));
+    if ( cpumask_intersects(mask, &numa_cpus) )
+        cpumask_and(mask, mask, &numa_cpus);
+}
+
+static void irq_balance_timer_fn(void *data)
+{
+    static cpumask_t allowed;
+    unsigned int irq, cpu;
+    unsigned long flags;
+
+    for_each_online_cpu ( cpu )
+        per_cpu(irq_bal_load, cpu) = 0;
+
+    /* Snapshot per-irq rates and tot up per-CPU load. */
+    for ( irq = 0; irq < nr_irqs; irq++ )
+    {
+        struct irq_desc *desc = irq_to_desc(irq);
+
+        if ( !irq_desc_initialized(desc) )
+            continue;
+
+        spin_lock_irqsave(&desc->lock, flags);
+        desc->bal_rate = desc->bal_cnt;
+        desc->bal_cnt = 0;
+        if ( (desc->status & IRQ_GUEST) && desc->bal_rate )
+        {
+            cpu = cpumask_first(desc->arch.cpu_mask);
+            if ( cpu < nr_cpu_ids && cpu_online(cpu) )
+                per_cpu(irq_bal_load, cpu) += desc->bal_rate;
+        }
+        spin_unlock_irqrestore(&desc->lock, flags);
+    }
+
+    /* Retarget hot vectors towards the least loaded CPU they may use. */
+    for ( irq = 0; irq < nr_irqs; irq++ )
+    {
+        struct irq_desc *desc = irq_to_desc(irq);
+        unsigned int home, target, min_load;
+
+        if ( !irq_desc_initialized(desc) )
+            continue;
+
+        spin_lock_irqsave(&desc->lock, flags);
+
+        if ( !(desc->status & IRQ_GUEST) ||
+             (desc->status & IRQ_MOVE_PENDING) ||
+             !desc->handler->set_affinity ||
+             desc->bal_rate < IRQ_BALANCE_MIN_RATE )
+            goto next;
+
+        irq_balance_allowed_cpus(desc, &allowed);
+        if ( cpumask_empty(&allowed) )
+            goto next;
+
+        home = cpumask_first(desc->arch.cpu_mask);
+        target = home;
+        min_load = UINT_MAX;
+        for_each_cpu ( cpu, &allowed )
+            if ( per_cpu(irq_bal_load, cpu) < min_load )
+            {
+                min_load = per_cpu(irq_bal_load, cpu);
+                target = cpu;
+            }
+
+        if ( target == home )
+            goto next;
+
+        /*
+         * Moving a rate r from load H to load L only evens things out if
+         * H - r > L + r.  An irq homed outside its allowed set (e.g. after
+         * a cpupool change) is moved unconditionally.
+         */
+        if ( cpumask_test_cpu(home, &allowed) &&
+             per_cpu(irq_bal_load, home) < min_load + 2 * desc->bal_rate )
+            goto next;
+
+        if ( home < nr_cpu_ids && cpu_online(home) )
+            per_cpu(irq_bal_load, home) -= min(per_cpu(irq_bal_load, home),
+                                               desc->bal_rate);
+        per_cpu(irq_bal_load, target) += desc->bal_rate;
+        desc->bal_moves++;
+        irq_set_affinity(desc, cpumask_of(target));
+
+    next:
+        spin_unlock_irqrestore(&desc->lock, flags);
+    }
+
+    set_timer(&irq_balance_timer, NOW() + MILLISECS(irq_balance_period_ms));
+}
+
+static int __init irq_balance_init(void)
+{
+    if ( irq_balance_period_ms )
+    {
+        init_timer(&irq_balance_timer, irq_balance_timer_fn, NULL, 0);
+        set_timer(&irq_balance_timer,
+                  NOW() + MILLISECS(irq_balance_period_ms));
+    }
+    return 0;
+}
+__initcall(irq_balance_init);
+
+int irq_get_stats(struct xen_sysctl_irq_stats *op)
+{
+    unsigned int irq, nr = 0;
+
+    for ( irq = 0; irq < nr_irqs && nr < op->nr; irq++ )
+    {
+        struct irq_desc *desc = irq_to_desc(irq);
+        struct xen_sysctl_irq_stat stat;
+        unsigned long flags;
+
+        if ( !irq_desc_initialized(desc) )
+            continue;
+
+        spin_lock_irqsave(&desc->lock, flags);
+        if ( !(desc->status & IRQ_GUEST) )
+        {
+            spin_unlock_irqrestore(&desc->lock, flags);
+            continue;
+        }
+        stat.irq = irq;
+        stat.cpu = cpumask_first(desc->arch.cpu_mask);
+        stat.rate = desc->bal_rate;
+        stat.moves = desc->bal_moves;
+        stat.time_ns = desc->bal_time;
+        spin_unlock_irqrestore(&desc->lock, flags);
+
+        if ( copy_to_guest_offset(op->stats, nr, &stat, 1) )
+            return -EFAULT;
+        nr++;
+    }
+
+    op->nr = nr;
+
+    return 0;
+}
+
 static inline void set_pirq_eoi(struct domain *d, unsigned int irq)
 {
     if ( d->arch.pirq_eoi_map )
@@ -1579,7 +1759,7 @@ int pirq_guest_bind(struct vcpu *v, struct pirq *pirq, int will_share)
     irq_guest_action_t *action, *newaction = NULL;
     int                 rc = 0;
 
-    WARN_ON(!spin_is_locked(&v->domain->event_lock));
+    WARN_ON(!rw_is_write_locked(&v->domain->event_lock));
     BUG_ON(!local_irq_is_enabled());
 
  retry:
@@ -1781,7 +1961,7 @@ void pirq_guest_unbind(struct domain *d, struct pirq *pirq)
     struct irq_desc *desc;
     int irq = 0;
 
-    WARN_ON(!spin_is_locked(&d->event_lock));
+    WARN_ON(!rw_is_write_locked(&d->event_lock));
 
     BUG_ON(!local_irq_is_enabled());
     desc = pirq_spin_lock_irq_desc(pirq, NULL);
@@ -1818,7 +1998,7 @@ static bool pirq_guest_force_unbind(struct domain *d, struct pirq *pirq)
     unsigned int i;
     bool bound = false;
 
-    WARN_ON(!spin_is_locked(&d->event_lock));
+    WARN_ON(!rw_is_write_locked(&d->event_lock));
 
     BUG_ON(!local_irq_is_enabled());
     desc = pirq_spin_lock_irq_desc(pirq, NULL);
@@ -1867,7 +2047,7 @@ int get_free_pirq(struct domain *d, int type)
 {
     int i;
 
-    ASSERT(spin_is_locked(&d->event_lock));
+    ASSERT(rw_is_write_locked(&d->event_lock));
 
     if ( type == MAP_PIRQ_TYPE_GSI )
     {
@@ -1892,7 +2072,7 @@ int get_free_pirqs(struct domain *d, unsigned int nr)
 {
     unsigned int i, found = 0;
 
-    ASSERT(spin_is_locked(&d->event_lock));
+    ASSERT(rw_is_write_locked(&d->event_lock));
 
     for ( i = d->nr_pirqs - 1; i >= nr_irqs_gsi; --i )
         if ( is_free_pirq(d, pirq_info(d, i)) )
@@ -1920,7 +2100,7 @@ int map_domain_pirq(
     DECLARE_BITMAP(prepared, MAX_MSI_IRQS) = {};
     DECLARE_BITMAP(granted, MAX_MSI_IRQS) = {};
 
-    ASSERT(spin_is_locked(&d->event_lock));
+    ASSERT(rw_is_write_locked(&d->event_lock));
 
     if ( !irq_access_permitted(current->domain, irq))
         return -EPERM;
@@ -2139,7 +2319,7 @@ int unmap_domain_pirq(struct domain *d, int pirq)
         return -EINVAL;
 
     ASSERT(pcidevs_locked());
-    ASSERT(spin_is_locked(&d->event_lock));
+    ASSERT(rw_is_write_locked(&d->event_lock));
 
     info = pirq_info(d, pirq);
     if ( !info || (irq = info->arch.irq) <= 0 )
@@ -2266,13 +2446,13 @@ void free_domain_pirqs(struct domain *d)
     int i;
 
     pcidevs_lock();
-    spin_lock(&d->event_lock);
+    write_lock(&d->event_lock);
 
     for ( i = 0; i < d->nr_pirqs; i++ )
         if ( domain_pirq_to_irq(d, i) > 0 )
             unmap_domain_pirq(d, i);
 
-    spin_unlock(&d->event_lock);
+    write_unlock(&d->event_lock);
     pcidevs_unlock();
 }
 
@@ -2455,7 +2635,7 @@ int map_domain_emuirq_pirq(struct domain *d, int pirq, int emuirq)
     int old_emuirq = IRQ_UNBOUND, old_pirq = IRQ_UNBOUND;
     struct pirq *info;
 
-    ASSERT(spin_is_locked(&d->event_lock));
+    ASSERT(rw_is_write_locked(&d->event_lock));
 
     if ( !is_hvm_domain(d) )
         return -EINVAL;
@@ -2521,7 +2701,7 @@ int unmap_domain_pirq_emuirq(struct domain *d, int pirq)
     if ( (pirq < 0) || (pirq >= d->nr_pirqs) )
         return -EINVAL;
 
-    ASSERT(spin_is_locked(&d->event_lock));
+    ASSERT(rw_is_write_locked(&d->event_lock));
 
     emuirq = domain_pirq_to_emuirq(d, pirq);
     if ( emuirq == IRQ_UNBOUND )
@@ -2569,7 +2749,7 @@ static int allocate_pirq(struct domain *d, int index, int pirq, int irq,
 {
     int current_pirq;
 
-    ASSERT(spin_is_locked(&d->event_lock));
+    ASSERT(rw_is_write_locked(&d->event_lock));
     current_pirq = domain_irq_to_pirq(d, irq);
     if ( pirq < 0 )
     {
@@ -2641,7 +2821,7 @@ int allocate_and_map_gsi_pirq(struct domain *d, int index, int *pirq_p)
     }
 
     /* Verify or get pirq. */
-    spin_lock(&d->event_lock);
+    write_lock(&d->event_lock);
     pirq = allocate_pirq(d, index, *pirq_p, irq, MAP_PIRQ_TYPE_GSI, NULL);
     if ( pirq < 0 )
     {
@@ -2654,7 +2834,7 @@ int allocate_and_map_gsi_pirq(struct domain *d, int index, int *pirq_p)
         *pirq_p = pirq;
 
  done:
-    spin_unlock(&d->event_lock);
+    write_unlock(&d->event_lock);
 
     return ret;
 }
@@ -2695,7 +2875,7 @@ int allocate_and_map_msi_pirq(struct domain *d, int index, int *pirq_p,
 
     pcidevs_lock();
     /* Verify or get pirq. */
-    spin_lock(&d->event_lock);
+    write_lock(&d->event_lock);
     pirq = allocate_pirq(d, index, *pirq_p, irq, type, &msi->entry_nr);
     if ( pirq < 0 )
     {
@@ -2708,7 +2888,7 @@ int allocate_and_map_msi_pirq(struct domain *d, int index, int *pirq_p,
         *pirq_p = pirq;
 
  done:
-    spin_unlock(&d->event_lock);
+    write_unlock(&d->event_lock);
     pcidevs_unlock();
     if ( ret )
     {
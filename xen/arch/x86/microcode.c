@@ -405,6 +405,16 @@ int __init early_microcode_update_cpu(bool start_update)
         if ( rc )
             return rc;
 
+        /*
+         * APs can normally reuse the patch a previously booted CPU has
+         * already isolated and cached, avoiding a re-parse of the whole
+         * blob on every CPU (all of which is serialized by bringup).
+         * Fall back to the full scan if no cached patch fits, e.g. on
+         * mixed-stepping systems.
+         */
+        if ( !start_update && !microcode_resume_cpu(smp_processor_id()) )
+            return 0;
+
         return microcode_update_cpu(data, len);
     }
     else
@@ -100,6 +100,7 @@
  */
 
 #include <xen/init.h>
+#include <xen/cpu.h>
 #include <xen/kernel.h>
 #include <xen/lib.h>
 #include <xen/mm.h>
@@ -1501,7 +1502,7 @@ static int alloc_l2_table(struct page_info *page, unsigned long type)
     {
         l2_pgentry_t l2e;
 
-        if ( i > page->nr_validated_ptes && hypercall_preempt_check() )
+        if ( i > page->nr_validated_ptes && general_preempt_check() )
         {
             page->nr_validated_ptes = i;
             rc = -ERESTART;
@@ -1582,7 +1583,7 @@ static int alloc_l3_table(struct page_info *page)
     {
         l3_pgentry_t l3e = pl3e[i];
 
-        if ( i > page->nr_validated_ptes && hypercall_preempt_check() )
+        if ( i > page->nr_validated_ptes && general_preempt_check() )
         {
             page->nr_validated_ptes = i;
             rc = -ERESTART;
@@ -1870,7 +1871,7 @@ static int free_l2_table(struct page_info *page)
         if ( !i-- )
             break;
 
-        if ( hypercall_preempt_check() )
+        if ( general_preempt_check() )
         {
             rc = -EINTR;
             break;
@@ -1922,7 +1923,7 @@ static int free_l3_table(struct page_info *page)
         if ( !i-- )
             break;
 
-        if ( hypercall_preempt_check() )
+        if ( general_preempt_check() )
         {
             rc = -EINTR;
             break;
@@ -2722,6 +2723,257 @@ static int _put_final_page_type(struct page_info *page, unsigned long type,
 }
 
 
+/*
+ * Split type-reference counting.
+ *
+ * An L1 page table shared by many vCPUs (e.g. one covering a library
+ * mapped into every process of a fork-heavy PV guest) turns the single
+ * atomic type_info word into a coherence hotspot: every map, unmap and
+ * (un)pin bounces its cache line across the machine.  Once the type
+ * count of an L1 table exceeds the "pt-split-thresh" threshold, the
+ * count in type_info is frozen and matching get/put operations only
+ * update a per-CPU delta, leaving the shared line read-only.  The exact
+ * count is the frozen base plus the sum of all deltas.
+ *
+ * Anything needing exact semantics (a type change, linear page table
+ * accounting, domain teardown) folds the deltas back first:
+ *  1. set PGT_split_fold, diverting new get/put operations into a wait
+ *     loop;
+ *  2. interrupt all other CPUs: delta updates run with interrupts
+ *     disabled, so once every CPU has acked, in-flight ones have either
+ *     completed or backed out;
+ *  3. sum and clear the deltas, and write the exact count back while
+ *     clearing PGT_split.
+ *
+ * Each tracking slot holds a general and a type reference of its own,
+ * so a split page can neither be freed nor see its type count reach
+ * zero (and thus never needs devalidating) before it is folded.  At
+ * worst PGT_SPLIT_NR otherwise unreferenced pages are held back until
+ * their next fold, which for a dying domain is forced from
+ * domain_relinquish_resources().
+ */
+static unsigned int __read_mostly opt_pt_split_thresh;
+integer_param("pt-split-thresh", opt_pt_split_thresh);
+
+#define PGT_SPLIT_NR (MASK_EXTR(PGT_split_idx_mask, PGT_split_idx_mask) + 1)
+
+static struct pgt_split_entry {
+    struct page_info *page;
+} pgt_split_ent[PGT_SPLIT_NR];
+static DEFINE_SPINLOCK(pgt_split_lock);
+static DEFINE_PER_CPU(long, pgt_split_delta[PGT_SPLIT_NR]);
+/* Deltas left behind by offlined CPUs; see cpu_callback(). */
+static long pgt_split_orphan[PGT_SPLIT_NR];
+
+#define pgt_split_idx(x) MASK_EXTR(x, PGT_split_idx_mask)
+
+/*
+ * Commit a per-CPU delta for a split-counted page.  @x is the caller's
+ * (possibly stale) view of type_info with PGT_split set.  Re-checking
+ * type_info after the update catches a fold having started in between:
+ * the fold's summation waits for our IPI ack, which cannot happen while
+ * interrupts are disabled here, so backing the delta out again is race
+ * free even if the slot has meanwhile been reused for another page.
+ */
+static bool pgt_split_adjust(struct page_info *page, unsigned long x, long inc)
+{
+    unsigned int idx = pgt_split_idx(x);
+    unsigned long flags, y;
+    bool ok;
+
+    local_irq_save(flags);
+    this_cpu(pgt_split_delta)[idx] += inc;
+    y = page->u.inuse.type_info;
+    ok = (y & (PGT_split | PGT_split_fold | PGT_split_idx_mask)) ==
+         (PGT_split | (x & PGT_split_idx_mask));
+    if ( unlikely(!ok) )
+        this_cpu(pgt_split_delta)[idx] -= inc;
+    local_irq_restore(flags);
+
+    return ok;
+}
+
+static void pgt_split_nop(void *unused)
+{
+}
+
+/*
+ * Fold the per-CPU deltas of @page back into type_info and drop the
+ * tracking slot's references.  Safe to call with a stale notion of the
+ * page being split; must not be called with interrupts disabled or
+ * while holding @page's page_lock() (the final put_page_type() below
+ * may devalidate the page).
+ */
+static void pgt_split_fold(struct page_info *page)
+{
+    unsigned long x, nx, y;
+    unsigned int idx, cpu;
+    long sum;
+
+    ASSERT(local_irq_is_enabled());
+
+    spin_lock(&pgt_split_lock);
+
+    y = page->u.inuse.type_info;
+    do {
+        x = y;
+        if ( !(x & PGT_split) )
+        {
+            /* Already folded by somebody else. */
+            spin_unlock(&pgt_split_lock);
+            return;
+        }
+    } while ( (y = cmpxchg(&page->u.inuse.type_info, x,
+                           x | PGT_split_fold)) != x );
+
+    idx = pgt_split_idx(x);
+    ASSERT(pgt_split_ent[idx].page == page);
+
+    /* Wait for in-flight delta updates (see pgt_split_adjust()). */
+    smp_call_function(pgt_split_nop, NULL, 1);
+
+    sum = pgt_split_orphan[idx];
+    pgt_split_orphan[idx] = 0;
+    for_each_online_cpu ( cpu )
+    {
+        sum += per_cpu(pgt_split_delta, cpu)[idx];
+        per_cpu(pgt_split_delta, cpu)[idx] = 0;
+    }
+
+    /* The slot's own type reference keeps the exact count positive. */
+    ASSERT((long)(x & PGT_count_mask) + sum > 0);
+
+    y = page->u.inuse.type_info;
+    do {
+        x = y;
+        nx = (x & ~(PGT_split | PGT_split_fold | PGT_split_idx_mask)) + sum;
+    } while ( (y = cmpxchg(&page->u.inuse.type_info, x, nx)) != x );
+
+    pgt_split_ent[idx].page = NULL;
+
+    spin_unlock(&pgt_split_lock);
+
+    perfc_incr(pgt_split_fold);
+
+    put_page_type(page);
+    put_page(page);
+}
+
+/*
+ * Try to switch @page to split counting, accounting the caller's type
+ * reference (plus one for the tracking slot) in the process.  @x must
+ * be a validated PGT_l1_page_table view of type_info the caller is
+ * about to cmpxchg against.
+ */
+static bool pgt_split_enter(struct page_info *page, unsigned long x)
+{
+    struct domain *d = page_get_owner(page);
+    unsigned long nx;
+    unsigned int i;
+
+    if ( (x & (PGT_type_mask | PGT_pae_xen_l2 | PGT_partial)) !=
+         PGT_l1_page_table ||
+         !d || !is_pv_domain(d) || d->is_dying ||
+         shadow_mode_enabled(d) || need_iommu_pt_sync(d) )
+        return false;
+
+    if ( !get_page(page, d) )
+        return false;
+
+    spin_lock(&pgt_split_lock);
+    for ( i = 0; i < PGT_SPLIT_NR; i++ )
+        if ( !pgt_split_ent[i].page )
+            break;
+    if ( i == PGT_SPLIT_NR )
+    {
+        spin_unlock(&pgt_split_lock);
+        put_page(page);
+        return false;
+    }
+    pgt_split_ent[i].page = page;
+    spin_unlock(&pgt_split_lock);
+
+    nx = (x + 2) | PGT_split | MASK_INSR(i, PGT_split_idx_mask);
+    if ( cmpxchg(&page->u.inuse.type_info, x, nx) != x )
+    {
+        spin_lock(&pgt_split_lock);
+        pgt_split_ent[i].page = NULL;
+        spin_unlock(&pgt_split_lock);
+        put_page(page);
+        return false;
+    }
+
+    perfc_incr(pgt_split_enter);
+
+    /*
+     * The eligibility checks above can be invalidated behind our back.
+     * The enabling paths (domain_kill(), shadow_enable(), device
+     * assignment) only see the page once PGT_split is visible, and we
+     * re-check after setting it, so one side always folds.
+     */
+    if ( unlikely(d->is_dying || shadow_mode_enabled(d) ||
+                  need_iommu_pt_sync(d)) )
+        pgt_split_fold(page);
+
+    return true;
+}
+
+/* Fold every split-counted page owned by @d; called when @d is dying. */
+void pgt_split_fold_domain(struct domain *d)
+{
+    unsigned int i;
+
+    for ( i = 0; i < PGT_SPLIT_NR; i++ )
+    {
+        struct page_info *page;
+
+        spin_lock(&pgt_split_lock);
+        page = pgt_split_ent[i].page;
+        if ( !page || page_get_owner(page) != d )
+            page = NULL;
+        spin_unlock(&pgt_split_lock);
+
+        /*
+         * The slot's general reference keeps @page alive until the
+         * fold; pgt_split_fold() copes with losing a race against it.
+         */
+        if ( page )
+            pgt_split_fold(page);
+    }
+}
+
+static int cpu_callback(struct notifier_block *nfb, unsigned long action,
+                        void *hcpu)
+{
+    unsigned int i;
+
+    /*
+     * CPU_DYING runs on the dying CPU inside stop_machine context: no
+     * fold can be in flight (its CPU couldn't schedule the rendezvous
+     * tasklet), so plain accesses to the orphan array are fine.
+     */
+    if ( action == CPU_DYING )
+        for ( i = 0; i < PGT_SPLIT_NR; i++ )
+        {
+            pgt_split_orphan[i] += this_cpu(pgt_split_delta)[i];
+            this_cpu(pgt_split_delta)[i] = 0;
+        }
+
+    return NOTIFY_DONE;
+}
+
+static struct notifier_block cpu_nfb = {
+    .notifier_call = cpu_callback
+};
+
+static int __init pgt_split_init(void)
+{
+    register_cpu_notifier(&cpu_nfb);
+    return 0;
+}
+__initcall(pgt_split_init);
+
+
 static int _put_page_type(struct page_info *page, bool preemptible,
                           struct page_info *ptpg)
 {
@@ -2736,6 +2988,30 @@ static int _put_page_type(struct page_info *page, bool preemptible,
 
         ASSERT((x & PGT_count_mask) != 0);
 
+        if ( unlikely(x & PGT_split) )
+        {
+            if ( x & PGT_split_fold )
+            {
+                /* A fold is in progress; wait for the exact count. */
+                do {
+                    if ( preemptible && general_preempt_check() )
+                        return -EINTR;
+                    cpu_relax();
+                } while ( (y = page->u.inuse.type_info) == x );
+            }
+            else if ( ptpg && PGT_type_equal(x, ptpg->u.inuse.type_info) )
+            {
+                /* Linear pt accounting needs exact semantics. */
+                pgt_split_fold(page);
+                y = page->u.inuse.type_info;
+            }
+            else if ( pgt_split_adjust(page, x, -1) )
+                return 0;
+            else
+                y = page->u.inuse.type_info;
+            continue;
+        }
+
         switch ( nx & (PGT_locked | PGT_count_mask) )
         {
         case 0:
@@ -2802,7 +3078,7 @@ static int _put_page_type(struct page_info *page, bool preemptible,
             break;
         }
 
-        if ( preemptible && hypercall_preempt_check() )
+        if ( preemptible && general_preempt_check() )
             return -EINTR;
     }
 }
@@ -2820,6 +3096,37 @@ static int _get_page_type(struct page_info *page, unsigned long type,
     for ( ; ; )
     {
         x  = y;
+
+        if ( unlikely(x & PGT_split) )
+        {
+            if ( !(x & PGT_split_fold) &&
+                 (x & (PGT_type_mask | PGT_pae_xen_l2)) == type &&
+                 (x & PGT_validated) )
+            {
+                /*
+                 * Type and validity are frozen while PGT_split is set,
+                 * so evaluating them on a stale @x is fine.
+                 */
+                if ( pgt_split_adjust(page, x, 1) )
+                    return 0;
+            }
+            else if ( x & PGT_split_fold )
+            {
+                /* A fold is in progress; wait for the exact count. */
+                do {
+                    if ( preemptible && general_preempt_check() )
+                        return -EINTR;
+                    cpu_relax();
+                } while ( (y = page->u.inuse.type_info) == x );
+                continue;
+            }
+            else
+                /* Type changes need exact semantics. */
+                pgt_split_fold(page);
+            y = page->u.inuse.type_info;
+            continue;
+        }
+
         nx = x + 1;
         if ( unlikely((nx & PGT_count_mask) == 0) )
         {
@@ -2897,7 +3204,7 @@ static int _get_page_type(struct page_info *page, unsigned long type,
             {
                 /* Someone else is updating validation of this page. Wait... */
                 do {
-                    if ( preemptible && hypercall_preempt_check() )
+                    if ( preemptible && general_preempt_check() )
                         return -EINTR;
                     cpu_relax();
                 } while ( (y = page->u.inuse.type_info) == x );
@@ -2907,11 +3214,16 @@ static int _get_page_type(struct page_info *page, unsigned long type,
             ASSERT((x & PGT_count_mask) == 1);
             nx = x & ~PGT_partial;
         }
+        else if ( unlikely(opt_pt_split_thresh &&
+                           (x & PGT_count_mask) >= opt_pt_split_thresh) &&
+                  pgt_split_enter(page, x) )
+            /* The reference was taken along with switching to split mode. */
+            return 0;
 
         if ( likely((y = cmpxchg(&page->u.inuse.type_info, x, nx)) == x) )
             break;
 
-        if ( preemptible && hypercall_preempt_check() )
+        if ( preemptible && general_preempt_check() )
             return -EINTR;
     }
 
@@ -3760,6 +4072,9 @@ long do_mmu_update(
     struct vcpu *curr = current, *v = curr;
     struct domain *d = v->domain, *pt_owner = d, *pg_owner;
     mfn_t map_mfn = INVALID_MFN;
+    struct page_info *run_page = NULL;
+    unsigned long run_gmfn = ~0UL;
+    bool run_typed = false;
     bool sync_guest = false;
     uint32_t xsm_needed = 0;
     uint32_t xsm_checked = 0;
@@ -3868,21 +4183,45 @@ long do_mmu_update(
 
             req.ptr -= cmd;
             gmfn = req.ptr >> PAGE_SHIFT;
-            page = get_page_from_gfn(pt_owner, gmfn, &p2mt, P2M_ALLOC);
 
-            if ( unlikely(!page) || p2mt != p2m_ram_rw )
+            /*
+             * Guests submit long runs of updates all targeting the same
+             * page table page (fork/exec populating L1s): keep the
+             * reference (and any writable type count) from the previous
+             * iteration and redo the lookup only when the target moves.
+             */
+            if ( run_page && gmfn == run_gmfn )
+                page = run_page;
+            else
             {
-                if ( page )
-                    put_page(page);
-                if ( p2m_is_paged(p2mt) )
+                if ( run_page )
                 {
-                    p2m_mem_paging_populate(pt_owner, gmfn);
-                    rc = -ENOENT;
+                    if ( run_typed )
+                        put_page_type(run_page);
+                    put_page(run_page);
+                    run_page = NULL;
+                    run_typed = false;
                 }
-                else
-                    gdprintk(XENLOG_WARNING,
-                             "Could not get page for normal update\n");
-                break;
+
+                page = get_page_from_gfn(pt_owner, gmfn, &p2mt, P2M_ALLOC);
+
+                if ( unlikely(!page) || p2mt != p2m_ram_rw )
+                {
+                    if ( page )
+                        put_page(page);
+                    if ( p2m_is_paged(p2mt) )
+                    {
+                        p2m_mem_paging_populate(pt_owner, gmfn);
+                        rc = -ENOENT;
+                    }
+                    else
+                        gdprintk(XENLOG_WARNING,
+                                 "Could not get page for normal update\n");
+                    break;
+                }
+
+                run_page = page;
+                run_gmfn = gmfn;
             }
 
             mfn = mfn_x(page_to_mfn(page));
@@ -3957,15 +4296,17 @@ long do_mmu_update(
                 if ( rc == -EINTR )
                     rc = -ERESTART;
             }
-            else if ( get_page_type(page, PGT_writable_page) )
+            else if ( run_typed || get_page_type(page, PGT_writable_page) )
             {
+                /*
+                 * Keep the writable type reference for the rest of the run
+                 * rather than cycling the type count on every entry.
+                 */
+                run_typed = true;
                 perfc_incr(writable_mmu_updates);
                 if ( paging_write_guest_entry(v, va, req.val, _mfn(mfn)) )
                     rc = 0;
-                put_page_type(page);
             }
-
-            put_page(page);
         }
         break;
 
@@ -4042,6 +4383,11 @@ long do_mmu_update(
 
     put_pg_owner(pg_owner);
 
+    if ( run_typed )
+        put_page_type(run_page);
+    if ( run_page )
+        put_page(run_page);
+
     if ( va )
         unmap_domain_page(va);
 
@@ -4502,7 +4848,11 @@ int xenmem_add_to_physmap_one(
             break;
         }
         case XENMAPSPACE_gmfn_foreign:
-            return p2m_add_foreign(d, idx, gfn_x(gpfn), extra.foreign_domid);
+            return p2m_add_foreign(d, idx, gfn_x(gpfn), extra.foreign_domid,
+                                   0);
+        case XENMAPSPACE_gmfn_foreign_2m:
+            return p2m_add_foreign(d, idx, gfn_x(gpfn), extra.foreign_domid,
+                                   PAGE_ORDER_2M);
         default:
             break;
     }
@@ -1232,6 +1232,35 @@ private_page_found:
     return 0;
 }
 
+/* Size of the aligned gfn window unshared around a write fault. */
+#define UNSHARE_CLUSTER_PAGES 8
+
+void mem_sharing_unshare_cluster(struct domain *d, unsigned long gfn)
+{
+    unsigned long start = gfn & ~(UNSHARE_CLUSTER_PAGES - 1);
+    unsigned long i;
+
+    /* Guests writing to one page of a deduplicated region typically touch
+     * its neighbours shortly afterwards; unsharing the surrounding cluster
+     * in one go saves the follow-on write faults. Best effort only: gfns
+     * that are not shared are skipped, and on ENOMEM the remaining pages
+     * are left for their own faults (and the attached notification). */
+    for ( i = start; i < start + UNSHARE_CLUSTER_PAGES; i++ )
+    {
+        p2m_type_t t;
+
+        if ( i == gfn )
+            continue;
+
+        (void)get_gfn_query_unlocked(d, i, &t);
+        if ( t != p2m_ram_shared )
+            continue;
+
+        if ( mem_sharing_unshare_page(d, i, 0) < 0 )
+            break;
+    }
+}
+
 int relinquish_shared_pages(struct domain *d)
 {
     int rc = 0;
@@ -1272,7 +1301,7 @@ int relinquish_shared_pages(struct domain *d)
         /* Preempt every 2MiB (shared) or 32MiB (unshared) - arbitrary. */
         if ( count >= 0x2000 )
         {
-            if ( hypercall_preempt_check() )
+            if ( general_preempt_check() )
             {
                 p2m->next_shared_gfn_to_relinquish = gfn + 1;
                 rc = -ERESTART;
@@ -1337,6 +1366,53 @@ static int range_share(struct domain *d, struct domain *cd,
     return rc;
 }
 
+/*
+ * Populate a range of an (empty) client physmap with shared mappings of the
+ * source domain's pages, giving clone semantics: both domains see the same
+ * contents, and the first write by either side breaks the sharing through
+ * the regular unshare path, leaving the writer with a private copy. Client
+ * gfns which aren't physmap holes, and source pages which can't be shared
+ * (granted out, foreign-mapped, ...), are skipped and are the toolstack's
+ * to populate.
+ */
+static int clone_range(struct domain *d, struct domain *cd,
+                       struct mem_sharing_op_range *range)
+{
+    int rc = 0;
+    shr_handle_t sh;
+    unsigned long start = range->opaque ?: range->first_gfn;
+
+    while ( range->last_gfn >= start )
+    {
+        /*
+         * As with range sharing, only running out of memory is fatal;
+         * individual pages may legitimately be unclonable.
+         */
+        rc = nominate_page(d, _gfn(start), 0, &sh);
+        if ( rc == -ENOMEM )
+            break;
+
+        if ( !rc )
+        {
+            rc = mem_sharing_add_to_physmap(d, start, sh, cd, start);
+            if ( rc == -ENOMEM )
+                break;
+        }
+        rc = 0;
+
+        /* Check for continuation if it's not the last iteration. */
+        if ( range->last_gfn >= ++start && hypercall_preempt_check() )
+        {
+            rc = 1;
+            break;
+        }
+    }
+
+    range->opaque = start;
+
+    return rc;
+}
+
 int mem_sharing_memop(XEN_GUEST_HANDLE_PARAM(xen_mem_sharing_op_t) arg)
 {
     int rc;
@@ -1603,6 +1679,93 @@ int mem_sharing_memop(XEN_GUEST_HANDLE_PARAM(xen_mem_sharing_op_t) arg)
         }
         break;
 
+        case XENMEM_sharing_op_clone:
+        {
+            unsigned long max_sgfn;
+            struct domain *cd;
+
+            rc = -EINVAL;
+            if ( mso.u.range._pad[0] || mso.u.range._pad[1] ||
+                 mso.u.range._pad[2] )
+                 goto out;
+
+            /* Opaque is the continuation value, as for range sharing. */
+            if ( mso.u.range.opaque &&
+                 (mso.u.range.opaque < mso.u.range.first_gfn ||
+                  mso.u.range.opaque > mso.u.range.last_gfn) )
+                goto out;
+
+            if ( !mem_sharing_enabled(d) )
+                goto out;
+
+            rc = rcu_lock_live_remote_domain_by_id(mso.u.range.client_domain,
+                                                   &cd);
+            if ( rc )
+                goto out;
+
+            /*
+             * We reuse XENMEM_sharing_op_share XSM check here as this is
+             * essentially the same concept repeated over multiple pages.
+             */
+            rc = xsm_mem_sharing_op(XSM_DM_PRIV, d, cd,
+                                    XENMEM_sharing_op_share);
+            if ( rc )
+            {
+                rcu_unlock_domain(cd);
+                goto out;
+            }
+
+            if ( !mem_sharing_enabled(cd) )
+            {
+                rcu_unlock_domain(cd);
+                rc = -EINVAL;
+                goto out;
+            }
+
+            /*
+             * Sanity check only, the client should keep the domains paused for
+             * the duration of this op.
+             */
+            if ( !atomic_read(&d->pause_count) ||
+                 !atomic_read(&cd->pause_count) )
+            {
+                rcu_unlock_domain(cd);
+                rc = -EINVAL;
+                goto out;
+            }
+
+            /*
+             * Only the source needs to be bounds checked; the client's
+             * physmap is expected to consist of holes across the range,
+             * which get filled with shared entries as we go.
+             */
+            max_sgfn = domain_get_maximum_gpfn(d);
+
+            if ( max_sgfn < mso.u.range.first_gfn ||
+                 max_sgfn < mso.u.range.last_gfn )
+            {
+                rcu_unlock_domain(cd);
+                rc = -EINVAL;
+                goto out;
+            }
+
+            rc = clone_range(d, cd, &mso.u.range);
+            rcu_unlock_domain(cd);
+
+            if ( rc > 0 )
+            {
+                if ( __copy_to_guest(arg, &mso, 1) )
+                    rc = -EFAULT;
+                else
+                    rc = hypercall_create_continuation(__HYPERVISOR_memory_op,
+                                                       "lh", XENMEM_sharing_op,
+                                                       arg);
+            }
+            else
+                mso.u.range.opaque = 0;
+        }
+        break;
+
         case XENMEM_sharing_op_debug_gfn:
             rc = debug_gfn(d, _gfn(mso.u.debug.u.gfn));
             break;
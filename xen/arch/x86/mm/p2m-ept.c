@@ -50,8 +50,9 @@ static int atomic_write_ept_entry(struct p2m_domain *p2m,
                                   ept_entry_t *entryptr, ept_entry_t new,
                                   int level)
 {
+    /* p2m_entry_modify() expects levels starting at 1 for 4k leaves. */
     int rc = p2m_entry_modify(p2m, new.sa_p2mt, entryptr->sa_p2mt,
-                              _mfn(new.mfn), _mfn(entryptr->mfn), level);
+                              _mfn(new.mfn), _mfn(entryptr->mfn), level + 1);
 
     if ( rc )
         return rc;
@@ -232,6 +233,60 @@ static void ept_free_entry(struct p2m_domain *p2m, ept_entry_t *ept_entry, int l
     p2m_free_ptp(p2m, mfn_to_page(_mfn(ept_entry->mfn)));
 }
 
+/*
+ * Intermediate tables which have been unhooked from the EPT tree may still
+ * be in use by lockless software walkers (get_gfn_query_unlocked() and
+ * friends), which run without the p2m lock and hence aren't flushed out by
+ * ept_sync_domain().  Queue the unhooked subtree and only hand its pages
+ * back to the paging pool after an RCU grace period, when no such walker
+ * can hold a pointer into it any more.
+ */
+struct ept_deferred_free {
+    struct rcu_head rcu;
+    struct p2m_domain *p2m;
+    ept_entry_t entry;
+    int level;
+};
+
+static void ept_free_entry_rcu(struct rcu_head *head)
+{
+    struct ept_deferred_free *df =
+        container_of(head, struct ept_deferred_free, rcu);
+    struct p2m_domain *p2m = df->p2m;
+
+    p2m_lock(p2m);
+    ept_free_entry(p2m, &df->entry, df->level);
+    p2m_unlock(p2m);
+
+    put_domain(p2m->domain);
+    xfree(df);
+}
+
+static void ept_free_entry_deferred(struct p2m_domain *p2m,
+                                    ept_entry_t *ept_entry, int level)
+{
+    struct ept_deferred_free *df;
+
+    if ( level == 0 || !is_epte_present(ept_entry) ||
+         is_epte_superpage(ept_entry) )
+        return;
+
+    df = xmalloc(struct ept_deferred_free);
+    if ( df && get_domain(p2m->domain) )
+    {
+        df->p2m = p2m;
+        df->entry = *ept_entry;
+        df->level = level;
+        call_rcu(&df->rcu, ept_free_entry_rcu);
+    }
+    else
+    {
+        /* No way to track the deferral; fall back to freeing right away. */
+        xfree(df);
+        ept_free_entry(p2m, ept_entry, level);
+    }
+}
+
 static bool_t ept_split_super_page(struct p2m_domain *p2m,
                                    ept_entry_t *ept_entry,
                                    unsigned int level, unsigned int target)
@@ -265,6 +320,24 @@ static bool_t ept_split_super_page(struct p2m_domain *p2m,
 
         ept_p2m_type_to_flags(p2m, epte, epte->sa_p2mt, epte->access);
 
+        /*
+         * The new leaf entries are written directly rather than through
+         * atomic_write_ept_entry(), so take the per-entry foreign reference
+         * here.  The parent superpage's references are dropped when it's
+         * replaced by the freshly allocated table.
+         */
+        if ( epte->sa_p2mt == p2m_map_foreign )
+        {
+            ASSERT(level == 1);
+            if ( !page_get_owner_and_reference(mfn_to_page(_mfn(epte->mfn))) )
+            {
+                while ( i-- )
+                    put_page(mfn_to_page(_mfn(table[i].mfn)));
+                rv = 0;
+                break;
+            }
+        }
+
         if ( (level - 1) == target )
             continue;
 
@@ -462,11 +535,67 @@ static int ept_invalidate_emt_range(struct p2m_domain *p2m,
  * - zero if no adjustment was done,
  * - a positive value if at least one adjustment was done.
  */
+/*
+ * Check whether a just recalculated leaf table has become one contiguous,
+ * uniform run of 4k mappings, and if so fold it back into a 2M superpage
+ * in the parent table.  This is the common situation when a log-dirty
+ * range covering the table is torn down again (e.g. at the end of live
+ * migration): the type change shattered the superpage, and without this
+ * the guest would permanently keep the 4k mappings and the extra TLB
+ * pressure coming with them.
+ */
+static void ept_recoalesce_table(struct p2m_domain *p2m, ept_entry_t *epte,
+                                 unsigned long parent_mfn,
+                                 unsigned int parent_idx)
+{
+    ept_entry_t e0 = atomic_read_ept_entry(&epte[0]), old, new, *parent;
+    unsigned int i;
+    int wrc;
+
+    if ( !is_epte_present(&e0) || !is_epte_valid(&e0) ||
+         is_epte_superpage(&e0) || e0.recalc ||
+         !p2m_is_changeable(e0.sa_p2mt) || e0.sa_p2mt == p2m_ioreq_server ||
+         (e0.mfn & (EPT_PAGETABLE_ENTRIES - 1)) )
+        return;
+
+    for ( i = 1; i < EPT_PAGETABLE_ENTRIES; ++i )
+    {
+        ept_entry_t e = atomic_read_ept_entry(&epte[i]), expect = e0;
+
+        expect.mfn += i;
+        if ( e.epte != expect.epte )
+            return;
+    }
+
+    parent = map_domain_page(_mfn(parent_mfn));
+    old = atomic_read_ept_entry(&parent[parent_idx]);
+
+    new = e0;
+    new.sp = 1;
+
+    wrc = atomic_write_ept_entry(p2m, &parent[parent_idx], new, 1);
+    if ( likely(wrc == 0) )
+    {
+        ept_sync_domain(p2m);
+        /*
+         * The now unhooked leaf table may still be in use by hardware
+         * walks (until the sync above takes effect) and by lockless
+         * software walks; ept_free_entry() flushes before freeing, and
+         * the RCU deferral covers the software side.
+         */
+        ept_free_entry_deferred(p2m, &old, 1);
+    }
+
+    unmap_domain_page(parent);
+}
+
 static int resolve_misconfig(struct p2m_domain *p2m, unsigned long gfn)
 {
     struct ept_data *ept = &p2m->ept;
     unsigned int level = ept->wl;
     unsigned long mfn = ept->mfn;
+    unsigned long parent_mfn = 0;
+    unsigned int parent_idx = 0;
     ept_entry_t *epte;
     int wrc, rc = 0;
 
@@ -515,6 +644,9 @@ static int resolve_misconfig(struct p2m_domain *p2m, unsigned long gfn)
                     wrc = atomic_write_ept_entry(p2m, &epte[i], e, level);
                     ASSERT(wrc == 0);
                 }
+
+                if ( parent_mfn )
+                    ept_recoalesce_table(p2m, epte, parent_mfn, parent_idx);
             }
             else
             {
@@ -588,6 +720,8 @@ static int resolve_misconfig(struct p2m_domain *p2m, unsigned long gfn)
         else
             break;
 
+        parent_mfn = mfn;
+        parent_idx = i;
         mfn = e.mfn;
     }
 
@@ -674,7 +808,7 @@ ept_set_entry(struct p2m_domain *p2m, gfn_t gfn_, mfn_t mfn,
     ASSERT((target == 2 && hap_has_1gb) ||
            (target == 1 && hap_has_2mb) ||
            (target == 0));
-    ASSERT(!p2m_is_foreign(p2mt) || target == 0);
+    ASSERT(!p2m_is_foreign(p2mt) || target <= 1);
 
     table = map_domain_page(pagetable_get_mfn(p2m_get_pagetable(p2m)));
 
@@ -820,9 +954,11 @@ out:
     /* Release the old intermediate tables, if any.  This has to be the
        last thing we do, after the ept_sync_domain() and removal
        from the iommu tables, so as to avoid a potential
-       use-after-free. */
+       use-after-free by hardware walkers.  The release is further
+       deferred by an RCU grace period for the benefit of lockless
+       software walkers. */
     if ( is_epte_present(&old_entry) )
-        ept_free_entry(p2m, &old_entry, target);
+        ept_free_entry_deferred(p2m, &old_entry, target);
 
     if ( entry_written && p2m_is_hostp2m(p2m) )
     {
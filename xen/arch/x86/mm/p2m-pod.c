@@ -31,6 +31,9 @@
 
 #define superpage_aligned(_x)  (((_x)&(SUPERPAGE_PAGES-1))==0)
 
+/* Number of entries (tagged as for the MRP list) kept as reclaim candidates. */
+#define POD_CANDIDATE_RING 1024
+
 /* Enforce lock ordering when grabbing the "external" page_alloc lock */
 static inline void lock_page_alloc(struct p2m_domain *p2m)
 {
@@ -346,6 +349,10 @@ p2m_pod_set_mem_target(struct domain *d, unsigned long target)
     if ( d->is_dying )
         goto out;
 
+    /* PoD is (about to be) in use: set up the reclaim candidate ring. */
+    if ( !p2m->pod.cand.ring )
+        p2m->pod.cand.ring = xmalloc_array(unsigned long, POD_CANDIDATE_RING);
+
     /*
      * T' < B: Don't reduce the cache size; let the balloon driver
      * take care of it.
@@ -394,7 +401,7 @@ int p2m_pod_empty_cache(struct domain *d)
 
         p2m->pod.count -= SUPERPAGE_PAGES;
 
-        if ( hypercall_preempt_check() )
+        if ( general_preempt_check() )
             goto out;
     }
 
@@ -405,12 +412,15 @@ int p2m_pod_empty_cache(struct domain *d)
 
         p2m->pod.count -= 1;
 
-        if ( i && !(i & 511) && hypercall_preempt_check() )
+        if ( i && !(i & 511) && general_preempt_check() )
             goto out;
     }
 
     BUG_ON(p2m->pod.count != 0);
 
+    p2m->pod.cand.nr = 0;
+    XFREE(p2m->pod.cand.ring);
+
  out:
     unlock_page_alloc(p2m);
     return p2m->pod.count ? -ERESTART : 0;
@@ -685,6 +695,25 @@ void p2m_pod_dump_data(struct domain *d)
 }
 
 
+/*
+ * Check @nr longwords, a multiple of 8 of them, for being all zero.  The
+ * wide OR accumulation avoids a conditional branch per word, letting the
+ * loads stream at close to memory bandwidth.
+ */
+static bool pod_zero_scan(const unsigned long *map, unsigned int nr)
+{
+    unsigned int i;
+
+    ASSERT(!(nr % 8));
+
+    for ( i = 0; i < nr; i += 8 )
+        if ( map[i] | map[i + 1] | map[i + 2] | map[i + 3] |
+             map[i + 4] | map[i + 5] | map[i + 6] | map[i + 7] )
+            return false;
+
+    return true;
+}
+
 /*
  * Search for all-zero superpages to be reclaimed as superpages for the
  * PoD cache. Must be called w/ pod lock held, must lock the superpage
@@ -698,7 +727,6 @@ p2m_pod_zero_check_superpage(struct p2m_domain *p2m, gfn_t gfn)
     unsigned long * map = NULL;
     int ret=0, reset = 0;
     unsigned long i, n;
-    unsigned int j;
     int max_ref = 1;
     struct domain *d = p2m->domain;
 
@@ -767,18 +795,17 @@ p2m_pod_zero_check_superpage(struct p2m_domain *p2m, gfn_t gfn)
     /* Now, do a quick check to see if it may be zero before unmapping. */
     for ( i = 0; i < SUPERPAGE_PAGES; i++ )
     {
+        bool zero;
+
         /* Quick zero-check */
         map = map_domain_page(mfn_add(mfn0, i));
 
-        for ( j = 0; j < 16; j++ )
-            if ( *(map + j) != 0 )
-                break;
+        zero = pod_zero_scan(map, 16);
 
         unmap_domain_page(map);
 
-        if ( j < 16 )
+        if ( !zero )
             goto out;
-
     }
 
     /* Try to remove the page, restoring old mapping if it fails. */
@@ -808,12 +835,7 @@ p2m_pod_zero_check_superpage(struct p2m_domain *p2m, gfn_t gfn)
     {
         map = map_domain_page(mfn_add(mfn0, i));
 
-        for ( j = 0; j < (PAGE_SIZE / sizeof(*map)); j++ )
-            if ( *(map+j) != 0 )
-            {
-                reset = 1;
-                break;
-            }
+        reset = !pod_zero_scan(map, PAGE_SIZE / sizeof(*map));
 
         unmap_domain_page(map);
 
@@ -821,7 +843,7 @@ p2m_pod_zero_check_superpage(struct p2m_domain *p2m, gfn_t gfn)
             goto out_reset;
     }
 
-    if ( tb_init_done )
+    if ( tracing_active() )
     {
         struct {
             u64 gfn, mfn;
@@ -873,7 +895,7 @@ p2m_pod_zero_check(struct p2m_domain *p2m, const gfn_t *gfns, unsigned int count
     p2m_type_t types[POD_SWEEP_STRIDE];
     unsigned long *map[POD_SWEEP_STRIDE];
     struct domain *d = p2m->domain;
-    unsigned int i, j, max_ref = 1;
+    unsigned int i, max_ref = 1;
 
     BUG_ON(count > POD_SWEEP_STRIDE);
 
@@ -913,9 +935,8 @@ p2m_pod_zero_check(struct p2m_domain *p2m, const gfn_t *gfns, unsigned int count
             continue;
 
         /* Quick zero-check */
-        for ( j = 0; j < 16; j++ )
-            if ( *(map[i] + j) != 0 )
-                goto skip;
+        if ( !pod_zero_scan(map[i], 16) )
+            goto skip;
 
         /* Try to remove the page, restoring old mapping if it fails. */
         if ( p2m_set_entry(p2m, gfns[i], INVALID_MFN, PAGE_ORDER_4K,
@@ -953,12 +974,12 @@ p2m_pod_zero_check(struct p2m_domain *p2m, const gfn_t *gfns, unsigned int count
     /* Now check each page for real */
     for ( i = 0; i < count; i++ )
     {
+        bool zero;
+
         if ( !map[i] )
             continue;
 
-        for ( j = 0; j < (PAGE_SIZE / sizeof(*map[i])); j++ )
-            if ( *(map[i] + j) != 0 )
-                break;
+        zero = pod_zero_scan(map[i], PAGE_SIZE / sizeof(*map[i]));
 
         unmap_domain_page(map[i]);
 
@@ -968,7 +989,7 @@ p2m_pod_zero_check(struct p2m_domain *p2m, const gfn_t *gfns, unsigned int count
          * See comment in p2m_pod_zero_check_superpage() re gnttab
          * check timing.
          */
-        if ( j < (PAGE_SIZE / sizeof(*map[i])) )
+        if ( !zero )
         {
             /*
              * If the previous p2m_set_entry call succeeded, this one shouldn't
@@ -984,7 +1005,7 @@ p2m_pod_zero_check(struct p2m_domain *p2m, const gfn_t *gfns, unsigned int count
         }
         else
         {
-            if ( tb_init_done )
+            if ( tracing_active() )
             {
                 struct {
                     u64 gfn, mfn;
@@ -1072,6 +1093,68 @@ p2m_pod_emergency_sweep(struct p2m_domain *p2m)
 
 }
 
+/* Keep hold of an entry falling off the MRP list as a longer-term candidate. */
+static void pod_candidate_record(struct p2m_domain *p2m, unsigned long entry)
+{
+    struct pod_candidate_list *cand = &p2m->pod.cand;
+
+    if ( !cand->ring || entry == gfn_x(INVALID_GFN) )
+        return;
+
+    cand->ring[cand->idx++] = entry;
+    cand->idx %= POD_CANDIDATE_RING;
+    if ( cand->nr < POD_CANDIDATE_RING )
+        cand->nr++;
+}
+
+/*
+ * Zero-check the accumulated candidates, oldest first, until the cache is
+ * no longer empty.  Unlike the emergency sweep this only ever visits GFNs
+ * which were actually demand-populated, so the amount of work done is
+ * bounded by the ring size rather than by the size of the p2m.
+ */
+static void
+p2m_pod_reclaim_candidates(struct p2m_domain *p2m)
+{
+    struct pod_candidate_list *cand = &p2m->pod.cand;
+    gfn_t gfns[POD_SWEEP_STRIDE];
+    unsigned int j = 0;
+
+    while ( cand->nr && p2m->pod.count == 0 )
+    {
+        unsigned int idx = (cand->idx + POD_CANDIDATE_RING - cand->nr) %
+                           POD_CANDIDATE_RING;
+        unsigned long entry = cand->ring[idx];
+
+        cand->nr--;
+
+        if ( entry & POD_LAST_SUPERPAGE )
+        {
+            gfn_t gfn = _gfn(entry & ~POD_LAST_SUPERPAGE);
+
+            if ( p2m_pod_zero_check_superpage(p2m, gfn) == 0 )
+            {
+                unsigned int x;
+
+                for ( x = 0; x < SUPERPAGE_PAGES; ++x, gfn = gfn_add(gfn, 1) )
+                    p2m_pod_zero_check(p2m, &gfn, 1);
+            }
+        }
+        else
+        {
+            gfns[j++] = _gfn(entry);
+            if ( j == POD_SWEEP_STRIDE )
+            {
+                p2m_pod_zero_check(p2m, gfns, j);
+                j = 0;
+            }
+        }
+    }
+
+    if ( j )
+        p2m_pod_zero_check(p2m, gfns, j);
+}
+
 static void pod_eager_reclaim(struct p2m_domain *p2m)
 {
     struct pod_mrp_list *mrp = &p2m->pod.mrp;
@@ -1118,6 +1201,9 @@ static void pod_eager_record(struct p2m_domain *p2m, gfn_t gfn,
 
     ASSERT(!gfn_eq(gfn, INVALID_GFN));
 
+    /* The entry being evicted remains a reclaim candidate. */
+    pod_candidate_record(p2m, mrp->list[mrp->idx]);
+
     mrp->list[mrp->idx++] =
         gfn_x(gfn) | (order == PAGE_ORDER_2M ? POD_LAST_SUPERPAGE : 0);
     mrp->idx %= ARRAY_SIZE(mrp->list);
@@ -1170,9 +1256,14 @@ p2m_pod_demand_populate(struct p2m_domain *p2m, gfn_t gfn,
         pod_eager_reclaim(p2m);
 
     /*
-     * Only sweep if we're actually out of memory.  Doing anything else
-     * causes unnecessary time and fragmentation of superpages in the p2m.
+     * Only reclaim further if we're actually out of memory.  Doing anything
+     * else causes unnecessary time and fragmentation of superpages in the
+     * p2m.  Try the accumulated candidates first; the linear sweep remains
+     * the last resort.
      */
+    if ( p2m->pod.count == 0 )
+        p2m_pod_reclaim_candidates(p2m);
+
     if ( p2m->pod.count == 0 )
         p2m_pod_emergency_sweep(p2m);
 
@@ -1212,7 +1303,7 @@ p2m_pod_demand_populate(struct p2m_domain *p2m, gfn_t gfn,
 
     pod_eager_record(p2m, gfn_aligned, order);
 
-    if ( tb_init_done )
+    if ( tracing_active() )
     {
         struct {
             u64 gfn, mfn;
@@ -1255,7 +1346,7 @@ remap_and_retry:
                        p2m_populate_on_demand, p2m->default_access) )
         return false;
 
-    if ( tb_init_done )
+    if ( tracing_active() )
     {
         struct {
             u64 gfn;
@@ -557,7 +557,7 @@ p2m_pt_set_entry(struct p2m_domain *p2m, gfn_t gfn_, mfn_t mfn,
     if ( !sve )
         return -EOPNOTSUPP;
 
-    if ( tb_init_done )
+    if ( tracing_active() )
     {
         struct {
             u64 gfn, mfn;
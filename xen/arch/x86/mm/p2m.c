@@ -27,6 +27,7 @@
 #include <xen/iommu.h>
 #include <xen/vm_event.h>
 #include <xen/event.h>
+#include <xen/perfc.h>
 #include <public/vm_event.h>
 #include <asm/domain.h>
 #include <asm/page.h>
@@ -136,6 +137,11 @@ static void p2m_free_one(struct p2m_domain *p2m)
     xfree(p2m);
 }
 
+#ifdef CONFIG_HVM
+static void p2m_promote_timer_fn(void *data);
+static void p2m_promote_tasklet_fn(unsigned long data);
+#endif
+
 static int p2m_init_hostp2m(struct domain *d)
 {
     struct p2m_domain *p2m = p2m_init_one(d);
@@ -147,7 +153,14 @@ static int p2m_init_hostp2m(struct domain *d)
     rc = p2m_init_logdirty(p2m);
 
     if ( !rc )
+    {
+#ifdef CONFIG_HVM
+        init_timer(&p2m->promote_timer, p2m_promote_timer_fn, d, 0);
+        softirq_tasklet_init(&p2m->promote_tasklet, p2m_promote_tasklet_fn,
+                             (unsigned long)d);
+#endif
         d->arch.p2m = p2m;
+    }
     else
         p2m_free_one(p2m);
 
@@ -161,6 +174,11 @@ static void p2m_teardown_hostp2m(struct domain *d)
 
     if ( p2m )
     {
+#ifdef CONFIG_HVM
+        p2m->promote_enabled = false;
+        kill_timer(&p2m->promote_timer);
+        tasklet_kill(&p2m->promote_tasklet);
+#endif
         p2m_free_one(p2m);
         d->arch.p2m = NULL;
     }
@@ -301,6 +319,7 @@ void p2m_change_entry_type_global(struct domain *d,
     ASSERT(p2m_is_changeable(ot) && p2m_is_changeable(nt));
 
     p2m_lock(hostp2m);
+    hostp2m->defer_nested_flush = 1;
 
     change_entry_type_global(hostp2m, ot, nt);
 
@@ -321,6 +340,14 @@ void p2m_change_entry_type_global(struct domain *d,
     }
 #endif
 
+    /*
+     * As in p2m_change_type_range(): flush the nested p2ms once at the
+     * end instead of once per rewritten entry.
+     */
+    hostp2m->defer_nested_flush = 0;
+    if ( nestedhvm_enabled(d) )
+        p2m_flush_nestedp2m(d);
+
     p2m_unlock(hostp2m);
 }
 
@@ -767,6 +794,107 @@ void p2m_final_teardown(struct domain *d)
     p2m_teardown_hostp2m(d);
 }
 
+#ifdef CONFIG_HVM
+/*
+ * Background superpage promotion.
+ *
+ * Ballooning, grant mappings and migration shatter 2M p2m entries into 4k
+ * ones, and nothing ever re-assembles them, so long-lived guests slowly
+ * degrade towards all-4k mappings and longer EPT/NPT walks.  When enabled
+ * via XEN_DOMCTL_superpage_promotion, a per-domain timer periodically scans
+ * a bounded chunk of the p2m for runs of 512 physically contiguous, aligned,
+ * identically typed 4k RAM entries and rewrites each such run as a single 2M
+ * entry.  Only runs which are already contiguous are promoted; guest pages
+ * are never relocated.
+ */
+
+/* 2M regions inspected per timer tick, and the tick interval. */
+#define PROMOTE_CHUNK     256
+#define PROMOTE_INTERVAL  MILLISECS(100)
+
+static bool p2m_promote_one(struct p2m_domain *p2m, gfn_t gfn)
+{
+    mfn_t mfn0, mfn;
+    p2m_type_t t0, t;
+    p2m_access_t a0, a;
+    unsigned int order;
+    unsigned long i;
+
+    ASSERT(gfn_locked_by_me(p2m, gfn));
+
+    mfn0 = p2m->get_entry(p2m, gfn, &t0, &a0, 0, &order, NULL);
+    if ( order != PAGE_ORDER_4K || t0 != p2m_ram_rw || !mfn_valid(mfn0) ||
+         (mfn_x(mfn0) & ((1UL << PAGE_ORDER_2M) - 1)) )
+        return false;
+
+    for ( i = 1; i < (1UL << PAGE_ORDER_2M); i++ )
+    {
+        mfn = p2m->get_entry(p2m, gfn_add(gfn, i), &t, &a, 0, &order, NULL);
+        if ( order != PAGE_ORDER_4K || t != t0 || a != a0 ||
+             !mfn_eq(mfn, mfn_add(mfn0, i)) )
+            return false;
+    }
+
+    return p2m_set_entry(p2m, gfn, mfn0, PAGE_ORDER_2M, t0, a0) == 0;
+}
+
+static void p2m_promote_tasklet_fn(unsigned long data)
+{
+    struct domain *d = (void *)data;
+    struct p2m_domain *p2m = p2m_get_hostp2m(d);
+    unsigned long gfn;
+    unsigned int i;
+
+    if ( !p2m->promote_enabled || d->is_dying )
+        return;
+
+    gfn = p2m->promote_gfn & ~((1UL << PAGE_ORDER_2M) - 1);
+
+    for ( i = 0; i < PROMOTE_CHUNK; i++, gfn += 1UL << PAGE_ORDER_2M )
+    {
+        if ( gfn > p2m->max_mapped_pfn )
+        {
+            gfn = 0;
+            break;
+        }
+
+        gfn_lock(p2m, _gfn(gfn), PAGE_ORDER_2M);
+        if ( p2m_promote_one(p2m, _gfn(gfn)) )
+            perfc_incr(p2m_promote_2m);
+        gfn_unlock(p2m, _gfn(gfn), PAGE_ORDER_2M);
+    }
+
+    p2m->promote_gfn = gfn;
+    set_timer(&p2m->promote_timer, NOW() + PROMOTE_INTERVAL);
+}
+
+static void p2m_promote_timer_fn(void *data)
+{
+    struct p2m_domain *p2m = p2m_get_hostp2m((struct domain *)data);
+
+    tasklet_schedule(&p2m->promote_tasklet);
+}
+
+int p2m_promote_enable(struct domain *d, bool enable)
+{
+    struct p2m_domain *p2m = p2m_get_hostp2m(d);
+
+    /* Shattered entries only exist with HAP; shadow rebuilds its own. */
+    if ( !is_hvm_domain(d) || !hap_enabled(d) )
+        return -EOPNOTSUPP;
+
+    if ( p2m->promote_enabled == enable )
+        return 0;
+
+    p2m->promote_enabled = enable;
+    if ( enable )
+        set_timer(&p2m->promote_timer, NOW() + PROMOTE_INTERVAL);
+    else
+        stop_timer(&p2m->promote_timer);
+
+    return 0;
+}
+#endif /* CONFIG_HVM */
 
 static int
 p2m_remove_page(struct p2m_domain *p2m, unsigned long gfn_l, unsigned long mfn,
@@ -1900,6 +2028,38 @@ p2m_getlru_nestedp2m(struct domain *d, struct p2m_domain *p2m)
     return p2m;
 }
 
+/*
+ * Pick a victim np2m for reuse.  Prefer the least recently used np2m
+ * which no vCPU is currently running on (empty dirty_cpumask):
+ * stealing a table that is live on another vCPU has both vCPUs
+ * endlessly rebuilding each other's translations, whereas an idle
+ * table can be recycled without disturbing anybody ("sticky" per-vCPU
+ * assignment).  Fall back to the plain LRU tail when every table is in
+ * active use.  Caller holds the nestedp2m lock.
+ */
+static struct p2m_domain *
+p2m_getlru_idle_nestedp2m(struct domain *d)
+{
+    struct list_head *lru_list = &p2m_get_hostp2m(d)->np2m_list;
+    struct p2m_domain *p2m, *victim = NULL;
+
+    ASSERT(!list_empty(lru_list));
+
+    list_for_each_entry_reverse(p2m, lru_list, np2m_list)
+        if ( cpumask_empty(p2m->dirty_cpumask) )
+        {
+            victim = p2m;
+            break;
+        }
+
+    if ( victim == NULL )
+        victim = list_entry(lru_list->prev, struct p2m_domain, np2m_list);
+
+    list_move(&victim->np2m_list, lru_list);
+
+    return victim;
+}
+
 static void
 p2m_flush_table_locked(struct p2m_domain *p2m)
 {
@@ -2066,9 +2226,9 @@ p2m_get_nestedp2m_locked(struct vcpu *v)
         p2m_unlock(p2m);
     }
 
-    /* All p2m's are or were in use. Take the least recent used one,
-     * flush it and reuse. */
-    p2m = p2m_getlru_nestedp2m(d, NULL);
+    /* All p2m's are or were in use.  Take an idle one if possible, or
+     * failing that the least recently used one, flush it and reuse. */
+    p2m = p2m_getlru_idle_nestedp2m(d);
     p2m_flush_table(p2m);
     p2m_lock(p2m);
 
@@ -2354,6 +2514,7 @@ bool_t p2m_switch_vcpu_altp2m_by_id(struct vcpu *v, unsigned int idx)
     {
         if ( idx != vcpu_altp2m(v).p2midx )
         {
+            perfc_incra(altp2m_switch_view, idx);
             atomic_dec(&p2m_get_altp2m(v)->active_vcpus);
             vcpu_altp2m(v).p2midx = idx;
             atomic_inc(&p2m_get_altp2m(v)->active_vcpus);
@@ -2888,39 +3049,13 @@ out_p2m_audit:
  *
  * Returns: 0 ==> success
  */
-int p2m_add_foreign(struct domain *tdom, unsigned long fgfn,
-                    unsigned long gpfn, domid_t foreigndom)
+static int p2m_add_foreign_one(struct domain *tdom, struct domain *fdom,
+                               unsigned long fgfn, unsigned long gpfn)
 {
     p2m_type_t p2mt, p2mt_prev;
     mfn_t prev_mfn, mfn;
     struct page_info *page;
     int rc;
-    struct domain *fdom;
-
-    ASSERT(tdom);
-    if ( foreigndom == DOMID_SELF )
-        return -EINVAL;
-    /*
-     * hvm fixme: until support is added to p2m teardown code to cleanup any
-     * foreign entries, limit this to hardware domain only.
-     */
-    if ( !is_hardware_domain(tdom) )
-        return -EPERM;
-
-    if ( foreigndom == DOMID_XEN )
-        fdom = rcu_lock_domain(dom_xen);
-    else
-        fdom = rcu_lock_domain_by_id(foreigndom);
-    if ( fdom == NULL )
-        return -ESRCH;
-
-    rc = -EINVAL;
-    if ( tdom == fdom )
-        goto out;
-
-    rc = xsm_map_gmfn_foreign(XSM_TARGET, tdom, fdom);
-    if ( rc )
-        goto out;
 
     /*
      * Take a refcnt on the mfn. NB: following supported for foreign mapping:
@@ -2932,8 +3067,7 @@ int p2m_add_foreign(struct domain *tdom, unsigned long fgfn,
     {
         if ( page )
             put_page(page);
-        rc = -EINVAL;
-        goto out;
+        return -EINVAL;
     }
     mfn = page_to_mfn(page);
 
@@ -2971,9 +3105,168 @@ int p2m_add_foreign(struct domain *tdom, unsigned long fgfn,
      */
     put_gfn(tdom, gpfn);
 
-out:
-    if ( fdom )
-        rcu_unlock_domain(fdom);
+    return rc;
+}
+
+/*
+ * Try to cover a 2M aligned, contiguous run of foreign frames with a single
+ * superpage p2m entry.
+ *
+ * Returns: 0 ==> success
+ *          1 ==> a superpage cannot be used here (foreign range not backed
+ *                by contiguous RAM, target range not empty, ...); the caller
+ *                is expected to fall back to 4k mappings
+ *          -errno otherwise
+ */
+static int p2m_add_foreign_2m(struct domain *tdom, struct domain *fdom,
+                              unsigned long fgfn, unsigned long gpfn)
+{
+    struct p2m_domain *p2m = p2m_get_hostp2m(tdom);
+    unsigned long i, nr = 1UL << PAGE_ORDER_2M;
+    mfn_t mfn = INVALID_MFN;
+    p2m_type_t p2mt;
+    int rc = 0;
+
+    /*
+     * Take a refcnt on every frame of the run, checking that the foreign
+     * p2m range is backed by an aligned, contiguous block of plain RAM.
+     */
+    for ( i = 0; i < nr; i++ )
+    {
+        struct page_info *page = get_page_from_gfn(fdom, fgfn + i, &p2mt,
+                                                   P2M_ALLOC);
+
+        if ( !page ||
+             !p2m_is_ram(p2mt) || p2m_is_shared(p2mt) || p2m_is_hole(p2mt) )
+        {
+            if ( page )
+                put_page(page);
+            rc = 1;
+            break;
+        }
+
+        if ( !i )
+        {
+            mfn = page_to_mfn(page);
+            if ( mfn_x(mfn) & (nr - 1) )
+            {
+                put_page(page);
+                rc = 1;
+                break;
+            }
+        }
+        else if ( !mfn_eq(page_to_mfn(page), mfn_add(mfn, i)) )
+        {
+            put_page(page);
+            rc = 1;
+            break;
+        }
+    }
+
+    if ( rc )
+    {
+        while ( i-- )
+            put_page(mfn_to_page(mfn_add(mfn, i)));
+        return rc;
+    }
+
+    /*
+     * Unlike the 4k path, require the whole target range to be empty:
+     * replacing existing mappings would need the per-page removal logic
+     * of p2m_add_foreign_one(), defeating the point of a superpage.
+     */
+    p2m_lock(p2m);
+
+    for ( i = 0; i < nr; i++ )
+    {
+        p2m_access_t a;
+        p2m_type_t ot;
+        mfn_t omfn = p2m->get_entry(p2m, _gfn(gpfn + i), &ot, &a, 0, NULL,
+                                    NULL);
+
+        if ( mfn_valid(omfn) || p2m_is_paging(ot) || p2m_is_pod(ot) )
+        {
+            rc = 1;
+            break;
+        }
+    }
+
+    if ( !rc )
+    {
+        rc = set_typed_p2m_entry(tdom, gpfn, mfn, PAGE_ORDER_2M,
+                                 p2m_map_foreign, p2m->default_access);
+        /* Shattered target range: just fall back to 4k mappings. */
+        if ( rc > 0 )
+            rc = 1;
+    }
+
+    p2m_unlock(p2m);
+
+    /*
+     * On success the p2m entry holds its own reference on every frame
+     * (taken in p2m_entry_modify()), so the transient ones can go in
+     * either case.
+     */
+    for ( i = 0; i < nr; i++ )
+        put_page(mfn_to_page(mfn_add(mfn, i)));
+
+    return rc;
+}
+
+int p2m_add_foreign(struct domain *tdom, unsigned long fgfn,
+                    unsigned long gpfn, domid_t foreigndom,
+                    unsigned int order)
+{
+    struct domain *fdom;
+    int rc;
+
+    ASSERT(tdom);
+    if ( foreigndom == DOMID_SELF )
+        return -EINVAL;
+    /*
+     * hvm fixme: until support is added to p2m teardown code to cleanup any
+     * foreign entries, limit this to hardware domain only.
+     */
+    if ( !is_hardware_domain(tdom) )
+        return -EPERM;
+
+    if ( order && (order != PAGE_ORDER_2M ||
+                   ((fgfn | gpfn) & ((1UL << order) - 1))) )
+        return -EINVAL;
+
+    if ( foreigndom == DOMID_XEN )
+        fdom = rcu_lock_domain(dom_xen);
+    else
+        fdom = rcu_lock_domain_by_id(foreigndom);
+    if ( fdom == NULL )
+        return -ESRCH;
+
+    rc = -EINVAL;
+    if ( tdom == fdom )
+        goto out;
+
+    rc = xsm_map_gmfn_foreign(XSM_TARGET, tdom, fdom);
+    if ( rc )
+        goto out;
+
+    if ( order )
+    {
+        unsigned long i;
+
+        rc = p2m_add_foreign_2m(tdom, fdom, fgfn, gpfn);
+        if ( rc <= 0 )
+            goto out;
+
+        /* No superpage possible - fall back to a run of 4k mappings. */
+        rc = 0;
+        for ( i = 0; !rc && i < (1UL << order); i++ )
+            rc = p2m_add_foreign_one(tdom, fdom, fgfn + i, gpfn + i);
+    }
+    else
+        rc = p2m_add_foreign_one(tdom, fdom, fgfn, gpfn);
+
+ out:
+    rcu_unlock_domain(fdom);
     return rc;
 }
 
@@ -21,6 +21,8 @@
 
 #include <xen/init.h>
 #include <xen/guest_access.h>
+#include <xen/iommu.h>
+#include <xen/vmap.h>
 #include <asm/paging.h>
 #include <asm/shadow.h>
 #include <asm/p2m.h>
@@ -116,6 +118,9 @@ static int paging_free_log_dirty_bitmap(struct domain *d, int rc)
 
     if ( !mfn_valid(d->arch.paging.log_dirty.top) )
     {
+        vfree(d->arch.paging.log_dirty.list.pfns);
+        memset(&d->arch.paging.log_dirty.list, 0,
+               sizeof(d->arch.paging.log_dirty.list));
         paging_unlock(d);
         return 0;
     }
@@ -161,7 +166,7 @@ static int paging_free_log_dirty_bitmap(struct domain *d, int rc)
             paging_free_log_dirty_page(d, l3[i3]);
             l3[i3] = INVALID_MFN;
 
-            if ( i3 < LOGDIRTY_NODE_ENTRIES - 1 && hypercall_preempt_check() )
+            if ( i3 < LOGDIRTY_NODE_ENTRIES - 1 && general_preempt_check() )
             {
                 d->arch.paging.preempt.log_dirty.i3 = i3 + 1;
                 d->arch.paging.preempt.log_dirty.i4 = i4;
@@ -176,7 +181,7 @@ static int paging_free_log_dirty_bitmap(struct domain *d, int rc)
         paging_free_log_dirty_page(d, l4[i4]);
         l4[i4] = INVALID_MFN;
 
-        if ( i4 < LOGDIRTY_NODE_ENTRIES - 1 && hypercall_preempt_check() )
+        if ( i4 < LOGDIRTY_NODE_ENTRIES - 1 && general_preempt_check() )
         {
             d->arch.paging.preempt.log_dirty.i3 = 0;
             d->arch.paging.preempt.log_dirty.i4 = i4 + 1;
@@ -195,6 +200,10 @@ static int paging_free_log_dirty_bitmap(struct domain *d, int rc)
         ASSERT(d->arch.paging.log_dirty.allocs == 0);
         d->arch.paging.log_dirty.failed_allocs = 0;
 
+        vfree(d->arch.paging.log_dirty.list.pfns);
+        memset(&d->arch.paging.log_dirty.list, 0,
+               sizeof(d->arch.paging.log_dirty.list));
+
         rc = -d->arch.paging.preempt.log_dirty.done;
         d->arch.paging.preempt.dom = NULL;
     }
@@ -322,10 +331,20 @@ void paging_mark_pfn_dirty(struct domain *d, pfn_t pfn)
     unmap_domain_page(l1);
     if ( changed )
     {
+        struct log_dirty_domain *ld = &d->arch.paging.log_dirty;
+
         PAGING_DEBUG(LOGDIRTY,
                      "d%d: marked mfn %" PRI_mfn " (pfn %" PRI_pfn ")\n",
                      d->domain_id, mfn_x(mfn), pfn_x(pfn));
-        d->arch.paging.log_dirty.dirty_count++;
+        ld->dirty_count++;
+
+        if ( ld->list.pfns )
+        {
+            if ( ld->list.count < ld->list.size )
+                ld->list.pfns[ld->list.count++] = pfn_x(pfn);
+            else
+                ld->list.full = 1;
+        }
     }
 
 out:
@@ -396,6 +415,44 @@ int paging_mfn_is_dirty(struct domain *d, mfn_t gmfn)
 }
 
 
+/* Clear a single pfn's bit in the log-dirty bitmap, if it is set. */
+static void paging_clear_pfn_dirty(struct domain *d, pfn_t pfn)
+{
+    mfn_t mfn, *l4, *l3, *l2;
+    unsigned long *l1;
+
+    ASSERT(paging_locked_by_me(d));
+
+    if ( unlikely(!VALID_M2P(pfn_x(pfn))) )
+        return;
+
+    mfn = d->arch.paging.log_dirty.top;
+    if ( !mfn_valid(mfn) )
+        return;
+
+    l4 = map_domain_page(mfn);
+    mfn = l4[L4_LOGDIRTY_IDX(pfn)];
+    unmap_domain_page(l4);
+    if ( !mfn_valid(mfn) )
+        return;
+
+    l3 = map_domain_page(mfn);
+    mfn = l3[L3_LOGDIRTY_IDX(pfn)];
+    unmap_domain_page(l3);
+    if ( !mfn_valid(mfn) )
+        return;
+
+    l2 = map_domain_page(mfn);
+    mfn = l2[L2_LOGDIRTY_IDX(pfn)];
+    unmap_domain_page(l2);
+    if ( !mfn_valid(mfn) )
+        return;
+
+    l1 = map_domain_page(mfn);
+    __clear_bit(L1_LOGDIRTY_IDX(pfn), l1);
+    unmap_domain_page(l1);
+}
+
 /* Read a domain's log-dirty bitmap and stats.  If the operation is a CLEAN,
  * clear the bitmap and stats as well. */
 static int paging_log_dirty_op(struct domain *d,
@@ -405,9 +462,17 @@ static int paging_log_dirty_op(struct domain *d,
     int rv = 0, clean = 0, peek = 1;
     unsigned long pages = 0;
     mfn_t *l4 = NULL, *l3 = NULL, *l2 = NULL;
-    unsigned long *l1 = NULL;
+    unsigned long *l1 = NULL, *dirty_buf;
     int i4, i3, i2;
 
+    /*
+     * Bounce page for the bitmap contents, so that the bulk of the copying
+     * to the caller happens without the paging lock held.
+     */
+    dirty_buf = alloc_xenheap_page();
+    if ( !dirty_buf )
+        return -ENOMEM;
+
     if ( !resuming )
     {
         /*
@@ -426,6 +491,10 @@ static int paging_log_dirty_op(struct domain *d,
          * it's not possible to have any new dirty pages.
          */
         p2m_flush_hardware_cached_dirty(d);
+
+        /* Likewise pull DMA-dirtied pages out of the IOMMU page tables. */
+        if ( has_iommu_pt(d) )
+            iommu_sync_dirty_log(d);
     }
 
     paging_lock(d);
@@ -439,6 +508,7 @@ static int paging_log_dirty_op(struct domain *d,
         paging_unlock(d);
         ASSERT(!resuming);
         domain_unpause(d);
+        free_xenheap_page(dirty_buf);
         return -EBUSY;
     }
 
@@ -482,29 +552,61 @@ static int paging_log_dirty_op(struct domain *d,
                   i2++ )
             {
                 unsigned int bytes = PAGE_SIZE;
+                bool_t have_l1 = 0;
+
                 l1 = ((l2 && mfn_valid(l2[i2])) ?
                       map_domain_page(l2[i2]) : NULL);
                 if ( unlikely(((sc->pages - pages + 7) >> 3) < bytes) )
                     bytes = (unsigned int)((sc->pages - pages + 7) >> 3);
+                if ( l1 )
+                {
+                    if ( clean )
+                    {
+                        unsigned int w;
+
+                        /*
+                         * Atomically grab-and-clear, so that dirty marks
+                         * arriving while the lock is dropped below either
+                         * make it into the snapshot or survive in the
+                         * bitmap for the next pass, but can't get lost.
+                         */
+                        for ( w = 0; w < PAGE_SIZE / sizeof(*l1); ++w )
+                            dirty_buf[w] = xchg(&l1[w], 0);
+                    }
+                    else
+                        memcpy(dirty_buf, l1, PAGE_SIZE);
+                    unmap_domain_page(l1);
+                    l1 = NULL;
+                    have_l1 = 1;
+                }
                 if ( likely(peek) )
                 {
-                    if ( (l1 ? copy_to_guest_offset(sc->dirty_bitmap,
-                                                    pages >> 3, (uint8_t *)l1,
-                                                    bytes)
-                             : clear_guest_offset(sc->dirty_bitmap,
-                                                  pages >> 3, bytes)) != 0 )
+                    int err;
+
+                    /*
+                     * Copying out can fault on the caller's buffer, and
+                     * hence take a while; don't hold up other users of
+                     * the paging lock.  The preempt machinery keeps
+                     * concurrent log-dirty operations away, the domain is
+                     * paused, and bitmap trie nodes are never freed while
+                     * log dirty mode is enabled, so the mapped upper
+                     * levels stay valid across the unlocked section.
+                     */
+                    paging_unlock(d);
+                    err = (have_l1 ? copy_to_guest_offset(sc->dirty_bitmap,
+                                                          pages >> 3,
+                                                          (uint8_t *)dirty_buf,
+                                                          bytes)
+                                   : clear_guest_offset(sc->dirty_bitmap,
+                                                        pages >> 3, bytes));
+                    paging_lock(d);
+                    if ( err != 0 )
                     {
                         rv = -EFAULT;
                         goto out;
                     }
                 }
                 pages += bytes << 3;
-                if ( l1 )
-                {
-                    if ( clean )
-                        clear_page(l1);
-                    unmap_domain_page(l1);
-                }
             }
             if ( l2 )
                 unmap_domain_page(l2);
@@ -550,6 +652,7 @@ static int paging_log_dirty_op(struct domain *d,
     }
 
     paging_unlock(d);
+    free_xenheap_page(dirty_buf);
 
     if ( rv )
     {
@@ -573,6 +676,7 @@ static int paging_log_dirty_op(struct domain *d,
     d->arch.paging.preempt.dom = NULL;
     paging_unlock(d);
     domain_unpause(d);
+    free_xenheap_page(dirty_buf);
 
     if ( l1 )
         unmap_domain_page(l1);
@@ -586,6 +690,120 @@ static int paging_log_dirty_op(struct domain *d,
     return rv;
 }
 
+/*
+ * Capacity of the dirty pfn list: 256k entries (2MB of xenheap) cover 1GB
+ * of dirtied 4k pages per round; beyond that the bitmap path wins anyway.
+ */
+#define PAGING_DIRTY_LIST_ENTRIES (256 * 1024)
+
+/*
+ * Hand the list of pfns dirtied since the last round to the caller and
+ * clean the log for the next one, at a cost proportional to the dirty set
+ * rather than to the guest size.  When the list (or the caller's buffer)
+ * was too small, the caller is redirected to the bitmap path via -ENOBUFS,
+ * with all information still present in the bitmap.
+ */
+static int paging_log_dirty_op_list(struct domain *d,
+                                    struct xen_domctl_shadow_op *sc)
+{
+    struct log_dirty_domain *ld = &d->arch.paging.log_dirty;
+    unsigned long count;
+    unsigned int i;
+
+    /* See paging_log_dirty_op() for the mark-dirty and flush rationale. */
+    if ( is_hvm_domain(d) &&
+         (sc->mode & XEN_DOMCTL_SHADOW_LOGDIRTY_FINAL) )
+        hvm_mapped_guest_frames_mark_dirty(d);
+
+    domain_pause(d);
+    p2m_flush_hardware_cached_dirty(d);
+    if ( has_iommu_pt(d) )
+        iommu_sync_dirty_log(d);
+
+    if ( !ld->list.pfns )
+    {
+        /*
+         * Arm the list; this round still has to use the bitmap.  Shadow op
+         * domctls are serialized, so there is no arming race to consider.
+         */
+        unsigned long *pfns = vzalloc(PAGING_DIRTY_LIST_ENTRIES *
+                                      sizeof(*pfns));
+        int rv = -ENOMEM;
+
+        if ( pfns )
+        {
+            paging_lock(d);
+            ld->list.pfns = pfns;
+            ld->list.size = PAGING_DIRTY_LIST_ENTRIES;
+            ld->list.count = 0;
+            ld->list.full = 0;
+            paging_unlock(d);
+            rv = -ENODATA;
+        }
+
+        domain_unpause(d);
+        return rv;
+    }
+
+    paging_lock(d);
+
+    if ( d->arch.paging.preempt.dom )
+    {
+        paging_unlock(d);
+        domain_unpause(d);
+        return -EBUSY;
+    }
+
+    sc->stats.fault_count = ld->fault_count;
+    sc->stats.dirty_count = ld->dirty_count;
+
+    count = ld->list.count;
+    if ( ld->list.full || count > sc->pages )
+    {
+        /* Restart the list; the bitmap still has every bit for OP_CLEAN. */
+        ld->list.count = 0;
+        ld->list.full = 0;
+        paging_unlock(d);
+        domain_unpause(d);
+        return -ENOBUFS;
+    }
+
+    /*
+     * Copy the list out with the lock dropped - the caller's buffer may
+     * fault.  It cannot change underneath us: the domain is paused and
+     * shadow op domctls are serialized.
+     */
+    paging_unlock(d);
+    BUILD_BUG_ON(sizeof(*ld->list.pfns) != sizeof(uint64_t));
+    if ( copy_to_guest_offset(sc->dirty_bitmap, 0, (uint8_t *)ld->list.pfns,
+                              count * sizeof(*ld->list.pfns)) )
+    {
+        /* Leave everything in place for a retry or a bitmap CLEAN. */
+        domain_unpause(d);
+        return -EFAULT;
+    }
+
+    paging_lock(d);
+
+    for ( i = 0; i < count; i++ )
+        paging_clear_pfn_dirty(d, _pfn(ld->list.pfns[i]));
+
+    ld->list.count = 0;
+    ld->fault_count = 0;
+    ld->dirty_count = 0;
+
+    paging_unlock(d);
+
+    sc->pages = count;
+
+    /* Safe because the domain is paused. */
+    ld->ops->clean(d);
+
+    domain_unpause(d);
+
+    return 0;
+}
+
 void paging_log_dirty_range(struct domain *d,
                            unsigned long begin_pfn,
                            unsigned long nr,
@@ -739,6 +957,11 @@ int paging_domctl(struct domain *d, struct xen_domctl_shadow_op *sc,
         if ( sc->mode & ~XEN_DOMCTL_SHADOW_LOGDIRTY_FINAL )
             return -EINVAL;
         return paging_log_dirty_op(d, sc, resuming);
+
+    case XEN_DOMCTL_SHADOW_OP_CLEAN_LIST:
+        if ( sc->mode & ~XEN_DOMCTL_SHADOW_LOGDIRTY_FINAL )
+            return -EINVAL;
+        return paging_log_dirty_op_list(d, sc);
     }
 
     /* Here, dispatch domctl to the appropriate paging code */
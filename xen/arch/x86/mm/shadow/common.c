@@ -44,6 +44,17 @@ static int sh_enable_log_dirty(struct domain *, bool log_global);
 static int sh_disable_log_dirty(struct domain *);
 static void sh_clean_dirty_bitmap(struct domain *);
 
+#if (SHADOW_OPTIMIZATIONS & SHOPT_OUT_OF_SYNC)
+/*
+ * Number of out-of-sync page slots actually used per vcpu, bounded by
+ * SHADOW_OOS_PAGES.  More slots let fork-heavy guests keep more L1s out
+ * of sync instead of thrashing evict/resync cycles, at the price of one
+ * snapshot page per slot per vcpu.  Primes hash best.
+ */
+static unsigned int __read_mostly shadow_oos_pages = 3;
+integer_param("shadow-oos-pages", shadow_oos_pages);
+#endif
+
 /* Set up the shadow-specific parts of a domain struct at start of day.
  * Called for every domain from arch_domain_create() */
 int shadow_domain_init(struct domain *d, unsigned int domcr_flags)
@@ -63,6 +74,10 @@ int shadow_domain_init(struct domain *d, unsigned int domcr_flags)
 #if (SHADOW_OPTIMIZATIONS & SHOPT_OUT_OF_SYNC)
     d->arch.paging.shadow.oos_active = 0;
     d->arch.paging.shadow.oos_off = domcr_flags & XEN_DOMCTL_CDF_oos_off;
+
+    /* Sanitise the command line setting before its first use. */
+    if ( !shadow_oos_pages || shadow_oos_pages > SHADOW_OOS_PAGES )
+        shadow_oos_pages = shadow_oos_pages ? SHADOW_OOS_PAGES : 1;
 #endif
     d->arch.paging.shadow.pagetable_dying_op = 0;
 
@@ -266,14 +281,14 @@ static void sh_oos_audit(struct domain *d)
 
     for_each_vcpu(d, v)
     {
-        for ( idx = 0; idx < SHADOW_OOS_PAGES; idx++ )
+        for ( idx = 0; idx < shadow_oos_pages; idx++ )
         {
             mfn_t *oos = v->arch.paging.shadow.oos;
             if ( !mfn_valid(oos[idx]) )
                 continue;
 
-            expected_idx = mfn_x(oos[idx]) % SHADOW_OOS_PAGES;
-            expected_idx_alt = ((expected_idx + 1) % SHADOW_OOS_PAGES);
+            expected_idx = mfn_x(oos[idx]) % shadow_oos_pages;
+            expected_idx_alt = ((expected_idx + 1) % shadow_oos_pages);
             if ( idx != expected_idx && idx != expected_idx_alt )
             {
                 printk("%s: idx %x contains gmfn %lx, expected at %x or %x.\n",
@@ -316,9 +331,9 @@ void oos_audit_hash_is_present(struct domain *d, mfn_t gmfn)
     for_each_vcpu(d, v)
     {
         oos = v->arch.paging.shadow.oos;
-        idx = mfn_x(gmfn) % SHADOW_OOS_PAGES;
+        idx = mfn_x(gmfn) % shadow_oos_pages;
         if ( !mfn_eq(oos[idx], gmfn) )
-            idx = (idx + 1) % SHADOW_OOS_PAGES;
+            idx = (idx + 1) % shadow_oos_pages;
 
         if ( mfn_eq(oos[idx], gmfn) )
             return;
@@ -388,9 +403,9 @@ void oos_fixup_add(struct domain *d, mfn_t gmfn,
     {
         oos = v->arch.paging.shadow.oos;
         oos_fixup = v->arch.paging.shadow.oos_fixup;
-        idx = mfn_x(gmfn) % SHADOW_OOS_PAGES;
+        idx = mfn_x(gmfn) % shadow_oos_pages;
         if ( !mfn_eq(oos[idx], gmfn) )
-            idx = (idx + 1) % SHADOW_OOS_PAGES;
+            idx = (idx + 1) % shadow_oos_pages;
         if ( mfn_eq(oos[idx], gmfn) )
         {
             int i;
@@ -471,7 +486,7 @@ static int oos_remove_write_access(struct vcpu *v, mfn_t gmfn,
 
 static inline void trace_resync(int event, mfn_t gmfn)
 {
-    if ( tb_init_done )
+    if ( tracing_active() )
     {
         /* Convert gmfn to gfn */
         unsigned long gfn = mfn_to_gfn(current->domain, gmfn);
@@ -527,17 +542,17 @@ static void oos_hash_add(struct vcpu *v, mfn_t gmfn)
     for (i = 0; i < SHADOW_OOS_FIXUPS; i++ )
         fixup.smfn[i] = INVALID_MFN;
 
-    idx = mfn_x(gmfn) % SHADOW_OOS_PAGES;
+    idx = mfn_x(gmfn) % shadow_oos_pages;
     oidx = idx;
 
     if ( mfn_valid(oos[idx])
-         && (mfn_x(oos[idx]) % SHADOW_OOS_PAGES) == idx )
+         && (mfn_x(oos[idx]) % shadow_oos_pages) == idx )
     {
         /* Punt the current occupant into the next slot */
         SWAP(oos[idx], gmfn);
         SWAP(oos_fixup[idx], fixup);
         swap = 1;
-        idx = (idx + 1) % SHADOW_OOS_PAGES;
+        idx = (idx + 1) % shadow_oos_pages;
     }
     if ( mfn_valid(oos[idx]) )
    {
@@ -570,9 +585,9 @@ static void oos_hash_remove(struct domain *d, mfn_t gmfn)
     for_each_vcpu(d, v)
     {
         oos = v->arch.paging.shadow.oos;
-        idx = mfn_x(gmfn) % SHADOW_OOS_PAGES;
+        idx = mfn_x(gmfn) % shadow_oos_pages;
         if ( !mfn_eq(oos[idx], gmfn) )
-            idx = (idx + 1) % SHADOW_OOS_PAGES;
+            idx = (idx + 1) % shadow_oos_pages;
         if ( mfn_eq(oos[idx], gmfn) )
         {
             oos[idx] = INVALID_MFN;
@@ -596,9 +611,9 @@ mfn_t oos_snapshot_lookup(struct domain *d, mfn_t gmfn)
     {
         oos = v->arch.paging.shadow.oos;
         oos_snapshot = v->arch.paging.shadow.oos_snapshot;
-        idx = mfn_x(gmfn) % SHADOW_OOS_PAGES;
+        idx = mfn_x(gmfn) % shadow_oos_pages;
         if ( !mfn_eq(oos[idx], gmfn) )
-            idx = (idx + 1) % SHADOW_OOS_PAGES;
+            idx = (idx + 1) % shadow_oos_pages;
         if ( mfn_eq(oos[idx], gmfn) )
         {
             return oos_snapshot[idx];
@@ -624,9 +639,9 @@ void sh_resync(struct domain *d, mfn_t gmfn)
         oos = v->arch.paging.shadow.oos;
         oos_fixup = v->arch.paging.shadow.oos_fixup;
         oos_snapshot = v->arch.paging.shadow.oos_snapshot;
-        idx = mfn_x(gmfn) % SHADOW_OOS_PAGES;
+        idx = mfn_x(gmfn) % shadow_oos_pages;
         if ( !mfn_eq(oos[idx], gmfn) )
-            idx = (idx + 1) % SHADOW_OOS_PAGES;
+            idx = (idx + 1) % shadow_oos_pages;
 
         if ( mfn_eq(oos[idx], gmfn) )
         {
@@ -679,7 +694,7 @@ void sh_resync_all(struct vcpu *v, int skip, int this, int others)
         goto resync_others;
 
     /* First: resync all of this vcpu's oos pages */
-    for ( idx = 0; idx < SHADOW_OOS_PAGES; idx++ )
+    for ( idx = 0; idx < shadow_oos_pages; idx++ )
         if ( mfn_valid(oos[idx]) )
         {
             /* Write-protect and sync contents */
@@ -701,7 +716,7 @@ void sh_resync_all(struct vcpu *v, int skip, int this, int others)
         oos_fixup = other->arch.paging.shadow.oos_fixup;
         oos_snapshot = other->arch.paging.shadow.oos_snapshot;
 
-        for ( idx = 0; idx < SHADOW_OOS_PAGES; idx++ )
+        for ( idx = 0; idx < shadow_oos_pages; idx++ )
         {
             if ( !mfn_valid(oos[idx]) )
                 continue;
@@ -1009,7 +1024,7 @@ void shadow_unhook_mappings(struct domain *d, mfn_t smfn, int user_only)
 
 static inline void trace_shadow_prealloc_unpin(struct domain *d, mfn_t smfn)
 {
-    if ( tb_init_done )
+    if ( tracing_active() )
     {
         /* Convert smfn to gfn */
         unsigned long gfn;
@@ -1885,7 +1900,7 @@ void sh_destroy_shadow(struct domain *d, mfn_t smfn)
 
 static inline void trace_shadow_wrmap_bf(mfn_t gmfn)
 {
-    if ( tb_init_done )
+    if ( tracing_active() )
     {
         /* Convert gmfn to gfn */
         unsigned long gfn = mfn_to_gfn(current->domain, gmfn);
@@ -2521,7 +2536,7 @@ static void sh_update_paging_modes(struct vcpu *v)
     if ( mfn_eq(v->arch.paging.shadow.oos_snapshot[0], INVALID_MFN) )
     {
         int i;
-        for(i = 0; i < SHADOW_OOS_PAGES; i++)
+        for(i = 0; i < shadow_oos_pages; i++)
         {
             shadow_prealloc(d, SH_type_oos_snapshot, 1);
             v->arch.paging.shadow.oos_snapshot[i] =
@@ -216,7 +216,7 @@ hvm_emulate_write(enum x86_segment seg,
     paging_lock(v->domain);
     memcpy(ptr, p_data, bytes);
 
-    if ( tb_init_done )
+    if ( tracing_active() )
         v->arch.paging.mode->shadow.trace_emul_write_val(ptr, addr,
                                                          p_data, bytes);
 
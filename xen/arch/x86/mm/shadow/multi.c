@@ -2661,7 +2661,7 @@ typedef u32 guest_pa_t;
 
 static inline void trace_shadow_gen(u32 event, guest_va_t va)
 {
-    if ( tb_init_done )
+    if ( tracing_active() )
     {
         event |= (GUEST_PAGING_LEVELS-2)<<8;
         __trace_var(event, 0/*!tsc*/, sizeof(va), &va);
@@ -2671,7 +2671,7 @@ static inline void trace_shadow_gen(u32 event, guest_va_t va)
 static inline void trace_shadow_fixup(guest_l1e_t gl1e,
                                       guest_va_t va)
 {
-    if ( tb_init_done )
+    if ( tracing_active() )
     {
         struct __packed {
             /* for PAE, guest_l1e may be 64 while guest_va may be 32;
@@ -2695,7 +2695,7 @@ static inline void trace_shadow_fixup(guest_l1e_t gl1e,
 static inline void trace_not_shadow_fault(guest_l1e_t gl1e,
                                           guest_va_t va)
 {
-    if ( tb_init_done )
+    if ( tracing_active() )
     {
         struct __packed {
             /* for PAE, guest_l1e may be 64 while guest_va may be 32;
@@ -2720,7 +2720,7 @@ static inline void trace_shadow_emulate_other(u32 event,
                                                  guest_va_t va,
                                                  gfn_t gfn)
 {
-    if ( tb_init_done )
+    if ( tracing_active() )
     {
         struct __packed {
             /* for PAE, guest_l1e may be 64 while guest_va may be 32;
@@ -2769,7 +2769,7 @@ static void trace_emulate_write_val(const void *ptr, unsigned long vaddr,
 
 static inline void trace_shadow_emulate(guest_l1e_t gl1e, unsigned long va)
 {
-    if ( tb_init_done )
+    if ( tracing_active() )
     {
         struct __packed {
             /* for PAE, guest_l1e may be 64 while guest_va may be 32;
@@ -37,11 +37,111 @@ int arch_monitor_init_domain(struct domain *d)
 void arch_monitor_cleanup_domain(struct domain *d)
 {
     xfree(d->arch.monitor.msr_bitmap);
+    xfree(d->arch.monitor.allowed_values);
 
     memset(&d->arch.monitor, 0, sizeof(d->arch.monitor));
     memset(&d->monitor, 0, sizeof(d->monitor));
 }
 
+int arch_monitor_allow_value(struct domain *d,
+                             struct xen_domctl_monitor_op *mop, bool add)
+{
+    struct arch_domain *ad = &d->arch;
+    uint32_t index = mop->u.allowed_value.index;
+    uint64_t value = mop->u.allowed_value.value;
+    unsigned int i;
+    int rc = 0;
+
+    if ( unlikely(mop->u.allowed_value.pad) )
+        return -EINVAL;
+
+    switch ( mop->event )
+    {
+    case XEN_DOMCTL_MONITOR_EVENT_WRITE_CTRLREG:
+        if ( unlikely(index >= ARRAY_SIZE(ad->monitor.write_ctrlreg_mask)) )
+            return -EINVAL;
+        break;
+
+    case XEN_DOMCTL_MONITOR_EVENT_MOV_TO_MSR:
+        break;
+
+    default:
+        return -EOPNOTSUPP;
+    }
+
+    if ( !ad->monitor.allowed_values )
+    {
+        if ( !add )
+            return -ENOENT;
+
+        ad->monitor.allowed_values =
+            xzalloc_array(struct monitor_allowed_value,
+                          MONITOR_MAX_ALLOWED_VALUES);
+        if ( !ad->monitor.allowed_values )
+            return -ENOMEM;
+    }
+
+    /*
+     * Pausing the domain serializes us against the delivery paths, which
+     * read the list without taking any lock (cf. write_ctrlreg_mask).
+     */
+    domain_pause(d);
+
+    for ( i = 0; i < ad->monitor.nr_allowed_values; i++ )
+    {
+        const struct monitor_allowed_value *av =
+            &ad->monitor.allowed_values[i];
+
+        if ( av->event == mop->event && av->index == index &&
+             av->value == value )
+            break;
+    }
+
+    if ( add )
+    {
+        if ( i < ad->monitor.nr_allowed_values )
+            rc = -EEXIST;
+        else if ( i == MONITOR_MAX_ALLOWED_VALUES )
+            rc = -ENOSPC;
+        else
+        {
+            ad->monitor.allowed_values[i].value = value;
+            ad->monitor.allowed_values[i].index = index;
+            ad->monitor.allowed_values[i].event = mop->event;
+            ad->monitor.nr_allowed_values++;
+        }
+    }
+    else
+    {
+        if ( i == ad->monitor.nr_allowed_values )
+            rc = -ENOENT;
+        else
+            ad->monitor.allowed_values[i] =
+                ad->monitor.allowed_values[--ad->monitor.nr_allowed_values];
+    }
+
+    domain_unpause(d);
+
+    return rc;
+}
+
+bool monitored_value_allowed(const struct domain *d, unsigned int event,
+                             unsigned int index, uint64_t value)
+{
+    unsigned int i;
+
+    for ( i = 0; i < d->arch.monitor.nr_allowed_values; i++ )
+    {
+        const struct monitor_allowed_value *av =
+            &d->arch.monitor.allowed_values[i];
+
+        if ( av->event == event && av->index == index && av->value == value )
+            return true;
+    }
+
+    return false;
+}
+
 static unsigned long *monitor_bitmap_for_msr(const struct domain *d, u32 *msr)
 {
     ASSERT(d->arch.monitor.msr_bitmap && msr);
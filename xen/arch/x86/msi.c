@@ -259,6 +259,20 @@ static int write_msi_msg(struct msi_desc *entry, struct msi_msg *msg)
             return rc;
     }
 
+    /*
+     * With interrupt remapping in use the value programmed into the device
+     * only encodes the IRTE index, which doesn't change across affinity or
+     * vector updates - those take effect through the (atomic) IRTE rewrite
+     * alone. Skip the device accesses when the entry contents are already
+     * in place; for MSI-X this avoids uncached MMIO writes and the memory
+     * decoding check on every affinity change.
+     */
+    if ( entry->hw_msg_valid &&
+         entry->hw_msg.address_lo == msg->address_lo &&
+         entry->hw_msg.address_hi == msg->address_hi &&
+         entry->hw_msg.data == msg->data )
+        return 0;
+
     switch ( entry->msi_attrib.type )
     {
     case PCI_CAP_ID_MSI:
@@ -307,6 +321,9 @@ static int write_msi_msg(struct msi_desc *entry, struct msi_msg *msg)
         BUG();
     }
 
+    entry->hw_msg = *msg;
+    entry->hw_msg_valid = true;
+
     return 0;
 }
 
@@ -323,7 +340,10 @@ void set_msi_affinity(struct irq_desc *desc, const cpumask_t *mask)
     ASSERT(spin_is_locked(&desc->lock));
 
     memset(&msg, 0, sizeof(msg));
-    if ( !read_msi_msg(msi_desc, &msg) )
+    if ( msi_desc->hw_msg_valid )
+        /* The device contents are known, no need to read them back. */
+        msg = msi_desc->msg;
+    else if ( !read_msi_msg(msi_desc, &msg) )
         return;
 
     msg.data &= ~MSI_DATA_VECTOR_MASK;
@@ -1432,6 +1452,8 @@ int pci_restore_msi_state(struct pci_dev *pdev)
         type = entry->msi_attrib.type;
 
         msg = entry->msg;
+        /* The device may have been reset - force the entry to be rewritten. */
+        entry->hw_msg_valid = false;
         write_msi_msg(entry, &msg);
 
         for ( i = 0; ; )
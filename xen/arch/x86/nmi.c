@@ -32,6 +32,7 @@
 #include <asm/debugger.h>
 #include <asm/div64.h>
 #include <asm/apic.h>
+#include <asm/sampler.h>
 
 unsigned int nmi_watchdog = NMI_NONE;
 static unsigned int nmi_hz = HZ;
@@ -474,6 +475,21 @@ bool watchdog_enabled(void)
     return !atomic_read(&watchdog_disable_count);
 }
 
+/*
+ * Retarget the watchdog NMI frequency, for use by the sampling engine.
+ * Zero restores the default.  Takes effect on each CPU at its next tick,
+ * as the tick handler reloads the perfctr from nmi_hz.
+ */
+void watchdog_set_rate(unsigned int hz)
+{
+    if ( hz )
+        nmi_hz = hz;
+    else if ( nmi_watchdog == NMI_LOCAL_APIC )
+        nmi_hz = max(1ul, cpu_khz >> 20);
+    else
+        nmi_hz = HZ;
+}
+
 int __init watchdog_setup(void)
 {
     unsigned int cpu;
@@ -559,6 +575,9 @@ bool nmi_watchdog_tick(const struct cpu_user_regs *regs)
         write_watchdog_counter(NULL);
     }
 
+    if ( watchdog_tick && sampler_enabled )
+        sampler_tick(regs);
+
     return watchdog_tick;
 }
 
@@ -419,10 +419,28 @@ static void dump_numa(unsigned char key)
     printk("Memory location of each domain:\n");
     for_each_domain ( d )
     {
+        const struct vcpu *v;
+        nodeid_t anode = domain_affinity_node(d);
+        unsigned int misplaced = 0;
+
         process_pending_softirqs();
 
         printk("Domain %u (total: %u):\n", d->domain_id, d->tot_pages);
 
+        printk("    struct domain on node %u, shared_info on node %u\n",
+               phys_to_nid(virt_to_maddr(d)),
+               phys_to_nid(virt_to_maddr(d->shared_info)));
+
+        if ( anode != NUMA_NO_NODE )
+        {
+            for_each_vcpu ( d, v )
+                if ( phys_to_nid(virt_to_maddr(v)) != anode )
+                    misplaced++;
+            if ( misplaced )
+                printk("    %u vcpu struct(s) off affinity node %u\n",
+                       misplaced, anode);
+        }
+
         for_each_online_node ( i )
             page_num_node[i] = 0;
 
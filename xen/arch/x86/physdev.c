@@ -7,6 +7,7 @@
 #include <xen/event.h>
 #include <xen/guest_access.h>
 #include <xen/iocap.h>
+#include <xen/iommu.h>
 #include <xen/serial.h>
 #include <asm/current.h>
 #include <asm/io_apic.h>
@@ -34,7 +35,7 @@ static int physdev_hvm_map_pirq(
 
     ASSERT(!is_hardware_domain(d));
 
-    spin_lock(&d->event_lock);
+    write_lock(&d->event_lock);
     switch ( type )
     {
     case MAP_PIRQ_TYPE_GSI: {
@@ -84,7 +85,7 @@ static int physdev_hvm_map_pirq(
         break;
     }
 
-    spin_unlock(&d->event_lock);
+    write_unlock(&d->event_lock);
     return ret;
 }
 
@@ -154,18 +155,18 @@ int physdev_unmap_pirq(domid_t domid, int pirq)
 
     if ( is_hvm_domain(d) && has_pirq(d) )
     {
-        spin_lock(&d->event_lock);
+        write_lock(&d->event_lock);
         if ( domain_pirq_to_emuirq(d, pirq) != IRQ_UNBOUND )
             ret = unmap_domain_pirq_emuirq(d, pirq);
-        spin_unlock(&d->event_lock);
+        write_unlock(&d->event_lock);
         if ( domid == DOMID_SELF || ret )
             goto free_domain;
     }
 
     pcidevs_lock();
-    spin_lock(&d->event_lock);
+    write_lock(&d->event_lock);
     ret = unmap_domain_pirq(d, pirq);
-    spin_unlock(&d->event_lock);
+    write_unlock(&d->event_lock);
     pcidevs_unlock();
 
  free_domain:
@@ -192,10 +193,10 @@ ret_t do_physdev_op(int cmd, XEN_GUEST_HANDLE_PARAM(void) arg)
         ret = -EINVAL;
         if ( eoi.irq >= currd->nr_pirqs )
             break;
-        spin_lock(&currd->event_lock);
+        write_lock(&currd->event_lock);
         pirq = pirq_info(currd, eoi.irq);
         if ( !pirq ) {
-            spin_unlock(&currd->event_lock);
+            write_unlock(&currd->event_lock);
             break;
         }
         if ( currd->arch.auto_unmask )
@@ -214,7 +215,7 @@ ret_t do_physdev_op(int cmd, XEN_GUEST_HANDLE_PARAM(void) arg)
                     && hvm_irq->gsi_assert_count[gsi] )
                 send_guest_pirq(currd, pirq);
         }
-        spin_unlock(&currd->event_lock);
+        write_unlock(&currd->event_lock);
         ret = 0;
         break;
     }
@@ -528,6 +529,148 @@ ret_t do_physdev_op(int cmd, XEN_GUEST_HANDLE_PARAM(void) arg)
         break;
     }
 
+#ifndef COMPAT
+    case PHYSDEVOP_pviommu_op: {
+        struct physdev_pviommu_op op;
+        unsigned int flush_flags = 0, done = 0;
+        uint64_t frames = 0;
+
+        ret = -EPERM;
+        if ( !is_hardware_domain(currd) )
+            break;
+
+        ret = xsm_resource_setup_misc(XSM_PRIV);
+        if ( ret )
+            break;
+
+        ret = -EFAULT;
+        if ( copy_from_guest(&op, arg, 1) )
+            break;
+
+        ret = -EINVAL;
+        if ( op.pad )
+            break;
+
+        if ( op.op == PVIOMMU_OP_query_caps )
+        {
+            ret = (iommu_enabled && has_iommu_pt(currd) &&
+                   !iommu_hwdom_passthrough) ? PVIOMMU_CAP_map : 0;
+            break;
+        }
+
+        if ( op.op != PVIOMMU_OP_map && op.op != PVIOMMU_OP_unmap )
+            break;
+
+        ret = -ENODEV;
+        if ( !iommu_enabled || !has_iommu_pt(currd) )
+            break;
+
+        /* On-demand mappings can't coexist with a passthrough hwdom. */
+        ret = -EOPNOTSUPP;
+        if ( iommu_hwdom_passthrough )
+            break;
+
+        ret = 0;
+        while ( done < op.nr_entries )
+        {
+            struct pviommu_map_entry entry;
+            unsigned long j;
+
+            if ( copy_from_guest_offset(&entry, op.entries, done, 1) )
+            {
+                ret = -EFAULT;
+                break;
+            }
+
+            /*
+             * Bound the work done per hypercall; callers get back the
+             * number of fully processed entries and must re-issue the
+             * remainder in a smaller batch.
+             */
+            frames += entry.nr_frames;
+            if ( frames > 4096 )
+            {
+                ret = done ? 0 : -E2BIG;
+                break;
+            }
+
+            if ( op.op == PVIOMMU_OP_map )
+            {
+                unsigned int iflags = 0;
+
+                if ( entry.flags & ~(PVIOMMU_MAPF_readable |
+                                     PVIOMMU_MAPF_writable) )
+                {
+                    ret = -EINVAL;
+                    break;
+                }
+                if ( entry.flags & PVIOMMU_MAPF_readable )
+                    iflags |= IOMMUF_readable;
+                if ( entry.flags & PVIOMMU_MAPF_writable )
+                    iflags |= IOMMUF_writable;
+
+                for ( j = 0; j < entry.nr_frames; j++ )
+                {
+                    mfn_t mfn = _mfn(entry.mfn + j);
+                    struct page_info *pg;
+
+                    ret = -EINVAL;
+                    if ( !mfn_valid(mfn) )
+                        break;
+
+                    /*
+                     * Validate ownership. No lasting reference is
+                     * taken - the hardware domain's boot-time IOMMU
+                     * mappings hold none either, and mappings may be
+                     * torn down in any order.
+                     */
+                    pg = mfn_to_page(mfn);
+                    ret = -EPERM;
+                    if ( !get_page(pg, currd) )
+                        break;
+                    put_page(pg);
+
+                    ret = iommu_map(currd, _dfn(entry.dfn + j), mfn, 0,
+                                    iflags, &flush_flags);
+                    if ( ret )
+                        break;
+                }
+            }
+            else
+            {
+                for ( j = 0; j < entry.nr_frames; j++ )
+                {
+                    ret = iommu_unmap(currd, _dfn(entry.dfn + j), 0,
+                                      &flush_flags);
+                    if ( ret )
+                        break;
+                }
+            }
+
+            if ( ret )
+                break;
+
+            done++;
+        }
+
+        /* One IOTLB flush covers the whole batch. */
+        if ( flush_flags )
+        {
+            int rc = iommu_iotlb_flush_all(currd, flush_flags);
+
+            if ( !ret )
+                ret = rc;
+        }
+
+        op.nr_entries = done;
+        if ( __copy_field_to_guest(guest_handle_cast(arg,
+                                                     physdev_pviommu_op_t),
+                                   &op, nr_entries) )
+            ret = -EFAULT;
+        break;
+    }
+#endif /* !COMPAT */
+
     case PHYSDEVOP_prepare_msix:
     case PHYSDEVOP_release_msix: {
         struct physdev_pci_device dev;
@@ -626,7 +769,7 @@ ret_t do_physdev_op(int cmd, XEN_GUEST_HANDLE_PARAM(void) arg)
         if ( copy_from_guest(&out, arg, 1) != 0 )
             break;
 
-        spin_lock(&currd->event_lock);
+        write_lock(&currd->event_lock);
 
         ret = get_free_pirq(currd, out.type);
         if ( ret >= 0 )
@@ -639,7 +782,7 @@ ret_t do_physdev_op(int cmd, XEN_GUEST_HANDLE_PARAM(void) arg)
                 ret = -ENOMEM;
         }
 
-        spin_unlock(&currd->event_lock);
+        write_unlock(&currd->event_lock);
 
         if ( ret >= 0 )
         {
@@ -13,6 +13,7 @@
 #include <xen/paging.h>
 #include <xen/pfn.h>
 #include <xen/sched.h>
+#include <xen/smp.h>
 #include <xen/softirq.h>
 
 #include <asm/bzimage.h>
@@ -42,6 +43,93 @@ void __init dom0_update_physmap(struct domain *d, unsigned long pfn,
     set_gpfn_from_mfn(mfn, pfn);
 }
 
+/*
+ * The initial P->M table is populated in pfn order, with the initrd (when
+ * mapped inside the initial allocation) and, in debug builds, part of the
+ * allocation deliberately placed out of line.  Keep the pfn -> mfn
+ * calculation in one place so the M2P worker CPUs below agree with the
+ * boot CPU's view of the layout.
+ */
+static struct physmap_fill_info {
+    unsigned long alloc_spfn;
+    unsigned long initrd_pfn;
+    unsigned long initrd_nr;
+    unsigned long initrd_mfn;
+#ifndef NDEBUG
+    unsigned long reverse_start;
+    unsigned long alloc_epfn;
+    bool mapped_initrd;
+#endif
+    unsigned long per_cpu_sz;
+    unsigned long rem;
+    cpumask_t cpus;
+    atomic_t done;
+} physmap_fill_info __initdata;
+
+static unsigned long __init physmap_pfn_to_mfn(
+    const struct physmap_fill_info *fi, unsigned long pfn)
+{
+    unsigned long mfn = pfn + fi->alloc_spfn;
+
+    if ( pfn >= fi->initrd_pfn )
+    {
+        if ( pfn < fi->initrd_pfn + fi->initrd_nr )
+            mfn = fi->initrd_mfn + (pfn - fi->initrd_pfn);
+        else
+            mfn -= fi->initrd_nr;
+    }
+
+#ifndef NDEBUG
+    if ( pfn > fi->reverse_start &&
+         (fi->mapped_initrd || pfn < fi->initrd_pfn) )
+        mfn = fi->alloc_epfn - (pfn - fi->reverse_start);
+#endif
+
+    return mfn;
+}
+
+/*
+ * Fill this CPU's slice of the M2P for Dom0's initial allocation.  The M2P
+ * lives in Xen's global mappings, so - unlike the P->M array, which is only
+ * reachable through Dom0's page tables on the boot CPU - the already-booted
+ * APs can populate it while the boot CPU writes the guest-virtual half.
+ */
+static void __init smp_fill_physmap_m2p(void *data)
+{
+    struct physmap_fill_info *fi = data;
+    unsigned int cpu = smp_processor_id(), cpu_idx = 0, i;
+    unsigned long pfn, start, end;
+
+    /* Determine the current CPU's index into the CPUs doing the fill. */
+    for_each_cpu ( i, &fi->cpus )
+    {
+        if ( i == cpu )
+            break;
+        cpu_idx++;
+    }
+
+    start = fi->per_cpu_sz * cpu_idx;
+    end = start + fi->per_cpu_sz;
+    if ( cpu_idx + 1 == cpumask_weight(&fi->cpus) )
+        end += fi->rem;
+
+    for ( pfn = start; pfn < end; pfn++ )
+        set_gpfn_from_mfn(physmap_pfn_to_mfn(fi, pfn), pfn);
+
+    atomic_inc(&fi->done);
+}
+
+static s_time_t __initdata build_phase_start;
+
+static void __init print_phase_time(const char *phase)
+{
+    s_time_t now = NOW();
+
+    printk(XENLOG_INFO "Dom0 %s: %lums\n", phase,
+           (unsigned long)((now - build_phase_start) / MILLISECS(1)));
+    build_phase_start = now;
+}
+
 static __init void mark_pv_pt_pages_rdonly(struct domain *d,
                                            l4_pgentry_t *l4start,
                                            unsigned long vpt_start,
@@ -294,6 +382,8 @@ int __init dom0_construct_pv(struct domain *d,
     unsigned long alloc_epfn;
     unsigned long initrd_pfn = -1, initrd_mfn = 0;
     unsigned long count;
+    unsigned int workers;
+    struct physmap_fill_info *fi;
     struct page_info *page = NULL;
     start_info_t *si;
     struct vcpu *v = d->vcpu[0];
@@ -338,6 +428,8 @@ int __init dom0_construct_pv(struct domain *d,
 
     printk(XENLOG_INFO "*** Building a PV Dom%d ***\n", d->domain_id);
 
+    build_phase_start = NOW();
+
     d->max_pages = ~0U;
 
     if ( (rc = bzimage_parse(image_base, &image_start, &image_len)) != 0 )
@@ -578,6 +670,8 @@ int __init dom0_construct_pv(struct domain *d,
            _p(v_start), _p(v_end));
     printk(" ENTRY ADDRESS: %p\n", _p(parms.virt_entry));
 
+    print_phase_time("image parsing and memory allocation");
+
     process_pending_softirqs();
 
     mpt_alloc = (vpt_start - v_start) + pfn_to_paddr(alloc_spfn);
@@ -703,6 +797,8 @@ int __init dom0_construct_pv(struct domain *d,
     for ( i = 0; i < XEN_LEGACY_MAX_VCPUS; i++ )
         shared_info(d, vcpu_info[i].evtchn_upcall_mask) = 1;
 
+    print_phase_time("page table construction");
+
     printk("Dom%u has maximum %u VCPUs\n", d->domain_id, d->max_vcpus);
 
     cpu = v->processor;
@@ -757,6 +853,8 @@ int __init dom0_construct_pv(struct domain *d,
     /* Free temporary buffers. */
     discard_initial_images();
 
+    print_phase_time("kernel image load");
+
     /* Set up start info area. */
     si = (start_info_t *)vstartinfo_start;
     clear_page(si);
@@ -786,25 +884,41 @@ int __init dom0_construct_pv(struct domain *d,
     }
 
     /* Write the phys->machine and machine->phys table entries. */
-    for ( pfn = 0; pfn < count; pfn++ )
-    {
-        mfn = pfn + alloc_spfn;
-        if ( pfn >= initrd_pfn )
-        {
-            if ( pfn < initrd_pfn + PFN_UP(initrd_len) )
-                mfn = initrd->mod_start + (pfn - initrd_pfn);
-            else
-                mfn -= PFN_UP(initrd_len);
-        }
+    fi = &physmap_fill_info;
+    fi->alloc_spfn = alloc_spfn;
+    fi->initrd_pfn = initrd_pfn;
+    fi->initrd_nr = PFN_UP(initrd_len);
+    fi->initrd_mfn = initrd ? initrd->mod_start : 0;
 #ifndef NDEBUG
-#define REVERSE_START ((v_end - v_start) >> PAGE_SHIFT)
-        if ( pfn > REVERSE_START && (vinitrd_start || pfn < initrd_pfn) )
-            mfn = alloc_epfn - (pfn - REVERSE_START);
+    fi->reverse_start = (v_end - v_start) >> PAGE_SHIFT;
+    fi->alloc_epfn = alloc_epfn;
+    fi->mapped_initrd = vinitrd_start;
 #endif
-        dom0_update_physmap(d, pfn, mfn, vphysmap_start);
+    cpumask_andnot(&fi->cpus, &cpu_online_map,
+                   cpumask_of(smp_processor_id()));
+    workers = cpumask_weight(&fi->cpus);
+    if ( workers )
+    {
+        fi->per_cpu_sz = count / workers;
+        fi->rem = count % workers;
+        atomic_set(&fi->done, 0);
+        on_selected_cpus(&fi->cpus, smp_fill_physmap_m2p, fi, 0);
+    }
+    for ( pfn = 0; pfn < count; pfn++ )
+    {
+        mfn = physmap_pfn_to_mfn(fi, pfn);
+        if ( !workers )
+            dom0_update_physmap(d, pfn, mfn, vphysmap_start);
+        else if ( !is_pv_32bit_domain(d) )
+            ((unsigned long *)vphysmap_start)[pfn] = mfn;
+        else
+            ((unsigned int *)vphysmap_start)[pfn] = mfn;
         if ( !(pfn & 0xfffff) )
             process_pending_softirqs();
     }
+    /* Wait for the APs to finish the M2P half of the work. */
+    while ( workers && atomic_read(&fi->done) != workers )
+        cpu_relax();
     si->first_p2m_pfn = pfn;
     si->nr_p2m_frames = d->tot_pages - count;
     page_list_for_each ( page, &d->page_list )
@@ -846,6 +960,9 @@ int __init dom0_construct_pv(struct domain *d,
         }
     }
 
+    print_phase_time(workers ? "P->M/M2P population (M2P on APs)"
+                             : "P->M/M2P population");
+
     if ( initrd_len != 0 )
     {
         si->mod_start = vinitrd_start ?: initrd_pfn;
@@ -20,7 +20,7 @@ static __read_mostly enum {
     PCID_ALL,
     PCID_XPTI,
     PCID_NOXPTI
-} opt_pcid = PCID_XPTI;
+} opt_pcid = PCID_ALL;
 
 static int parse_pcid(const char *s)
 {
@@ -20,6 +20,7 @@
  */
 
 #include <xen/compiler.h>
+#include <xen/domperf.h>
 #include <xen/hypercall.h>
 #include <xen/nospec.h>
 #include <xen/trace.h>
@@ -97,6 +98,7 @@ void pv_hypercall(struct cpu_user_regs *regs)
 {
     struct vcpu *curr = current;
     unsigned long eax;
+    s_time_t t0;
 
     ASSERT(guest_kernel_mode(curr, regs));
 
@@ -120,6 +122,7 @@ void pv_hypercall(struct cpu_user_regs *regs)
     }
 
     curr->hcall_preempted = false;
+    t0 = NOW();
 
     if ( !is_pv_32bit_vcpu(curr) )
     {
@@ -142,7 +145,7 @@ void pv_hypercall(struct cpu_user_regs *regs)
         case 5: r9 = 0xdeadbeefdeadf00dUL;
         }
 #endif
-        if ( unlikely(tb_init_done) )
+        if ( tracing_active() )
         {
             unsigned long args[6] = { rdi, rsi, rdx, r10, r8, r9 };
 
@@ -189,7 +192,7 @@ void pv_hypercall(struct cpu_user_regs *regs)
         }
 #endif
 
-        if ( unlikely(tb_init_done) )
+        if ( tracing_active() )
         {
             unsigned long args[6] = { ebx, ecx, edx, esi, edi, ebp };
 
@@ -225,6 +228,10 @@ void pv_hypercall(struct cpu_user_regs *regs)
     if ( curr->hcall_preempted )
         regs->rip -= 2;
 
+    /* Preempted hypercalls have each continuation accounted separately. */
+    hypercall_stats_account(curr->domain, eax, t0);
+    domperf_incr(curr, hypercalls);
+
     perfc_incr(hypercalls);
 }
 
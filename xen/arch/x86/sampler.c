@@ -0,0 +1,207 @@
+/******************************************************************************
+ * sampler.c
+ *
+ * NMI-driven IP sampling with per-domain attribution.
+ *
+ * The watchdog NMI calls sampler_tick(), which stores the interrupted
+ * instruction pointer, the owning domain/vCPU and (for hypervisor-mode
+ * samples) a couple of likely callers into a per-CPU ring.  A softirq
+ * drains the ring into the trace buffers as TRC_SAMPLE records, so the
+ * existing xentrace machinery delivers samples to dom0; nothing but the
+ * ring write and a softirq bit happens in NMI context.
+ *
+ * Unlike xenoprof this needs no oprofile-aware kernel in dom0: any
+ * consumer of the trace buffers can symbolize samples against the
+ * hypervisor symbol table (XENPF_get_symbol) and the guest's own.
+ */
+
+#include <xen/errno.h>
+#include <xen/init.h>
+#include <xen/lib.h>
+#include <xen/percpu.h>
+#include <xen/kernel.h>
+#include <xen/sched.h>
+#include <xen/softirq.h>
+#include <xen/trace.h>
+#include <xen/watchdog.h>
+#include <asm/nmi.h>
+#include <asm/regs.h>
+#include <asm/sampler.h>
+
+/* Default per-CPU sampling rate, in Hz. */
+#define SAMPLER_DEFAULT_RATE 500
+#define SAMPLER_MAX_RATE     10000
+
+/* Ring slots per CPU; must be a power of two. */
+#define SAMPLER_RING_SIZE    256
+
+/* Hypervisor-mode stack words inspected for caller addresses. */
+#define SAMPLER_STACK_WORDS  32
+#define SAMPLER_NR_CALLERS   2
+
+struct sampler_rec {
+    uint32_t meta;                      /* domid | vcpu << 16 */
+    uint32_t flags;                     /* XEN_SAMPLE_F_* + caller count */
+    uint64_t ip;
+    uint32_t caller[SAMPLER_NR_CALLERS]; /* offsets into Xen text */
+};
+
+struct sampler_ring {
+    struct sampler_rec rec[SAMPLER_RING_SIZE];
+    /* prod is only written from NMI context, cons only from softirq. */
+    uint32_t prod, cons;
+    uint64_t taken, dropped;
+};
+static DEFINE_PER_CPU(struct sampler_ring, sampler_ring);
+
+bool __read_mostly sampler_enabled;
+
+/*
+ * Conservative caller extraction: scan the interrupted (hypervisor)
+ * stack for values pointing into Xen text.  With -fomit-frame-pointer
+ * this over-approximates the call chain, which is fine for profile
+ * aggregation; a real unwinder cannot run in NMI context anyway.
+ */
+static unsigned int sample_callers(const struct cpu_user_regs *regs,
+                                   uint32_t caller[SAMPLER_NR_CALLERS])
+{
+    const unsigned long *sp = (const unsigned long *)regs->rsp;
+    unsigned long top = ((unsigned long)sp | (STACK_SIZE - 1)) + 1 -
+                        sizeof(unsigned long);
+    unsigned int i, nr = 0;
+
+    for ( i = 0; i < SAMPLER_STACK_WORDS && nr < SAMPLER_NR_CALLERS; i++ )
+    {
+        unsigned long val;
+
+        if ( (unsigned long)&sp[i] > top )
+            break;
+
+        val = sp[i];
+        if ( val != regs->rip && is_active_kernel_text(val) )
+            caller[nr++] = val - XEN_VIRT_START;
+    }
+
+    return nr;
+}
+
+void sampler_tick(const struct cpu_user_regs *regs)
+{
+    struct sampler_ring *r = &this_cpu(sampler_ring);
+    struct sampler_rec *rec;
+    const struct vcpu *curr = current;
+
+    if ( r->prod - r->cons == SAMPLER_RING_SIZE )
+    {
+        r->dropped++;
+        return;
+    }
+
+    rec = &r->rec[r->prod & (SAMPLER_RING_SIZE - 1)];
+    rec->ip = regs->rip;
+    rec->meta = curr->domain->domain_id | (uint32_t)curr->vcpu_id << 16;
+    rec->flags = 0;
+
+    if ( is_hvm_vcpu(curr) )
+        rec->flags |= XEN_SAMPLE_F_HVM;
+
+    if ( guest_mode(regs) )
+        rec->flags |= XEN_SAMPLE_F_GUEST;
+    else
+        rec->flags |= sample_callers(regs, rec->caller) << 16;
+
+    /* Publish the record before making it visible to the consumer. */
+    barrier();
+    r->prod++;
+    r->taken++;
+
+    raise_softirq(SAMPLER_SOFTIRQ);
+}
+
+static void sampler_softirq_fn(void)
+{
+    struct sampler_ring *r = &this_cpu(sampler_ring);
+
+    while ( r->cons != r->prod )
+    {
+        const struct sampler_rec *rec =
+            &r->rec[r->cons & (SAMPLER_RING_SIZE - 1)];
+        struct {
+            uint32_t meta, flags;
+            uint64_t ip;
+            uint32_t caller[SAMPLER_NR_CALLERS];
+        } d = {
+            .meta = rec->meta,
+            .flags = rec->flags,
+            .ip = rec->ip,
+            .caller = { rec->caller[0], rec->caller[1] },
+        };
+
+        trace_var(TRC_SAMPLE, 1, sizeof(d), &d);
+        barrier();
+        r->cons++;
+    }
+}
+
+int sampler_control(struct xen_sysctl_sampler_op *op)
+{
+    unsigned int cpu;
+
+    switch ( op->cmd )
+    {
+    case XEN_SYSCTL_SAMPLER_enable:
+        if ( !watchdog_enabled() )
+            return -ENODEV;
+        if ( op->rate > SAMPLER_MAX_RATE )
+            return -EINVAL;
+        if ( !sampler_enabled )
+            for_each_online_cpu ( cpu )
+            {
+                struct sampler_ring *r = &per_cpu(sampler_ring, cpu);
+
+                r->taken = r->dropped = 0;
+            }
+        watchdog_set_rate(op->rate ?: SAMPLER_DEFAULT_RATE);
+        sampler_enabled = true;
+        break;
+
+    case XEN_SYSCTL_SAMPLER_disable:
+        sampler_enabled = false;
+        watchdog_set_rate(0);
+        break;
+
+    case XEN_SYSCTL_SAMPLER_query:
+        op->enabled = sampler_enabled;
+        op->nr_samples = op->nr_dropped = 0;
+        for_each_online_cpu ( cpu )
+        {
+            const struct sampler_ring *r = &per_cpu(sampler_ring, cpu);
+
+            op->nr_samples += r->taken;
+            op->nr_dropped += r->dropped;
+        }
+        break;
+
+    default:
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+static int __init sampler_init(void)
+{
+    open_softirq(SAMPLER_SOFTIRQ, sampler_softirq_fn);
+    return 0;
+}
+__initcall(sampler_init);
+
+/*
+ * Local variables:
+ * mode: C
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -41,6 +41,7 @@
 #include <asm/paging.h>
 #include <asm/e820.h>
 #include <xen/kexec.h>
+#include <xen/liveupdate.h>
 #include <asm/edd.h>
 #include <xsm/xsm.h>
 #include <asm/tboot.h>
@@ -576,6 +577,34 @@ static void __init kexec_reserve_area(struct e820map *e820)
 #endif
 }
 
+static void __init liveupdate_reserve_area(struct e820map *e820)
+{
+#ifdef CONFIG_KEXEC
+    unsigned long lu_start = liveupdate_area.start;
+    unsigned long lu_size  = liveupdate_area.size;
+    static bool __initdata is_reserved = false;
+
+    lu_size = (lu_size + PAGE_SIZE - 1) & PAGE_MASK;
+
+    if ( (lu_start == 0) || (lu_size == 0) || is_reserved )
+        return;
+
+    is_reserved = true;
+
+    if ( !reserve_e820_ram(e820, lu_start, lu_start + lu_size) )
+    {
+        printk("Liveupdate: DISABLED (failed to reserve %luMB at %#lx)\n",
+               lu_size >> 20, lu_start);
+        liveupdate_area.start = liveupdate_area.size = 0;
+    }
+    else
+    {
+        printk("Liveupdate: %luMB (%lukB) at %#lx\n",
+               lu_size >> 20, lu_size >> 10, lu_start);
+    }
+#endif
+}
+
 static inline bool using_2M_mapping(void)
 {
     return !l1_table_offset((unsigned long)__2M_text_end) &&
@@ -956,6 +985,7 @@ void __init noreturn __start_xen(unsigned long mbi_p)
             nr_pages += e820.map[i].size >> PAGE_SHIFT;
     set_kexec_crash_area_size((u64)nr_pages << PAGE_SHIFT);
     kexec_reserve_area(&boot_e820);
+    liveupdate_reserve_area(&boot_e820);
 
     initial_images = mod;
     nr_initial_images = mbi->mods_count;
@@ -1382,10 +1412,21 @@ void __init noreturn __start_xen(unsigned long mbi_p)
         unsigned long e = min(s + PFN_UP(kexec_crash_area.size),
                               PFN_UP(__pa(HYPERVISOR_VIRT_END - 1)));
 
-        if ( e > s ) 
+        if ( e > s )
             map_pages_to_xen((unsigned long)__va(kexec_crash_area.start),
                              _mfn(s), e - s, PAGE_HYPERVISOR);
     }
+
+    if ( liveupdate_area.size )
+    {
+        unsigned long s = PFN_DOWN(liveupdate_area.start);
+        unsigned long e = min(s + PFN_UP(liveupdate_area.size),
+                              PFN_UP(__pa(HYPERVISOR_VIRT_END - 1)));
+
+        if ( e > s )
+            map_pages_to_xen((unsigned long)__va(liveupdate_area.start),
+                             _mfn(s), e - s, PAGE_HYPERVISOR);
+    }
 #endif
 
     xen_virt_end = ((unsigned long)_end + (1UL << L2_PAGETABLE_SHIFT) - 1) &
@@ -1697,6 +1738,7 @@ void __init noreturn __start_xen(unsigned long mbi_p)
     }
 
     printk("Brought up %ld CPUs\n", (long)num_online_cpus());
+    smp_boot_report();
     if ( num_parked )
         printk(XENLOG_INFO "Parked %u CPUs\n", num_parked);
     smp_cpus_done();
@@ -416,8 +416,24 @@ void start_secondary(void *unused)
 
 extern void *stack_start;
 
+/*
+ * The 10ms INIT deassert delay and the delays around each STARTUP IPI are
+ * only needed by external (82489DX) APICs and some ancient processors.
+ * Anything with an integrated APIC from the P6 family onwards latches
+ * INIT/SIPI without them, as the x2apic path below already assumes.
+ */
+static bool wakeup_delays_needed(void)
+{
+    if ( cpu_has_hypervisor )
+        return false;
+    if ( boot_cpu_data.x86_vendor == X86_VENDOR_AMD )
+        return false;
+    return boot_cpu_data.x86 < 6;
+}
+
 static int wakeup_secondary_cpu(int phys_apicid, unsigned long start_eip)
 {
+    bool delays = wakeup_delays_needed();
     unsigned long send_status = 0, accept_status = 0;
     int maxlvt, timeout, i;
 
@@ -445,7 +461,8 @@ static int wakeup_secondary_cpu(int phys_apicid, unsigned long start_eip)
             send_status = apic_read(APIC_ICR) & APIC_ICR_BUSY;
         } while ( send_status && (timeout++ < 1000) );
 
-        mdelay(10);
+        if ( delays )
+            mdelay(10);
 
         Dprintk("Deasserting INIT.\n");
 
@@ -490,7 +507,8 @@ static int wakeup_secondary_cpu(int phys_apicid, unsigned long start_eip)
         if ( !x2apic_enabled )
         {
             /* Give the other CPU some time to accept the IPI. */
-            udelay(300);
+            if ( delays )
+                udelay(300);
 
             Dprintk("Startup point 1.\n");
 
@@ -503,7 +521,8 @@ static int wakeup_secondary_cpu(int phys_apicid, unsigned long start_eip)
             } while ( send_status && (timeout++ < 1000) );
 
             /* Give the other CPU some time to accept the IPI. */
-            udelay(200);
+            if ( delays )
+                udelay(200);
         }
 
         /* Due to the Pentium erratum 3AP. */
@@ -535,10 +554,76 @@ int alloc_cpu_id(void)
     return (cpu < nr_cpu_ids) ? cpu : -ENODEV;
 }
 
+/*
+ * Per-CPU trace of the bringup phases, recorded while booting the secondary
+ * processors and reported (see smp_boot_report()) once they are all up.
+ * Only written during boot, so it can live in .init and runtime hotplug or
+ * resume need not touch it.
+ */
+static struct ap_boot_trace {
+    s_time_t wakeup;  /* INIT/SIPI sequence */
+    s_time_t callin;  /* trampoline to callin, incl. TSC sync */
+    s_time_t online;  /* notifier chain to appearing in cpu_online_map */
+} ap_boot_trace[NR_CPUS] __initdata;
+
+static void ap_boot_note(s_time_t *slot, s_time_t *stamp)
+{
+    s_time_t now;
+
+    if ( system_state >= SYS_STATE_active )
+        return;
+
+    now = NOW();
+    *slot = now - *stamp;
+    *stamp = now;
+}
+
+void __init smp_boot_report(void)
+{
+    unsigned int cpu, slowest = 0;
+    s_time_t wakeup = 0, callin = 0, online = 0, max_total = 0;
+
+    for_each_online_cpu ( cpu )
+    {
+        const struct ap_boot_trace *t = &ap_boot_trace[cpu];
+        s_time_t total = t->wakeup + t->callin + t->online;
+
+        if ( !total )
+            continue;
+
+        wakeup += t->wakeup;
+        callin += t->callin;
+        online += t->online;
+        if ( total > max_total )
+        {
+            max_total = total;
+            slowest = cpu;
+        }
+
+        if ( opt_cpu_info )
+            printk("CPU%u boot: wakeup %luus, callin %luus, online %luus\n",
+                   cpu,
+                   (unsigned long)(t->wakeup / MICROSECS(1)),
+                   (unsigned long)(t->callin / MICROSECS(1)),
+                   (unsigned long)(t->online / MICROSECS(1)));
+    }
+
+    if ( !max_total )
+        return;
+
+    printk("AP bringup: wakeup %lums, callin %lums, online %lums"
+           " (slowest: CPU%u, %lums)\n",
+           (unsigned long)(wakeup / MILLISECS(1)),
+           (unsigned long)(callin / MILLISECS(1)),
+           (unsigned long)(online / MILLISECS(1)),
+           slowest, (unsigned long)(max_total / MILLISECS(1)));
+}
+
 static int do_boot_cpu(int apicid, int cpu)
 {
     int timeout, boot_error = 0, rc = 0;
     unsigned long start_eip;
+    s_time_t stamp = NOW();
 
     /*
      * Save current MTRR state in case it was changed since early boot
@@ -570,6 +655,8 @@ static int do_boot_cpu(int apicid, int cpu)
     if ( !tboot_in_measured_env() || tboot_wake_ap(apicid, start_eip) )
         boot_error = wakeup_secondary_cpu(apicid, start_eip);
 
+    ap_boot_note(&ap_boot_trace[cpu].wakeup, &stamp);
+
     if ( !boot_error )
     {
         /* Allow AP to start initializing. */
@@ -591,6 +678,7 @@ static int do_boot_cpu(int apicid, int cpu)
             print_cpu_info(cpu);
             synchronize_tsc_master(cpu);
             Dprintk("CPU has booted.\n");
+            ap_boot_note(&ap_boot_trace[cpu].callin, &stamp);
         }
         else if ( cpu_state == CPU_STATE_DEAD )
         {
@@ -1320,6 +1408,7 @@ int cpu_add(uint32_t apic_id, uint32_t acpi_id, uint32_t pxm)
 int __cpu_up(unsigned int cpu)
 {
     int apicid, ret;
+    s_time_t stamp;
 
     if ( (apicid = x86_cpu_to_apicid[cpu]) == BAD_APICID )
         return -ENODEV;
@@ -1329,12 +1418,14 @@ int __cpu_up(unsigned int cpu)
 
     time_latch_stamps();
 
+    stamp = NOW();
     set_cpu_state(CPU_STATE_ONLINE);
     while ( !cpu_online(cpu) )
     {
         cpu_relax();
         process_pending_softirqs();
     }
+    ap_boot_note(&ap_boot_trace[cpu].online, &stamp);
 
     return 0;
 }
@@ -7,10 +7,23 @@
 
 #include <xen/lib.h>
 
+#include <asm/processor.h>
+
 void *(memcpy)(void *dest, const void *src, size_t n)
 {
     long d0, d1, d2;
 
+    if ( cpu_has_erms )
+    {
+        asm volatile (
+            "rep movsb"
+            : "=&c" (d0), "=&D" (d1), "=&S" (d2)
+            : "0" (n), "1" (dest), "2" (src)
+            : "memory" );
+
+        return dest;
+    }
+
     asm volatile (
         "   rep ; movs"__OS" ; "
         "   mov %k4,%k3      ; "
@@ -31,6 +31,7 @@
 #include <xen/cpu.h>
 #include <xsm/xsm.h>
 #include <asm/psr.h>
+#include <asm/sampler.h>
 #include <asm/cpuid.h>
 
 const struct cpu_policy system_policies[] = {
@@ -386,6 +387,35 @@ long arch_do_sysctl(
         break;
     }
 
+    case XEN_SYSCTL_hypercall_prof_op:
+        ret = hypercall_stats_control(&sysctl->u.hypercall_prof_op);
+        if ( ret == 0 &&
+             __copy_field_to_guest(u_sysctl, sysctl, u.hypercall_prof_op) )
+            ret = -EFAULT;
+        break;
+
+    case XEN_SYSCTL_sampler_op:
+        ret = sampler_control(&sysctl->u.sampler_op);
+        if ( ret == 0 &&
+             __copy_field_to_guest(u_sysctl, sysctl, u.sampler_op) )
+            ret = -EFAULT;
+        break;
+
+    case XEN_SYSCTL_irq_stats:
+        ret = irq_get_stats(&sysctl->u.irq_stats);
+        if ( ret == 0 &&
+             __copy_field_to_guest(u_sysctl, sysctl, u.irq_stats) )
+            ret = -EFAULT;
+        break;
+
+    case XEN_SYSCTL_timepage_info:
+        sysctl->u.timepage_info.mfn = timepage_mfn();
+        if ( sysctl->u.timepage_info.mfn == 0 )
+            ret = -ENODATA;
+        else if ( __copy_field_to_guest(u_sysctl, sysctl, u.timepage_info) )
+            ret = -EFAULT;
+        break;
+
     default:
         ret = -ENOSYS;
         break;
@@ -37,6 +37,7 @@
 #include <io_ports.h>
 #include <asm/setup.h> /* for early_time_init */
 #include <public/arch-x86/cpuid.h>
+#include <public/sysctl.h>
 
 /* opt_clocksource: Force clocksource to one of: pit, hpet, acpi. */
 static char __initdata opt_clocksource[10];
@@ -73,6 +74,12 @@ static DEFINE_PER_CPU(struct cpu_time, cpu_time);
 #define EPOCH MILLISECS(1000)
 static struct timer calibration_timer;
 
+/*
+ * Read-only page shared with privileged guests, holding the boot CPU's
+ * TSC-to-system-time parameters for tools (XEN_SYSCTL_timepage_info).
+ */
+static struct xen_timepage *timepage;
+
 /*
  * We simulate a 32-bit platform timer from the 16-bit PIT ch2 counter.
  * Otherwise overflow happens too quickly (~50ms) for us to guarantee that
@@ -1206,6 +1213,30 @@ int cpu_frequency_change(u64 freq)
 static DEFINE_PER_CPU(struct cpu_time_stamp, cpu_calibration);
 
 /* Softirq handler for per-CPU time calibration. */
+/* Refresh the shared time page from the boot CPU's calibration record. */
+static void update_timepage(void)
+{
+    const struct cpu_time *t = &this_cpu(cpu_time);
+    struct xen_timepage *tp = timepage;
+
+    if ( !tp )
+        return;
+
+    tp->version = version_update_begin(tp->version);
+    smp_wmb();
+    tp->tsc_timestamp     = t->stamp.local_tsc;
+    tp->system_time       = t->stamp.local_stime;
+    tp->tsc_to_system_mul = t->tsc_scale.mul_frac;
+    tp->tsc_shift         = t->tsc_scale.shift;
+    smp_wmb();
+    tp->version = version_update_end(tp->version);
+}
+
+unsigned long timepage_mfn(void)
+{
+    return timepage ? virt_to_mfn(timepage) : 0;
+}
+
 static void local_time_calibration(void)
 {
     struct cpu_time *t = &this_cpu(cpu_time);
@@ -1342,6 +1373,7 @@ static void local_time_calibration(void)
  out:
     if ( smp_processor_id() == 0 )
     {
+        update_timepage();
         set_timer(&calibration_timer, NOW() + EPOCH);
         platform_time_calibration();
     }
@@ -1835,12 +1867,23 @@ int __init init_xen_time(void)
 
     open_softirq(TIME_CALIBRATE_SOFTIRQ, local_time_calibration);
 
+    /* Tolerate allocation failure: tools simply get no time page. */
+    timepage = alloc_xenheap_page();
+    if ( timepage )
+    {
+        clear_page(timepage);
+        share_xen_page_with_privileged_guests(virt_to_page(timepage),
+                                              SHARE_ro);
+    }
+
     /* NB. get_wallclock_time() can take over one second to execute. */
     do_settime(get_wallclock_time(), 0, NOW());
 
     /* Finish platform timer initialization. */
     try_platform_timer_tail(false);
 
+    update_timepage();
+
     /*
      * Setup space to track per-socket TSC_ADJUST values. Don't fiddle with
      * values if the TSC is not reported as invariant. Ignore allocation
@@ -2053,10 +2096,18 @@ int hwdom_pit_access(struct ioreq *ioreq)
  * PV SoftTSC Emulation.
  */
 
+/*
+ * Replace TSC emulation of always-emulate domains with hardware TSC
+ * scaling where it reproduces the guest frequency exactly.
+ */
+static bool __read_mostly opt_tsc_hwscale;
+
 /*
  * tsc=unstable: Override all tests; assume TSC is unreliable.
  * tsc=skewed: Assume TSCs are individually reliable, but skewed across CPUs.
  * tsc=stable:socket: Assume TSCs are reliable across sockets.
+ * tsc=hwscale: Run always-emulate domains on the (scaled) host TSC when
+ *  hardware TSC scaling can reproduce their frequency exactly.
  */
 static int __init tsc_parse(const char *s)
 {
@@ -2070,6 +2121,8 @@ static int __init tsc_parse(const char *s)
         setup_clear_cpu_cap(X86_FEATURE_TSC_RELIABLE);
     else if ( !strcmp(s, "stable:socket") )
         tsc_flags |= TSC_RELIABLE_SOCKET;
+    else if ( !strcmp(s, "hwscale") )
+        opt_tsc_hwscale = true;
     else
         return -EINVAL;
 
@@ -2154,9 +2207,10 @@ void tsc_get_info(struct domain *d, uint32_t *tsc_mode,
         *elapsed_nsec = *gtsc_khz = 0;
         break;
     case TSC_MODE_DEFAULT:
+    case TSC_MODE_ALWAYS_EMULATE:
+        /* Always-emulate domains run de-emulated with "tsc=hwscale". */
         if ( d->arch.vtsc )
         {
-    case TSC_MODE_ALWAYS_EMULATE:
             *elapsed_nsec = get_s_time() - d->arch.vtsc_offset;
             *gtsc_khz = d->arch.tsc_khz;
             break;
@@ -2205,8 +2259,13 @@ int tsc_set_info(struct domain *d,
          * - for HVM/PVH - via TSC scaling).
          * When a guest is created, gtsc_khz is passed in as zero, making
          * d->arch.tsc_khz == cpu_khz. Thus no need to check incarnation.
+         * With "tsc=hwscale", always-emulate domains take the same path:
+         * the guest observes the same deterministic frequency through
+         * hardware scaling, but rdtsc no longer traps.
          */
-        if ( tsc_mode == TSC_MODE_DEFAULT && host_tsc_is_safe() &&
+        if ( (tsc_mode == TSC_MODE_DEFAULT ||
+              (tsc_mode == TSC_MODE_ALWAYS_EMULATE && opt_tsc_hwscale)) &&
+             host_tsc_is_safe() &&
              (d->arch.tsc_khz == cpu_khz ||
               (is_hvm_domain(d) &&
                hvm_get_tsc_scaling_ratio(d->arch.tsc_khz))) )
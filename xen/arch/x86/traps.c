@@ -878,6 +878,8 @@ void cpuid_hypervisor_leaves(const struct vcpu *v, uint32_t leaf,
         res->b = is_viridian_domain(d) ? 0x40000200 : 0x40000000;
         if ( is_pv_domain(d) ) /* Features */
             res->c |= XEN_CPUID_FEAT1_MMU_PT_UPDATE_PRESERVE_AD;
+        else                   /* Features */
+            res->c |= XEN_CPUID_FEAT1_HVM_PV_TLB_FLUSH;
         break;
 
     case 3: /* Time leaf. */
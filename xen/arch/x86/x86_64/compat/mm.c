@@ -114,6 +114,9 @@ int compat_arch_memory_op(unsigned long cmd, XEN_GUEST_HANDLE_PARAM(void) arg)
     {
         unsigned long limit;
         compat_pfn_t last_mfn;
+        /* Batch the guest copies; one L2 entry covers 512 frames anyway. */
+        compat_pfn_t mfns[64];
+        unsigned int nr = 0;
 
         if ( copy_from_guest(&xmml, arg, 1) )
             return -EFAULT;
@@ -131,11 +134,20 @@ int compat_arch_memory_op(unsigned long cmd, XEN_GUEST_HANDLE_PARAM(void) arg)
             else
                 mfn = last_mfn;
             ASSERT(mfn);
-            if ( copy_to_compat_offset(xmml.extent_start, i, &mfn, 1) )
-                return -EFAULT;
+            mfns[nr++] = mfn;
+            if ( nr == ARRAY_SIZE(mfns) )
+            {
+                if ( copy_to_compat_offset(xmml.extent_start, i + 1 - nr,
+                                           mfns, nr) )
+                    return -EFAULT;
+                nr = 0;
+            }
             last_mfn = mfn;
         }
 
+        if ( nr && copy_to_compat_offset(xmml.extent_start, i - nr, mfns, nr) )
+            return -EFAULT;
+
         xmml.nr_extents = i;
         if ( __copy_to_guest(arg, &xmml, 1) )
             rc = -EFAULT;
@@ -41,6 +41,22 @@ arch_compat_vcpu_op(
         break;
     }
 
+    case VCPUOP_register_runstate_ring:
+    {
+        union {
+            struct compat_vcpu_register_runstate_ring compat;
+            struct vcpu_register_runstate_ring native;
+        } area = { };
+
+        rc = -EFAULT;
+        if ( copy_from_guest(&area.compat.addr.v, arg, 1) )
+            break;
+
+        rc = map_runstate_ring(v, &area.native);
+
+        break;
+    }
+
     case VCPUOP_get_physid:
         rc = arch_do_vcpu_op(cmd, v, arg);
         break;
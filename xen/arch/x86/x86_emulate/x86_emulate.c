@@ -811,6 +811,24 @@ struct x86_emulate_state {
 #define PTR_POISON NULL /* 32-bit builds are for user-space, so NULL is OK. */
 #endif
 
+/* Layout of the opaque data[] portion of struct x86_decode_cache. */
+struct x86_decode_cache_data {
+    struct x86_emulate_state state;
+    struct cpu_user_regs regs;
+};
+
+/*
+ * Rebase a cached decode's pointers into the register file onto the
+ * current invocation's shadow copy of the registers.
+ */
+static void decode_cache_rebase(struct x86_emulate_state *s,
+                                struct cpu_user_regs *regs)
+{
+    if ( s->ea.type == OP_REG )
+        s->ea.reg = (void *)s->ea.reg + ((void *)regs - (void *)s->regs);
+    s->regs = regs;
+}
+
 typedef union {
     uint64_t mmx;
     uint64_t __attribute__ ((aligned(16))) xmm[2];
@@ -3400,6 +3418,7 @@ x86_emulate(
         unsigned int line;
     } stub_exn;
 #endif
+    struct x86_decode_cache *dc = ctxt->decode_cache;
 
     ASSERT(ops->read);
 
@@ -3410,10 +3429,75 @@ x86_emulate(
                            (_regs.eflags & X86_EFLAGS_VIP)),
                           EXC_GP, 0);
 
+    if ( dc )
+    {
+        const struct x86_decode_cache_data *data = (const void *)dc->data;
+
+        BUILD_BUG_ON(sizeof(*data) > sizeof(dc->data));
+
+        if ( dc->valid &&
+             dc->addr_size == ctxt->addr_size &&
+             dc->sp_size == ctxt->sp_size &&
+             dc->lma == ctxt->lma &&
+             !memcmp(&data->regs, ctxt->regs, sizeof(data->regs)) )
+        {
+            uint8_t insn[MAX_INST_LEN];
+
+            if ( ops->insn_fetch(x86_seg_cs, _regs.r(ip), insn,
+                                 dc->insn_len, ctxt) == X86EMUL_OKAY &&
+                 !memcmp(insn, dc->insn, dc->insn_len) )
+            {
+                /*
+                 * Same mode, register file and instruction bytes: decoding
+                 * now would produce the same result as the cached one did.
+                 */
+                state = data->state;
+                decode_cache_rebase(&state, &_regs);
+                ctxt->opcode = dc->opcode;
+#ifdef __XEN__
+                perfc_incr(decode_cache_hit);
+#endif
+                goto decode_done;
+            }
+
+            if ( ctxt->event_pending )
+                x86_emul_reset_event(ctxt);
+        }
+
+        dc->valid = false;
+#ifdef __XEN__
+        perfc_incr(decode_cache_miss);
+#endif
+    }
+
     rc = x86_decode(&state, ctxt, ops);
     if ( rc != X86EMUL_OKAY )
         return rc;
 
+    if ( dc )
+    {
+        unsigned long len = state.ip - _regs.r(ip);
+
+        if ( len && len <= MAX_INST_LEN &&
+             ops->insn_fetch(x86_seg_cs, _regs.r(ip), dc->insn, len,
+                             ctxt) == X86EMUL_OKAY )
+        {
+            struct x86_decode_cache_data *data = (void *)dc->data;
+
+            dc->insn_len = len;
+            dc->addr_size = ctxt->addr_size;
+            dc->sp_size = ctxt->sp_size;
+            dc->lma = ctxt->lma;
+            dc->opcode = ctxt->opcode;
+            data->state = state;
+            data->regs = *ctxt->regs;
+            dc->valid = true;
+        }
+        else if ( ctxt->event_pending )
+            x86_emul_reset_event(ctxt);
+    }
+
+ decode_done:
     /* Sync rIP to post decode value. */
     _regs.r(ip) = state.ip;
 
@@ -496,6 +496,25 @@ struct x86_emulate_ops
 
 struct cpu_user_regs;
 
+/*
+ * Cache of the most recently decoded instruction, optionally supplied by
+ * the caller via x86_emulate_ctxt.decode_cache (typically one per vCPU).
+ * Contents are managed entirely by x86_emulate(): a cached decode is only
+ * reused when the execution mode, the whole register file and the
+ * instruction bytes all match, in which case decoding is deterministic.
+ */
+struct x86_decode_cache {
+    bool valid;
+    bool lma;
+    uint8_t insn_len;
+    unsigned int addr_size;
+    unsigned int sp_size;
+    unsigned int opcode;
+    uint8_t insn[MAX_INST_LEN];
+    /* Decoded state and register snapshot; opaque to callers. */
+    unsigned long data[64];
+};
+
 struct x86_emulate_ctxt
 {
     /*
@@ -508,6 +527,9 @@ struct x86_emulate_ctxt
     /* Set this if writes may have side effects. */
     bool force_writeback;
 
+    /* Optional cache of decoded instructions (may be NULL). */
+    struct x86_decode_cache *decode_cache;
+
     /* Caller data that can be used by x86_emulate_ops' routines. */
     void *data;
 
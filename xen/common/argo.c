@@ -26,6 +26,7 @@
 #include <xen/nospec.h>
 #include <xen/sched.h>
 #include <xen/time.h>
+#include <xen/vmap.h>
 #include <xsm/xsm.h>
 
 #include <public/argo.h>
@@ -126,6 +127,8 @@ struct argo_ring_info
     unsigned int tx_ptr;
     /* mapped ring pages protected by L3 */
     void **mfn_mapping;
+    /* contiguous mapping of the whole ring, if established, protected by L3 */
+    void *ring_map;
     /* list of mfns of guest ring, protected by L3 */
     mfn_t *mfns;
     /* list of struct pending_ent for this ring, protected by L3 */
@@ -460,6 +463,12 @@ ring_unmap(const struct domain *d, struct argo_ring_info *ring_info)
 
     ASSERT(LOCKING_L3(d, ring_info));
 
+    if ( ring_info->ring_map )
+    {
+        vunmap(ring_info->ring_map);
+        ring_info->ring_map = NULL;
+    }
+
     if ( !ring_info->mfn_mapping )
         return;
 
@@ -486,11 +495,10 @@ ring_map_page(const struct domain *d, struct argo_ring_info *ring_info,
     ASSERT(LOCKING_L3(d, ring_info));
 
     /*
-     * FIXME: Investigate using vmap to create a single contiguous virtual
-     * address space mapping of the ring instead of using the array of single
-     * page mappings.
-     * Affects logic in memcpy_to_guest_ring, the mfn_mapping array data
-     * structure, and places where ring mappings are added or removed.
+     * The bulk data path (memcpy_to_guest_ring) uses a single contiguous
+     * vmap of the whole ring instead; see ring_map_whole.  These per-page
+     * mappings remain for accesses to the ring header and as the fallback
+     * when the vmap cannot be established.
      */
 
     if ( i >= ring_info->nmfns )
@@ -531,6 +539,30 @@ ring_map_page(const struct domain *d, struct argo_ring_info *ring_info,
     return 0;
 }
 
+/*
+ * Map the whole ring contiguously, on first use.  A message spanning
+ * multiple ring pages can then be written with a single access rather
+ * than page at a time.  Returns NULL (leaving callers to fall back to
+ * the per-page mappings) if the address space reservation fails.
+ */
+static void *
+ring_map_whole(const struct domain *d, struct argo_ring_info *ring_info)
+{
+    ASSERT(LOCKING_L3(d, ring_info));
+
+    if ( !ring_info->ring_map && ring_info->mfns && ring_info->nmfns )
+    {
+        ring_info->ring_map = vmap(ring_info->mfns, ring_info->nmfns);
+        if ( ring_info->ring_map )
+            argo_dprintk("mapping ring (vm%u:%x vm%u) %u pages to %p\n",
+                         ring_info->id.domain_id, ring_info->id.aport,
+                         ring_info->id.partner_id, ring_info->nmfns,
+                         ring_info->ring_map);
+    }
+
+    return ring_info->ring_map;
+}
+
 static void
 update_tx_ptr(const struct domain *d, struct argo_ring_info *ring_info,
               uint32_t tx_ptr)
@@ -560,11 +592,26 @@ memcpy_to_guest_ring(const struct domain *d, struct argo_ring_info *ring_info,
 
     ASSERT(LOCKING_L3(d, ring_info));
 
-    offset &= ~PAGE_MASK;
-
     if ( len + offset > XEN_ARGO_MAX_RING_SIZE )
         return -EFAULT;
 
+    /* Fast path: one access covers the whole (possibly multi-page) copy. */
+    dst = ring_map_whole(d, ring_info);
+    if ( likely(dst) )
+    {
+        if ( len + offset > (ring_info->nmfns << PAGE_SHIFT) )
+            return -ENOMEM;
+
+        if ( src )
+            memcpy(dst + offset, src, len);
+        else if ( copy_from_guest(dst + offset, src_hnd, len) )
+            return -EFAULT;
+
+        return 0;
+    }
+
+    offset &= ~PAGE_MASK;
+
     while ( len )
     {
         unsigned int head_len = (offset + len) > PAGE_SIZE ? PAGE_SIZE - offset
@@ -17,6 +17,70 @@ CHECK_TYPE(domid);
 
 CHECK_vmemrange;
 
+/*
+ * Bounce an array of compat_pfn_t into the translation area with a single
+ * guest access, widening to xen_pfn_t in place.  The compat entries are
+ * staged in the upper half of the (twice as wide) native array, so widening
+ * entry i never overwrites a not-yet-read staged entry.  Returns the number
+ * of entries copied; in the (unlikely) event of a fault the exact boundary
+ * is established element by element.
+ */
+static unsigned int copy_pfns_from_compat(xen_pfn_t *space,
+                                          COMPAT_HANDLE(compat_pfn_t) from,
+                                          unsigned int start, unsigned int n)
+{
+    compat_pfn_t *staging = (compat_pfn_t *)space + n;
+    unsigned int i;
+
+    if ( likely(!__copy_from_compat_offset(staging, from, start, n)) )
+    {
+        for ( i = 0; i < n; ++i )
+            space[i] = staging[i];
+        return n;
+    }
+
+    for ( i = 0; i < n; ++i )
+    {
+        compat_pfn_t pfn;
+
+        if ( __copy_from_compat_offset(&pfn, from, start + i, 1) )
+            break;
+        space[i] = pfn;
+    }
+
+    return i;
+}
+
+/*
+ * The outbound counterpart: narrow the native array in place (the write at
+ * index i never passes the read) and push the result out with one guest
+ * access, again falling back to element-by-element copies on a fault.
+ */
+static unsigned int copy_pfns_to_compat(COMPAT_HANDLE(compat_pfn_t) to,
+                                        xen_pfn_t *space,
+                                        unsigned int start, unsigned int n)
+{
+    compat_pfn_t *narrow = (compat_pfn_t *)space;
+    unsigned int i;
+
+    for ( i = 0; i < n; ++i )
+    {
+        compat_pfn_t pfn = space[i];
+
+        BUG_ON(pfn != space[i]);
+        narrow[i] = pfn;
+    }
+
+    if ( likely(!__copy_to_compat_offset(to, start, narrow, n)) )
+        return n;
+
+    for ( i = 0; i < n; ++i )
+        if ( __copy_to_compat_offset(to, start + i, &narrow[i], 1) )
+            break;
+
+    return i;
+}
+
 #ifdef CONFIG_HAS_PASSTHROUGH
 struct get_reserved_device_memory {
     struct compat_reserved_device_memory_map map;
@@ -117,16 +181,15 @@ int compat_memory_op(unsigned int cmd, XEN_GUEST_HANDLE_PARAM(void) compat)
                     set_xen_guest_handle((_d_)->extent_start, space - start_extent); \
                     if ( op != XENMEM_increase_reservation ) \
                     { \
-                        for ( i = start_extent; i < end_extent; ++i ) \
+                        unsigned int done_ = \
+                            copy_pfns_from_compat(space, (_s_)->extent_start, \
+                                                  start_extent, \
+                                                  end_extent - start_extent); \
+                        space += done_; \
+                        if ( start_extent + done_ != end_extent ) \
                         { \
-                            compat_pfn_t pfn; \
-                            if ( __copy_from_compat_offset(&pfn, (_s_)->extent_start, i, 1) ) \
-                            { \
-                                end_extent = i; \
-                                split = -1; \
-                                break; \
-                            } \
-                            *space++ = pfn; \
+                            end_extent = start_extent + done_; \
+                            split = -1; \
                         } \
                     } \
                 } \
@@ -195,13 +258,12 @@ int compat_memory_op(unsigned int cmd, XEN_GUEST_HANDLE_PARAM(void) compat)
             do \
             { \
                 set_xen_guest_handle((_d_)->extent_start, space - start_extent); \
-                for ( i = start_extent; i < end_extent; ++i ) \
-                { \
-                    compat_pfn_t pfn; \
-                    if ( __copy_from_compat_offset(&pfn, (_s_)->extent_start, i, 1) ) \
-                        return -EFAULT; \
-                    *space++ = pfn; \
-                } \
+                if ( copy_pfns_from_compat(space, (_s_)->extent_start, \
+                                           start_extent, \
+                                           end_extent - start_extent) != \
+                     end_extent - start_extent ) \
+                    return -EFAULT; \
+                space += end_extent - start_extent; \
                 if ( order_delta > 0 ) \
                 { \
                     start_extent >>= order_delta; \
@@ -276,21 +338,25 @@ int compat_memory_op(unsigned int cmd, XEN_GUEST_HANDLE_PARAM(void) compat)
             if ( end_extent > size )
                 end_extent = size;
 
-            idxs -= start_extent;
-            gpfns -= start_extent;
-
-            for ( i = start_extent; i < end_extent; ++i )
             {
-                compat_ulong_t idx;
-                compat_pfn_t gpfn;
+                unsigned int n = end_extent - start_extent;
+                /* Stage the compat entries as copy_pfns_from_compat() does. */
+                compat_ulong_t *cidxs = (compat_ulong_t *)idxs + n;
 
-                if ( __copy_from_compat_offset(&idx, cmp.atpb.idxs, i, 1) ||
-                     __copy_from_compat_offset(&gpfn, cmp.atpb.gpfns, i, 1) )
+                if ( __copy_from_compat_offset(cidxs, cmp.atpb.idxs,
+                                               start_extent, n) )
+                    return -EFAULT;
+                for ( i = 0; i < n; ++i )
+                    idxs[i] = cidxs[i];
+
+                if ( copy_pfns_from_compat(gpfns, cmp.atpb.gpfns,
+                                           start_extent, n) != n )
                     return -EFAULT;
-                idxs[i] = idx;
-                gpfns[i] = gpfn;
             }
 
+            idxs -= start_extent;
+            gpfns -= start_extent;
+
 #define XLAT_add_to_physmap_batch_HNDL_idxs(_d_, _s_) \
             set_xen_guest_handle((_d_)->idxs, idxs)
 #define XLAT_add_to_physmap_batch_HNDL_gpfns(_d_, _s_) \
@@ -427,16 +493,10 @@ int compat_memory_op(unsigned int cmd, XEN_GUEST_HANDLE_PARAM(void) compat)
                                          cmp.mar.nr_frames) )
                     return -EFAULT;
 
-                for ( i = 0; i < cmp.mar.nr_frames; i++ )
-                {
-                    compat_pfn_t frame;
-
-                    if ( __copy_from_compat_offset(
-                             &frame, cmp.mar.frame_list, i, 1) )
-                        return -EFAULT;
-
-                    xen_frame_list[i] = frame;
-                }
+                if ( copy_pfns_from_compat(xen_frame_list, cmp.mar.frame_list,
+                                           0, cmp.mar.nr_frames) !=
+                     cmp.mar.nr_frames )
+                    return -EFAULT;
             }
 
 #define XLAT_mem_acquire_resource_HNDL_frame_list(_d_, _s_) \
@@ -483,28 +543,26 @@ int compat_memory_op(unsigned int cmd, XEN_GUEST_HANDLE_PARAM(void) compat)
             if ( (op != XENMEM_decrease_reservation) &&
                  !guest_handle_is_null(nat.rsrv->extent_start) )
             {
-                for ( ; start_extent < end_extent; ++start_extent )
-                {
-                    compat_pfn_t pfn = nat.rsrv->extent_start.p[start_extent];
+                unsigned int n = end_extent - start_extent;
 
-                    BUG_ON(pfn != nat.rsrv->extent_start.p[start_extent]);
-                    if ( __copy_to_compat_offset(cmp.rsrv.extent_start,
-                                                 start_extent, &pfn, 1) )
+                start_extent +=
+                    copy_pfns_to_compat(cmp.rsrv.extent_start,
+                                        &nat.rsrv->extent_start.p[start_extent],
+                                        start_extent, n);
+                if ( start_extent != end_extent )
+                {
+                    if ( split >= 0 )
                     {
-                        if ( split >= 0 )
-                        {
-                            rc = start_extent;
-                            split = 0;
-                        }
-                        else
-                            /*
-                             * Short of being able to cancel the continuation,
-                             * force it to restart here; eventually we shall
-                             * get out of this state.
-                             */
-                            rc = (start_extent << MEMOP_EXTENT_SHIFT) | op;
-                        break;
+                        rc = start_extent;
+                        split = 0;
                     }
+                    else
+                        /*
+                         * Short of being able to cancel the continuation,
+                         * force it to restart here; eventually we shall
+                         * get out of this state.
+                         */
+                        rc = (start_extent << MEMOP_EXTENT_SHIFT) | op;
                 }
             }
             else
@@ -538,18 +596,14 @@ int compat_memory_op(unsigned int cmd, XEN_GUEST_HANDLE_PARAM(void) compat)
                 end_extent <<= -order_delta;
             }
 
-            for ( ; start_extent < end_extent; ++start_extent )
-            {
-                compat_pfn_t pfn = nat.xchg->out.extent_start.p[start_extent];
-
-                BUG_ON(pfn != nat.xchg->out.extent_start.p[start_extent]);
-                if ( __copy_to_compat_offset(cmp.xchg.out.extent_start,
-                                             start_extent, &pfn, 1) )
-                {
-                    rc = -EFAULT;
-                    break;
-                }
-            }
+            if ( copy_pfns_to_compat(cmp.xchg.out.extent_start,
+                                     &nat.xchg->out.extent_start.p[start_extent],
+                                     start_extent,
+                                     end_extent - start_extent) ==
+                 end_extent - start_extent )
+                start_extent = end_extent;
+            else
+                rc = -EFAULT;
 
             cmp.xchg.nr_exchanged = nat.xchg->nr_exchanged;
             if ( __copy_field_to_guest(guest_handle_cast(compat,
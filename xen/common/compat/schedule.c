@@ -34,7 +34,33 @@ static int compat_poll(struct compat_sched_poll *compat)
     return do_poll(&native);
 }
 
+static int compat_register_poll_set(struct compat_sched_poll *compat)
+{
+    struct sched_poll native;
+
+#define XLAT_sched_poll_HNDL_ports(_d_, _s_) \
+    guest_from_compat_handle((_d_)->ports, (_s_)->ports)
+    XLAT_sched_poll(&native, compat);
+#undef XLAT_sched_poll_HNDL_ports
+
+    return do_register_poll_set(&native);
+}
+
+static int compat_poll_set(struct compat_sched_poll *compat)
+{
+    struct sched_poll native;
+
+#define XLAT_sched_poll_HNDL_ports(_d_, _s_) \
+    guest_from_compat_handle((_d_)->ports, (_s_)->ports)
+    XLAT_sched_poll(&native, compat);
+#undef XLAT_sched_poll_HNDL_ports
+
+    return do_poll_set(&native);
+}
+
 #define do_poll compat_poll
+#define do_register_poll_set compat_register_poll_set
+#define do_poll_set compat_poll_set
 #define sched_poll compat_sched_poll
 
 #include "../schedule.c"
@@ -39,9 +39,11 @@ CHECK_dom0_vga_console_info;
 #define xen_evtchn_close evtchn_close
 #define xen_evtchn_op evtchn_op
 #define xen_evtchn_send evtchn_send
+#define xen_evtchn_send_batch evtchn_send_batch
 #define xen_evtchn_status evtchn_status
 #define xen_evtchn_unmask evtchn_unmask
 CHECK_evtchn_op;
+CHECK_evtchn_send_batch;
 #undef xen_evtchn_alloc_unbound
 #undef xen_evtchn_bind_interdomain
 #undef xen_evtchn_bind_ipi
@@ -51,6 +53,7 @@ CHECK_evtchn_op;
 #undef xen_evtchn_close
 #undef xen_evtchn_op
 #undef xen_evtchn_send
+#undef xen_evtchn_send_batch
 #undef xen_evtchn_status
 #undef xen_evtchn_unmask
 
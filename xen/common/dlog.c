@@ -0,0 +1,159 @@
+/******************************************************************************
+ * common/dlog.c
+ *
+ * Binary structured diagnostics log.
+ *
+ * printk() formats via vsnprintf() and serializes on the console lock,
+ * which is far too heavy for diagnostics in hot paths.  Each CPU here
+ * owns a one page ring of fixed-size binary records (event identifier,
+ * arguments, TSC); writing one is a handful of stores with interrupts
+ * disabled, so DLOGn() call sites can stay enabled in production.  The
+ * rings are drained and formatted from dom0 via XEN_SYSCTL_dlog
+ * (xen-dlog); older records are simply overwritten when a ring wraps.
+ */
+
+#include <xen/types.h>
+#include <xen/lib.h>
+#include <xen/errno.h>
+#include <xen/init.h>
+#include <xen/mm.h>
+#include <xen/smp.h>
+#include <xen/percpu.h>
+#include <xen/cpu.h>
+#include <xen/notifier.h>
+#include <xen/guest_access.h>
+#include <xen/dlog.h>
+#include <asm/time.h>
+
+struct dlog_buf {
+    uint64_t prod;
+    struct xen_dlog_rec rec[];
+};
+
+#define DLOG_BUF_RECS ((PAGE_SIZE - sizeof(struct dlog_buf)) / \
+                       sizeof(struct xen_dlog_rec))
+
+static DEFINE_PER_CPU(struct dlog_buf *, dlog_buf);
+
+void __dlog(uint32_t event, unsigned int nargs,
+            uint64_t a0, uint64_t a1, uint64_t a2, uint64_t a3)
+{
+    struct dlog_buf *buf;
+    struct xen_dlog_rec *rec;
+    unsigned long flags;
+
+    local_irq_save(flags);
+
+    buf = this_cpu(dlog_buf);
+    if ( likely(buf != NULL) )
+    {
+        rec = &buf->rec[buf->prod % DLOG_BUF_RECS];
+        rec->tsc = get_cycles();
+        rec->event = event;
+        rec->nargs = nargs;
+        rec->arg[0] = a0;
+        rec->arg[1] = a1;
+        rec->arg[2] = a2;
+        rec->arg[3] = a3;
+        /* Make the record visible before advancing prod past it. */
+        smp_wmb();
+        write_atomic(&buf->prod, buf->prod + 1);
+    }
+
+    local_irq_restore(flags);
+}
+
+int dlog_sysctl(struct xen_sysctl_dlog *op)
+{
+    const struct dlog_buf *buf;
+    uint64_t prod;
+    unsigned int i, n;
+
+    if ( op->cpu >= nr_cpu_ids )
+        return -EINVAL;
+
+    buf = per_cpu(dlog_buf, op->cpu);
+    if ( buf == NULL )
+        return -ENODEV;
+
+    /*
+     * Read without stopping the producer: prod is sampled once and only
+     * records it already covers are copied.  The producer may overwrite
+     * the oldest of those while we copy - a bounded risk of one torn
+     * record per wrap, which the consumer tolerates for diagnostics.
+     */
+    prod = read_atomic(&buf->prod);
+    smp_rmb();
+
+    n = min_t(uint64_t, prod, DLOG_BUF_RECS);
+    if ( n > op->nr_recs )
+        n = op->nr_recs;
+
+    for ( i = 0; i < n; i++ )
+    {
+        struct xen_dlog_rec rec = buf->rec[(prod - n + i) % DLOG_BUF_RECS];
+
+        if ( copy_to_guest_offset(op->recs, i, &rec, 1) )
+            return -EFAULT;
+    }
+
+    op->nr_recs = n;
+    op->prod = prod;
+
+    return 0;
+}
+
+static int dlog_alloc_buf(unsigned int cpu)
+{
+    void *p;
+
+    if ( per_cpu(dlog_buf, cpu) != NULL )
+        return 0;
+
+    p = alloc_xenheap_page();
+    if ( p == NULL )
+        return -ENOMEM;
+
+    clear_page(p);
+    per_cpu(dlog_buf, cpu) = p;
+
+    return 0;
+}
+
+static int cpu_callback(
+    struct notifier_block *nfb, unsigned long action, void *hcpu)
+{
+    unsigned int cpu = (unsigned long)hcpu;
+
+    if ( action == CPU_UP_PREPARE )
+        dlog_alloc_buf(cpu);
+
+    return NOTIFY_DONE;
+}
+
+static struct notifier_block cpu_nfb = {
+    .notifier_call = cpu_callback
+};
+
+static int __init dlog_init(void)
+{
+    unsigned int cpu;
+
+    for_each_online_cpu ( cpu )
+        dlog_alloc_buf(cpu);
+
+    register_cpu_notifier(&cpu_nfb);
+
+    return 0;
+}
+__initcall(dlog_init);
+
+/*
+ * Local variables:
+ * mode: C
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
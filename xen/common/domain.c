@@ -66,6 +66,9 @@ DEFINE_RCU_READ_LOCK(domlist_read_lock);
 static struct domain *domain_hash[DOMAIN_HASH_SIZE];
 struct domain *domain_list;
 
+/* Bumped (under domlist_update_lock) whenever the domain list changes. */
+uint64_t domlist_generation;
+
 struct domain *hardware_domain __read_mostly;
 
 #ifdef CONFIG_LATE_HWDOM
@@ -77,6 +80,8 @@ struct vcpu *idle_vcpu[NR_CPUS] __read_mostly;
 
 vcpu_info_t dummy_vcpu_info;
 
+static void domain_destroy_work(unsigned long data);
+
 static void __domain_finalise_shutdown(struct domain *d)
 {
     struct vcpu *v;
@@ -150,6 +155,7 @@ struct vcpu *vcpu_create(
     v->dirty_cpu = VCPU_CPU_CLEAN;
 
     spin_lock_init(&v->virq_lock);
+    INIT_LIST_HEAD(&v->sleeplock_waiter);
 
     tasklet_init(&v->continue_hypercall_tasklet, NULL, 0);
 
@@ -278,6 +284,7 @@ static void _domain_destroy(struct domain *d)
     BUG_ON(atomic_read(&d->refcnt) != DOMAIN_DESTROYED);
 
     xfree(d->pbuf);
+    xfree(d->cbuf);
 
     argo_destroy(d);
 
@@ -377,6 +384,7 @@ struct domain *domain_create(domid_t domid,
     atomic_set(&d->refcnt, 1);
     spin_lock_init_prof(d, domain_lock);
     spin_lock_init_prof(d, page_alloc_lock);
+    seqcount_init(&d->page_alloc_count);
     spin_lock_init(&d->hypercall_deadlock_mutex);
     INIT_PAGE_LIST_HEAD(&d->page_list);
     INIT_PAGE_LIST_HEAD(&d->xenpage_list);
@@ -389,9 +397,12 @@ struct domain *domain_create(domid_t domid,
     d->shutdown_code = SHUTDOWN_CODE_INVALID;
 
     spin_lock_init(&d->pbuf_lock);
+    INIT_LIST_HEAD(&d->cbuf_list);
 
     rwlock_init(&d->vnuma_rwlock);
 
+    tasklet_init(&d->destroy_tasklet, domain_destroy_work, (unsigned long)d);
+
     err = -ENOMEM;
     if ( !zalloc_cpumask_var(&d->dirty_cpumask) )
         goto fail;
@@ -458,6 +469,10 @@ struct domain *domain_create(domid_t domid,
         if ( !d->pbuf )
             goto fail;
 
+        d->cbuf = xzalloc_array(char, DOMAIN_CBUF_SIZE);
+        if ( !d->cbuf )
+            goto fail;
+
         if ( (err = sched_init_domain(d, 0)) != 0 )
             goto fail;
 
@@ -478,6 +493,7 @@ struct domain *domain_create(domid_t domid,
         d->next_in_hashbucket = domain_hash[DOMAIN_HASH(domid)];
         rcu_assign_pointer(*pd, d);
         rcu_assign_pointer(domain_hash[DOMAIN_HASH(domid)], d);
+        domlist_generation++;
         spin_unlock(&domlist_update_lock);
 
         memcpy(d->handle, config->handle, sizeof(d->handle));
@@ -701,11 +717,66 @@ int rcu_lock_live_remote_domain_by_id(domid_t dom, struct domain **d)
     return 0;
 }
 
-int domain_kill(struct domain *d)
+/*
+ * Tear down a dying domain's resources.  Returns -ERESTART if preempted,
+ * in which case the caller is expected to come back here once pending
+ * softirqs have been serviced.
+ */
+static int domain_teardown(struct domain *d)
 {
-    int rc = 0;
     struct vcpu *v;
+    int rc;
+
+    ASSERT(d->is_dying == DOMDYING_dying);
 
+    rc = domain_relinquish_resources(d);
+    if ( rc != 0 )
+        return rc;
+    if ( cpupool_move_domain(d, cpupool0) )
+        return -ERESTART;
+    for_each_vcpu ( d, v )
+    {
+        unmap_runstate_area(v);
+        unmap_runstate_ring(v);
+        unmap_event_doorbell(v);
+        unmap_vcpu_info(v);
+    }
+    d->is_dying = DOMDYING_dead;
+    /* Mem event cleanup has to go here because the rings
+     * have to be put before we call put_domain. */
+    vm_event_cleanup(d);
+    put_domain(d);
+    send_global_virq(VIRQ_DOM_EXC);
+
+    return 0;
+}
+
+static void domain_destroy_work(unsigned long data)
+{
+    struct domain *d = (struct domain *)data;
+    int rc;
+
+    domain_lock(d);
+    rc = d->is_dying == DOMDYING_dying ? domain_teardown(d) : 0;
+    domain_unlock(d);
+
+    if ( rc == -ERESTART )
+    {
+        /* Yield to softirqs (in particular the scheduler) and try again. */
+        tasklet_schedule(&d->destroy_tasklet);
+        return;
+    }
+
+    if ( rc )
+        printk(XENLOG_G_ERR
+               "%pd teardown failed: %d; domain left as a zombie\n", d, rc);
+
+    /* Drop the reference taken when the work was scheduled. */
+    put_domain(d);
+}
+
+int domain_kill(struct domain *d)
+{
     if ( d == current->domain )
         return -EINVAL;
 
@@ -731,30 +802,22 @@ int domain_kill(struct domain *d)
         vnuma_destroy(d->vnuma);
         domain_set_outstanding_pages(d, 0);
         d->tmem_client = NULL;
+        /*
+         * The expensive part of teardown runs as background work, so the
+         * caller neither blocks on it nor needs continuation handling.
+         * Completion is signalled via VIRQ_DOM_EXC; until then progress
+         * can be observed through XEN_DOMCTL_getdomaininfo (the dying
+         * flag is set and tot_pages drains to zero).
+         */
+        if ( get_domain(d) )
+            tasklet_schedule(&d->destroy_tasklet);
         /* fallthrough */
     case DOMDYING_dying:
-        rc = domain_relinquish_resources(d);
-        if ( rc != 0 )
-            break;
-        if ( cpupool_move_domain(d, cpupool0) )
-            return -ERESTART;
-        for_each_vcpu ( d, v )
-        {
-            unmap_runstate_area(v);
-            unmap_vcpu_info(v);
-        }
-        d->is_dying = DOMDYING_dead;
-        /* Mem event cleanup has to go here because the rings 
-         * have to be put before we call put_domain. */
-        vm_event_cleanup(d);
-        put_domain(d);
-        send_global_virq(VIRQ_DOM_EXC);
-        /* fallthrough */
     case DOMDYING_dead:
         break;
     }
 
-    return rc;
+    return 0;
 }
 
 
@@ -904,6 +967,8 @@ static void complete_domain_destroy(struct rcu_head *head)
      */
     sync_local_execstate();
 
+    tasklet_kill(&d->destroy_tasklet);
+
     for ( i = d->max_vcpus - 1; i >= 0; i-- )
     {
         if ( (v = d->vcpu[i]) == NULL )
@@ -976,10 +1041,11 @@ void domain_destroy(struct domain *d)
     while ( *pd != d ) 
         pd = &(*pd)->next_in_hashbucket;
     rcu_assign_pointer(*pd, d->next_in_hashbucket);
+    domlist_generation++;
     spin_unlock(&domlist_update_lock);
 
     /* Schedule RCU asynchronous completion of domain destroy. */
-    call_rcu(&d->rcu, complete_domain_destroy);
+    call_rcu_expedited(&d->rcu, complete_domain_destroy);
 }
 
 void vcpu_pause(struct vcpu *v)
@@ -1072,8 +1138,13 @@ void domain_unpause(struct domain *d)
     arch_domain_unpause(d);
 
     if ( atomic_dec_and_test(&d->pause_count) )
+    {
+        /* Waking all vcpus tickles pcpus; send each at most one IPI. */
+        cpu_raise_softirq_batch_begin();
         for_each_vcpu( d, v )
             vcpu_wake(v);
+        cpu_raise_softirq_batch_finish();
+    }
 }
 
 int __domain_pause_by_systemcontroller(struct domain *d,
@@ -1197,6 +1268,8 @@ int domain_soft_reset(struct domain *d)
     for_each_vcpu ( d, v )
     {
         unmap_runstate_area(v);
+        unmap_runstate_ring(v);
+        unmap_event_doorbell(v);
         unmap_vcpu_info(v);
     }
 
@@ -1427,6 +1500,142 @@ void unmap_runstate_area(struct vcpu *v)
     v->runstate_nr = 0;
 }
 
+int map_runstate_ring(struct vcpu *v,
+                      struct vcpu_register_runstate_ring *area)
+{
+    struct page_info *pg;
+    struct vcpu_runstate_ring *ring;
+    mfn_t mfn;
+#ifdef CONFIG_X86
+    p2m_type_t t;
+    struct domain *d = v->domain;
+    uint32_t pfec = PFEC_page_present;
+    gfn_t gfn;
+#endif
+
+    if ( area->addr.p & ~PAGE_MASK )
+        return -EINVAL;
+
+    /*
+     * Writers dereference v->runstate_ring with the scheduler lock held
+     * but without further synchronisation, so the registration cannot
+     * safely be replaced while the vcpu can still be scheduled.
+     */
+    if ( v->runstate_ring )
+        return -EBUSY;
+
+#ifdef CONFIG_X86
+    gfn = _gfn(paging_gva_to_gfn(v, area->addr.p, &pfec));
+    if ( gfn_eq(gfn, INVALID_GFN) )
+        return -EFAULT;
+
+    mfn = get_gfn(d, gfn_x(gfn), &t);
+    if ( t != p2m_ram_rw || mfn_eq(mfn, INVALID_MFN) )
+    {
+        put_gfn(d, gfn_x(gfn));
+        return -EFAULT;
+    }
+
+    pg = mfn_to_page(mfn);
+    if ( !pg || !get_page_and_type(pg, d, PGT_writable_page) )
+    {
+        put_gfn(d, gfn_x(gfn));
+        return -EFAULT;
+    }
+    put_gfn(d, gfn_x(gfn));
+#elif defined(CONFIG_ARM)
+    pg = get_page_from_gva(v, area->addr.p, GV2M_WRITE);
+    if ( !pg || !get_page_type(pg, PGT_writable_page) )
+        return -EFAULT;
+
+    mfn = page_to_mfn(pg);
+#else
+#error Unsopported arquitecture
+#endif
+
+    ring = vmap(&mfn, 1);
+    if ( !ring )
+    {
+        put_page_and_type(pg);
+        return -ENOMEM;
+    }
+
+    clear_page(ring);
+    ring->size = RUNSTATE_RING_ENTRIES;
+    smp_wmb();
+
+    v->runstate_ring_mfn = mfn;
+    v->runstate_ring = ring;
+
+    return 0;
+}
+
+void unmap_runstate_ring(struct vcpu *v)
+{
+    if ( !v->runstate_ring )
+        return;
+
+    vunmap(v->runstate_ring);
+    put_page_and_type(mfn_to_page(v->runstate_ring_mfn));
+    v->runstate_ring = NULL;
+}
+
+int map_event_doorbell(struct vcpu *v, unsigned long gfn, unsigned int offset)
+{
+    struct domain *d = v->domain;
+    struct page_info *page;
+    void *mapping;
+
+    if ( (offset > (PAGE_SIZE - sizeof(*v->event_doorbell))) ||
+         (offset & (sizeof(*v->event_doorbell) - 1)) )
+        return -EINVAL;
+
+    /*
+     * Senders dereference v->event_doorbell without synchronisation, so
+     * the registration cannot safely be replaced.
+     */
+    if ( v->event_doorbell )
+        return -EBUSY;
+
+    page = get_page_from_gfn(d, gfn, NULL, P2M_ALLOC);
+    if ( !page )
+        return -EINVAL;
+
+    if ( !get_page_type(page, PGT_writable_page) )
+    {
+        put_page(page);
+        return -EINVAL;
+    }
+
+    mapping = __map_domain_page_global(page);
+    if ( mapping == NULL )
+    {
+        put_page_and_type(page);
+        return -ENOMEM;
+    }
+
+    v->event_doorbell_mfn = page_to_mfn(page);
+    smp_wmb();
+    v->event_doorbell = mapping + offset;
+
+    /* Events may already be pending; don't leave the guest waiting. */
+    write_atomic(v->event_doorbell, 1);
+
+    return 0;
+}
+
+void unmap_event_doorbell(struct vcpu *v)
+{
+    void *mapping = v->event_doorbell;
+
+    if ( !mapping )
+        return;
+
+    v->event_doorbell = NULL;
+    unmap_domain_page_global((void *)((unsigned long)mapping & PAGE_MASK));
+    put_page_and_type(mfn_to_page(v->event_doorbell_mfn));
+}
+
 int default_initialise_vcpu(struct vcpu *v, XEN_GUEST_HANDLE_PARAM(void) arg)
 {
     struct vcpu_guest_context *ctxt;
@@ -1619,6 +1828,32 @@ long do_vcpu_op(int cmd, unsigned int vcpuid, XEN_GUEST_HANDLE_PARAM(void) arg)
         break;
     }
 
+    case VCPUOP_register_runstate_ring:
+    {
+        struct vcpu_register_runstate_ring area;
+
+        rc = -EFAULT;
+        if ( copy_from_guest(&area, arg, 1) )
+            break;
+
+        rc = map_runstate_ring(v, &area);
+
+        break;
+    }
+
+    case VCPUOP_register_event_doorbell:
+    {
+        struct vcpu_register_event_doorbell db;
+
+        rc = -EFAULT;
+        if ( copy_from_guest(&db, arg, 1) )
+            break;
+
+        rc = db.rsvd ? -EINVAL : map_event_doorbell(v, db.mfn, db.offset);
+
+        break;
+    }
+
 #ifdef VCPU_TRAP_NMI
     case VCPUOP_send_nmi:
         if ( !guest_handle_is_null(arg) )
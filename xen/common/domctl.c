@@ -12,8 +12,10 @@
 #include <xen/mm.h>
 #include <xen/sched.h>
 #include <xen/sched-if.h>
+#include <xen/sleeplock.h>
 #include <xen/domain.h>
 #include <xen/event.h>
+#include <xen/event_fifo.h>
 #include <xen/grant_table.h>
 #include <xen/domain_page.h>
 #include <xen/trace.h>
@@ -33,7 +35,7 @@
 #include <public/domctl.h>
 #include <xsm/xsm.h>
 
-static DEFINE_SPINLOCK(domctl_lock);
+static DEFINE_SLEEPLOCK(domctl_lock);
 
 static int bitmap_to_xenctl_bitmap(struct xenctl_bitmap *xenctl_bitmap,
                                    const unsigned long *bitmap,
@@ -153,6 +155,7 @@ void getdomaininfo(struct domain *d, struct xen_domctl_getdomaininfo *info)
     struct vcpu *v;
     u64 cpu_time = 0;
     int flags = XEN_DOMINF_blocked;
+    unsigned int tot_pages, max_pages, outstanding_pages;
     struct vcpu_runstate_info runstate;
 
     info->domain = d->domain_id;
@@ -200,9 +203,10 @@ void getdomaininfo(struct domain *d, struct xen_domctl_getdomaininfo *info)
 
     xsm_security_domaininfo(d, info);
 
-    info->tot_pages         = d->tot_pages;
-    info->max_pages         = d->max_pages;
-    info->outstanding_pages = d->outstanding_pages;
+    domain_get_accounting(d, &tot_pages, &max_pages, &outstanding_pages);
+    info->tot_pages         = tot_pages;
+    info->max_pages         = max_pages;
+    info->outstanding_pages = outstanding_pages;
     info->shr_pages         = atomic_read(&d->shr_pages);
     info->paged_pages       = atomic_read(&d->paged_pages);
     info->shared_info_frame = mfn_to_gmfn(d, virt_to_mfn(d->shared_info));
@@ -225,11 +229,14 @@ bool_t domctl_lock_acquire(void)
         return 0;
 
     /*
-     * Trylock here is paranoia if we have multiple privileged domains. Then
-     * we could have one domain trying to pause another which is spinning
-     * on domctl_lock -- results in deadlock.
+     * Spin briefly, then park on the lock's waiter list.  A parked caller
+     * goes back out via a hypercall continuation and retries once the
+     * holder wakes it, instead of burning the CPU at hypercall rate for
+     * the duration of long-hold operations like domain build.  Parking
+     * also removes the old trylock deadlock concern: a parked vcpu holds
+     * nothing and can safely be paused by another privileged domain.
      */
-    if ( spin_trylock(&domctl_lock) )
+    if ( sleeplock_acquire(&domctl_lock) )
         return 1;
 
     spin_unlock(&current->domain->hypercall_deadlock_mutex);
@@ -238,7 +245,7 @@ bool_t domctl_lock_acquire(void)
 
 void domctl_lock_release(void)
 {
-    spin_unlock(&domctl_lock);
+    sleeplock_release(&domctl_lock);
     spin_unlock(&current->domain->hypercall_deadlock_mutex);
 }
 
@@ -376,19 +383,69 @@ static struct vnuma_info *vnuma_init(const struct xen_domctl_vnuma *uinfo,
     return ERR_PTR(ret);
 }
 
+/*
+ * Per-subop copy sizes, derived at build time from the public header
+ * types: most subops use only a small slice of the (large) xen_domctl
+ * union, so copy only the header plus the active union member in each
+ * direction.  Subops without an entry - in particular everything
+ * forwarded to arch_do_domctl(), which may copy the full structure
+ * back itself - keep the traditional full-size copy.
+ */
+#define DOMCTL_COPY_HDR offsetof(struct xen_domctl, u)
+#define DOMCTL_COPY(memb) \
+    (DOMCTL_COPY_HDR + sizeof(((struct xen_domctl *)NULL)->u.memb))
+
+static unsigned int domctl_copy_size(unsigned int cmd)
+{
+    static const uint16_t size[] = {
+        [XEN_DOMCTL_pausedomain]     = DOMCTL_COPY_HDR,
+        [XEN_DOMCTL_unpausedomain]   = DOMCTL_COPY_HDR,
+        [XEN_DOMCTL_resumedomain]    = DOMCTL_COPY_HDR,
+        [XEN_DOMCTL_destroydomain]   = DOMCTL_COPY_HDR,
+        [XEN_DOMCTL_getdomaininfo]   = DOMCTL_COPY(getdomaininfo),
+        [XEN_DOMCTL_getvcpuinfo]     = DOMCTL_COPY(getvcpuinfo),
+        [XEN_DOMCTL_setvcpuaffinity] = DOMCTL_COPY(vcpuaffinity),
+        [XEN_DOMCTL_getvcpuaffinity] = DOMCTL_COPY(vcpuaffinity),
+        [XEN_DOMCTL_setnodeaffinity] = DOMCTL_COPY(nodeaffinity),
+        [XEN_DOMCTL_getnodeaffinity] = DOMCTL_COPY(nodeaffinity),
+        [XEN_DOMCTL_max_mem]         = DOMCTL_COPY(max_mem),
+        [XEN_DOMCTL_max_vcpus]       = DOMCTL_COPY(max_vcpus),
+        [XEN_DOMCTL_scheduler_op]    = DOMCTL_COPY(scheduler_op),
+        [XEN_DOMCTL_setdomainhandle] = DOMCTL_COPY(setdomainhandle),
+        [XEN_DOMCTL_settimeoffset]   = DOMCTL_COPY(settimeoffset),
+        [XEN_DOMCTL_getvcpucontexts] = DOMCTL_COPY(vcpucontexts),
+    };
+
+    if ( cmd < ARRAY_SIZE(size) && size[cmd] != 0 )
+        return size[cmd];
+
+    return sizeof(struct xen_domctl);
+}
+
 long do_domctl(XEN_GUEST_HANDLE_PARAM(xen_domctl_t) u_domctl)
 {
     long ret = 0;
     bool_t copyback = 0;
+    unsigned int copy_size;
     struct xen_domctl curop, *op = &curop;
     struct domain *d;
 
-    if ( copy_from_guest(op, u_domctl, 1) )
+    if ( copy_from_guest_offset((uint8_t *)op,
+                                guest_handle_cast(u_domctl, void),
+                                0, DOMCTL_COPY_HDR) )
         return -EFAULT;
 
     if ( op->interface_version != XEN_DOMCTL_INTERFACE_VERSION )
         return -EACCES;
 
+    copy_size = domctl_copy_size(op->cmd);
+    if ( copy_size > DOMCTL_COPY_HDR &&
+         copy_from_guest_offset((uint8_t *)op + DOMCTL_COPY_HDR,
+                                guest_handle_cast(u_domctl, void),
+                                DOMCTL_COPY_HDR,
+                                copy_size - DOMCTL_COPY_HDR) )
+        return -EFAULT;
+
     switch ( op->cmd )
     {
     case XEN_DOMCTL_test_assign_device:
@@ -588,9 +645,6 @@ long do_domctl(XEN_GUEST_HANDLE_PARAM(xen_domctl_t) u_domctl)
         domain_lock(d);
         ret = domain_kill(d);
         domain_unlock(d);
-        if ( ret == -ERESTART )
-            ret = hypercall_create_continuation(
-                __HYPERVISOR_domctl, "h", u_domctl);
         goto domctl_out_unlock_domonly;
 
     case XEN_DOMCTL_setnodeaffinity:
@@ -820,6 +874,65 @@ long do_domctl(XEN_GUEST_HANDLE_PARAM(xen_domctl_t) u_domctl)
         break;
     }
 
+    case XEN_DOMCTL_getvcpucontexts:
+    {
+        struct xen_domctl_vcpucontexts *vcs = &op->u.vcpucontexts;
+        vcpu_guest_context_u c = { .nat = NULL };
+        unsigned int i, nr = vcs->nr_vcpus;
+
+        ret = -EINVAL;
+        if ( d == current->domain || /* no domain_pause() */
+             vcs->first_vcpu >= d->max_vcpus )
+            break;
+
+        nr = min(nr, 8 * (unsigned int)sizeof(vcs->valid));
+        nr = min(nr, d->max_vcpus - vcs->first_vcpu);
+
+        ret = -ENOMEM;
+        if ( (c.nat = xzalloc(struct vcpu_guest_context)) == NULL )
+            break;
+
+        vcs->valid = 0;
+        ret = 0;
+
+        domain_pause(d);
+
+        for ( i = 0; i < nr; i++ )
+        {
+            struct vcpu *v = d->vcpu[vcs->first_vcpu + i];
+
+            if ( v == NULL || !v->is_initialised )
+                continue;
+
+            memset(c.nat, 0, sizeof(*c.nat));
+            arch_get_info_guest(v, c);
+
+#ifdef CONFIG_COMPAT
+            if ( is_pv_32bit_domain(d) )
+                ret = copy_to_guest_offset(guest_handle_cast(vcs->ctxt, void),
+                                           i * sizeof(*c.nat),
+                                           (uint8_t *)c.cmp, sizeof(*c.cmp));
+            else
+#endif
+                ret = copy_to_guest_offset(vcs->ctxt, i, c.nat, 1);
+
+            if ( ret )
+            {
+                ret = -EFAULT;
+                break;
+            }
+
+            vcs->valid |= 1ULL << i;
+        }
+
+        domain_unpause(d);
+
+        vcs->nr_vcpus = nr;
+        xfree(c.nat);
+        copyback = 1;
+        break;
+    }
+
     case XEN_DOMCTL_getvcpuinfo:
     {
         struct vcpu   *v;
@@ -850,12 +963,14 @@ long do_domctl(XEN_GUEST_HANDLE_PARAM(xen_domctl_t) u_domctl)
         uint64_t new_max = op->u.max_mem.max_memkb >> (PAGE_SHIFT - 10);
 
         spin_lock(&d->page_alloc_lock);
+        write_seqcount_begin(&d->page_alloc_count);
         /*
          * NB. We removed a check that new_max >= current tot_pages; this means
          * that the domain will now be allowed to "ratchet" down to new_max. In
          * the meantime, while tot > max, all new allocations are disallowed.
          */
         d->max_pages = min(new_max, (uint64_t)(typeof(d->max_pages))-1);
+        write_seqcount_end(&d->page_alloc_count);
         spin_unlock(&d->page_alloc_lock);
         break;
     }
@@ -1040,6 +1155,31 @@ long do_domctl(XEN_GUEST_HANDLE_PARAM(xen_domctl_t) u_domctl)
         ret = set_global_virq_handler(d, op->u.set_virq_handler.virq);
         break;
 
+    case XEN_DOMCTL_get_runstate_times:
+    {
+        struct xen_domctl_runstate_times *rt = &op->u.runstate_times;
+        struct vcpu *v;
+        struct vcpu_runstate_info runstate;
+
+        memset(rt, 0, sizeof(*rt));
+        for_each_vcpu ( d, v )
+        {
+            vcpu_runstate_get(v, &runstate);
+            rt->running  += runstate.time[RUNSTATE_running];
+            rt->runnable += runstate.time[RUNSTATE_runnable];
+            rt->blocked  += runstate.time[RUNSTATE_blocked];
+            rt->offline  += runstate.time[RUNSTATE_offline];
+        }
+        copyback = 1;
+        break;
+    }
+
+    case XEN_DOMCTL_evtchn_fifo_lat:
+        ret = evtchn_fifo_lat_domctl(d, &op->u.evtchn_fifo_lat);
+        if ( !ret && op->u.evtchn_fifo_lat.op == XEN_DOMCTL_EVTCHN_FIFO_LAT_read )
+            copyback = 1;
+        break;
+
     case XEN_DOMCTL_setvnumainfo:
     {
         struct vnuma_info *vnuma;
@@ -1077,7 +1217,9 @@ long do_domctl(XEN_GUEST_HANDLE_PARAM(xen_domctl_t) u_domctl)
     if ( d )
         rcu_unlock_domain(d);
 
-    if ( copyback && __copy_to_guest(u_domctl, op, 1) )
+    if ( copyback &&
+         __copy_to_guest_offset(guest_handle_cast(u_domctl, void),
+                                0, (uint8_t *)op, copy_size) )
         ret = -EFAULT;
 
     return ret;
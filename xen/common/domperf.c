@@ -0,0 +1,70 @@
+/******************************************************************************
+ * domperf.c
+ *
+ * Per-domain event counters, for attributing vmexits, hypercalls, grant
+ * ops and event channel sends to individual domains without a tracing
+ * setup.  Counting is disabled by default and switched globally at
+ * runtime via XEN_SYSCTL_domperf_op.
+ */
+
+#include <xen/domperf.h>
+#include <xen/guest_access.h>
+#include <xen/lib.h>
+#include <xen/sched.h>
+
+bool __read_mostly domperf_enabled;
+
+int domperf_control(struct xen_sysctl_domperf_op *dp)
+{
+    struct domain *d;
+    const struct vcpu *v;
+    uint64_t vals[XEN_DOMPERF_NR] = {};
+    unsigned int i, nr;
+    int rc = 0;
+
+    BUILD_BUG_ON(sizeof(v->domperf) != XEN_DOMPERF_NR * sizeof(*v->domperf));
+
+    switch ( dp->cmd )
+    {
+    case XEN_SYSCTL_DOMPERF_enable:
+        domperf_enabled = true;
+        break;
+
+    case XEN_SYSCTL_DOMPERF_disable:
+        domperf_enabled = false;
+        break;
+
+    case XEN_SYSCTL_DOMPERF_query:
+        d = rcu_lock_domain_by_id(dp->domain);
+        if ( d == NULL )
+            return -ESRCH;
+
+        for_each_vcpu ( d, v )
+            for ( i = 0; i < XEN_DOMPERF_NR; i++ )
+                vals[i] += v->domperf[i];
+
+        rcu_unlock_domain(d);
+
+        dp->nr_elem = XEN_DOMPERF_NR;
+        nr = min(dp->max_elem, (uint32_t)XEN_DOMPERF_NR);
+        if ( nr && copy_to_guest(dp->data, vals, nr) )
+            rc = -EFAULT;
+        break;
+
+    default:
+        rc = -EINVAL;
+        break;
+    }
+
+    return rc;
+}
+
+/*
+ * Local variables:
+ * mode: C
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
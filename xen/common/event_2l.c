@@ -23,12 +23,20 @@ static void evtchn_2l_set_pending(struct vcpu *v, struct evtchn *evtchn)
      * NB. On x86, the atomic bit operations also act as memory barriers.
      * There is therefore sufficiently strict ordering for this architecture --
      * others may require explicit memory barriers.
+     *
+     * The pending array and selector words are shared by all vCPUs, so
+     * check each bit with a plain read first: a locked RMW dirties the
+     * cacheline even when the bit is already set, and under load most
+     * of them are.
      */
 
-    if ( test_and_set_bit(port, &shared_info(d, evtchn_pending)) )
+    if ( test_bit        (port, &shared_info(d, evtchn_pending)) ||
+         test_and_set_bit(port, &shared_info(d, evtchn_pending)) )
         return;
 
     if ( !test_bit        (port, &shared_info(d, evtchn_mask)) &&
+         !test_bit        (port / BITS_PER_EVTCHN_WORD(d),
+                           &vcpu_info(v, evtchn_pending_sel)) &&
          !test_and_set_bit(port / BITS_PER_EVTCHN_WORD(d),
                            &vcpu_info(v, evtchn_pending_sel)) )
     {
@@ -54,6 +62,8 @@ static void evtchn_2l_unmask(struct domain *d, struct evtchn *evtchn)
      */
     if ( test_and_clear_bit(port, &shared_info(d, evtchn_mask)) &&
          test_bit          (port, &shared_info(d, evtchn_pending)) &&
+         !test_bit         (port / BITS_PER_EVTCHN_WORD(d),
+                            &vcpu_info(v, evtchn_pending_sel)) &&
          !test_and_set_bit (port / BITS_PER_EVTCHN_WORD(d),
                             &vcpu_info(v, evtchn_pending_sel)) )
     {
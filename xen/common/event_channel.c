@@ -18,6 +18,7 @@
 #include <xen/lib.h>
 #include <xen/errno.h>
 #include <xen/sched.h>
+#include <xen/domperf.h>
 #include <xen/event.h>
 #include <xen/irq.h>
 #include <xen/iocap.h>
@@ -25,6 +26,7 @@
 #include <xen/guest_access.h>
 #include <xen/keyhandler.h>
 #include <xen/event_fifo.h>
+#include <xen/softirq.h>
 #include <asm/current.h>
 
 #include <public/xen.h>
@@ -229,7 +231,7 @@ static long evtchn_alloc_unbound(evtchn_alloc_unbound_t *alloc)
     if ( d == NULL )
         return -ESRCH;
 
-    spin_lock(&d->event_lock);
+    write_lock(&d->event_lock);
 
     if ( (port = get_free_port(d)) < 0 )
         ERROR_EXIT_DOM(port, d);
@@ -251,7 +253,7 @@ static long evtchn_alloc_unbound(evtchn_alloc_unbound_t *alloc)
     alloc->port = port;
 
  out:
-    spin_unlock(&d->event_lock);
+    write_unlock(&d->event_lock);
     rcu_unlock_domain(d);
 
     return rc;
@@ -297,14 +299,14 @@ static long evtchn_bind_interdomain(evtchn_bind_interdomain_t *bind)
     /* Avoid deadlock by first acquiring lock of domain with smaller id. */
     if ( ld < rd )
     {
-        spin_lock(&ld->event_lock);
-        spin_lock(&rd->event_lock);
+        write_lock(&ld->event_lock);
+        read_lock(&rd->event_lock);
     }
     else
     {
         if ( ld != rd )
-            spin_lock(&rd->event_lock);
-        spin_lock(&ld->event_lock);
+            read_lock(&rd->event_lock);
+        write_lock(&ld->event_lock);
     }
 
     if ( (lport = get_free_port(ld)) < 0 )
@@ -344,9 +346,9 @@ static long evtchn_bind_interdomain(evtchn_bind_interdomain_t *bind)
     bind->local_port = lport;
 
  out:
-    spin_unlock(&ld->event_lock);
+    write_unlock(&ld->event_lock);
     if ( ld != rd )
-        spin_unlock(&rd->event_lock);
+        read_unlock(&rd->event_lock);
     
     rcu_unlock_domain(rd);
 
@@ -377,7 +379,7 @@ int evtchn_bind_virq(evtchn_bind_virq_t *bind, evtchn_port_t port)
     if ( (v = domain_vcpu(d, vcpu)) == NULL )
         return -ENOENT;
 
-    spin_lock(&d->event_lock);
+    write_lock(&d->event_lock);
 
     if ( v->virq_to_evtchn[virq] != 0 )
         ERROR_EXIT(-EEXIST);
@@ -410,7 +412,7 @@ int evtchn_bind_virq(evtchn_bind_virq_t *bind, evtchn_port_t port)
     v->virq_to_evtchn[virq] = bind->port = port;
 
  out:
-    spin_unlock(&d->event_lock);
+    write_unlock(&d->event_lock);
 
     return rc;
 }
@@ -426,7 +428,7 @@ static long evtchn_bind_ipi(evtchn_bind_ipi_t *bind)
     if ( domain_vcpu(d, vcpu) == NULL )
         return -ENOENT;
 
-    spin_lock(&d->event_lock);
+    write_lock(&d->event_lock);
 
     if ( (port = get_free_port(d)) < 0 )
         ERROR_EXIT(port);
@@ -444,7 +446,7 @@ static long evtchn_bind_ipi(evtchn_bind_ipi_t *bind)
     bind->port = port;
 
  out:
-    spin_unlock(&d->event_lock);
+    write_unlock(&d->event_lock);
 
     return rc;
 }
@@ -490,7 +492,7 @@ static long evtchn_bind_pirq(evtchn_bind_pirq_t *bind)
     if ( !is_hvm_domain(d) && !pirq_access_permitted(d, pirq) )
         return -EPERM;
 
-    spin_lock(&d->event_lock);
+    write_lock(&d->event_lock);
 
     if ( pirq_to_evtchn(d, pirq) != 0 )
         ERROR_EXIT(-EEXIST);
@@ -529,7 +531,7 @@ static long evtchn_bind_pirq(evtchn_bind_pirq_t *bind)
     arch_evtchn_bind_pirq(d, pirq);
 
  out:
-    spin_unlock(&d->event_lock);
+    write_unlock(&d->event_lock);
 
     return rc;
 }
@@ -544,7 +546,7 @@ int evtchn_close(struct domain *d1, int port1, bool guest)
     long           rc = 0;
 
  again:
-    spin_lock(&d1->event_lock);
+    write_lock(&d1->event_lock);
 
     if ( !port_is_valid(d1, port1) )
     {
@@ -612,12 +614,12 @@ int evtchn_close(struct domain *d1, int port1, bool guest)
 
             if ( d1 < d2 )
             {
-                spin_lock(&d2->event_lock);
+                write_lock(&d2->event_lock);
             }
             else if ( d1 != d2 )
             {
-                spin_unlock(&d1->event_lock);
-                spin_lock(&d2->event_lock);
+                write_unlock(&d1->event_lock);
+                write_lock(&d2->event_lock);
                 goto again;
             }
         }
@@ -664,11 +666,11 @@ int evtchn_close(struct domain *d1, int port1, bool guest)
     if ( d2 != NULL )
     {
         if ( d1 != d2 )
-            spin_unlock(&d2->event_lock);
+            write_unlock(&d2->event_lock);
         put_domain(d2);
     }
 
-    spin_unlock(&d1->event_lock);
+    write_unlock(&d1->event_lock);
 
     return rc;
 }
@@ -682,6 +684,8 @@ int evtchn_send(struct domain *ld, unsigned int lport)
     if ( !port_is_valid(ld, lport) )
         return -EINVAL;
 
+    domperf_incr(current, evtchn_sends);
+
     lchn = evtchn_from_port(ld, lport);
 
     spin_lock(&lchn->lock);
@@ -874,7 +878,7 @@ int evtchn_status(evtchn_status_t *status)
     if ( d == NULL )
         return -ESRCH;
 
-    spin_lock(&d->event_lock);
+    read_lock(&d->event_lock);
 
     if ( !port_is_valid(d, port) )
     {
@@ -922,7 +926,7 @@ int evtchn_status(evtchn_status_t *status)
     status->vcpu = chn->notify_vcpu_id;
 
  out:
-    spin_unlock(&d->event_lock);
+    read_unlock(&d->event_lock);
     rcu_unlock_domain(d);
 
     return rc;
@@ -940,7 +944,7 @@ long evtchn_bind_vcpu(unsigned int port, unsigned int vcpu_id)
     if ( (v = domain_vcpu(d, vcpu_id)) == NULL )
         return -ENOENT;
 
-    spin_lock(&d->event_lock);
+    write_lock(&d->event_lock);
 
     if ( !port_is_valid(d, port) )
     {
@@ -984,7 +988,7 @@ long evtchn_bind_vcpu(unsigned int port, unsigned int vcpu_id)
     }
 
  out:
-    spin_unlock(&d->event_lock);
+    write_unlock(&d->event_lock);
 
     return rc;
 }
@@ -1015,7 +1019,7 @@ int evtchn_reset(struct domain *d)
     for ( i = 0; port_is_valid(d, i); i++ )
         evtchn_close(d, i, 1);
 
-    spin_lock(&d->event_lock);
+    write_lock(&d->event_lock);
 
     if ( d->evtchn_fifo )
     {
@@ -1024,7 +1028,7 @@ int evtchn_reset(struct domain *d)
         evtchn_2l_init(d);
     }
 
-    spin_unlock(&d->event_lock);
+    write_unlock(&d->event_lock);
 
     return 0;
 }
@@ -1033,20 +1037,23 @@ static long evtchn_set_priority(const struct evtchn_set_priority *set_priority)
 {
     struct domain *d = current->domain;
     unsigned int port = set_priority->port;
+    struct evtchn *chn;
     long ret;
 
-    spin_lock(&d->event_lock);
+    read_lock(&d->event_lock);
 
     if ( !port_is_valid(d, port) )
     {
-        spin_unlock(&d->event_lock);
+        read_unlock(&d->event_lock);
         return -EINVAL;
     }
 
-    ret = evtchn_port_set_priority(d, evtchn_from_port(d, port),
-                                   set_priority->priority);
+    chn = evtchn_from_port(d, port);
+    spin_lock(&chn->lock);
+    ret = evtchn_port_set_priority(d, chn, set_priority->priority);
+    spin_unlock(&chn->lock);
 
-    spin_unlock(&d->event_lock);
+    read_unlock(&d->event_lock);
 
     return ret;
 }
@@ -1123,6 +1130,23 @@ long do_event_channel_op(int cmd, XEN_GUEST_HANDLE_PARAM(void) arg)
         break;
     }
 
+    case EVTCHNOP_send_batch: {
+        struct evtchn_send_batch send_batch;
+        unsigned int i;
+
+        if ( copy_from_guest(&send_batch, arg, 1) != 0 )
+            return -EFAULT;
+        if ( send_batch.nr_ports > ARRAY_SIZE(send_batch.port) )
+            return -EINVAL;
+        for ( i = 0; i < send_batch.nr_ports; i++ )
+        {
+            rc = evtchn_send(current->domain, send_batch.port[i]);
+            if ( rc )
+                break;
+        }
+        break;
+    }
+
     case EVTCHNOP_status: {
         struct evtchn_status status;
         if ( copy_from_guest(&status, arg, 1) != 0 )
@@ -1210,7 +1234,7 @@ int alloc_unbound_xen_event_channel(
     struct evtchn *chn;
     int            port, rc;
 
-    spin_lock(&ld->event_lock);
+    write_lock(&ld->event_lock);
 
     rc = get_free_port(ld);
     if ( rc < 0 )
@@ -1232,7 +1256,7 @@ int alloc_unbound_xen_event_channel(
     spin_unlock(&chn->lock);
 
  out:
-    spin_unlock(&ld->event_lock);
+    write_unlock(&ld->event_lock);
 
     return rc < 0 ? rc : port;
 }
@@ -1275,19 +1299,34 @@ void evtchn_check_pollers(struct domain *d, unsigned int port)
     if ( likely(bitmap_empty(d->poll_mask, d->max_vcpus)) )
         return;
 
+    /*
+     * Unblocking several pollers can resolve to the same pcpu within
+     * microseconds; batch the kicks so each target gets one IPI.
+     */
+    cpu_raise_softirq_batch_begin();
+
     /* Wake any interested (or potentially interested) pollers. */
     for ( vcpuid = find_first_bit(d->poll_mask, d->max_vcpus);
           vcpuid < d->max_vcpus;
           vcpuid = find_next_bit(d->poll_mask, d->max_vcpus, vcpuid+1) )
     {
         v = d->vcpu[vcpuid];
-        if ( ((v->poll_evtchn <= 0) || (v->poll_evtchn == port)) &&
-             test_and_clear_bit(vcpuid, d->poll_mask) )
+        if ( v->poll_evtchn == -2 )
+        {
+            /* Polling a registered set: wake only if @port is in it. */
+            if ( !v->poll_set || !test_bit(port, v->poll_set) )
+                continue;
+        }
+        else if ( (v->poll_evtchn > 0) && (v->poll_evtchn != port) )
+            continue;
+        if ( test_and_clear_bit(vcpuid, d->poll_mask) )
         {
             v->poll_evtchn = 0;
             vcpu_unblock(v);
         }
     }
+
+    cpu_raise_softirq_batch_finish();
 }
 
 int evtchn_init(struct domain *d, unsigned int max_port)
@@ -1300,7 +1339,7 @@ int evtchn_init(struct domain *d, unsigned int max_port)
         return -ENOMEM;
     d->valid_evtchns = EVTCHNS_PER_BUCKET;
 
-    spin_lock_init_prof(d, event_lock);
+    rwlock_init(&d->event_lock);
     if ( get_free_port(d) != 0 )
     {
         free_evtchn_bucket(d, d->evtchn);
@@ -1327,7 +1366,8 @@ void evtchn_destroy(struct domain *d)
 
     /* After this barrier no new event-channel allocations can occur. */
     BUG_ON(!d->is_dying);
-    spin_barrier(&d->event_lock);
+    write_lock(&d->event_lock);
+    write_unlock(&d->event_lock);
 
     /* Close all existing event channels. */
     for ( i = 0; port_is_valid(d, i); i++ )
@@ -1368,13 +1408,13 @@ void evtchn_move_pirqs(struct vcpu *v)
     unsigned int port;
     struct evtchn *chn;
 
-    spin_lock(&d->event_lock);
+    read_lock(&d->event_lock);
     for ( port = v->pirq_evtchn_head; port; port = chn->u.pirq.next_port )
     {
         chn = evtchn_from_port(d, port);
         pirq_set_affinity(d, chn->u.pirq.irq, mask);
     }
-    spin_unlock(&d->event_lock);
+    read_unlock(&d->event_lock);
 }
 
 
@@ -1387,7 +1427,7 @@ static void domain_dump_evtchn_info(struct domain *d)
            "Polling vCPUs: {%*pbl}\n"
            "    port [p/m/s]\n", d->domain_id, d->max_vcpus, d->poll_mask);
 
-    spin_lock(&d->event_lock);
+    read_lock(&d->event_lock);
 
     for ( port = 1; port < d->max_evtchns; ++port )
     {
@@ -1436,7 +1476,7 @@ static void domain_dump_evtchn_info(struct domain *d)
         }
     }
 
-    spin_unlock(&d->event_lock);
+    read_unlock(&d->event_lock);
 }
 
 static void dump_evtchn_info(unsigned char key)
@@ -13,10 +13,12 @@
 #include <xen/sched.h>
 #include <xen/event.h>
 #include <xen/event_fifo.h>
+#include <xen/guest_access.h>
 #include <xen/paging.h>
 #include <xen/mm.h>
 #include <xen/domain_page.h>
 
+#include <public/domctl.h>
 #include <public/event_channel.h>
 
 static inline event_word_t *evtchn_fifo_word_from_port(const struct domain *d,
@@ -62,9 +64,15 @@ static struct evtchn_fifo_queue *lock_old_queue(const struct domain *d,
 {
     struct vcpu *v;
     struct evtchn_fifo_queue *q, *old_q;
-    unsigned int try;
 
-    for ( try = 0; try < 3; try++ )
+    /*
+     * The (last_vcpu_id, last_priority) pair is only updated under the
+     * old queue's lock, so retrying until the snapshot is stable is
+     * guaranteed to make progress: each retry requires another queue
+     * change to have completed in the meantime.  Giving up instead (as
+     * we used to after three attempts) would lose the event.
+     */
+    for ( ; ; )
     {
         v = d->vcpu[evtchn->last_vcpu_id];
         old_q = &v->evtchn_fifo->queue[evtchn->last_priority];
@@ -78,13 +86,9 @@ static struct evtchn_fifo_queue *lock_old_queue(const struct domain *d,
             return old_q;
 
         spin_unlock_irqrestore(&old_q->lock, *flags);
+        cpu_relax();
     }
-
-    gprintk(XENLOG_WARNING,
-            "dom%d port %d lost event (too many queue changes)\n",
-            d->domain_id, evtchn->port);
-    return NULL;
-}          
+}
 
 static int try_set_link(event_word_t *word, event_word_t *w, uint32_t link)
 {
@@ -171,7 +175,12 @@ static void evtchn_fifo_set_pending(struct vcpu *v, struct evtchn *evtchn)
         return;
     }
 
-    was_pending = test_and_set_bit(EVTCHN_FIFO_PENDING, word);
+    /*
+     * Many event words share a cacheline; don't dirty it with a locked
+     * RMW when the event is already pending.
+     */
+    was_pending = test_bit(EVTCHN_FIFO_PENDING, word) ||
+                  test_and_set_bit(EVTCHN_FIFO_PENDING, word);
 
     /*
      * Link the event if it unmasked and not already linked.
@@ -203,8 +212,6 @@ static void evtchn_fifo_set_pending(struct vcpu *v, struct evtchn *evtchn)
         q = &v->evtchn_fifo->queue[evtchn->priority];
 
         old_q = lock_old_queue(d, evtchn, &flags);
-        if ( !old_q )
-            goto done;
 
         if ( test_and_set_bit(EVTCHN_FIFO_LINKED, word) )
         {
@@ -254,7 +261,24 @@ static void evtchn_fifo_set_pending(struct vcpu *v, struct evtchn *evtchn)
         if ( !linked
              && !test_and_set_bit(q->priority,
                                   &v->evtchn_fifo->control_block->ready) )
+        {
+            struct evtchn_fifo_lat *lat = d->evtchn_fifo->lat;
+
+            if ( unlikely(lat && lat->enabled) )
+            {
+                /*
+                 * The queue just went ready.  A running vCPU will see the
+                 * event on its next interrupt or poll, so count that as
+                 * the lowest bucket; otherwise arm the stamp, consumed by
+                 * evtchn_fifo_record_wake() when the vCPU is switched in.
+                 */
+                if ( v->is_running )
+                    lat->count[q->priority][0]++;
+                else
+                    write_atomic(&q->ready_since, NOW());
+            }
             vcpu_mark_events_pending(v);
+        }
     }
  done:
     if ( !was_pending )
@@ -472,6 +496,7 @@ static void cleanup_event_array(struct domain *d)
 
     for ( i = 0; i < EVTCHN_FIFO_MAX_EVENT_ARRAY_PAGES; i++ )
         unmap_guest_page(d->evtchn_fifo->event_array[i]);
+    xfree(d->evtchn_fifo->lat);
     xfree(d->evtchn_fifo);
     d->evtchn_fifo = NULL;
 }
@@ -535,7 +560,7 @@ int evtchn_fifo_init_control(struct evtchn_init_control *init_control)
     if ( offset & (8 - 1) )
         return -EINVAL;
 
-    spin_lock(&d->event_lock);
+    write_lock(&d->event_lock);
 
     /*
      * If this is the first control block, setup an empty event array
@@ -566,13 +591,13 @@ int evtchn_fifo_init_control(struct evtchn_init_control *init_control)
     else
         rc = map_control_block(v, gfn, offset);
 
-    spin_unlock(&d->event_lock);
+    write_unlock(&d->event_lock);
 
     return rc;
 
  error:
     evtchn_fifo_destroy(d);
-    spin_unlock(&d->event_lock);
+    write_unlock(&d->event_lock);
     return rc;
 }
 
@@ -625,9 +650,9 @@ int evtchn_fifo_expand_array(const struct evtchn_expand_array *expand_array)
     if ( !d->evtchn_fifo )
         return -EOPNOTSUPP;
 
-    spin_lock(&d->event_lock);
+    write_lock(&d->event_lock);
     rc = add_page_to_event_array(d, expand_array->array_gfn);
-    spin_unlock(&d->event_lock);
+    write_unlock(&d->event_lock);
 
     return rc;
 }
@@ -641,6 +666,93 @@ void evtchn_fifo_destroy(struct domain *d)
     cleanup_event_array(d);
 }
 
+void evtchn_fifo_record_wake(struct vcpu *v, s_time_t now)
+{
+    struct evtchn_fifo_lat *lat = v->domain->evtchn_fifo->lat;
+    unsigned int i;
+
+    for ( i = 0; i < EVTCHN_FIFO_MAX_QUEUES; i++ )
+    {
+        struct evtchn_fifo_queue *q = &v->evtchn_fifo->queue[i];
+        s_time_t since = read_atomic(&q->ready_since);
+        unsigned int b;
+
+        if ( likely(!since) )
+            continue;
+        write_atomic(&q->ready_since, 0);
+
+        b = now > since ? min(flsl((now - since) / 1000),
+                              EVTCHN_FIFO_LAT_NR_BUCKETS - 1) : 0;
+        lat->count[i][b]++;
+    }
+}
+
+int evtchn_fifo_lat_domctl(struct domain *d,
+                           struct xen_domctl_evtchn_fifo_lat *op)
+{
+    struct evtchn_fifo_lat *lat = NULL;
+    int rc = 0;
+
+    write_lock(&d->event_lock);
+
+    if ( !d->evtchn_fifo )
+    {
+        write_unlock(&d->event_lock);
+        return -EOPNOTSUPP;
+    }
+
+    switch ( op->op )
+    {
+    case XEN_DOMCTL_EVTCHN_FIFO_LAT_enable:
+        if ( !d->evtchn_fifo->lat )
+        {
+            lat = xzalloc(struct evtchn_fifo_lat);
+            if ( !lat )
+            {
+                rc = -ENOMEM;
+                break;
+            }
+            d->evtchn_fifo->lat = lat;
+        }
+        d->evtchn_fifo->lat->enabled = true;
+        break;
+
+    case XEN_DOMCTL_EVTCHN_FIFO_LAT_disable:
+        /* Counters are retained for a later read. */
+        if ( d->evtchn_fifo->lat )
+            d->evtchn_fifo->lat->enabled = false;
+        break;
+
+    case XEN_DOMCTL_EVTCHN_FIFO_LAT_read:
+        lat = d->evtchn_fifo->lat;
+        if ( !lat )
+            rc = -ENODEV;
+        break;
+
+    default:
+        rc = -EINVAL;
+        break;
+    }
+
+    write_unlock(&d->event_lock);
+
+    if ( !rc && op->op == XEN_DOMCTL_EVTCHN_FIFO_LAT_read )
+    {
+        unsigned int nr = EVTCHN_FIFO_MAX_QUEUES * EVTCHN_FIFO_LAT_NR_BUCKETS;
+
+        /*
+         * Copying outside the lock is fine: @lat is freed only together
+         * with the event array, and the counters merely keep ticking.
+         */
+        if ( copy_to_guest(op->counts, &lat->count[0][0],
+                           min(op->nr_counts, nr)) )
+            rc = -EFAULT;
+        op->nr_counts = nr;
+    }
+
+    return rc;
+}
+
 /*
  * Local variables:
  * mode: C
@@ -28,14 +28,17 @@
 #include <xen/lib.h>
 #include <xen/sched.h>
 #include <xen/mm.h>
+#include <xen/domperf.h>
 #include <xen/event.h>
 #include <xen/trace.h>
 #include <xen/grant_table.h>
 #include <xen/guest_access.h>
 #include <xen/domain_page.h>
 #include <xen/iommu.h>
+#include <xen/numa.h>
 #include <xen/paging.h>
 #include <xen/keyhandler.h>
+#include <xen/prefetch.h>
 #include <xen/vmap.h>
 #include <xsm/xsm.h>
 #include <asm/flushtlb.h>
@@ -76,6 +79,14 @@ struct grant_table {
     /* Mapping tracking table per vcpu. */
     struct grant_mapping **maptrack;
 
+    /*
+     * Frames pre-staged (outside the write lock) for table growth,
+     * chained through their first word.  Protected by prealloc_lock.
+     */
+    void                 *prealloc_frames;
+    unsigned int          nr_prealloc_frames;
+    spinlock_t            prealloc_lock;
+
     /* Domain to which this struct grant_table belongs. */
     const struct domain *domain;
 
@@ -232,6 +243,22 @@ shared_entry_header(struct grant_table *t, grant_ref_t ref)
         return &shared_entry_v2(t, ref).hdr;
 }
 
+/*
+ * Grant v2 splits a grant's status from its shared entry: the flags
+ * live in separate status frames, so every map/unmap/copy touches one
+ * more cache line per grant than v1.  Start the loads of both lines
+ * before acquiring the active entry, so they overlap the (serializing)
+ * lock acquisition instead of queueing behind it.
+ */
+static inline void grant_prefetch_v2(struct grant_table *t, grant_ref_t ref)
+{
+    if ( t->gt_version != 2 )
+        return;
+
+    prefetch(&shared_entry_v2(t, ref));
+    prefetchw(&status_entry(t, ref));
+}
+
 /* Active grant entry - used for shadowing GTF_permit_access grants. */
 struct active_grant_entry {
     uint32_t      pin;    /* Reference count information:             */
@@ -440,33 +467,30 @@ double_gt_unlock(struct grant_table *lgt, struct grant_table *rgt)
 static inline grant_handle_t
 _get_maptrack_handle(struct grant_table *t, struct vcpu *v)
 {
-    unsigned int head, next, prev_head;
+    unsigned int head, next;
 
     spin_lock(&v->maptrack_freelist_lock);
 
-    do {
-        /* No maptrack pages allocated for this VCPU yet? */
-        head = read_atomic(&v->maptrack_head);
-        if ( unlikely(head == MAPTRACK_TAIL) )
-        {
-            spin_unlock(&v->maptrack_freelist_lock);
-            return INVALID_MAPTRACK_HANDLE;
-        }
+    /* No maptrack pages allocated for this VCPU yet? */
+    head = v->maptrack_head;
+    if ( unlikely(head == MAPTRACK_TAIL) )
+    {
+        spin_unlock(&v->maptrack_freelist_lock);
+        return INVALID_MAPTRACK_HANDLE;
+    }
 
-        /*
-         * Always keep one entry in the free list to make it easier to
-         * add free entries to the tail.
-         */
-        next = read_atomic(&maptrack_entry(t, head).ref);
-        if ( unlikely(next == MAPTRACK_TAIL) )
-        {
-            spin_unlock(&v->maptrack_freelist_lock);
-            return INVALID_MAPTRACK_HANDLE;
-        }
+    /*
+     * Always keep one entry in the free list to make it easier to
+     * add free entries to the tail.
+     */
+    next = maptrack_entry(t, head).ref;
+    if ( unlikely(next == MAPTRACK_TAIL) )
+    {
+        spin_unlock(&v->maptrack_freelist_lock);
+        return INVALID_MAPTRACK_HANDLE;
+    }
 
-        prev_head = head;
-        head = cmpxchg(&v->maptrack_head, prev_head, next);
-    } while ( head != prev_head );
+    v->maptrack_head = next;
 
     spin_unlock(&v->maptrack_freelist_lock);
 
@@ -518,26 +542,29 @@ static inline void
 put_maptrack_handle(
     struct grant_table *t, grant_handle_t handle)
 {
-    struct domain *currd = current->domain;
-    struct vcpu *v;
-    unsigned int prev_tail, cur_tail;
+    struct vcpu *v = current;
+    unsigned int prev_tail;
 
-    /* 1. Set entry to be a tail. */
+    /*
+     * 1. Set entry to be a tail and re-home it to the freeing VCPU, so
+     * that both allocation and release only ever touch the local
+     * freelist.  Entries thereby migrate towards the VCPUs actually
+     * using them, just like with steal_maptrack_handle().
+     */
     maptrack_entry(t, handle).ref = MAPTRACK_TAIL;
+    maptrack_entry(t, handle).vcpu = v->vcpu_id;
 
-    /* 2. Add entry to the tail of the list on the original VCPU. */
-    v = currd->vcpu[maptrack_entry(t, handle).vcpu];
-
+    /* 2. Add entry to the tail of the list on the local VCPU. */
     spin_lock(&v->maptrack_freelist_lock);
 
-    cur_tail = read_atomic(&v->maptrack_tail);
-    do {
-        prev_tail = cur_tail;
-        cur_tail = cmpxchg(&v->maptrack_tail, prev_tail, handle);
-    } while ( cur_tail != prev_tail );
+    prev_tail = v->maptrack_tail;
+    v->maptrack_tail = handle;
 
     /* 3. Update the old tail entry to point to the new entry. */
-    write_atomic(&maptrack_entry(t, prev_tail).ref, handle);
+    if ( prev_tail != MAPTRACK_TAIL )
+        maptrack_entry(t, prev_tail).ref = handle;
+    if ( v->maptrack_head == MAPTRACK_TAIL )
+        v->maptrack_head = handle;
 
     spin_unlock(&v->maptrack_freelist_lock);
 }
@@ -547,7 +574,7 @@ get_maptrack_handle(
     struct grant_table *lgt)
 {
     struct vcpu          *curr = current;
-    unsigned int          i, head;
+    unsigned int          i;
     grant_handle_t        handle;
     struct grant_mapping *new_mt = NULL;
 
@@ -555,16 +582,31 @@ get_maptrack_handle(
     if ( likely(handle != INVALID_MAPTRACK_HANDLE) )
         return handle;
 
-    spin_lock(&lgt->maptrack_lock);
-
     /*
      * If we've run out of handles and still have frame headroom, try
      * allocating a new maptrack frame.  If there is no headroom, or we're
      * out of memory, try stealing an entry from another VCPU (in case the
      * guest isn't mapping across its VCPUs evenly).
+     *
+     * Allocate and clear the new frame before taking the maptrack lock,
+     * so that concurrent mappers don't sit spinning behind the page
+     * allocator while the table grows; the headroom is re-checked under
+     * the lock in case we raced with another grower.
      */
     if ( nr_maptrack_frames(lgt) < lgt->max_maptrack_frames )
+    {
         new_mt = alloc_xenheap_page();
+        if ( new_mt )
+            clear_page(new_mt);
+    }
+
+    spin_lock(&lgt->maptrack_lock);
+
+    if ( new_mt && nr_maptrack_frames(lgt) >= lgt->max_maptrack_frames )
+    {
+        free_xenheap_page(new_mt);
+        new_mt = NULL;
+    }
 
     if ( !new_mt )
     {
@@ -583,14 +625,12 @@ get_maptrack_handle(
             maptrack_entry(lgt, handle).ref = MAPTRACK_TAIL;
             curr->maptrack_tail = handle;
             if ( curr->maptrack_head == MAPTRACK_TAIL )
-                write_atomic(&curr->maptrack_head, handle);
+                curr->maptrack_head = handle;
             spin_unlock(&curr->maptrack_freelist_lock);
         }
         return steal_maptrack_handle(lgt, curr);
     }
 
-    clear_page(new_mt);
-
     /*
      * Use the first new entry and add the remaining entries to the
      * head of the free list.
@@ -615,10 +655,8 @@ get_maptrack_handle(
     spin_unlock(&lgt->maptrack_lock);
     spin_lock(&curr->maptrack_freelist_lock);
 
-    do {
-        new_mt[i - 1].ref = read_atomic(&curr->maptrack_head);
-        head = cmpxchg(&curr->maptrack_head, new_mt[i - 1].ref, handle + 1);
-    } while ( head != new_mt[i - 1].ref );
+    new_mt[i - 1].ref = curr->maptrack_head;
+    curr->maptrack_head = handle + 1;
 
     spin_unlock(&curr->maptrack_freelist_lock);
 
@@ -890,11 +928,16 @@ static unsigned int mapkind(
     return kind;
 }
 
+/*
+ * Map a single grant of @rd, which the caller has already looked up and
+ * RCU-locked.  Batched callers are expected to reuse @rd across entries
+ * naming the same remote domain, saving the domain lookup per entry.
+ */
 static void
 map_grant_ref(
-    struct gnttab_map_grant_ref *op)
+    struct gnttab_map_grant_ref *op, struct domain *rd)
 {
-    struct domain *ld, *rd, *owner = NULL;
+    struct domain *ld, *owner = NULL;
     struct grant_table *lgt, *rgt;
     struct vcpu   *led;
     grant_handle_t handle;
@@ -930,17 +973,9 @@ map_grant_ref(
         return;
     }
 
-    if ( unlikely((rd = rcu_lock_domain_by_id(op->dom)) == NULL) )
-    {
-        gdprintk(XENLOG_INFO, "Could not find domain %d\n", op->dom);
-        op->status = GNTST_bad_domain;
-        return;
-    }
-
     rc = xsm_grant_mapref(XSM_HOOK, ld, rd, op->flags);
     if ( rc )
     {
-        rcu_unlock_domain(rd);
         op->status = GNTST_permission_denied;
         return;
     }
@@ -949,7 +984,6 @@ map_grant_ref(
     handle = get_maptrack_handle(lgt);
     if ( unlikely(handle == INVALID_MAPTRACK_HANDLE) )
     {
-        rcu_unlock_domain(rd);
         gdprintk(XENLOG_INFO, "Failed to obtain maptrack handle\n");
         op->status = GNTST_no_device_space;
         return;
@@ -963,6 +997,8 @@ map_grant_ref(
         PIN_FAIL(unlock_out, GNTST_bad_gntref, "Bad ref %#x for d%d\n",
                  op->ref, rgt->domain->domain_id);
 
+    grant_prefetch_v2(rgt, op->ref);
+
     act = active_entry_acquire(rgt, op->ref);
     shah = shared_entry_header(rgt, op->ref);
     status = rgt->gt_version == 1 ? &shah->flags : &status_entry(rgt, op->ref);
@@ -1174,7 +1210,6 @@ map_grant_ref(
     op->handle       = handle;
     op->status       = GNTST_okay;
 
-    rcu_unlock_domain(rd);
     return;
 
  undo_out:
@@ -1216,7 +1251,6 @@ map_grant_ref(
     grant_read_unlock(rgt);
     op->status = rc;
     put_maptrack_handle(lgt, handle);
-    rcu_unlock_domain(rd);
 }
 
 static long
@@ -1224,23 +1258,53 @@ gnttab_map_grant_ref(
     XEN_GUEST_HANDLE_PARAM(gnttab_map_grant_ref_t) uop, unsigned int count)
 {
     int i;
+    long rc = 0;
     struct gnttab_map_grant_ref op;
+    struct domain *rd = NULL;
 
     for ( i = 0; i < count; i++ )
     {
         if ( i && hypercall_preempt_check() )
-            return i;
+        {
+            rc = i;
+            break;
+        }
 
         if ( unlikely(__copy_from_guest_offset(&op, uop, i, 1)) )
-            return -EFAULT;
+        {
+            rc = -EFAULT;
+            break;
+        }
 
-        map_grant_ref(&op);
+        /*
+         * Backends typically map batches of grants of a single remote
+         * domain, so hold on to the looked up domain across entries until
+         * one naming a different domain is encountered.
+         */
+        if ( rd && op.dom != rd->domain_id )
+        {
+            rcu_unlock_domain(rd);
+            rd = NULL;
+        }
+        if ( !rd && (rd = rcu_lock_domain_by_id(op.dom)) == NULL )
+        {
+            gdprintk(XENLOG_INFO, "Could not find domain %d\n", op.dom);
+            op.status = GNTST_bad_domain;
+        }
+        else
+            map_grant_ref(&op, rd);
 
         if ( unlikely(__copy_to_guest_offset(uop, i, &op, 1)) )
-            return -EFAULT;
+        {
+            rc = -EFAULT;
+            break;
+        }
     }
 
-    return 0;
+    if ( rd )
+        rcu_unlock_domain(rd);
+
+    return rc;
 }
 
 static void
@@ -1431,6 +1495,8 @@ unmap_common_complete(struct gnttab_unmap_common *op)
 
     grant_read_lock(rgt);
 
+    grant_prefetch_v2(rgt, op->ref);
+
     act = active_entry_acquire(rgt, op->ref);
     sha = shared_entry_header(rgt, op->ref);
 
@@ -1619,6 +1685,86 @@ fault:
     return -EFAULT;
 }
 
+/*
+ * Growing the table stalls every concurrent grant operation for as long
+ * as the write lock is held, so the frames backing a growth are best
+ * allocated (and zeroed) up front via gnttab_prestage_frames(), with the
+ * domain's NUMA node preferred either way.  gnttab_get_frame() hands out
+ * a zeroed frame, staged if available; frames staged but not consumed
+ * stay around for the next growth and are freed with the table.
+ */
+static void *gnttab_get_frame(struct domain *d, struct grant_table *gt)
+{
+    void *p;
+
+    spin_lock(&gt->prealloc_lock);
+    p = gt->prealloc_frames;
+    if ( p )
+    {
+        gt->prealloc_frames = *(void **)p;
+        gt->nr_prealloc_frames--;
+    }
+    spin_unlock(&gt->prealloc_lock);
+
+    if ( p )
+        *(void **)p = NULL; /* re-zero the chain word */
+    else
+    {
+        p = alloc_xenheap_pages(0, MEMF_node(domain_to_node(d)));
+        if ( p )
+            clear_page(p);
+    }
+
+    return p;
+}
+
+static void gnttab_prestage_frames(struct domain *d, unsigned int nr)
+{
+    struct grant_table *gt = d->grant_table;
+
+    while ( read_atomic(&gt->nr_prealloc_frames) < nr )
+    {
+        void *p = alloc_xenheap_pages(0, MEMF_node(domain_to_node(d)));
+
+        if ( p == NULL )
+            break;
+        clear_page(p);
+
+        spin_lock(&gt->prealloc_lock);
+        *(void **)p = gt->prealloc_frames;
+        gt->prealloc_frames = p;
+        gt->nr_prealloc_frames++;
+        spin_unlock(&gt->prealloc_lock);
+    }
+}
+
+/*
+ * Frames gnttab_grow_table() will consume to reach @req_nr_frames.  An
+ * unlocked (hence approximate) reading of the current sizes is fine for
+ * pre-staging purposes: staging too much or too little is only a matter
+ * of where the remainder gets allocated.
+ */
+static unsigned int gnttab_frames_needed(struct grant_table *gt,
+                                         unsigned int req_nr_frames)
+{
+    unsigned int nr = 0;
+
+    if ( req_nr_frames < INITIAL_NR_GRANT_FRAMES )
+        req_nr_frames = INITIAL_NR_GRANT_FRAMES;
+
+    if ( num_act_frames_from_sha_frames(req_nr_frames) >
+         nr_active_grant_frames(gt) )
+        nr += num_act_frames_from_sha_frames(req_nr_frames) -
+              nr_active_grant_frames(gt);
+    if ( req_nr_frames > nr_grant_frames(gt) )
+        nr += req_nr_frames - nr_grant_frames(gt);
+    if ( gt->gt_version > 1 &&
+         grant_to_status_frames(req_nr_frames) > nr_status_frames(gt) )
+        nr += grant_to_status_frames(req_nr_frames) - nr_status_frames(gt);
+
+    return nr;
+}
+
 static int
 gnttab_populate_status_frames(struct domain *d, struct grant_table *gt,
                               unsigned int req_nr_frames)
@@ -1629,9 +1775,8 @@ gnttab_populate_status_frames(struct domain *d, struct grant_table *gt,
     req_status_frames = grant_to_status_frames(req_nr_frames);
     for ( i = nr_status_frames(gt); i < req_status_frames; i++ )
     {
-        if ( (gt->status[i] = alloc_xenheap_page()) == NULL )
+        if ( (gt->status[i] = gnttab_get_frame(d, gt)) == NULL )
             goto status_alloc_failed;
-        clear_page(gt->status[i]);
     }
     /* Share the new status frames with the recipient domain */
     for ( i = nr_status_frames(gt); i < req_status_frames; i++ )
@@ -1750,9 +1895,8 @@ gnttab_grow_table(struct domain *d, unsigned int req_nr_frames)
     for ( i = nr_active_grant_frames(gt);
           i < num_act_frames_from_sha_frames(req_nr_frames); i++ )
     {
-        if ( (gt->active[i] = alloc_xenheap_page()) == NULL )
+        if ( (gt->active[i] = gnttab_get_frame(d, gt)) == NULL )
             goto active_alloc_failed;
-        clear_page(gt->active[i]);
         for ( j = 0; j < ACGNT_PER_PAGE; j++ )
             spin_lock_init(&gt->active[i][j].lock);
     }
@@ -1760,9 +1904,8 @@ gnttab_grow_table(struct domain *d, unsigned int req_nr_frames)
     /* Shared */
     for ( i = nr_grant_frames(gt); i < req_nr_frames; i++ )
     {
-        if ( (gt->shared_raw[i] = alloc_xenheap_page()) == NULL )
+        if ( (gt->shared_raw[i] = gnttab_get_frame(d, gt)) == NULL )
             goto shared_alloc_failed;
-        clear_page(gt->shared_raw[i]);
     }
 
     /* Status pages - version 2 */
@@ -1815,6 +1958,7 @@ int grant_table_init(struct domain *d, unsigned int max_grant_frames,
     /* Simple stuff. */
     percpu_rwlock_resource_init(&gt->lock, grant_rwlock);
     spin_lock_init(&gt->maptrack_lock);
+    spin_lock_init(&gt->prealloc_lock);
 
     gt->gt_version = 1;
     gt->max_grant_frames = max_grant_frames;
@@ -1902,6 +2046,12 @@ gnttab_setup_table(
     }
 
     gt = d->grant_table;
+
+    /* Stage the frames a growth will need before stalling grant ops. */
+    if ( op.nr_frames <= gt->max_grant_frames &&
+         op.nr_frames > nr_grant_frames(gt) )
+        gnttab_prestage_frames(d, gnttab_frames_needed(gt, op.nr_frames));
+
     grant_write_lock(gt);
 
     if ( unlikely(op.nr_frames > gt->max_grant_frames) )
@@ -2312,6 +2462,8 @@ release_grant_for_copy(
 
     grant_read_lock(rgt);
 
+    grant_prefetch_v2(rgt, gref);
+
     act = active_entry_acquire(rgt, gref);
     sha = shared_entry_header(rgt, gref);
     mfn = act->mfn;
@@ -2410,6 +2562,8 @@ acquire_grant_for_copy(
         PIN_FAIL(gt_unlock_out, GNTST_bad_gntref,
                  "Bad grant reference %#x\n", gref);
 
+    grant_prefetch_v2(rgt, gref);
+
     act = active_entry_acquire(rgt, gref);
     shah = shared_entry_header(rgt, gref);
     if ( rgt->gt_version == 1 )
@@ -2890,8 +3044,8 @@ static int gnttab_copy_one(const struct gnttab_copy *op,
 static long gnttab_copy(
     XEN_GUEST_HANDLE_PARAM(gnttab_copy_t) uop, unsigned int count)
 {
-    unsigned int i;
-    struct gnttab_copy op;
+    unsigned int i, base = 0, n = 0;
+    struct gnttab_copy op[16], *cur;
     struct gnttab_copy_buf src = {};
     struct gnttab_copy_buf dest = {};
     long rc = 0;
@@ -2904,13 +3058,26 @@ static long gnttab_copy(
             break;
         }
 
-        if ( unlikely(__copy_from_guest(&op, uop, 1)) )
+        /*
+         * Fetch guest ops in batches: storage and network backends issue
+         * dozens of ops per hypercall, and pulling them in chunks saves a
+         * guest access (and the SMAP round trip it entails) per entry.
+         */
+        if ( !n )
         {
-            rc = -EFAULT;
-            break;
+            base = i;
+            n = min(count - i, (unsigned int)ARRAY_SIZE(op));
+            if ( unlikely(__copy_from_guest(op, uop, n)) )
+            {
+                rc = -EFAULT;
+                break;
+            }
         }
+        cur = &op[i - base];
+        if ( i - base == n - 1 )
+            n = 0;
 
-        rc = gnttab_copy_one(&op, &dest, &src);
+        rc = gnttab_copy_one(cur, &dest, &src);
         if ( rc > 0 )
         {
             rc = count - i;
@@ -2922,9 +3089,9 @@ static long gnttab_copy(
             gnttab_copy_release_buf(&dest);
         }
 
-        op.status = rc;
+        cur->status = rc;
         rc = 0;
-        if ( unlikely(__copy_field_to_guest(uop, &op, status)) )
+        if ( unlikely(__copy_field_to_guest(uop, cur, status)) )
         {
             rc = -EFAULT;
             break;
@@ -3406,6 +3573,8 @@ do_grant_table_op(
     if ( (cmd &= GNTTABOP_CMD_MASK) != GNTTABOP_cache_flush && opaque_in )
         return -EINVAL;
 
+    domperf_add(current, grant_ops, count);
+
     rc = -EFAULT;
     switch ( cmd )
     {
@@ -3574,15 +3743,16 @@ void
 gnttab_release_mappings(
     struct domain *d)
 {
-    struct grant_table   *gt = d->grant_table, *rgt;
+    struct grant_table   *gt = d->grant_table, *rgt = NULL;
     struct grant_mapping *map;
     grant_ref_t           ref;
     grant_handle_t        handle;
-    struct domain        *rd;
+    struct domain        *rd = NULL;
     struct active_grant_entry *act;
     grant_entry_header_t *sha;
     uint16_t             *status;
     struct page_info     *pg;
+    unsigned int          held = 0;
 
     BUG_ON(!d->is_dying);
 
@@ -3597,16 +3767,35 @@ gnttab_release_mappings(
         gdprintk(XENLOG_INFO, "Grant release %#x ref %#x flags %#x d%d\n",
                  handle, ref, map->flags, map->domid);
 
-        rd = rcu_lock_domain_by_id(map->domid);
-        if ( rd == NULL )
+        /*
+         * Backends with long-lived (persistent) mappings have many
+         * thousands of consecutive maptrack entries referencing the
+         * same remote domain. Keep that domain and its grant table
+         * locked across such runs instead of re-acquiring everything
+         * per handle, dropping the lock periodically so concurrent
+         * grant operations against the table aren't starved.
+         */
+        if ( rd && (rd->domain_id != map->domid || ++held >= 64) )
         {
-            /* Nothing to clear up... */
-            map->flags = 0;
-            continue;
+            grant_read_unlock(rgt);
+            rcu_unlock_domain(rd);
+            rd = NULL;
+            held = 0;
         }
 
-        rgt = rd->grant_table;
-        grant_read_lock(rgt);
+        if ( !rd )
+        {
+            rd = rcu_lock_domain_by_id(map->domid);
+            if ( rd == NULL )
+            {
+                /* Nothing to clear up... */
+                map->flags = 0;
+                continue;
+            }
+
+            rgt = rd->grant_table;
+            grant_read_lock(rgt);
+        }
 
         act = active_entry_acquire(rgt, ref);
         sha = shared_entry_header(rgt, ref);
@@ -3669,12 +3858,15 @@ gnttab_release_mappings(
             gnttab_clear_flag(_GTF_reading, status);
 
         active_entry_release(act);
-        grant_read_unlock(rgt);
-
-        rcu_unlock_domain(rd);
 
         map->flags = 0;
     }
+
+    if ( rd )
+    {
+        grant_read_unlock(rgt);
+        rcu_unlock_domain(rd);
+    }
 }
 
 void grant_table_warn_active_grants(struct domain *d)
@@ -3749,6 +3941,14 @@ grant_table_destroy(
         free_xenheap_page(t->status[i]);
     xfree(t->status);
 
+    while ( t->prealloc_frames )
+    {
+        void *p = t->prealloc_frames;
+
+        t->prealloc_frames = *(void **)p;
+        free_xenheap_page(p);
+    }
+
     xfree(t);
     d->grant_table = NULL;
 }
@@ -26,6 +26,7 @@
 #include <xen/console.h>
 #include <xen/kexec.h>
 #include <xen/kimage.h>
+#include <xen/liveupdate.h>
 #include <public/elfnote.h>
 #include <xsm/xsm.h>
 #include <xen/cpu.h>
@@ -736,6 +737,8 @@ static int kexec_load_get_bits(int type, int *base, int *bit)
     switch ( type )
     {
     case KEXEC_TYPE_DEFAULT:
+    case KEXEC_TYPE_LIVE_UPDATE:
+        /* A live update (re)uses the regular kexec image slots. */
         *base = KEXEC_IMAGE_DEFAULT_BASE;
         *bit = KEXEC_FLAG_DEFAULT_POS;
         break;
@@ -833,6 +836,11 @@ static int kexec_exec(XEN_GUEST_HANDLE_PARAM(void) uarg)
 
     switch (exec.type)
     {
+    case KEXEC_TYPE_LIVE_UPDATE:
+        ret = liveupdate_save();
+        if ( ret )
+            return ret;
+        /* Fall through - jump into the regularly loaded image. */
     case KEXEC_TYPE_DEFAULT:
         image = kexec_image[base + pos];
         ret = continue_hypercall_on_cpu(0, kexec_reboot, image);
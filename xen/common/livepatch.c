@@ -56,6 +56,8 @@ struct payload {
     int32_t rc;                          /* 0 or -XEN_EXX. */
     bool reverted;                       /* Whether it was reverted. */
     bool safe_to_reapply;                /* Can apply safely after revert. */
+    s_time_t rendezvous_ns;              /* Time to gather CPUs for the last action. */
+    s_time_t patch_ns;                   /* Time CPUs were held while patching. */
     struct list_head list;               /* Linked to 'payload_list'. */
     const void *text_addr;               /* Virtual address of .text. */
     size_t text_size;                    /* .. and its size. */
@@ -980,6 +982,8 @@ static int livepatch_get(struct xen_sysctl_livepatch_get *get)
 
     get->status.state = data->state;
     get->status.rc = data->rc;
+    get->status.rendezvous_ns = data->rendezvous_ns;
+    get->status.patch_ns = data->patch_ns;
 
     spin_unlock(&payload_lock);
 
@@ -1023,6 +1027,8 @@ static int livepatch_list(struct xen_sysctl_livepatch_list *list)
 
             status.state = data->state;
             status.rc = data->rc;
+            status.rendezvous_ns = data->rendezvous_ns;
+            status.patch_ns = data->patch_ns;
             len = strlen(data->name) + 1;
 
             /* N.B. 'idx' != 'i'. */
@@ -1060,9 +1066,6 @@ static int apply_payload(struct payload *data)
     unsigned int i;
     int rc;
 
-    printk(XENLOG_INFO LIVEPATCH "%s: Applying %u functions\n",
-            data->name, data->nfuncs);
-
     rc = arch_livepatch_quiesce();
     if ( rc )
     {
@@ -1102,8 +1105,6 @@ static int revert_payload(struct payload *data)
     unsigned int i;
     int rc;
 
-    printk(XENLOG_INFO LIVEPATCH "%s: Reverting\n", data->name);
-
     rc = arch_livepatch_quiesce();
     if ( rc )
     {
@@ -1228,6 +1229,30 @@ static int schedule_work(struct payload *data, uint32_t cmd, uint32_t timeout)
     livepatch_work.cmd = cmd;
     livepatch_work.data = data;
     livepatch_work.timeout = timeout ?: MILLISECS(30);
+    data->rendezvous_ns = 0;
+    data->patch_ns = 0;
+
+    /*
+     * Announce the action here rather than in apply/revert_payload: those
+     * run with every CPU held in the rendezvous, where console I/O would
+     * needlessly extend the global pause.
+     */
+    switch ( cmd )
+    {
+    case LIVEPATCH_ACTION_APPLY:
+        printk(XENLOG_INFO LIVEPATCH "%s: Applying %u functions\n",
+               data->name, data->nfuncs);
+        break;
+
+    case LIVEPATCH_ACTION_REVERT:
+        printk(XENLOG_INFO LIVEPATCH "%s: Reverting\n", data->name);
+        break;
+
+    case LIVEPATCH_ACTION_REPLACE:
+        printk(XENLOG_INFO LIVEPATCH "%s: Replacing all applied payloads\n",
+               data->name);
+        break;
+    }
 
     dprintk(XENLOG_DEBUG, LIVEPATCH "%s: timeout is %"PRIu32"ns\n",
             data->name, livepatch_work.timeout);
@@ -1310,6 +1335,7 @@ void check_for_livepatch_work(void)
     {
         struct payload *p;
         unsigned int cpus;
+        s_time_t rendezvous_start;
 
         p = livepatch_work.data;
         if ( !get_cpu_maps() )
@@ -1341,7 +1367,8 @@ void check_for_livepatch_work(void)
             smp_call_function(reschedule_fn, NULL, 0);
         }
 
-        timeout = livepatch_work.timeout + NOW();
+        rendezvous_start = NOW();
+        timeout = livepatch_work.timeout + rendezvous_start;
         if ( livepatch_spin(&livepatch_work.semaphore, timeout, cpus, "CPU") )
             goto abort;
 
@@ -1357,12 +1384,16 @@ void check_for_livepatch_work(void)
 
         if ( !livepatch_spin(&livepatch_work.semaphore, timeout, cpus, "IRQ") )
         {
+            s_time_t patch_start = NOW();
+
+            p->rendezvous_ns = patch_start - rendezvous_start;
             local_irq_save(flags);
             /* Do the patching. */
             livepatch_do_action();
             /* Serialize and flush out the CPU via CPUID instruction (on x86). */
             arch_livepatch_post_action();
             local_irq_restore(flags);
+            p->patch_ns = NOW() - patch_start;
         }
 
  abort:
@@ -1374,8 +1405,10 @@ void check_for_livepatch_work(void)
         /* put_cpu_maps has an barrier(). */
         put_cpu_maps();
 
-        printk(XENLOG_INFO LIVEPATCH "%s finished %s with rc=%d\n",
-               p->name, names[livepatch_work.cmd], p->rc);
+        printk(XENLOG_INFO LIVEPATCH "%s finished %s with rc=%d"
+               " (rendezvous %"PRI_stime"ns, patch %"PRI_stime"ns)\n",
+               p->name, names[livepatch_work.cmd], p->rc,
+               p->rendezvous_ns, p->patch_ns);
     }
     else
     {
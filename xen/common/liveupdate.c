@@ -0,0 +1,164 @@
+/******************************************************************************
+ * liveupdate.c
+ *
+ * Warm-restart of the hypervisor via kexec, preserving a state stream in
+ * a reserved memory region.
+ *
+ * The "liveupdate=<size>@<address>" command line option reserves a block
+ * of RAM which never enters the heap.  On a KEXEC_TYPE_LIVE_UPDATE exec
+ * the old hypervisor writes a stream of per-domain records there; the new
+ * hypervisor finds the stream on boot.  Only the staging/handover
+ * mechanism and a minimal domain inventory are implemented here - the
+ * records do not yet carry enough state (p2m, vCPU contexts, grant
+ * tables) to actually reattach domains.
+ */
+
+#include <xen/init.h>
+#include <xen/kernel.h>
+#include <xen/lib.h>
+#include <xen/mm.h>
+#include <xen/sched.h>
+#include <xen/liveupdate.h>
+
+xen_kexec_reserve_t liveupdate_area;
+
+#define LU_STREAM_MAGIC   0x586c5570644d3031ULL /* "XlUpdM01" */
+#define LU_STREAM_VERSION 1
+
+struct lu_stream_hdr {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t nr_domains;
+    uint64_t len;            /* Total stream length, header included. */
+};
+
+struct lu_domain_rec {
+    uint16_t domid;
+    uint16_t pad;
+    uint32_t max_vcpus;
+    uint64_t tot_pages;
+    uint64_t max_pages;
+    uint64_t shared_info_mfn;
+};
+
+/* liveupdate=<size>@<address> */
+static int __init parse_liveupdate(const char *s)
+{
+    const char *cur;
+
+    liveupdate_area.size = parse_size_and_unit(cur = s, &s);
+    if ( cur == s )
+    {
+        printk(XENLOG_WARNING "liveupdate: memory value expected\n");
+        return -EINVAL;
+    }
+
+    if ( *s == '@' )
+        liveupdate_area.start = parse_size_and_unit(cur = s + 1, &s);
+
+    if ( !liveupdate_area.start || !liveupdate_area.size )
+    {
+        printk(XENLOG_WARNING
+               "liveupdate: both size and address required - disabled\n");
+        liveupdate_area.start = liveupdate_area.size = 0;
+        return -EINVAL;
+    }
+
+    return *s ? -EINVAL : 0;
+}
+custom_param("liveupdate", parse_liveupdate);
+
+bool liveupdate_enabled(void)
+{
+    return liveupdate_area.start && liveupdate_area.size;
+}
+
+int liveupdate_save(void)
+{
+    struct lu_stream_hdr *hdr;
+    struct lu_domain_rec *rec;
+    struct domain *d;
+    unsigned int nr = 0;
+
+    if ( !liveupdate_enabled() )
+        return -ENODEV;
+
+    hdr = __va(liveupdate_area.start);
+    rec = (struct lu_domain_rec *)(hdr + 1);
+
+    rcu_read_lock(&domlist_read_lock);
+
+    for_each_domain ( d )
+    {
+        if ( (void *)(rec + 1) > (void *)hdr + liveupdate_area.size )
+        {
+            rcu_read_unlock(&domlist_read_lock);
+            return -ENOSPC;
+        }
+
+        rec->domid = d->domain_id;
+        rec->pad = 0;
+        rec->max_vcpus = d->max_vcpus;
+        rec->tot_pages = d->tot_pages;
+        rec->max_pages = d->max_pages;
+        rec->shared_info_mfn = virt_to_mfn(d->shared_info);
+        ++rec;
+        ++nr;
+    }
+
+    rcu_read_unlock(&domlist_read_lock);
+
+    hdr->version = LU_STREAM_VERSION;
+    hdr->nr_domains = nr;
+    hdr->len = (void *)rec - (void *)hdr;
+    /* Written last: the stream only becomes valid once fully staged. */
+    hdr->magic = LU_STREAM_MAGIC;
+
+    printk("liveupdate: staged %u domain record(s), %"PRIu64" bytes\n",
+           nr, hdr->len);
+
+    return 0;
+}
+
+static int __init liveupdate_init(void)
+{
+    struct lu_stream_hdr *hdr;
+
+    if ( !liveupdate_enabled() )
+        return 0;
+
+    hdr = __va(liveupdate_area.start);
+
+    if ( hdr->magic == LU_STREAM_MAGIC )
+    {
+        if ( hdr->version != LU_STREAM_VERSION )
+            printk(XENLOG_WARNING
+                   "liveupdate: stream version %u from previous hypervisor"
+                   " not understood (expected %u)\n",
+                   hdr->version, LU_STREAM_VERSION);
+        else
+            printk("liveupdate: found stream from previous hypervisor:"
+                   " %u domain(s), %"PRIu64" bytes"
+                   " (restore not implemented, discarding)\n",
+                   hdr->nr_domains, hdr->len);
+
+        /* Consume the stream so a crash/reboot cannot replay stale state. */
+        hdr->magic = 0;
+    }
+    else
+        printk("liveupdate: %"PRIu64"kB state area at %#"PRIx64"\n",
+               liveupdate_area.size >> 10, liveupdate_area.start);
+
+    return 0;
+}
+__initcall(liveupdate_init);
+
+/*
+ * Local variables:
+ * mode: C
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -414,6 +414,131 @@ int guest_remove_page(struct domain *d, unsigned long gmfn)
     return rc != -ENOENT ? rc : -EINVAL;
 }
 
+/*
+ * Drop the final reference to @page without freeing it; the caller takes
+ * over responsibility for returning the page to the allocator.
+ */
+static void put_final_page_ref(struct page_info *page)
+{
+    unsigned long x, y = page->count_info;
+
+    do {
+        x = y;
+        ASSERT((x & PGC_count_mask) == 1);
+    } while ( (y = cmpxchg(&page->count_info, x, x - 1)) != x );
+}
+
+/*
+ * Remove a 2^@order page chunk in one go, provided it is contiguously
+ * mapped, suitably aligned, and consists of nothing but plain RAM.  A
+ * single p2m update covering the whole chunk avoids shattering a
+ * superpage mapping only to then discard its pieces, and if no other
+ * references are held the memory goes back to the allocator as one
+ * block, taking the heap lock once rather than once per page.
+ *
+ * Returns false, leaving the p2m untouched, if the chunk needs the page
+ * by page treatment of guest_remove_page().
+ */
+static bool guest_remove_superpage(struct domain *d, unsigned long gmfn,
+                                   unsigned int order)
+{
+    unsigned long i, nr = 1UL << order;
+    struct page_info *page;
+    mfn_t mfn;
+#ifdef CONFIG_X86
+    p2m_type_t p2mt;
+#endif
+
+    if ( !order || (gmfn & (nr - 1)) || is_domain_direct_mapped(d) )
+        return false;
+
+#ifdef CONFIG_X86
+    /*
+     * Once the p2m entries are gone only existing references can be
+     * dropped.  That isn't true for a non-translated guest, which can
+     * keep obtaining references by MFN, so make it use the ordinary
+     * page by page path.
+     */
+    if ( !paging_mode_translate(d) )
+        return false;
+
+    mfn = get_gfn_query(d, gmfn, &p2mt);
+    if ( p2mt != p2m_ram_rw )
+        goto out_put_gfn;
+#else
+    mfn = gfn_to_mfn(d, _gfn(gmfn));
+#endif
+    if ( !mfn_valid(mfn) || (mfn_x(mfn) & (nr - 1)) )
+        goto out_put_gfn;
+
+    /* The remainder of the chunk must be contiguous plain RAM. */
+    for ( i = 1; i < nr; i++ )
+    {
+#ifdef CONFIG_X86
+        /* Stable, as get_gfn_query() above holds the p2m lock. */
+        mfn_t mfn_i = get_gfn_query_unlocked(d, gmfn + i, &p2mt);
+
+        if ( p2mt != p2m_ram_rw || !mfn_eq(mfn_i, mfn_add(mfn, i)) )
+            goto out_put_gfn;
+#else
+        if ( !mfn_eq(gfn_to_mfn(d, _gfn(gmfn + i)), mfn_add(mfn, i)) )
+            goto out_put_gfn;
+#endif
+    }
+
+    page = mfn_to_page(mfn);
+    for ( i = 0; i < nr; i++ )
+        if ( unlikely(!get_page(page + i, d)) )
+        {
+            while ( i-- )
+                put_page(page + i);
+            goto out_put_gfn;
+        }
+
+    if ( guest_physmap_remove_page(d, _gfn(gmfn), mfn, order) )
+    {
+        for ( i = 0; i < nr; i++ )
+            put_page(page + i);
+        goto out_put_gfn;
+    }
+
+#ifdef CONFIG_X86
+    put_gfn(d, gmfn);
+#endif
+
+    /* Drop the allocation references; ours keep the pages alive. */
+    for ( i = 0; i < nr; i++ )
+        if ( test_and_clear_bit(_PGC_allocated, &page[i].count_info) )
+            put_page(page + i);
+
+    /*
+     * If we hold the only remaining reference on every page, free the
+     * chunk as a single block.  No new references can appear (the p2m
+     * entries are gone), so the counts can only fall, and ours cannot.
+     */
+    for ( i = 0; i < nr; i++ )
+        if ( (page[i].count_info & PGC_count_mask) != 1 )
+            break;
+
+    if ( i == nr )
+    {
+        for ( i = 0; i < nr; i++ )
+            put_final_page_ref(page + i);
+        free_domheap_pages(page, order);
+    }
+    else
+        for ( i = 0; i < nr; i++ )
+            put_page(page + i);
+
+    return true;
+
+ out_put_gfn:
+#ifdef CONFIG_X86
+    put_gfn(d, gmfn);
+#endif
+    return false;
+}
+
 static void decrease_reservation(struct memop_args *a)
 {
     unsigned long i, j;
@@ -437,7 +562,7 @@ static void decrease_reservation(struct memop_args *a)
         if ( unlikely(__copy_from_guest_offset(&gmfn, a->extent_list, i, 1)) )
             goto out;
 
-        if ( tb_init_done )
+        if ( tracing_active() )
         {
             struct {
                 u64 gfn;
@@ -456,6 +581,11 @@ static void decrease_reservation(struct memop_args *a)
                    p2m_pod_decrease_reservation(a->domain, _gfn(gmfn),
                                                 a->extent_order) : 0;
 
+        /* A fully populated, contiguous chunk can be removed wholesale. */
+        if ( !pod_done &&
+             guest_remove_superpage(a->domain, gmfn, a->extent_order) )
+            continue;
+
         /*
          * Look for pages not handled by p2m_pod_decrease_reservation().
          *
@@ -1150,7 +1280,8 @@ static int acquire_resource(
 
 long do_memory_op(unsigned long cmd, XEN_GUEST_HANDLE_PARAM(void) arg)
 {
-    struct domain *d, *curr_d = current->domain;
+    struct vcpu *curr = current;
+    struct domain *d, *curr_d = curr->domain;
     long rc;
     struct xen_memory_reservation reservation;
     struct memop_args args;
@@ -1163,34 +1294,54 @@ long do_memory_op(unsigned long cmd, XEN_GUEST_HANDLE_PARAM(void) arg)
     case XENMEM_increase_reservation:
     case XENMEM_decrease_reservation:
     case XENMEM_populate_physmap:
-        if ( copy_from_guest(&reservation, arg, 1) )
-            return start_extent;
+        if ( start_extent && op == curr->memop_cont.op &&
+             start_extent == curr->memop_cont.start_extent )
+        {
+            /*
+             * Continuation of an operation whose arguments were fetched
+             * and validated when it was first preempted - resume from the
+             * saved state instead of re-marshalling them.
+             */
+            d = rcu_lock_domain_by_any_id(curr->memop_cont.domid);
+            if ( d == NULL )
+                return start_extent;
+            args.domain       = d;
+            args.extent_list  = curr->memop_cont.extent_list;
+            args.nr_extents   = curr->memop_cont.nr_extents;
+            args.extent_order = curr->memop_cont.extent_order;
+            args.memflags     = curr->memop_cont.memflags;
+        }
+        else
+        {
+            if ( copy_from_guest(&reservation, arg, 1) )
+                return start_extent;
 
-        /* Is size too large for us to encode a continuation? */
-        if ( reservation.nr_extents > (UINT_MAX >> MEMOP_EXTENT_SHIFT) )
-            return start_extent;
+            /* Is size too large for us to encode a continuation? */
+            if ( reservation.nr_extents > (UINT_MAX >> MEMOP_EXTENT_SHIFT) )
+                return start_extent;
 
-        if ( unlikely(start_extent >= reservation.nr_extents) )
-            return start_extent;
+            if ( unlikely(start_extent >= reservation.nr_extents) )
+                return start_extent;
 
-        d = rcu_lock_domain_by_any_id(reservation.domid);
-        if ( d == NULL )
-            return start_extent;
-        args.domain = d;
+            d = rcu_lock_domain_by_any_id(reservation.domid);
+            if ( d == NULL )
+                return start_extent;
+            args.domain = d;
 
-        if ( construct_memop_from_reservation(&reservation, &args) )
-        {
-            rcu_unlock_domain(d);
-            return start_extent;
+            if ( construct_memop_from_reservation(&reservation, &args) )
+            {
+                rcu_unlock_domain(d);
+                return start_extent;
+            }
+
+            if ( op == XENMEM_populate_physmap
+                 && (reservation.mem_flags & XENMEMF_populate_on_demand) )
+                args.memflags |= MEMF_populate_on_demand;
         }
 
         args.nr_done   = start_extent;
         args.preempted = 0;
 
-        if ( op == XENMEM_populate_physmap
-             && (reservation.mem_flags & XENMEMF_populate_on_demand) )
-            args.memflags |= MEMF_populate_on_demand;
-
         if ( xsm_memory_adjust_reservation(XSM_TARGET, curr_d, d) )
         {
             rcu_unlock_domain(d);
@@ -1216,6 +1367,20 @@ long do_memory_op(unsigned long cmd, XEN_GUEST_HANDLE_PARAM(void) arg)
             break;
         }
 
+        if ( args.preempted )
+        {
+            /* Stash the validated arguments for the continuation. */
+            curr->memop_cont.op           = op;
+            curr->memop_cont.start_extent = args.nr_done;
+            curr->memop_cont.domid        = d->domain_id;
+            curr->memop_cont.memflags     = args.memflags;
+            curr->memop_cont.extent_order = args.extent_order;
+            curr->memop_cont.nr_extents   = args.nr_extents;
+            curr->memop_cont.extent_list  = args.extent_list;
+        }
+        else
+            curr->memop_cont.start_extent = 0;
+
         rcu_unlock_domain(d);
 
         rc = args.nr_done;
@@ -1303,8 +1468,9 @@ long do_memory_op(unsigned long cmd, XEN_GUEST_HANDLE_PARAM(void) arg)
         if ( copy_from_guest(&xatp, arg, 1) )
             return -EFAULT;
 
-        /* Foreign mapping is only possible via add_to_physmap_batch. */
-        if ( xatp.space == XENMAPSPACE_gmfn_foreign )
+        /* Foreign mappings are only possible via add_to_physmap_batch. */
+        if ( xatp.space == XENMAPSPACE_gmfn_foreign ||
+             xatp.space == XENMAPSPACE_gmfn_foreign_2m )
             return -ENOSYS;
 
         d = rcu_lock_domain_by_any_id(xatp.domid);
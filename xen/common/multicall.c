@@ -26,7 +26,7 @@ static void __trace_multicall_call(multicall_entry_t *call)
 
 static void trace_multicall_call(multicall_entry_t *call)
 {
-    if ( !tb_init_done )
+    if ( !tracing_active() )
         return;
 
     __trace_multicall_call(call);
@@ -124,6 +124,7 @@
 #include <xen/types.h>
 #include <xen/lib.h>
 #include <xen/sched.h>
+#include <xen/seqlock.h>
 #include <xen/spinlock.h>
 #include <xen/mm.h>
 #include <xen/irq.h>
@@ -134,6 +135,7 @@
 #include <xen/pfn.h>
 #include <xen/numa.h>
 #include <xen/nodemask.h>
+#include <xen/cpu.h>
 #include <xen/event.h>
 #include <xen/tmem.h>
 #include <xen/tmem_xen.h>
@@ -446,6 +448,13 @@ typedef struct page_list_head heap_by_zone_and_order_t[NR_ZONES][MAX_ORDER+1];
 static heap_by_zone_and_order_t *_heap[MAX_NUMNODES];
 #define heap(node, zone, order) ((*_heap[node])[zone][order])
 
+/*
+ * Allocations of at least this order (2M worth of pages) are the ones
+ * hurt by fragmentation; used for the 'H' keyhandler fragmentation
+ * report and the domheap_hiorder_fail counter.
+ */
+#define FRAG_HIGH_ORDER 9
+
 static unsigned long node_need_scrub[MAX_NUMNODES];
 
 static unsigned long *avail[MAX_NUMNODES];
@@ -455,14 +464,44 @@ static long total_avail_pages;
 static long midsize_alloc_zone_pages;
 #define MIDSIZE_ALLOC_FRAC 128
 
+/*
+ * Each node's heap lists and the per-node counters (avail[],
+ * node_need_scrub[]) are protected by that node's lock.  The global
+ * heap_lock now only covers cross-node state: total_avail_pages,
+ * outstanding_claims, midsize_alloc_zone_pages, first_valid_mfn and the
+ * offlined/broken page lists.  Where both are needed, a node lock is
+ * always acquired first.
+ */
+static spinlock_t node_heap_lock[MAX_NUMNODES] = {
+    [0 ... MAX_NUMNODES - 1] = SPIN_LOCK_UNLOCKED
+};
 static DEFINE_SPINLOCK(heap_lock);
 static long outstanding_claims; /* total outstanding claims by all domains */
 
+/* Quiesce every node's heap, e.g. around boot-time scrubbing. */
+static void __init lock_all_node_heaps(void)
+{
+    unsigned int node;
+
+    for ( node = 0; node < MAX_NUMNODES; node++ )
+        spin_lock(&node_heap_lock[node]);
+}
+
+static void __init unlock_all_node_heaps(void)
+{
+    unsigned int node = MAX_NUMNODES;
+
+    while ( node-- )
+        spin_unlock(&node_heap_lock[node]);
+}
+
 unsigned long domain_adjust_tot_pages(struct domain *d, long pages)
 {
     long dom_before, dom_after, dom_claimed, sys_before, sys_after;
 
     ASSERT(spin_is_locked(&d->page_alloc_lock));
+
+    write_seqcount_begin(&d->page_alloc_count);
     d->tot_pages += pages;
 
     /*
@@ -488,9 +527,28 @@ unsigned long domain_adjust_tot_pages(struct domain *d, long pages)
     spin_unlock(&heap_lock);
 
 out:
+    write_seqcount_end(&d->page_alloc_count);
     return d->tot_pages;
 }
 
+/*
+ * Consistent lockless snapshot of a domain's memory accounting, for stat
+ * queries that must not delay allocation paths holding d->page_alloc_lock.
+ */
+void domain_get_accounting(struct domain *d, unsigned int *tot_pages,
+                           unsigned int *max_pages,
+                           unsigned int *outstanding_pages)
+{
+    unsigned int seq;
+
+    do {
+        seq = read_seqcount_begin(&d->page_alloc_count);
+        *tot_pages = d->tot_pages;
+        *max_pages = d->max_pages;
+        *outstanding_pages = d->outstanding_pages;
+    } while ( read_seqcount_retry(&d->page_alloc_count, seq) );
+}
+
 int domain_set_outstanding_pages(struct domain *d, unsigned long pages)
 {
     int ret = -ENOMEM;
@@ -503,6 +561,7 @@ int domain_set_outstanding_pages(struct domain *d, unsigned long pages)
      */
     spin_lock(&d->page_alloc_lock);
     spin_lock(&heap_lock);
+    write_seqcount_begin(&d->page_alloc_count);
 
     /* pages==0 means "unset" the claim. */
     if ( pages == 0 )
@@ -556,6 +615,7 @@ int domain_set_outstanding_pages(struct domain *d, unsigned long pages)
     ret = 0;
 
 out:
+    write_seqcount_end(&d->page_alloc_count);
     spin_unlock(&heap_lock);
     spin_unlock(&d->page_alloc_lock);
     return ret;
@@ -851,37 +911,47 @@ static struct page_info *get_free_buddy(unsigned int zone_lo,
      * Start with requested node, but exhaust all node memory in requested
      * zone before failing, only calc new node value if we fail to find memory
      * in target node, this avoids needless computation on fast-path.
+     *
+     * On success the lock of the node the returned buddy lives on is held;
+     * the caller is responsible for releasing it.
      */
     for ( ; ; )
     {
-        zone = zone_hi;
-        do {
-            /* Check if target node can support the allocation. */
-            if ( !avail[node] || (avail[node][zone] < (1UL << order)) )
-                continue;
+        if ( avail[node] )
+        {
+            spin_lock(&node_heap_lock[node]);
 
-            /* Find smallest order which can satisfy the request. */
-            for ( j = order; j <= MAX_ORDER; j++ )
-            {
-                if ( (pg = page_list_remove_head(&heap(node, zone, j))) )
+            zone = zone_hi;
+            do {
+                /* Check if target node can support the allocation. */
+                if ( avail[node][zone] < (1UL << order) )
+                    continue;
+
+                /* Find smallest order which can satisfy the request. */
+                for ( j = order; j <= MAX_ORDER; j++ )
                 {
-                    if ( pg->u.free.first_dirty == INVALID_DIRTY_IDX )
-                        return pg;
-                    /*
-                     * We grab single pages (order=0) even if they are
-                     * unscrubbed. Given that scrubbing one page is fairly quick
-                     * it is not worth breaking higher orders.
-                     */
-                    if ( (order == 0) || use_unscrubbed )
+                    if ( (pg = page_list_remove_head(&heap(node, zone, j))) )
                     {
-                        check_and_stop_scrub(pg);
-                        return pg;
-                    }
+                        if ( pg->u.free.first_dirty == INVALID_DIRTY_IDX )
+                            return pg;
+                        /*
+                         * We grab single pages (order=0) even if they are
+                         * unscrubbed. Given that scrubbing one page is fairly
+                         * quick it is not worth breaking higher orders.
+                         */
+                        if ( (order == 0) || use_unscrubbed )
+                        {
+                            check_and_stop_scrub(pg);
+                            return pg;
+                        }
 
-                    page_list_add_tail(pg, &heap(node, zone, j));
+                        page_list_add_tail(pg, &heap(node, zone, j));
+                    }
                 }
-            }
-        } while ( zone-- > zone_lo ); /* careful: unsigned zone may wrap */
+            } while ( zone-- > zone_lo ); /* careful: unsigned zone may wrap */
+
+            spin_unlock(&node_heap_lock[node]);
+        }
 
         if ( (memflags & MEMF_exact_node) && req_node != NUMA_NO_NODE )
             return NULL;
@@ -958,24 +1028,23 @@ static struct page_info *alloc_heap_pages(
          (total_avail_pages <= midsize_alloc_zone_pages) &&
          tmem_freeable_pages() )
     {
-        /* Try to free memory from tmem. */
-        pg = tmem_relinquish_pages(order, memflags);
         spin_unlock(&heap_lock);
-        return pg;
+        /* Try to free memory from tmem. */
+        return tmem_relinquish_pages(order, memflags);
     }
 
+    spin_unlock(&heap_lock);
+
     pg = get_free_buddy(zone_lo, zone_hi, order, memflags, d);
     /* Try getting a dirty buddy if we couldn't get a clean one. */
     if ( !pg && !(memflags & MEMF_no_scrub) )
         pg = get_free_buddy(zone_lo, zone_hi, order,
                             memflags | MEMF_no_scrub, d);
     if ( !pg )
-    {
         /* No suitable memory blocks. Fail the request. */
-        spin_unlock(&heap_lock);
         return NULL;
-    }
 
+    /* get_free_buddy() returned with this node's heap lock held. */
     node = phys_to_nid(page_to_maddr(pg));
     zone = page_to_zone(pg);
     buddy_order = PFN_ORDER(pg);
@@ -1003,10 +1072,12 @@ static struct page_info *alloc_heap_pages(
 
     ASSERT(avail[node][zone] >= request);
     avail[node][zone] -= request;
+
+    spin_lock(&heap_lock);
     total_avail_pages -= request;
     ASSERT(total_avail_pages >= 0);
-
     check_low_mem_virq();
+    spin_unlock(&heap_lock);
 
     if ( d != NULL )
         d->last_alloc_node = node;
@@ -1037,7 +1108,7 @@ static struct page_info *alloc_heap_pages(
                           !(memflags & MEMF_no_icache_flush));
     }
 
-    spin_unlock(&heap_lock);
+    spin_unlock(&node_heap_lock[node]);
 
     if ( first_dirty != INVALID_DIRTY_IDX ||
          (scrub_debug && !(memflags & MEMF_no_scrub)) )
@@ -1051,9 +1122,9 @@ static struct page_info *alloc_heap_pages(
 
                 dirty_cnt++;
 
-                spin_lock(&heap_lock);
+                spin_lock(&node_heap_lock[node]);
                 pg[i].count_info &= ~PGC_need_scrub;
-                spin_unlock(&heap_lock);
+                spin_unlock(&node_heap_lock[node]);
             }
             else if ( !(memflags & MEMF_no_scrub) )
                 check_one_page(&pg[i]);
@@ -1061,9 +1132,9 @@ static struct page_info *alloc_heap_pages(
 
         if ( dirty_cnt )
         {
-            spin_lock(&heap_lock);
+            spin_lock(&node_heap_lock[node]);
             node_need_scrub[node] -= dirty_cnt;
-            spin_unlock(&heap_lock);
+            spin_unlock(&node_heap_lock[node]);
         }
     }
 
@@ -1081,7 +1152,7 @@ static int reserve_offlined_page(struct page_info *head)
     struct page_info *cur_head;
     unsigned int cur_order, first_dirty;
 
-    ASSERT(spin_is_locked(&heap_lock));
+    ASSERT(spin_is_locked(&node_heap_lock[node]));
 
     cur_head = head;
 
@@ -1157,12 +1228,15 @@ static int reserve_offlined_page(struct page_info *head)
             continue;
 
         avail[node][zone]--;
+
+        spin_lock(&heap_lock);
         total_avail_pages--;
         ASSERT(total_avail_pages >= 0);
 
         page_list_add_tail(cur_head,
                            test_bit(_PGC_broken, &cur_head->count_info) ?
                            &page_broken_list : &page_offlined_list);
+        spin_unlock(&heap_lock);
 
         count++;
     }
@@ -1272,7 +1346,7 @@ bool scrub_free_pages(void)
     if ( node == NUMA_NO_NODE )
         return false;
 
-    spin_lock(&heap_lock);
+    spin_lock(&node_heap_lock[node]);
 
     for ( zone = 0; zone < NR_ZONES; zone++ )
     {
@@ -1292,7 +1366,7 @@ bool scrub_free_pages(void)
                 ASSERT(pg->u.free.scrub_state == BUDDY_NOT_SCRUBBING);
                 pg->u.free.scrub_state = BUDDY_SCRUBBING;
 
-                spin_unlock(&heap_lock);
+                spin_unlock(&node_heap_lock[node]);
 
                 dirty_cnt = 0;
 
@@ -1322,9 +1396,9 @@ bool scrub_free_pages(void)
                         smp_wmb();
                         pg->u.free.scrub_state = BUDDY_NOT_SCRUBBING;
 
-                        spin_lock(&heap_lock);
+                        spin_lock(&node_heap_lock[node]);
                         node_need_scrub[node] -= dirty_cnt;
-                        spin_unlock(&heap_lock);
+                        spin_unlock(&node_heap_lock[node]);
                         goto out_nolock;
                     }
 
@@ -1351,7 +1425,7 @@ bool scrub_free_pages(void)
                 st.first_dirty = (i >= (1U << order) - 1) ?
                     INVALID_DIRTY_IDX : i + 1;
                 st.drop = false;
-                spin_lock_cb(&heap_lock, scrub_continue, &st);
+                spin_lock_cb(&node_heap_lock[node], scrub_continue, &st);
 
                 node_need_scrub[node] -= dirty_cnt;
 
@@ -1375,7 +1449,7 @@ bool scrub_free_pages(void)
     }
 
  out:
-    spin_unlock(&heap_lock);
+    spin_unlock(&node_heap_lock[node]);
 
  out_nolock:
     node_clear(node, node_scrubbing);
@@ -1394,7 +1468,7 @@ static void free_heap_pages(
     ASSERT(order <= MAX_ORDER);
     ASSERT(node >= 0);
 
-    spin_lock(&heap_lock);
+    spin_lock(&node_heap_lock[node]);
 
     for ( i = 0; i < (1 << order); i++ )
     {
@@ -1434,7 +1508,14 @@ static void free_heap_pages(
     }
 
     avail[node][zone] += 1 << order;
+
+    spin_lock(&heap_lock);
     total_avail_pages += 1 << order;
+    if ( tmem_enabled() )
+        midsize_alloc_zone_pages = max(
+            midsize_alloc_zone_pages, total_avail_pages / MIDSIZE_ALLOC_FRAC);
+    spin_unlock(&heap_lock);
+
     if ( need_scrub )
     {
         node_need_scrub[node] += 1 << order;
@@ -1443,10 +1524,6 @@ static void free_heap_pages(
     else
         pg->u.free.first_dirty = INVALID_DIRTY_IDX;
 
-    if ( tmem_enabled() )
-        midsize_alloc_zone_pages = max(
-            midsize_alloc_zone_pages, total_avail_pages / MIDSIZE_ALLOC_FRAC);
-
     /* Merge chunks as far as possible. */
     while ( order < MAX_ORDER )
     {
@@ -1505,7 +1582,7 @@ static void free_heap_pages(
     if ( tainted )
         reserve_offlined_page(pg);
 
-    spin_unlock(&heap_lock);
+    spin_unlock(&node_heap_lock[node]);
 }
 
 
@@ -1520,7 +1597,7 @@ static unsigned long mark_page_offline(struct page_info *pg, int broken)
     unsigned long nx, x, y = pg->count_info;
 
     ASSERT(page_is_ram_type(mfn_x(page_to_mfn(pg)), RAM_TYPE_CONVENTIONAL));
-    ASSERT(spin_is_locked(&heap_lock));
+    ASSERT(spin_is_locked(&node_heap_lock[phys_to_nid(page_to_maddr(pg))]));
 
     do {
         nx = x = y;
@@ -1614,7 +1691,7 @@ int offline_page(unsigned long mfn, int broken, uint32_t *status)
         return 0;
     }
 
-    spin_lock(&heap_lock);
+    spin_lock(&node_heap_lock[phys_to_nid(page_to_maddr(pg))]);
 
     old_info = mark_page_offline(pg, broken);
 
@@ -1622,14 +1699,14 @@ int offline_page(unsigned long mfn, int broken, uint32_t *status)
     {
         reserve_heap_page(pg);
 
-        spin_unlock(&heap_lock);
+        spin_unlock(&node_heap_lock[phys_to_nid(page_to_maddr(pg))]);
 
         *status = broken ? PG_OFFLINE_OFFLINED | PG_OFFLINE_BROKEN
                          : PG_OFFLINE_OFFLINED;
         return 0;
     }
 
-    spin_unlock(&heap_lock);
+    spin_unlock(&node_heap_lock[phys_to_nid(page_to_maddr(pg))]);
 
     if ( (owner = page_get_owner_and_reference(pg)) )
     {
@@ -1691,7 +1768,7 @@ unsigned int online_page(unsigned long mfn, uint32_t *status)
 
     pg = mfn_to_page(_mfn(mfn));
 
-    spin_lock(&heap_lock);
+    spin_lock(&node_heap_lock[phys_to_nid(page_to_maddr(pg))]);
 
     y = pg->count_info;
     do {
@@ -1706,7 +1783,9 @@ unsigned int online_page(unsigned long mfn, uint32_t *status)
 
         if ( (y & PGC_state) == PGC_state_offlined )
         {
+            spin_lock(&heap_lock);
             page_list_del(pg, &page_offlined_list);
+            spin_unlock(&heap_lock);
             *status = PG_ONLINE_ONLINED;
         }
         else if ( (y & PGC_state) == PGC_state_offlining )
@@ -1722,7 +1801,7 @@ unsigned int online_page(unsigned long mfn, uint32_t *status)
         nx = (x & ~PGC_state) | PGC_state_inuse;
     } while ( (y = cmpxchg(&pg->count_info, x, nx)) != x );
 
-    spin_unlock(&heap_lock);
+    spin_unlock(&node_heap_lock[phys_to_nid(page_to_maddr(pg))]);
 
     if ( (y & PGC_state) == PGC_state_offlined )
         free_heap_pages(pg, 0, false);
@@ -1741,10 +1820,10 @@ int query_page_offline(unsigned long mfn, uint32_t *status)
     }
 
     *status = 0;
-    spin_lock(&heap_lock);
-
     pg = mfn_to_page(_mfn(mfn));
 
+    spin_lock(&node_heap_lock[phys_to_nid(page_to_maddr(pg))]);
+
     if ( page_state_is(pg, offlining) )
         *status |= PG_OFFLINE_STATUS_OFFLINE_PENDING;
     if ( pg->count_info & PGC_broken )
@@ -1752,7 +1831,7 @@ int query_page_offline(unsigned long mfn, uint32_t *status)
     if ( page_state_is(pg, offlined) )
         *status |= PG_OFFLINE_STATUS_OFFLINED;
 
-    spin_unlock(&heap_lock);
+    spin_unlock(&node_heap_lock[phys_to_nid(page_to_maddr(pg))]);
 
     return 0;
 }
@@ -2004,9 +2083,9 @@ static void __init scrub_heap_pages(void)
 
         process_pending_softirqs();
 
-        spin_lock(&heap_lock);
+        lock_all_node_heaps();
         on_selected_cpus(&all_worker_cpus, smp_scrub_heap_pages, NULL, 1);
-        spin_unlock(&heap_lock);
+        unlock_all_node_heaps();
 
         printk(".");
     }
@@ -2061,9 +2140,9 @@ static void __init scrub_heap_pages(void)
 
             process_pending_softirqs();
 
-            spin_lock(&heap_lock);
+            lock_all_node_heaps();
             on_selected_cpus(&node_cpus, smp_scrub_heap_pages, &region[i], 1);
-            spin_unlock(&heap_lock);
+            unlock_all_node_heaps();
 
             printk(".");
         }
@@ -2241,6 +2320,237 @@ void init_domheap_pages(paddr_t ps, paddr_t pe)
 }
 
 
+/*
+ * Per-CPU caches ("magazines") of clean free pages, layered over the buddy
+ * allocator.  Only the two hottest chunk sizes are cached: single pages and
+ * superpage-sized (order-9) chunks.  Pages enter a magazine when freed clean
+ * by a live domain and leave it on the next matching allocation from the
+ * same CPU, avoiding the buddy merge/split cycle and the node heap lock on
+ * the hot path.  Dirty frees bypass the magazines entirely so that they
+ * remain visible to the scrubbing machinery.
+ *
+ * Cached pages are left accounted as allocated, i.e. they are invisible to
+ * avail[] and total_avail_pages; the amount so hidden is bounded by the
+ * magazine sizes below.
+ */
+#define MAGAZINE_ORDER_HI    9
+#define MAGAZINE_O0_SIZE     32
+#define MAGAZINE_O9_SIZE     2
+
+struct page_magazine {
+    unsigned int nr_o0, nr_o9;
+    struct page_info *o0[MAGAZINE_O0_SIZE];
+    struct page_info *o9[MAGAZINE_O9_SIZE];
+};
+static DEFINE_PER_CPU(struct page_magazine, page_magazine);
+
+/*
+ * Put every page of a chunk that is leaving a magazine for the buddy
+ * allocator into a state free_heap_pages() handles: free pages become
+ * inuse again, and offlined pages are downgraded to offlining.  The
+ * latter can appear because cached pages sit on no heap list, so
+ * offline_page() moves them straight from free to offlined without
+ * being able to segregate them; free_heap_pages() re-marks offlining
+ * pages as offlined and parks them via reserve_offlined_page().
+ */
+static void magazine_reclaim(struct page_info *pg, unsigned int order)
+{
+    unsigned int i;
+
+    for ( i = 0; i < (1U << order); i++ )
+    {
+        unsigned long x = pg[i].count_info, nx, y;
+
+        for ( ; ; x = y )
+        {
+            nx = x & ~PGC_state;
+            switch ( x & PGC_state )
+            {
+            case PGC_state_free:
+                nx |= PGC_state_inuse;
+                break;
+            case PGC_state_offlined:
+                nx |= PGC_state_offlining;
+                break;
+            default:
+                nx = x;
+                break;
+            }
+
+            if ( nx == x || (y = cmpxchg(&pg[i].count_info, x, nx)) == x )
+                break;
+        }
+    }
+}
+
+static bool magazine_store(struct page_info *pg, unsigned int order)
+{
+    struct page_magazine *mag;
+    unsigned int i;
+
+    ASSERT(!in_irq());
+
+    if ( (order != 0 && order != MAGAZINE_ORDER_HI) ||
+         system_state < SYS_STATE_active || scrub_debug )
+        return false;
+
+    mag = &this_cpu(page_magazine);
+
+    if ( order == 0 ? mag->nr_o0 == MAGAZINE_O0_SIZE
+                    : mag->nr_o9 == MAGAZINE_O9_SIZE )
+        return false;
+
+    /*
+     * Transition each page to the free state, atomically so that a
+     * concurrent offline_page() cannot have its state update lost.
+     * Pages with pending offline/broken state must go through the buddy
+     * allocator; in that case undo the partial conversion, as the caller
+     * falls back to free_heap_pages() for the whole chunk.
+     */
+    for ( i = 0; i < (1U << order); i++ )
+    {
+        unsigned long x = pg[i].count_info, y;
+
+        for ( ; ; x = y )
+        {
+            if ( (x & (PGC_state | PGC_broken)) != PGC_state_inuse )
+            {
+                magazine_reclaim(pg, order);
+                return false;
+            }
+
+            y = cmpxchg(&pg[i].count_info, x, PGC_state_free);
+            if ( y == x )
+                break;
+        }
+    }
+
+    for ( i = 0; i < (1U << order); i++ )
+    {
+        /* If a page has no owner it will need no safety TLB flush. */
+        pg[i].u.free.need_tlbflush = (page_get_owner(&pg[i]) != NULL);
+        if ( pg[i].u.free.need_tlbflush )
+            page_set_tlbflush_timestamp(&pg[i]);
+
+        /* This page is not a guest frame any more. */
+        page_set_owner(&pg[i], NULL);
+        set_gpfn_from_mfn(mfn_x(page_to_mfn(&pg[i])), INVALID_M2P_ENTRY);
+    }
+
+    if ( order == 0 )
+        mag->o0[mag->nr_o0++] = pg;
+    else
+        mag->o9[mag->nr_o9++] = pg;
+
+    return true;
+}
+
+static struct page_info *magazine_fetch(unsigned int order,
+                                        unsigned int memflags)
+{
+    struct page_magazine *mag = &this_cpu(page_magazine);
+    struct page_info *pg;
+    bool need_tlbflush = false;
+    uint32_t tlbflush_timestamp = 0;
+    unsigned int i;
+
+    ASSERT(!in_irq());
+
+ again:
+    if ( order == 0 )
+    {
+        if ( !mag->nr_o0 )
+            return NULL;
+        pg = mag->o0[--mag->nr_o0];
+    }
+    else
+    {
+        if ( !mag->nr_o9 )
+            return NULL;
+        pg = mag->o9[--mag->nr_o9];
+    }
+
+    /*
+     * Claim each page atomically: a cached page may have been marked for
+     * offlining (or offlined outright) behind our back.  Hand chunks so
+     * caught back to the buddy allocator, which re-segregates the
+     * offlined pages, and try the next magazine entry.
+     */
+    for ( i = 0; i < (1U << order); i++ )
+        if ( unlikely(cmpxchg(&pg[i].count_info, PGC_state_free,
+                              PGC_state_inuse) != PGC_state_free) )
+        {
+            magazine_reclaim(pg, order);
+            free_heap_pages(pg, order, false);
+            goto again;
+        }
+
+    for ( i = 0; i < (1U << order); i++ )
+    {
+        if ( !(memflags & MEMF_no_tlbflush) )
+            accumulate_tlbflush(&need_tlbflush, &pg[i],
+                                &tlbflush_timestamp);
+
+        /* Initialise fields which have other uses for free pages. */
+        pg[i].u.inuse.type_info = 0;
+        page_set_owner(&pg[i], NULL);
+
+        flush_page_to_ram(mfn_x(page_to_mfn(&pg[i])),
+                          !(memflags & MEMF_no_icache_flush));
+    }
+
+    if ( need_tlbflush )
+        filtered_flush_tlb_mask(tlbflush_timestamp);
+
+    return pg;
+}
+
+static void magazine_drain(unsigned int cpu)
+{
+    struct page_magazine *mag = &per_cpu(page_magazine, cpu);
+
+    while ( mag->nr_o0 )
+    {
+        struct page_info *pg = mag->o0[--mag->nr_o0];
+
+        magazine_reclaim(pg, 0);
+        free_heap_pages(pg, 0, false);
+    }
+    while ( mag->nr_o9 )
+    {
+        struct page_info *pg = mag->o9[--mag->nr_o9];
+
+        magazine_reclaim(pg, MAGAZINE_ORDER_HI);
+        free_heap_pages(pg, MAGAZINE_ORDER_HI, false);
+    }
+}
+
+static int cpu_magazine_callback(
+    struct notifier_block *nfb, unsigned long action, void *hcpu)
+{
+    unsigned int cpu = (unsigned long)hcpu;
+
+    switch ( action )
+    {
+    case CPU_DEAD:
+        magazine_drain(cpu);
+        break;
+    }
+
+    return NOTIFY_DONE;
+}
+
+static struct notifier_block cpu_magazine_nfb = {
+    .notifier_call = cpu_magazine_callback
+};
+
+static int __init magazine_init(void)
+{
+    register_cpu_notifier(&cpu_magazine_nfb);
+    return 0;
+}
+__initcall(magazine_init);
+
 int assign_pages(
     struct domain *d,
     struct page_info *pg,
@@ -2314,6 +2624,25 @@ struct page_info *alloc_domheap_pages(
         return NULL;
     }
 
+    /*
+     * Requests without placement constraints can be satisfied from this
+     * CPU's magazine, sidestepping the buddy allocator.
+     */
+    if ( (order == 0 || order == MAGAZINE_ORDER_HI) &&
+         zone_hi == NR_ZONES - 1 &&
+         MEMF_get_node(memflags) == NUMA_NO_NODE &&
+         (pg = magazine_fetch(order, memflags)) != NULL )
+    {
+        if ( d && !(memflags & MEMF_no_owner) &&
+             assign_pages(d, pg, order, memflags) )
+        {
+            free_heap_pages(pg, order, memflags & MEMF_no_scrub);
+            return NULL;
+        }
+
+        return pg;
+    }
+
     if ( !dma_bitsize )
         memflags &= ~MEMF_no_dma;
     else if ( (dma_zone = bits_to_zone(dma_bitsize)) < zone_hi )
@@ -2323,7 +2652,11 @@ struct page_info *alloc_domheap_pages(
          ((memflags & MEMF_no_dma) ||
           ((pg = alloc_heap_pages(MEMZONE_XEN + 1, zone_hi, order,
                                   memflags, d)) == NULL)) )
-         return NULL;
+    {
+        if ( order >= FRAG_HIGH_ORDER )
+            perfc_incr(domheap_hiorder_fail);
+        return NULL;
+    }
 
     if ( d && !(memflags & MEMF_no_owner) &&
          assign_pages(d, pg, order, memflags) )
@@ -2396,7 +2729,8 @@ void free_domheap_pages(struct page_info *pg, unsigned int order)
             scrub = 1;
         }
 
-        free_heap_pages(pg, order, scrub);
+        if ( scrub || !magazine_store(pg, order) )
+            free_heap_pages(pg, order, scrub);
     }
 
     if ( drop_dom_ref )
@@ -2429,6 +2763,21 @@ unsigned long avail_node_heap_pages(unsigned int nodeid)
     return avail_heap_pages(MEMZONE_XEN, NR_ZONES -1, nodeid);
 }
 
+/*
+ * Number of free pages still waiting to be scrubbed in the background.
+ * Snapshot only - the counts move under the per-node heap locks.
+ */
+unsigned long pending_scrub_pages(void)
+{
+    unsigned long total = 0;
+    unsigned int node;
+
+    for_each_online_node ( node )
+        total += node_need_scrub[node];
+
+    return total;
+}
+
 
 static void pagealloc_info(unsigned char key)
 {
@@ -2497,6 +2846,38 @@ static void dump_heap(unsigned char key)
                    i, j, avail[i][j]);
     }
 
+    for ( i = 0; i < MAX_NUMNODES; i++ )
+    {
+        unsigned long free = 0, high = 0, blocks;
+        unsigned int zone, order;
+        struct page_info *pg;
+
+        if ( !_heap[i] )
+            continue;
+
+        spin_lock(&node_heap_lock[i]);
+        for ( zone = 0; zone < NR_ZONES; zone++ )
+            for ( order = 0; order <= MAX_ORDER; order++ )
+            {
+                blocks = 0;
+                page_list_for_each ( pg, &heap(i, zone, order) )
+                    blocks++;
+                free += blocks << order;
+                if ( order >= FRAG_HIGH_ORDER )
+                    high += blocks << order;
+            }
+        spin_unlock(&node_heap_lock[i]);
+
+        /*
+         * 0% means all free memory sits in order >= FRAG_HIGH_ORDER
+         * blocks; 100% means none of it can satisfy such an allocation.
+         */
+        printk("Node %d: %lu pages free, %lu in order>=%u blocks, "
+               "fragmentation index %lu%%\n",
+               i, free, high, FRAG_HIGH_ORDER,
+               free ? 100 - ((high * 100) / free) : 0);
+    }
+
     for ( i = 0; i < MAX_NUMNODES; i++ )
     {
         if ( !node_need_scrub[i] )
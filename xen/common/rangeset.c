@@ -10,11 +10,20 @@
 #include <xen/sched.h>
 #include <xen/errno.h>
 #include <xen/rangeset.h>
+#include <xen/rbtree.h>
 #include <xsm/xsm.h>
 
-/* An inclusive range [s,e] and pointer to next range in ascending order. */
+/*
+ * An inclusive range [s,e] and pointer to next range in ascending order.
+ *
+ * Each range is also linked into a tree keyed on ->s. In-place updates of
+ * the boundaries (as done by the add/remove/claim/consume operations) never
+ * reorder a range relative to its disjoint neighbours, so they don't
+ * require a tree re-insertion.
+ */
 struct range {
     struct list_head list;
+    struct rb_node node;
     unsigned long s, e;
 };
 
@@ -26,6 +35,12 @@ struct rangeset {
     /* Ordered list of ranges contained in this set, and protecting lock. */
     struct list_head range_list;
 
+    /* Tree of the same ranges, keyed on ->s, for use by large sets. */
+    struct rb_root   range_tree;
+
+    /* Number of ranges currently in the set */
+    unsigned int     nr_inuse;
+
     /* Number of ranges that can be allocated */
     long             nr_ranges;
     rwlock_t         lock;
@@ -41,12 +56,41 @@ struct rangeset {
  * Private range functions hide the underlying linked-list implemnetation.
  */
 
+/*
+ * Sets below this size are searched linearly: for short lists this beats
+ * the tree in practice, and keeps the common (few-range) case cheap.
+ */
+#define RANGESET_TREE_THRESHOLD 16
+
 /* Find highest range lower than or containing s. NULL if no such range. */
 static struct range *find_range(
     struct rangeset *r, unsigned long s)
 {
     struct range *x = NULL, *y;
 
+    if ( r->nr_inuse > RANGESET_TREE_THRESHOLD )
+    {
+        /*
+         * Ranges are disjoint and maximally merged, so a tree keyed on
+         * range start gives the same answer as the linear scan below.
+         */
+        struct rb_node *n = r->range_tree.rb_node;
+
+        while ( n != NULL )
+        {
+            y = rb_entry(n, struct range, node);
+            if ( y->s > s )
+                n = n->rb_left;
+            else
+            {
+                x = y;
+                n = n->rb_right;
+            }
+        }
+
+        return x;
+    }
+
     list_for_each_entry ( y, &r->range_list, list )
     {
         if ( y->s > s )
@@ -79,15 +123,30 @@ static struct range *next_range(
 static void insert_range(
     struct rangeset *r, struct range *x, struct range *y)
 {
+    struct rb_node **p = &r->range_tree.rb_node, *parent = NULL;
+
     list_add(&y->list, (x != NULL) ? &x->list : &r->range_list);
+
+    while ( *p != NULL )
+    {
+        parent = *p;
+        p = (y->s < rb_entry(parent, struct range, node)->s)
+            ? &parent->rb_left : &parent->rb_right;
+    }
+    rb_link_node(&y->node, parent, p);
+    rb_insert_color(&y->node, &r->range_tree);
+
+    r->nr_inuse++;
 }
 
-/* Remove a range from its list and free it. */
+/* Remove a range from its list and tree and free it. */
 static void destroy_range(
     struct rangeset *r, struct range *x)
 {
     r->nr_ranges++;
+    r->nr_inuse--;
 
+    rb_erase(&x->node, &r->range_tree);
     list_del(&x->list);
     xfree(x);
 }
@@ -431,6 +490,8 @@ struct rangeset *rangeset_new(
 
     rwlock_init(&r->lock);
     INIT_LIST_HEAD(&r->range_list);
+    r->range_tree = RB_ROOT;
+    r->nr_inuse = 0;
     r->nr_ranges = -1;
 
     BUG_ON(flags & ~RANGESETF_prettyprint_hex);
@@ -512,6 +573,8 @@ void rangeset_domain_destroy(
 void rangeset_swap(struct rangeset *a, struct rangeset *b)
 {
     LIST_HEAD(tmp);
+    struct rb_root tree;
+    unsigned int inuse;
 
     if ( a < b )
     {
@@ -528,6 +591,14 @@ void rangeset_swap(struct rangeset *a, struct rangeset *b)
     list_splice_init(&b->range_list, &a->range_list);
     list_splice(&tmp, &b->range_list);
 
+    tree = a->range_tree;
+    a->range_tree = b->range_tree;
+    b->range_tree = tree;
+
+    inuse = a->nr_inuse;
+    a->nr_inuse = b->nr_inuse;
+    b->nr_inuse = inuse;
+
     write_unlock(&a->lock);
     write_unlock(&b->lock);
 }
@@ -140,6 +140,9 @@ static int qhimark = 10000;
 static int qlowmark = 100;
 static int rsinterval = 1000;
 
+/* A request to expedite the next grace period is outstanding. */
+static bool_t rcu_expedite_pending;
+
 struct rcu_barrier_data {
     struct rcu_head head;
     atomic_t *cpu_count;
@@ -235,6 +238,31 @@ void call_rcu(struct rcu_head *head,
     local_irq_restore(flags);
 }
 
+/**
+ * call_rcu_expedited - as call_rcu(), but accelerate the grace period.
+ *
+ * For latency-sensitive teardown paths: in addition to queueing the
+ * callback, chase both the currently running grace period and the one
+ * which will cover the callback by forcing the CPUs involved through a
+ * quiescent state, instead of waiting for them to pass one naturally.
+ */
+void call_rcu_expedited(struct rcu_head *head,
+                        void (*func)(struct rcu_head *rcu))
+{
+    cpumask_t cpumask;
+
+    call_rcu(head, func);
+
+    /* Consumed by rcu_start_batch() when the covering batch starts. */
+    rcu_expedite_pending = 1;
+
+    raise_softirq(RCU_SOFTIRQ);
+    raise_softirq(SCHEDULE_SOFTIRQ);
+    cpumask_andnot(&cpumask, &rcu_ctrlblk.cpumask,
+                   cpumask_of(smp_processor_id()));
+    cpumask_raise_softirq(&cpumask, SCHEDULE_SOFTIRQ);
+}
+
 /*
  * Invoke the completed RCU callbacks. They are expected to be in
  * a per-cpu list.
@@ -242,15 +270,20 @@ void call_rcu(struct rcu_head *head,
 static void rcu_do_batch(struct rcu_data *rdp)
 {
     struct rcu_head *next, *list;
+    long limit = rdp->blimit;
     int count = 0;
 
+    /* Adapt the invocation limit to the backlog: drain big queues faster. */
+    if (limit != INT_MAX && rdp->qlen > qlowmark)
+        limit = max_t(long, limit, rdp->qlen >> 2);
+
     list = rdp->donelist;
     while (list) {
         next = rdp->donelist = list->next;
         list->func(list);
         list = next;
         rdp->qlen--;
-        if (++count >= rdp->blimit)
+        if (++count >= limit)
             break;
     }
     if (rdp->blimit == INT_MAX && rdp->qlen <= qlowmark)
@@ -306,6 +339,11 @@ static void rcu_start_batch(struct rcu_ctrlblk *rcp)
         */
         smp_mb();
         cpumask_andnot(&rcp->cpumask, &cpu_online_map, &rcp->idle_cpumask);
+
+        if (rcu_expedite_pending) {
+            rcu_expedite_pending = 0;
+            cpumask_raise_softirq(&rcp->cpumask, SCHEDULE_SOFTIRQ);
+        }
     }
 }
 
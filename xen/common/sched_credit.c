@@ -479,9 +479,9 @@ static inline void __runq_tickle(struct csched_vcpu *new)
  tickle:
     if ( !cpumask_empty(&mask) )
     {
-        if ( unlikely(tb_init_done) )
+        if ( tracing_active() )
         {
-            /* Avoid TRACE_*: saves checking !tb_init_done each step */
+            /* Avoid TRACE_*: saves checking !tracing_active() each step */
             for_each_cpu(cpu, &mask)
                 __trace_var(TRC_CSCHED_TICKLE, 1, sizeof(cpu), &cpu);
         }
@@ -1848,7 +1848,7 @@ csched_schedule(
      * don't care about packing. But scheduling happens very often, so it
      * actually is important that the record is as small as possible.
      */
-    if ( unlikely(tb_init_done) )
+    if ( tracing_active() )
     {
         struct {
             unsigned cpu:16, tasklet:8, idle:8;
@@ -1915,7 +1915,7 @@ csched_schedule(
         tslice = prv->ratelimit - runtime;
         if ( unlikely(runtime < CSCHED_MIN_TIMER) )
             tslice = CSCHED_MIN_TIMER;
-        if ( unlikely(tb_init_done) )
+        if ( tracing_active() )
         {
             struct {
                 unsigned vcpu:16, dom:16;
@@ -57,6 +57,7 @@
 #define TRC_CSCHED2_SCHEDULE         TRC_SCHED_CLASS_EVT(CSCHED2, 21)
 #define TRC_CSCHED2_RATELIMIT        TRC_SCHED_CLASS_EVT(CSCHED2, 22)
 #define TRC_CSCHED2_RUNQ_CAND_CHECK  TRC_SCHED_CLASS_EVT(CSCHED2, 23)
+#define TRC_CSCHED2_YIELD_TO         TRC_SCHED_CLASS_EVT(CSCHED2, 24)
 
 /*
  * TODO:
@@ -247,6 +248,8 @@
 #define CSCHED2_MIGRATE_COMPENSATION MICROSECS(50)
 /* How tolerant we should be when peeking at runtime of vcpus on other cpus */
 #define CSCHED2_RATELIMIT_TICKLE_TOLERANCE MICROSECS(50)
+/* How recently a waiter must have been preempted to be a yield-to target. */
+#define CSCHED2_YIELD_TO_RECENT      MILLISECS(2)
 /* Reset: Value below which credit will be reset. */
 #define CSCHED2_CREDIT_RESET         0
 /* Max timer: Maximum time a guest can be run for. */
@@ -303,6 +306,25 @@
 static unsigned int __read_mostly opt_migrate_resist = 500;
 integer_param("sched_credit2_migrate_resist", opt_migrate_resist);
 
+/*
+ * SMT gang mode: never run vcpus of different domains on the SMT threads
+ * of the same core at the same time.  A thread that cannot find work from
+ * the domain its siblings are running (or going to run) stays idle rather
+ * than picking up a vcpu of another domain, so SMT can be left enabled
+ * without exposing domains to their core-neighbours.
+ *
+ * Each pcpu records which domain it is about to run, under the runqueue
+ * lock; as runqueues are never smaller than a core (see the check in
+ * csched2_global_init()), all threads of a core share that lock, making
+ * the check-and-claim in runq_candidate()/csched2_schedule() atomic with
+ * respect to the siblings' scheduling decisions.
+ */
+static bool __read_mostly opt_smt_gang;
+boolean_param("sched_credit2_smt_gang", opt_smt_gang);
+
+/* Domain each pcpu is running or committed to run; NULL when (going) idle. */
+static DEFINE_PER_CPU(const struct domain *, smt_gang_dom);
+
 /*
  * Load tracking and load balancing
  *
@@ -388,6 +410,14 @@ static int __read_mostly opt_underload_balance_tolerance = 0;
 integer_param("credit2_balance_under", opt_underload_balance_tolerance);
 static int __read_mostly opt_overload_balance_tolerance = -3;
 integer_param("credit2_balance_over", opt_overload_balance_tolerance);
+/*
+ * Each runqueue backs off its load balancing attempts while they keep
+ * finding nothing to move, doubling the interval between them (starting
+ * from no delay at all) up to this maximum, expressed in milliseconds.
+ * As soon as an attempt moves a vcpu, the interval is reset.
+ */
+static unsigned int __read_mostly opt_max_balance_interval = 256; /* ms */
+integer_param("credit2_max_balance_interval_ms", opt_max_balance_interval);
 /*
  * Domains subject to a cap receive a replenishment of their runtime budget
  * once every opt_cap_period interval. Default is 10 ms. The amount of budget
@@ -465,22 +495,32 @@ custom_param("credit2_runqueue", parse_credit2_runqueue);
 struct csched2_runqueue_data {
     spinlock_t lock;           /* Lock for this runqueue                     */
 
+    /*
+     * All fields in this first block are touched on every scheduling
+     * event (runqueue insertion/removal and load tracking), always with
+     * the lock held.  Keep them together, right after the lock and ahead
+     * of the (large) cpumasks, so that the hot paths stay within as few
+     * cache lines as possible.
+     */
     struct list_head runq;     /* Ordered list of runnable vms               */
-    int id;                    /* ID of this runqueue (-1 if invalid)        */
-
     int load;                  /* Instantaneous load (num of non-idle vcpus) */
     s_time_t load_last_update; /* Last time average was updated              */
     s_time_t avgload;          /* Decaying queue load                        */
     s_time_t b_avgload;        /* Decaying queue load modified by balancing  */
+    unsigned int max_weight;   /* Max weight of the vcpus in this runqueue   */
+    unsigned int pick_bias;    /* Last picked pcpu. Start from it next time  */
 
     cpumask_t active,          /* CPUs enabled for this runqueue             */
         smt_idle,              /* Fully idle-and-untickled cores (see below) */
         tickled,               /* Have been asked to go through schedule     */
         idle;                  /* Currently idle pcpus                       */
 
+    /* Configuration and rarely touched state. */
+    int id;                    /* ID of this runqueue (-1 if invalid)        */
     struct list_head svc;      /* List of all vcpus assigned to the runqueue */
-    unsigned int max_weight;   /* Max weight of the vcpus in this runqueue   */
-    unsigned int pick_bias;    /* Last picked pcpu. Start from it next time  */
+
+    s_time_t next_balance;     /* When to next attempt load balancing        */
+    s_time_t balance_interval; /* Current balancing back-off interval        */
 };
 
 /*
@@ -511,7 +551,13 @@ struct csched2_pcpu {
  * Virtual CPU
  */
 struct csched2_vcpu {
-    struct csched2_dom *sdom;          /* Up-pointer to domain                */
+    /*
+     * The fields down to avgload are the ones accessed on every scheduling
+     * event: runqueue insertion/removal, credit burn and load tracking.
+     * They are laid out first, packed together, so that the hot paths pull
+     * in as few cache lines of this structure as possible.
+     */
+    struct list_head runq_elem;        /* On the runqueue (rqd->runq)         */
     struct vcpu *vcpu;                 /* Up-pointer, to vcpu                 */
     struct csched2_runqueue_data *rqd; /* Up-pointer to the runqueue          */
 
@@ -519,17 +565,18 @@ struct csched2_vcpu {
     unsigned int weight;               /* Weight of this vcpu                 */
     unsigned int residual;             /* Reminder of div(max_weight/weight)  */
     unsigned flags;                    /* Status flags (16 bits would be ok,  */
-    s_time_t budget;                   /* Current budget (if domains has cap) */
                                        /* but clear_bit() does not like that) */
-    s_time_t budget_quota;             /* Budget to which vCPU is entitled    */
-
     s_time_t start_time;               /* Time we were scheduled (for credit) */
 
     /* Individual contribution to load                                        */
     s_time_t load_last_update;         /* Last time average was updated       */
     s_time_t avgload;                  /* Decaying queue load                 */
 
-    struct list_head runq_elem;        /* On the runqueue (rqd->runq)         */
+    /* Colder fields: budgets, domain linkage and migration state.            */
+    struct csched2_dom *sdom;          /* Up-pointer to domain                */
+    s_time_t budget;                   /* Current budget (if domains has cap) */
+    s_time_t budget_quota;             /* Budget to which vCPU is entitled    */
+
     struct list_head parked_elem;      /* On the parked_vcpus list            */
     struct list_head rqd_elem;         /* On csched2_runqueue_data's svc list */
     struct csched2_runqueue_data *migrate_rqd; /* Pre-determined migr. target */
@@ -809,6 +856,8 @@ static void activate_runqueue(struct csched2_private *prv, int rqi)
 
     rqd->max_weight = 1;
     rqd->id = rqi;
+    rqd->balance_interval = 0;
+    rqd->next_balance = 0;
     INIT_LIST_HEAD(&rqd->svc);
     INIT_LIST_HEAD(&rqd->runq);
     spin_lock_init(&rqd->lock);
@@ -924,7 +973,7 @@ static void update_max_weight(struct csched2_runqueue_data *rqd, int new_weight,
         SCHED_STAT_CRANK(upd_max_weight_full);
     }
 
-    if ( unlikely(tb_init_done) )
+    if ( tracing_active() )
     {
         struct {
             unsigned rqi:16, max_weight:16;
@@ -950,7 +999,7 @@ _runq_assign(struct csched2_vcpu *svc, struct csched2_runqueue_data *rqd)
     /* Expected new load based on adding this vcpu */
     rqd->b_avgload += svc->avgload;
 
-    if ( unlikely(tb_init_done) )
+    if ( tracing_active() )
     {
         struct {
             unsigned vcpu:16, dom:16;
@@ -1179,7 +1228,7 @@ update_runq_load(const struct scheduler *ops,
     /* Overflow, capable of making the load look negative, must not occur. */
     ASSERT(rqd->avgload >= 0 && rqd->b_avgload >= 0);
 
-    if ( unlikely(tb_init_done) )
+    if ( tracing_active() )
     {
         struct {
             uint64_t rq_avgload, b_avgload;
@@ -1238,7 +1287,7 @@ update_svc_load(const struct scheduler *ops,
     /* Overflow, capable of making the load look negative, must not occur. */
     ASSERT(svc->avgload >= 0);
 
-    if ( unlikely(tb_init_done) )
+    if ( tracing_active() )
     {
         struct {
             uint64_t v_avgload;
@@ -1296,7 +1345,7 @@ runq_insert(const struct scheduler *ops, struct csched2_vcpu *svc)
     }
     list_add_tail(&svc->runq_elem, iter);
 
-    if ( unlikely(tb_init_done) )
+    if ( tracing_active() )
     {
         struct {
             unsigned vcpu:16, dom:16;
@@ -1396,7 +1445,7 @@ static s_time_t tickle_score(const struct scheduler *ops, s_time_t now,
             score += CSCHED2_CREDIT_INIT;
     }
 
-    if ( unlikely(tb_init_done) )
+    if ( tracing_active() )
     {
         struct {
             unsigned vcpu:16, dom:16;
@@ -1442,7 +1491,7 @@ runq_tickle(const struct scheduler *ops, struct csched2_vcpu *new, s_time_t now)
 
     ASSERT(new->rqd == rqd);
 
-    if ( unlikely(tb_init_done) )
+    if ( tracing_active() )
     {
         struct {
             unsigned vcpu:16, dom:16;
@@ -1478,6 +1527,29 @@ runq_tickle(const struct scheduler *ops, struct csched2_vcpu *new, s_time_t now)
         goto tickle;
     }
 
+    /*
+     * Fast path: the pcpu where the vcpu was running before is, for cache
+     * locality reasons, always the preferred landing spot, and it is also
+     * the cpu the scans below would try first. If it is fully idle (i.e.,
+     * all its siblings are idle too, so we are not disturbing the SMT
+     * placement policy), untickled, and fine affinity-wise, take it right
+     * away, without building any intermediate cpumask. This is where the
+     * vast majority of wakeups of vcpus pinned to just one or two pcpus
+     * (e.g., interrupt-driven, device-owning guests) land.
+     */
+    if ( likely(!sched_smt_power_savings) &&
+         cpumask_test_cpu(cpu, &rqd->smt_idle) &&
+         !cpumask_test_cpu(cpu, &rqd->tickled) &&
+         cpumask_test_cpu(cpu, online) &&
+         cpumask_test_cpu(cpu, new->vcpu->cpu_hard_affinity) &&
+         (!has_soft_affinity(new->vcpu) ||
+          cpumask_test_cpu(cpu, new->vcpu->cpu_soft_affinity)) )
+    {
+        SCHED_STAT_CRANK(tickled_idle_cpu_fast);
+        ipid = cpu;
+        goto tickle;
+    }
+
     for_each_affinity_balance_step( bs )
     {
         /* Just skip first step, if we don't have a soft affinity */
@@ -1591,7 +1663,7 @@ runq_tickle(const struct scheduler *ops, struct csched2_vcpu *new, s_time_t now)
  tickle:
     BUG_ON(ipid == -1);
 
-    if ( unlikely(tb_init_done) )
+    if ( tracing_active() )
     {
         struct {
             unsigned cpu:16, pad:16;
@@ -1684,7 +1756,7 @@ static void reset_credit(const struct scheduler *ops, int cpu, s_time_t now,
 
         svc->start_time = now;
 
-        if ( unlikely(tb_init_done) )
+        if ( tracing_active() )
         {
             struct {
                 unsigned vcpu:16, dom:16;
@@ -1740,7 +1812,7 @@ void burn_credits(struct csched2_runqueue_data *rqd,
     svc->start_time = now;
 
  out:
-    if ( unlikely(tb_init_done) )
+    if ( tracing_active() )
     {
         struct {
             unsigned vcpu:16, dom:16;
@@ -2148,8 +2220,57 @@ static void
 csched2_vcpu_yield(const struct scheduler *ops, struct vcpu *v)
 {
     struct csched2_vcpu * const svc = csched2_vcpu(v);
+    struct list_head *iter;
+    s_time_t now = NOW();
 
     __set_bit(__CSFLAG_vcpu_yield, &svc->flags);
+
+    /*
+     * Directed yield.  A yield (PV spinlock path or PAUSE-loop exit)
+     * nearly always means we are spinning on a lock some sibling vCPU
+     * holds.  Look down our runqueue (whose lock we hold) for a vCPU of
+     * the same domain which was preempted only a moment ago -- the
+     * likely lock holder -- raise it to our credit level so it sorts
+     * ahead of us, and tickle a pCPU to pick it up.  Siblings preempted
+     * long ago are most probably idle in the guest, not holders.
+     */
+    list_for_each ( iter, &svc->rqd->runq )
+    {
+        struct csched2_vcpu * iter_svc = runq_elem(iter);
+
+        if ( iter_svc->sdom != svc->sdom )
+            continue;
+
+        if ( now - iter_svc->vcpu->runstate.state_entry_time >
+             CSCHED2_YIELD_TO_RECENT )
+            continue;
+
+        if ( iter_svc->credit < svc->credit )
+        {
+            runq_remove(iter_svc);
+            iter_svc->credit = svc->credit;
+            runq_insert(ops, iter_svc);
+        }
+        runq_tickle(ops, iter_svc, now);
+
+        SCHED_STAT_CRANK(vcpu_yield_to);
+
+        if ( tracing_active() )
+        {
+            struct {
+                unsigned vcpu:16, dom:16;
+                unsigned tvcpu:16, tcredit:16;
+            } d;
+            d.dom = v->domain->domain_id;
+            d.vcpu = v->vcpu_id;
+            d.tvcpu = iter_svc->vcpu->vcpu_id;
+            d.tcredit = (uint16_t)(iter_svc->credit >> 10);
+            __trace_var(TRC_CSCHED2_YIELD_TO, 1,
+                        sizeof(d),
+                        (unsigned char *)&d);
+        }
+        break;
+    }
 }
 
 static void
@@ -2398,7 +2519,7 @@ csched2_cpu_pick(const struct scheduler *ops, struct vcpu *vc)
  out_up:
     read_unlock(&prv->lock);
  out:
-    if ( unlikely(tb_init_done) )
+    if ( tracing_active() )
     {
         struct {
             uint64_t b_avgload;
@@ -2469,7 +2590,7 @@ static void migrate(const struct scheduler *ops,
 {
     int cpu = svc->vcpu->processor;
 
-    if ( unlikely(tb_init_done) )
+    if ( tracing_active() )
     {
         struct {
             unsigned vcpu:16, dom:16;
@@ -2564,6 +2685,13 @@ static void balance_load(const struct scheduler *ops, int cpu, s_time_t now)
     ASSERT(spin_is_locked(per_cpu(schedule_data, cpu).schedule_lock));
     st.lrqd = c2rqd(ops, cpu);
 
+    /*
+     * If the last attempts kept finding nothing worth moving, don't even
+     * bother recomputing the loads until our back-off interval has elapsed.
+     */
+    if ( now < st.lrqd->next_balance )
+        return;
+
     update_runq_load(ops, st.lrqd, 0, now);
 
 retry:
@@ -2617,7 +2745,7 @@ retry:
         if ( i > cpus_max )
             cpus_max = i;
 
-        if ( unlikely(tb_init_done) )
+        if ( tracing_active() )
         {
             struct {
                 unsigned lrq_id:16, orq_id:16;
@@ -2659,7 +2787,7 @@ retry:
     if ( unlikely(st.orqd->id < 0) )
         goto out_up;
 
-    if ( unlikely(tb_init_done) )
+    if ( tracing_active() )
     {
         struct {
             uint64_t lb_avgload, ob_avgload;
@@ -2728,7 +2856,23 @@ retry:
  out_up:
     spin_unlock(&st.orqd->lock);
  out:
-    return;
+    /*
+     * Runqueues whose load is well matched with their peers' rarely have
+     * anything to exchange, and re-checking them at every credit reset is
+     * wasted work (and wasted remote cachelines).  Double our back-off
+     * interval after each fruitless attempt, up to the boot-time maximum,
+     * and reset it as soon as an attempt does move a vcpu.
+     */
+    if ( st.best_push_svc || st.best_pull_svc )
+        st.lrqd->balance_interval = 0;
+    else
+    {
+        st.lrqd->balance_interval = st.lrqd->balance_interval ?
+            st.lrqd->balance_interval * 2 : MILLISECS(1);
+        if ( st.lrqd->balance_interval > MILLISECS(opt_max_balance_interval) )
+            st.lrqd->balance_interval = MILLISECS(opt_max_balance_interval);
+    }
+    st.lrqd->next_balance = now + st.lrqd->balance_interval;
 }
 
 static void
@@ -3250,6 +3394,26 @@ csched2_runtime(const struct scheduler *ops, int cpu,
     return time;
 }
 
+/*
+ * Whether, in SMT gang mode, vcpus of domain d may run on cpu, given what
+ * the other threads of the core are running.  Call with the runqueue lock
+ * held.
+ */
+static bool smt_gang_ok(unsigned int cpu, const struct domain *d)
+{
+    unsigned int sib;
+
+    for_each_cpu ( sib, per_cpu(cpu_sibling_mask, cpu) )
+    {
+        const struct domain *sdom = per_cpu(smt_gang_dom, sib);
+
+        if ( sib != cpu && sdom && sdom != d )
+            return false;
+    }
+
+    return true;
+}
+
 /*
  * Find a candidate.
  */
@@ -3287,7 +3451,7 @@ runq_candidate(struct csched2_runqueue_data *rqd,
          (now - scurr->vcpu->runstate.state_entry_time) <
           MICROSECS(prv->ratelimit_us) )
     {
-        if ( unlikely(tb_init_done) )
+        if ( tracing_active() )
         {
             struct {
                 unsigned vcpu:16, dom:16;
@@ -3348,7 +3512,7 @@ runq_candidate(struct csched2_runqueue_data *rqd,
     {
         struct csched2_vcpu * svc = list_entry(iter, struct csched2_vcpu, runq_elem);
 
-        if ( unlikely(tb_init_done) )
+        if ( tracing_active() )
         {
             struct {
                 unsigned vcpu:16, dom:16;
@@ -3367,6 +3531,17 @@ runq_candidate(struct csched2_runqueue_data *rqd,
             continue;
         }
 
+        /*
+         * In SMT gang mode, don't pick up work from a domain other than
+         * what the siblings of this core are running; stay idle instead,
+         * and let a same-domain thread or a fully idle core take it.
+         */
+        if ( unlikely(opt_smt_gang) && !smt_gang_ok(cpu, svc->vcpu->domain) )
+        {
+            (*skipped)++;
+            continue;
+        }
+
         /*
          * If a vcpu is meant to be picked up by another processor, and such
          * processor has not scheduled yet, leave it in the runqueue for him.
@@ -3405,7 +3580,7 @@ runq_candidate(struct csched2_runqueue_data *rqd,
         break;
     }
 
-    if ( unlikely(tb_init_done) )
+    if ( tracing_active() )
     {
         struct {
             unsigned vcpu:16, dom:16;
@@ -3472,7 +3647,7 @@ csched2_schedule(
         smt_idle_mask_set(cpu, cpumask_scratch, &rqd->smt_idle);
     }
 
-    if ( unlikely(tb_init_done) )
+    if ( tracing_active() )
     {
         struct {
             unsigned cpu:16, rq_id:16;
@@ -3527,6 +3702,11 @@ csched2_schedule(
     else
         snext = runq_candidate(rqd, scurr, cpu, now, &skipped_vcpus);
 
+    /* Claim the core for snext's domain before the runqueue lock drops. */
+    if ( unlikely(opt_smt_gang) )
+        per_cpu(smt_gang_dom, cpu) = is_idle_vcpu(snext->vcpu)
+                                     ? NULL : snext->vcpu->domain;
+
     /* If switching from a non-idle runnable vcpu, put it
      * back on the runqueue. */
     if ( snext != scurr
@@ -3926,6 +4106,8 @@ csched2_deinit_pdata(const struct scheduler *ops, void *pcpu, int cpu)
     __cpumask_clear_cpu(cpu, &rqd->idle);
     __cpumask_clear_cpu(cpu, &rqd->smt_idle);
     __cpumask_clear_cpu(cpu, &rqd->active);
+    /* Don't leave a stale domain claim behind for the siblings to see. */
+    per_cpu(smt_gang_dom, cpu) = NULL;
 
     if ( cpumask_empty(&rqd->active) )
     {
@@ -3988,6 +4170,13 @@ csched2_global_init(void)
         opt_cap_period = 10; /* ms */
     }
 
+    if ( opt_smt_gang && opt_runqueue == OPT_RUNQUEUE_CPU )
+    {
+        printk("WARNING: %s: SMT gang mode needs at least per-core "
+               "runqueues, using 'core'\n", __func__);
+        opt_runqueue = OPT_RUNQUEUE_CORE;
+    }
+
     return 0;
 }
 
@@ -4004,13 +4193,15 @@ csched2_init(struct scheduler *ops)
            XENLOG_INFO " underload_balance_tolerance: %d\n"
            XENLOG_INFO " overload_balance_tolerance: %d\n"
            XENLOG_INFO " runqueues arrangement: %s\n"
-           XENLOG_INFO " cap enforcement granularity: %dms\n",
+           XENLOG_INFO " cap enforcement granularity: %dms\n"
+           XENLOG_INFO " max balancing back-off: %ums\n",
            opt_load_precision_shift,
            opt_load_window_shift,
            opt_underload_balance_tolerance,
            opt_overload_balance_tolerance,
            opt_runqueue_str[opt_runqueue],
-           opt_cap_period);
+           opt_cap_period,
+           opt_max_balance_interval);
 
     printk(XENLOG_INFO "load tracking window length %llu ns\n",
            1ULL << opt_load_window_shift);
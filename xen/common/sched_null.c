@@ -28,6 +28,7 @@
  * if the scheduler is used inside a cpupool.
  */
 
+#include <xen/init.h>
 #include <xen/sched.h>
 #include <xen/sched-if.h>
 #include <xen/softirq.h>
@@ -43,6 +44,22 @@
 #define TRC_SNULL_MIGRATE       TRC_SCHED_CLASS_EVT(SNULL, 4)
 #define TRC_SNULL_SCHEDULE      TRC_SCHED_CLASS_EVT(SNULL, 5)
 #define TRC_SNULL_TASKLET       TRC_SCHED_CLASS_EVT(SNULL, 6)
+#define TRC_SNULL_COMP_ASSIGN   TRC_SCHED_CLASS_EVT(SNULL, 7)
+#define TRC_SNULL_COMP_DEASSIGN TRC_SCHED_CLASS_EVT(SNULL, 8)
+
+/*
+ * When there are more vCPUs than pCPUs, a pCPU can host one extra
+ * "companion" vCPU, alongside the one it is assigned: the two are then
+ * time-multiplexed with a fixed timeslice of this many microseconds,
+ * which bounds the scheduling latency of both.  This allows, e.g.,
+ * overcommitting by one vCPU during maintenance without moving the
+ * whole cpupool to a general purpose scheduler.
+ *
+ * Setting the slice to 0 disables companion vCPUs altogether, and any
+ * excess vCPU just sits in the waitqueue, as before.
+ */
+static unsigned int __read_mostly sched_null_slice_us = 100;
+integer_param("sched_null_slice_us", sched_null_slice_us);
 
 /*
  * Locking:
@@ -88,6 +105,8 @@ struct null_private {
  */
 struct null_pcpu {
     struct vcpu *vcpu;
+    struct vcpu *companion;
+    bool run_companion;
 };
 DEFINE_PER_CPU(struct null_pcpu, npc);
 
@@ -120,6 +139,11 @@ static inline struct null_vcpu *null_vcpu(const struct vcpu *v)
     return v->sched_priv;
 }
 
+static inline bool vcpu_on_cpu(const struct vcpu *v, unsigned int cpu)
+{
+    return per_cpu(npc, cpu).vcpu == v || per_cpu(npc, cpu).companion == v;
+}
+
 static inline bool vcpu_check_affinity(struct vcpu *v, unsigned int cpu,
                                        unsigned int balance_step)
 {
@@ -163,6 +187,8 @@ static void init_pdata(struct null_private *prv, unsigned int cpu)
     /* Mark the pCPU as free, and with no vCPU assigned */
     cpumask_set_cpu(cpu, &prv->cpus_free);
     per_cpu(npc, cpu).vcpu = NULL;
+    per_cpu(npc, cpu).companion = NULL;
+    per_cpu(npc, cpu).run_companion = false;
 }
 
 static void null_init_pdata(const struct scheduler *ops, void *pdata, int cpu)
@@ -191,6 +217,8 @@ static void null_deinit_pdata(const struct scheduler *ops, void *pcpu, int cpu)
 
     cpumask_clear_cpu(cpu, &prv->cpus_free);
     per_cpu(npc, cpu).vcpu = NULL;
+    per_cpu(npc, cpu).companion = NULL;
+    per_cpu(npc, cpu).run_companion = false;
 }
 
 static void *null_alloc_vdata(const struct scheduler *ops,
@@ -291,7 +319,7 @@ static unsigned int pick_cpu(struct null_private *prv, struct vcpu *v)
          * don't, so we get to keep in the scratch cpumask what we have just
          * put in it.)
          */
-        if ( likely((per_cpu(npc, cpu).vcpu == NULL || per_cpu(npc, cpu).vcpu == v)
+        if ( likely((per_cpu(npc, cpu).vcpu == NULL || vcpu_on_cpu(v, cpu))
                     && cpumask_test_cpu(cpu, cpumask_scratch_cpu(cpu))) )
         {
             new_cpu = cpu;
@@ -322,7 +350,7 @@ static unsigned int pick_cpu(struct null_private *prv, struct vcpu *v)
     new_cpu = cpumask_any(cpumask_scratch_cpu(cpu));
 
  out:
-    if ( unlikely(tb_init_done) )
+    if ( tracing_active() )
     {
         struct {
             uint16_t vcpu, dom;
@@ -346,7 +374,7 @@ static void vcpu_assign(struct null_private *prv, struct vcpu *v,
 
     dprintk(XENLOG_G_INFO, "%d <-- %pv\n", cpu, v);
 
-    if ( unlikely(tb_init_done) )
+    if ( tracing_active() )
     {
         struct {
             uint16_t vcpu, dom;
@@ -367,7 +395,7 @@ static void vcpu_deassign(struct null_private *prv, struct vcpu *v,
 
     dprintk(XENLOG_G_INFO, "%d <-- NULL (%pv)\n", cpu, v);
 
-    if ( unlikely(tb_init_done) )
+    if ( tracing_active() )
     {
         struct {
             uint16_t vcpu, dom;
@@ -380,6 +408,58 @@ static void vcpu_deassign(struct null_private *prv, struct vcpu *v,
     }
 }
 
+/*
+ * Companion slot management. A companion can only exist on a pCPU which
+ * already has a vCPU assigned, and does not affect prv->cpus_free: as far
+ * as placement is concerned, such a pCPU stays busy.
+ */
+static void companion_assign(struct null_private *prv, struct vcpu *v,
+                             unsigned int cpu)
+{
+    ASSERT(per_cpu(npc, cpu).vcpu != NULL);
+    ASSERT(per_cpu(npc, cpu).companion == NULL);
+
+    per_cpu(npc, cpu).companion = v;
+    v->processor = cpu;
+
+    dprintk(XENLOG_G_INFO, "%d (companion) <-- %pv\n", cpu, v);
+
+    if ( tracing_active() )
+    {
+        struct {
+            uint16_t vcpu, dom;
+            uint32_t cpu;
+        } d;
+        d.dom = v->domain->domain_id;
+        d.vcpu = v->vcpu_id;
+        d.cpu = cpu;
+        __trace_var(TRC_SNULL_COMP_ASSIGN, 1, sizeof(d), &d);
+    }
+}
+
+static void companion_deassign(struct null_private *prv, struct vcpu *v,
+                               unsigned int cpu)
+{
+    ASSERT(per_cpu(npc, cpu).companion == v);
+
+    per_cpu(npc, cpu).companion = NULL;
+    per_cpu(npc, cpu).run_companion = false;
+
+    dprintk(XENLOG_G_INFO, "%d (companion) <-- NULL (%pv)\n", cpu, v);
+
+    if ( tracing_active() )
+    {
+        struct {
+            uint16_t vcpu, dom;
+            uint32_t cpu;
+        } d;
+        d.dom = v->domain->domain_id;
+        d.vcpu = v->vcpu_id;
+        d.cpu = cpu;
+        __trace_var(TRC_SNULL_COMP_DEASSIGN, 1, sizeof(d), &d);
+    }
+}
+
 /* Change the scheduler of cpu to us (null). */
 static void null_switch_sched(struct scheduler *new_ops, unsigned int cpu,
                               void *pdata, void *vdata)
@@ -452,6 +532,15 @@ static void null_vcpu_insert(const struct scheduler *ops, struct vcpu *v)
          */
          goto retry;
     }
+    else if ( sched_null_slice_us && per_cpu(npc, cpu).companion == NULL &&
+              cpumask_test_cpu(cpu, cpumask_scratch_cpu(cpu)) )
+    {
+        /*
+         * If the pCPU is busy, but its companion slot is free, we can
+         * time-multiplex v with the vCPU the pCPU is assigned to.
+         */
+        companion_assign(prv, v, cpu);
+    }
     else
     {
         /*
@@ -476,7 +565,29 @@ static void _vcpu_remove(struct null_private *prv, struct vcpu *v)
 
     ASSERT(list_empty(&null_vcpu(v)->waitq_elem));
 
-    vcpu_deassign(prv, v, cpu);
+    /* A departing companion just frees its slot; nothing else changes. */
+    if ( per_cpu(npc, cpu).companion == v )
+    {
+        companion_deassign(prv, v, cpu);
+        return;
+    }
+
+    /*
+     * If v had a companion, promote it, rather than freeing the pCPU:
+     * it's the companion's slot which becomes available for someone in
+     * the waitqueue.
+     */
+    if ( per_cpu(npc, cpu).companion != NULL )
+    {
+        struct vcpu *cv = per_cpu(npc, cpu).companion;
+
+        companion_deassign(prv, cv, cpu);
+        vcpu_deassign(prv, v, cpu);
+        vcpu_assign(prv, cv, cpu);
+        cpu_raise_softirq(cpu, SCHEDULE_SOFTIRQ);
+    }
+    else
+        vcpu_deassign(prv, v, cpu);
 
     spin_lock(&prv->waitq_lock);
 
@@ -495,7 +606,13 @@ static void _vcpu_remove(struct null_private *prv, struct vcpu *v)
             if ( vcpu_check_affinity(wvc->vcpu, cpu, bs) )
             {
                 list_del_init(&wvc->waitq_elem);
-                vcpu_assign(prv, wvc->vcpu, cpu);
+                if ( per_cpu(npc, cpu).vcpu == NULL )
+                    vcpu_assign(prv, wvc->vcpu, cpu);
+                else if ( sched_null_slice_us &&
+                          per_cpu(npc, cpu).companion == NULL )
+                    companion_assign(prv, wvc->vcpu, cpu);
+                else
+                    continue;
                 cpu_raise_softirq(cpu, SCHEDULE_SOFTIRQ);
                 spin_unlock(&prv->waitq_lock);
                 return;
@@ -525,7 +642,7 @@ static void null_vcpu_remove(const struct scheduler *ops, struct vcpu *v)
         goto out;
     }
 
-    ASSERT(per_cpu(npc, v->processor).vcpu == v);
+    ASSERT(vcpu_on_cpu(v, v->processor));
     ASSERT(!cpumask_test_cpu(v->processor, &prv->cpus_free));
 
     _vcpu_remove(prv, v);
@@ -590,7 +707,7 @@ static void null_vcpu_migrate(const struct scheduler *ops, struct vcpu *v,
     if ( v->processor == new_cpu )
         return;
 
-    if ( unlikely(tb_init_done) )
+    if ( tracing_active() )
     {
         struct {
             uint16_t vcpu, dom;
@@ -641,6 +758,16 @@ static void null_vcpu_migrate(const struct scheduler *ops, struct vcpu *v,
 
         vcpu_assign(prv, v, new_cpu);
     }
+    else if ( sched_null_slice_us && per_cpu(npc, new_cpu).companion == NULL &&
+              vcpu_check_affinity(v, new_cpu, BALANCE_HARD_AFFINITY) )
+    {
+        /* v might have been in the waitqueue, so remove it */
+        spin_lock(&prv->waitq_lock);
+        list_del_init(&nvc->waitq_elem);
+        spin_unlock(&prv->waitq_lock);
+
+        companion_assign(prv, v, new_cpu);
+    }
     else
     {
         /* Put v in the waitqueue, if it wasn't there already */
@@ -689,6 +816,10 @@ static inline void null_vcpu_check(struct vcpu *v)
  * The most simple scheduling function of all times! We either return:
  *  - the vCPU assigned to the pCPU, if there's one and it can run;
  *  - the idle vCPU, otherwise.
+ *
+ * The only complication is when the pCPU hosts a companion vCPU too, in
+ * which case we alternate between it and the assigned vCPU, with a fixed
+ * timeslice of sched_null_slice_us microseconds.
  */
 static struct task_slice null_schedule(const struct scheduler *ops,
                                        s_time_t now,
@@ -703,7 +834,7 @@ static struct task_slice null_schedule(const struct scheduler *ops,
     SCHED_STAT_CRANK(schedule);
     NULL_VCPU_CHECK(current);
 
-    if ( unlikely(tb_init_done) )
+    if ( tracing_active() )
     {
         struct {
             uint16_t tasklet, cpu;
@@ -733,12 +864,36 @@ static struct task_slice null_schedule(const struct scheduler *ops,
     ret.migrated = 0;
     ret.time = -1;
 
+    if ( unlikely(per_cpu(npc, cpu).companion != NULL) &&
+         !tasklet_work_scheduled )
+    {
+        struct vcpu *companion = per_cpu(npc, cpu).companion;
+
+        ASSERT(ret.task != NULL);
+
+        /*
+         * Alternate between the assigned vCPU and its companion, slice by
+         * slice, so neither can be kept off the pCPU for longer than
+         * sched_null_slice_us microseconds.
+         */
+        if ( (per_cpu(npc, cpu).run_companion || !vcpu_runnable(ret.task)) &&
+             vcpu_runnable(companion) )
+            ret.task = companion;
+
+        per_cpu(npc, cpu).run_companion = (ret.task != companion);
+        ret.time = MICROSECS(sched_null_slice_us);
+    }
+
     /*
      * We may be new in the cpupool, or just coming back online. In which
      * case, there may be vCPUs in the waitqueue that we can assign to us
-     * and run.
+     * and run. And if companions are enabled, our companion slot may be
+     * free for one of them too.
      */
-    if ( unlikely(ret.task == NULL) )
+    if ( unlikely(ret.task == NULL ||
+                  (sched_null_slice_us &&
+                   per_cpu(npc, cpu).companion == NULL &&
+                   !list_empty(&prv->waitq))) )
     {
         spin_lock(&prv->waitq_lock);
 
@@ -762,9 +917,20 @@ static struct task_slice null_schedule(const struct scheduler *ops,
 
                 if ( vcpu_check_affinity(wvc->vcpu, cpu, bs) )
                 {
-                    vcpu_assign(prv, wvc->vcpu, cpu);
                     list_del_init(&wvc->waitq_elem);
-                    ret.task = wvc->vcpu;
+                    if ( per_cpu(npc, cpu).vcpu == NULL )
+                    {
+                        vcpu_assign(prv, wvc->vcpu, cpu);
+                        if ( !tasklet_work_scheduled )
+                            ret.task = wvc->vcpu;
+                    }
+                    else
+                    {
+                        companion_assign(prv, wvc->vcpu, cpu);
+                        /* Let the newcomer have the very next slice */
+                        per_cpu(npc, cpu).run_companion = true;
+                        ret.time = MICROSECS(sched_null_slice_us);
+                    }
                     goto unlock;
                 }
             }
@@ -802,6 +968,8 @@ static void null_dump_pcpu(const struct scheduler *ops, int cpu)
            nr_cpu_ids, cpumask_bits(per_cpu(cpu_core_mask, cpu)));
     if ( per_cpu(npc, cpu).vcpu != NULL )
         printk(", vcpu=%pv", per_cpu(npc, cpu).vcpu);
+    if ( per_cpu(npc, cpu).companion != NULL )
+        printk(", companion=%pv", per_cpu(npc, cpu).companion);
     printk("\n");
 
     /* current VCPU (nothing to say if that's the idle vcpu) */
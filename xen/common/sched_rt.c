@@ -171,6 +171,7 @@
 #define TRC_RTDS_BUDGET_REPLENISH TRC_SCHED_CLASS_EVT(RTDS, 4)
 #define TRC_RTDS_SCHED_TASKLET    TRC_SCHED_CLASS_EVT(RTDS, 5)
 #define TRC_RTDS_SCHEDULE         TRC_SCHED_CLASS_EVT(RTDS, 6)
+#define TRC_RTDS_EXTRA_BUDGET     TRC_SCHED_CLASS_EVT(RTDS, 7)
 
 static void repl_timer_handler(void *data);
 
@@ -975,8 +976,30 @@ burn_budget(const struct scheduler *ops, struct rt_vcpu *svc, s_time_t now)
     {
         if ( has_extratime(svc) )
         {
+            s_time_t overrun = -svc->cur_budget;
+
             svc->priority_level++;
             svc->cur_budget = svc->budget;
+
+            /*
+             * TRACE: mark the point where the vcpu's reservation ends and
+             * it starts (keeps) running on otherwise idle time, so that
+             * budgeted and donated runtime can be told apart.
+             */
+            {
+                struct __packed {
+                    unsigned vcpu:16, dom:16;
+                    unsigned priority_level;
+                    uint64_t overrun;
+                } d;
+                d.dom = svc->vcpu->domain->domain_id;
+                d.vcpu = svc->vcpu->vcpu_id;
+                d.priority_level = svc->priority_level;
+                d.overrun = (uint64_t) overrun;
+                trace_var(TRC_RTDS_EXTRA_BUDGET, 1,
+                          sizeof(d),
+                          (unsigned char *) &d);
+            }
         }
         else
         {
@@ -1044,11 +1067,13 @@ runq_pick(const struct scheduler *ops, const cpumask_t *mask)
             struct __packed {
                 unsigned vcpu:16, dom:16;
                 uint64_t cur_deadline, cur_budget;
+                unsigned priority_level;
             } d;
             d.dom = svc->vcpu->domain->domain_id;
             d.vcpu = svc->vcpu->vcpu_id;
             d.cur_deadline = (uint64_t) svc->cur_deadline;
             d.cur_budget = (uint64_t) svc->cur_budget;
+            d.priority_level = svc->priority_level;
             trace_var(TRC_RTDS_RUNQ_PICK, 1,
                       sizeof(d),
                       (unsigned char *) &d);
@@ -20,6 +20,7 @@
 #include <xen/domain.h>
 #include <xen/delay.h>
 #include <xen/event.h>
+#include <xen/event_fifo.h>
 #include <xen/time.h>
 #include <xen/timer.h>
 #include <xen/perfc.h>
@@ -123,7 +124,7 @@ static inline void trace_runstate_change(struct vcpu *v, int new_state)
     struct { uint32_t vcpu:16, domain:16; } d;
     uint32_t event;
 
-    if ( likely(!tb_init_done) )
+    if ( !tracing_active() )
         return;
 
     d.vcpu = v->vcpu_id;
@@ -140,7 +141,7 @@ static inline void trace_continue_running(struct vcpu *v)
 {
     struct { uint32_t vcpu:16, domain:16; } d;
 
-    if ( likely(!tb_init_done) )
+    if ( !tracing_active() )
         return;
 
     d.vcpu = v->vcpu_id;
@@ -193,6 +194,26 @@ static inline void vcpu_runstate_change(
         v->runstate.state_entry_time = new_entry_time;
     }
 
+    if ( unlikely(v->runstate_ring != NULL) )
+    {
+        struct vcpu_runstate_ring *r = v->runstate_ring;
+        /*
+         * The ring page is guest writable, so nothing read from it can be
+         * trusted: index with the fixed entry count, not r->size.
+         */
+        struct vcpu_runstate_ring_entry *e =
+            &r->ring[r->prod % RUNSTATE_RING_ENTRIES];
+
+        e->state_entry_time = new_entry_time;
+        e->old_state = v->runstate.state;
+        e->new_state = new_state;
+        smp_wmb(); /* entry before prod */
+        r->prod++;
+    }
+
+    if ( new_state == RUNSTATE_running )
+        evtchn_fifo_note_wake(v, new_entry_time);
+
     v->runstate.state = new_state;
 }
 
@@ -344,6 +365,14 @@ int sched_move_domain(struct domain *d, struct cpupool *c)
         }
     }
 
+    /*
+     * The scheduler of a domain is resolved through d->cpupool, for all of
+     * its vCPUs at once, so the re-association below must happen with the
+     * domain paused.  Everything which does not strictly need the domain
+     * quiesced (all the allocations above, re-homing timers and interrupts
+     * below) is done outside of the paused window, to keep the guest
+     * visible stall as short as possible.
+     */
     domain_pause(d);
 
     old_ops = dom_scheduler(d);
@@ -365,10 +394,6 @@ int sched_move_domain(struct domain *d, struct cpupool *c)
 
         vcpudata = v->sched_priv;
 
-        migrate_timer(&v->periodic_timer, new_p);
-        migrate_timer(&v->singleshot_timer, new_p);
-        migrate_timer(&v->poll_timer, new_p);
-
         cpumask_setall(&allcpus);
 
         lock = vcpu_schedule_lock_irq(v);
@@ -384,8 +409,6 @@ int sched_move_domain(struct domain *d, struct cpupool *c)
         spin_unlock_irq(lock);
 
         v->sched_priv = vcpu_priv[v->vcpu_id];
-        if ( !d->is_dying )
-            sched_move_irqs(v);
 
         new_p = cpumask_cycle(new_p, c->cpu_valid);
 
@@ -398,6 +421,24 @@ int sched_move_domain(struct domain *d, struct cpupool *c)
 
     domain_unpause(d);
 
+    /*
+     * Re-home timers and interrupts one vCPU at a time, with the domain
+     * running again.  A racy read of v->processor is fine here: any pCPU
+     * of the new pool is a valid home, and if the vCPU is being migrated
+     * further, the normal migration machinery re-routes interrupts anyway.
+     */
+    for_each_vcpu ( d, v )
+    {
+        unsigned int cpu = v->processor;
+
+        migrate_timer(&v->periodic_timer, cpu);
+        migrate_timer(&v->singleshot_timer, cpu);
+        migrate_timer(&v->poll_timer, cpu);
+
+        if ( !d->is_dying )
+            sched_move_irqs(v);
+    }
+
     sched_free_domdata(old_ops, old_domdata);
 
     xfree(vcpu_priv);
@@ -410,6 +451,8 @@ void sched_destroy_vcpu(struct vcpu *v)
     kill_timer(&v->periodic_timer);
     kill_timer(&v->singleshot_timer);
     kill_timer(&v->poll_timer);
+    xfree(v->poll_set);
+    v->poll_set = NULL;
     if ( test_and_clear_bool(v->is_urgent) )
         atomic_dec(&per_cpu(schedule_data, v->processor).urgent_count);
     SCHED_OP(vcpu_scheduler(v), remove_vcpu, v);
@@ -1084,6 +1127,116 @@ static long do_poll(struct sched_poll *sched_poll)
     return rc;
 }
 
+static long do_register_poll_set(struct sched_poll *sched_poll)
+{
+    struct vcpu   *v = current;
+    struct domain *d = v->domain;
+    evtchn_port_t  port = 0;
+    unsigned long *set = v->poll_set;
+    unsigned int   i;
+
+    if ( sched_poll->nr_ports > d->max_evtchns )
+        return -EINVAL;
+
+    if ( !guest_handle_okay(sched_poll->ports, sched_poll->nr_ports) )
+        return -EFAULT;
+
+    if ( set == NULL )
+    {
+        /*
+         * Sized for the largest event channel ABI, so that a later 2l->FIFO
+         * switch cannot require reallocation: evtchn_check_pollers() may look
+         * at the bitmap from another CPU, hence it is never freed or resized
+         * while the vcpu exists.
+         */
+        set = xzalloc_array(unsigned long, BITS_TO_LONGS(MAX_NR_EVTCHNS));
+        if ( set == NULL )
+            return -ENOMEM;
+        v->poll_set = set;
+    }
+    else
+        bitmap_zero(set, MAX_NR_EVTCHNS);
+
+    for ( i = 0; i < sched_poll->nr_ports; i++ )
+    {
+        if ( __copy_from_guest_offset(&port, sched_poll->ports, i, 1) )
+        {
+            bitmap_zero(set, MAX_NR_EVTCHNS);
+            return -EFAULT;
+        }
+
+        if ( port >= d->max_evtchns )
+        {
+            bitmap_zero(set, MAX_NR_EVTCHNS);
+            return -EINVAL;
+        }
+
+        __set_bit(port, set);
+    }
+
+    return 0;
+}
+
+static long do_poll_set(struct sched_poll *sched_poll)
+{
+    struct vcpu   *v = current;
+    struct domain *d = v->domain;
+    unsigned int   port;
+    long           rc;
+
+    if ( sched_poll->nr_ports != 0 )
+        return -EINVAL;
+
+    if ( v->poll_set == NULL )
+        return -ENOENT;
+
+    set_bit(_VPF_blocked, &v->pause_flags);
+    v->poll_evtchn = -2;
+    set_bit(v->vcpu_id, d->poll_mask);
+
+    arch_vcpu_block(v);
+
+#ifndef CONFIG_X86 /* set_bit() implies mb() on x86 */
+    /* Check for events /after/ setting flags: avoids wakeup waiting race. */
+    smp_mb();
+
+    /*
+     * Someone may have seen we are blocked but not that we are polling, or
+     * vice versa. We are certainly being woken, so clean up and bail. Beyond
+     * this point others can be guaranteed to clean up for us if they wake us.
+     */
+    rc = 0;
+    if ( (v->poll_evtchn == 0) ||
+         !test_bit(_VPF_blocked, &v->pause_flags) ||
+         !test_bit(v->vcpu_id, d->poll_mask) )
+        goto out;
+#endif
+
+    rc = 0;
+    if ( local_events_need_delivery() )
+        goto out;
+
+    for ( port = find_first_bit(v->poll_set, d->max_evtchns);
+          port < d->max_evtchns;
+          port = find_next_bit(v->poll_set, d->max_evtchns, port + 1) )
+        if ( evtchn_port_is_pending(d, port) )
+            goto out;
+
+    if ( sched_poll->timeout != 0 )
+        set_timer(&v->poll_timer, sched_poll->timeout);
+
+    TRACE_2D(TRC_SCHED_BLOCK, d->domain_id, v->vcpu_id);
+    raise_softirq(SCHEDULE_SOFTIRQ);
+
+    return 0;
+
+ out:
+    v->poll_evtchn = 0;
+    clear_bit(v->vcpu_id, d->poll_mask);
+    clear_bit(_VPF_blocked, &v->pause_flags);
+    return rc;
+}
+
 /* Voluntarily yield the processor for this allocation. */
 long vcpu_yield(void)
 {
@@ -1285,6 +1438,22 @@ ret_t do_sched_op(int cmd, XEN_GUEST_HANDLE_PARAM(void) arg)
         break;
     }
 
+    case SCHEDOP_register_poll_set:
+    case SCHEDOP_poll_set:
+    {
+        struct sched_poll sched_poll;
+
+        ret = -EFAULT;
+        if ( copy_from_guest(&sched_poll, arg, 1) )
+            break;
+
+        ret = (cmd == SCHEDOP_register_poll_set)
+              ? do_register_poll_set(&sched_poll)
+              : do_poll_set(&sched_poll);
+
+        break;
+    }
+
     case SCHEDOP_remote_shutdown:
     {
         struct domain *d;
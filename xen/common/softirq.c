@@ -11,6 +11,7 @@
 
 #include <xen/init.h>
 #include <xen/mm.h>
+#include <xen/perfc.h>
 #include <xen/preempt.h>
 #include <xen/sched.h>
 #include <xen/rcupdate.h>
@@ -87,7 +88,11 @@ void cpumask_raise_softirq(const cpumask_t *mask, unsigned int nr)
         if ( !test_and_set_bit(nr, &softirq_pending(cpu)) &&
              cpu != this_cpu &&
              !arch_skip_send_event_check(cpu) )
+        {
+            if ( raise_mask != &send_mask )
+                perfc_incr(softirq_batch_raise);
             __cpumask_set_cpu(cpu, raise_mask);
+        }
 
     if ( raise_mask == &send_mask )
         smp_send_event_check_mask(raise_mask);
@@ -105,7 +110,10 @@ void cpu_raise_softirq(unsigned int cpu, unsigned int nr)
     if ( !per_cpu(batching, this_cpu) || in_irq() )
         smp_send_event_check_cpu(cpu);
     else
+    {
+        perfc_incr(softirq_batch_raise);
         __cpumask_set_cpu(cpu, &per_cpu(batch_mask, this_cpu));
+    }
 }
 
 void cpu_raise_softirq_batch_begin(void)
@@ -121,7 +129,11 @@ void cpu_raise_softirq_batch_finish(void)
     ASSERT(per_cpu(batching, this_cpu));
     for_each_cpu ( cpu, mask )
         if ( !softirq_pending(cpu) )
+        {
+            perfc_incr(softirq_batch_skipped);
             __cpumask_clear_cpu(cpu, mask);
+        }
+    perfc_add(softirq_batch_ipis, cpumask_weight(mask));
     smp_send_event_check_mask(mask);
     cpumask_clear(mask);
     --per_cpu(batching, this_cpu);
@@ -2,6 +2,10 @@
 #include <xen/irq.h>
 #include <xen/smp.h>
 #include <xen/time.h>
+#include <xen/event.h>
+#include <xen/sched.h>
+#include <xen/sleeplock.h>
+#include <xen/softirq.h>
 #include <xen/spinlock.h>
 #include <xen/guest_access.h>
 #include <xen/preempt.h>
@@ -92,8 +96,22 @@ void spin_debug_disable(void)
 
 #ifdef CONFIG_LOCK_PROFILE
 
+/* Runtime switch for data collection, XEN_SYSCTL_LOCKPROF_{en,dis}able. */
+static bool_t lock_profile_collect = 1;
+
+/*
+ * Histogram bucket for a wait of @block nsecs: bucket 0 is sub-usec,
+ * bucket n is [2^(n-1), 2^n) usecs, the last bucket takes the rest.
+ */
+static inline unsigned int lock_profile_hist_idx(s_time_t block)
+{
+    uint64_t us = block / MICROSECS(1);
+
+    return us ? min(fls64(us), XEN_LOCKPROF_NR_HIST - 1) : 0;
+}
+
 #define LOCK_PROFILE_REL                                                     \
-    if (lock->profile)                                                       \
+    if (lock->profile && lock_profile_collect)                               \
     {                                                                        \
         lock->profile->time_hold += NOW() - lock->profile->time_locked;      \
         lock->profile->lock_cnt++;                                           \
@@ -101,13 +119,15 @@ void spin_debug_disable(void)
 #define LOCK_PROFILE_VAR    s_time_t block = 0
 #define LOCK_PROFILE_BLOCK  block = block ? : NOW();
 #define LOCK_PROFILE_GOT                                                     \
-    if (lock->profile)                                                       \
+    if (lock->profile && lock_profile_collect)                               \
     {                                                                        \
         lock->profile->time_locked = NOW();                                  \
         if (block)                                                           \
         {                                                                    \
             lock->profile->time_block += lock->profile->time_locked - block; \
             lock->profile->block_cnt++;                                      \
+            lock->profile->hist[lock_profile_hist_idx(                       \
+                lock->profile->time_locked - block)]++;                      \
         }                                                                    \
     }
 
@@ -225,7 +245,7 @@ int _spin_trylock(spinlock_t *lock)
                  old.head_tail, new.head_tail) != old.head_tail )
         return 0;
 #ifdef CONFIG_LOCK_PROFILE
-    if (lock->profile)
+    if (lock->profile && lock_profile_collect)
         lock->profile->time_locked = NOW();
 #endif
     preempt_disable();
@@ -251,10 +271,13 @@ void _spin_barrier(spinlock_t *lock)
         while ( observe_head(&lock->tickets) == sample.head )
             arch_lock_relax();
 #ifdef CONFIG_LOCK_PROFILE
-        if ( lock->profile )
+        if ( lock->profile && lock_profile_collect )
         {
-            lock->profile->time_block += NOW() - block;
+            s_time_t waited = NOW() - block;
+
+            lock->profile->time_block += waited;
             lock->profile->block_cnt++;
+            lock->profile->hist[lock_profile_hist_idx(waited)]++;
         }
 #endif
     }
@@ -371,6 +394,7 @@ static void spinlock_profile_reset_elem(struct lock_profile *data,
     data->block_cnt = 0;
     data->time_hold = 0;
     data->time_block = 0;
+    memset(data->hist, 0, sizeof(data->hist));
 }
 
 void spinlock_profile_reset(unsigned char key)
@@ -406,6 +430,7 @@ static void spinlock_profile_ucopy_elem(struct lock_profile *data,
         elem.block_cnt = data->block_cnt;
         elem.lock_time = data->time_hold;
         elem.block_time = data->time_block;
+        memcpy(elem.hist, data->hist, sizeof(elem.hist));
         if ( copy_to_guest_offset(p->pc->data, p->pc->nr_elem, &elem, 1) )
             p->rc = -EFAULT;
     }
@@ -433,6 +458,12 @@ int spinlock_profile_control(struct xen_sysctl_lockprof_op *pc)
         pc->time = NOW() - lock_profile_start;
         rc = par.rc;
         break;
+    case XEN_SYSCTL_LOCKPROF_enable:
+        lock_profile_collect = 1;
+        break;
+    case XEN_SYSCTL_LOCKPROF_disable:
+        lock_profile_collect = 0;
+        break;
     default:
         rc = -EINVAL;
         break;
@@ -491,3 +522,116 @@ __initcall(lock_prof_init);
 #endif
 
 #endif /* LOCK_PROFILE */
+
+/*
+ * Spin-then-park locks (see xen/sleeplock.h).
+ *
+ * The waiter list and the locked flag are protected by the inner
+ * spinlock, whose critical sections are short and bounded.  All
+ * manipulation of v->sleeplock happens under the owning lock's inner
+ * spinlock, so a parked vcpu woken for an unrelated reason can safely
+ * take itself back off the list before contending again.
+ */
+
+#define SLEEPLOCK_SPIN_NS MICROSECS(20)
+
+static void sleeplock_dequeue(struct vcpu *v)
+{
+    struct sleeplock *l = v->sleeplock;
+
+    if ( l == NULL )
+        return;
+
+    spin_lock(&l->lock);
+    if ( v->sleeplock == l )
+    {
+        list_del(&v->sleeplock_waiter);
+        v->sleeplock = NULL;
+    }
+    spin_unlock(&l->lock);
+}
+
+int sleeplock_trylock(struct sleeplock *l)
+{
+    int rc = 0;
+
+    spin_lock(&l->lock);
+    if ( !l->locked )
+    {
+        l->locked = true;
+        rc = 1;
+    }
+    spin_unlock(&l->lock);
+
+    return rc;
+}
+
+int sleeplock_acquire(struct sleeplock *l)
+{
+    struct vcpu *v = current;
+    s_time_t deadline = NOW() + SLEEPLOCK_SPIN_NS;
+
+    /* A previous park may have been cut short by an unrelated wakeup. */
+    sleeplock_dequeue(v);
+
+    /* Adaptive phase: don't pay a deschedule for a short hold. */
+    for ( ; ; )
+    {
+        if ( sleeplock_trylock(l) )
+            return 1;
+        if ( NOW() >= deadline )
+            break;
+        cpu_relax();
+    }
+
+    spin_lock(&l->lock);
+    if ( !l->locked )
+    {
+        l->locked = true;
+        spin_unlock(&l->lock);
+        return 1;
+    }
+    list_add_tail(&v->sleeplock_waiter, &l->waiters);
+    v->sleeplock = l;
+    set_bit(_VPF_blocked, &v->pause_flags);
+    spin_unlock(&l->lock);
+
+    arch_vcpu_block(v);
+
+    /* Check for events /after/ blocking: avoids wakeup waiting race. */
+    smp_mb();
+    if ( local_events_need_delivery() )
+    {
+        sleeplock_dequeue(v);
+        clear_bit(_VPF_blocked, &v->pause_flags);
+    }
+    else
+        raise_softirq(SCHEDULE_SOFTIRQ);
+
+    return 0;
+}
+
+void sleeplock_release(struct sleeplock *l)
+{
+    spin_lock(&l->lock);
+
+    ASSERT(l->locked);
+    l->locked = false;
+
+    /*
+     * Wake all waiters and let their hypercall continuations re-contend:
+     * handoff isn't needed for fairness here, and wake-all keeps the
+     * bookkeeping trivially free of lost wakeups.
+     */
+    while ( !list_empty(&l->waiters) )
+    {
+        struct vcpu *woken = list_first_entry(&l->waiters, struct vcpu,
+                                              sleeplock_waiter);
+
+        list_del(&woken->sleeplock_waiter);
+        woken->sleeplock = NULL;
+        vcpu_unblock(woken);
+    }
+
+    spin_unlock(&l->lock);
+}
@@ -0,0 +1,66 @@
+/******************************************************************************
+ * common/static_branch.c
+ *
+ * Runtime patching of rarely changing boolean predicates.  See
+ * include/xen/static_branch.h for the interface.
+ */
+
+#include <xen/errno.h>
+#include <xen/lib.h>
+#include <xen/static_branch.h>
+#include <xen/stop_machine.h>
+
+extern struct static_branch_entry __start_static_branch[],
+                                  __stop_static_branch[];
+
+struct sb_work {
+    struct static_branch *sb;
+    bool enable;
+};
+
+/*
+ * Runs with all other online CPUs spinning with interrupts disabled, so
+ * no CPU can be executing a patch site while it is rewritten, and the
+ * IRET each CPU performs on leaving the rendezvous serializes against the
+ * modified text.
+ */
+static int sb_patch_fn(void *data)
+{
+    const struct sb_work *w = data;
+    struct static_branch_entry *e;
+
+    if ( w->sb->enabled == w->enable )
+        return 0;
+
+    for ( e = __start_static_branch; e < __stop_static_branch; e++ )
+        if ( SB_KEY_PTR(e) == w->sb )
+            arch_static_branch_patch(e, w->enable);
+
+    w->sb->enabled = w->enable;
+
+    return 0;
+}
+
+static int static_branch_set(struct static_branch *sb, bool enable)
+{
+    struct sb_work w = { .sb = sb, .enable = enable };
+
+    /*
+     * stop_machine_run() provides both the quiescing the patching needs
+     * and serialization of ->enabled updates.  Its -EBUSY (CPU hotplug or
+     * another rendezvous in flight) is deliberately not retried here:
+     * spinning in hypercall context would prevent this CPU's stopmachine
+     * tasklet from running and so deadlock against the competing caller.
+     */
+    return stop_machine_run(sb_patch_fn, &w, NR_CPUS);
+}
+
+int static_branch_enable(struct static_branch *sb)
+{
+    return static_branch_set(sb, true);
+}
+
+int static_branch_disable(struct static_branch *sb)
+{
+    return static_branch_set(sb, false);
+}
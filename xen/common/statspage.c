@@ -0,0 +1,194 @@
+/******************************************************************************
+ * statspage.c
+ *
+ * Host-global statistics area.  A periodic timer refreshes one record per
+ * domain (runstate times, memory footprint) in xenheap pages shared
+ * read-only with privileged guests, so tools like xentop can sample by
+ * reading memory instead of issuing one hypercall per domain and vcpu.
+ * Controlled via XEN_SYSCTL_statspage_op.
+ */
+
+#include <xen/init.h>
+#include <xen/lib.h>
+#include <xen/mm.h>
+#include <xen/sched.h>
+#include <xen/spinlock.h>
+#include <xen/statspage.h>
+#include <xen/timer.h>
+
+#define STATSPAGE_DEFAULT_PERIOD_MS 100
+#define STATSPAGE_DEFAULT_CAPACITY  256
+#define STATSPAGE_MAX_CAPACITY      16384
+
+static DEFINE_SPINLOCK(statspage_lock);
+static struct xen_statspage_header *statspage_hdr;
+static struct xen_statspage_entry *statspage_entries;
+static unsigned int statspage_order;
+static unsigned int statspage_period_ms;
+static struct timer statspage_timer;
+static bool statspage_enabled;
+
+static void statspage_refresh(void *unused)
+{
+    struct xen_statspage_header *hdr = statspage_hdr;
+    struct domain *d;
+    unsigned int nr = 0;
+
+    if ( !statspage_enabled )
+        return;
+
+    hdr->generation++;  /* becomes odd: refresh in progress */
+    smp_wmb();
+
+    rcu_read_lock(&domlist_read_lock);
+
+    for_each_domain ( d )
+    {
+        struct xen_statspage_entry *e = &statspage_entries[nr];
+        struct vcpu *v;
+
+        if ( nr == hdr->capacity )
+            break;
+
+        *e = (struct xen_statspage_entry) {
+            .domain    = d->domain_id,
+            .tot_pages = d->tot_pages,
+            .max_pages = d->max_pages,
+        };
+
+        for_each_vcpu ( d, v )
+        {
+            struct vcpu_runstate_info runstate;
+            unsigned int i;
+
+            vcpu_runstate_get(v, &runstate);
+
+            if ( !(v->pause_flags & VPF_down) )
+                e->nr_vcpus++;
+            e->cpu_time += runstate.time[RUNSTATE_running];
+            for ( i = 0; i < ARRAY_SIZE(e->runstate_time); i++ )
+                e->runstate_time[i] += runstate.time[i];
+        }
+
+        nr++;
+    }
+
+    rcu_read_unlock(&domlist_read_lock);
+
+    hdr->nr_entries = nr;
+    hdr->last_update = NOW();
+    smp_wmb();
+    hdr->generation++;  /* back to even */
+
+    set_timer(&statspage_timer, NOW() + MILLISECS(statspage_period_ms));
+}
+
+static int statspage_enable(unsigned int capacity, unsigned int period_ms)
+{
+    unsigned int nr_pages, order, i;
+    void *va;
+
+    if ( statspage_enabled )
+        return -EBUSY;
+
+    if ( capacity == 0 )
+        capacity = STATSPAGE_DEFAULT_CAPACITY;
+    if ( capacity > STATSPAGE_MAX_CAPACITY )
+        return -EINVAL;
+
+    if ( statspage_hdr == NULL )
+    {
+        nr_pages = PFN_UP(sizeof(*statspage_hdr) +
+                          capacity * sizeof(*statspage_entries));
+        order = get_order_from_pages(nr_pages);
+
+        va = alloc_xenheap_pages(order, 0);
+        if ( va == NULL )
+            return -ENOMEM;
+        memset(va, 0, PAGE_SIZE << order);
+
+        /*
+         * The area may remain mapped by tools across a disable/enable
+         * cycle, so it is shared once and never freed or resized.
+         */
+        for ( i = 0; i < (1u << order); i++ )
+            share_xen_page_with_privileged_guests(virt_to_page(va) + i,
+                                                  SHARE_ro);
+
+        statspage_hdr = va;
+        statspage_entries = (void *)(statspage_hdr + 1);
+        statspage_order = order;
+        statspage_hdr->capacity =
+            ((PAGE_SIZE << order) - sizeof(*statspage_hdr)) /
+            sizeof(*statspage_entries);
+    }
+    else if ( capacity > statspage_hdr->capacity )
+        return -EBUSY;
+
+    statspage_period_ms = period_ms ?: STATSPAGE_DEFAULT_PERIOD_MS;
+    statspage_hdr->period_ms = statspage_period_ms;
+    statspage_enabled = true;
+
+    set_timer(&statspage_timer, NOW());
+
+    return 0;
+}
+
+int statspage_control(struct xen_sysctl_statspage_op *op)
+{
+    int rc = 0;
+
+    spin_lock(&statspage_lock);
+
+    switch ( op->cmd )
+    {
+    case XEN_SYSCTL_STATSPAGE_enable:
+        rc = statspage_enable(op->capacity, op->period_ms);
+        break;
+
+    case XEN_SYSCTL_STATSPAGE_disable:
+        if ( !statspage_enabled )
+            rc = -EINVAL;
+        else
+        {
+            statspage_enabled = false;
+            stop_timer(&statspage_timer);
+        }
+        break;
+
+    case XEN_SYSCTL_STATSPAGE_get_info:
+        if ( statspage_hdr == NULL )
+            rc = -ENODATA;
+        else
+        {
+            op->mfn = virt_to_mfn(statspage_hdr);
+            op->nr_pages = 1u << statspage_order;
+        }
+        break;
+
+    default:
+        rc = -EINVAL;
+        break;
+    }
+
+    spin_unlock(&statspage_lock);
+
+    return rc;
+}
+
+static int __init statspage_init(void)
+{
+    init_timer(&statspage_timer, statspage_refresh, NULL, 0);
+    return 0;
+}
+__initcall(statspage_init);
+
+/*
+ * Local variables:
+ * mode: C
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
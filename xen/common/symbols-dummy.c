@@ -21,4 +21,4 @@ const struct symbol_offset symbols_sorted_offsets[1];
 const u8 symbols_token_table[1];
 const u16 symbols_token_index[1];
 
-const unsigned int symbols_markers[1];
+const unsigned int symbols_name_offsets[1];
@@ -35,7 +35,7 @@ extern const struct symbol_offset symbols_sorted_offsets[];
 extern const u8 symbols_token_table[];
 extern const u16 symbols_token_index[];
 
-extern const unsigned int symbols_markers[];
+extern const unsigned int symbols_name_offsets[];
 
 /* expand a compressed symbol data into the resulting uncompressed string,
    given the offset to where the symbol is in the compressed stream */
@@ -80,21 +80,11 @@ static unsigned int symbols_expand_symbol(unsigned int off, char *result)
  * symbols array */
 static unsigned int get_symbol_offset(unsigned long pos)
 {
-    const u8 *name;
-    int i;
-
-    /* use the closest marker we have. We have markers every 256 positions,
-     * so that should be close enough */
-    name = &symbols_names[ symbols_markers[pos>>8] ];
-
-    /* sequentially scan all the symbols up to the point we're searching for.
-     * Every symbol is stored in a [<len>][<len> bytes of data] format, so we
-     * just need to add the len to the current pointer for every symbol we
-     * wish to skip */
-    for(i = 0; i < (pos&0xFF); i++)
-        name = name + (*name) + 1;
-
-    return name - symbols_names;
+    /*
+     * The build-time tool emits a per-symbol offset into the compressed
+     * stream, so no walking of the stream is needed to find a name.
+     */
+    return symbols_name_offsets[pos];
 }
 
 bool_t is_active_kernel_text(unsigned long addr)
@@ -173,13 +163,7 @@ static char symbols_get_symbol_type(unsigned int off)
 int xensyms_read(uint32_t *symnum, char *type,
                  unsigned long *address, char *name)
 {
-    /*
-     * Symbols are most likely accessed sequentially so we remember position
-     * from previous read. This can help us avoid the extra call to
-     * get_symbol_offset().
-     */
-    static uint64_t next_symbol, next_offset;
-    static DEFINE_SPINLOCK(symbols_mutex);
+    unsigned int off;
 
     if ( *symnum > symbols_num_syms )
         return -ERANGE;
@@ -190,21 +174,17 @@ int xensyms_read(uint32_t *symnum, char *type,
         return 0;
     }
 
-    spin_lock(&symbols_mutex);
-
-    if ( *symnum == 0 )
-        next_offset = next_symbol = 0;
-    if ( next_symbol != *symnum )
-        /* Non-sequential access */
-        next_offset = get_symbol_offset(*symnum);
-
-    *type = symbols_get_symbol_type(next_offset);
-    next_offset = symbols_expand_symbol(next_offset, name);
+    /*
+     * All tables are const and the per-symbol name offsets make random
+     * access O(1), so no serialization or sequential-access caching is
+     * needed.
+     */
+    off = get_symbol_offset(*symnum);
+    *type = symbols_get_symbol_type(off);
+    symbols_expand_symbol(off, name);
     *address = symbols_address(*symnum);
 
-    next_symbol = ++*symnum;
-
-    spin_unlock(&symbols_mutex);
+    ++*symnum;
 
     return 0;
 }
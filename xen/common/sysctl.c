@@ -28,20 +28,64 @@
 #include <xen/pmstat.h>
 #include <xen/livepatch.h>
 #include <xen/coverage.h>
+#include <xen/domperf.h>
+#include <xen/statspage.h>
+#include <xen/xmalloc.h>
+#include <xen/dlog.h>
+
+/*
+ * Per-subop copy sizes, derived at build time from the public header
+ * types, mirroring domctl_copy_size(): listed subops copy only the
+ * header plus the active union member in each direction, everything
+ * else (notably arch_do_sysctl() subops) keeps the full-size copy.
+ */
+#define SYSCTL_COPY_HDR offsetof(struct xen_sysctl, u)
+#define SYSCTL_COPY(memb) \
+    (SYSCTL_COPY_HDR + sizeof(((struct xen_sysctl *)NULL)->u.memb))
+
+static unsigned int sysctl_copy_size(unsigned int cmd)
+{
+    static const uint16_t size[] = {
+        [XEN_SYSCTL_readconsole]       = SYSCTL_COPY(readconsole),
+        [XEN_SYSCTL_physinfo]          = SYSCTL_COPY(physinfo),
+        [XEN_SYSCTL_sched_id]          = SYSCTL_COPY(sched_id),
+        [XEN_SYSCTL_getdomaininfolist] = SYSCTL_COPY(getdomaininfolist),
+        [XEN_SYSCTL_getcpuinfo]        = SYSCTL_COPY(getcpuinfo),
+        [XEN_SYSCTL_availheap]         = SYSCTL_COPY(availheap),
+        [XEN_SYSCTL_memprof]           = SYSCTL_COPY(memprof),
+        [XEN_SYSCTL_dlog]              = SYSCTL_COPY(dlog),
+    };
+
+    if ( cmd < ARRAY_SIZE(size) && size[cmd] != 0 )
+        return size[cmd];
+
+    return sizeof(struct xen_sysctl);
+}
 
 long do_sysctl(XEN_GUEST_HANDLE_PARAM(xen_sysctl_t) u_sysctl)
 {
     long ret = 0;
     int copyback = -1;
+    unsigned int copy_size;
     struct xen_sysctl curop, *op = &curop;
     static DEFINE_SPINLOCK(sysctl_lock);
 
-    if ( copy_from_guest(op, u_sysctl, 1) )
+    if ( copy_from_guest_offset((uint8_t *)op,
+                                guest_handle_cast(u_sysctl, void),
+                                0, SYSCTL_COPY_HDR) )
         return -EFAULT;
 
     if ( op->interface_version != XEN_SYSCTL_INTERFACE_VERSION )
         return -EACCES;
 
+    copy_size = sysctl_copy_size(op->cmd);
+    if ( copy_size > SYSCTL_COPY_HDR &&
+         copy_from_guest_offset((uint8_t *)op + SYSCTL_COPY_HDR,
+                                guest_handle_cast(u_sysctl, void),
+                                SYSCTL_COPY_HDR,
+                                copy_size - SYSCTL_COPY_HDR) )
+        return -EFAULT;
+
     ret = xsm_sysctl(XSM_PRIV, op->cmd);
     if ( ret )
         return ret;
@@ -114,6 +158,81 @@ long do_sysctl(XEN_GUEST_HANDLE_PARAM(xen_sysctl_t) u_sysctl)
     }
     break;
 
+    case XEN_SYSCTL_domain_snapshot:
+    {
+        struct domain *d;
+        struct vcpu *v;
+        struct xen_domctl_getdomaininfo info = { 0 };
+        u32 num_domains = 0, num_vcpus = 0;
+
+        rcu_read_lock(&domlist_read_lock);
+
+        op->u.domain_snapshot.generation = domlist_generation;
+
+        for_each_domain ( d )
+        {
+            if ( d->domain_id < op->u.domain_snapshot.first_domain )
+                continue;
+            if ( num_domains == op->u.domain_snapshot.max_domains )
+                break;
+
+            ret = xsm_getdomaininfo(XSM_HOOK, d);
+            if ( ret )
+                continue;
+
+            getdomaininfo(d, &info);
+
+            if ( copy_to_guest_offset(op->u.domain_snapshot.domains,
+                                      num_domains, &info, 1) )
+            {
+                ret = -EFAULT;
+                break;
+            }
+
+            num_domains++;
+
+            for_each_vcpu ( d, v )
+            {
+                struct vcpu_runstate_info runstate;
+                struct xen_sysctl_vcpu_snapshot vsnap = {
+                    .domain  = d->domain_id,
+                    .vcpu    = v->vcpu_id,
+                    .online  = !(v->pause_flags & VPF_down),
+                    .blocked = !!(v->pause_flags & VPF_blocked),
+                    .running = v->is_running,
+                    .cpu     = v->processor,
+                };
+
+                if ( num_vcpus == op->u.domain_snapshot.max_vcpus )
+                    break;
+
+                vcpu_runstate_get(v, &runstate);
+                memcpy(vsnap.time, runstate.time, sizeof(vsnap.time));
+
+                if ( copy_to_guest_offset(op->u.domain_snapshot.vcpus,
+                                          num_vcpus, &vsnap, 1) )
+                {
+                    ret = -EFAULT;
+                    break;
+                }
+
+                num_vcpus++;
+            }
+
+            if ( ret != 0 )
+                break;
+        }
+
+        rcu_read_unlock(&domlist_read_lock);
+
+        if ( ret != 0 )
+            break;
+
+        op->u.domain_snapshot.num_domains = num_domains;
+        op->u.domain_snapshot.num_vcpus = num_vcpus;
+    }
+    break;
+
 #ifdef CONFIG_PERF_COUNTERS
     case XEN_SYSCTL_perfc_op:
         ret = perfc_control(&op->u.perfc_op);
@@ -125,6 +244,12 @@ long do_sysctl(XEN_GUEST_HANDLE_PARAM(xen_sysctl_t) u_sysctl)
         ret = spinlock_profile_control(&op->u.lockprof_op);
         break;
 #endif
+    case XEN_SYSCTL_domperf_op:
+        ret = domperf_control(&op->u.domperf_op);
+        break;
+    case XEN_SYSCTL_statspage_op:
+        ret = statspage_control(&op->u.statspage_op);
+        break;
     case XEN_SYSCTL_debug_keys:
     {
         char c;
@@ -171,6 +296,43 @@ long do_sysctl(XEN_GUEST_HANDLE_PARAM(xen_sysctl_t) u_sysctl)
         op->u.availheap.avail_bytes <<= PAGE_SHIFT;
         break;
 
+    case XEN_SYSCTL_memprof:
+    {
+        struct domain *d;
+        uint32_t i = 0;
+
+        ret = xmalloc_memprof_op(&op->u.memprof);
+        if ( ret )
+            break;
+
+        rcu_read_lock(&domlist_read_lock);
+        for_each_domain ( d )
+        {
+            struct xen_memprof_dom ent = {
+                .domain = d->domain_id,
+                .tot_pages = d->tot_pages,
+                .xenheap_pages = d->xenheap_pages,
+            };
+
+            if ( i == op->u.memprof.nr_doms )
+                break;
+            if ( copy_to_guest_offset(op->u.memprof.doms, i, &ent, 1) )
+            {
+                ret = -EFAULT;
+                break;
+            }
+            i++;
+        }
+        rcu_read_unlock(&domlist_read_lock);
+
+        op->u.memprof.nr_doms = i;
+    }
+    break;
+
+    case XEN_SYSCTL_dlog:
+        ret = dlog_sysctl(&op->u.dlog);
+        break;
+
 #if defined (CONFIG_ACPI) && defined (CONFIG_HAS_CPUFREQ)
     case XEN_SYSCTL_get_pmstat:
         ret = do_get_pm_info(&op->u.get_pmstat);
@@ -264,7 +426,7 @@ long do_sysctl(XEN_GUEST_HANDLE_PARAM(xen_sysctl_t) u_sysctl)
         pi->total_pages = total_pages;
         /* Protected by lock */
         get_outstanding_claims(&pi->free_pages, &pi->outstanding_pages);
-        pi->scrub_pages = 0;
+        pi->scrub_pages = pending_scrub_pages();
         pi->cpu_khz = cpu_khz;
         pi->max_mfn = get_upper_mfn_bound();
         arch_do_physinfo(pi);
@@ -512,7 +674,8 @@ long do_sysctl(XEN_GUEST_HANDLE_PARAM(xen_sysctl_t) u_sysctl)
     spin_unlock(&sysctl_lock);
 
     if ( copyback && (!ret || copyback > 0) &&
-         __copy_to_guest(u_sysctl, op, 1) )
+         __copy_to_guest_offset(guest_handle_cast(u_sysctl, void),
+                                0, (uint8_t *)op, copy_size) )
         ret = -EFAULT;
 
     return ret;
@@ -14,6 +14,7 @@
  */
 
 #include <xen/init.h>
+#include <xen/keyhandler.h>
 #include <xen/sched.h>
 #include <xen/softirq.h>
 #include <xen/tasklet.h>
@@ -27,13 +28,25 @@ DEFINE_PER_CPU(unsigned long, tasklet_work_to_do);
 static DEFINE_PER_CPU(struct list_head, tasklet_list);
 static DEFINE_PER_CPU(struct list_head, softirq_tasklet_list);
 
+/* Queue depths, maintained under tasklet_lock, racily read when stealing. */
+static DEFINE_PER_CPU(unsigned int, tasklet_depth);
+static DEFINE_PER_CPU(unsigned int, softirq_tasklet_depth);
+
 /* Protects all lists and tasklet structures. */
 static DEFINE_SPINLOCK(tasklet_lock);
 
+static unsigned int *queue_depth(const struct tasklet *t, unsigned int cpu)
+{
+    return t->is_softirq ? &per_cpu(softirq_tasklet_depth, cpu)
+                         : &per_cpu(tasklet_depth, cpu);
+}
+
 static void tasklet_enqueue(struct tasklet *t)
 {
     unsigned int cpu = t->scheduled_on;
 
+    ++*queue_depth(t, cpu);
+
     if ( t->is_softirq )
     {
         struct list_head *list = &per_cpu(softirq_tasklet_list, cpu);
@@ -51,7 +64,8 @@ static void tasklet_enqueue(struct tasklet *t)
     }
 }
 
-void tasklet_schedule_on_cpu(struct tasklet *t, unsigned int cpu)
+static void tasklet_schedule_cpu(struct tasklet *t, unsigned int cpu,
+                                 bool_t pinned)
 {
     unsigned long flags;
 
@@ -59,7 +73,11 @@ void tasklet_schedule_on_cpu(struct tasklet *t, unsigned int cpu)
 
     if ( tasklets_initialised && !t->is_dead )
     {
+        /* If already queued, account its removal against the old CPU. */
+        if ( !t->is_running && !list_empty(&t->list) )
+            --*queue_depth(t, t->scheduled_on);
         t->scheduled_on = cpu;
+        t->is_pinned = pinned;
         if ( !t->is_running )
         {
             list_del(&t->list);
@@ -70,9 +88,14 @@ void tasklet_schedule_on_cpu(struct tasklet *t, unsigned int cpu)
     spin_unlock_irqrestore(&tasklet_lock, flags);
 }
 
+void tasklet_schedule_on_cpu(struct tasklet *t, unsigned int cpu)
+{
+    tasklet_schedule_cpu(t, cpu, 1);
+}
+
 void tasklet_schedule(struct tasklet *t)
 {
-    tasklet_schedule_on_cpu(t, smp_processor_id());
+    tasklet_schedule_cpu(t, smp_processor_id(), 0);
 }
 
 static void do_tasklet_work(unsigned int cpu, struct list_head *list)
@@ -84,6 +107,7 @@ static void do_tasklet_work(unsigned int cpu, struct list_head *list)
 
     t = list_entry(list->next, struct tasklet, list);
     list_del_init(&t->list);
+    --*queue_depth(t, cpu);
 
     BUG_ON(t->is_dead || t->is_running || (t->scheduled_on != cpu));
     t->scheduled_on = -1;
@@ -103,6 +127,60 @@ static void do_tasklet_work(unsigned int cpu, struct list_head *list)
     }
 }
 
+/*
+ * Pull one piece of VCPU context work queued behind other work on a busy
+ * peer across to this (otherwise idle) CPU.  Tasklets given an explicit CPU
+ * via tasklet_schedule_on_cpu() are never moved.  Returns whether work was
+ * stolen, in which case SCHEDULE_SOFTIRQ has been raised locally.
+ */
+bool tasklet_steal_work(void)
+{
+    unsigned int cpu = smp_processor_id(), peer, victim = NR_CPUS, depth = 1;
+    struct tasklet *t, *found = NULL;
+    unsigned long flags;
+
+    if ( !tasklets_initialised || cpu_is_offline(cpu) ||
+         per_cpu(tasklet_depth, cpu) )
+        return false;
+
+    /*
+     * Racy scan for the deepest queue with work backed up behind other
+     * work; anything stale is caught by the locked re-check below.
+     */
+    for_each_online_cpu ( peer )
+        if ( peer != cpu && per_cpu(tasklet_depth, peer) > depth )
+        {
+            victim = peer;
+            depth = per_cpu(tasklet_depth, peer);
+        }
+
+    if ( victim == NR_CPUS )
+        return false;
+
+    spin_lock_irqsave(&tasklet_lock, flags);
+
+    if ( per_cpu(tasklet_depth, victim) > 1 )
+        list_for_each_entry_reverse ( t, &per_cpu(tasklet_list, victim),
+                                      list )
+            if ( !t->is_pinned )
+            {
+                found = t;
+                break;
+            }
+
+    if ( found )
+    {
+        --per_cpu(tasklet_depth, victim);
+        list_del(&found->list);
+        found->scheduled_on = cpu;
+        tasklet_enqueue(found);
+    }
+
+    spin_unlock_irqrestore(&tasklet_lock, flags);
+
+    return found;
+}
+
 /* VCPU context work */
 void do_tasklet(void)
 {
@@ -163,6 +241,7 @@ void tasklet_kill(struct tasklet *t)
     if ( !list_empty(&t->list) )
     {
         BUG_ON(t->is_dead || t->is_running || (t->scheduled_on < 0));
+        --*queue_depth(t, t->scheduled_on);
         list_del_init(&t->list);
     }
 
@@ -191,6 +270,7 @@ static void migrate_tasklets_from_cpu(unsigned int cpu, struct list_head *list)
     {
         t = list_entry(list->next, struct tasklet, list);
         BUG_ON(t->scheduled_on != cpu);
+        --*queue_depth(t, cpu);
         t->scheduled_on = smp_processor_id();
         list_del(&t->list);
         tasklet_enqueue(t);
@@ -244,12 +324,33 @@ static struct notifier_block cpu_nfb = {
     .priority = 99
 };
 
+static void dump_tasklet_queues(unsigned char key)
+{
+    unsigned int cpu;
+    unsigned long flags;
+
+    printk("'%c' pressed -> dumping tasklet queue depths\n", key);
+
+    spin_lock_irqsave(&tasklet_lock, flags);
+
+    for_each_online_cpu ( cpu )
+        if ( per_cpu(tasklet_depth, cpu) ||
+             per_cpu(softirq_tasklet_depth, cpu) )
+            printk("CPU%u: %u queued, %u softirq queued\n", cpu,
+                   per_cpu(tasklet_depth, cpu),
+                   per_cpu(softirq_tasklet_depth, cpu));
+
+    spin_unlock_irqrestore(&tasklet_lock, flags);
+}
+
 void __init tasklet_subsys_init(void)
 {
     void *hcpu = (void *)(long)smp_processor_id();
     cpu_callback(&cpu_nfb, CPU_UP_PREPARE, hcpu);
     register_cpu_notifier(&cpu_nfb);
     open_softirq(TASKLET_SOFTIRQ, tasklet_softirq_action);
+    register_keyhandler('k', dump_tasklet_queues,
+                        "dump tasklet queue depths", 1);
     tasklets_initialised = 1;
 }
 
@@ -28,11 +28,25 @@
 static unsigned int timer_slop __read_mostly = 50000; /* 50 us */
 integer_param("timer_slop", timer_slop);
 
+/*
+ * Timers expiring within the wheel horizon go into a timing wheel of
+ * TIMER_WHEEL_SLOTS unsorted per-slot lists, giving O(1) insertion and
+ * removal for the short-interval (mostly periodic) timers which dominate
+ * at high rates.  Everything further out stays on the heap, which thus
+ * acts as the wheel's overflow level.
+ */
+#define TIMER_WHEEL_SHIFT 17 /* ~131 us per slot */
+#define TIMER_WHEEL_SLOTS 128 /* ~16.8 ms horizon */
+
 struct timers {
     spinlock_t     lock;
     struct timer **heap;
     struct timer  *list;
     struct timer  *running;
+    struct timer  *wheel[TIMER_WHEEL_SLOTS];
+    /* Absolute slot number up to which the wheel has been drained. */
+    unsigned long  wheel_cursor;
+    unsigned int   wheel_count;
     struct list_head inactive;
 } __cacheline_aligned;
 
@@ -166,6 +180,67 @@ static int add_to_list(struct timer **pprev, struct timer *t)
 }
 
 
+/****************************************************************************
+ * TIMING WHEEL OPERATIONS.
+ */
+
+static unsigned long wheel_slot(s_time_t expires)
+{
+    return (unsigned long)expires >> TIMER_WHEEL_SHIFT;
+}
+
+/* Add @t to @timers' wheel. Return TRUE if the deadline needs reprogramming. */
+static int add_to_wheel(struct timers *timers, struct timer *t)
+{
+    struct timer **slot = &timers->wheel[wheel_slot(t->expires) %
+                                         TIMER_WHEEL_SLOTS];
+
+    t->list_next = *slot;
+    *slot = t;
+    timers->wheel_count++;
+
+    /*
+     * Slots aren't sorted, so we can't cheaply tell whether @t is the new
+     * earliest deadline.  Compare against what is currently programmed,
+     * accepting the occasional spurious softirq.
+     */
+    return (per_cpu(timer_deadline, t->cpu) == 0) ||
+           (t->expires < per_cpu(timer_deadline, t->cpu));
+}
+
+static void remove_from_wheel(struct timers *timers, struct timer *t)
+{
+    struct timer **slot = &timers->wheel[wheel_slot(t->expires) %
+                                         TIMER_WHEEL_SLOTS];
+
+    remove_from_list(slot, t);
+    timers->wheel_count--;
+}
+
+/* Find the earliest-expiring timer on @timers' wheel, if any. */
+static struct timer *wheel_earliest(struct timers *timers)
+{
+    struct timer *t, *earliest = NULL;
+    unsigned int i;
+
+    if ( timers->wheel_count == 0 )
+        return NULL;
+
+    /* Slots are time ordered, so the first occupied one holds the winner. */
+    for ( i = 0; i < TIMER_WHEEL_SLOTS; i++ )
+    {
+        t = timers->wheel[(timers->wheel_cursor + i) % TIMER_WHEEL_SLOTS];
+        if ( t == NULL )
+            continue;
+        for ( earliest = t; (t = t->list_next) != NULL; )
+            if ( t->expires < earliest->expires )
+                earliest = t;
+        break;
+    }
+
+    return earliest;
+}
+
 /****************************************************************************
  * TIMER OPERATIONS.
  */
@@ -183,6 +258,10 @@ static int remove_entry(struct timer *t)
     case TIMER_STATUS_in_list:
         rc = remove_from_list(&timers->list, t);
         break;
+    case TIMER_STATUS_in_wheel:
+        remove_from_wheel(timers, t);
+        rc = 0;
+        break;
     default:
         rc = 0;
         BUG();
@@ -195,10 +274,19 @@ static int remove_entry(struct timer *t)
 static int add_entry(struct timer *t)
 {
     struct timers *timers = &per_cpu(timers, t->cpu);
+    unsigned long slot = wheel_slot(t->expires);
     int rc;
 
     ASSERT(t->status == TIMER_STATUS_invalid);
 
+    /* Short-interval timers go on the wheel. */
+    if ( (slot >= timers->wheel_cursor) &&
+         (slot < timers->wheel_cursor + TIMER_WHEEL_SLOTS) )
+    {
+        t->status = TIMER_STATUS_in_wheel;
+        return add_to_wheel(timers, t);
+    }
+
     /* Try to add to heap. t->heap_offset indicates whether we succeed. */
     t->heap_offset = 0;
     t->status = TIMER_STATUS_in_heap;
@@ -276,7 +364,7 @@ static inline void timer_unlock(struct timer *timer)
 static bool_t active_timer(struct timer *timer)
 {
     ASSERT(timer->status >= TIMER_STATUS_inactive);
-    ASSERT(timer->status <= TIMER_STATUS_in_list);
+    ASSERT(timer->status <= TIMER_STATUS_in_wheel);
     return (timer->status >= TIMER_STATUS_in_heap);
 }
 
@@ -443,9 +531,10 @@ static void execute_timer(struct timers *ts, struct timer *t)
 
 static void timer_softirq_action(void)
 {
-    struct timer  *t, **heap, *next;
+    struct timer  *t, **heap, *next, **pprev;
     struct timers *ts;
     s_time_t       now, deadline;
+    unsigned long  cur_slot;
 
     ts = &this_cpu(timers);
     heap = ts->heap;
@@ -473,6 +562,41 @@ static void timer_softirq_action(void)
     spin_lock_irq(&ts->lock);
 
     now = NOW();
+    cur_slot = wheel_slot(now);
+
+    /* Execute wheel slots which have passed in their entirety. */
+    while ( (ts->wheel_cursor < cur_slot) && (ts->wheel_count != 0) )
+    {
+        struct timer **slot = &ts->wheel[ts->wheel_cursor %
+                                         TIMER_WHEEL_SLOTS];
+
+        while ( (t = *slot) != NULL )
+        {
+            *slot = t->list_next;
+            ts->wheel_count--;
+            execute_timer(ts, t);
+        }
+
+        ts->wheel_cursor++;
+    }
+    if ( ts->wheel_cursor < cur_slot )
+        ts->wheel_cursor = cur_slot;
+
+    /* Execute ready timers in the current (partially elapsed) wheel slot. */
+    pprev = &ts->wheel[cur_slot % TIMER_WHEEL_SLOTS];
+    while ( (t = *pprev) != NULL )
+    {
+        if ( t->expires >= now )
+        {
+            pprev = &t->list_next;
+            continue;
+        }
+        *pprev = t->list_next;
+        ts->wheel_count--;
+        execute_timer(ts, t);
+        /* The slot may have changed while the lock was dropped. */
+        pprev = &ts->wheel[cur_slot % TIMER_WHEEL_SLOTS];
+    }
 
     /* Execute ready heap timers. */
     while ( (GET_HEAP_SIZE(heap) != 0) &&
@@ -499,12 +623,14 @@ static void timer_softirq_action(void)
         add_entry(t);
     }
 
-    /* Find earliest deadline from head of linked list and top of heap. */
+    /* Find earliest deadline across the wheel, linked list and heap. */
     deadline = STIME_MAX;
     if ( GET_HEAP_SIZE(heap) != 0 )
         deadline = heap[1]->expires;
     if ( (ts->list != NULL) && (ts->list->expires < deadline) )
         deadline = ts->list->expires;
+    if ( ((t = wheel_earliest(ts)) != NULL) && (t->expires < deadline) )
+        deadline = t->expires;
     now = NOW();
     this_cpu(timer_deadline) =
         (deadline == STIME_MAX) ? 0 : MAX(deadline, now + timer_slop);
@@ -549,6 +675,9 @@ static void dump_timerq(unsigned char key)
             dump_timer(ts->heap[j], now);
         for ( t = ts->list, j = 0; t != NULL; t = t->list_next, j++ )
             dump_timer(t, now);
+        for ( j = 0; j < TIMER_WHEEL_SLOTS; j++ )
+            for ( t = ts->wheel[j]; t != NULL; t = t->list_next )
+                dump_timer(t, now);
         spin_unlock_irqrestore(&ts->lock, flags);
     }
 }
@@ -577,7 +706,8 @@ static void migrate_timers_from_cpu(unsigned int old_cpu)
     }
 
     while ( (t = GET_HEAP_SIZE(old_ts->heap)
-             ? old_ts->heap[1] : old_ts->list) != NULL )
+             ? old_ts->heap[1]
+             : old_ts->list ?: wheel_earliest(old_ts)) != NULL )
     {
         remove_entry(t);
         write_atomic(&t->cpu, new_cpu);
@@ -613,6 +743,7 @@ static int cpu_callback(
         INIT_LIST_HEAD(&ts->inactive);
         spin_lock_init(&ts->lock);
         ts->heap = &dummy_heap;
+        ts->wheel_cursor = wheel_slot(NOW());
         break;
     case CPU_UP_CANCELED:
     case CPU_DEAD:
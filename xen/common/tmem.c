@@ -100,9 +100,7 @@ static int tmem_initialized = 0;
 struct xmem_pool *tmem_mempool = 0;
 unsigned int tmem_mempool_maxalloc = 0;
 
-DEFINE_SPINLOCK(tmem_page_list_lock);
-PAGE_LIST_HEAD(tmem_page_list);
-unsigned long tmem_page_list_pages = 0;
+struct tmem_page_list tmem_page_lists[MAX_NUMNODES];
 
 DEFINE_RWLOCK(tmem_rwlock);
 static DEFINE_SPINLOCK(eph_lists_spinlock); /* Protects global AND clients. */
@@ -1003,7 +1001,7 @@ static inline bool tmem_ensure_avail_pages(void)
     unsigned long free_mem;
 
     do {
-        free_mem = (tmem_page_list_pages + total_free_pages())
+        free_mem = (tmem_page_list_pages() + total_free_pages())
                         >> (20 - PAGE_SHIFT);
         if ( free_mem )
             return true;
@@ -2060,15 +2058,23 @@ unsigned long tmem_freeable_pages(void)
     if ( !tmem_enabled() )
         return 0;
 
-    return tmem_page_list_pages + _atomic_read(freeable_page_count);
+    return tmem_page_list_pages() + _atomic_read(freeable_page_count);
 }
 
 /* Called at hypervisor startup. */
 static int __init init_tmem(void)
 {
+    unsigned int node;
+
     if ( !tmem_enabled() )
         return 0;
 
+    for ( node = 0; node < MAX_NUMNODES; node++ )
+    {
+        spin_lock_init(&tmem_page_lists[node].lock);
+        INIT_PAGE_LIST_HEAD(&tmem_page_lists[node].list);
+    }
+
     if ( !tmem_mempool_init() )
         return 0;
 
@@ -45,24 +45,31 @@ static unsigned long tmem_flush_npages(unsigned long n)
 {
     unsigned long avail_pages = 0;
 
-    while ( (avail_pages = tmem_page_list_pages) < n )
+    while ( (avail_pages = tmem_page_list_pages()) < n )
     {
         if (  !tmem_evict() )
             break;
     }
     if ( avail_pages )
     {
-        spin_lock(&tmem_page_list_lock);
-        while ( !page_list_empty(&tmem_page_list) )
+        unsigned int node;
+
+        for ( node = 0; node < MAX_NUMNODES; node++ )
         {
-            struct page_info *pg = page_list_remove_head(&tmem_page_list);
-            scrub_one_page(pg);
-            tmem_page_list_pages--;
-            free_domheap_page(pg);
+            struct tmem_page_list *pl = &tmem_page_lists[node];
+
+            spin_lock(&pl->lock);
+            while ( !page_list_empty(&pl->list) )
+            {
+                struct page_info *pg = page_list_remove_head(&pl->list);
+                scrub_one_page(pg);
+                pl->pages--;
+                free_domheap_page(pg);
+            }
+            ASSERT(pl->pages == 0);
+            INIT_PAGE_LIST_HEAD(&pl->list);
+            spin_unlock(&pl->lock);
         }
-        ASSERT(tmem_page_list_pages == 0);
-        INIT_PAGE_LIST_HEAD(&tmem_page_list);
-        spin_unlock(&tmem_page_list_lock);
     }
     return avail_pages;
 }
@@ -213,7 +220,8 @@ static int tmemc_list_global(tmem_cli_va_param_t buf, int off, uint32_t len,
       "Tt:%lu,Te:%lu,Cf:%lu,Af:%lu,Pf:%lu,Ta:%lu,"
       "Lm:%lu,Et:%lu,Ea:%lu,Rt:%lu,Ra:%lu,Rx:%lu,Fp:%lu%c",
       tmem_stats.total_tmem_ops, tmem_stats.errored_tmem_ops, tmem_stats.failed_copies,
-      tmem_stats.alloc_failed, tmem_stats.alloc_page_failed, tmem_page_list_pages,
+      tmem_stats.alloc_failed, tmem_stats.alloc_page_failed,
+      tmem_page_list_pages(),
       tmem_stats.low_on_memory, tmem_stats.evicted_pgs,
       tmem_stats.evict_attempts, tmem_stats.relinq_pgs, tmem_stats.relinq_attempts,
       tmem_stats.max_evicts_per_relinq,
@@ -9,6 +9,7 @@
 #include <xen/tmem.h>
 #include <xen/tmem_xen.h>
 #include <xen/lzo.h> /* compression code */
+#include <xen/lz4.h> /* compression code */
 #include <xen/paging.h>
 #include <xen/domain_page.h>
 #include <xen/cpu.h>
@@ -20,12 +21,32 @@ boolean_param("tmem", opt_tmem);
 bool __read_mostly opt_tmem_compress;
 boolean_param("tmem_compress", opt_tmem_compress);
 
+/*
+ * lz4 trades a little compression ratio for markedly less time spent
+ * holding per-pool locks during put/get; tmem contents do not survive
+ * a reboot, so the algorithm only needs to stay fixed within one boot.
+ */
+static bool __read_mostly opt_tmem_compress_lz4 = true;
+
+static int __init parse_tmem_compress_algo(const char *s)
+{
+    if ( !strcmp(s, "lz4") )
+        opt_tmem_compress_lz4 = true;
+    else if ( !strcmp(s, "lzo") )
+        opt_tmem_compress_lz4 = false;
+    else
+        return -EINVAL;
+
+    return 0;
+}
+custom_param("tmem_compress_algo", parse_tmem_compress_algo);
+
 atomic_t freeable_page_count = ATOMIC_INIT(0);
 
-/* these are a concurrency bottleneck, could be percpu and dynamically
- * allocated iff opt_tmem_compress */
-#define LZO_WORKMEM_BYTES LZO1X_1_MEM_COMPRESS
-#define LZO_DSTMEM_PAGES 2
+/* Scratch buffers are per-cpu, sized for whichever algorithm needs more.
+ * Both compressors emit at most compressbound(PAGE_SIZE) < 2 pages. */
+#define COMP_WORKMEM_BYTES max(LZO1X_1_MEM_COMPRESS, LZ4_MEM_COMPRESS)
+#define COMP_DSTMEM_PAGES 2
 static DEFINE_PER_CPU_READ_MOSTLY(unsigned char *, workmem);
 static DEFINE_PER_CPU_READ_MOSTLY(unsigned char *, dstmem);
 static DEFINE_PER_CPU_READ_MOSTLY(void *, scratch_page);
@@ -142,8 +163,17 @@ int tmem_compress_from_client(xen_pfn_t cmfn,
     else if ( copy_from_guest(scratch, clibuf, PAGE_SIZE) )
         return -EFAULT;
     smp_mb();
-    ret = lzo1x_1_compress(cli_va ?: scratch, PAGE_SIZE, dmem, out_len, wmem);
-    ASSERT(ret == LZO_E_OK);
+    if ( opt_tmem_compress_lz4 )
+    {
+        ret = lz4_compress(cli_va ?: scratch, PAGE_SIZE, dmem, out_len, wmem);
+        ASSERT(ret == 0);
+    }
+    else
+    {
+        ret = lzo1x_1_compress(cli_va ?: scratch, PAGE_SIZE, dmem, out_len,
+                               wmem);
+        ASSERT(ret == LZO_E_OK);
+    }
     *out_va = dmem;
     if ( cli_va )
         cli_put_page(cli_va, cli_pfp, cli_mfn, 0);
@@ -198,8 +228,18 @@ int tmem_decompress_to_client(xen_pfn_t cmfn, void *tmem_va,
     }
     else if ( !scratch )
         return 0;
-    ret = lzo1x_decompress_safe(tmem_va, size, cli_va ?: scratch, &out_len);
-    ASSERT(ret == LZO_E_OK);
+    if ( opt_tmem_compress_lz4 )
+    {
+        ret = lz4_decompress_unknownoutputsize(tmem_va, size,
+                                               cli_va ?: scratch, &out_len);
+        ASSERT(ret == 0);
+    }
+    else
+    {
+        ret = lzo1x_decompress_safe(tmem_va, size, cli_va ?: scratch,
+                                    &out_len);
+        ASSERT(ret == LZO_E_OK);
+    }
     ASSERT(out_len == PAGE_SIZE);
     if ( cli_va )
         cli_put_page(cli_va, cli_pfp, cli_mfn, 1);
@@ -262,8 +302,8 @@ int __init tmem_init(void)
 {
     unsigned int cpu;
 
-    dstmem_order = get_order_from_pages(LZO_DSTMEM_PAGES);
-    workmem_order = get_order_from_bytes(LZO1X_1_MEM_COMPRESS);
+    dstmem_order = get_order_from_pages(COMP_DSTMEM_PAGES);
+    workmem_order = get_order_from_bytes(COMP_WORKMEM_BYTES);
 
     for_each_online_cpu ( cpu )
     {
@@ -60,20 +60,33 @@ static u32 data_size __read_mostly;
 /* Send virtual interrupt when buffer level reaches this point */
 static u32 t_buf_highwater;
 
+/* Water mark above which low-priority (muted) events are shed. */
+static u32 t_buf_mutewater;
+
 /* Number of records lost due to per-CPU trace buffer being full. */
 static DEFINE_PER_CPU(unsigned long, lost_records);
 static DEFINE_PER_CPU(unsigned long, lost_records_first_tsc);
 
+/* Cumulative drop statistics, never reset while tracing is set up. */
+static DEFINE_PER_CPU(unsigned long, total_lost_records);
+static DEFINE_PER_CPU(unsigned long, muted_records);
+
 /* a flag recording whether initialization has been done */
 /* or more properly, if the tbuf subsystem is enabled right now */
 int tb_init_done __read_mostly;
 
+/* Patched gate for the trace points; kept in sync with tb_init_done. */
+struct static_branch __read_mostly tb_active = STATIC_BRANCH_FALSE;
+
 /* which CPUs tracing is enabled on */
 static cpumask_t tb_cpu_mask;
 
 /* which tracing events are enabled */
 static u32 tb_event_mask = TRC_ALL;
 
+/* low-priority events shed first when buffers fill beyond the mute mark */
+static u32 tb_mute_mask;
+
 /* Return the number of elements _type necessary to store at least _x bytes of data
  * i.e., sizeof(_type) * ans >= _x. */
 #define fit_to_type(_type, _x) (((_x)+sizeof(_type)-1) / sizeof(_type))
@@ -252,6 +265,7 @@ static int alloc_trace_bufs(unsigned int pages)
 
     data_size  = (pages * PAGE_SIZE - sizeof(struct t_buf));
     t_buf_highwater = data_size >> 1; /* 50% high water */
+    t_buf_mutewater = data_size - (data_size >> 2); /* mute at 75% */
     opt_tbuf_size = pages;
 
     printk("xentrace: initialised\n");
@@ -283,6 +297,90 @@ out_fail:
 }
 
 
+/**
+ * free_trace_bufs - tear down the per-cpu trace buffers again.
+ *
+ * Requires tracing to be disabled, and all mappings of the shared pages
+ * to have been torn down by the tools; otherwise nothing is freed.  Mirrors
+ * the unsharing done for xenoprof buffers.
+ */
+static int free_trace_bufs(void)
+{
+    uint32_t *t_info_mfn_list = (uint32_t *)t_info;
+    unsigned int cpu, i;
+    uint16_t offset;
+
+    if ( tb_init_done )
+        return -EBUSY;
+
+    if ( t_info == NULL )
+        return 0;
+
+    /*
+     * Check that no page is referenced beyond the ref which sharing it
+     * took, i.e. the tools have unmapped all of them again.
+     */
+    for ( cpu = 0; cpu < nr_cpu_ids; cpu++ )
+    {
+        offset = t_info->mfn_offset[cpu];
+        if ( !offset )
+            continue;
+        for ( i = 0; i < opt_tbuf_size; i++ )
+        {
+            const struct page_info *pg =
+                mfn_to_page(_mfn(t_info_mfn_list[offset + i]));
+
+            if ( (pg->count_info & PGC_count_mask) != 1 )
+                return -EBUSY;
+        }
+    }
+    for ( i = 0; i < t_info_pages; i++ )
+        if ( ((virt_to_page(t_info) + i)->count_info & PGC_count_mask) != 1 )
+            return -EBUSY;
+
+    /* Sync with any writer still inside __trace_var(). */
+    for_each_online_cpu(cpu)
+    {
+        unsigned long flags;
+
+        spin_lock_irqsave(&per_cpu(t_lock, cpu), flags);
+        per_cpu(t_bufs, cpu) = NULL;
+        spin_unlock_irqrestore(&per_cpu(t_lock, cpu), flags);
+    }
+
+    for ( cpu = 0; cpu < nr_cpu_ids; cpu++ )
+    {
+        offset = t_info->mfn_offset[cpu];
+        if ( !offset )
+            continue;
+        for ( i = 0; i < opt_tbuf_size; i++ )
+        {
+            uint32_t mfn = t_info_mfn_list[offset + i];
+            struct page_info *pg = mfn_to_page(_mfn(mfn));
+
+            if ( test_and_clear_bit(_PGC_allocated, &pg->count_info) )
+                put_page(pg);
+            free_xenheap_pages(mfn_to_virt(mfn), 0);
+        }
+    }
+
+    for ( i = 0; i < t_info_pages; i++ )
+    {
+        struct page_info *pg = virt_to_page(t_info) + i;
+
+        if ( test_and_clear_bit(_PGC_allocated, &pg->count_info) )
+            put_page(pg);
+    }
+    free_xenheap_pages(t_info, get_order_from_pages(t_info_pages));
+    t_info = NULL;
+    data_size = 0;
+    opt_tbuf_size = 0;
+
+    printk(XENLOG_INFO "xentrace: buffers freed\n");
+
+    return 0;
+}
+
 /**
  * tb_set_size - handle the logic involved with dynamically allocating tbufs
  *
@@ -290,18 +388,19 @@ out_fail:
  */
 static int tb_set_size(unsigned int pages)
 {
+    int rc;
+
     /*
-     * Setting size is a one-shot operation. It can be done either at
-     * boot time or via control tools, but not by both. Once buffers
-     * are created they cannot be destroyed.
+     * Resizing deallocates the current buffers and starts over with the
+     * new size; this requires tracing to be disabled and the old buffers
+     * to be unmapped by the tools.  A size of zero merely frees them.
      */
-    if ( opt_tbuf_size && pages != opt_tbuf_size )
-    {
-        printk(XENLOG_INFO "xentrace: tb_set_size from %d to %d "
-               "not implemented\n",
-               opt_tbuf_size, pages);
-        return -EINVAL;
-    }
+    if ( pages == opt_tbuf_size )
+        return 0;
+
+    rc = free_trace_bufs();
+    if ( rc || pages == 0 )
+        return rc;
 
     return alloc_trace_bufs(pages);
 }
@@ -352,12 +451,18 @@ void __init init_trace_bufs(void)
                    opt_tbuf_size);
             opt_tbuf_size = 0;
         }
-        else if ( opt_tevt_mask )
+        else
         {
-            printk("xentrace: Starting tracing, enabling mask %x\n",
-                   opt_tevt_mask);
-            tb_event_mask = opt_tevt_mask;
-            tb_init_done=1;
+            if ( opt_tevt_mask )
+            {
+                printk("xentrace: Starting tracing, enabling mask %x\n",
+                       opt_tevt_mask);
+                tb_event_mask = opt_tevt_mask;
+                tb_init_done=1;
+            }
+            if ( tb_init_done && static_branch_enable(&tb_active) )
+                printk(XENLOG_WARNING
+                       "xentrace: failed to patch trace points\n");
         }
     }
 }
@@ -395,15 +500,37 @@ int tb_control(struct xen_sysctl_tbuf_op *tbc)
     case XEN_SYSCTL_TBUFOP_set_evt_mask:
         tb_event_mask = tbc->evt_mask;
         break;
+    case XEN_SYSCTL_TBUFOP_set_mute_mask:
+        tb_mute_mask = tbc->evt_mask;
+        break;
+    case XEN_SYSCTL_TBUFOP_get_drops:
+    {
+        int i;
+
+        tbc->lost_records = 0;
+        tbc->muted_records = 0;
+        for_each_online_cpu(i)
+        {
+            tbc->lost_records += per_cpu(total_lost_records, i);
+            tbc->muted_records += per_cpu(muted_records, i);
+        }
+    }
+        break;
     case XEN_SYSCTL_TBUFOP_set_size:
         rc = tb_set_size(tbc->size);
+        if ( !rc && tb_init_done )
+            rc = static_branch_enable(&tb_active);
         break;
     case XEN_SYSCTL_TBUFOP_enable:
         /* Enable trace buffers. Check buffers are already allocated. */
-        if ( opt_tbuf_size == 0 ) 
+        if ( opt_tbuf_size == 0 )
             rc = -EINVAL;
         else
+        {
             tb_init_done = 1;
+            /* -EBUSY asks the tools to retry the hypercall. */
+            rc = static_branch_enable(&tb_active);
+        }
         break;
     case XEN_SYSCTL_TBUFOP_disable:
     {
@@ -415,6 +542,12 @@ int tb_control(struct xen_sysctl_tbuf_op *tbc)
 
         tb_init_done = 0;
         smp_wmb();
+        /*
+         * Unpatching the trace points isn't needed for correctness (the
+         * tb_init_done check in __trace_var() already keeps records out),
+         * but restores the zero-cost disabled state.
+         */
+        rc = static_branch_disable(&tb_active);
         /* Clear any lost-record info so we don't get phantom lost records next time we
          * start tracing.  Grab the lock to make sure we're not racing anyone.  After this
          * hypercall returns, no more records should be placed into the buffers. */
@@ -452,6 +585,10 @@ static inline bool_t bogus(u32 prod, u32 cons)
     if ( unlikely(prod & 3) || unlikely(prod >= 2 * data_size) ||
          unlikely(cons & 3) || unlikely(cons >= 2 * data_size) )
     {
+        /*
+         * Can't repatch tb_active from here (any context, IRQs possibly
+         * off); the sites stay live but bounce off tb_init_done below.
+         */
         tb_init_done = 0;
         printk(XENLOG_WARNING "trc#%u: bogus prod (%08x) and/or cons (%08x)\n",
                smp_processor_id(), prod, cons);
@@ -731,6 +868,22 @@ void __trace_var(u32 event, bool_t cycles, unsigned int extra,
         goto unlock;
     }
 
+    /*
+     * Above the mute water mark, shed events matching the low-priority
+     * mask up front, so the remaining space keeps higher-priority classes
+     * flowing instead of everything being lost.
+     */
+    if ( unlikely(tb_mute_mask) &&
+         (((tb_mute_mask >> TRC_CLS_SHIFT) & (event >> TRC_CLS_SHIFT)) != 0) &&
+         ((((tb_mute_mask >> TRC_SUBCLS_SHIFT) & 0xf )
+                & ((event >> TRC_SUBCLS_SHIFT) & 0xf )) != 0) &&
+         calc_unconsumed_bytes(buf) >= t_buf_mutewater )
+    {
+        this_cpu(muted_records)++;
+        started_below_highwater = 0;
+        goto unlock;
+    }
+
     started_below_highwater = (calc_unconsumed_bytes(buf) < t_buf_highwater);
 
     /* Calculate the record size */
@@ -776,6 +929,7 @@ void __trace_var(u32 event, bool_t cycles, unsigned int extra,
     {
         if ( ++this_cpu(lost_records) == 1 )
             this_cpu(lost_records_first_tsc)=(u64)get_cycles();
+        this_cpu(total_lost_records)++;
         started_below_highwater = 0;
         goto unlock;
     }
@@ -819,7 +973,8 @@ unlock:
 void __trace_hypercall(uint32_t event, unsigned long op,
                        const xen_ulong_t *args)
 {
-    struct __packed {
+    /* All fields are uint32_t, so the layout is packed already. */
+    struct {
         uint32_t op;
         uint32_t args[6];
     } d;
@@ -25,6 +25,7 @@
 #include <xen/wait.h>
 #include <xen/vm_event.h>
 #include <xen/mem_access.h>
+#include <xen/vmap.h>
 #include <asm/p2m.h>
 #include <asm/monitor.h>
 #include <asm/vm_event.h>
@@ -39,6 +40,96 @@
 #define vm_event_ring_lock(_ved)       spin_lock(&(_ved)->ring_lock)
 #define vm_event_ring_unlock(_ved)     spin_unlock(&(_ved)->ring_lock)
 
+/* Largest ring a helper may ask for: 16 pages */
+#define VM_EVENT_MAX_RING_ORDER 4
+
+/* Tear down the ring mapping; tolerates a partially set up ring. */
+static void vm_event_ring_unmap(struct vm_event_domain *ved)
+{
+    unsigned int i;
+
+    if ( ved->ring_page )
+    {
+        vunmap(ved->ring_page);
+        ved->ring_page = NULL;
+    }
+
+    if ( !ved->ring_pg_structs )
+        return;
+
+    for ( i = 0; i < ved->nr_ring_pages; i++ )
+        if ( ved->ring_pg_structs[i] )
+            put_page_and_type(ved->ring_pg_structs[i]);
+
+    xfree(ved->ring_pg_structs);
+    ved->ring_pg_structs = NULL;
+    ved->nr_ring_pages = 0;
+}
+
+/*
+ * Map the nr_pages gfns starting at gfn as one virtually contiguous ring.
+ * The multi-page equivalent of prepare_ring_for_helper().
+ */
+static int vm_event_ring_map(struct domain *d, struct vm_event_domain *ved,
+                             unsigned long gfn, unsigned int nr_pages)
+{
+    mfn_t *mfns;
+    unsigned int i;
+    void *va;
+    int rc;
+
+    ved->ring_pg_structs = xzalloc_array(struct page_info *, nr_pages);
+    mfns = xmalloc_array(mfn_t, nr_pages);
+    if ( !ved->ring_pg_structs || !mfns )
+    {
+        rc = -ENOMEM;
+        goto err;
+    }
+    ved->nr_ring_pages = nr_pages;
+
+    for ( i = 0; i < nr_pages; i++ )
+    {
+        p2m_type_t p2mt;
+        struct page_info *page;
+
+        rc = check_get_page_from_gfn(d, _gfn(gfn + i), false, &p2mt, &page);
+        if ( rc )
+        {
+            if ( rc == -EAGAIN )
+                rc = -ENOENT;
+            goto err;
+        }
+
+        if ( !get_page_type(page, PGT_writable_page) )
+        {
+            put_page(page);
+            rc = -EINVAL;
+            goto err;
+        }
+
+        ved->ring_pg_structs[i] = page;
+        mfns[i] = page_to_mfn(page);
+    }
+
+    va = vmap(mfns, nr_pages);
+    if ( !va )
+    {
+        rc = -ENOMEM;
+        goto err;
+    }
+
+    ved->ring_page = va;
+    xfree(mfns);
+
+    return 0;
+
+ err:
+    vm_event_ring_unmap(ved);
+    xfree(mfns);
+
+    return rc;
+}
+
 static int vm_event_enable(
     struct domain *d,
     struct xen_domctl_vm_event_op *vec,
@@ -49,6 +140,12 @@ static int vm_event_enable(
 {
     int rc;
     unsigned long ring_gfn = d->arch.hvm.params[param];
+    unsigned int nr_pages;
+
+    /* The helper picks the ring size at enable time. */
+    if ( vec->ring_order > VM_EVENT_MAX_RING_ORDER )
+        return -EINVAL;
+    nr_pages = 1U << vec->ring_order;
 
     if ( !*ved )
         *ved = xzalloc(struct vm_event_domain);
@@ -74,8 +171,7 @@ static int vm_event_enable(
     if ( rc < 0 )
         goto err;
 
-    rc = prepare_ring_for_helper(d, ring_gfn, &(*ved)->ring_pg_struct,
-                                 &(*ved)->ring_page);
+    rc = vm_event_ring_map(d, *ved, ring_gfn, nr_pages);
     if ( rc < 0 )
         goto err;
 
@@ -93,7 +189,7 @@ static int vm_event_enable(
     /* Prepare ring buffer */
     FRONT_RING_INIT(&(*ved)->front_ring,
                     (vm_event_sring_t *)(*ved)->ring_page,
-                    PAGE_SIZE);
+                    nr_pages * PAGE_SIZE);
 
     /* Save the pause flag for this particular ring. */
     (*ved)->pause_flag = pause_flag;
@@ -105,8 +201,7 @@ static int vm_event_enable(
     return 0;
 
  err:
-    destroy_ring_for_helper(&(*ved)->ring_page,
-                            (*ved)->ring_pg_struct);
+    vm_event_ring_unmap(*ved);
     vm_event_ring_unlock(*ved);
     xfree(*ved);
     *ved = NULL;
@@ -221,8 +316,7 @@ static int vm_event_disable(struct domain *d, struct vm_event_domain **ved)
             }
         }
 
-        destroy_ring_for_helper(&(*ved)->ring_page,
-                                (*ved)->ring_pg_struct);
+        vm_event_ring_unmap(*ved);
 
         vm_event_cleanup_domain(d);
 
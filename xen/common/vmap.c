@@ -1,8 +1,11 @@
 #ifdef VMAP_VIRT_START
 #include <xen/bitmap.h>
 #include <xen/cache.h>
+#include <xen/cpu.h>
 #include <xen/init.h>
 #include <xen/mm.h>
+#include <xen/percpu.h>
+#include <xen/perfc.h>
 #include <xen/pfn.h>
 #include <xen/spinlock.h>
 #include <xen/types.h>
@@ -19,6 +22,31 @@ static unsigned int __read_mostly vm_end[VMAP_REGION_NR];
 /* lowest known clear bit in the bitmap */
 static unsigned int vm_low[VMAP_REGION_NR];
 
+/*
+ * Per-CPU cache of recently freed VMAP_DEFAULT ranges.
+ *
+ * vm_alloc()/vm_free() otherwise serialize on vm_lock, which livepatch
+ * application, xenoprof buffer setup, and large-xmalloc fallbacks hammer
+ * with small short-lived ranges.  A freed range keeps its bitmap bits set
+ * and is parked, already unmapped and flushed, in a per-CPU stack; the
+ * next default-aligned allocation of the same size takes it back without
+ * touching vm_lock.  An overflowing cache is returned to the bitmap in
+ * one batch under a single lock acquisition.  Mapping teardown (and with
+ * it the TLB flush) stays synchronous in vunmap(): the backing pages may
+ * be freed as soon as it returns, so the flush cannot be deferred.
+ */
+#define VMAP_CACHE_DEPTH     8
+#define VMAP_CACHE_MAX_PAGES 8
+
+struct vmap_cache {
+    struct {
+        void *va;
+        unsigned int pages;
+    } ent[VMAP_CACHE_DEPTH];
+    unsigned int nr;
+};
+static DEFINE_PER_CPU(struct vmap_cache, vmap_cache);
+
 void __init vm_init_type(enum vmap_region type, void *start, void *end)
 {
     unsigned int i, nr;
@@ -59,6 +87,25 @@ static void *vm_alloc(unsigned int nr, unsigned int align,
     if ( !vm_base[t] )
         return NULL;
 
+    /* Small default-aligned requests can come from the per-CPU cache. */
+    if ( t == VMAP_DEFAULT && align <= 1 && nr <= VMAP_CACHE_MAX_PAGES )
+    {
+        struct vmap_cache *cache = &this_cpu(vmap_cache);
+        unsigned int i;
+
+        for ( i = 0; i < cache->nr; i++ )
+            if ( cache->ent[i].pages == nr )
+            {
+                void *va = cache->ent[i].va;
+
+                cache->ent[i] = cache->ent[--cache->nr];
+                perfc_incr(vmap_cache_hit);
+                return va;
+            }
+
+        perfc_incr(vmap_cache_miss);
+    }
+
     spin_lock(&vm_lock);
     for ( ; ; )
     {
@@ -169,6 +216,20 @@ static unsigned int vm_size(const void *va, enum vmap_region type)
     return min(end, vm_top[type]) - start;
 }
 
+/* Return a range's bits to the bitmap; caller holds vm_lock. */
+static void vm_free_bits(unsigned int bit, enum vmap_region type)
+{
+    if ( bit < vm_low[type] )
+    {
+        vm_low[type] = bit - 1;
+        while ( !test_bit(vm_low[type] - 1, vm_bitmap(type)) )
+            --vm_low[type];
+    }
+    while ( __test_and_clear_bit(bit, vm_bitmap(type)) )
+        if ( ++bit == vm_top[type] )
+            break;
+}
+
 static void vm_free(const void *va)
 {
     enum vmap_region type = VMAP_DEFAULT;
@@ -187,18 +248,48 @@ static void vm_free(const void *va)
     }
 
     spin_lock(&vm_lock);
-    if ( bit < vm_low[type] )
+    vm_free_bits(bit, type);
+    spin_unlock(&vm_lock);
+}
+
+static void vmap_cache_drain(struct vmap_cache *cache)
+{
+    spin_lock(&vm_lock);
+    while ( cache->nr )
     {
-        vm_low[type] = bit - 1;
-        while ( !test_bit(vm_low[type] - 1, vm_bitmap(type)) )
-            --vm_low[type];
+        const void *va = cache->ent[--cache->nr].va;
+
+        vm_free_bits(PFN_DOWN(va - vm_base[VMAP_DEFAULT]), VMAP_DEFAULT);
     }
-    while ( __test_and_clear_bit(bit, vm_bitmap(type)) )
-        if ( ++bit == vm_top[type] )
-            break;
     spin_unlock(&vm_lock);
 }
 
+static int cpu_vmap_cache_callback(
+    struct notifier_block *nfb, unsigned long action, void *hcpu)
+{
+    unsigned int cpu = (unsigned long)hcpu;
+
+    switch ( action )
+    {
+    case CPU_DEAD:
+        vmap_cache_drain(&per_cpu(vmap_cache, cpu));
+        break;
+    }
+
+    return NOTIFY_DONE;
+}
+
+static struct notifier_block cpu_vmap_cache_nfb = {
+    .notifier_call = cpu_vmap_cache_callback
+};
+
+static int __init vmap_cache_init(void)
+{
+    register_cpu_notifier(&cpu_vmap_cache_nfb);
+    return 0;
+}
+__initcall(vmap_cache_init);
+
 void *__vmap(const mfn_t *mfn, unsigned int granularity,
              unsigned int nr, unsigned int align, unsigned int flags,
              enum vmap_region type)
@@ -226,16 +317,33 @@ void *vmap(const mfn_t *mfn, unsigned int nr)
 void vunmap(const void *va)
 {
     unsigned long addr = (unsigned long)va;
-    unsigned int pages = vm_size(va, VMAP_DEFAULT);
+    enum vmap_region type = VMAP_DEFAULT;
+    unsigned int pages = vm_size(va, type);
 
     if ( !pages )
-        pages = vm_size(va, VMAP_XEN);
+    {
+        type = VMAP_XEN;
+        pages = vm_size(va, type);
+    }
 
 #ifndef _PAGE_NONE
     destroy_xen_mappings(addr, addr + PAGE_SIZE * pages);
 #else /* Avoid tearing down intermediate page tables. */
     map_pages_to_xen(addr, INVALID_MFN, pages, _PAGE_NONE);
 #endif
+
+    /* Park small default-region ranges, now unmapped, in the cache. */
+    if ( type == VMAP_DEFAULT && pages && pages <= VMAP_CACHE_MAX_PAGES )
+    {
+        struct vmap_cache *cache = &this_cpu(vmap_cache);
+
+        if ( cache->nr == VMAP_CACHE_DEPTH )
+            vmap_cache_drain(cache);
+        cache->ent[cache->nr].va = (void *)addr;
+        cache->ent[cache->nr++].pages = pages;
+        return;
+    }
+
     vm_free(va);
 }
 
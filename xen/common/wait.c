@@ -27,6 +27,7 @@
 struct waitqueue_vcpu {
     struct list_head list;
     struct vcpu *vcpu;
+    unsigned long key;
 #ifdef CONFIG_X86
     /*
      * Xen/x86 does not have per-vcpu hypervisor stacks. So we must save the
@@ -102,6 +103,35 @@ void wake_up_nr(struct waitqueue_head *wq, unsigned int nr)
     {
         wqv = list_entry(wq->list.next, struct waitqueue_vcpu, list);
         list_del_init(&wqv->list);
+        perfc_incr(waitqueue_wake);
+        vcpu_unpause(wqv->vcpu);
+        put_domain(wqv->vcpu->domain);
+    }
+
+    spin_unlock(&wq->lock);
+}
+
+void wake_up_key(struct waitqueue_head *wq, unsigned long key,
+                 unsigned int nr)
+{
+    struct waitqueue_vcpu *wqv, *tmp;
+
+    spin_lock(&wq->lock);
+
+    list_for_each_entry_safe ( wqv, tmp, &wq->list, list )
+    {
+        if ( !nr )
+            break;
+
+        if ( (wqv->key != key) && (wqv->key != WAIT_KEY_ANY) )
+        {
+            perfc_incr(waitqueue_key_passed_over);
+            continue;
+        }
+
+        nr--;
+        list_del_init(&wqv->list);
+        perfc_incr(waitqueue_wake);
         vcpu_unpause(wqv->vcpu);
         put_domain(wqv->vcpu->domain);
     }
@@ -230,6 +260,11 @@ void check_wakeup_from_wait(void)
 #endif
 
 void prepare_to_wait(struct waitqueue_head *wq)
+{
+    prepare_to_wait_key(wq, WAIT_KEY_ANY);
+}
+
+void prepare_to_wait_key(struct waitqueue_head *wq, unsigned long key)
 {
     struct vcpu *curr = current;
     struct waitqueue_vcpu *wqv = curr->waitqueue_vcpu;
@@ -239,6 +274,7 @@ void prepare_to_wait(struct waitqueue_head *wq)
 
     ASSERT(list_empty(&wqv->list));
     spin_lock(&wq->lock);
+    wqv->key = key;
     list_add_tail(&wqv->list, &wq->list);
     vcpu_pause_nosync(curr);
     get_knownalive_domain(curr->domain);
@@ -23,9 +23,15 @@
  * Adapted for Xen by Dan Magenheimer (dan.magenheimer@oracle.com)
  */
 
+#include <xen/cpu.h>
+#include <xen/guest_access.h>
+#include <xen/init.h>
 #include <xen/irq.h>
 #include <xen/mm.h>
+#include <xen/percpu.h>
+#include <xen/perfc.h>
 #include <xen/pfn.h>
+#include <public/sysctl.h>
 #include <asm/time.h>
 
 #define MAX_POOL_NAME_LEN       16
@@ -82,6 +88,12 @@ struct bhdr {
      *  bit 1: previous block is free, if set
      */
     u32 size;
+    /*
+     * Allocation site index (xmalloc_sites[]) of a used xmalloc() block.
+     * On 64-bit this occupies what would otherwise be alignment padding,
+     * so it does not change the block layout.
+     */
+    u32 sid;
     /* Free blocks in individual freelists are linked */
     union {
         struct free_ptr free_ptr;
@@ -559,6 +571,188 @@ static void tlsf_init(void)
     BUG_ON(!xenpool);
 }
 
+/*
+ * Per-CPU object caches over the TLSF pool.
+ *
+ * Every xmalloc()/xfree() otherwise serializes on the pool spinlock, and
+ * small fixed-size allocations (event channel buckets, maptrack pages,
+ * list nodes) dominate.  Freed objects of a few popular size classes are
+ * parked in a small per-CPU stack and handed straight back to the next
+ * same-class allocation, bypassing the pool and its lock.  Cached objects
+ * keep their (used) block headers, so the pool's view stays consistent;
+ * misses and frees of other sizes take the regular path.  Hit/miss
+ * figures per class are available as perf counters (xenperf / the perfc
+ * sysctl) for sizing the classes against a workload.
+ */
+
+#define XMALLOC_CACHE_NR_CLASSES 5
+#define XMALLOC_CACHE_DEPTH      16
+
+/* Cacheable block sizes in bytes; multiples of MEM_ALIGN, ascending. */
+static const unsigned int xmalloc_cache_sizes[XMALLOC_CACHE_NR_CLASSES] = {
+    32, 64, 128, 256, 512
+};
+
+struct xmalloc_cache {
+    void *obj[XMALLOC_CACHE_NR_CLASSES][XMALLOC_CACHE_DEPTH];
+    unsigned int nr[XMALLOC_CACHE_NR_CLASSES];
+};
+static DEFINE_PER_CPU(struct xmalloc_cache, xmalloc_cache);
+
+/* Smallest class able to hold @size, or -1. */
+static int xmalloc_cache_class(unsigned long size)
+{
+    unsigned int i;
+
+    for ( i = 0; i < XMALLOC_CACHE_NR_CLASSES; i++ )
+        if ( size <= xmalloc_cache_sizes[i] )
+            return i;
+
+    return -1;
+}
+
+/* Class whose size matches @bs exactly, or -1. */
+static int xmalloc_cache_class_exact(unsigned long bs)
+{
+    unsigned int i;
+
+    for ( i = 0; i < XMALLOC_CACHE_NR_CLASSES; i++ )
+        if ( bs == xmalloc_cache_sizes[i] )
+            return i;
+
+    return -1;
+}
+
+static void xmalloc_cache_drain(unsigned int cpu)
+{
+    struct xmalloc_cache *cache = &per_cpu(xmalloc_cache, cpu);
+    unsigned int i;
+
+    for ( i = 0; i < XMALLOC_CACHE_NR_CLASSES; i++ )
+        while ( cache->nr[i] )
+            xmem_pool_free(cache->obj[i][--cache->nr[i]], xenpool);
+}
+
+static int cpu_xmalloc_cache_callback(
+    struct notifier_block *nfb, unsigned long action, void *hcpu)
+{
+    unsigned int cpu = (unsigned long)hcpu;
+
+    switch ( action )
+    {
+    case CPU_DEAD:
+        xmalloc_cache_drain(cpu);
+        break;
+    }
+
+    return NOTIFY_DONE;
+}
+
+static struct notifier_block cpu_xmalloc_cache_nfb = {
+    .notifier_call = cpu_xmalloc_cache_callback
+};
+
+static int __init xmalloc_cache_init(void)
+{
+    register_cpu_notifier(&cpu_xmalloc_cache_nfb);
+    return 0;
+}
+__initcall(xmalloc_cache_init);
+
+/*
+ * Allocation-site accounting.
+ *
+ * Every xmalloc()/xzalloc() is attributed to its caller address in a
+ * small open-addressed table, so a slowly leaking site can be identified
+ * on a production host (XEN_SYSCTL_memprof, xen-memprof) instead of by
+ * bisection and reboot.  A used block's site index lives in its header
+ * (see struct bhdr), so frees - including parking in and reissue from
+ * the per-CPU caches above - move live bytes between sites without any
+ * per-block space overhead.  Counters are updated with atomic adds;
+ * whole-page allocations have no header to carry the index, so they
+ * only show up in the cumulative figures of their site.  Slot 0 lumps
+ * together whatever does not fit in the table.
+ */
+#define XMALLOC_NR_SITES 128
+
+struct xmalloc_site {
+    unsigned long addr;
+    unsigned long allocs;
+    unsigned long frees;
+    unsigned long bytes;
+    unsigned long live_bytes;
+};
+static struct xmalloc_site xmalloc_sites[XMALLOC_NR_SITES];
+
+static unsigned int xmalloc_site(unsigned long addr)
+{
+    unsigned int n, h = (addr / MEM_ALIGN) % (XMALLOC_NR_SITES - 1) + 1;
+
+    for ( n = 1; n < XMALLOC_NR_SITES; n++ )
+    {
+        unsigned long cur = read_atomic(&xmalloc_sites[h].addr);
+
+        if ( !cur )
+            cur = cmpxchg(&xmalloc_sites[h].addr, 0, addr);
+        if ( !cur || cur == addr )
+            return h;
+        if ( ++h == XMALLOC_NR_SITES )
+            h = 1;
+    }
+
+    return 0;
+}
+
+static void xmalloc_site_alloc(unsigned int sid, unsigned long bytes,
+                               bool live)
+{
+    struct xmalloc_site *s = &xmalloc_sites[sid];
+
+    arch_fetch_and_add(&s->allocs, 1);
+    arch_fetch_and_add(&s->bytes, bytes);
+    if ( live )
+        arch_fetch_and_add(&s->live_bytes, bytes);
+}
+
+static void xmalloc_site_free(unsigned int sid, unsigned long bytes)
+{
+    struct xmalloc_site *s = &xmalloc_sites[sid % XMALLOC_NR_SITES];
+
+    arch_fetch_and_add(&s->frees, 1);
+    arch_fetch_and_add(&s->live_bytes, -bytes);
+}
+
+int xmalloc_memprof_op(struct xen_sysctl_memprof *op)
+{
+    unsigned int i, n = 0;
+
+    op->pool_used = xenpool ? xmem_pool_get_used_size(xenpool) : 0;
+    op->pool_size = xenpool ? xmem_pool_get_total_size(xenpool) : 0;
+
+    for ( i = 0; i < XMALLOC_NR_SITES; i++ )
+    {
+        const struct xmalloc_site *s = &xmalloc_sites[i];
+        xen_memprof_site_t ent = {
+            .addr = s->addr,
+            .allocs = s->allocs,
+            .frees = s->frees,
+            .bytes = s->bytes,
+            .live_bytes = s->live_bytes,
+        };
+
+        if ( !ent.allocs )
+            continue;
+        if ( n >= op->nr_sites )
+            break;
+        if ( copy_to_guest_offset(op->sites, n, &ent, 1) )
+            return -EFAULT;
+        n++;
+    }
+    op->nr_sites = n;
+
+    return 0;
+}
+
 /*
  * xmalloc()
  */
@@ -568,9 +762,12 @@ static void tlsf_init(void)
 #define ZERO_BLOCK_PTR ((void *)-1L)
 #endif
 
-void *_xmalloc(unsigned long size, unsigned long align)
+static void *xmalloc_at(unsigned long size, unsigned long align,
+                        unsigned long caller)
 {
+    unsigned int sid = xmalloc_site(caller);
     void *p = NULL;
+    struct bhdr *b;
     u32 pad;
 
     ASSERT(!in_irq());
@@ -586,17 +783,52 @@ void *_xmalloc(unsigned long size, unsigned long align)
     if ( !xenpool )
         tlsf_init();
 
+    /* Small default-aligned requests can come from the per-CPU cache. */
+    if ( align == MEM_ALIGN )
+    {
+        int cls = xmalloc_cache_class(size);
+
+        if ( cls >= 0 )
+        {
+            struct xmalloc_cache *cache = &this_cpu(xmalloc_cache);
+
+            if ( cache->nr[cls] )
+            {
+                perfc_incra(xmalloc_cache_hit, cls);
+                p = cache->obj[cls][--cache->nr[cls]];
+                b = (struct bhdr *)((char *)p - BHDR_OVERHEAD);
+                b->sid = sid;
+                xmalloc_site_alloc(sid, b->size & BLOCK_SIZE_MASK, true);
+                return p;
+            }
+
+            perfc_incra(xmalloc_cache_miss, cls);
+            /* Canonicalize, so the block can be cached when freed. */
+            size = xmalloc_cache_sizes[cls];
+        }
+    }
+
     if ( size < PAGE_SIZE )
         p = xmem_pool_alloc(size, xenpool);
     if ( p == NULL )
-        return xmalloc_whole_pages(size - align + MEM_ALIGN, align);
+    {
+        p = xmalloc_whole_pages(size - align + MEM_ALIGN, align);
+        if ( p )
+            xmalloc_site_alloc(sid, PFN_UP(size - align + MEM_ALIGN) <<
+                               PAGE_SHIFT, false);
+        return p;
+    }
+
+    b = (struct bhdr *)((char *)p - BHDR_OVERHEAD);
+    b->sid = sid;
+    xmalloc_site_alloc(sid, b->size & BLOCK_SIZE_MASK, true);
 
     /* Add alignment padding. */
     if ( (pad = -(long)p & (align - 1)) != 0 )
     {
         char *q = (char *)p + pad;
-        struct bhdr *b = (struct bhdr *)(q - BHDR_OVERHEAD);
         ASSERT(q > (char *)p);
+        b = (struct bhdr *)(q - BHDR_OVERHEAD);
         b->size = pad | 1;
         p = q;
     }
@@ -605,9 +837,16 @@ void *_xmalloc(unsigned long size, unsigned long align)
     return p;
 }
 
+void *_xmalloc(unsigned long size, unsigned long align)
+{
+    return xmalloc_at(size, align,
+                      (unsigned long)__builtin_return_address(0));
+}
+
 void *_xzalloc(unsigned long size, unsigned long align)
 {
-    void *p = _xmalloc(size, align);
+    void *p = xmalloc_at(size, align,
+                         (unsigned long)__builtin_return_address(0));
 
     return p ? memset(p, 0, size) : p;
 }
@@ -615,6 +854,7 @@ void *_xzalloc(unsigned long size, unsigned long align)
 void xfree(void *p)
 {
     struct bhdr *b;
+    int cls;
 
     if ( p == NULL || p == ZERO_BLOCK_PTR )
         return;
@@ -648,5 +888,20 @@ void xfree(void *p)
         ASSERT(!(b->size & 1));
     }
 
+    xmalloc_site_free(b->sid, b->size & BLOCK_SIZE_MASK);
+
+    /* Park exact-sized blocks of a popular class in the per-CPU cache. */
+    cls = xmalloc_cache_class_exact(b->size & BLOCK_SIZE_MASK);
+    if ( cls >= 0 )
+    {
+        struct xmalloc_cache *cache = &this_cpu(xmalloc_cache);
+
+        if ( cache->nr[cls] < XMALLOC_CACHE_DEPTH )
+        {
+            cache->obj[cls][cache->nr[cls]++] = p;
+            return;
+        }
+    }
+
     xmem_pool_free(p, xenpool);
 }
@@ -36,6 +36,10 @@
 #include <xen/percpu.h>
 #include <xen/domain.h>
 #include <xen/acpi.h>
+#include <xen/cpuidle.h>
+#include <xen/mm.h>
+#include <xen/pfn.h>
+#include <xen/timer.h>
 
 #include <public/sysctl.h>
 #include <acpi/cpufreq/cpufreq.h>
@@ -43,6 +47,130 @@
 
 DEFINE_PER_CPU_READ_MOSTLY(struct pm_px *, cpufreq_statistic_data);
 
+/* Cx/Px residency telemetry, pushed into dom0-visible shared pages. */
+#define TELEMETRY_DEFAULT_PERIOD_MS 1000
+#define TELEMETRY_MIN_PERIOD_MS     100
+
+static struct pm_telemetry_rec *telemetry_recs;
+static unsigned int telemetry_nr_pages;
+static bool telemetry_active;
+static unsigned int telemetry_period_ms;
+static DEFINE_PER_CPU(struct timer, telemetry_timer);
+
+static void pm_fill_telemetry_rec(unsigned int cpu,
+                                  struct pm_telemetry_rec *rec)
+{
+    const struct processor_pminfo *pmpt = processor_pminfo[cpu];
+    struct pm_px *pxpt;
+    spinlock_t *cpufreq_statistic_lock =
+               &per_cpu(cpufreq_statistic_lock, cpu);
+
+    rec->timestamp = NOW();
+    rec->idle_time = get_cpu_idle_time(cpu);
+    rec->last_cx = pmstat_get_last_cx(cpu);
+    rec->cur_px = ~0;
+    memset(rec->px_residency, 0, sizeof(rec->px_residency));
+
+    spin_lock(cpufreq_statistic_lock);
+
+    pxpt = per_cpu(cpufreq_statistic_data, cpu);
+    if ( pxpt && pxpt->u.pt && pmpt )
+    {
+        unsigned int i, ct = min_t(unsigned int, pmpt->perf.state_count,
+                                   XEN_PM_PX_MAX);
+
+        cpufreq_residency_update(cpu, pxpt->u.cur);
+        rec->cur_px = pxpt->u.cur;
+        for ( i = 0; i < ct; i++ )
+            rec->px_residency[i] = pxpt->u.pt[i].residency;
+    }
+
+    spin_unlock(cpufreq_statistic_lock);
+}
+
+static void telemetry_timer_fn(void *data)
+{
+    unsigned int cpu = (unsigned long)data;
+    struct pm_telemetry_rec *rec = &telemetry_recs[cpu];
+
+    /* Timers get migrated when a CPU goes down; don't publish stale data. */
+    if ( !telemetry_active || cpu != smp_processor_id() )
+        return;
+
+    rec->seq++;
+    smp_wmb();
+    pm_fill_telemetry_rec(cpu, rec);
+    smp_wmb();
+    rec->seq++;
+
+    set_timer(&this_cpu(telemetry_timer),
+              NOW() + MILLISECS(telemetry_period_ms));
+}
+
+static int pm_telemetry_enable(struct pm_telemetry_op *telem)
+{
+    unsigned int cpu;
+
+    if ( telemetry_active )
+        return -EBUSY;
+
+    if ( telem->period_ms &&
+         telem->period_ms < TELEMETRY_MIN_PERIOD_MS )
+        return -EINVAL;
+
+    if ( !telemetry_recs )
+    {
+        unsigned int i, nr_pages =
+            PFN_UP(nr_cpu_ids * sizeof(*telemetry_recs));
+        void *p = alloc_xenheap_pages(get_order_from_pages(nr_pages), 0);
+
+        if ( !p )
+            return -ENOMEM;
+
+        memset(p, 0, nr_pages << PAGE_SHIFT);
+
+        /*
+         * Once handed out the pages stay shared with dom0 forever; on
+         * disable they are merely left idle, never freed.
+         */
+        for ( i = 0; i < nr_pages; i++ )
+            share_xen_page_with_privileged_guests(
+                virt_to_page(p + i * PAGE_SIZE), SHARE_ro);
+
+        telemetry_recs = p;
+        telemetry_nr_pages = nr_pages;
+    }
+
+    telemetry_period_ms = telem->period_ms ?: TELEMETRY_DEFAULT_PERIOD_MS;
+    telemetry_active = true;
+
+    for_each_online_cpu ( cpu )
+    {
+        struct timer *t = &per_cpu(telemetry_timer, cpu);
+
+        init_timer(t, telemetry_timer_fn, (void *)(unsigned long)cpu, cpu);
+        set_timer(t, NOW() + MILLISECS(telemetry_period_ms));
+    }
+
+    telem->mfn = virt_to_mfn(telemetry_recs);
+    telem->nr = telemetry_nr_pages;
+
+    return 0;
+}
+
+static void pm_telemetry_disable(void)
+{
+    unsigned int cpu;
+
+    if ( !telemetry_active )
+        return;
+
+    telemetry_active = false;
+
+    for_each_online_cpu ( cpu )
+        kill_timer(&per_cpu(telemetry_timer, cpu));
+}
+
 /*
  * Get PM statistic info
  */
@@ -69,6 +197,8 @@ int do_get_pm_info(struct xen_sysctl_get_pmstat *op)
         if ( !pmpt || !(pmpt->perf.init & XEN_PX_INIT) )
             return -EINVAL;
         break;
+    case PMSTAT_TELEM:
+        break;
     default:
         return -ENODEV;
     }
@@ -151,6 +281,39 @@ int do_get_pm_info(struct xen_sysctl_get_pmstat *op)
         break;
     }
 
+    case PMSTAT_get_summary:
+    {
+        unsigned int cpu, nr = 0;
+
+        /* Slots of offline CPUs are left untouched. */
+        for_each_online_cpu ( cpu )
+        {
+            struct pm_telemetry_rec rec = { .seq = 0 };
+
+            if ( cpu >= op->u.telem.nr )
+                break;
+
+            pm_fill_telemetry_rec(cpu, &rec);
+            if ( copy_to_guest_offset(op->u.telem.summaries, cpu, &rec, 1) )
+                return -EFAULT;
+            nr = cpu + 1;
+        }
+        op->u.telem.nr = nr;
+        break;
+    }
+
+    case PMSTAT_telem_enable:
+    {
+        ret = pm_telemetry_enable(&op->u.telem);
+        break;
+    }
+
+    case PMSTAT_telem_disable:
+    {
+        pm_telemetry_disable();
+        break;
+    }
+
     default:
         printk("not defined sub-hypercall @ do_get_pm_info\n");
         ret = -ENOSYS;
@@ -473,6 +636,18 @@ int do_pm_op(struct xen_sysctl_pm_op *op)
         break;
     }
 
+    case XEN_SYSCTL_pm_op_set_hwp_epp:
+    {
+        ret = hwp_set_epp(op->cpuid, op->u.set_hwp_epp);
+        break;
+    }
+
+    case XEN_SYSCTL_pm_op_set_cpu_max_cstate:
+    {
+        ret = cpuidle_set_max_cstate(op->cpuid, op->u.set_cpu_max_cstate);
+        break;
+    }
+
     default:
         printk("not defined sub-hypercall @ do_pm_op\n");
         ret = -ENOSYS;
@@ -29,6 +29,7 @@
 #include <asm/div64.h>
 #include <xen/hypercall.h> /* for do_console_io */
 #include <xen/early_printk.h>
+#include <xen/dlog.h>
 #include <xen/warning.h>
 #include <xen/pv_console.h>
 #include <asm/setup.h>
@@ -524,6 +525,87 @@ static inline void xen_console_write_debug_port(const char *buf, size_t len)
 }
 #endif
 
+/*
+ * Guest console output is staged per domain and printed from a tasklet, so
+ * that a guest spamming its console contends for the global console lock
+ * with Xen's own printk() only in bounded, per-line chunks at tasklet
+ * priority.  Lines which don't fit in the staging buffer are dropped and
+ * accounted to the domain.
+ */
+static LIST_HEAD(guest_console_flush_list);
+static DEFINE_SPINLOCK(guest_console_flush_lock);
+
+static void guest_console_flush(unsigned long unused)
+{
+    static char buf[DOMAIN_CBUF_SIZE + 1];
+
+    for ( ; ; )
+    {
+        struct domain *d;
+        unsigned int len;
+
+        spin_lock(&guest_console_flush_lock);
+        if ( list_empty(&guest_console_flush_list) )
+        {
+            spin_unlock(&guest_console_flush_lock);
+            break;
+        }
+        d = list_first_entry(&guest_console_flush_list, struct domain,
+                             cbuf_list);
+        list_del_init(&d->cbuf_list);
+        spin_unlock(&guest_console_flush_lock);
+
+        spin_lock(&d->pbuf_lock);
+        len = d->cbuf_idx;
+        memcpy(buf, d->cbuf, len);
+        buf[len] = '\0';
+        d->cbuf_idx = 0;
+        spin_unlock(&d->pbuf_lock);
+
+        if ( len )
+            guest_printk(d, "%s", buf);
+
+        put_domain(d);
+    }
+}
+static DECLARE_SOFTIRQ_TASKLET(guest_console_flush_tasklet,
+                               guest_console_flush, 0);
+
+/* Stage one complete line (s1 followed by s2); pbuf_lock held. */
+static void guest_console_stage(struct domain *d, const char *s1,
+                                const char *s2)
+{
+    static const char prefix[] = XENLOG_G_DEBUG;
+    unsigned int len1 = strlen(s1), len2 = strlen(s2);
+    unsigned int len = (sizeof(prefix) - 1) + len1 + len2 + 1;
+
+    ASSERT(spin_is_locked(&d->pbuf_lock));
+
+    if ( len > DOMAIN_CBUF_SIZE - d->cbuf_idx )
+    {
+        d->cbuf_dropped += len;
+        return;
+    }
+
+    memcpy(d->cbuf + d->cbuf_idx, prefix, sizeof(prefix) - 1);
+    d->cbuf_idx += sizeof(prefix) - 1;
+    memcpy(d->cbuf + d->cbuf_idx, s1, len1);
+    d->cbuf_idx += len1;
+    memcpy(d->cbuf + d->cbuf_idx, s2, len2);
+    d->cbuf_idx += len2;
+    d->cbuf[d->cbuf_idx++] = '\n';
+
+    spin_lock(&guest_console_flush_lock);
+    if ( list_empty(&d->cbuf_list) )
+    {
+        get_knownalive_domain(d);
+        list_add_tail(&d->cbuf_list, &guest_console_flush_list);
+    }
+    spin_unlock(&guest_console_flush_lock);
+
+    tasklet_schedule(&guest_console_flush_tasklet);
+}
+
 static long guest_console_write(XEN_GUEST_HANDLE_PARAM(char) buffer, int count)
 {
     char kbuf[128];
@@ -589,7 +671,7 @@ static long guest_console_write(XEN_GUEST_HANDLE_PARAM(char) buffer, int count)
             {
                 kcount = kin - kbuf;
                 cd->pbuf[cd->pbuf_idx] = '\0';
-                guest_printk(cd, XENLOG_G_DEBUG "%s%s\n", cd->pbuf, kbuf);
+                guest_console_stage(cd, cd->pbuf, kbuf);
                 cd->pbuf_idx = 0;
             }
             else if ( cd->pbuf_idx + kcount < (DOMAIN_PBUF_SIZE - 1) )
@@ -601,7 +683,7 @@ static long guest_console_write(XEN_GUEST_HANDLE_PARAM(char) buffer, int count)
             else
             {
                 cd->pbuf[cd->pbuf_idx] = '\0';
-                guest_printk(cd, XENLOG_G_DEBUG "%s%s\n", cd->pbuf, kbuf);
+                guest_console_stage(cd, cd->pbuf, kbuf);
                 cd->pbuf_idx = 0;
             }
             spin_unlock(&cd->pbuf_lock);
@@ -1136,6 +1218,8 @@ int __printk_ratelimit(int ratelimit_ms, int ratelimit_burst)
         return 1;
     }
     missed++;
+    /* The console sees nothing; leave a record in the diagnostics ring. */
+    DLOG1(XEN_DLOG_CONSOLE_SUPPRESSED, missed);
     spin_unlock_irqrestore(&ratelimit_lock, flags);
     return 0;
 }
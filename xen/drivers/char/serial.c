@@ -157,19 +157,16 @@ static void __serial_putc(struct serial_port *port, char c)
             return;
         }
 
-        if ( ((port->txbufp - port->txbufc) == 0) &&
-             port->driver->tx_ready(port) > 0 )
-        {
-            /* Enable TX before sending chars */
+        /*
+         * Normal case: buffer the character and leave draining the UART
+         * entirely to the TX interrupt / poll timer, so producers never
+         * touch (slow) UART registers.  Kick the transmitter when going
+         * non-empty: on interrupt-driven ports enabling TX with an empty
+         * holding register raises the interrupt immediately.
+         */
+        if ( port->txbufp == port->txbufc )
             serial_start_tx(port);
-            /* Buffer and UART FIFO are both empty, and port is available. */
-            port->driver->putc(port, c);
-        }
-        else
-        {
-            /* Normal case: buffer the character. */
-            port->txbuf[mask_serial_txbuf_idx(port->txbufp++)] = c;
-        }
+        port->txbuf[mask_serial_txbuf_idx(port->txbufp++)] = c;
     }
     else if ( port->driver->tx_ready )
     {
@@ -217,7 +214,8 @@ void serial_putc(int handle, char c)
 
     __serial_putc(port, c);
 
-    if ( port->driver->flush )
+    /* Characters were pushed to the UART only if transmitting directly. */
+    if ( (port->sync || port->txbuf == NULL) && port->driver->flush )
         port->driver->flush(port);
 
     spin_unlock_irqrestore(&port->tx_lock, flags);
@@ -251,7 +249,8 @@ void serial_puts(int handle, const char *s)
         __serial_putc(port, c);
     }
 
-    if ( port->driver->flush )
+    /* Characters were pushed to the UART only if transmitting directly. */
+    if ( (port->sync || port->txbuf == NULL) && port->driver->flush )
         port->driver->flush(port);
 
     spin_unlock_irqrestore(&port->tx_lock, flags);
@@ -495,6 +495,27 @@ int iommu_iotlb_flush_all(struct domain *d, unsigned int flush_flags)
     return rc;
 }
 
+int iommu_sync_dirty_log(struct domain *d)
+{
+    const struct domain_iommu *hd = dom_iommu(d);
+    int rc;
+
+    if ( !iommu_enabled || !hd->platform_ops ||
+         !hd->platform_ops->sync_dirty_log )
+        return 0;
+
+    rc = hd->platform_ops->sync_dirty_log(d);
+    if ( unlikely(rc) )
+    {
+        if ( !d->is_shutting_down && printk_ratelimit() )
+            printk(XENLOG_ERR
+                   "d%d: IOMMU dirty log sync failed: %d\n",
+                   d->domain_id, rc);
+    }
+
+    return rc;
+}
+
 int __init iommu_setup(void)
 {
     int rc = -ENODEV;
@@ -890,7 +890,7 @@ static int pci_clean_dpci_irqs(struct domain *d)
     if ( !is_hvm_domain(d) )
         return 0;
 
-    spin_lock(&d->event_lock);
+    write_lock(&d->event_lock);
     hvm_irq_dpci = domain_get_irq_dpci(d);
     if ( hvm_irq_dpci != NULL )
     {
@@ -898,14 +898,14 @@ static int pci_clean_dpci_irqs(struct domain *d)
 
         if ( ret )
         {
-            spin_unlock(&d->event_lock);
+            write_unlock(&d->event_lock);
             return ret;
         }
 
         hvm_domain_irq(d)->dpci = NULL;
         free_hvm_irq_dpci(hvm_irq_dpci);
     }
-    spin_unlock(&d->event_lock);
+    write_unlock(&d->event_lock);
     return 0;
 }
 
@@ -1054,6 +1054,61 @@ void pci_check_disable_device(u16 seg, u8 bus, u8 devfn)
                      PCI_COMMAND, cword & ~PCI_COMMAND_MASTER);
 }
 
+/*
+ * Record an IOMMU fault against the offending device, and decide
+ * whether it should still be logged individually. Logging is throttled
+ * per device so that a misprogrammed device cannot drown the console;
+ * accounting carries on while quiet and the recent records remain
+ * visible via the 'Q' debug key. Logging resumes after a window with
+ * no faults from the device.
+ */
+#define PT_FAULT_LOG_LIMIT 8
+
+bool pci_record_fault(u16 seg, u8 bus, u8 devfn, u8 type, u8 reason,
+                      u64 addr)
+{
+    struct pci_dev *pdev;
+    s_time_t now = NOW();
+    bool log = true;
+
+    pcidevs_lock();
+    pdev = pci_get_real_pdev(seg, bus, devfn);
+    if ( pdev )
+    {
+        unsigned int i = pdev->fault.idx;
+
+        pdev->fault.total++;
+        pdev->fault.recent[i].time = now;
+        pdev->fault.recent[i].addr = addr;
+        pdev->fault.recent[i].reason = reason;
+        pdev->fault.recent[i].type = type;
+        pdev->fault.idx = (i + 1) % ARRAY_SIZE(pdev->fault.recent);
+
+        if ( now < pdev->fault.log_time ||
+             now - pdev->fault.log_time > SECONDS(1) )
+        {
+            pdev->fault.logged = 0;
+            pdev->fault.quiet = false;
+        }
+        pdev->fault.log_time = now;
+
+        if ( ++pdev->fault.logged > PT_FAULT_LOG_LIMIT )
+        {
+            if ( !pdev->fault.quiet )
+            {
+                pdev->fault.quiet = true;
+                printk(XENLOG_G_WARNING
+                       "%04x:%02x:%02x.%u: fault rate too high, suppressing further fault messages\n",
+                       seg, bus, PCI_SLOT(devfn), PCI_FUNC(devfn));
+            }
+            log = false;
+        }
+    }
+    pcidevs_unlock();
+
+    return log;
+}
+
 /*
  * scan pci devices to add all existed PCI devices to alldevs_list,
  * and setup pci hierarchy in array bus2bridge.
@@ -1313,6 +1368,27 @@ static int _dump_pci_devices(struct pci_seg *pseg, void *arg)
         list_for_each_entry ( msi, &pdev->msi_list, list )
                printk("%d ", msi->irq);
         printk(">\n");
+        if ( pdev->fault.total )
+        {
+            unsigned int i;
+
+            printk("      iommu faults: %"PRIu64" total%s\n",
+                   pdev->fault.total,
+                   pdev->fault.quiet ? " (logging suppressed)" : "");
+            for ( i = 0; i < ARRAY_SIZE(pdev->fault.recent); i++ )
+            {
+                unsigned int j = (pdev->fault.idx + i) %
+                                 ARRAY_SIZE(pdev->fault.recent);
+
+                if ( !pdev->fault.recent[j].time )
+                    continue;
+                printk("        t=%"PRI_stime" type %u reason %02x addr %016"PRIx64"\n",
+                       pdev->fault.recent[j].time,
+                       pdev->fault.recent[j].type,
+                       pdev->fault.recent[j].reason,
+                       pdev->fault.recent[j].addr);
+            }
+        }
     }
 
     return 0;
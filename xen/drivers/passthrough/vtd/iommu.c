@@ -34,6 +34,7 @@
 #include <asm/irq.h>
 #include <asm/hvm/vmx/vmx.h>
 #include <asm/p2m.h>
+#include <asm/paging.h>
 #include <mach_apic.h>
 #include "iommu.h"
 #include "dmar.h"
@@ -249,7 +250,46 @@ static u64 bus_to_context_maddr(struct iommu *iommu, u8 bus)
     return maddr;
 }
 
-static u64 addr_to_dma_page_maddr(struct domain *domain, u64 addr, int alloc)
+/* Largest leaf level supported by all IOMMUs: 1 = 4k, 2 = 2M, 3 = 1G. */
+static unsigned int __read_mostly vtd_sp_level = 3;
+
+/* Second-level Accessed/Dirty bits supported by all IOMMUs. */
+static bool_t __read_mostly iommu_slads = 1;
+
+/*
+ * Count the leaf mappings below a page table out of the per-domain stats,
+ * ahead of the table being freed or replaced by a larger leaf.
+ */
+static void discount_subtree(struct domain_iommu *hd, u64 pt_maddr,
+                             unsigned int level)
+{
+    struct dma_pte *pt = map_vtd_domain_page(pt_maddr);
+    unsigned int i;
+
+    for ( i = 0; i < PTE_NUM; i++ )
+    {
+        if ( !dma_pte_present(pt[i]) )
+            continue;
+
+        if ( level == 1 || dma_pte_superpage(pt[i]) )
+            hd->arch.leaf_mappings[level]--;
+        else
+            discount_subtree(hd, dma_pte_addr(pt[i]), level - 1);
+    }
+
+    unmap_vtd_domain_page(pt);
+}
+
+/*
+ * Return the page table (at least) containing the entry mapping addr at
+ * level target.  Superpages installed above the target level get shattered
+ * into next-level entries so the walk can continue, which is noted via
+ * flush_flags; callers unable to flush (lookups) must pass NULL and have
+ * the walk fail instead.
+ */
+static u64 addr_to_dma_page_maddr(struct domain *domain, u64 addr,
+                                  unsigned int target, int alloc,
+                                  unsigned int *flush_flags)
 {
     struct acpi_drhd_unit *drhd;
     struct pci_dev *pdev;
@@ -262,6 +302,7 @@ static u64 addr_to_dma_page_maddr(struct domain *domain, u64 addr, int alloc)
 
     addr &= (((u64)1) << addr_width) - 1;
     ASSERT(spin_is_locked(&hd->arch.mapping_lock));
+    ASSERT(target >= 1 && (int)target < level);
     if ( hd->arch.pgd_maddr == 0 )
     {
         /*
@@ -275,13 +316,58 @@ static u64 addr_to_dma_page_maddr(struct domain *domain, u64 addr, int alloc)
     }
 
     parent = (struct dma_pte *)map_vtd_domain_page(hd->arch.pgd_maddr);
-    while ( level > 1 )
+    while ( level > (int)target )
     {
         offset = address_level_offset(addr, level);
         pte = &parent[offset];
 
         pte_maddr = dma_pte_addr(*pte);
-        if ( !pte_maddr )
+        if ( dma_pte_present(*pte) && dma_pte_superpage(*pte) )
+        {
+            struct dma_pte *new_table, sp = *pte, new = {};
+            unsigned int i;
+
+            if ( !flush_flags )
+            {
+                pte_maddr = 0;
+                break;
+            }
+
+            pdev = pci_get_pdev_by_domain(domain, -1, -1, -1);
+            drhd = acpi_find_matched_drhd_unit(pdev);
+            pte_maddr = alloc_pgtable_maddr(drhd, 1);
+            if ( !pte_maddr )
+                break;
+
+            /* Shatter the superpage into next-level entries. */
+            new_table = map_vtd_domain_page(pte_maddr);
+            for ( i = 0; i < PTE_NUM; i++ )
+            {
+                new_table[i] = sp;
+                new_table[i].val += (u64)i << level_to_offset_bits(level - 1);
+                if ( level - 1 == 1 )
+                    new_table[i].val &= ~DMA_PTE_SP;
+            }
+            iommu_flush_cache_page(new_table, 1);
+            unmap_vtd_domain_page(new_table);
+
+            /*
+             * DMA through the superpage may be in flight: compose the
+             * replacement entry locally and install it with a single
+             * 64-bit write, so a concurrent hardware walk never sees a
+             * non-present or partially formed entry.
+             */
+            dma_set_pte_addr(new, pte_maddr);
+            dma_set_pte_readable(new);
+            dma_set_pte_writable(new);
+            write_atomic(&pte->val, new.val);
+            iommu_flush_cache_entry(pte, sizeof(struct dma_pte));
+            *flush_flags |= IOMMU_FLUSHF_modified;
+
+            hd->arch.leaf_mappings[level]--;
+            hd->arch.leaf_mappings[level - 1] += PTE_NUM;
+        }
+        else if ( !pte_maddr )
         {
             if ( !alloc )
                 break;
@@ -303,7 +389,7 @@ static u64 addr_to_dma_page_maddr(struct domain *domain, u64 addr, int alloc)
             iommu_flush_cache_entry(pte, sizeof(struct dma_pte));
         }
 
-        if ( level == 2 )
+        if ( level == (int)target + 1 )
             break;
 
         unmap_vtd_domain_page(parent);
@@ -659,7 +745,7 @@ static int __must_check dma_pte_clear_one(struct domain *domain, u64 addr,
 
     spin_lock(&hd->arch.mapping_lock);
     /* get last level pte */
-    pg_maddr = addr_to_dma_page_maddr(domain, addr, 0);
+    pg_maddr = addr_to_dma_page_maddr(domain, addr, 1, 0, flush_flags);
     if ( pg_maddr == 0 )
     {
         spin_unlock(&hd->arch.mapping_lock);
@@ -678,6 +764,7 @@ static int __must_check dma_pte_clear_one(struct domain *domain, u64 addr,
 
     dma_clear_pte(*pte);
     *flush_flags |= IOMMU_FLUSHF_modified;
+    hd->arch.leaf_mappings[1]--;
 
     spin_unlock(&hd->arch.mapping_lock);
     iommu_flush_cache_entry(pte, sizeof(struct dma_pte));
@@ -877,6 +964,14 @@ static int iommu_page_fault_do_one(struct iommu *iommu, int type,
     enum faulttype fault_type;
     u16 seg = iommu->intel->drhd->segment;
 
+    /*
+     * Always account the fault against the device; skip the console
+     * output once the device's per-fault logging has been suppressed.
+     */
+    if ( !pci_record_fault(seg, PCI_BUS(source_id), PCI_DEVFN2(source_id),
+                           type, fault_reason, addr) )
+        return 0;
+
     reason = iommu_get_fault_reason(fault_reason, &fault_type);
     switch ( fault_type )
     {
@@ -935,6 +1030,60 @@ static void iommu_fault_status(u32 fault_status)
         INTEL_IOMMU_DEBUG("iommu_fault_status: Invalidation Time-out Error\n");
 }
 
+/*
+ * A device in a fault storm raises a continuous stream of fault
+ * interrupts and can otherwise pin a CPU in fault processing. Once too
+ * many fault records have been handled within the window, leave the
+ * fault interrupt masked and let the timer re-enable it; the hardware
+ * keeps latching faults meanwhile, and any still pending at unmask
+ * time re-raise the interrupt.
+ */
+#define VTD_FAULT_BURST  64
+#define VTD_FAULT_WINDOW SECONDS(1)
+
+static void vtd_fault_unmask(void *data)
+{
+    struct iommu *iommu = data;
+    unsigned long flags;
+    u32 sts;
+
+    /* Don't override an interrupt the irq core masked itself. */
+    if ( iommu->msi.msi_attrib.host_masked )
+        return;
+
+    spin_lock_irqsave(&iommu->register_lock, flags);
+    sts = dmar_readl(iommu->reg, DMAR_FECTL_REG);
+    dmar_writel(iommu->reg, DMAR_FECTL_REG, sts & ~DMA_FECTL_IM);
+    spin_unlock_irqrestore(&iommu->register_lock, flags);
+}
+
+static void vtd_fault_throttle(struct iommu *iommu)
+{
+    s_time_t now = NOW();
+    unsigned long flags;
+    u32 sts;
+
+    if ( now - iommu->fault_window > VTD_FAULT_WINDOW )
+    {
+        iommu->fault_window = now;
+        iommu->fault_cnt = 0;
+    }
+
+    if ( ++iommu->fault_cnt != VTD_FAULT_BURST )
+        return;
+
+    printk(XENLOG_WARNING VTDPREFIX
+           "fault storm detected, masking fault interrupt (iommu reg = %p)\n",
+           iommu->reg);
+
+    spin_lock_irqsave(&iommu->register_lock, flags);
+    sts = dmar_readl(iommu->reg, DMAR_FECTL_REG);
+    dmar_writel(iommu->reg, DMAR_FECTL_REG, sts | DMA_FECTL_IM);
+    spin_unlock_irqrestore(&iommu->register_lock, flags);
+
+    set_timer(&iommu->fault_unmask_timer, now + VTD_FAULT_WINDOW);
+}
+
 #define PRIMARY_FAULT_REG_LEN (16)
 static void __do_iommu_page_fault(struct iommu *iommu)
 {
@@ -991,6 +1140,8 @@ static void __do_iommu_page_fault(struct iommu *iommu)
         pci_check_disable_device(iommu->intel->drhd->segment,
                                  PCI_BUS(source_id), PCI_DEVFN2(source_id));
 
+        vtd_fault_throttle(iommu);
+
         fault_index++;
         if ( fault_index > cap_num_fault_regs(iommu->cap) )
             fault_index = 0;
@@ -1184,6 +1335,7 @@ int __init iommu_alloc(struct acpi_drhd_unit *drhd)
 
     iommu->msi.irq = -1; /* No irq assigned yet. */
     INIT_LIST_HEAD(&iommu->ats_devices);
+    init_timer(&iommu->fault_unmask_timer, vtd_fault_unmask, iommu, 0);
 
     iommu->intel = alloc_intel_iommu();
     if ( iommu->intel == NULL )
@@ -1270,6 +1422,8 @@ void __init iommu_free(struct acpi_drhd_unit *drhd)
     if ( iommu == NULL )
         return;
 
+    kill_timer(&iommu->fault_unmask_timer);
+
     drhd->iommu = NULL;
 
     if ( iommu->root_maddr != 0 )
@@ -1403,7 +1557,7 @@ int domain_context_mapping_one(
         /* Ensure we have pagetables allocated down to leaf PTE. */
         if ( hd->arch.pgd_maddr == 0 )
         {
-            addr_to_dma_page_maddr(domain, 0, 1);
+            addr_to_dma_page_maddr(domain, 0, 1, 1, NULL);
             if ( hd->arch.pgd_maddr == 0 )
             {
             nomem:
@@ -1773,6 +1927,7 @@ static void iommu_domain_teardown(struct domain *d)
     spin_lock(&hd->arch.mapping_lock);
     iommu_free_pagetable(hd->arch.pgd_maddr, agaw_to_level(hd->arch.agaw));
     hd->arch.pgd_maddr = 0;
+    memset(hd->arch.leaf_mappings, 0, sizeof(hd->arch.leaf_mappings));
     spin_unlock(&hd->arch.mapping_lock);
 }
 
@@ -1795,7 +1950,8 @@ static int __must_check intel_iommu_map_page(struct domain *d, dfn_t dfn,
 
     spin_lock(&hd->arch.mapping_lock);
 
-    pg_maddr = addr_to_dma_page_maddr(d, dfn_to_daddr(dfn), 1);
+    pg_maddr = addr_to_dma_page_maddr(d, dfn_to_daddr(dfn), 1, 1,
+                                      flush_flags);
     if ( !pg_maddr )
     {
         spin_unlock(&hd->arch.mapping_lock);
@@ -1823,6 +1979,8 @@ static int __must_check intel_iommu_map_page(struct domain *d, dfn_t dfn,
     }
 
     *pte = new;
+    if ( !dma_pte_present(old) )
+        hd->arch.leaf_mappings[1]++;
 
     iommu_flush_cache_entry(pte, sizeof(struct dma_pte));
     spin_unlock(&hd->arch.mapping_lock);
@@ -1835,6 +1993,153 @@ static int __must_check intel_iommu_map_page(struct domain *d, dfn_t dfn,
     return rc;
 }
 
+/*
+ * Pick the leaf level for a (1 << order) range at dfn/mfn: the largest
+ * hardware-supported superpage level (bounded by max) which alignment and
+ * size allow, or 1 for 4k mappings.
+ */
+static unsigned int mapping_level(const struct domain_iommu *hd,
+                                  dfn_t dfn, mfn_t mfn, unsigned int order,
+                                  unsigned int max)
+{
+    unsigned int level = 1;
+
+    max = min(max, agaw_to_level(hd->arch.agaw) - 1U);
+    while ( level < max && order >= level * LEVEL_STRIDE &&
+            IS_ALIGNED(dfn_x(dfn) | mfn_x(mfn),
+                       1ul << (level * LEVEL_STRIDE)) )
+        level++;
+
+    return level;
+}
+
+/*
+ * Map a run of (1 << page_order) contiguous pages.  Unlike the single page
+ * handler above this walks the page table only once per leaf table, writing
+ * all PTEs sharing it under a single acquisition of the mapping lock with
+ * one cache flush per modified range, and installs superpage PTEs where
+ * the caller's order, the alignment and the hardware allow.  The IOTLB
+ * flush remains deferred to the caller via flush_flags.
+ */
+static int __must_check intel_iommu_map_pages(struct domain *d, dfn_t dfn,
+                                              mfn_t mfn,
+                                              unsigned int page_order,
+                                              unsigned int flags,
+                                              unsigned int *flush_flags)
+{
+    struct domain_iommu *hd = dom_iommu(d);
+    unsigned long i, nr = 1ul << page_order;
+    unsigned int level, step;
+    int rc = 0;
+    PAGE_LIST_HEAD(freed_pts);
+
+    /* Do nothing if VT-d shares EPT page table */
+    if ( iommu_use_hap_pt(d) )
+        return 0;
+
+    /* Do nothing if hardware domain and iommu supports pass thru. */
+    if ( iommu_hwdom_passthrough && is_hardware_domain(d) )
+        return 0;
+
+    level = mapping_level(hd, dfn, mfn, page_order, vtd_sp_level);
+    step = 1u << ((level - 1) * LEVEL_STRIDE);
+
+    for ( i = 0; i < nr; )
+    {
+        struct dma_pte *page, *pte, *first = NULL;
+        unsigned int idx;
+        u64 pg_maddr;
+
+        spin_lock(&hd->arch.mapping_lock);
+
+        pg_maddr = addr_to_dma_page_maddr(d, dfn_to_daddr(dfn_add(dfn, i)),
+                                          level, 1, flush_flags);
+        if ( !pg_maddr )
+        {
+            spin_unlock(&hd->arch.mapping_lock);
+            rc = -ENOMEM;
+            break;
+        }
+
+        page = (struct dma_pte *)map_vtd_domain_page(pg_maddr);
+
+        for ( idx = address_level_offset(dfn_to_daddr(dfn_add(dfn, i)), level);
+              idx < PTE_NUM && i < nr; idx++, i += step )
+        {
+            struct dma_pte old, new = {};
+
+            pte = &page[idx];
+            old = *pte;
+
+            dma_set_pte_addr(new, mfn_to_maddr(mfn_add(mfn, i)));
+            dma_set_pte_prot(new,
+                             ((flags & IOMMUF_readable) ? DMA_PTE_READ  : 0) |
+                             ((flags & IOMMUF_writable) ? DMA_PTE_WRITE : 0));
+            if ( level > 1 )
+                dma_set_pte_superpage(new);
+
+            /* Set the SNP on leaf page table if Snoop Control available */
+            if ( iommu_snoop )
+                dma_set_pte_snp(new);
+
+            if ( old.val == new.val )
+                continue;
+
+            if ( !dma_pte_present(old) )
+                hd->arch.leaf_mappings[level]++;
+            else if ( level > 1 && !dma_pte_superpage(old) )
+            {
+                /*
+                 * Replacing a page table: account for the subtree and
+                 * queue it for freeing once the IOTLB has been flushed.
+                 */
+                struct page_info *pg = maddr_to_page(dma_pte_addr(old));
+
+                discount_subtree(hd, dma_pte_addr(old), level - 1);
+                PFN_ORDER(pg) = level - 1;
+                page_list_add_tail(pg, &freed_pts);
+                hd->arch.leaf_mappings[level]++;
+            }
+
+            *pte = new;
+            if ( !first )
+                first = pte;
+
+            *flush_flags |= IOMMU_FLUSHF_added;
+            if ( dma_pte_present(old) )
+                *flush_flags |= IOMMU_FLUSHF_modified;
+        }
+
+        if ( first )
+            iommu_flush_cache_entry(first,
+                                    (pte - first + 1) * sizeof(*pte));
+
+        spin_unlock(&hd->arch.mapping_lock);
+        unmap_vtd_domain_page(page);
+    }
+
+    /*
+     * Paging-structure caches may still hold entries referencing the
+     * replaced page tables, and the caller's deferred flush (via
+     * flush_flags) is not ordered against the cleanup tasklet.  Flush
+     * the IOTLB synchronously before the subtrees go back to the
+     * allocator.
+     */
+    if ( !page_list_empty(&freed_pts) )
+    {
+        struct page_info *pg;
+        int flush_rc = iommu_flush_iotlb(d, dfn, 1, nr);
+
+        if ( !rc )
+            rc = flush_rc;
+
+        while ( (pg = page_list_remove_head(&freed_pts)) != NULL )
+            iommu_free_pagetable(page_to_maddr(pg), PFN_ORDER(pg));
+    }
+
+    return rc;
+}
+
 static int __must_check intel_iommu_unmap_page(struct domain *d, dfn_t dfn,
                                                unsigned int *flush_flags)
 {
@@ -1849,11 +2154,110 @@ static int __must_check intel_iommu_unmap_page(struct domain *d, dfn_t dfn,
     return dma_pte_clear_one(d, dfn_to_daddr(dfn), flush_flags);
 }
 
+/*
+ * Clear a run of (1 << page_order) contiguous pages, one leaf table at a
+ * time as per intel_iommu_map_pages() above.  Where order and alignment
+ * cover whole higher-level entries those are cleared directly, whether
+ * they hold a superpage or a page table; superpages straddling the range
+ * boundary get shattered by the page table walk.
+ */
+static int __must_check intel_iommu_unmap_pages(struct domain *d, dfn_t dfn,
+                                                unsigned int page_order,
+                                                unsigned int *flush_flags)
+{
+    struct domain_iommu *hd = dom_iommu(d);
+    unsigned long i, nr = 1ul << page_order;
+    unsigned int level, step;
+    int rc = 0;
+    PAGE_LIST_HEAD(freed_pts);
+
+    /* Do nothing if VT-d shares EPT page table */
+    if ( iommu_use_hap_pt(d) )
+        return 0;
+
+    /* Do nothing if hardware domain and iommu supports pass thru. */
+    if ( iommu_hwdom_passthrough && is_hardware_domain(d) )
+        return 0;
+
+    level = mapping_level(hd, dfn, _mfn(0), page_order, 3);
+    step = 1u << ((level - 1) * LEVEL_STRIDE);
+
+    for ( i = 0; i < nr; )
+    {
+        struct dma_pte *page, *pte, *first = NULL;
+        unsigned int idx;
+        u64 pg_maddr;
+
+        spin_lock(&hd->arch.mapping_lock);
+
+        pg_maddr = addr_to_dma_page_maddr(d, dfn_to_daddr(dfn_add(dfn, i)),
+                                          level, 0, flush_flags);
+        if ( !pg_maddr )
+        {
+            spin_unlock(&hd->arch.mapping_lock);
+            /* No table here: skip to the next table's worth of dfns. */
+            i += (PTE_NUM -
+                  address_level_offset(dfn_to_daddr(dfn_add(dfn, i)),
+                                       level)) * step;
+            continue;
+        }
+
+        page = (struct dma_pte *)map_vtd_domain_page(pg_maddr);
+
+        for ( idx = address_level_offset(dfn_to_daddr(dfn_add(dfn, i)), level);
+              idx < PTE_NUM && i < nr; idx++, i += step )
+        {
+            pte = &page[idx];
+
+            if ( !dma_pte_present(*pte) )
+                continue;
+
+            if ( level > 1 && !dma_pte_superpage(*pte) )
+            {
+                struct page_info *pg = maddr_to_page(dma_pte_addr(*pte));
+
+                discount_subtree(hd, dma_pte_addr(*pte), level - 1);
+                PFN_ORDER(pg) = level - 1;
+                page_list_add_tail(pg, &freed_pts);
+            }
+            else
+                hd->arch.leaf_mappings[level]--;
+
+            dma_clear_pte(*pte);
+            if ( !first )
+                first = pte;
+
+            *flush_flags |= IOMMU_FLUSHF_modified;
+        }
+
+        if ( first )
+            iommu_flush_cache_entry(first,
+                                    (pte - first + 1) * sizeof(*pte));
+
+        spin_unlock(&hd->arch.mapping_lock);
+        unmap_vtd_domain_page(page);
+    }
+
+    /* As in intel_iommu_map_pages(): flush before freeing subtrees. */
+    if ( !page_list_empty(&freed_pts) )
+    {
+        struct page_info *pg;
+
+        rc = iommu_flush_iotlb(d, dfn, 1, nr);
+
+        while ( (pg = page_list_remove_head(&freed_pts)) != NULL )
+            iommu_free_pagetable(page_to_maddr(pg), PFN_ORDER(pg));
+    }
+
+    return rc;
+}
+
 static int intel_iommu_lookup_page(struct domain *d, dfn_t dfn, mfn_t *mfn,
                                    unsigned int *flags)
 {
     struct domain_iommu *hd = dom_iommu(d);
     struct dma_pte *page, val;
+    unsigned int level;
     u64 pg_maddr;
 
     /*
@@ -1866,23 +2270,36 @@ static int intel_iommu_lookup_page(struct domain *d, dfn_t dfn, mfn_t *mfn,
 
     spin_lock(&hd->arch.mapping_lock);
 
-    pg_maddr = addr_to_dma_page_maddr(d, dfn_to_daddr(dfn), 0);
+    pg_maddr = hd->arch.pgd_maddr;
     if ( !pg_maddr )
     {
         spin_unlock(&hd->arch.mapping_lock);
         return -ENOMEM;
     }
 
-    page = map_vtd_domain_page(pg_maddr);
-    val = page[dfn_x(dfn) & LEVEL_MASK];
+    /* Walk by hand so superpage leaves can be reported. */
+    for ( level = agaw_to_level(hd->arch.agaw); ; level-- )
+    {
+        page = map_vtd_domain_page(pg_maddr);
+        val = page[address_level_offset(dfn_to_daddr(dfn), level)];
+        unmap_vtd_domain_page(page);
 
-    unmap_vtd_domain_page(page);
-    spin_unlock(&hd->arch.mapping_lock);
+        if ( !dma_pte_present(val) )
+        {
+            spin_unlock(&hd->arch.mapping_lock);
+            return -ENOENT;
+        }
 
-    if ( !dma_pte_present(val) )
-        return -ENOENT;
+        if ( level == 1 || dma_pte_superpage(val) )
+            break;
+
+        pg_maddr = dma_pte_addr(val);
+    }
 
-    *mfn = maddr_to_mfn(dma_pte_addr(val));
+    spin_unlock(&hd->arch.mapping_lock);
+
+    *mfn = maddr_to_mfn(dma_pte_addr(val) |
+                        (dfn_to_daddr(dfn) & (level_size(level) - 1)));
     *flags = dma_pte_read(val) ? IOMMUF_readable : 0;
     *flags |= dma_pte_write(val) ? IOMMUF_writable : 0;
 
@@ -2325,9 +2742,17 @@ int __init intel_vtd_setup(void)
 
         printk(".\n");
 
+        if ( vtd_sp_level > 1 && !cap_sps_2mb(iommu->cap) )
+            vtd_sp_level = 1;
+        if ( vtd_sp_level > 2 && !cap_sps_1gb(iommu->cap) )
+            vtd_sp_level = 2;
+
         if ( iommu_snoop && !ecap_snp_ctl(iommu->ecap) )
             iommu_snoop = 0;
 
+        if ( iommu_slads && !ecap_slads(iommu->ecap) )
+            iommu_slads = 0;
+
         if ( iommu_hwdom_passthrough && !ecap_pass_thru(iommu->ecap) )
             iommu_hwdom_passthrough = false;
 
@@ -2367,6 +2792,7 @@ int __init intel_vtd_setup(void)
 
 #define P(p,s) printk("Intel VT-d %s %senabled.\n", s, (p)? "" : "not ")
     P(iommu_snoop, "Snoop Control");
+    P(iommu_slads, "Second-level A/D");
     P(iommu_hwdom_passthrough, "Dom0 DMA Passthrough");
     P(iommu_qinval, "Queued Invalidation");
     P(iommu_intremap, "Interrupt Remapping");
@@ -2389,6 +2815,7 @@ int __init intel_vtd_setup(void)
  error:
     iommu_enabled = 0;
     iommu_snoop = 0;
+    iommu_slads = 0;
     iommu_hwdom_passthrough = false;
     iommu_qinval = 0;
     iommu_intremap = 0;
@@ -2702,10 +3129,84 @@ static void vtd_dump_p2m_table(struct domain *d)
         return;
 
     hd = dom_iommu(d);
+    printk("installed leaf mappings: %lu x 4k, %lu x 2M, %lu x 1G\n",
+           hd->arch.leaf_mappings[1], hd->arch.leaf_mappings[2],
+           hd->arch.leaf_mappings[3]);
     printk("p2m table has %d levels\n", agaw_to_level(hd->arch.agaw));
     vtd_dump_p2m_table_level(hd->arch.pgd_maddr, agaw_to_level(hd->arch.agaw), 0, 0);
 }
 
+static unsigned long vtd_sync_dirty_log_level(struct domain *d,
+                                              paddr_t pt_maddr, int level)
+{
+    struct dma_pte *pt_vaddr, *pte;
+    unsigned long dirty = 0;
+    int i;
+
+    pt_vaddr = map_vtd_domain_page(pt_maddr);
+
+    for ( i = 0; i < PTE_NUM; i++ )
+    {
+        unsigned long mfn, nr, j;
+
+        pte = &pt_vaddr[i];
+        if ( !dma_pte_present(*pte) || !dma_pte_write(*pte) )
+            continue;
+
+        if ( level > 1 && !dma_pte_superpage(*pte) )
+        {
+            dirty += vtd_sync_dirty_log_level(d, dma_pte_addr(*pte),
+                                              level - 1);
+            continue;
+        }
+
+        if ( !dma_pte_dirty(*pte) )
+            continue;
+
+        /*
+         * Devices keep writing while we harvest: clear atomically, and
+         * before marking, so that a write racing with the harvest
+         * re-dirties the entry for the next round.
+         */
+        clear_bit(DMA_PTE_DIRTY_BIT, &pte->val);
+        iommu_flush_cache_entry(pte, sizeof(struct dma_pte));
+
+        mfn = dma_pte_addr(*pte) >> PAGE_SHIFT_4K;
+        nr = 1UL << ((level - 1) * LEVEL_STRIDE);
+        for ( j = 0; j < nr; j++ )
+            paging_mark_dirty(d, _mfn(mfn + j));
+        dirty++;
+    }
+
+    unmap_vtd_domain_page(pt_vaddr);
+
+    return dirty;
+}
+
+/*
+ * Harvest the second-level Dirty bits into the log-dirty bitmap. Callers
+ * have the domain paused, so the page tables are stable under us (devices
+ * however are not, see above); with shared EPT there are no separate
+ * second-level entries and the EPT D bits already feed the log.
+ */
+static int __must_check vtd_sync_dirty_log(struct domain *d)
+{
+    struct domain_iommu *hd = dom_iommu(d);
+    unsigned long dirty;
+
+    if ( !iommu_slads || iommu_use_hap_pt(d) || hd->arch.pgd_maddr == 0 )
+        return 0;
+
+    dirty = vtd_sync_dirty_log_level(d, hd->arch.pgd_maddr,
+                                     agaw_to_level(hd->arch.agaw));
+
+    /*
+     * Translations cached with the D bit already set won't set it again;
+     * flush them so further device writes are caught.
+     */
+    return dirty ? iommu_flush_iotlb_all(d) : 0;
+}
+
 const struct iommu_ops __initconstrel intel_iommu_ops = {
     .init = intel_iommu_domain_init,
     .hwdom_init = intel_iommu_hwdom_init,
@@ -2716,6 +3217,8 @@ const struct iommu_ops __initconstrel intel_iommu_ops = {
     .teardown = iommu_domain_teardown,
     .map_page = intel_iommu_map_page,
     .unmap_page = intel_iommu_unmap_page,
+    .map_pages = intel_iommu_map_pages,
+    .unmap_pages = intel_iommu_unmap_pages,
     .lookup_page = intel_iommu_lookup_page,
     .free_page_table = iommu_free_page_table,
     .reassign_device = reassign_device_ownership,
@@ -2731,6 +3234,7 @@ const struct iommu_ops __initconstrel intel_iommu_ops = {
     .crash_shutdown = vtd_crash_shutdown,
     .iotlb_flush = iommu_flush_iotlb_pages,
     .iotlb_flush_all = iommu_flush_iotlb_all,
+    .sync_dirty_log = vtd_sync_dirty_log,
     .get_reserved_device_memory = intel_iommu_get_reserved_device_memory,
     .dump_p2m_table = vtd_dump_p2m_table,
 };
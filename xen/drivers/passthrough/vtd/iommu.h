@@ -20,6 +20,7 @@
 #define _INTEL_IOMMU_H_
 
 #include <xen/iommu.h>
+#include <xen/timer.h>
 #include <asm/msi.h>
 
 /*
@@ -103,6 +104,7 @@
 #define ecap_cache_hints(e)      ((e >> 5) & 0x1)
 #define ecap_pass_thru(e)        ((e >> 6) & 0x1)
 #define ecap_snp_ctl(e)          ((e >> 7) & 0x1)
+#define ecap_slads(e)            ((e >> 45) & 0x1)
 
 /* IOTLB_REG */
 #define DMA_TLB_FLUSH_GRANU_OFFSET  60
@@ -263,6 +265,14 @@ struct dma_pte {
 #define DMA_PTE_WRITE (2)
 #define DMA_PTE_PROT (DMA_PTE_READ | DMA_PTE_WRITE)
 #define DMA_PTE_SP   (1 << 7)
+/*
+ * Second-level Accessed/Dirty bits; only set by hardware when the IOMMU
+ * supports SLADS (ignored otherwise, the range is "available" then).
+ */
+#define DMA_PTE_ACCESS_BIT 8
+#define DMA_PTE_DIRTY_BIT  9
+#define DMA_PTE_ACCESS (1 << DMA_PTE_ACCESS_BIT)
+#define DMA_PTE_DIRTY  (1 << DMA_PTE_DIRTY_BIT)
 #define DMA_PTE_SNP  (1 << 11)
 #define dma_clear_pte(p)    do {(p).val = 0;} while(0)
 #define dma_set_pte_readable(p) do {(p).val |= DMA_PTE_READ;} while(0)
@@ -279,6 +289,7 @@ struct dma_pte {
 #define dma_set_pte_addr(p, addr) do {\
             (p).val |= ((addr) & PAGE_MASK_4K); } while (0)
 #define dma_pte_present(p) (((p).val & DMA_PTE_PROT) != 0)
+#define dma_pte_dirty(p) (((p).val & DMA_PTE_DIRTY) != 0)
 #define dma_pte_superpage(p) (((p).val & DMA_PTE_SP) != 0)
 
 /* interrupt remap entry */
@@ -548,6 +559,9 @@ struct iommu {
     struct list_head ats_devices;
     unsigned long *domid_bitmap;  /* domain id bitmap */
     u16 *domid_map;               /* domain id mapping array */
+    struct timer fault_unmask_timer; /* re-enables a throttled fault irq */
+    s_time_t fault_window;
+    unsigned int fault_cnt;
 };
 
 static inline struct qi_ctrl *iommu_qi_ctrl(struct iommu *iommu)
@@ -28,7 +28,8 @@
 /* Allow for both IOAPIC and IOSAPIC. */
 #define IO_xAPIC_route_entry IO_APIC_route_entry
 
-struct IO_APIC_route_remap_entry {
+/* __packed: overlays the (packed) IO/xAPIC RTE, which has alignment 1. */
+struct __packed IO_APIC_route_remap_entry {
     union {
         u64 val;
         struct {
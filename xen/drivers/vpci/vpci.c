@@ -27,7 +27,6 @@ struct vpci_register {
     unsigned int size;
     unsigned int offset;
     void *private;
-    struct list_head node;
 };
 
 #ifdef __XEN__
@@ -38,15 +37,9 @@ extern vpci_register_init_t *const __end_vpci_array[];
 void vpci_remove_device(struct pci_dev *pdev)
 {
     spin_lock(&pdev->vpci->lock);
-    while ( !list_empty(&pdev->vpci->handlers) )
-    {
-        struct vpci_register *r = list_first_entry(&pdev->vpci->handlers,
-                                                   struct vpci_register,
-                                                   node);
-
-        list_del(&r->node);
-        xfree(r);
-    }
+    xfree(pdev->vpci->handlers);
+    pdev->vpci->handlers = NULL;
+    pdev->vpci->nr_handlers = 0;
     spin_unlock(&pdev->vpci->lock);
     xfree(pdev->vpci->msix);
     xfree(pdev->vpci->msi);
@@ -66,7 +59,6 @@ int __hwdom_init vpci_add_handlers(struct pci_dev *pdev)
     if ( !pdev->vpci )
         return -ENOMEM;
 
-    INIT_LIST_HEAD(&pdev->vpci->handlers);
     spin_lock_init(&pdev->vpci->lock);
 
     for ( i = 0; i < NUM_VPCI_INIT; i++ )
@@ -129,8 +121,8 @@ int vpci_add_register(struct vpci *vpci, vpci_read_t *read_handler,
                       vpci_write_t *write_handler, unsigned int offset,
                       unsigned int size, void *data)
 {
-    struct list_head *prev;
-    struct vpci_register *r;
+    struct vpci_register r, *handlers;
+    unsigned int i;
 
     /* Some sanity checks. */
     if ( (size != 1 && size != 2 && size != 4) ||
@@ -138,36 +130,47 @@ int vpci_add_register(struct vpci *vpci, vpci_read_t *read_handler,
          (!read_handler && !write_handler) )
         return -EINVAL;
 
-    r = xmalloc(struct vpci_register);
-    if ( !r )
-        return -ENOMEM;
-
-    r->read = read_handler ?: vpci_ignored_read;
-    r->write = write_handler ?: vpci_ignored_write;
-    r->size = size;
-    r->offset = offset;
-    r->private = data;
+    r.read = read_handler ?: vpci_ignored_read;
+    r.write = write_handler ?: vpci_ignored_write;
+    r.size = size;
+    r.offset = offset;
+    r.private = data;
 
     spin_lock(&vpci->lock);
 
-    /* The list of handlers must be kept sorted at all times. */
-    list_for_each ( prev, &vpci->handlers )
+    /* The array of handlers must be kept sorted at all times. */
+    for ( i = 0; i < vpci->nr_handlers; i++ )
     {
-        const struct vpci_register *this =
-            list_entry(prev, const struct vpci_register, node);
-        int cmp = vpci_register_cmp(r, this);
+        int cmp = vpci_register_cmp(&r, &vpci->handlers[i]);
 
         if ( cmp < 0 )
             break;
         if ( cmp == 0 )
         {
             spin_unlock(&vpci->lock);
-            xfree(r);
             return -EEXIST;
         }
     }
 
-    list_add_tail(&r->node, prev);
+    handlers = xmalloc_array(struct vpci_register, vpci->nr_handlers + 1);
+    if ( !handlers )
+    {
+        spin_unlock(&vpci->lock);
+        return -ENOMEM;
+    }
+
+    memcpy(handlers, vpci->handlers, i * sizeof(r));
+    handlers[i] = r;
+    memcpy(&handlers[i + 1], &vpci->handlers[i],
+           (vpci->nr_handlers - i) * sizeof(r));
+
+    xfree(vpci->handlers);
+    vpci->handlers = handlers;
+    vpci->nr_handlers++;
+
+    for ( i = 0; i < size; i++ )
+        __set_bit(offset + i, vpci->intercepted);
+
     spin_unlock(&vpci->lock);
 
     return 0;
@@ -177,22 +180,28 @@ int vpci_remove_register(struct vpci *vpci, unsigned int offset,
                          unsigned int size)
 {
     const struct vpci_register r = { .offset = offset, .size = size };
-    struct vpci_register *rm;
+    unsigned int i;
 
     spin_lock(&vpci->lock);
-    list_for_each_entry ( rm, &vpci->handlers, node )
+    for ( i = 0; i < vpci->nr_handlers; i++ )
     {
+        const struct vpci_register *rm = &vpci->handlers[i];
         int cmp = vpci_register_cmp(&r, rm);
 
         /*
          * NB: do not use a switch so that we can use break to
-         * get out of the list loop earlier if required.
+         * get out of the loop earlier if required.
          */
         if ( !cmp && rm->offset == offset && rm->size == size )
         {
-            list_del(&rm->node);
+            unsigned int j;
+
+            for ( j = 0; j < size; j++ )
+                __clear_bit(offset + j, vpci->intercepted);
+            /* Keep the (now oversized) allocation; removals are rare. */
+            memmove(&vpci->handlers[i], &vpci->handlers[i + 1],
+                    (--vpci->nr_handlers - i) * sizeof(r));
             spin_unlock(&vpci->lock);
-            xfree(rm);
             return 0;
         }
         if ( cmp <= 0 )
@@ -312,12 +321,55 @@ static uint32_t merge_result(uint32_t data, uint32_t new, unsigned int size,
     return (data & ~(mask << (offset * 8))) | ((new & mask) << (offset * 8));
 }
 
+/*
+ * Check whether an access touches a byte covered by an emulated register.
+ * Done locklessly: the bitmap is only ever updated with the vpci lock held,
+ * and a racing update is indistinguishable from the access having happened
+ * just before or after it.
+ */
+static bool vpci_access_intercepted(const struct vpci *vpci, unsigned int reg,
+                                    unsigned int size)
+{
+    unsigned int i;
+
+    if ( reg + size > PCI_CFG_SPACE_EXP_SIZE )
+        return true;
+
+    for ( i = 0; i < size; i++ )
+        if ( test_bit(reg + i, vpci->intercepted) )
+            return true;
+
+    return false;
+}
+
+/*
+ * Return the index of the first handler whose range ends past 'offset'
+ * (nr_handlers if there's none). The caller must hold the vpci lock.
+ */
+static unsigned int vpci_find_handler(const struct vpci *vpci,
+                                      unsigned int offset)
+{
+    unsigned int lo = 0, hi = vpci->nr_handlers;
+
+    while ( lo < hi )
+    {
+        unsigned int mid = (lo + hi) / 2;
+        const struct vpci_register *r = &vpci->handlers[mid];
+
+        if ( r->offset + r->size <= offset )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
 uint32_t vpci_read(pci_sbdf_t sbdf, unsigned int reg, unsigned int size)
 {
     const struct domain *d = current->domain;
     const struct pci_dev *pdev;
-    const struct vpci_register *r;
-    unsigned int data_offset = 0;
+    unsigned int i, data_offset = 0;
     uint32_t data = ~(uint32_t)0;
 
     if ( !size )
@@ -331,23 +383,26 @@ uint32_t vpci_read(pci_sbdf_t sbdf, unsigned int reg, unsigned int size)
     if ( !pdev )
         return vpci_read_hw(sbdf, reg, size);
 
+    /* Accesses not hitting any emulated register are passed through. */
+    if ( !vpci_access_intercepted(pdev->vpci, reg, size) )
+        return vpci_read_hw(sbdf, reg, size);
+
     spin_lock(&pdev->vpci->lock);
 
     /* Read from the hardware or the emulated register handlers. */
-    list_for_each_entry ( r, &pdev->vpci->handlers, node )
+    for ( i = vpci_find_handler(pdev->vpci, reg);
+          i < pdev->vpci->nr_handlers; i++ )
     {
+        const struct vpci_register *r = &pdev->vpci->handlers[i];
         const struct vpci_register emu = {
             .offset = reg + data_offset,
             .size = size - data_offset
         };
-        int cmp = vpci_register_cmp(&emu, r);
         uint32_t val;
         unsigned int read_size;
 
-        if ( cmp < 0 )
+        if ( r->offset >= reg + size )
             break;
-        if ( cmp > 0 )
-            continue;
 
         if ( emu.offset < r->offset )
         {
@@ -419,8 +474,7 @@ void vpci_write(pci_sbdf_t sbdf, unsigned int reg, unsigned int size,
 {
     const struct domain *d = current->domain;
     const struct pci_dev *pdev;
-    const struct vpci_register *r;
-    unsigned int data_offset = 0;
+    unsigned int i, data_offset = 0;
 
     if ( !size )
     {
@@ -439,22 +493,28 @@ void vpci_write(pci_sbdf_t sbdf, unsigned int reg, unsigned int size,
         return;
     }
 
+    /* Accesses not hitting any emulated register are passed through. */
+    if ( !vpci_access_intercepted(pdev->vpci, reg, size) )
+    {
+        vpci_write_hw(sbdf, reg, size, data);
+        return;
+    }
+
     spin_lock(&pdev->vpci->lock);
 
     /* Write the value to the hardware or emulated registers. */
-    list_for_each_entry ( r, &pdev->vpci->handlers, node )
+    for ( i = vpci_find_handler(pdev->vpci, reg);
+          i < pdev->vpci->nr_handlers; i++ )
     {
+        const struct vpci_register *r = &pdev->vpci->handlers[i];
         const struct vpci_register emu = {
             .offset = reg + data_offset,
             .size = size - data_offset
         };
-        int cmp = vpci_register_cmp(&emu, r);
         unsigned int write_size;
 
-        if ( cmp < 0 )
+        if ( r->offset >= reg + size )
             break;
-        if ( cmp > 0 )
-            continue;
 
         if ( emu.offset < r->offset )
         {
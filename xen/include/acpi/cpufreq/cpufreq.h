@@ -138,6 +138,9 @@ extern int cpufreq_driver_getavg(unsigned int cpu, unsigned int flag);
 extern int cpufreq_update_turbo(int cpuid, int new_state);
 extern int cpufreq_get_turbo_status(int cpuid);
 
+/* HWP energy-performance preference (0 - performance ... 255 - energy) */
+extern int hwp_set_epp(unsigned int cpu, unsigned int epp);
+
 static __inline__ int 
 __cpufreq_governor(struct cpufreq_policy *policy, unsigned int event)
 {
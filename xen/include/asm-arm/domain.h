@@ -189,6 +189,12 @@ struct arch_vcpu
 
     /* Float-pointer */
     struct vfp_state vfp;
+    /*
+     * Whether this vCPU's FP/SIMD state is live in the registers. Set on
+     * the first trapped FP/SIMD access after being scheduled in, cleared
+     * again when the state is saved on context switch out.
+     */
+    bool vfp_loaded;
 
     /* CP 15 */
     uint32_t csselr;
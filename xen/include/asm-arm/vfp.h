@@ -2,6 +2,10 @@
 #define _ASM_VFP_H
 
 #include <xen/sched.h>
+#include <asm/cpregs.h>
+#include <asm/processor.h>
+#include <asm/sysregs.h>
+#include <asm/system.h>
 
 #if defined(CONFIG_ARM_32)
 # include <asm/arm32/vfp.h>
@@ -14,6 +18,27 @@
 void vfp_save_state(struct vcpu *v);
 void vfp_restore_state(struct vcpu *v);
 
+/*
+ * Re-arm the FP/SIMD trap so that the first access by the next vCPU
+ * faults into Xen, where the register file is restored lazily.
+ */
+static inline void vfp_enable_trap(void)
+{
+    WRITE_SYSREG(READ_SYSREG(CPTR_EL2) | HCPTR_CP(10) | HCPTR_CP(11),
+                 CPTR_EL2);
+}
+
+/*
+ * Clear the FP/SIMD trap. The isb is required before Xen itself may
+ * execute FP/SIMD instructions (the trap also applies to EL2).
+ */
+static inline void vfp_disable_trap(void)
+{
+    WRITE_SYSREG(READ_SYSREG(CPTR_EL2) & ~(HCPTR_CP(10) | HCPTR_CP(11)),
+                 CPTR_EL2);
+    isb();
+}
+
 #endif /* _ASM_VFP_H */
 /*
  * Local variables:
@@ -24,6 +24,7 @@
 
 #include <xen/radix-tree.h>
 #include <xen/rbtree.h>
+#include <xen/time.h>
 
 struct pending_irq
 {
@@ -79,6 +80,8 @@ struct pending_irq
     unsigned long status;
     struct irq_desc *desc; /* only set it the irq corresponds to a physical irq */
     unsigned int irq;
+    /* When the irq was first queued; zeroed again on LR insertion. */
+    s_time_t queue_time;
 #define GIC_INVALID_LR         (uint8_t)~0
     uint8_t lr;
     uint8_t priority;
@@ -203,6 +206,15 @@ struct vgic_cpu {
     struct list_head lr_pending;
     spinlock_t lock;
 
+    /*
+     * Injection latency statistics: time from an IRQ being queued on
+     * this vCPU to its insertion into an LR.  Dumped by the 'I' debug
+     * key, so dom0 can read them from the console ring.
+     */
+    uint64_t inj_count;
+    s_time_t inj_lat_sum;
+    s_time_t inj_lat_max;
+
     /* GICv3: redistributor base and flags for this vCPU */
     paddr_t rdist_base;
     uint64_t rdist_pendbase;
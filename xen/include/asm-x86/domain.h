@@ -174,6 +174,18 @@ struct log_dirty_domain {
     unsigned int   allocs;
     unsigned int   failed_allocs;
 
+    /*
+     * Optional list of dirtied pfns, filled alongside the bitmap and
+     * consumed via XEN_DOMCTL_SHADOW_OP_CLEAN_LIST.  Once it overflows
+     * ('full' set), consumers fall back to a bitmap-based CLEAN.
+     */
+    struct {
+        unsigned long *pfns;
+        unsigned int   size;
+        unsigned int   count;
+        bool_t         full;
+    } list;
+
     /* log-dirty mode stats */
     unsigned int   fault_count;
     unsigned int   dirty_count;
@@ -243,6 +255,7 @@ struct paging_vcpu {
 #define INVALID_ALTP2M  0xffff
 #define MAX_EPTP        (PAGE_SIZE / sizeof(uint64_t))
 struct p2m_domain;
+struct hypercall_stats;
 struct time_scale {
     int shift;
     u32 mul_frac;
@@ -315,6 +328,12 @@ struct arch_domain
     unsigned int rel_priv;
     struct page_list_head relmem_list;
 
+    /* Per-hypercall latency statistics (may be NULL). */
+    struct hypercall_stats *hypercall_stats;
+
+    /* Worst tolerable wakeup latency (us), fed to cpuidle; 0 = no hint. */
+    uint32_t wakeup_latency_us;
+
     const struct arch_csw {
         void (*from)(struct vcpu *);
         void (*to)(struct vcpu *);
@@ -421,6 +440,9 @@ struct arch_domain
         unsigned int inguest_pagefault_disabled                            : 1;
         struct monitor_msr_bitmap *msr_bitmap;
         uint64_t write_ctrlreg_mask[4];
+        /* CR/MSR values never forwarded to the monitor ring */
+        struct monitor_allowed_value *allowed_values;
+        unsigned int nr_allowed_values;
     } monitor;
 
     /* Mem_access emulation control */
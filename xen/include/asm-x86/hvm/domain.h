@@ -65,8 +65,11 @@ struct hvm_ioreq_server {
     spinlock_t             bufioreq_lock;
     evtchn_port_t          bufioreq_evtchn;
     struct rangeset        *range[NR_IO_RANGE_TYPES];
+    /* Subsets of range[] whose writes are posted; allocated on demand */
+    struct rangeset        *posted_range[NR_IO_RANGE_TYPES];
     bool                   enabled;
     uint8_t                bufioreq_handling;
+    struct rcu_head        rcu_head;
 };
 
 /*
@@ -103,8 +106,19 @@ struct hvm_domain {
     struct {
         spinlock_t              lock;
         struct hvm_ioreq_server *server[MAX_NR_IOREQ_SERVERS];
+        /*
+         * Bumped on any server or range change; invalidates the per-vCPU
+         * MRU caches used by hvm_select_ioreq_server().
+         */
+        uint64_t                generation;
     } ioreq_server;
 
+    /*
+     * Bumped whenever any vCPU's APIC ID/LDR/DFR changes; invalidates the
+     * per-sender IPI destination caches used by vlapic_ipi().
+     */
+    uint64_t               vlapic_dest_generation;
+
     /* Cached CF8 for guest PCI config cycles */
     uint32_t                pci_cf8;
 
@@ -157,11 +157,14 @@ struct hvm_hw_stdvga {
     enum stdvga_cache_state cache;
     uint32_t latch;
     struct page_info *vram_page[64];  /* shadow of 0xa0000-0xaffff */
+    struct page_info *dirty_page;     /* HVM_PARAM_VGA_DIRTY_PFN backing */
+    struct vga_dirty_rect *dirty;
     spinlock_t lock;
 };
 
 void stdvga_init(struct domain *d);
 void stdvga_deinit(struct domain *d);
+int stdvga_dirty_rect_set_gfn(struct domain *d, unsigned long gfn);
 
 extern void hvm_dpci_msi_eoi(struct domain *d, int vector);
 
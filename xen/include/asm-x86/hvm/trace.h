@@ -69,7 +69,7 @@
 
 #define HVMTRACE_ND(evt, modifier, cycles, count, d1, d2, d3, d4, d5, d6) \
     do {                                                                  \
-        if ( unlikely(tb_init_done) && DO_TRC_HVM_ ## evt )               \
+        if ( tracing_active() && DO_TRC_HVM_ ## evt )                     \
         {                                                                 \
             struct {                                                      \
                 u32 d[6];                                                 \
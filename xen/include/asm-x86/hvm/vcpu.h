@@ -52,6 +52,18 @@ struct hvm_mmio_cache {
     uint8_t buffer[64] __aligned(sizeof(long));
 };
 
+/*
+ * MRU result of hvm_select_ioreq_server(), valid only while the generation
+ * matches the domain's ioreq server configuration generation.
+ */
+struct hvm_ioreq_select_cache {
+    uint64_t generation;
+    unsigned long start, end;
+    struct hvm_ioreq_server *server;
+    uint8_t type;
+    bool valid;
+};
+
 struct hvm_vcpu_io {
     /* I/O request in flight to device model. */
     enum hvm_io_completion io_completion;
@@ -77,6 +89,12 @@ struct hvm_vcpu_io {
     /* For retries we shouldn't re-fetch the instruction. */
     unsigned int mmio_insn_bytes;
     unsigned char mmio_insn[16];
+
+    /* Decoded-instruction cache, maintained by x86_emulate(). */
+    struct x86_decode_cache *decode_cache;
+
+    /* Cached ioreq server resolution for the last emulated access. */
+    struct hvm_ioreq_select_cache select_cache;
     /*
      * For string instruction emulation we need to be able to signal a
      * necessary retry through other than function return codes.
@@ -168,6 +186,8 @@ struct hvm_vcpu {
     /* Lock and list for virtual platform timers. */
     spinlock_t          tm_lock;
     struct list_head    tm_list;
+    /* Mirror of the tm_list length, for lock-free empty checks. */
+    unsigned int        nr_pts;
 
     bool                flag_dr_dirty;
     bool                debug_state_latch;
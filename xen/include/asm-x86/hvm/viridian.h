@@ -66,6 +66,8 @@ struct viridian_domain
     union viridian_page_msr hypercall_gpa;
     struct viridian_time_ref_count time_ref_count;
     union viridian_page_msr reference_tsc;
+    /* Cached TscScale value for the reference TSC page (0 => not known). */
+    uint64_t reference_tsc_scale;
 };
 
 void cpuid_viridian_leaves(const struct vcpu *v, uint32_t leaf,
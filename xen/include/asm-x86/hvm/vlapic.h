@@ -84,6 +84,8 @@ struct vlapic {
     }                        loaded;
     spinlock_t               esr_lock;
     struct periodic_time     pt;
+    /* Directly armed TSC-deadline; see opt_tdt_direct in vlapic.c. */
+    struct timer             tdt_timer;
     s_time_t                 timer_last_update;
     struct page_info         *regs_page;
     /* INIT-SIPI-SIPI work gets deferred to a tasklet. */
@@ -91,6 +93,18 @@ struct vlapic {
         uint32_t             icr, dest;
         struct tasklet       tasklet;
     } init_sipi;
+    /*
+     * MRU unicast IPI destination of this sender, valid while gen matches
+     * the domain's vlapic_dest_generation.  Only ever touched by the
+     * sending vCPU itself.
+     */
+    struct {
+        uint64_t             gen;
+        uint32_t             dest;
+        uint32_t             vcpu_id;
+        bool_t               dest_mode;
+        bool_t               valid;
+    } dest_cache;
 };
 
 /* vlapic's frequence is 100 MHz */
@@ -50,6 +50,14 @@ struct nestedvmx {
         uint32_t exit_qual;
     } ept;
     uint32_t guest_vpid;
+    /*
+     * Bitmap, indexed by vmcs_gstate_field[] position, of guest state
+     * fields in which the vvmcs may have diverged from the shadow vmcs
+     * since the two were last synchronised.  Only maintained without
+     * VMCS shadowing; with VMCS shadowing L1 writes don't trap and all
+     * fields have to be considered dirty.
+     */
+    uint64_t vvmcs_dirty;
     struct list_head launched_list;
 };
 
@@ -164,6 +172,7 @@ enum vmx_insn_errno get_vvmcs_real_safe(const struct vcpu *, u32 encoding,
 enum vmx_insn_errno set_vvmcs_virtual_safe(void *vvmcs, u32 encoding, u64 val);
 enum vmx_insn_errno set_vvmcs_real_safe(const struct vcpu *, u32 encoding,
                                         u64 val);
+void nvmx_set_vvmcs_dirty(struct vcpu *v, u32 encoding);
 
 #define get_vvmcs(vcpu, encoding) \
   (cpu_has_vmx_vmcs_shadowing ? \
@@ -171,9 +180,10 @@ enum vmx_insn_errno set_vvmcs_real_safe(const struct vcpu *, u32 encoding,
    get_vvmcs_virtual(vcpu_nestedhvm(vcpu).nv_vvmcx, encoding))
 
 #define set_vvmcs(vcpu, encoding, val) \
-  (cpu_has_vmx_vmcs_shadowing ? \
-   set_vvmcs_real(vcpu, encoding, val) : \
-   set_vvmcs_virtual(vcpu_nestedhvm(vcpu).nv_vvmcx, encoding, val))
+  (nvmx_set_vvmcs_dirty(vcpu, encoding), \
+   (cpu_has_vmx_vmcs_shadowing ? \
+    set_vvmcs_real(vcpu, encoding, val) : \
+    set_vvmcs_virtual(vcpu_nestedhvm(vcpu).nv_vvmcx, encoding, val)))
 
 #define get_vvmcs_safe(vcpu, encoding, val) \
   (cpu_has_vmx_vmcs_shadowing ? \
@@ -181,9 +191,10 @@ enum vmx_insn_errno set_vvmcs_real_safe(const struct vcpu *, u32 encoding,
    get_vvmcs_virtual_safe(vcpu_nestedhvm(vcpu).nv_vvmcx, encoding, val))
 
 #define set_vvmcs_safe(vcpu, encoding, val) \
-  (cpu_has_vmx_vmcs_shadowing ? \
-   set_vvmcs_real_safe(vcpu, encoding, val) : \
-   set_vvmcs_virtual_safe(vcpu_nestedhvm(vcpu).nv_vvmcx, encoding, val))
+  (nvmx_set_vvmcs_dirty(vcpu, encoding), \
+   (cpu_has_vmx_vmcs_shadowing ? \
+    set_vvmcs_real_safe(vcpu, encoding, val) : \
+    set_vvmcs_virtual_safe(vcpu_nestedhvm(vcpu).nv_vvmcx, encoding, val)))
 
 void nvmx_destroy_vmcs(struct vcpu *v);
 int nvmx_handle_vmx_insn(struct cpu_user_regs *regs, unsigned int exit_reason);
@@ -6,7 +6,9 @@
 #define __ASM_X86_HYPERCALL_H__
 
 #include <xen/types.h>
+#include <xen/time.h>
 #include <public/physdev.h>
+#include <public/sysctl.h>   /* for struct xen_sysctl_hypercall_prof_op */
 #include <public/event_channel.h>
 #include <public/arch-x86/xen-mca.h> /* for do_mca */
 #include <asm/paging.h>
@@ -25,6 +27,16 @@ typedef struct {
 
 extern const hypercall_args_t hypercall_args_table[NR_hypercalls];
 
+/* Per-domain hypercall latency statistics, indexed by hypercall number. */
+struct hypercall_stats {
+    uint64_t count;                            /* # of dispatches */
+    s_time_t time;                             /* total time spent */
+    uint64_t hist[XEN_HYPERCALL_PROF_NR_HIST]; /* log2 usec histogram */
+};
+
+void hypercall_stats_account(struct domain *d, unsigned int op, s_time_t t0);
+int hypercall_stats_control(struct xen_sysctl_hypercall_prof_op *hp);
+
 #ifdef CONFIG_PV
 extern const hypercall_table_t pv_hypercall_table[];
 void pv_hypercall(struct cpu_user_regs *regs);
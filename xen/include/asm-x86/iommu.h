@@ -50,6 +50,9 @@ struct arch_iommu
     u64 iommu_bitmap;              /* bitmap of iommu(s) that the domain uses */
     struct list_head mapped_rmrrs;
 
+    /* Count of installed leaf mappings per level ([1] 4k, [2] 2M, [3] 1G). */
+    unsigned long leaf_mappings[4];
+
     /* amd iommu support */
     int paging_mode;
     struct page_info *root_table;
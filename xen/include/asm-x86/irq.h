@@ -150,6 +150,9 @@ int unmap_domain_pirq_emuirq(struct domain *d, int pirq);
 void fixup_irqs(const cpumask_t *mask, bool verbose);
 void fixup_eoi(void);
 
+struct xen_sysctl_irq_stats;
+int irq_get_stats(struct xen_sysctl_irq_stats *op);
+
 int  init_irq_data(void);
 
 void clear_irq_vector(int irq);
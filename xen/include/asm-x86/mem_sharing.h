@@ -71,6 +71,11 @@ static inline int mem_sharing_unshare_page(struct domain *d,
     return rc;
 }
 
+/* Best-effort unshare of the aligned cluster of gfns around a write
+ * fault to a shared page. Skips gfns that are not shared; stops early
+ * on ENOMEM, leaving the rest to their own faults. */
+void mem_sharing_unshare_cluster(struct domain *d, unsigned long gfn);
+
 /* If called by a foreign domain, possible errors are
  *   -EBUSY -> ring full
  *   -ENOSYS -> no ring to begin with
@@ -48,8 +48,17 @@
 #define _PGT_partial      PG_shift(8)
 #define PGT_partial       PG_mask(1, 8)
 
+/* Is the type count split into per-CPU deltas? */
+#define _PGT_split        PG_shift(9)
+#define PGT_split         PG_mask(1, 9)
+/* Is a fold of the per-CPU deltas in progress? */
+#define _PGT_split_fold   PG_shift(10)
+#define PGT_split_fold    PG_mask(1, 10)
+ /* Index of the tracking slot of a split-counted page. */
+#define PGT_split_idx_mask PG_mask(0x3f, 16)
+
  /* Count of uses of this frame as its current type. */
-#define PGT_count_width   PG_shift(8)
+#define PGT_count_width   PG_shift(16)
 #define PGT_count_mask    ((1UL<<PGT_count_width)-1)
 
 /* Are the 'type mask' bits identical? */
@@ -285,8 +294,10 @@ struct page_info
 
 #define PRtype_info "016lx"/* should only be used for printk's */
 
-/* The number of out-of-sync shadows we allow per vcpu (prime, please) */
-#define SHADOW_OOS_PAGES 3
+/* The maximum number of out-of-sync shadows we allow per vcpu, sizing
+ * the per-vcpu OOS tables; the number of slots actually used is set
+ * with the "shadow-oos-pages" command line option (prime, please). */
+#define SHADOW_OOS_PAGES 7
 
 /* OOS fixup entries */
 #define SHADOW_OOS_FIXUPS 2
@@ -383,6 +394,7 @@ int  get_page_type(struct page_info *page, unsigned long type);
 int  put_page_type_preemptible(struct page_info *page);
 int  get_page_type_preemptible(struct page_info *page, unsigned long type);
 int  put_old_guest_table(struct vcpu *);
+void pgt_split_fold_domain(struct domain *d);
 int  get_page_from_l1e(
     l1_pgentry_t l1e, struct domain *l1e_owner, struct domain *pg_owner);
 void put_page_from_l1e(l1_pgentry_t l1e, struct domain *l1e_owner);
@@ -32,6 +32,20 @@ struct monitor_msr_bitmap {
     DECLARE_BITMAP(high, 8192);
 };
 
+#define MONITOR_MAX_ALLOWED_VALUES 32
+
+struct monitor_allowed_value {
+    uint64_t value;
+    uint32_t index;
+    uint32_t event;
+};
+
+int arch_monitor_allow_value(struct domain *d,
+                             struct xen_domctl_monitor_op *mop, bool add);
+
+bool monitored_value_allowed(const struct domain *d, unsigned int event,
+                             unsigned int index, uint64_t value);
+
 static inline
 void arch_monitor_allow_userspace(struct domain *d, bool allow_userspace)
 {
@@ -59,6 +73,14 @@ int arch_monitor_domctl_op(struct domain *d, struct xen_domctl_monitor_op *mop)
         domain_unpause(d);
         break;
 
+    case XEN_DOMCTL_MONITOR_OP_ADD_ALLOWED_VALUE:
+        rc = arch_monitor_allow_value(d, mop, true);
+        break;
+
+    case XEN_DOMCTL_MONITOR_OP_REMOVE_ALLOWED_VALUE:
+        rc = arch_monitor_allow_value(d, mop, false);
+        break;
+
     default:
         rc = -EOPNOTSUPP;
     }
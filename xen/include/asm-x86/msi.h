@@ -123,6 +123,9 @@ struct msi_desc {
 	int remap_index;		/* index in interrupt remapping table */
 
 	struct msi_msg msg;		/* Last set MSI message */
+
+	struct msi_msg hw_msg;		/* Last value written to the device */
+	bool hw_msg_valid;
 };
 
 /*
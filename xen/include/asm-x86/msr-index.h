@@ -338,6 +338,7 @@
 #define MSR_X2APIC_TPR                  0x00000808
 #define MSR_X2APIC_PPR                  0x0000080a
 #define MSR_X2APIC_EOI                  0x0000080b
+#define MSR_X2APIC_ICR                  0x00000830
 #define MSR_X2APIC_TMICT                0x00000838
 #define MSR_X2APIC_TMCCT                0x00000839
 #define MSR_X2APIC_SELF                 0x0000083f
@@ -366,6 +367,11 @@
 #define MSR_IA32_TSC_DEADLINE		0x000006E0
 #define MSR_IA32_ENERGY_PERF_BIAS	0x000001b0
 
+/* Hardware-managed P-states (HWP) */
+#define MSR_IA32_PM_ENABLE		0x00000770
+#define MSR_IA32_HWP_CAPABILITIES	0x00000771
+#define MSR_IA32_HWP_REQUEST		0x00000774
+
 /* Platform Shared Resource MSRs */
 #define MSR_IA32_CMT_EVTSEL		0x00000c8d
 #define MSR_IA32_CMT_EVTSEL_UE_MASK	0x0000ffff
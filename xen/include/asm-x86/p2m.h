@@ -28,6 +28,8 @@
 
 #include <xen/paging.h>
 #include <xen/mem_access.h>
+#include <xen/timer.h>
+#include <xen/tasklet.h>
 #include <asm/mem_sharing.h>
 #include <asm/page.h>    /* for pagetable_t */
 
@@ -224,6 +226,19 @@ struct p2m_domain {
     /* Host p2m: Global log-dirty mode enabled for the domain. */
     bool               global_logdirty;
 
+#ifdef CONFIG_HVM
+    /*
+     * Host p2m: state of the opt-in background promotion scan which
+     * re-assembles runs of 4k mappings into superpages (see
+     * p2m_promote_enable()).  promote_gfn is the scan cursor; the timer
+     * paces the scan and hands the actual work to the tasklet.
+     */
+    bool               promote_enabled;
+    unsigned long      promote_gfn;
+    struct timer       promote_timer;
+    struct tasklet     promote_tasklet;
+#endif
+
     /* Host p2m: when this flag is set, don't flush all the nested-p2m 
      * tables on every host-p2m change.  The setter of this flag 
      * is responsible for performing the full flush before releasing the
@@ -338,6 +353,17 @@ struct p2m_domain {
             unsigned long list[NR_POD_MRP_ENTRIES];
             unsigned int idx;
         } mrp;
+
+        /*
+         * Populated GFNs evicted from the MRP list above.  Such pages
+         * were handed out zeroed not long ago, making them worthwhile
+         * reclaim candidates to try before falling back to a linear
+         * sweep of the p2m.
+         */
+        struct pod_candidate_list {
+            unsigned long    *ring;
+            unsigned int     idx, nr;
+        } cand;
         mm_lock_t        lock;         /* Locking of private pod structs,   *
                                         * not relying on the p2m lock.      */
     } pod;
@@ -582,6 +608,16 @@ int p2m_alloc_table(struct p2m_domain *p2m);
 void p2m_teardown(struct p2m_domain *p2m);
 void p2m_final_teardown(struct domain *d);
 
+/* Enable/disable the background superpage promotion scan. */
+#ifdef CONFIG_HVM
+int p2m_promote_enable(struct domain *d, bool enable);
+#else
+static inline int p2m_promote_enable(struct domain *d, bool enable)
+{
+    return -EOPNOTSUPP;
+}
+#endif
+
 /* Add a page to a domain's p2m table */
 int guest_physmap_add_entry(struct domain *d, gfn_t gfn,
                             mfn_t mfn, unsigned int page_order,
@@ -645,7 +681,8 @@ int clear_identity_p2m_entry(struct domain *d, unsigned long gfn);
 
 /* Add foreign mapping to the guest's p2m table. */
 int p2m_add_foreign(struct domain *tdom, unsigned long fgfn,
-                    unsigned long gpfn, domid_t foreign_domid);
+                    unsigned long gpfn, domid_t foreign_domid,
+                    unsigned int order);
 
 /* 
  * Populate-on-demand
@@ -936,9 +973,20 @@ static inline int p2m_entry_modify(struct p2m_domain *p2m, p2m_type_t nt,
                                    p2m_type_t ot, mfn_t nfn, mfn_t ofn,
                                    unsigned int level)
 {
-    BUG_ON(level > 1 && (nt == p2m_ioreq_server || nt == p2m_map_foreign));
+    unsigned long i, npages = level == 2 ? 1UL << PAGE_ORDER_2M : 1;
+
+    BUG_ON(level > 1 && nt == p2m_ioreq_server);
+    /* Foreign mappings may use 2M entries, but nothing larger. */
+    BUG_ON(level > 2 && nt == p2m_map_foreign);
 
-    if ( level != 1 || (nt == ot && mfn_eq(nfn, ofn)) )
+    if ( level > 2 || (nt == ot && mfn_eq(nfn, ofn)) )
+        return 0;
+
+    /*
+     * Only foreign mappings need accounting above 4K: intermediate page
+     * tables and all other superpage types can be ignored here.
+     */
+    if ( level == 2 && nt != p2m_map_foreign && ot != p2m_map_foreign )
         return 0;
 
     switch ( nt )
@@ -958,8 +1006,13 @@ static inline int p2m_entry_modify(struct p2m_domain *p2m, p2m_type_t nt,
             return -EINVAL;
         }
 
-        if ( !page_get_owner_and_reference(mfn_to_page(nfn)) )
-            return -EBUSY;
+        for ( i = 0; i < npages; i++ )
+            if ( !page_get_owner_and_reference(mfn_to_page(mfn_add(nfn, i))) )
+            {
+                while ( i-- )
+                    put_page(mfn_to_page(mfn_add(nfn, i)));
+                return -EBUSY;
+            }
 
         break;
 
@@ -980,7 +1033,8 @@ static inline int p2m_entry_modify(struct p2m_domain *p2m, p2m_type_t nt,
             ASSERT_UNREACHABLE();
             return -EINVAL;
         }
-        put_page(mfn_to_page(ofn));
+        for ( i = 0; i < npages; i++ )
+            put_page(mfn_to_page(mfn_add(ofn, i)));
         break;
 
     default:
@@ -226,6 +226,7 @@ typedef struct { u64 pfn; } pagetable_t;
 #define pagetable_null()        pagetable_from_pfn(0)
 
 void clear_page_sse2(void *);
+void clear_page_clzero(void *);
 void copy_page_sse2(void *, const void *);
 
 #define clear_page(_p)      clear_page_sse2(_p)
@@ -8,6 +8,14 @@ PERFCOUNTER_ARRAY(exceptions,           "exceptions", 32)
 #define VMX_PERF_VECTOR_SIZE 0x20
 PERFCOUNTER_ARRAY(vmexits,              "vmexits", VMX_PERF_EXIT_REASON_SIZE)
 PERFCOUNTER_ARRAY(cause_vector,         "cause vector", VMX_PERF_VECTOR_SIZE)
+PERFCOUNTER(pi_ndst_suppressed,         "PI NDST updates suppressed")
+PERFCOUNTER(pi_wakeup_intr,             "PI wakeup interrupts")
+PERFCOUNTER(pi_notify_in_root,          "PI notifications in root mode")
+PERFCOUNTER(dpci_deliver_msi,           "dpci: MSIs delivered through Xen")
+PERFCOUNTER(dpci_deliver_intx,          "dpci: INTx delivered through Xen")
+PERFCOUNTER(vmexit_fastpathed,          "vmexits handled on the fast path")
+PERFCOUNTER(decode_cache_hit,           "emulation decode cache hits")
+PERFCOUNTER(decode_cache_miss,          "emulation decode cache misses")
 
 #define VMEXIT_NPF_PERFC 141
 #define SVM_PERF_EXIT_REASON_SIZE (1+141)
@@ -17,13 +25,23 @@ PERFCOUNTER(seg_fixups,             "segmentation fixups")
 
 PERFCOUNTER(apic_timer,             "apic timer interrupts")
 
+PERFCOUNTER(vpt_save,               "vpt saves walking the timer list")
+PERFCOUNTER(vpt_save_skip,          "vpt saves with no active timers")
+PERFCOUNTER(vpt_restore,            "vpt restores walking the timer list")
+PERFCOUNTER(vpt_restore_skip,       "vpt restores with no active timers")
+PERFCOUNTER_ARRAY(vpt_list_len,     "vpt timer list length (7 = 7+)", 8)
+
 PERFCOUNTER(domain_page_tlb_flush,  "domain page tlb flushes")
+PERFCOUNTER(domain_page_wrap,       "domain page cache wraps")
+PERFCOUNTER(domain_page_inv_addr,   "domain page single-address invalidations")
 
 PERFCOUNTER(calls_to_mmuext_op,         "calls to mmuext_op")
 PERFCOUNTER(num_mmuext_ops,             "mmuext ops")
 PERFCOUNTER(calls_to_mmu_update,        "calls to mmu_update")
 PERFCOUNTER(num_page_updates,           "page updates")
 PERFCOUNTER(writable_mmu_updates,       "mmu_updates of writable pages")
+PERFCOUNTER(pgt_split_enter,            "pages entering split type count")
+PERFCOUNTER(pgt_split_fold,             "split type count folds")
 PERFCOUNTER(calls_to_update_va,         "calls to update_va_map")
 PERFCOUNTER(page_faults,            "page faults")
 PERFCOUNTER(copy_user_faults,       "copy_user faults")
@@ -32,6 +50,23 @@ PERFCOUNTER(map_domain_page_count,  "map_domain_page count")
 PERFCOUNTER(ptwr_emulations,        "writable pt emulations")
 PERFCOUNTER(mmio_ro_emulations,     "mmio ro emulations")
 
+PERFCOUNTER(hap_npf_fast,           "HAP NPFs on the fast path")
+PERFCOUNTER(hap_npf_ram,            "HAP NPFs on RAM (populate/log-dirty)")
+PERFCOUNTER(hap_npf_mmio,           "HAP NPFs sent to the device model")
+PERFCOUNTER(hap_npf_access,         "HAP NPF access violations")
+PERFCOUNTER(hap_npf_paged,          "HAP NPFs on paged-out pages")
+PERFCOUNTER(hap_npf_unshare,        "HAP NPF unshares")
+
+PERFCOUNTER(monitor_value_filtered, "monitor events suppressed by value filter")
+
+PERFCOUNTER(p2m_promote_2m,         "p2m 2M superpage promotions")
+
+#define ALTP2M_PERF_VIEW_SIZE 10 /* MAX_ALTP2M */
+PERFCOUNTER_ARRAY(altp2m_switch_view,   "altp2m switches to view",
+                  ALTP2M_PERF_VIEW_SIZE)
+PERFCOUNTER_ARRAY(altp2m_npf_view,      "altp2m NPFs in view",
+                  ALTP2M_PERF_VIEW_SIZE)
+
 PERFCOUNTER(exception_fixed,        "pre-exception fixed")
 
 PERFCOUNTER(guest_walk,            "guest pagetable walks")
@@ -117,4 +152,7 @@ PERFCOUNTER(realmode_exits,      "vmexits from realmode")
 
 PERFCOUNTER(pauseloop_exits, "vmexits from Pause-Loop Detection")
 
+PERFCOUNTER(vlapic_ipi_cache_hit,  "vlapic IPI dest cache hits")
+PERFCOUNTER(vlapic_ipi_cache_miss, "vlapic IPI dest cache misses")
+
 /*#endif*/ /* __XEN_PERFC_DEFN_H__ */
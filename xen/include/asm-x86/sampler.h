@@ -0,0 +1,22 @@
+/******************************************************************************
+ * asm-x86/sampler.h
+ *
+ * NMI-driven IP sampling with per-domain attribution.
+ */
+
+#ifndef __ASM_X86_SAMPLER_H__
+#define __ASM_X86_SAMPLER_H__
+
+#include <xen/types.h>
+#include <public/sysctl.h>
+
+struct cpu_user_regs;
+
+extern bool sampler_enabled;
+
+/* Record a sample; called from the watchdog NMI handler. */
+void sampler_tick(const struct cpu_user_regs *regs);
+
+int sampler_control(struct xen_sysctl_sampler_op *op);
+
+#endif /* __ASM_X86_SAMPLER_H__ */
@@ -0,0 +1,46 @@
+#ifndef __X86_STATIC_BRANCH_H__
+#define __X86_STATIC_BRANCH_H__
+
+#include <xen/types.h>
+
+struct static_branch;
+
+/*
+ * Descriptor of one patch site, emitted into .static_branch by
+ * arch_static_branch() below.  All fields are relative to their own
+ * position, as for struct alt_instr, so the table needs no relocations.
+ */
+struct static_branch_entry {
+    int32_t orig_offset;    /* patched instruction */
+    int32_t target_offset;  /* jump target when enabled */
+    int32_t key_offset;     /* struct static_branch tested by this site */
+};
+
+/* The cast via unsigned long stops gcc reasoning about object bounds. */
+#define __SB_PTR(e, f)      ((void *)((unsigned long)&(e)->f + (e)->f))
+#define SB_ORIG_PTR(e)      ((uint8_t *)__SB_PTR(e, orig_offset))
+#define SB_TARGET_PTR(e)    ((uint8_t *)__SB_PTR(e, target_offset))
+#define SB_KEY_PTR(e)       ((struct static_branch *)__SB_PTR(e, key_offset))
+
+/* Sites are 5 bytes: either a long nop or a jmp rel32. */
+#define STATIC_BRANCH_INSN_LEN 5
+
+static always_inline bool arch_static_branch(const struct static_branch *sb)
+{
+    asm goto ( "1: .byte 0x0f, 0x1f, 0x44, 0x00, 0x00\n\t" /* P6_NOP5 */
+               ".pushsection .static_branch, \"a\", @progbits\n\t"
+               ".balign 4\n\t"
+               ".long 1b - .\n\t"
+               ".long %l[t_yes] - .\n\t"
+               ".long %c[sb] - .\n\t"
+               ".popsection"
+               : : [sb] "i" (sb) : : t_yes );
+
+    return false;
+ t_yes:
+    return true;
+}
+
+void arch_static_branch_patch(const struct static_branch_entry *e, bool enable);
+
+#endif /* __X86_STATIC_BRANCH_H__ */
@@ -23,9 +23,6 @@
 #define xchg(ptr,v) \
     ((__typeof__(*(ptr)))__xchg((unsigned long)(v),(ptr),sizeof(*(ptr))))
 
-struct __xchg_dummy { unsigned long a[100]; };
-#define __xg(x) ((volatile struct __xchg_dummy *)(x))
-
 #include <asm/x86_64/system.h>
 
 /*
@@ -41,25 +38,25 @@ static always_inline unsigned long __xchg(
     case 1:
         asm volatile ( "xchgb %b0,%1"
                        : "=q" (x)
-                       : "m" (*__xg(ptr)), "0" (x)
+                       : "m" (*(volatile uint8_t *)ptr), "0" (x)
                        : "memory" );
         break;
     case 2:
         asm volatile ( "xchgw %w0,%1"
                        : "=r" (x)
-                       : "m" (*__xg(ptr)), "0" (x)
+                       : "m" (*(volatile uint16_t *)ptr), "0" (x)
                        : "memory" );
         break;
     case 4:
         asm volatile ( "xchgl %k0,%1"
                        : "=r" (x)
-                       : "m" (*__xg(ptr)), "0" (x)
+                       : "m" (*(volatile uint32_t *)ptr), "0" (x)
                        : "memory" );
         break;
     case 8:
         asm volatile ( "xchgq %0,%1"
                        : "=r" (x)
-                       : "m" (*__xg(ptr)), "0" (x)
+                       : "m" (*(volatile uint64_t *)ptr), "0" (x)
                        : "memory" );
         break;
     }
@@ -81,28 +78,28 @@ static always_inline unsigned long __cmpxchg(
     case 1:
         asm volatile ( "lock; cmpxchgb %b1,%2"
                        : "=a" (prev)
-                       : "q" (new), "m" (*__xg(ptr)),
+                       : "q" (new), "m" (*(volatile uint8_t *)ptr),
                        "0" (old)
                        : "memory" );
         return prev;
     case 2:
         asm volatile ( "lock; cmpxchgw %w1,%2"
                        : "=a" (prev)
-                       : "r" (new), "m" (*__xg(ptr)),
+                       : "r" (new), "m" (*(volatile uint16_t *)ptr),
                        "0" (old)
                        : "memory" );
         return prev;
     case 4:
         asm volatile ( "lock; cmpxchgl %k1,%2"
                        : "=a" (prev)
-                       : "r" (new), "m" (*__xg(ptr)),
+                       : "r" (new), "m" (*(volatile uint32_t *)ptr),
                        "0" (old)
                        : "memory" );
         return prev;
     case 8:
         asm volatile ( "lock; cmpxchgq %1,%2"
                        : "=a" (prev)
-                       : "r" (new), "m" (*__xg(ptr)),
+                       : "r" (new), "m" (*(volatile uint64_t *)ptr),
                        "0" (old)
                        : "memory" );
         return prev;
@@ -162,22 +159,22 @@ static always_inline unsigned long __xadd(
     {
     case 1:
         asm volatile ( "lock; xaddb %b0,%1"
-                       : "+r" (v), "+m" (*__xg(ptr))
+                       : "+r" (v), "+m" (*(volatile uint8_t *)ptr)
                        :: "memory");
         return v;
     case 2:
         asm volatile ( "lock; xaddw %w0,%1"
-                       : "+r" (v), "+m" (*__xg(ptr))
+                       : "+r" (v), "+m" (*(volatile uint16_t *)ptr)
                        :: "memory");
         return v;
     case 4:
         asm volatile ( "lock; xaddl %k0,%1"
-                       : "+r" (v), "+m" (*__xg(ptr))
+                       : "+r" (v), "+m" (*(volatile uint32_t *)ptr)
                        :: "memory");
         return v;
     case 8:
         asm volatile ( "lock; xaddq %q0,%1"
-                       : "+r" (v), "+m" (*__xg(ptr))
+                       : "+r" (v), "+m" (*(volatile uint64_t *)ptr)
                        :: "memory");
 
         return v;
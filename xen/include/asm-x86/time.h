@@ -73,4 +73,7 @@ struct time_scale;
 void set_time_scale(struct time_scale *ts, u64 ticks_per_sec);
 u64 scale_delta(u64 delta, const struct time_scale *scale);
 
+/* MFN of the shared time page (XEN_SYSCTL_timepage_info), or 0. */
+unsigned long timepage_mfn(void);
+
 #endif /* __X86_TIME_H__ */
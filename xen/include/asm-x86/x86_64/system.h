@@ -25,7 +25,7 @@ static always_inline __uint128_t __cmpxchg16b(
 
     /* Don't use "=A" here - clang can't deal with that. */
     asm volatile ( "lock; cmpxchg16b %2"
-                   : "=d" (prev.hi), "=a" (prev.lo), "+m" (*__xg(ptr))
+                   : "=d" (prev.hi), "=a" (prev.lo), "+m" (*(volatile __uint128_t *)ptr)
                    : "c" (new.hi), "b" (new.lo), "0" (old.hi), "1" (old.lo) );
 
     return prev.raw;
@@ -74,7 +74,7 @@ static always_inline __uint128_t cmpxchg16b_local_(
         ".previous\n"                                                   \
         _ASM_EXTABLE(1b, 3b)                                            \
         : "=a" (_o), "=r" (_rc)                                         \
-        : _regtype (_n), "m" (*__xg((volatile void *)_p)), "0" (_o), "1" (0) \
+        : _regtype (_n), "m" (*(_p)), "0" (_o), "1" (0)                 \
         : "memory");                                                    \
     clac()
 
@@ -73,6 +73,10 @@
 #define _XEN_CPUID_FEAT1_MMU_PT_UPDATE_PRESERVE_AD 0
 #define XEN_CPUID_FEAT1_MMU_PT_UPDATE_PRESERVE_AD  (1u<<0)
 
+/* Does the host support HVMOP_flush_tlb_vcpus for this (HVM) guest? */
+#define _XEN_CPUID_FEAT1_HVM_PV_TLB_FLUSH          1
+#define XEN_CPUID_FEAT1_HVM_PV_TLB_FLUSH           (1u<<1)
+
 /*
  * Leaf 4 (0x40000x03)
  * Sub-leaf 0: EAX: bit 0: emulated tsc
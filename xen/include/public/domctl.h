@@ -38,7 +38,7 @@
 #include "hvm/save.h"
 #include "memory.h"
 
-#define XEN_DOMCTL_INTERFACE_VERSION 0x00000011
+#define XEN_DOMCTL_INTERFACE_VERSION 0x00000012
 
 /*
  * NB. xen_domctl.domain is an IN/OUT parameter for this operation.
@@ -172,6 +172,18 @@ struct xen_domctl_getpageframeinfo3 {
 #define XEN_DOMCTL_SHADOW_OP_CLEAN       11
  /* Return the bitmap but do not modify internal copy. */
 #define XEN_DOMCTL_SHADOW_OP_PEEK        12
+ /*
+  * Return the list of pfns dirtied since the previous round and clean the
+  * log for the next one, making the cost of an iteration proportional to
+  * the dirty set rather than to the guest size.  The dirty_bitmap handle
+  * is interpreted as an array of uint64_t pfn entries, with 'pages' the
+  * number of entries it has room for on input and the number of entries
+  * written on output.  Fails with -ENODATA on the first invocation (pfns
+  * are only tracked from then on) and with -ENOBUFS when the dirty set
+  * outgrew either the internal list or the supplied buffer; in both cases
+  * the caller must use OP_CLEAN for that round.
+  */
+#define XEN_DOMCTL_SHADOW_OP_CLEAN_LIST  13
 
 /* Memory allocation accessors. */
 #define XEN_DOMCTL_SHADOW_OP_GET_ALLOCATION   30
@@ -844,6 +856,12 @@ struct xen_domctl_vm_event_op {
     uint32_t       mode;         /* XEN_DOMCTL_VM_EVENT_OP_* */
 
     uint32_t port;              /* OUT: event channel for ring */
+    /*
+     * IN, XEN_VM_EVENT_ENABLE only: order of the shared ring.  The ring
+     * occupies 1 << ring_order contiguous gfns starting at the relevant
+     * HVM_PARAM_*_RING_PFN.  0 requests the traditional single page.
+     */
+    uint32_t ring_order;
 };
 
 /*
@@ -1010,6 +1028,13 @@ struct xen_domctl_psr_cmt_op {
 #define XEN_DOMCTL_MONITOR_OP_DISABLE           1
 #define XEN_DOMCTL_MONITOR_OP_GET_CAPABILITIES  2
 #define XEN_DOMCTL_MONITOR_OP_EMULATE_EACH_REP  3
+/*
+ * Add/remove a value to/from the allowlist of a monitored control
+ * register or MSR.  Writes of an allowed value are resolved in the
+ * hypervisor without sending an event.
+ */
+#define XEN_DOMCTL_MONITOR_OP_ADD_ALLOWED_VALUE     4
+#define XEN_DOMCTL_MONITOR_OP_REMOVE_ALLOWED_VALUE  5
 
 #define XEN_DOMCTL_MONITOR_EVENT_WRITE_CTRLREG         0
 #define XEN_DOMCTL_MONITOR_EVENT_MOV_TO_MSR            1
@@ -1074,6 +1099,18 @@ struct xen_domctl_monitor_op {
             /* Pause vCPU until response */
             uint8_t sync;
         } debug_exception;
+
+        /*
+         * For XEN_DOMCTL_MONITOR_OP_{ADD,REMOVE}_ALLOWED_VALUE, with
+         * event set to WRITE_CTRLREG or MOV_TO_MSR.
+         */
+        struct {
+            /* Control register index or MSR, depending on event */
+            uint32_t index;
+            uint32_t pad;
+            /* Value never forwarded to the monitor ring */
+            uint64_aligned_t value;
+        } allowed_value;
     } u;
 };
 
@@ -1093,6 +1130,79 @@ struct xen_domctl_psr_alloc {
     uint64_t data;      /* IN/OUT */
 };
 
+/* XEN_DOMCTL_get_runstate_times */
+/*
+ * Aggregate vCPU runstate times (see VCPUOP_get_runstate_info) across a
+ * whole domain, in nanoseconds.  Cheap enough to poll for always-on
+ * per-domain CPU accounting.
+ */
+struct xen_domctl_runstate_times {
+    /* OUT */
+    uint64_aligned_t running;
+    uint64_aligned_t runnable;
+    uint64_aligned_t blocked;
+    uint64_aligned_t offline;
+};
+
+/* XEN_DOMCTL_superpage_promotion */
+/*
+ * Enable or disable the background scan which re-assembles runs of 4k p2m
+ * mappings into 2M superpages for a HAP domain.  Only runs which are
+ * already physically contiguous and uniformly typed are promoted.
+ */
+struct xen_domctl_superpage_promotion {
+    uint8_t enable;     /* IN: non-zero to enable the promotion scan. */
+    uint8_t pad[7];     /* IN: must be zero. */
+};
+
+/* XEN_DOMCTL_set_wakeup_latency */
+/*
+ * Advise the idle governor of the worst wakeup latency this domain can
+ * tolerate.  CPUs the domain may run on will not enter C-states with a
+ * larger exit latency.  Zero removes the hint.
+ */
+struct xen_domctl_set_wakeup_latency {
+    uint32_t latency_us; /* IN */
+};
+
+/* XEN_DOMCTL_evtchn_fifo_lat */
+/*
+ * Wake-latency histograms for the FIFO event channel ABI: the time from
+ * an event making a queue ready until the notified vCPU next runs,
+ * bucketed per queue priority by power-of-two microseconds (bucket i
+ * counts latencies below 2^i us; the last bucket catches the rest).
+ */
+struct xen_domctl_evtchn_fifo_lat {
+#define XEN_DOMCTL_EVTCHN_FIFO_LAT_enable   0
+#define XEN_DOMCTL_EVTCHN_FIFO_LAT_disable  1
+#define XEN_DOMCTL_EVTCHN_FIFO_LAT_read     2
+    uint32_t op;         /* IN */
+    /* IN/OUT: uint64 slots in @counts / slots available for reading. */
+    uint32_t nr_counts;
+    /* OUT: counts in [priority][bucket] order, row-major. */
+    XEN_GUEST_HANDLE_64(uint64) counts;
+};
+
+/* XEN_DOMCTL_getvcpucontexts */
+/*
+ * Fetch the contexts of a range of vCPUs with a single domain pause, so
+ * the individual contexts are mutually consistent.  @ctxt is an array of
+ * at least @nr_vcpus elements; for 32-bit PV domains each element holds
+ * a compat context at offset zero.  Slots of vCPUs which do not exist or
+ * are not initialised are skipped, with the corresponding bit in @valid
+ * left clear.
+ */
+struct xen_domctl_vcpucontexts {
+    uint32_t first_vcpu;      /* IN */
+    /*
+     * IN/OUT: number of contexts requested / covered by this call
+     * (at most 64; issue further calls for larger domains).
+     */
+    uint32_t nr_vcpus;
+    uint64_aligned_t valid;   /* OUT: bitmap of slots actually written */
+    XEN_GUEST_HANDLE_64(vcpu_guest_context_t) ctxt; /* OUT */
+};
+
 /* XEN_DOMCTL_vuart_op */
 struct xen_domctl_vuart_op {
 #define XEN_DOMCTL_VUART_OP_INIT  0
@@ -1194,6 +1304,11 @@ struct xen_domctl {
 /* #define XEN_DOMCTL_set_gnttab_limits          80 - Moved into XEN_DOMCTL_createdomain */
 #define XEN_DOMCTL_vuart_op                      81
 #define XEN_DOMCTL_get_cpu_policy                82
+#define XEN_DOMCTL_get_runstate_times            83
+#define XEN_DOMCTL_superpage_promotion           84
+#define XEN_DOMCTL_set_wakeup_latency            85
+#define XEN_DOMCTL_evtchn_fifo_lat               86
+#define XEN_DOMCTL_getvcpucontexts               87
 #define XEN_DOMCTL_gdbsx_guestmemio            1000
 #define XEN_DOMCTL_gdbsx_pausevcpu             1001
 #define XEN_DOMCTL_gdbsx_unpausevcpu           1002
@@ -1255,6 +1370,11 @@ struct xen_domctl {
         struct xen_domctl_monitor_op        monitor_op;
         struct xen_domctl_psr_alloc         psr_alloc;
         struct xen_domctl_vuart_op          vuart_op;
+        struct xen_domctl_runstate_times    runstate_times;
+        struct xen_domctl_superpage_promotion superpage_promotion;
+        struct xen_domctl_set_wakeup_latency set_wakeup_latency;
+        struct xen_domctl_evtchn_fifo_lat   evtchn_fifo_lat;
+        struct xen_domctl_vcpucontexts      vcpucontexts;
         uint8_t                             pad[128];
     } u;
 };
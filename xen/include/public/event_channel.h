@@ -74,6 +74,7 @@
 #define EVTCHNOP_init_control    11
 #define EVTCHNOP_expand_array    12
 #define EVTCHNOP_set_priority    13
+#define EVTCHNOP_send_batch      14
 /* ` } */
 
 typedef uint32_t evtchn_port_t;
@@ -312,6 +313,21 @@ struct evtchn_set_priority {
 };
 typedef struct evtchn_set_priority evtchn_set_priority_t;
 
+/*
+ * EVTCHNOP_send_batch: Send an event to the remote end of each of the
+ * channels whose local endpoints are given in <port>.  Notifications to
+ * the same remote VCPU are coalesced into (typically) a single upcall.
+ * Processing stops at the first port which fails to send; ports before
+ * it will have been signalled.
+ */
+#define EVTCHN_SEND_BATCH_MAX 31
+struct evtchn_send_batch {
+    /* IN parameters. */
+    uint32_t nr_ports;
+    evtchn_port_t port[EVTCHN_SEND_BATCH_MAX];
+};
+typedef struct evtchn_send_batch evtchn_send_batch_t;
+
 /*
  * ` enum neg_errnoval
  * ` HYPERVISOR_event_channel_op_compat(struct evtchn_op *op)
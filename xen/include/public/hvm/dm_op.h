@@ -139,7 +139,22 @@ struct xen_dm_op_get_ioreq_server_info {
 struct xen_dm_op_ioreq_server_range {
     /* IN - server id */
     ioservid_t id;
-    uint16_t pad;
+    /* IN - flags (only valid for XEN_DMOP_map_io_range_to_ioreq_server) */
+    uint16_t flags;
+
+/*
+ * Complete writes to the range without waiting for the emulator to
+ * process them. Such writes are delivered over the buffered ioreq ring,
+ * so the IOREQ Server must handle buffered emulation, and the emulator
+ * must support the addr_ext buf_ioreq encoding (see public/hvm/ioreq.h)
+ * as the range may lie above 1MB. Reads, and writes which cannot be
+ * expressed on the ring, still use the synchronous ioreq path. Only
+ * valid for port and memory ranges.
+ */
+#define _XEN_DMOP_IO_RANGE_POSTED_WRITE 0
+#define XEN_DMOP_IO_RANGE_POSTED_WRITE \
+    (1u << _XEN_DMOP_IO_RANGE_POSTED_WRITE)
+
     /* IN - type of range */
     uint32_t type;
 # define XEN_DMOP_IO_RANGE_PORT   0 /* I/O port range */
@@ -353,6 +353,20 @@ struct xen_hvm_altp2m_op {
 typedef struct xen_hvm_altp2m_op xen_hvm_altp2m_op_t;
 DEFINE_XEN_GUEST_HANDLE(xen_hvm_altp2m_op_t);
 
+/*
+ * HVMOP_flush_tlb_vcpus: Flush the TLBs of the calling domain's vCPUs
+ * whose bit is set in vcpu_mask, on the caller's behalf.  vCPUs with ids
+ * beyond 63 are always flushed.  Unlike HVMOP_flush_tlbs this does not
+ * pause the target vCPUs; descheduled vCPUs are flushed lazily when they
+ * next run.  Availability is advertised via XEN_CPUID_FEAT1_HVM_PV_TLB_FLUSH.
+ */
+#define HVMOP_flush_tlb_vcpus 26
+struct xen_hvm_flush_tlb_vcpus {
+    uint64_t vcpu_mask;
+};
+typedef struct xen_hvm_flush_tlb_vcpus xen_hvm_flush_tlb_vcpus_t;
+DEFINE_XEN_GUEST_HANDLE(xen_hvm_flush_tlb_vcpus_t);
+
 #endif /* __XEN_PUBLIC_HVM_HVM_OP_H__ */
 
 /*
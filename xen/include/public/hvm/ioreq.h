@@ -71,9 +71,16 @@ struct shared_iopage {
 };
 typedef struct shared_iopage shared_iopage_t;
 
+/*
+ * A buffered ioreq may occupy multiple consecutive slots:
+ *  - If addr_ext is set, the next slot's data field carries physical
+ *    address bits [51:20] (addr then only holds bits [19:0]).
+ *  - A size of 8 uses a further slot carrying data bits [63:32].
+ * The extra slots repeat the remaining fields of the first one.
+ */
 struct buf_ioreq {
     uint8_t  type;   /* I/O type                    */
-    uint8_t  pad:1;
+    uint8_t  addr_ext:1; /* high address bits follow in another slot */
     uint8_t  dir:1;  /* 1=read, 0=write             */
     uint8_t  size:2; /* 0=>1, 1=>2, 2=>4, 3=>8. If 8, use two buf_ioreqs */
     uint32_t addr:20;/* physical address            */
@@ -98,6 +105,28 @@ struct buffered_iopage {
 }; /* NB. Size of this structure must be no greater than one page. */
 typedef struct buffered_iopage buffered_iopage_t;
 
+/*
+ * Layout of the VGA dirty-rectangle page (HVM_PARAM_VGA_DIRTY_PFN).
+ *
+ * Xen extends the bounding box as the stdvga intercept buffers VRAM
+ * writes; the device model reads it each display refresh instead of
+ * scanning the whole framebuffer.  first/last are byte offsets into
+ * the legacy VRAM window (relative to 0xa0000), last inclusive.
+ *
+ * Protocol: Xen updates the box and then increments wseq.  The device
+ * model reads wseq, reads the box, and stores the wseq value it saw to
+ * ack.  When Xen finds ack == wseq on its next update it starts a
+ * fresh box; until then updates only ever grow the box, so a stale
+ * read is never missing older damage.
+ */
+struct vga_dirty_rect {
+    uint32_t wseq;    /* incremented by Xen after each box update */
+    uint32_t ack;     /* last wseq value consumed by the device model */
+    uint32_t first;   /* lowest dirty VRAM byte offset */
+    uint32_t last;    /* highest dirty VRAM byte offset (inclusive) */
+};
+typedef struct vga_dirty_rect vga_dirty_rect_t;
+
 /*
  * ACPI Control/Event register locations. Location is controlled by a
  * version number in HVM_PARAM_ACPI_IOPORTS_LOCATION.
@@ -288,6 +288,14 @@
 #define XEN_HVM_MCA_CAP_LMCE   (xen_mk_ullong(1) << 0)
 #define XEN_HVM_MCA_CAP_MASK   XEN_HVM_MCA_CAP_LMCE
 
-#define HVM_NR_PARAMS 39
+/*
+ * GFN of a guest frame to be used as the VGA dirty-rectangle page (see
+ * struct vga_dirty_rect in hvm/ioreq.h).  May only be set once, by the
+ * toolstack or device model, and only has an effect for domains with an
+ * emulated VGA.
+ */
+#define HVM_PARAM_VGA_DIRTY_PFN 39
+
+#define HVM_NR_PARAMS 40
 
 #endif /* __XEN_PUBLIC_HVM_PARAMS_H__ */
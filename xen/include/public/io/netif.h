@@ -160,6 +160,44 @@
  * be applied if it is set.
  */
 
+/*
+ * Persistent receive buffer pools
+ * ===============================
+ *
+ * In the default protocol every receive requires the backend to grant-copy
+ * (or map and unmap) the frontend's buffer, which costs a hypercall and,
+ * for mapping, a TLB flush per packet. A backend capable of keeping
+ * long-lived mappings of pre-granted frontend buffers advertises:
+ *
+ * /local/domain/X/backend/<domid>/<vif>/feature-persistent-rx-pool = "1"
+ *
+ * A frontend wishing to use the feature grants, for each queue, a pool
+ * descriptor page and writes (under the queue's sub-key when multiple
+ * queues are in use):
+ *
+ * /local/domain/<domid>/device/vif/<vif>/queue-N/rx-pool-ref = <gref>
+ * /local/domain/<domid>/device/vif/<vif>/queue-N/rx-pool-size = <count>
+ *
+ * where the descriptor page contains an array of <count> 32-bit grant
+ * references, each naming one page-sized receive buffer writable by the
+ * backend. These keys must be set before the frontend moves into the
+ * connected state, and the granted buffers must remain valid for the
+ * lifetime of the connection.
+ *
+ * The backend maps the whole pool once at connect time and keeps the
+ * mappings until disconnect, so received data can be written (or DMAd)
+ * directly into guest memory without per-packet map/copy operations.
+ * Receive responses identify the buffer by its index into the pool,
+ * carried in the response's 'id' field; the frontend returns ownership
+ * of a buffer to the backend by re-posting a receive request with that
+ * index as the request 'id'.
+ *
+ * On disconnect the backend must unmap the entire pool (batching the
+ * GNTTABOP_unmap_grant_ref operations) before the frontend may end
+ * foreign access on the buffer grants. The frontend must treat buffer
+ * contents as undefined once it has initiated disconnect.
+ */
+
 /*
  * Control ring
  * ============
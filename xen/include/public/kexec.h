@@ -71,17 +71,23 @@
  */
 
 /*
- * Kexec supports two types of operation:
+ * Kexec supports three types of operation:
  * - kexec into a regular kernel, very similar to a standard reboot
  *   - KEXEC_TYPE_DEFAULT is used to specify this type
  * - kexec into a special "crash kernel", aka kexec-on-panic
  *   - KEXEC_TYPE_CRASH is used to specify this type
  *   - parts of our system may be broken at kexec-on-panic time
  *     - the code should be kept as simple and self-contained as possible
+ * - kexec into a new hypervisor as a warm restart ("live update")
+ *   - KEXEC_TYPE_LIVE_UPDATE is used to specify this type
+ *   - uses the image loaded into the KEXEC_TYPE_DEFAULT slot, but a
+ *     state stream is staged in the "liveupdate=" reserved region
+ *     before the jump
  */
 
-#define KEXEC_TYPE_DEFAULT 0
-#define KEXEC_TYPE_CRASH   1
+#define KEXEC_TYPE_DEFAULT     0
+#define KEXEC_TYPE_CRASH       1
+#define KEXEC_TYPE_LIVE_UPDATE 2
 
 
 /* The kexec implementation for Xen allows the user to load two
@@ -227,6 +227,13 @@ DEFINE_XEN_GUEST_HANDLE(xen_machphys_mapping_t);
                                       Stage-2 using the Normal Memory
                                       Inner/Outer Write-Back Cacheable
                                       memory attribute. */
+#define XENMAPSPACE_gmfn_foreign_2m 6 /* 2Mb run of GMFNs from another dom,
+                                       * XENMEM_add_to_physmap_batch only.
+                                       * idx and gpfn must be 2Mb aligned;
+                                       * installed as a single superpage
+                                       * mapping where the foreign range is
+                                       * backed by contiguous RAM, falling
+                                       * back to 4k mappings otherwise. */
 /* ` } */
 
 /*
@@ -482,6 +489,7 @@ DEFINE_XEN_GUEST_HANDLE(xen_mem_access_op_t);
 #define XENMEM_sharing_op_add_physmap       6
 #define XENMEM_sharing_op_audit             7
 #define XENMEM_sharing_op_range_share       8
+#define XENMEM_sharing_op_clone             9
 
 #define XENMEM_SHARING_OP_S_HANDLE_INVALID  (-10)
 #define XENMEM_SHARING_OP_C_HANDLE_INVALID  (-9)
@@ -326,6 +326,59 @@ struct physdev_pci_device {
 typedef struct physdev_pci_device physdev_pci_device_t;
 DEFINE_XEN_GUEST_HANDLE(physdev_pci_device_t);
 
+/*
+ * On-demand IOMMU mapping interface for the hardware domain.
+ *
+ * When the hardware domain runs without a full 1:1 IOMMU table (i.e.
+ * "iommu=dom0-strict" and no passthrough mode), it may use this
+ * operation to establish and tear down DMA mappings on demand rather
+ * than having every page mapped up front. Each call carries a vector
+ * of entries; the IOTLB is flushed once per batch, after all entries
+ * have been processed.
+ *
+ * PVIOMMU_OP_query_caps returns PVIOMMU_CAP_* bits (0 when on-demand
+ * mapping is unavailable, e.g. in passthrough mode); 'entries' and
+ * 'nr_entries' are ignored. For map/unmap, nr_entries is updated on
+ * return to the number of entries fully processed.
+ */
+#define PHYSDEVOP_pviommu_op            32
+#if defined(__XEN__) || defined(__XEN_TOOLS__)
+
+#ifndef uint64_aligned_t
+#define uint64_aligned_t uint64_t
+#endif
+
+#define PVIOMMU_OP_query_caps   0
+#define PVIOMMU_OP_map          1
+#define PVIOMMU_OP_unmap        2
+
+#define PVIOMMU_CAP_map         (1u << 0)
+
+#define PVIOMMU_MAPF_readable   (1u << 0)
+#define PVIOMMU_MAPF_writable   (1u << 1)
+
+struct pviommu_map_entry {
+    /* IN */
+    uint64_aligned_t dfn;       /* device frame to map at */
+    uint64_aligned_t mfn;       /* machine frame to map (map only) */
+    uint32_t nr_frames;
+    uint32_t flags;             /* PVIOMMU_MAPF_* (map only) */
+};
+typedef struct pviommu_map_entry pviommu_map_entry_t;
+DEFINE_XEN_GUEST_HANDLE(pviommu_map_entry_t);
+
+struct physdev_pviommu_op {
+    /* IN */
+    uint16_t op;                /* PVIOMMU_OP_* */
+    uint16_t pad;               /* reserved, must be zero */
+    /* IN/OUT */
+    uint32_t nr_entries;
+    XEN_GUEST_HANDLE(pviommu_map_entry_t) entries;
+};
+typedef struct physdev_pviommu_op physdev_pviommu_op_t;
+DEFINE_XEN_GUEST_HANDLE(physdev_pviommu_op_t);
+#endif /* __XEN__ || __XEN_TOOLS__ */
+
 #define PHYSDEVOP_DBGP_RESET_PREPARE    1
 #define PHYSDEVOP_DBGP_RESET_DONE       2
 
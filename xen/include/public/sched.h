@@ -130,6 +130,23 @@
  * to be part of the domain's cpupool.
  */
 #define SCHEDOP_pin_override 7
+
+/*
+ * Register a persistent set of event-channel ports with the calling vcpu,
+ * for later use with SCHEDOP_poll_set. The new set replaces any previously
+ * registered one; registering zero ports removes the set. The timeout field
+ * is ignored.
+ * @arg == pointer to sched_poll_t structure.
+ */
+#define SCHEDOP_register_poll_set 8
+
+/*
+ * Poll the set of ports previously registered with SCHEDOP_register_poll_set.
+ * Return when one or more of them are pending, or when the optional timeout
+ * expires. nr_ports must be zero and the ports handle is ignored.
+ * @arg == pointer to sched_poll_t structure.
+ */
+#define SCHEDOP_poll_set    9
 /* ` } */
 
 struct sched_shutdown {
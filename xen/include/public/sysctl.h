@@ -36,7 +36,7 @@
 #include "physdev.h"
 #include "tmem.h"
 
-#define XEN_SYSCTL_INTERFACE_VERSION 0x00000012
+#define XEN_SYSCTL_INTERFACE_VERSION 0x00000013
 
 /*
  * Read console content from Xen buffer ring.
@@ -69,6 +69,8 @@ struct xen_sysctl_tbuf_op {
 #define XEN_SYSCTL_TBUFOP_set_size     3
 #define XEN_SYSCTL_TBUFOP_enable       4
 #define XEN_SYSCTL_TBUFOP_disable      5
+#define XEN_SYSCTL_TBUFOP_set_mute_mask 6 /* mask passed via evt_mask */
+#define XEN_SYSCTL_TBUFOP_get_drops    7
     uint32_t cmd;
     /* IN/OUT variables */
     struct xenctl_bitmap cpu_mask;
@@ -76,6 +78,9 @@ struct xen_sysctl_tbuf_op {
     /* OUT variables */
     uint64_aligned_t buffer_mfn;
     uint32_t size;  /* Also an IN variable! */
+    /* OUT variables (get_drops): cumulative counts across all CPUs. */
+    uint64_aligned_t lost_records;
+    uint64_aligned_t muted_records;
 };
 
 /*
@@ -223,21 +228,56 @@ struct pm_cx_stat {
     XEN_GUEST_HANDLE_64(uint64) cc;
 };
 
+/*
+ * Compact per-CPU residency digest, used both for bulk retrieval
+ * (PMSTAT_get_summary) and as the record layout of the telemetry page
+ * (PMSTAT_telem_enable).  In the latter case readers must retry while
+ * seq is odd or changes across the read.
+ */
+struct pm_telemetry_rec {
+    uint64_aligned_t seq;        /* odd while the record is being updated */
+    uint64_aligned_t timestamp;  /* ns since boot, at last refresh */
+    uint64_aligned_t idle_time;  /* ns spent idle (all Cx) since boot */
+#define XEN_PM_PX_MAX 16
+    uint64_aligned_t px_residency[XEN_PM_PX_MAX]; /* ns per P-state */
+    uint32_t cur_px;             /* current Px state, ~0 if unknown */
+    uint32_t last_cx;            /* last Cx state, ~0 if unknown */
+};
+typedef struct pm_telemetry_rec pm_telemetry_rec_t;
+DEFINE_XEN_GUEST_HANDLE(pm_telemetry_rec_t);
+
+struct pm_telemetry_op {
+    /* get_summary: IN: array capacity; OUT: entries (CPUs) written. */
+    /* telem_enable: OUT: number of shared pages. */
+    uint32_t nr;
+    /* telem_enable IN: refresh period in ms (0 selects the default). */
+    uint32_t period_ms;
+    /* telem_enable OUT: first MFN of the (contiguous) telemetry pages. */
+    uint64_aligned_t mfn;
+    /* get_summary IN: record array, indexed by CPU number. */
+    XEN_GUEST_HANDLE_64(pm_telemetry_rec_t) summaries;
+};
+
 struct xen_sysctl_get_pmstat {
 #define PMSTAT_CATEGORY_MASK 0xf0
 #define PMSTAT_PX            0x10
 #define PMSTAT_CX            0x20
+#define PMSTAT_TELEM         0x40
 #define PMSTAT_get_max_px    (PMSTAT_PX | 0x1)
 #define PMSTAT_get_pxstat    (PMSTAT_PX | 0x2)
 #define PMSTAT_reset_pxstat  (PMSTAT_PX | 0x3)
 #define PMSTAT_get_max_cx    (PMSTAT_CX | 0x1)
 #define PMSTAT_get_cxstat    (PMSTAT_CX | 0x2)
 #define PMSTAT_reset_cxstat  (PMSTAT_CX | 0x3)
+#define PMSTAT_get_summary   (PMSTAT_TELEM | 0x1)
+#define PMSTAT_telem_enable  (PMSTAT_TELEM | 0x2)
+#define PMSTAT_telem_disable (PMSTAT_TELEM | 0x3)
     uint32_t type;
     uint32_t cpuid;
     union {
         struct pm_px_stat getpx;
         struct pm_cx_stat getcx;
+        struct pm_telemetry_op telem;
         /* other struct for tx, etc */
     } u;
 };
@@ -344,6 +384,12 @@ struct xen_sysctl_pm_op {
     #define XEN_SYSCTL_pm_op_enable_turbo               0x26
     #define XEN_SYSCTL_pm_op_disable_turbo              0x27
 
+    /* set HWP energy-performance preference (0 - perf ... 255 - energy) */
+    #define XEN_SYSCTL_pm_op_set_hwp_epp                0x28
+
+    /* set per-cpu C-state type cap (0 = no cap, 1 = C1, ...) */
+    #define XEN_SYSCTL_pm_op_set_cpu_max_cstate         0x29
+
     uint32_t cmd;
     uint32_t cpuid;
     union {
@@ -354,6 +400,8 @@ struct xen_sysctl_pm_op {
         uint32_t                    set_sched_opt_smt;
         uint32_t                    get_max_cstate;
         uint32_t                    set_max_cstate;
+        uint32_t                    set_hwp_epp;
+        uint32_t                    set_cpu_max_cstate;
     } u;
 };
 
@@ -410,10 +458,17 @@ struct xen_sysctl_page_offline_op {
 /* Sub-operations: */
 #define XEN_SYSCTL_LOCKPROF_reset 1   /* Reset all profile data to zero. */
 #define XEN_SYSCTL_LOCKPROF_query 2   /* Get lock profile information. */
+#define XEN_SYSCTL_LOCKPROF_enable  3 /* Start data collection. */
+#define XEN_SYSCTL_LOCKPROF_disable 4 /* Stop data collection. */
 /* Record-type: */
 #define LOCKPROF_TYPE_GLOBAL      0   /* global lock, idx meaningless */
 #define LOCKPROF_TYPE_PERDOM      1   /* per-domain lock, idx is domid */
 #define LOCKPROF_TYPE_N           2   /* number of types */
+/*
+ * Wait-time histogram: bucket 0 counts waits of less than 1 usec, bucket n
+ * waits of [2^(n-1), 2^n) usecs, and the last bucket everything beyond.
+ */
+#define XEN_LOCKPROF_NR_HIST      16
 struct xen_sysctl_lockprof_data {
     char     name[40];     /* lock name (may include up to 2 %d specifiers) */
     int32_t  type;         /* LOCKPROF_TYPE_??? */
@@ -422,6 +477,7 @@ struct xen_sysctl_lockprof_data {
     uint64_aligned_t block_cnt;    /* # of wait for lock */
     uint64_aligned_t lock_time;    /* nsecs lock held */
     uint64_aligned_t block_time;   /* nsecs waited for lock */
+    uint64_aligned_t hist[XEN_LOCKPROF_NR_HIST]; /* wait time histogram */
 };
 typedef struct xen_sysctl_lockprof_data xen_sysctl_lockprof_data_t;
 DEFINE_XEN_GUEST_HANDLE(xen_sysctl_lockprof_data_t);
@@ -436,6 +492,296 @@ struct xen_sysctl_lockprof_op {
     XEN_GUEST_HANDLE_64(xen_sysctl_lockprof_data_t) data;
 };
 
+/* XEN_SYSCTL_hypercall_prof_op */
+/* Sub-operations: */
+#define XEN_SYSCTL_HYPERCALL_PROF_reset 1 /* Reset a domain's data to zero. */
+#define XEN_SYSCTL_HYPERCALL_PROF_query 2 /* Get hypercall profile data. */
+/*
+ * Latency histogram: bucket 0 counts dispatches completing in under 1 usec,
+ * bucket n those taking [2^(n-1), 2^n) usecs, the last bucket the rest.
+ */
+#define XEN_HYPERCALL_PROF_NR_HIST      16
+struct xen_sysctl_hypercall_prof_data {
+    uint32_t op;           /* hypercall number */
+    uint32_t pad;
+    uint64_aligned_t count;    /* # of dispatches */
+    uint64_aligned_t time;     /* nsecs spent in this hypercall */
+    uint64_aligned_t hist[XEN_HYPERCALL_PROF_NR_HIST]; /* latency histogram */
+};
+typedef struct xen_sysctl_hypercall_prof_data xen_sysctl_hypercall_prof_data_t;
+DEFINE_XEN_GUEST_HANDLE(xen_sysctl_hypercall_prof_data_t);
+struct xen_sysctl_hypercall_prof_op {
+    /* IN variables. */
+    uint32_t       cmd;       /* XEN_SYSCTL_HYPERCALL_PROF_??? */
+    domid_t        domain;    /* domain to query/reset */
+    uint16_t       pad;
+    uint32_t       max_elem;  /* size of output buffer */
+    /* OUT variables (query only). */
+    uint32_t       nr_elem;   /* number of elements available */
+    /* profile information (or NULL) */
+    XEN_GUEST_HANDLE_64(xen_sysctl_hypercall_prof_data_t) data;
+};
+
+/* XEN_SYSCTL_domperf_op */
+/* Sub-operations: */
+#define XEN_SYSCTL_DOMPERF_enable  1 /* Enable per-domain counting globally. */
+#define XEN_SYSCTL_DOMPERF_disable 2
+#define XEN_SYSCTL_DOMPERF_query   3 /* Get one domain's counters. */
+/*
+ * Counter indices in the query output.  New counters are appended; consumers
+ * should tolerate nr_elem being larger than they know about.
+ */
+#define XEN_DOMPERF_vmexits        0
+#define XEN_DOMPERF_hypercalls     1
+#define XEN_DOMPERF_grant_ops      2
+#define XEN_DOMPERF_evtchn_sends   3
+#define XEN_DOMPERF_NR             4
+struct xen_sysctl_domperf_op {
+    /* IN variables. */
+    uint32_t       cmd;       /* XEN_SYSCTL_DOMPERF_??? */
+    domid_t        domain;    /* domain to query (query only) */
+    uint16_t       pad;
+    uint32_t       max_elem;  /* size of output buffer */
+    /* OUT variables (query only). */
+    uint32_t       nr_elem;   /* number of counters available */
+    XEN_GUEST_HANDLE_64(uint64) data;
+};
+
+/* XEN_SYSCTL_sampler_op */
+/*
+ * Control the NMI-driven IP sampling engine.  Samples are delivered as
+ * TRC_SAMPLE records through the trace buffers, so tracing must be active
+ * (see XEN_SYSCTL_tbuf_op) for samples to be retained.
+ */
+/* Sub-operations: */
+#define XEN_SYSCTL_SAMPLER_enable  1 /* Start sampling at 'rate' Hz.     */
+#define XEN_SYSCTL_SAMPLER_disable 2
+#define XEN_SYSCTL_SAMPLER_query   3 /* Report status and sample counts. */
+struct xen_sysctl_sampler_op {
+    /* IN variables. */
+    uint32_t cmd;           /* XEN_SYSCTL_SAMPLER_??? */
+    uint32_t rate;          /* enable: samples/sec per CPU; 0 for default */
+    /* OUT variables (query only). */
+    uint32_t enabled;
+    uint32_t pad;
+    uint64_aligned_t nr_samples; /* samples recorded since enable */
+    uint64_aligned_t nr_dropped; /* samples lost to ring overflow */
+};
+
+/* XEN_SYSCTL_irq_stats */
+/*
+ * Report rate and CPU time figures for guest-bound (passthrough)
+ * interrupts.  Rates and times are only maintained while the in-hypervisor
+ * irq balancer is active ("irq_balance=" on the command line).
+ */
+struct xen_sysctl_irq_stat {
+    uint32_t irq;
+    uint32_t cpu;             /* current destination CPU */
+    uint32_t rate;            /* interrupts over the last balance interval */
+    uint32_t moves;           /* times the balancer retargeted the irq */
+    uint64_aligned_t time_ns; /* cumulative handling time */
+};
+typedef struct xen_sysctl_irq_stat xen_sysctl_irq_stat_t;
+DEFINE_XEN_GUEST_HANDLE(xen_sysctl_irq_stat_t);
+
+struct xen_sysctl_irq_stats {
+    uint32_t nr;              /* IN: capacity of stats; OUT: entries filled */
+    uint32_t pad;
+    XEN_GUEST_HANDLE_64(xen_sysctl_irq_stat_t) stats;
+};
+
+/* XEN_SYSCTL_domain_snapshot */
+/*
+ * Composite snapshot for fleet monitoring: per-domain info (as per
+ * XEN_DOMCTL_getdomaininfo) plus runstate records for every vcpu of the
+ * reported domains, in a single hypercall.  The vcpu records are a flat
+ * array; each carries its owning domid so the two arrays can be
+ * correlated.  @generation changes whenever a domain is created or
+ * destroyed, letting tools detect that a cached domain list is stale.
+ */
+struct xen_sysctl_vcpu_snapshot {
+    domid_t  domain;
+    uint16_t vcpu;
+    uint8_t  online;
+    uint8_t  blocked;
+    uint8_t  running;
+    uint8_t  pad;
+    uint32_t cpu;               /* current mapping */
+    uint32_t pad2;
+    uint64_aligned_t time[4];   /* ns spent in each runstate */
+};
+typedef struct xen_sysctl_vcpu_snapshot xen_sysctl_vcpu_snapshot_t;
+DEFINE_XEN_GUEST_HANDLE(xen_sysctl_vcpu_snapshot_t);
+
+struct xen_sysctl_domain_snapshot {
+    /* IN variables. */
+    domid_t  first_domain;
+    uint16_t pad;
+    uint32_t max_domains;       /* capacity of @domains */
+    uint32_t max_vcpus;         /* capacity of @vcpus */
+    /* OUT variables. */
+    uint32_t num_domains;
+    uint32_t num_vcpus;
+    uint32_t pad2;
+    uint64_aligned_t generation; /* domain list generation at snapshot */
+    XEN_GUEST_HANDLE_64(xen_domctl_getdomaininfo_t) domains;
+    XEN_GUEST_HANDLE_64(xen_sysctl_vcpu_snapshot_t) vcpus;
+};
+
+/* XEN_SYSCTL_statspage_op */
+/*
+ * Host-global statistics area.  When enabled, the hypervisor shares a
+ * contiguous run of pages read-only with privileged guests (map the
+ * reported MFNs with DOMID_XEN, as done for the trace metadata page)
+ * and refreshes one record per domain in them periodically, so sampling
+ * tools such as xentop read statistics without issuing any hypercalls.
+ *
+ * @generation in the header is a seqcount: it is odd while a refresh is
+ * in progress, and readers should retry if it changed across their read.
+ */
+struct xen_statspage_entry {
+    domid_t  domain;
+    uint16_t pad;
+    uint32_t nr_vcpus;                 /* online vcpus */
+    uint64_aligned_t tot_pages;
+    uint64_aligned_t max_pages;
+    uint64_aligned_t cpu_time;         /* ns running, summed over vcpus */
+    uint64_aligned_t runstate_time[4]; /* ns per runstate, summed */
+};
+
+struct xen_statspage_header {
+    uint64_aligned_t generation;  /* odd => refresh in progress */
+    uint64_aligned_t last_update; /* system time (ns) of last refresh */
+    uint32_t nr_entries;          /* entries currently valid */
+    uint32_t capacity;            /* entries the area can hold */
+    uint32_t period_ms;           /* refresh period */
+    uint32_t pad;
+    /* Followed by @capacity struct xen_statspage_entry records. */
+};
+
+#define XEN_SYSCTL_STATSPAGE_enable   0
+#define XEN_SYSCTL_STATSPAGE_disable  1
+#define XEN_SYSCTL_STATSPAGE_get_info 2
+struct xen_sysctl_statspage_op {
+    uint32_t cmd;         /* XEN_SYSCTL_STATSPAGE_* */
+    /* IN variables (enable only). */
+    uint32_t capacity;    /* minimum number of domains to cover; 0 = default */
+    uint32_t period_ms;   /* refresh period; 0 = default */
+    /* OUT variables (get_info only). */
+    uint32_t nr_pages;
+    uint64_aligned_t mfn; /* first MFN of the shared area */
+};
+
+/* XEN_SYSCTL_timepage_info */
+/*
+ * Host time parameters page.  The hypervisor shares one page read-only
+ * with privileged guests (map the reported MFN with DOMID_XEN) holding
+ * the TSC-to-system-time conversion it maintains for the boot CPU, so
+ * tools can convert raw TSC values (e.g. xentrace cycle stamps) to Xen
+ * system time without issuing hypercalls or guessing the clock rate.
+ *
+ * system_time = tp->system_time +
+ *               (((tsc - tp->tsc_timestamp) * tp->tsc_to_system_mul)
+ *                >> (32 - tp->tsc_shift))
+ * (a negative tsc_shift means shifting right by a further -tsc_shift.)
+ *
+ * @version is a seqcount: odd while an update is in progress; readers
+ * should retry if it changed across their read.
+ */
+struct xen_timepage {
+    uint32_t version;
+    uint32_t pad;
+    uint64_aligned_t tsc_timestamp;   /* TSC at last calibration */
+    uint64_aligned_t system_time;     /* system time (ns) at same instant */
+    uint32_t tsc_to_system_mul;
+    int8_t   tsc_shift;
+    int8_t   pad1[3];
+};
+
+struct xen_sysctl_timepage_info {
+    /* OUT variables. */
+    uint64_aligned_t mfn; /* MFN of the shared time page */
+};
+
+/* XEN_SYSCTL_memprof */
+/*
+ * Hypervisor heap profiling.  Reports the xmalloc() pool totals, the
+ * per-allocation-site counters maintained by the allocator (a site is
+ * the caller address of xmalloc()/xzalloc(), to be resolved against
+ * xen-syms), and the pages currently assigned to each domain from the
+ * domain and xen heaps.
+ *
+ * live_bytes covers sub-page allocations served from the pool only:
+ * whole-page allocations appear in the cumulative alloc/bytes figures
+ * of their site, but their frees cannot be attributed, so they are
+ * excluded from both frees and live_bytes.  An entry with a zero addr
+ * but non-zero counters aggregates sites which did not fit in the
+ * (fixed-size) table.
+ */
+struct xen_memprof_site {
+    uint64_aligned_t addr;       /* caller address; 0 = unused/overflow */
+    uint64_aligned_t allocs;     /* allocations ever made at this site */
+    uint64_aligned_t frees;      /* ... of which since freed */
+    uint64_aligned_t bytes;      /* cumulative bytes allocated */
+    uint64_aligned_t live_bytes; /* pool bytes currently allocated */
+};
+typedef struct xen_memprof_site xen_memprof_site_t;
+DEFINE_XEN_GUEST_HANDLE(xen_memprof_site_t);
+
+struct xen_memprof_dom {
+    domid_t  domain;
+    uint16_t pad;
+    uint32_t pad2;
+    uint64_aligned_t tot_pages;     /* domheap pages assigned */
+    uint64_aligned_t xenheap_pages; /* xenheap pages assigned */
+};
+typedef struct xen_memprof_dom xen_memprof_dom_t;
+DEFINE_XEN_GUEST_HANDLE(xen_memprof_dom_t);
+
+struct xen_sysctl_memprof {
+    /* IN: capacities of the arrays; OUT: entries filled. */
+    uint32_t nr_sites;
+    uint32_t nr_doms;
+    /* OUT variables. */
+    uint64_aligned_t pool_used; /* xmalloc pool bytes in use */
+    uint64_aligned_t pool_size; /* xmalloc pool bytes owned */
+    XEN_GUEST_HANDLE_64(xen_memprof_site_t) sites;
+    XEN_GUEST_HANDLE_64(xen_memprof_dom_t) doms;
+};
+
+/* XEN_SYSCTL_dlog */
+/*
+ * Binary structured diagnostics log.  Hot paths deposit fixed-size
+ * records (event identifier, up to four arguments, TSC) into small
+ * per-CPU rings without taking any global lock; all formatting is done
+ * by the dom0 consumer (xen-dlog), so verbose diagnostics can stay
+ * enabled in production without perturbing timing the way ratelimited
+ * printk() does.
+ */
+struct xen_dlog_rec {
+    uint64_aligned_t tsc;   /* local TSC when the record was written */
+    uint32_t event;         /* XEN_DLOG_* event identifier */
+    uint32_t nargs;         /* number of valid entries in arg[] */
+    uint64_aligned_t arg[4];
+};
+typedef struct xen_dlog_rec xen_dlog_rec_t;
+DEFINE_XEN_GUEST_HANDLE(xen_dlog_rec_t);
+
+/* Event identifiers: (subsystem << 16) | code. */
+#define XEN_DLOG_SUBSYS_CONSOLE     1
+/* arg0 = number of printk() messages suppressed by rate limiting. */
+#define XEN_DLOG_CONSOLE_SUPPRESSED ((XEN_DLOG_SUBSYS_CONSOLE << 16) | 1)
+
+struct xen_sysctl_dlog {
+    /* IN: CPU whose ring to read. */
+    uint32_t cpu;
+    /* IN: capacity of recs; OUT: records returned, oldest first. */
+    uint32_t nr_recs;
+    /* OUT: records ever written on this CPU (older ones overwritten). */
+    uint64_aligned_t prod;
+    XEN_GUEST_HANDLE_64(xen_dlog_rec_t) recs;
+};
+
 /* XEN_SYSCTL_cputopoinfo */
 #define XEN_INVALID_CORE_ID     (~0U)
 #define XEN_INVALID_SOCKET_ID   (~0U)
@@ -970,6 +1316,10 @@ struct xen_livepatch_status {
 #define LIVEPATCH_STATE_APPLIED      2
     uint32_t state;                /* OUT: LIVEPATCH_STATE_*. */
     int32_t rc;                    /* OUT: 0 if no error, otherwise -XEN_EXX. */
+    /* OUT: ns spent gathering the CPUs for the most recent action. */
+    uint64_aligned_t rendezvous_ns;
+    /* OUT: ns all CPUs were held while the most recent action patched. */
+    uint64_aligned_t patch_ns;
 };
 typedef struct xen_livepatch_status xen_livepatch_status_t;
 DEFINE_XEN_GUEST_HANDLE(xen_livepatch_status_t);
@@ -1130,6 +1480,16 @@ struct xen_sysctl {
 #define XEN_SYSCTL_livepatch_op                  27
 #define XEN_SYSCTL_set_parameter                 28
 #define XEN_SYSCTL_get_cpu_policy                29
+#define XEN_SYSCTL_hypercall_prof_op             30
+#define XEN_SYSCTL_domperf_op                    31
+#define XEN_SYSCTL_sampler_op                    32
+#define XEN_SYSCTL_irq_stats                     33
+#define XEN_SYSCTL_domain_snapshot               34
+#define XEN_SYSCTL_statspage_op                  35
+#define XEN_SYSCTL_timepage_info                 36
+#define XEN_SYSCTL_memprof                       37
+#define XEN_SYSCTL_dlog                          38
+
     uint32_t interface_version; /* XEN_SYSCTL_INTERFACE_VERSION */
     union {
         struct xen_sysctl_readconsole       readconsole;
@@ -1149,6 +1509,15 @@ struct xen_sysctl {
         struct xen_sysctl_pm_op             pm_op;
         struct xen_sysctl_page_offline_op   page_offline;
         struct xen_sysctl_lockprof_op       lockprof_op;
+        struct xen_sysctl_hypercall_prof_op hypercall_prof_op;
+        struct xen_sysctl_domperf_op        domperf_op;
+        struct xen_sysctl_sampler_op        sampler_op;
+        struct xen_sysctl_irq_stats         irq_stats;
+        struct xen_sysctl_domain_snapshot   domain_snapshot;
+        struct xen_sysctl_statspage_op      statspage_op;
+        struct xen_sysctl_timepage_info     timepage_info;
+        struct xen_sysctl_memprof           memprof;
+        struct xen_sysctl_dlog              dlog;
         struct xen_sysctl_cpupool_op        cpupool_op;
         struct xen_sysctl_scheduler_op      scheduler_op;
         struct xen_sysctl_coverage_op       coverage_op;
@@ -97,6 +97,18 @@
 #define TRC_LOST_RECORDS        (TRC_GEN + 1)
 #define TRC_TRACE_WRAP_BUFFER  (TRC_GEN + 2)
 #define TRC_TRACE_CPU_CHANGE    (TRC_GEN + 3)
+/*
+ * IP sample from the hypervisor sampling engine.  Payload:
+ *   [0] domid (low 16 bits) | vcpu id (high 16 bits)
+ *   [1] flags (XEN_SAMPLE_F_*; high 16 bits: number of caller entries)
+ *   [2,3] sampled instruction pointer (64 bits)
+ *   [4,5] callers, as 32-bit offsets into the hypervisor text
+ */
+#define TRC_SAMPLE              (TRC_GEN + 4)
+
+#define XEN_SAMPLE_F_GUEST      0x00000001 /* IP is a guest address */
+#define XEN_SAMPLE_F_HVM        0x00000002 /* vCPU is HVM */
+#define XEN_SAMPLE_NR_CALLERS(f) ((f) >> 16)
 
 #define TRC_SCHED_RUNSTATE_CHANGE   (TRC_SCHED_MIN + 1)
 #define TRC_SCHED_CONTINUE_RUNNING  (TRC_SCHED_MIN + 2)
@@ -235,6 +235,74 @@ struct vcpu_register_time_memory_area {
 typedef struct vcpu_register_time_memory_area vcpu_register_time_memory_area_t;
 DEFINE_XEN_GUEST_HANDLE(vcpu_register_time_memory_area_t);
 
+/*
+ * Register a page of guest memory as a runstate-transition ring for the
+ * specified VCPU.  Where VCPUOP_register_runstate_memory_area publishes
+ * cumulative times only, the ring receives one timestamped entry per
+ * runstate change, so preemption-duration distributions can be derived
+ * without a tracing setup.
+ *
+ * The address must be page aligned.  Xen clears the page and fills in
+ * @size; once the ring is full the oldest entries are overwritten.
+ * @prod counts entries ever written and only increases; a reader at
+ * entry (prod - 1) % size should re-check @prod after reading, as with
+ * other lock-free rings.  The registration lasts until the vcpu is
+ * destroyed and cannot be replaced.
+ *
+ * @extra_arg == pointer to vcpu_register_runstate_ring structure.
+ */
+#define VCPUOP_register_runstate_ring           14
+struct vcpu_runstate_ring_entry {
+    uint64_t state_entry_time; /* system time (ns) @new_state was entered */
+    uint32_t old_state;        /* RUNSTATE_* left */
+    uint32_t new_state;        /* RUNSTATE_* entered */
+};
+typedef struct vcpu_runstate_ring_entry vcpu_runstate_ring_entry_t;
+
+struct vcpu_runstate_ring {
+    uint32_t prod;             /* entries ever written; monotonic */
+    uint32_t size;             /* entries in ring[]; filled in by Xen */
+    uint32_t _pad[14];
+    struct vcpu_runstate_ring_entry ring[1]; /* actually @size entries */
+};
+typedef struct vcpu_runstate_ring vcpu_runstate_ring_t;
+
+struct vcpu_register_runstate_ring {
+    union {
+        struct vcpu_runstate_ring *v;
+        uint64_t p; /* page-aligned guest address */
+    } addr;
+};
+typedef struct vcpu_register_runstate_ring vcpu_register_runstate_ring_t;
+DEFINE_XEN_GUEST_HANDLE(vcpu_register_runstate_ring_t);
+
+/*
+ * Register a doorbell for the specified VCPU: a naturally aligned 32-bit
+ * word of guest memory which Xen stores a non-zero value to whenever an
+ * event-channel port bound to the VCPU becomes pending.
+ *
+ * The store happens on every port transition to pending, even while
+ * upcalls are suppressed or masked, so a consumer may run with the
+ * upcall path quiesced and wait on the doorbell alone, e.g. with
+ * MONITOR/MWAIT on the containing cacheline instead of taking an
+ * interrupt and a syscall per batch.  Any store to a monitored line
+ * triggers a wakeup, so the protocol is simply: clear the word, arm the
+ * monitor, re-check the pending state, wait.
+ *
+ * The registration lasts until the vcpu is destroyed and cannot be
+ * replaced.
+ *
+ * @extra_arg == pointer to vcpu_register_event_doorbell structure.
+ */
+#define VCPUOP_register_event_doorbell          15
+struct vcpu_register_event_doorbell {
+    uint64_t mfn;    /* gmfn of page holding the doorbell */
+    uint32_t offset; /* offset within page; 4-byte aligned */
+    uint32_t rsvd;   /* unused */
+};
+typedef struct vcpu_register_event_doorbell vcpu_register_event_doorbell_t;
+DEFINE_XEN_GUEST_HANDLE(vcpu_register_event_doorbell_t);
+
 #endif /* __XEN_PUBLIC_VCPU_H__ */
 
 /*
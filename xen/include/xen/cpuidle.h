@@ -27,6 +27,7 @@
 #define _XEN_CPUIDLE_H
 
 #include <xen/cpumask.h>
+#include <xen/percpu.h>
 #include <xen/spinlock.h>
 
 #define ACPI_PROCESSOR_MAX_POWER        8
@@ -96,4 +97,11 @@ extern void cpuidle_wakeup_mwait(cpumask_t *mask);
 
 extern void menu_get_trace_data(u32 *expected, u32 *pred);
 
+/* Per-CPU QoS bounds honoured by the governor (0 = no bound). */
+DECLARE_PER_CPU(uint32_t, max_cstate_limit);
+DECLARE_PER_CPU(uint32_t, wakeup_latency_limit_us);
+
+int cpuidle_set_max_cstate(unsigned int cpu, unsigned int limit);
+void cpuidle_update_latency_limits(void);
+
 #endif /* _XEN_CPUIDLE_H */
@@ -0,0 +1,26 @@
+/******************************************************************************
+ * dlog.h
+ *
+ * Binary structured diagnostics log.  DLOGn() deposits a fixed-size
+ * record into a lockless per-CPU ring; formatting happens in dom0
+ * (xen-dlog), so these can be left in hot paths unconditionally.
+ */
+
+#ifndef __XEN_DLOG_H__
+#define __XEN_DLOG_H__
+
+#include <xen/types.h>
+#include <public/sysctl.h>
+
+void __dlog(uint32_t event, unsigned int nargs,
+            uint64_t a0, uint64_t a1, uint64_t a2, uint64_t a3);
+
+#define DLOG0(e)                 __dlog(e, 0, 0, 0, 0, 0)
+#define DLOG1(e, a)              __dlog(e, 1, a, 0, 0, 0)
+#define DLOG2(e, a, b)           __dlog(e, 2, a, b, 0, 0)
+#define DLOG3(e, a, b, c)        __dlog(e, 3, a, b, c, 0)
+#define DLOG4(e, a, b, c, d)     __dlog(e, 4, a, b, c, d)
+
+int dlog_sysctl(struct xen_sysctl_dlog *op);
+
+#endif /* __XEN_DLOG_H__ */
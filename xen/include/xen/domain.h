@@ -124,4 +124,17 @@ int map_runstate_area(struct vcpu *v,
 void unmap_runstate_area(struct vcpu *v);
 void update_runstate_area(struct vcpu *);
 
+/* Entries a one-page runstate-transition ring can hold. */
+#define RUNSTATE_RING_ENTRIES \
+    ((PAGE_SIZE - offsetof(struct vcpu_runstate_ring, ring)) / \
+     sizeof(struct vcpu_runstate_ring_entry))
+
+struct vcpu_register_runstate_ring;
+int map_runstate_ring(struct vcpu *v,
+                      struct vcpu_register_runstate_ring *area);
+void unmap_runstate_ring(struct vcpu *v);
+
+int map_event_doorbell(struct vcpu *v, unsigned long gfn, unsigned int offset);
+void unmap_event_doorbell(struct vcpu *v);
+
 #endif /* __XEN_DOMAIN_H__ */
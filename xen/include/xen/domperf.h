@@ -0,0 +1,27 @@
+/******************************************************************************
+ * domperf.h
+ *
+ * Per-domain event counters for noisy-neighbor triage.  Events are counted
+ * per vCPU without locking (all increments happen in that vCPU's context)
+ * and summed across vCPUs at query time.
+ */
+
+#ifndef __XEN_DOMPERF_H__
+#define __XEN_DOMPERF_H__
+
+#include <xen/types.h>
+#include <public/sysctl.h>
+
+extern bool domperf_enabled;
+
+/* Count one event of the given kind against (v)'s domain. */
+#define domperf_incr(v, ctr) domperf_add(v, ctr, 1)
+
+#define domperf_add(v, ctr, n) do {                     \
+    if ( unlikely(domperf_enabled) )                    \
+        (v)->domperf[XEN_DOMPERF_##ctr] += (n);         \
+} while ( 0 )
+
+int domperf_control(struct xen_sysctl_domperf_op *dp);
+
+#endif /* __XEN_DOMPERF_H__ */
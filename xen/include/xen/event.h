@@ -182,7 +182,18 @@ static inline void evtchn_port_set_pending(struct domain *d,
                                            unsigned int vcpu_id,
                                            struct evtchn *evtchn)
 {
-    d->evtchn_port_ops->set_pending(d->vcpu[vcpu_id], evtchn);
+    struct vcpu *v = d->vcpu[vcpu_id];
+
+    d->evtchn_port_ops->set_pending(v, evtchn);
+
+    /*
+     * Ring the doorbell on every transition to pending, regardless of the
+     * upcall state: consumers waiting on the line (e.g. in MONITOR/MWAIT)
+     * run with upcalls suppressed.  Any store wakes a waiter, even one
+     * not changing the value, so no state needs tracking here.
+     */
+    if ( v->event_doorbell )
+        write_atomic(v->event_doorbell, 1);
 }
 
 static inline void evtchn_port_clear_pending(struct domain *d,
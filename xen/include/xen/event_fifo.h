@@ -14,6 +14,7 @@ struct evtchn_fifo_queue {
     uint32_t tail;
     uint8_t priority;
     spinlock_t lock;
+    s_time_t ready_since; /* when the queue went ready; 0 when consumed */
 };
 
 struct evtchn_fifo_vcpu {
@@ -25,15 +26,42 @@ struct evtchn_fifo_vcpu {
 #define EVTCHN_FIFO_MAX_EVENT_ARRAY_PAGES \
     (EVTCHN_FIFO_NR_CHANNELS / EVTCHN_FIFO_EVENT_WORDS_PER_PAGE)
 
+/* Wake-latency histograms; bucket i counts latencies below 2^i us. */
+#define EVTCHN_FIFO_LAT_NR_BUCKETS 16
+
+struct evtchn_fifo_lat {
+    bool enabled;
+    /*
+     * Increments are not atomic; concurrent hits on the same bucket may
+     * occasionally be lost, which is acceptable for diagnostics.
+     */
+    uint64_t count[EVTCHN_FIFO_MAX_QUEUES][EVTCHN_FIFO_LAT_NR_BUCKETS];
+};
+
 struct evtchn_fifo_domain {
     event_word_t *event_array[EVTCHN_FIFO_MAX_EVENT_ARRAY_PAGES];
     unsigned int num_evtchns;
+    struct evtchn_fifo_lat *lat; /* freed only with the event array */
 };
 
 int evtchn_fifo_init_control(struct evtchn_init_control *init_control);
 int evtchn_fifo_expand_array(const struct evtchn_expand_array *expand_array);
 void evtchn_fifo_destroy(struct domain *domain);
 
+struct xen_domctl_evtchn_fifo_lat;
+int evtchn_fifo_lat_domctl(struct domain *d,
+                           struct xen_domctl_evtchn_fifo_lat *op);
+void evtchn_fifo_record_wake(struct vcpu *v, s_time_t now);
+
+/* Called whenever @v is switched in; see evtchn_fifo_set_pending(). */
+static inline void evtchn_fifo_note_wake(struct vcpu *v, s_time_t now)
+{
+    if ( unlikely(v->evtchn_fifo && v->domain->evtchn_fifo &&
+                  v->domain->evtchn_fifo->lat &&
+                  v->domain->evtchn_fifo->lat->enabled) )
+        evtchn_fifo_record_wake(v, now);
+}
+
 #endif /* __XEN_EVENT_FIFO_H__ */
 
 /*
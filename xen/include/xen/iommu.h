@@ -131,6 +131,13 @@ int __must_check iommu_iotlb_flush(struct domain *d, dfn_t dfn,
 int __must_check iommu_iotlb_flush_all(struct domain *d,
                                        unsigned int flush_flags);
 
+/*
+ * Transfer DMA-dirtied pages into the paging log-dirty log, for migration
+ * of domains with assigned devices. A no-op (returning 0) when the
+ * hardware doesn't maintain Dirty bits in the IOMMU page tables.
+ */
+int iommu_sync_dirty_log(struct domain *d);
+
 enum iommu_feature
 {
     IOMMU_FEAT_COHERENT_WALK,
@@ -236,6 +243,8 @@ struct iommu_ops {
                                     unsigned int page_count,
                                     unsigned int flush_flags);
     int __must_check (*iotlb_flush_all)(struct domain *d);
+    /* Harvest hardware-maintained PTE Dirty bits into the log-dirty log. */
+    int __must_check (*sync_dirty_log)(struct domain *d);
     int (*get_reserved_device_memory)(iommu_grdm_t *, void *);
     void (*dump_p2m_table)(struct domain *d);
 };
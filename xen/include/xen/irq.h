@@ -96,6 +96,12 @@ typedef struct irq_desc {
     s_time_t rl_quantum_start;
     unsigned int rl_cnt;
     struct list_head rl_link;
+
+    /* irq balancing (see "irq_balance=" option) */
+    unsigned int bal_cnt;      /* interrupts this balancing interval */
+    unsigned int bal_rate;     /* interrupts over the last interval */
+    unsigned int bal_moves;    /* times the balancer retargeted the irq */
+    uint64_t bal_time;         /* cumulative guest handling time (ns) */
 } __cacheline_aligned irq_desc_t;
 
 #ifndef irq_to_desc
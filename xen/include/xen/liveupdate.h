@@ -0,0 +1,52 @@
+#ifndef __XEN_LIVEUPDATE_H__
+#define __XEN_LIVEUPDATE_H__
+
+#ifdef CONFIG_KEXEC
+
+#include <xen/types.h>
+#include <xen/kexec.h>
+
+/*
+ * Live update: warm-restart the hypervisor via kexec while carrying a
+ * state stream across in a memory region ("liveupdate=" command line
+ * option) which is excluded from the heap and therefore survives the
+ * handover untouched.
+ */
+
+extern xen_kexec_reserve_t liveupdate_area;
+
+/* True once a state area has been reserved at boot. */
+bool liveupdate_enabled(void);
+
+/*
+ * Stage the state stream in the reserved area, to be picked up by the
+ * next hypervisor.  Called on the KEXEC_TYPE_LIVE_UPDATE exec path,
+ * immediately before the jump into the new image.
+ */
+int liveupdate_save(void);
+
+#else /* !CONFIG_KEXEC */
+
+static inline bool liveupdate_enabled(void)
+{
+    return false;
+}
+
+static inline int liveupdate_save(void)
+{
+    return -ENOSYS;
+}
+
+#endif
+
+#endif /* __XEN_LIVEUPDATE_H__ */
+
+/*
+ * Local variables:
+ * mode: C
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -194,6 +194,10 @@ unsigned long __must_check domain_adjust_tot_pages(struct domain *d,
     long pages);
 int domain_set_outstanding_pages(struct domain *d, unsigned long pages);
 void get_outstanding_claims(uint64_t *free_pages, uint64_t *outstanding_pages);
+/* Seqcount-validated lockless snapshot of tot/max/outstanding pages. */
+void domain_get_accounting(struct domain *d, unsigned int *tot_pages,
+                           unsigned int *max_pages,
+                           unsigned int *outstanding_pages);
 
 /* Domain suballocator. These functions are *not* interrupt-safe.*/
 void init_domheap_pages(paddr_t ps, paddr_t pe);
@@ -204,6 +208,7 @@ unsigned long avail_domheap_pages_region(
     unsigned int node, unsigned int min_width, unsigned int max_width);
 unsigned long avail_domheap_pages(void);
 unsigned long avail_node_heap_pages(unsigned int);
+unsigned long pending_scrub_pages(void);
 #define alloc_domheap_page(d,f) (alloc_domheap_pages(d,0,f))
 #define free_domheap_page(p)  (free_domheap_pages(p,0))
 unsigned int online_page(unsigned long mfn, uint32_t *status);
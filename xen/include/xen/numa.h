@@ -18,4 +18,13 @@
   (((d)->vcpu != NULL && (d)->vcpu[0] != NULL) \
    ? vcpu_to_node((d)->vcpu[0]) : NUMA_NO_NODE)
 
+/*
+ * A node to place a domain's control structures on: the first node of
+ * the domain's node affinity when that is restricted to a subset of
+ * the online nodes, NUMA_NO_NODE (i.e. no preference) otherwise.
+ */
+#define domain_affinity_node(d)                                  \
+  (nodes_weight((d)->node_affinity) < num_online_nodes()         \
+   ? first_node((d)->node_affinity) : NUMA_NO_NODE)
+
 #endif /* _XEN_NUMA_H */
@@ -113,6 +113,18 @@ struct pci_dev {
         s_time_t time;
         unsigned int count;
 #define PT_FAULT_THRESHOLD 10
+        /* Lifetime accounting and recent records ('Q' debug key). */
+        uint64_t total;
+        unsigned int logged;     /* faults logged in the current window */
+        bool quiet;              /* per-fault logging suppressed */
+        s_time_t log_time;
+        uint8_t idx;
+        struct {
+            s_time_t time;
+            u64 addr;
+            u8 reason;
+            u8 type;
+        } recent[4];
     } fault;
     u64 vf_rlen[6];
 
@@ -159,6 +171,8 @@ struct pci_dev *pci_get_real_pdev(int seg, int bus, int devfn);
 struct pci_dev *pci_get_pdev_by_domain(const struct domain *, int seg,
                                        int bus, int devfn);
 void pci_check_disable_device(u16 seg, u8 bus, u8 devfn);
+bool pci_record_fault(u16 seg, u8 bus, u8 devfn, u8 type, u8 reason,
+                      u64 addr);
 
 uint8_t pci_conf_read8(
     unsigned int seg, unsigned int bus, unsigned int dev, unsigned int func,
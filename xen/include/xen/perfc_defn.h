@@ -12,6 +12,14 @@ PERFCOUNTER(calls_from_multicall,       "calls from multicall")
 PERFCOUNTER(irqs,                   "#interrupts")
 PERFCOUNTER(ipis,                   "#IPIs")
 
+PERFCOUNTER(waitqueue_wake,            "waitqueue: vcpus woken")
+PERFCOUNTER(waitqueue_spurious,        "waitqueue: spurious wakeups")
+PERFCOUNTER(waitqueue_key_passed_over, "waitqueue: keyed wake mismatches")
+
+PERFCOUNTER(softirq_batch_raise,    "softirq: raises while batching")
+PERFCOUNTER(softirq_batch_ipis,     "softirq: IPIs sent at batch end")
+PERFCOUNTER(softirq_batch_skipped,  "softirq: batched IPIs made redundant")
+
 PERFCOUNTER(rcu_idle_timer,         "RCU: idle_timer")
 
 /* Generic scheduler counters (applicable to all schedulers) */
@@ -26,6 +34,7 @@ PERFCOUNTER(vcpu_insert,            "sched: vcpu_insert")
 PERFCOUNTER(vcpu_remove,            "sched: vcpu_remove")
 PERFCOUNTER(vcpu_sleep,             "sched: vcpu_sleep")
 PERFCOUNTER(vcpu_yield,             "sched: vcpu_yield")
+PERFCOUNTER(vcpu_yield_to,          "sched: directed yield to lock holder")
 PERFCOUNTER(vcpu_wake_running,      "sched: vcpu_wake_running")
 PERFCOUNTER(vcpu_wake_onrunq,       "sched: vcpu_wake_onrunq")
 PERFCOUNTER(vcpu_wake_runnable,     "sched: vcpu_wake_runnable")
@@ -33,6 +42,7 @@ PERFCOUNTER(vcpu_wake_not_runnable, "sched: vcpu_wake_not_runnable")
 PERFCOUNTER(tickled_no_cpu,         "sched: tickled_no_cpu")
 PERFCOUNTER(tickled_idle_cpu,       "sched: tickled_idle_cpu")
 PERFCOUNTER(tickled_idle_cpu_excl,  "sched: tickled_idle_cpu_exclusive")
+PERFCOUNTER(tickled_idle_cpu_fast,  "sched: tickled_idle_cpu_fastpath")
 PERFCOUNTER(tickled_busy_cpu,       "sched: tickled_busy_cpu")
 PERFCOUNTER(vcpu_check,             "sched: vcpu_check")
 
@@ -80,4 +90,15 @@ PERFCOUNTER(tickled_cpu_overridden, "csched2: tickled_cpu_overridden")
 
 PERFCOUNTER(need_flush_tlb_flush,   "PG_need_flush tlb flushes")
 
+PERFCOUNTER(domheap_hiorder_fail,   "domheap order>=9 allocation failures")
+
+#define XMALLOC_CACHE_PERF_CLASSES 5 /* XMALLOC_CACHE_NR_CLASSES */
+PERFCOUNTER_ARRAY(xmalloc_cache_hit,  "xmalloc per-CPU cache hits",
+                  XMALLOC_CACHE_PERF_CLASSES)
+PERFCOUNTER_ARRAY(xmalloc_cache_miss, "xmalloc per-CPU cache misses",
+                  XMALLOC_CACHE_PERF_CLASSES)
+
+PERFCOUNTER(vmap_cache_hit,         "vmap per-CPU cache hits")
+PERFCOUNTER(vmap_cache_miss,        "vmap per-CPU cache misses")
+
 /*#endif*/ /* __XEN_PERFC_DEFN_H__ */
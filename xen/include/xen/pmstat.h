@@ -8,6 +8,7 @@
 int set_px_pminfo(uint32_t cpu, struct xen_processor_performance *perf);
 long set_cx_pminfo(uint32_t cpu, struct xen_processor_power *power);
 uint32_t pmstat_get_cx_nr(uint32_t cpuid);
+uint32_t pmstat_get_last_cx(uint32_t cpuid);
 int pmstat_get_cx_stat(uint32_t cpuid, struct pm_cx_stat *stat);
 int pmstat_reset_cx_stat(uint32_t cpuid);
 
@@ -141,9 +141,13 @@ void rcu_init(void);
 void rcu_check_callbacks(int cpu);
 
 /* Exported interfaces */
-void call_rcu(struct rcu_head *head, 
+void call_rcu(struct rcu_head *head,
               void (*func)(struct rcu_head *head));
 
+/* As call_rcu(), but expedites the grace period covering the callback. */
+void call_rcu_expedited(struct rcu_head *head,
+                        void (*func)(struct rcu_head *head));
+
 int rcu_barrier(void);
 
 void rcu_idle_enter(unsigned int cpu);
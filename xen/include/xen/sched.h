@@ -5,6 +5,7 @@
 #include <xen/types.h>
 #include <xen/spinlock.h>
 #include <xen/rwlock.h>
+#include <xen/seqlock.h>
 #include <xen/shared.h>
 #include <xen/timer.h>
 #include <xen/rangeset.h>
@@ -165,6 +166,12 @@ struct vcpu
     struct vcpu_runstate_info runstate;
     mfn_t runstate_mfn[2];
     unsigned int runstate_nr;
+    /* Optional runstate-transition ring (VCPUOP_register_runstate_ring). */
+    struct vcpu_runstate_ring *runstate_ring;
+    mfn_t runstate_ring_mfn;
+    /* Optional wake doorbell (VCPUOP_register_event_doorbell). */
+    uint32_t *event_doorbell;
+    mfn_t event_doorbell_mfn;
 #ifndef CONFIG_COMPAT
     struct vcpu_runstate_info *runstate_guest;
 #else
@@ -212,6 +219,22 @@ struct vcpu
     bool             hcall_compat;
 #endif
 
+    /*
+     * Marshalled arguments of a preempted XENMEM_{increase,decrease}_
+     * reservation or XENMEM_populate_physmap, letting the continuation
+     * resume without re-fetching and re-validating them.  Only consulted
+     * when resuming with a matching non-zero start extent.
+     */
+    struct {
+        unsigned int  op;
+        unsigned long start_extent;
+        domid_t       domid;
+        unsigned int  memflags;
+        unsigned int  extent_order;
+        unsigned int  nr_extents;
+        XEN_GUEST_HANDLE(xen_pfn_t) extent_list;
+    } memop_cont;
+
     /* Does soft affinity actually play a role (given hard affinity)? */
     bool             soft_aff_effective;
 
@@ -222,10 +245,18 @@ struct vcpu
     /*
      * > 0: a single port is being polled;
      * = 0: nothing is being polled (vcpu should be clear in d->poll_mask);
+     * = -2: only the ports in @poll_set are being polled;
      * < 0: multiple ports may be being polled.
      */
     int              poll_evtchn;
 
+    /* Bitmap of ports registered via SCHEDOP_register_poll_set, or NULL. */
+    unsigned long   *poll_set;
+
+    /* Sleeplock this vcpu is parked on (or NULL), and its waiter node. */
+    struct sleeplock *sleeplock;
+    struct list_head sleeplock_waiter;
+
     /* (over-)protected by ->domain->event_lock */
     int              pirq_evtchn_head;
 
@@ -272,6 +303,9 @@ struct vcpu
     /* vPCI per-vCPU area, used to store data for long running operations. */
     struct vpci_vcpu vpci;
 
+    /* Per-domain event counters (see xen/domperf.h), counted per vCPU. */
+    uint64_t domperf[4 /* XEN_DOMPERF_NR */];
+
     struct arch_vcpu arch;
 };
 
@@ -284,12 +318,13 @@ struct vm_event_domain
 {
     /* ring lock */
     spinlock_t ring_lock;
-    /* The ring has 64 entries */
-    unsigned char foreign_producers;
-    unsigned char target_producers;
-    /* shared ring page */
+    /* claimed slots, each bounded by the ring size */
+    unsigned int foreign_producers;
+    unsigned int target_producers;
+    /* shared ring, 1 << ring_order pages mapped contiguously */
     void *ring_page;
-    struct page_info *ring_pg_struct;
+    struct page_info **ring_pg_structs;
+    unsigned int nr_ring_pages;
     /* front-end ring */
     vm_event_front_ring_t front_ring;
     /* event channel port (vcpu0 only) */
@@ -322,6 +357,7 @@ struct domain
     spinlock_t       domain_lock;
 
     spinlock_t       page_alloc_lock; /* protects all the following fields  */
+    seqcount_t       page_alloc_count; /* validates lockless accounting reads */
     struct page_list_head page_list;  /* linked list */
     struct page_list_head xenpage_list; /* linked list (size xenheap_pages) */
     unsigned int     tot_pages;       /* number of pages currently possesed */
@@ -347,7 +383,7 @@ struct domain
     unsigned int     max_evtchns;     /* number supported by ABI */
     unsigned int     max_evtchn_port; /* max permitted port number */
     unsigned int     valid_evtchns;   /* number of allocated event channels */
-    spinlock_t       event_lock;
+    rwlock_t         event_lock;
     const struct evtchn_port_ops *evtchn_port_ops;
     struct evtchn_fifo_domain *evtchn_fifo;
 
@@ -365,6 +401,9 @@ struct domain
     /* Is this guest dying (i.e., a zombie)? */
     enum { DOMDYING_alive, DOMDYING_dying, DOMDYING_dead } is_dying;
 
+    /* Performs the deferred part of domain destruction. */
+    struct tasklet   destroy_tasklet;
+
     /* Domain is paused by controller software? */
     int              controller_pause_count;
 
@@ -439,6 +478,17 @@ struct domain
     unsigned    pbuf_idx;
     spinlock_t  pbuf_lock;
 
+    /*
+     * Completed console lines staged for deferred printing, so guest
+     * writes don't take the global console lock.  Protected by pbuf_lock,
+     * except for cbuf_list which is under the flush list lock in console.c.
+     */
+#define DOMAIN_CBUF_SIZE 1024
+    char       *cbuf;
+    unsigned    cbuf_idx;
+    unsigned long cbuf_dropped;
+    struct list_head cbuf_list;
+
     /* OProfile support. */
     struct xenoprof *xenoprof;
 
@@ -502,6 +552,9 @@ struct domain
 extern spinlock_t domlist_update_lock;
 extern rcu_read_lock_t domlist_read_lock;
 
+/* Bumped (under domlist_update_lock) whenever the domain list changes. */
+extern uint64_t domlist_generation;
+
 extern struct vcpu *idle_vcpu[NR_CPUS];
 #define is_idle_domain(d) ((d)->domain_id == DOMID_IDLE)
 #define is_idle_vcpu(v)   (is_idle_domain((v)->domain))
@@ -0,0 +1,66 @@
+/******************************************************************************
+ * seqlock.h
+ *
+ * Minimal sequence counter, for consistent lockless snapshots of a small
+ * set of fields that are updated under an external lock.
+ *
+ * Writers must already be serialised (e.g. by a spinlock) and bracket
+ * their updates with write_seqcount_begin()/write_seqcount_end().
+ * Readers loop on read_seqcount_begin()/read_seqcount_retry() and never
+ * block a writer.  Not suitable where readers cannot tolerate retrying.
+ */
+
+#ifndef __XEN_SEQLOCK_H__
+#define __XEN_SEQLOCK_H__
+
+#include <xen/lib.h>
+#include <asm/atomic.h>
+#include <asm/processor.h>
+#include <asm/system.h>
+
+typedef struct {
+    unsigned int sequence;
+} seqcount_t;
+
+#define SEQCNT_ZERO { 0 }
+
+static inline void seqcount_init(seqcount_t *s)
+{
+    s->sequence = 0;
+}
+
+/* Begin a read section: returns the sequence to pass to the retry check. */
+static inline unsigned int read_seqcount_begin(const seqcount_t *s)
+{
+    unsigned int seq;
+
+    do {
+        seq = read_atomic(&s->sequence);
+        cpu_relax();
+    } while ( unlikely(seq & 1) );
+
+    smp_rmb();
+    return seq;
+}
+
+/* End a read section: true if a writer intervened and the reads are torn. */
+static inline bool read_seqcount_retry(const seqcount_t *s, unsigned int seq)
+{
+    smp_rmb();
+    return unlikely(read_atomic(&s->sequence) != seq);
+}
+
+/* Writer side: caller must hold the lock serialising all writers. */
+static inline void write_seqcount_begin(seqcount_t *s)
+{
+    s->sequence++;
+    smp_wmb();
+}
+
+static inline void write_seqcount_end(seqcount_t *s)
+{
+    smp_wmb();
+    s->sequence++;
+}
+
+#endif /* __XEN_SEQLOCK_H__ */
@@ -0,0 +1,44 @@
+/******************************************************************************
+ * sleeplock.h
+ *
+ * Spin-then-park lock for long-hold, preemptible hypercall paths.
+ *
+ * sleeplock_acquire() spins briefly (short holds are the common case) and
+ * otherwise parks the calling vcpu on the lock's waiter list.  A parked
+ * caller gets 0 back and must return to the guest with a hypercall
+ * continuation; the holder wakes all waiters on release and the retried
+ * hypercall re-contends.  Hence this lock is only usable from hypercall
+ * context on paths that can restart via a continuation, and unlike
+ * spinlocks it leaves contended CPUs free to run other vcpus.
+ */
+
+#ifndef __XEN_SLEEPLOCK_H__
+#define __XEN_SLEEPLOCK_H__
+
+#include <xen/list.h>
+#include <xen/spinlock.h>
+
+struct sleeplock {
+    spinlock_t lock;          /* protects locked and waiters */
+    bool locked;
+    struct list_head waiters; /* parked vcpus (v->sleeplock_waiter) */
+};
+
+#define SLEEPLOCK_INIT(l) {                 \
+    .lock = SPIN_LOCK_UNLOCKED,             \
+    .waiters = LIST_HEAD_INIT((l).waiters), \
+}
+#define DEFINE_SLEEPLOCK(l) struct sleeplock l = SLEEPLOCK_INIT(l)
+
+/* Returns 1 if the lock was acquired, 0 if it is held by someone else. */
+int sleeplock_trylock(struct sleeplock *l);
+
+/*
+ * Returns 1 if the lock was acquired; 0 if the calling vcpu was parked,
+ * in which case the caller must go back out via a hypercall continuation.
+ */
+int sleeplock_acquire(struct sleeplock *l);
+
+void sleeplock_release(struct sleeplock *l);
+
+#endif /* __XEN_SLEEPLOCK_H__ */
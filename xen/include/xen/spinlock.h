@@ -69,6 +69,7 @@ struct lock_profile {
     s64                 time_hold;   /* cumulated lock time */
     s64                 time_block;  /* cumulated wait time */
     s64                 time_locked; /* system time of last locking */
+    u64                 hist[XEN_LOCKPROF_NR_HIST]; /* wait time histogram */
 };
 
 struct lock_profile_qhead {
@@ -0,0 +1,63 @@
+/******************************************************************************
+ * include/xen/static_branch.h
+ *
+ * Runtime-patched boolean predicates.
+ *
+ * A static branch guards code which is almost always skipped (or almost
+ * always run), but whose state can still change at runtime - tracing,
+ * diagnostic modes and the like.  On architectures with patching support
+ * the test compiles to a single nop which is rewritten into a jump when
+ * the branch is flipped, so the disabled state costs no load and no
+ * conditional branch at all.  Elsewhere it degrades to a plain test of
+ * the ->enabled flag.
+ *
+ * The key passed to static_branch_unlikely() must be an address constant
+ * (i.e. "&some_key"), as the patch site table is built at compile time.
+ */
+
+#ifndef __XEN_STATIC_BRANCH_H__
+#define __XEN_STATIC_BRANCH_H__
+
+#include <xen/types.h>
+
+struct static_branch {
+    bool enabled;
+};
+
+#define STATIC_BRANCH_FALSE { .enabled = false }
+
+#ifdef CONFIG_HAS_STATIC_BRANCH
+
+#include <asm/static_branch.h>
+
+#define static_branch_unlikely(sb) unlikely(arch_static_branch(sb))
+
+/*
+ * Flipping a branch rewrites every site referencing the key, under a
+ * stop_machine rendezvous.  -EBUSY is returned if the rendezvous cannot
+ * be entered (CPU hotplug or another patching operation in flight);
+ * callers are expected to hand this back for the invoker to retry.
+ */
+int static_branch_enable(struct static_branch *sb);
+int static_branch_disable(struct static_branch *sb);
+
+#else /* !CONFIG_HAS_STATIC_BRANCH */
+
+#define static_branch_unlikely(sb) \
+    unlikely(*(const volatile bool *)&(sb)->enabled)
+
+static inline int static_branch_enable(struct static_branch *sb)
+{
+    sb->enabled = true;
+    return 0;
+}
+
+static inline int static_branch_disable(struct static_branch *sb)
+{
+    sb->enabled = false;
+    return 0;
+}
+
+#endif /* CONFIG_HAS_STATIC_BRANCH */
+
+#endif /* __XEN_STATIC_BRANCH_H__ */
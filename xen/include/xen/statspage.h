@@ -0,0 +1,17 @@
+/******************************************************************************
+ * statspage.h
+ *
+ * Host-global statistics area: per-domain runstate and memory records,
+ * refreshed periodically in pages shared read-only with privileged guests
+ * so that monitoring tools can sample without issuing hypercalls.
+ */
+
+#ifndef __XEN_STATSPAGE_H__
+#define __XEN_STATSPAGE_H__
+
+#include <xen/types.h>
+#include <public/sysctl.h>
+
+int statspage_control(struct xen_sysctl_statspage_op *op);
+
+#endif /* __XEN_STATSPAGE_H__ */
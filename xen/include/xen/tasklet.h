@@ -21,13 +21,14 @@ struct tasklet
     bool_t is_softirq;
     bool_t is_running;
     bool_t is_dead;
+    bool_t is_pinned;
     void (*func)(unsigned long);
     unsigned long data;
 };
 
 #define _DECLARE_TASKLET(name, func, data, softirq)                     \
     struct tasklet name = {                                             \
-        LIST_HEAD_INIT(name.list), -1, softirq, 0, 0, func, data }
+        LIST_HEAD_INIT(name.list), -1, softirq, 0, 0, 0, func, data }
 #define DECLARE_TASKLET(name, func, data)               \
     _DECLARE_TASKLET(name, func, data, 0)
 #define DECLARE_SOFTIRQ_TASKLET(name, func, data)       \
@@ -57,6 +58,7 @@ static inline bool tasklet_is_scheduled(const struct tasklet *t)
 
 void tasklet_schedule_on_cpu(struct tasklet *t, unsigned int cpu);
 void tasklet_schedule(struct tasklet *t);
+bool tasklet_steal_work(void);
 void do_tasklet(void);
 void tasklet_kill(struct tasklet *t);
 void tasklet_init(
@@ -10,6 +10,7 @@
 #define __XEN_TMEM_XEN_H__
 
 #include <xen/mm.h> /* heap alloc/free */
+#include <xen/numa.h> /* per-node free page lists */
 #include <xen/pfn.h>
 #include <xen/xmalloc.h> /* xmalloc/xfree */
 #include <xen/sched.h>  /* struct domain */
@@ -27,9 +28,17 @@ typedef uint32_t pagesize_t;  /* like size_t, must handle largest PAGE_SIZE */
 #define IS_PAGE_ALIGNED(addr) IS_ALIGNED((unsigned long)(addr), PAGE_SIZE)
 #define IS_VALID_PAGE(_pi)    mfn_valid(page_to_mfn(_pi))
 
-extern struct page_list_head tmem_page_list;
-extern spinlock_t tmem_page_list_lock;
-extern unsigned long tmem_page_list_pages;
+/*
+ * Freed pages are kept on per-node lists, so that recycling a page
+ * neither bounces the (formerly global) list lock between sockets nor
+ * hands out remote memory to a local allocation.
+ */
+struct tmem_page_list {
+    struct page_list_head list;
+    spinlock_t lock;
+    unsigned long pages;
+};
+extern struct tmem_page_list tmem_page_lists[MAX_NUMNODES];
 extern atomic_t freeable_page_count;
 
 extern int tmem_init(void);
@@ -67,25 +76,44 @@ static inline void tmem_disable(void)
  * Memory free page list management
  */
 
+static inline unsigned long tmem_page_list_pages(void)
+{
+    unsigned long total = 0;
+    unsigned int node;
+
+    /* Approximate: reads are lock-free, as for the old global counter. */
+    for ( node = 0; node < MAX_NUMNODES; node++ )
+        total += tmem_page_lists[node].pages;
+    return total;
+}
+
 static inline struct page_info *tmem_page_list_get(void)
 {
+    struct tmem_page_list *pl =
+        &tmem_page_lists[cpu_to_node(smp_processor_id())];
     struct page_info *pi;
 
-    spin_lock(&tmem_page_list_lock);
-    if ( (pi = page_list_remove_head(&tmem_page_list)) != NULL )
-        tmem_page_list_pages--;
-    spin_unlock(&tmem_page_list_lock);
+    /* If the local list is empty, fall back to the page allocator. */
+    if ( !pl->pages )
+        return NULL;
+    spin_lock(&pl->lock);
+    if ( (pi = page_list_remove_head(&pl->list)) != NULL )
+        pl->pages--;
+    spin_unlock(&pl->lock);
     ASSERT((pi == NULL) || IS_VALID_PAGE(pi));
     return pi;
 }
 
 static inline void tmem_page_list_put(struct page_info *pi)
 {
+    struct tmem_page_list *pl =
+        &tmem_page_lists[phys_to_nid(page_to_maddr(pi))];
+
     ASSERT(IS_VALID_PAGE(pi));
-    spin_lock(&tmem_page_list_lock);
-    page_list_add(pi, &tmem_page_list);
-    tmem_page_list_pages++;
-    spin_unlock(&tmem_page_list_lock);
+    spin_lock(&pl->lock);
+    page_list_add(pi, &pl->list);
+    pl->pages++;
+    spin_unlock(&pl->lock);
 }
 
 /*
@@ -101,15 +129,12 @@ static inline struct page_info *__tmem_alloc_page_thispool(struct domain *d)
     if ( d->tot_pages >= d->max_pages )
         return NULL;
 
-    if ( tmem_page_list_pages )
+    if ( (pi = tmem_page_list_get()) != NULL )
     {
-        if ( (pi = tmem_page_list_get()) != NULL )
-        {
-            if ( donate_page(d,pi,0) == 0 )
-                goto out;
-            else
-                tmem_page_list_put(pi);
-        }
+        if ( donate_page(d,pi,0) == 0 )
+            goto out;
+        else
+            tmem_page_list_put(pi);
     }
 
     pi = alloc_domheap_pages(d,0,MEMF_tmem);
@@ -21,8 +21,21 @@
 #ifndef __XEN_TRACE_H__
 #define __XEN_TRACE_H__
 
+#include <xen/static_branch.h>
+
 extern int tb_init_done;
 
+/*
+ * Fast-path gate for the trace emission macros.  Patched when tracing is
+ * switched on or off, so a disabled trace point costs a single nop rather
+ * than a load and conditional branch per pass.  tb_init_done remains the
+ * authoritative flag and is re-checked in __trace_var(), which also lets
+ * the tracer shut itself off from contexts that cannot repatch.
+ */
+extern struct static_branch tb_active;
+
+#define tracing_active() static_branch_unlikely(&tb_active)
+
 #include <public/sysctl.h>
 #include <public/trace.h>
 #include <asm/trace.h>
@@ -40,7 +53,7 @@ void __trace_var(u32 event, bool_t cycles, unsigned int extra, const void *);
 static inline void trace_var(u32 event, int cycles, int extra,
                              const void *extra_data)
 {
-    if ( unlikely(tb_init_done) )
+    if ( tracing_active() )
         __trace_var(event, cycles, extra, extra_data);
 }
 
@@ -55,7 +68,7 @@ void __trace_hypercall(uint32_t event, unsigned long op,
   
 #define TRACE_1D(_e,d1)                                         \
     do {                                                        \
-        if ( unlikely(tb_init_done) )                           \
+        if ( tracing_active() )                                 \
         {                                                       \
             u32 _d[1];                                          \
             _d[0] = d1;                                         \
@@ -65,7 +78,7 @@ void __trace_hypercall(uint32_t event, unsigned long op,
  
 #define TRACE_2D(_e,d1,d2)                                      \
     do {                                                        \
-        if ( unlikely(tb_init_done) )                           \
+        if ( tracing_active() )                                 \
         {                                                       \
             u32 _d[2];                                          \
             _d[0] = d1;                                         \
@@ -76,7 +89,7 @@ void __trace_hypercall(uint32_t event, unsigned long op,
  
 #define TRACE_3D(_e,d1,d2,d3)                                   \
     do {                                                        \
-        if ( unlikely(tb_init_done) )                           \
+        if ( tracing_active() )                                 \
         {                                                       \
             u32 _d[3];                                          \
             _d[0] = d1;                                         \
@@ -88,7 +101,7 @@ void __trace_hypercall(uint32_t event, unsigned long op,
  
 #define TRACE_4D(_e,d1,d2,d3,d4)                                \
     do {                                                        \
-        if ( unlikely(tb_init_done) )                           \
+        if ( tracing_active() )                                 \
         {                                                       \
             u32 _d[4];                                          \
             _d[0] = d1;                                         \
@@ -101,7 +114,7 @@ void __trace_hypercall(uint32_t event, unsigned long op,
  
 #define TRACE_5D(_e,d1,d2,d3,d4,d5)                             \
     do {                                                        \
-        if ( unlikely(tb_init_done) )                           \
+        if ( tracing_active() )                                 \
         {                                                       \
             u32 _d[5];                                          \
             _d[0] = d1;                                         \
@@ -115,7 +128,7 @@ void __trace_hypercall(uint32_t event, unsigned long op,
 
 #define TRACE_6D(_e,d1,d2,d3,d4,d5,d6)                             \
     do {                                                        \
-        if ( unlikely(tb_init_done) )                           \
+        if ( tracing_active() )                                 \
         {                                                       \
             u32 _d[6];                                          \
             _d[0] = d1;                                         \
@@ -4,9 +4,12 @@
 #ifdef CONFIG_HAS_VPCI
 
 #include <xen/pci.h>
+#include <xen/pci_regs.h>
 #include <xen/types.h>
 #include <xen/list.h>
 
+struct vpci_register;
+
 typedef uint32_t vpci_read_t(const struct pci_dev *pdev, unsigned int reg,
                              void *data);
 
@@ -56,8 +59,15 @@ uint32_t vpci_hw_read32(const struct pci_dev *pdev, unsigned int reg,
 bool __must_check vpci_process_pending(struct vcpu *v);
 
 struct vpci {
-    /* List of vPCI handlers for a device. */
-    struct list_head handlers;
+    /* Sorted (by offset) array of vPCI handlers for a device. */
+    struct vpci_register *handlers;
+    unsigned int nr_handlers;
+    /*
+     * Bitmap of config space bytes covered by an emulated register.
+     * Accesses not touching any set bit are forwarded straight to the
+     * hardware, without taking the lock below.
+     */
+    DECLARE_BITMAP(intercepted, PCI_CFG_SPACE_EXP_SIZE);
     spinlock_t lock;
 
 #ifdef __XEN__
@@ -11,6 +11,7 @@
 
 #include <xen/types.h>
 #include <xen/list.h>
+#include <xen/perfc.h>
 #include <xen/spinlock.h>
 
 struct waitqueue_head {
@@ -29,29 +30,50 @@ struct waitqueue_head {
 void init_waitqueue_head(struct waitqueue_head *wq);
 void destroy_waitqueue_head(struct waitqueue_head *wq);
 
+/*
+ * Waiters may register with a key (e.g. the gfn they are waiting on), so
+ * wakers knowing which event occurred can wake just the interested
+ * subset instead of the whole queue.  Plain prepare_to_wait()/wake_up_*()
+ * use WAIT_KEY_ANY: such waiters match every keyed wakeup, and unkeyed
+ * wakeups ignore keys entirely.
+ */
+#define WAIT_KEY_ANY (~0UL)
+
 /* Wake VCPU(s) waiting on specified waitqueue. */
 void wake_up_nr(struct waitqueue_head *wq, unsigned int nr);
 void wake_up_one(struct waitqueue_head *wq);
 void wake_up_all(struct waitqueue_head *wq);
 
+/* Wake VCPU(s) waiting on specified waitqueue with a matching key. */
+void wake_up_key(struct waitqueue_head *wq, unsigned long key,
+                 unsigned int nr);
+
 /* Wait on specified waitqueue until @condition is true. */
-#define wait_event(wq, condition)               \
+#define wait_event_key(wq, key, condition)      \
 do {                                            \
+    bool _awoken = false;                       \
     if ( condition )                            \
         break;                                  \
     for ( ; ; ) {                               \
-        prepare_to_wait(&wq);                   \
+        prepare_to_wait_key(&wq, key);          \
         if ( condition )                        \
             break;                              \
+        if ( _awoken )                          \
+            perfc_incr(waitqueue_spurious);     \
+        _awoken = true;                         \
         wait();                                 \
     }                                           \
     finish_wait(&wq);                           \
 } while (0)
 
+#define wait_event(wq, condition)               \
+    wait_event_key(wq, WAIT_KEY_ANY, condition)
+
 /* Private functions. */
 int init_waitqueue_vcpu(struct vcpu *v);
 void destroy_waitqueue_vcpu(struct vcpu *v);
 void prepare_to_wait(struct waitqueue_head *wq);
+void prepare_to_wait_key(struct waitqueue_head *wq, unsigned long key);
 void wait(void);
 void finish_wait(struct waitqueue_head *wq);
 void check_wakeup_from_wait(void);
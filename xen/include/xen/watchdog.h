@@ -23,12 +23,16 @@ void watchdog_disable(void);
 /* Is the watchdog currently enabled. */
 bool watchdog_enabled(void);
 
+/* Retarget the watchdog tick frequency; 0 restores the default. */
+void watchdog_set_rate(unsigned int hz);
+
 #else
 
 #define watchdog_setup() ((void)0)
 #define watchdog_enable() ((void)0)
 #define watchdog_disable() ((void)0)
 #define watchdog_enabled() ((void)0)
+#define watchdog_set_rate(hz) ((void)(hz))
 
 #endif
 
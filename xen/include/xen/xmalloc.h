@@ -70,6 +70,13 @@ static inline void *_xzalloc_array(
     return _xzalloc(size * num, align);
 }
 
+/*
+ * Allocation-site accounting (XEN_SYSCTL_memprof): fill in the pool
+ * totals and copy out the per-caller-address counters.
+ */
+struct xen_sysctl_memprof;
+int xmalloc_memprof_op(struct xen_sysctl_memprof *op);
+
 /*
  * Pooled allocator interface.
  */
@@ -305,7 +305,6 @@ static void write_src(void)
 {
 	unsigned int i, k, off;
 	unsigned int best_idx[256];
-	unsigned int *markers;
 	char buf[KSYM_NAME_LEN+1];
 
 	if (map_only) {
@@ -342,16 +341,9 @@ static void write_src(void)
 	printf("\t.long\t%d\n", table_cnt);
 	printf("\n");
 
-	/* table of offset markers, that give the offset in the compressed stream
-	 * every 256 symbols */
-	markers = (unsigned int *) malloc(sizeof(unsigned int) * ((table_cnt + 255) / 256));
-
 	output_label("symbols_names");
 	off = 0;
 	for (i = 0; i < table_cnt; i++) {
-		if ((i & 0xFF) == 0)
-			markers[i >> 8] = off;
-
 		printf("\t.byte 0x%02x", table[i].len);
 		for (k = 0; k < table[i].len; k++)
 			printf(", 0x%02x", table[i].sym[k]);
@@ -362,9 +354,10 @@ static void write_src(void)
 	}
 	printf("\n");
 
-	output_label("symbols_markers");
-	for (i = 0; i < ((table_cnt + 255) >> 8); i++)
-		printf("\t.long\t%d\n", markers[i]);
+	/* per-symbol offsets into the compressed stream, for O(1) expansion */
+	output_label("symbols_name_offsets");
+	for (i = 0; i < table_cnt; i++)
+		printf("\t.long\t%u\n", table[i].stream_offset);
 	printf("\n");
 
 
@@ -383,10 +376,8 @@ static void write_src(void)
 		printf("\t.short\t%d\n", best_idx[i]);
 	printf("\n");
 
-	if (!sort_by_name) {
-		free(markers);
+	if (!sort_by_name)
 		return;
-	}
 
 	/* Sorted by original symbol names and type. */
 	qsort(table, table_cnt, sizeof(*table), compare_name_orig);
@@ -399,8 +390,6 @@ static void write_src(void)
 		printf("\t.long %u, %u\n", table[i].stream_offset, table[i].addr_idx);
 	}
 	printf("\n");
-
-	free(markers);
 }
 
 
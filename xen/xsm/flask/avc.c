@@ -102,6 +102,85 @@ static inline int avc_hash(u32 ssid, u32 tsid, u16 tclass)
     return (ssid ^ (tsid<<2) ^ (tclass<<4)) & (AVC_CACHE_SLOTS - 1);
 }
 
+/*
+ * First-level, per-CPU decision cache in front of the shared hash.
+ * Lookups only touch CPU-local memory, so the hot hypercall path does
+ * not bounce the shared slot cachelines between CPUs. Entries are
+ * invalidated wholesale by bumping avc_local_gen on policy reload
+ * (avc_ss_reset()); each CPU notices the new generation on its next
+ * lookup and flushes its own copy.
+ */
+#define AVC_LOCAL_SLOTS 32
+
+struct avc_local_cache {
+    u32 gen;
+    bool valid[AVC_LOCAL_SLOTS];
+    struct avc_entry entry[AVC_LOCAL_SLOTS];
+};
+
+static DEFINE_PER_CPU(struct avc_local_cache, avc_local_cache);
+static u32 avc_local_gen = 1;
+
+static inline unsigned int avc_local_hash(u32 ssid, u32 tsid, u16 tclass)
+{
+    return (ssid ^ (tsid<<2) ^ (tclass<<4)) & (AVC_LOCAL_SLOTS - 1);
+}
+
+/* Returns the local slot for the triple, flushing a stale cache. */
+static struct avc_local_cache *avc_local_get(void)
+{
+    struct avc_local_cache *cache = &this_cpu(avc_local_cache);
+    u32 gen = read_atomic(&avc_local_gen);
+
+    if ( unlikely(cache->gen != gen) )
+    {
+        memset(cache->valid, 0, sizeof(cache->valid));
+        cache->gen = gen;
+    }
+
+    return cache;
+}
+
+static struct av_decision *avc_local_lookup(u32 ssid, u32 tsid, u16 tclass)
+{
+    struct avc_local_cache *cache = avc_local_get();
+    unsigned int idx = avc_local_hash(ssid, tsid, tclass);
+    struct avc_entry *ae = &cache->entry[idx];
+
+    if ( cache->valid[idx] &&
+         ae->ssid == ssid && ae->tsid == tsid && ae->tclass == tclass )
+        return &ae->avd;
+
+    return NULL;
+}
+
+static void avc_local_insert(u32 ssid, u32 tsid, u16 tclass,
+                             const struct av_decision *avd)
+{
+    struct avc_local_cache *cache = avc_local_get();
+    unsigned int idx = avc_local_hash(ssid, tsid, tclass);
+    struct avc_entry *ae = &cache->entry[idx];
+
+    /*
+     * Mark the slot invalid while it is repopulated, so a lookup from
+     * an interrupting context never sees a half-written entry.
+     */
+    cache->valid[idx] = false;
+    ae->ssid = ssid;
+    ae->tsid = tsid;
+    ae->tclass = tclass;
+    ae->avd = *avd;
+    cache->valid[idx] = true;
+}
+
+static void avc_local_invalidate(u32 ssid, u32 tsid, u16 tclass)
+{
+    struct avc_local_cache *cache = avc_local_get();
+    unsigned int idx = avc_local_hash(ssid, tsid, tclass);
+
+    cache->valid[idx] = false;
+}
+
 /* no use making this larger than the printk buffer */
 #define AVC_BUF_SIZE 1024
 static DEFINE_SPINLOCK(avc_emerg_lock);
@@ -683,6 +762,9 @@ int avc_ss_reset(u32 seqno)
     struct hlist_node *next;
     spinlock_t *lock;
 
+    /* Invalidate every CPU's local tier before emptying the hash. */
+    write_atomic(&avc_local_gen, avc_local_gen + 1);
+
     for ( i = 0; i < AVC_CACHE_SLOTS; i++ )
     {
         head = &avc_cache.slots[i];
@@ -729,6 +811,27 @@ int avc_has_perm_noaudit(u32 ssid, u32 tsid, u16 tclass, u32 requested,
 
     BUG_ON(!requested);
 
+    /*
+     * Fast path: serve fully granted requests from the per-CPU tier
+     * without touching the shared hash. Denials (including the
+     * permissive-mode learning path) fall through to the shared cache,
+     * which holds the authoritative entry.
+     */
+    avd = avc_local_lookup(ssid, tsid, tclass);
+    if ( avd )
+    {
+        avc_cache_stats_incr(lookups);
+        denied = requested & ~avd->allowed;
+        if ( !denied )
+        {
+            avc_cache_stats_incr(hits);
+            if ( in_avd )
+                memcpy(in_avd, avd, sizeof(*in_avd));
+            return 0;
+        }
+        avc_local_invalidate(ssid, tsid, tclass);
+    }
+
     rcu_read_lock(&avc_rcu_lock);
 
     node = avc_lookup(ssid, tsid, tclass);
@@ -761,12 +864,41 @@ int avc_has_perm_noaudit(u32 ssid, u32 tsid, u16 tclass, u32 requested,
         else
             rc = -EACCES;
     }
+    else if ( node )
+        /*
+         * Only mirror entries the shared cache accepted: avc_insert()
+         * refuses decisions which predate a revocation notification.
+         */
+        avc_local_insert(ssid, tsid, tclass, avd);
 
     rcu_read_unlock(&avc_rcu_lock);
  out:
     return rc;
 }
 
+/**
+ * avc_prime - Precompute and cache the decision for a SID pair.
+ * @ssid: source security identifier
+ * @tsid: target security identifier
+ * @tclass: target security class
+ *
+ * Called by the security server after a policy (re)load to seed the
+ * cache for hot paths, so the first check after a reload does not pay
+ * for a policy database walk. Failures are not fatal - the pair will
+ * simply be computed on first use instead.
+ */
+void avc_prime(u32 ssid, u32 tsid, u16 tclass)
+{
+    struct av_decision avd;
+
+    if ( security_compute_av(ssid, tsid, tclass, 0, &avd) )
+        return;
+
+    rcu_read_lock(&avc_rcu_lock);
+    avc_insert(ssid, tsid, tclass, &avd);
+    rcu_read_unlock(&avc_rcu_lock);
+}
+
 /**
  * avc_has_perm - Check permissions and perform any appropriate auditing.
  * @ssid: source security identifier
@@ -1343,6 +1343,43 @@ bad:
 
 static int security_preserve_bools(struct policydb *p);
 
+/*
+ * Seed the AVC with decisions for the hot inter-domain paths (event
+ * channels and grants) for every SID currently in use, so the first
+ * hypercalls after a policy load do not each pay for a policy walk.
+ */
+#define PRESEED_MAX_SIDS 64
+
+struct preseed_args {
+    u32 sids[PRESEED_MAX_SIDS];
+    unsigned int nr;
+};
+
+static int preseed_collect_sid(u32 sid, struct context *context, void *arg)
+{
+    struct preseed_args *args = arg;
+
+    if ( args->nr < PRESEED_MAX_SIDS )
+        args->sids[args->nr++] = sid;
+
+    return 0;
+}
+
+static void preseed_avc(void)
+{
+    struct preseed_args args = { .nr = 0 };
+    unsigned int i, j;
+
+    sidtab_map(&sidtab, preseed_collect_sid, &args);
+
+    for ( i = 0; i < args.nr; i++ )
+        for ( j = 0; j < args.nr; j++ )
+        {
+            avc_prime(args.sids[i], args.sids[j], SECCLASS_EVENT);
+            avc_prime(args.sids[i], args.sids[j], SECCLASS_GRANT);
+        }
+}
+
 /**
  * security_load_policy - Load a security policy configuration.
  * @data: binary policy data
@@ -1391,6 +1428,7 @@ int security_load_policy(const void *data, size_t len)
         seqno = ++latest_granting;
         LOAD_UNLOCK;
         avc_ss_reset(seqno);
+        preseed_avc();
         return 0;
     }
 
@@ -1454,6 +1492,7 @@ int security_load_policy(const void *data, size_t len)
     sidtab_destroy(&oldsidtab);
 
     avc_ss_reset(seqno);
+    preseed_avc();
 
     return 0;
 